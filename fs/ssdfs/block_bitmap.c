@@ -183,6 +183,40 @@ static
 void ssdfs_debug_block_bitmap(struct ssdfs_block_bmap *bmap);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+/*
+ * ssdfs_correct_free_lower_bound() - correct free blocks' bound
+ * @blk_bmap: pointer on block bitmap
+ * @range: range of blocks that has been changed
+ * @blk_state: new state of the range
+ *
+ * The lower bound of free blocks guarantees that all blocks
+ * before it are not free. It means that any search of free
+ * blocks can start from the bound instead of the bitmap's
+ * beginning.
+ */
+static inline
+void ssdfs_correct_free_lower_bound(struct ssdfs_block_bmap *blk_bmap,
+				    struct ssdfs_block_bmap_range *range,
+				    int blk_state)
+{
+	u32 end = range->start + range->len;
+
+	if (blk_state == SSDFS_BLK_FREE) {
+		if (range->start < blk_bmap->free_lower_bound)
+			blk_bmap->free_lower_bound = range->start;
+	} else if (range->start <= blk_bmap->free_lower_bound &&
+		   blk_bmap->free_lower_bound < end) {
+		blk_bmap->free_lower_bound = end;
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("range (start %u, len %u), blk_state %#x, "
+		  "free_lower_bound %u\n",
+		  range->start, range->len, blk_state,
+		  blk_bmap->free_lower_bound);
+#endif /* CONFIG_SSDFS_DEBUG */
+}
+
 /*
  * ssdfs_block_bmap_storage_destroy() - destroy block bitmap's storage
  * @storage: pointer on block bitmap's storage
@@ -205,6 +239,13 @@ void ssdfs_block_bmap_storage_destroy(struct ssdfs_block_bmap_storage *storage)
 			ssdfs_block_bmap_kfree(storage->buf);
 		break;
 
+	case SSDFS_BLOCK_BMAP_STORAGE_RLE:
+		if (storage->runs)
+			ssdfs_block_bmap_kfree(storage->runs);
+		storage->runs = NULL;
+		storage->runs_count = 0;
+		break;
+
 	default:
 		SSDFS_WARN("unexpected state %#x\n", storage->state);
 		break;
@@ -435,6 +476,10 @@ int ssdfs_block_bmap_create(struct ssdfs_fs_info *fsi,
 	ptr->metadata_items = 0;
 	ptr->used_blks = 0;
 	ptr->invalid_blks = 0;
+	ptr->free_lower_bound = 0;
+	ptr->last_access = jiffies;
+	ptr->storage.runs = NULL;
+	ptr->storage.runs_count = 0;
 
 	err = ssdfs_block_bmap_create_empty_storage(&ptr->storage, bmap_bytes);
 	if (unlikely(err)) {
@@ -471,6 +516,8 @@ int ssdfs_block_bmap_create(struct ssdfs_fs_info *fsi,
 				  range.start, range.len, init_state, err);
 			goto destroy_pagevec;
 		}
+
+		ssdfs_correct_free_lower_bound(ptr, &range, init_state);
 	}
 
 	err = ssdfs_cache_block_state(ptr, 0, SSDFS_BLK_FREE);
@@ -754,6 +801,7 @@ int ssdfs_block_bmap_init(struct ssdfs_block_bmap *blk_bmap,
 	}
 
 	blk_bmap->invalid_blks = invalid_blks;
+	blk_bmap->free_lower_bound = 0;
 
 	err = ssdfs_block_bmap_init_storage(blk_bmap, source);
 	if (unlikely(err)) {
@@ -874,7 +922,8 @@ int ssdfs_define_last_free_page(struct ssdfs_block_bmap *blk_bmap,
 
 	if (is_cache_invalid(blk_bmap, SSDFS_BLK_FREE)) {
 		err = ssdfs_block_bmap_find_block(blk_bmap,
-						  0, max_blk,
+						  blk_bmap->free_lower_bound,
+						  max_blk,
 						  SSDFS_BLK_FREE,
 						  found_blk);
 		if (err == -ENODATA) {
@@ -1208,6 +1257,403 @@ void ssdfs_block_bmap_forget_snapshot(struct ssdfs_page_vector *snapshot)
 	ssdfs_page_vector_release(snapshot);
 }
 
+/*
+ * struct ssdfs_blk_bmap_rle_cursor - cursor of run-length encoding
+ * @runs: array of runs (NULL means calculation of runs only)
+ * @count: number of runs
+ * @max_runs: maximum possible number of runs
+ * @last_state: state of the last run
+ * @index: index of current run (decoding)
+ * @offset: number of decoded blocks in current run (decoding)
+ */
+struct ssdfs_blk_bmap_rle_cursor {
+	u32 *runs;
+	u32 count;
+	u32 max_runs;
+	int last_state;
+	u32 index;
+	u32 offset;
+};
+
+/*
+ * ssdfs_blk_bmap_rle_encode_bytes() - encode bytes of block bitmap
+ * @cursor: encoding cursor
+ * @bytes: encoded bytes
+ * @bytes_count: number of bytes
+ *
+ * This function adds the states of @bytes into the sequence of runs.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-E2BIG      - number of runs is bigger than maximum.
+ */
+static
+int ssdfs_blk_bmap_rle_encode_bytes(struct ssdfs_blk_bmap_rle_cursor *cursor,
+				    u8 *bytes, u32 bytes_count)
+{
+	u32 items_per_byte = SSDFS_ITEMS_PER_BYTE(SSDFS_BLK_STATE_BITS);
+	u32 *run;
+	u32 len;
+	int state;
+	u32 i, j;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!cursor || !bytes);
+
+	SSDFS_DBG("runs count %u, bytes_count %u\n",
+		  cursor->count, bytes_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	for (i = 0; i < bytes_count; i++) {
+		for (j = 0; j < items_per_byte; j++) {
+			state = (bytes[i] >> (j * SSDFS_BLK_STATE_BITS)) &
+					SSDFS_BLK_STATE_MASK;
+
+			if (cursor->count > 0 && state == cursor->last_state) {
+				if (cursor->runs) {
+					run = &cursor->runs[cursor->count - 1];
+					len = SSDFS_BLK_BMAP_RUN_LEN(*run) + 1;
+					*run = SSDFS_BLK_BMAP_RUN(state, len);
+				}
+				continue;
+			}
+
+			if (cursor->count >= cursor->max_runs)
+				return -E2BIG;
+
+			if (cursor->runs) {
+				cursor->runs[cursor->count] =
+					SSDFS_BLK_BMAP_RUN(state, 1);
+			}
+
+			cursor->count++;
+			cursor->last_state = state;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_blk_bmap_rle_decode_bytes() - decode bytes of block bitmap
+ * @cursor: decoding cursor
+ * @bytes: decoded bytes [out]
+ * @bytes_count: number of bytes
+ *
+ * This function restores the states of @bytes from
+ * the sequence of runs.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - sequence of runs is shorter than bytes.
+ */
+static
+int ssdfs_blk_bmap_rle_decode_bytes(struct ssdfs_blk_bmap_rle_cursor *cursor,
+				    u8 *bytes, u32 bytes_count)
+{
+	u32 items_per_byte = SSDFS_ITEMS_PER_BYTE(SSDFS_BLK_STATE_BITS);
+	u32 run;
+	u8 value;
+	u32 i, j;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!cursor || !cursor->runs || !bytes);
+
+	SSDFS_DBG("run index %u, runs count %u, bytes_count %u\n",
+		  cursor->index, cursor->count, bytes_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	for (i = 0; i < bytes_count; i++) {
+		value = 0;
+
+		for (j = 0; j < items_per_byte; j++) {
+			if (cursor->index >= cursor->count)
+				return -ERANGE;
+
+			run = cursor->runs[cursor->index];
+			value |= SSDFS_BLK_BMAP_RUN_STATE(run) <<
+					(j * SSDFS_BLK_STATE_BITS);
+
+			cursor->offset++;
+			if (cursor->offset >= SSDFS_BLK_BMAP_RUN_LEN(run)) {
+				cursor->index++;
+				cursor->offset = 0;
+			}
+		}
+
+		bytes[i] = value;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_block_bmap_rle_encode() - encode block bitmap's storage
+ * @blk_bmap: pointer on block bitmap
+ * @cursor: encoding cursor
+ */
+static
+int ssdfs_block_bmap_rle_encode(struct ssdfs_block_bmap *blk_bmap,
+				struct ssdfs_blk_bmap_rle_cursor *cursor)
+{
+	struct ssdfs_page_vector *array;
+	struct page *page;
+	void *kaddr;
+	int i;
+	int err = 0;
+
+	switch (blk_bmap->storage.state) {
+	case SSDFS_BLOCK_BMAP_STORAGE_PAGE_VEC:
+		array = &blk_bmap->storage.array;
+
+		for (i = 0; i < ssdfs_page_vector_count(array); i++) {
+			page = array->pages[i];
+
+			kaddr = kmap_local_page(page);
+			err = ssdfs_blk_bmap_rle_encode_bytes(cursor, kaddr,
+							      PAGE_SIZE);
+			kunmap_local(kaddr);
+
+			if (err)
+				break;
+		}
+		break;
+
+	case SSDFS_BLOCK_BMAP_STORAGE_BUFFER:
+		err = ssdfs_blk_bmap_rle_encode_bytes(cursor,
+						blk_bmap->storage.buf,
+						blk_bmap->bytes_count);
+		break;
+
+	default:
+		err = -EOPNOTSUPP;
+		break;
+	}
+
+	return err;
+}
+
+/*
+ * ssdfs_block_bmap_inflate() - restore storage of compacted block bitmap
+ * @blk_bmap: pointer on block bitmap
+ *
+ * This function restores the pagevec or buffer of block bitmap
+ * from the run-length encoded representation.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - unable to allocate memory.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_block_bmap_inflate(struct ssdfs_block_bmap *blk_bmap)
+{
+	struct ssdfs_block_bmap_storage *storage = &blk_bmap->storage;
+	struct ssdfs_blk_bmap_rle_cursor cursor = {0};
+	u32 items_per_page = PAGE_SIZE *
+				SSDFS_ITEMS_PER_BYTE(SSDFS_BLK_STATE_BITS);
+	u32 total_items = 0;
+	struct page *page;
+	void *kaddr;
+	u32 i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!mutex_is_locked(&blk_bmap->lock));
+	BUG_ON(storage->state != SSDFS_BLOCK_BMAP_STORAGE_RLE);
+
+	SSDFS_DBG("blk_bmap %p, runs_count %u\n",
+		  blk_bmap, storage->runs_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	cursor.runs = storage->runs;
+	cursor.count = storage->runs_count;
+
+	for (i = 0; i < cursor.count; i++)
+		total_items += SSDFS_BLK_BMAP_RUN_LEN(cursor.runs[i]);
+
+	err = ssdfs_block_bmap_create_empty_storage(storage,
+						    blk_bmap->bytes_count);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to create empty bmap's storage: "
+			  "bmap_bytes %zu, err %d\n",
+			  blk_bmap->bytes_count, err);
+		goto restore_rle_state;
+	}
+
+	switch (storage->state) {
+	case SSDFS_BLOCK_BMAP_STORAGE_PAGE_VEC:
+		for (i = 0; i < (total_items / items_per_page); i++) {
+			page = ssdfs_page_vector_allocate(&storage->array);
+			if (IS_ERR_OR_NULL(page)) {
+				err = (page == NULL ? -ENOMEM : PTR_ERR(page));
+				SSDFS_ERR("unable to allocate #%u page\n", i);
+				goto destroy_storage;
+			}
+
+			kaddr = kmap_local_page(page);
+			err = ssdfs_blk_bmap_rle_decode_bytes(&cursor, kaddr,
+							      PAGE_SIZE);
+			kunmap_local(kaddr);
+
+			if (unlikely(err)) {
+				SSDFS_ERR("fail to decode page #%u: err %d\n",
+					  i, err);
+				goto destroy_storage;
+			}
+		}
+		break;
+
+	case SSDFS_BLOCK_BMAP_STORAGE_BUFFER:
+		err = ssdfs_blk_bmap_rle_decode_bytes(&cursor, storage->buf,
+						      blk_bmap->bytes_count);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to decode buffer: err %d\n", err);
+			goto destroy_storage;
+		}
+		break;
+
+	default:
+		err = -ERANGE;
+		SSDFS_ERR("unexpected state %#x\n", storage->state);
+		goto destroy_storage;
+	}
+
+	ssdfs_block_bmap_kfree(storage->runs);
+	storage->runs = NULL;
+	storage->runs_count = 0;
+
+	return 0;
+
+destroy_storage:
+	ssdfs_block_bmap_storage_destroy(storage);
+
+restore_rle_state:
+	storage->state = SSDFS_BLOCK_BMAP_STORAGE_RLE;
+	return err;
+}
+
+/*
+ * ssdfs_block_bmap_compact() - compact storage of idle block bitmap
+ * @blk_bmap: pointer on block bitmap
+ * @force: compact the block bitmap independently from idle time
+ *
+ * This function replaces the pagevec or buffer of block bitmap
+ * by run-length encoded representation if the bitmap hasn't been
+ * accessed during SSDFS_BLK_BMAP_IDLE_TIMEOUT (or @force is requested
+ * by memory shrinker). The compaction
+ * is made only if the encoded bitmap is two times smaller
+ * at least. The storage is restored transparently by
+ * ssdfs_block_bmap_lock().
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EBUSY      - block bitmap is locked.
+ * %-EAGAIN     - block bitmap is not idle or is dirty.
+ * %-E2BIG      - block bitmap cannot be compacted efficiently.
+ * %-ENOMEM     - unable to allocate memory.
+ */
+int ssdfs_block_bmap_compact(struct ssdfs_block_bmap *blk_bmap, bool force)
+{
+	struct ssdfs_block_bmap_storage *storage;
+	struct ssdfs_blk_bmap_rle_cursor cursor = {0};
+	gfp_t gfp_mask = force ? GFP_NOWAIT | __GFP_NOWARN : GFP_KERNEL;
+	size_t raw_bytes;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!blk_bmap);
+
+	SSDFS_DBG("blk_bmap %p\n", blk_bmap);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!mutex_trylock(&blk_bmap->lock))
+		return -EBUSY;
+
+	storage = &blk_bmap->storage;
+
+	if (!is_block_bmap_initialized(blk_bmap) ||
+	    is_block_bmap_dirty(blk_bmap)) {
+		err = -EAGAIN;
+		goto finish_compaction;
+	}
+
+	if (!force && time_before(jiffies, blk_bmap->last_access +
+					SSDFS_BLK_BMAP_IDLE_TIMEOUT)) {
+		err = -EAGAIN;
+		goto finish_compaction;
+	}
+
+	switch (storage->state) {
+	case SSDFS_BLOCK_BMAP_STORAGE_PAGE_VEC:
+		raw_bytes = (size_t)ssdfs_page_vector_count(&storage->array) *
+								PAGE_SIZE;
+		break;
+
+	case SSDFS_BLOCK_BMAP_STORAGE_BUFFER:
+		raw_bytes = blk_bmap->bytes_count;
+		break;
+
+	default:
+		err = -EAGAIN;
+		goto finish_compaction;
+	}
+
+	cursor.max_runs = raw_bytes / (2 * sizeof(u32));
+
+	/* calculate the number of runs at first */
+	err = ssdfs_block_bmap_rle_encode(blk_bmap, &cursor);
+	if (err || cursor.count == 0) {
+		err = -E2BIG;
+		goto finish_compaction;
+	}
+
+	cursor.runs = ssdfs_block_bmap_kcalloc(cursor.count, sizeof(u32),
+						gfp_mask);
+	if (!cursor.runs) {
+		err = -ENOMEM;
+		if (!force) {
+			SSDFS_ERR("fail to allocate runs: count %u\n",
+				  cursor.count);
+		}
+		goto finish_compaction;
+	}
+
+	cursor.max_runs = cursor.count;
+	cursor.count = 0;
+
+	err = ssdfs_block_bmap_rle_encode(blk_bmap, &cursor);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to encode block bitmap: err %d\n", err);
+		ssdfs_block_bmap_kfree(cursor.runs);
+		goto finish_compaction;
+	}
+
+	ssdfs_block_bmap_storage_destroy(storage);
+
+	storage->runs = cursor.runs;
+	storage->runs_count = cursor.count;
+	storage->state = SSDFS_BLOCK_BMAP_STORAGE_RLE;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("block bitmap has been compacted: "
+		  "raw_bytes %zu, runs_count %u\n",
+		  raw_bytes, storage->runs_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+finish_compaction:
+	mutex_unlock(&blk_bmap->lock);
+	return err;
+}
+
 /*
  * ssdfs_block_bmap_lock() - lock segment's block bitmap
  * @blk_bmap: pointer on block bitmap
@@ -1226,6 +1672,18 @@ int ssdfs_block_bmap_lock(struct ssdfs_block_bmap *blk_bmap)
 		return err;
 	}
 
+	if (blk_bmap->storage.state == SSDFS_BLOCK_BMAP_STORAGE_RLE) {
+		err = ssdfs_block_bmap_inflate(blk_bmap);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to inflate block bitmap: err %d\n",
+				  err);
+			mutex_unlock(&blk_bmap->lock);
+			return err;
+		}
+	}
+
+	blk_bmap->last_access = jiffies;
+
 	return 0;
 }
 
@@ -1869,6 +2327,45 @@ bool BYTE_CONTAINS_STATE(u8 *value, int blk_state)
 	return false;
 }
 
+#define SSDFS_BLK_BMAP_WORD_LOW_BITS		(0x5555555555555555ULL)
+#define SSDFS_BLK_BMAP_WORD_HIGH_BITS		(0xAAAAAAAAAAAAAAAAULL)
+
+/*
+ * WORD_STATES_PATTERN() - define word that contains @blk_state only
+ * @blk_state: requested block's state
+ */
+static inline
+u64 WORD_STATES_PATTERN(int blk_state)
+{
+	BUILD_BUG_ON(SSDFS_BLK_STATE_BITS != 2);
+
+	return SSDFS_BLK_BMAP_WORD_LOW_BITS * (u64)blk_state;
+}
+
+/*
+ * WORD_CONTAINS_STATE() - check that 64-bit word contains requested state
+ * @word: analysed word of packed block states
+ * @blk_state: requested block's state
+ *
+ * All 32 states of the word are compared with @blk_state
+ * in parallel: the matched states become zero after XOR and
+ * the zero states are detected by the borrow in the high bit
+ * of every state.
+ *
+ * RETURN:
+ * [true]  - @word contains @blk_state.
+ * [false] - @word hasn't @blk_state.
+ */
+static inline
+bool WORD_CONTAINS_STATE(u64 word, int blk_state)
+{
+	u64 value = word ^ WORD_STATES_PATTERN(blk_state);
+
+	value = (value - SSDFS_BLK_BMAP_WORD_LOW_BITS) & ~value;
+
+	return (value & SSDFS_BLK_BMAP_WORD_HIGH_BITS) != 0;
+}
+
 /*
  * ssdfs_block_bmap_find_block_in_cache() - find block for state in cache
  * @blk_bmap: pointer on block bitmap
@@ -2089,6 +2586,18 @@ int ssdfs_block_bmap_find_block_in_memory_range(void *kaddr,
 
 	for (; *byte_index < search_bytes; ++(*byte_index)) {
 		u8 *value = (u8 *)kaddr + *byte_index;
+		u64 word;
+
+		if (start_off == 0 &&
+		    (*byte_index + sizeof(u64)) <= search_bytes) {
+			memcpy(&word, value, sizeof(u64));
+
+			if (!WORD_CONTAINS_STATE(word, blk_state)) {
+				/* skip the whole word */
+				*byte_index += sizeof(u64) - 1;
+				continue;
+			}
+		}
 
 		err = FIND_FIRST_ITEM_IN_BYTE(value, blk_state,
 					      SSDFS_BLK_STATE_BITS,
@@ -2833,6 +3342,7 @@ int ssdfs_block_bmap_find_state_area_end_in_memory(void *kaddr,
 						   u8 start_off,
 						   u8 *found_off)
 {
+	u64 pattern;
 	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -2844,8 +3354,22 @@ int ssdfs_block_bmap_find_state_area_end_in_memory(void *kaddr,
 	}
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	pattern = WORD_STATES_PATTERN(blk_state);
+
 	for (; *byte_index < search_bytes; ++(*byte_index)) {
 		u8 *value = (u8 *)kaddr + *byte_index;
+		u64 word;
+
+		if (start_off == 0 &&
+		    (*byte_index + sizeof(u64)) <= search_bytes) {
+			memcpy(&word, value, sizeof(u64));
+
+			if (word == pattern) {
+				/* the whole word contains @blk_state only */
+				*byte_index += sizeof(u64) - 1;
+				continue;
+			}
+		}
 
 		err = ssdfs_find_state_area_end_in_byte(value,
 							blk_state,
@@ -3744,6 +4268,9 @@ int ssdfs_block_bmap_find_range(struct ssdfs_block_bmap *blk_bmap,
 	range->start = U32_MAX;
 	range->len = 0;
 
+	if (blk_state == SSDFS_BLK_FREE)
+		start = max_t(u32, start, blk_bmap->free_lower_bound);
+
 	if (start >= max_blk) {
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("start %u >= max_blk %u\n", start, max_blk);
@@ -3773,6 +4300,12 @@ int ssdfs_block_bmap_find_range(struct ssdfs_block_bmap *blk_bmap,
 		return -EINVAL;
 	}
 
+	if (blk_state == SSDFS_BLK_FREE &&
+	    start == blk_bmap->free_lower_bound) {
+		/* blocks [start, found_start) are not free */
+		blk_bmap->free_lower_bound = found_start;
+	}
+
 	err = ssdfs_block_bmap_find_state_area_end(blk_bmap, found_start,
 						   found_start + len,
 						   blk_state,
@@ -3958,6 +4491,8 @@ int ssdfs_block_bmap_set_range(struct ssdfs_block_bmap *blk_bmap,
 		}
 	}
 
+	ssdfs_correct_free_lower_bound(blk_bmap, range, blk_state);
+
 #ifdef CONFIG_SSDFS_DEBUG
 	ssdfs_debug_block_bitmap(blk_bmap);
 #endif /* CONFIG_SSDFS_DEBUG */
@@ -5261,6 +5796,7 @@ int ssdfs_block_bmap_clean(struct ssdfs_block_bmap *blk_bmap)
 	blk_bmap->metadata_items = 0;
 	blk_bmap->used_blks = 0;
 	blk_bmap->invalid_blks = 0;
+	blk_bmap->free_lower_bound = 0;
 
 	for (i = 0; i < SSDFS_SEARCH_TYPE_MAX; i++) {
 		blk_bmap->last_search[i].page_index = max_capacity;
@@ -155,11 +155,15 @@ int SSDFS_GET_CACHE_TYPE(int blk_state)
  * @state: storage state
  * @array: vector of pages
  * @buf: pointer on memory buffer
+ * @runs: run-length encoded states of compacted bitmap
+ * @runs_count: number of runs in compacted bitmap
  */
 struct ssdfs_block_bmap_storage {
 	int state;
 	struct ssdfs_page_vector array;
 	void *buf;
+	u32 *runs;
+	u32 runs_count;
 };
 
 /* Block bitmap's storage's states */
@@ -167,9 +171,24 @@ enum {
 	SSDFS_BLOCK_BMAP_STORAGE_ABSENT,
 	SSDFS_BLOCK_BMAP_STORAGE_PAGE_VEC,
 	SSDFS_BLOCK_BMAP_STORAGE_BUFFER,
+	SSDFS_BLOCK_BMAP_STORAGE_RLE,
 	SSDFS_BLOCK_BMAP_STORAGE_STATE_MAX
 };
 
+/*
+ * Run of compacted block bitmap: length of run is stored
+ * in high bits and state of blocks in low bits.
+ */
+#define SSDFS_BLK_BMAP_RUN(state, len) \
+	(((u32)(len) << SSDFS_BLK_STATE_BITS) | ((u32)(state)))
+#define SSDFS_BLK_BMAP_RUN_STATE(run) \
+	((int)((run) & SSDFS_BLK_STATE_MASK))
+#define SSDFS_BLK_BMAP_RUN_LEN(run) \
+	((u32)(run) >> SSDFS_BLK_STATE_BITS)
+
+/* Block bitmap is compacted if it isn't accessed during this time */
+#define SSDFS_BLK_BMAP_IDLE_TIMEOUT	(600 * HZ)
+
 /*
  * struct ssdfs_block_bmap - in-core segment's block bitmap
  * @lock: block bitmap lock
@@ -180,6 +199,8 @@ enum {
  * @metadata_items: count of metadata items
  * @used_blks: count of valid blocks
  * @invalid_blks: count of invalid blocks
+ * @free_lower_bound: all blocks before this one are not free
+ * @last_access: time of last access (jiffies)
  * @last_search: last search/access cache array
  */
 struct ssdfs_block_bmap {
@@ -191,6 +212,8 @@ struct ssdfs_block_bmap {
 	u32 metadata_items;
 	u32 used_blks;
 	u32 invalid_blks;
+	u32 free_lower_bound;
+	unsigned long last_access;
 	struct ssdfs_last_bmap_search last_search[SSDFS_SEARCH_TYPE_MAX];
 };
 
@@ -293,6 +316,7 @@ void ssdfs_block_bmap_forget_snapshot(struct ssdfs_page_vector *snapshot);
 int ssdfs_block_bmap_lock(struct ssdfs_block_bmap *blk_bmap);
 bool ssdfs_block_bmap_is_locked(struct ssdfs_block_bmap *blk_bmap);
 void ssdfs_block_bmap_unlock(struct ssdfs_block_bmap *blk_bmap);
+int ssdfs_block_bmap_compact(struct ssdfs_block_bmap *blk_bmap, bool force);
 
 bool ssdfs_block_bmap_dirtied(struct ssdfs_block_bmap *blk_bmap);
 void ssdfs_block_bmap_clear_dirty_state(struct ssdfs_block_bmap *blk_bmap);
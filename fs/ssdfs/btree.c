@@ -23,6 +23,7 @@
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/pagevec.h>
+#include <linux/workqueue.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -134,7 +135,8 @@ int ssdfs_btree_radix_tree_insert(struct ssdfs_btree *tree,
 		SSDFS_ERR("fail to add node into radix tree: "
 			  "node_id %llu, node %p, err %d\n",
 			  (u64)node_id, node, err);
-	}
+	} else
+		atomic64_inc(&tree->fsi->btree_nodes_count);
 
 	return err;
 }
@@ -166,6 +168,9 @@ struct ssdfs_btree_node *ssdfs_btree_radix_tree_delete(struct ssdfs_btree *tree,
 	ptr = radix_tree_delete(&tree->nodes, node_id);
 	spin_unlock(&tree->nodes_lock);
 
+	if (ptr)
+		atomic64_dec(&tree->fsi->btree_nodes_count);
+
 	return ptr;
 }
 
@@ -209,6 +214,296 @@ int ssdfs_btree_radix_tree_find(struct ssdfs_btree *tree,
 	return 0;
 }
 
+/*
+ * can_ssdfs_btree_nodes_be_evicted() - check that tree's nodes are evictable
+ * @tree: btree object
+ *
+ * Only the trees that find nodes by means of regular search
+ * (and re-read the absent nodes from the volume) can have
+ * the evicted nodes.
+ */
+static inline
+bool can_ssdfs_btree_nodes_be_evicted(struct ssdfs_btree *tree)
+{
+	switch (tree->type) {
+	case SSDFS_DENTRIES_BTREE:
+	case SSDFS_EXTENTS_BTREE:
+	case SSDFS_XATTR_BTREE:
+	case SSDFS_SHARED_DICTIONARY_BTREE:
+		return true;
+
+	default:
+		/* do nothing */
+		break;
+	}
+
+	return false;
+}
+
+/*
+ * is_ssdfs_btree_node_evictable() - check that node can be evicted
+ * @tree: btree object
+ * @node: node object
+ *
+ * The node can be evicted if it is clean initialized leaf node
+ * without flush in progress that nobody references and that
+ * hasn't been accessed since the previous eviction scan.
+ * Index and hybrid nodes are never evicted.
+ */
+static
+bool is_ssdfs_btree_node_evictable(struct ssdfs_btree *tree,
+				   struct ssdfs_btree_node *node)
+{
+	bool is_dirty;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!rwsem_is_locked(&tree->lock));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (atomic_read(&node->type) != SSDFS_BTREE_LEAF_NODE)
+		return false;
+
+	if (atomic_read(&node->state) != SSDFS_BTREE_NODE_INITIALIZED)
+		return false;
+
+	if (is_ssdfs_btree_node_pre_deleted(node))
+		return false;
+
+	if (atomic_read(&node->refs_count) > 0)
+		return false;
+
+	switch (atomic_read(&node->flush_req.result.state)) {
+	case SSDFS_UNKNOWN_REQ_RESULT:
+	case SSDFS_REQ_FINISHED:
+		/* no flush in progress */
+		break;
+
+	default:
+		return false;
+	}
+
+	spin_lock(&tree->nodes_lock);
+	is_dirty = radix_tree_tag_get(&tree->nodes, node->node_id,
+					SSDFS_BTREE_NODE_DIRTY_TAG) ||
+		   radix_tree_tag_get(&tree->nodes, node->node_id,
+					SSDFS_BTREE_NODE_TOWRITE_TAG);
+	spin_unlock(&tree->nodes_lock);
+
+	if (is_dirty)
+		return false;
+
+	/* second chance for recently used node */
+	if (atomic_xchg(&node->lru_referenced, 0) != 0)
+		return false;
+
+	return true;
+}
+
+#define SSDFS_BTREE_EVICT_BATCH_SIZE	(16)
+
+/*
+ * ssdfs_btree_evict_clean_nodes() - evict clean leaf nodes of the tree
+ * @tree: btree object
+ * @nr_to_scan: maximum number of nodes for scanning
+ * @scanned: number of scanned nodes [out]
+ *
+ * This method tries to evict the clean and idle leaf nodes
+ * of the tree. The evicted node is read from the volume again
+ * by the next search operation.
+ *
+ * RETURN:
+ * number of evicted nodes.
+ */
+static
+unsigned long ssdfs_btree_evict_clean_nodes(struct ssdfs_btree *tree,
+					    unsigned long nr_to_scan,
+					    unsigned long *scanned)
+{
+	struct ssdfs_btree_node *batch[SSDFS_BTREE_EVICT_BATCH_SIZE];
+	struct ssdfs_btree_node *node;
+	unsigned long index = SSDFS_BTREE_ROOT_NODE_ID + 1;
+	unsigned long evicted = 0;
+	unsigned int count;
+	unsigned int i;
+
+	if (!can_ssdfs_btree_nodes_be_evicted(tree))
+		return 0;
+
+	if (!down_write_trylock(&tree->lock))
+		return 0;
+
+	while (*scanned < nr_to_scan) {
+		spin_lock(&tree->nodes_lock);
+		count = radix_tree_gang_lookup(&tree->nodes, (void **)batch,
+					       index,
+					       SSDFS_BTREE_EVICT_BATCH_SIZE);
+		spin_unlock(&tree->nodes_lock);
+
+		if (count == 0)
+			break;
+
+		index = batch[count - 1]->node_id + 1;
+
+		for (i = 0; i < count && *scanned < nr_to_scan; i++) {
+			node = batch[i];
+			(*scanned)++;
+
+			if (!is_ssdfs_btree_node_evictable(tree, node))
+				continue;
+
+			if (!down_write_trylock(&node->full_lock))
+				continue;
+			up_write(&node->full_lock);
+
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("evict node: tree_type %#x, node_id %u\n",
+				  tree->type, node->node_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+			ssdfs_btree_radix_tree_delete(tree, node->node_id);
+
+			if (tree->btree_ops && tree->btree_ops->destroy_node)
+				tree->btree_ops->destroy_node(node);
+
+			ssdfs_btree_node_destroy(node);
+			evicted++;
+		}
+	}
+
+	up_write(&tree->lock);
+
+	return evicted;
+}
+
+/*
+ * ssdfs_btree_nodes_count() - count btree nodes in memory
+ * @shrink: shrinker object
+ * @sc: shrink control
+ */
+static
+unsigned long ssdfs_btree_nodes_count(struct shrinker *shrink,
+				      struct shrink_control *sc)
+{
+	struct ssdfs_fs_info *fsi;
+	s64 count;
+
+	fsi = container_of(shrink, struct ssdfs_fs_info,
+			   btree_nodes_shrinker);
+	count = atomic64_read(&fsi->btree_nodes_count);
+
+	return count > 0 ? (unsigned long)count : SHRINK_EMPTY;
+}
+
+/*
+ * ssdfs_btree_nodes_scan() - evict clean leaf nodes of btrees
+ * @shrink: shrinker object
+ * @sc: shrink control
+ *
+ * This method walks through the btrees in round-robin manner
+ * and evicts the clean leaf nodes that have not been accessed
+ * since the previous scan. The btrees that are locked
+ * at the moment are skipped.
+ */
+static
+unsigned long ssdfs_btree_nodes_scan(struct shrinker *shrink,
+				     struct shrink_control *sc)
+{
+	struct ssdfs_fs_info *fsi;
+	struct ssdfs_btree *tree, *tmp;
+	LIST_HEAD(processed);
+	unsigned long scanned = 0;
+	unsigned long freed = 0;
+
+	fsi = container_of(shrink, struct ssdfs_fs_info,
+			   btree_nodes_shrinker);
+
+	if (!(sc->gfp_mask & __GFP_FS))
+		return SHRINK_STOP;
+
+	if (!mutex_trylock(&fsi->btrees_lock))
+		return SHRINK_STOP;
+
+	list_for_each_entry_safe(tree, tmp, &fsi->btrees_list, list) {
+		if (scanned >= sc->nr_to_scan)
+			break;
+
+		freed += ssdfs_btree_evict_clean_nodes(tree, sc->nr_to_scan,
+							&scanned);
+		list_move_tail(&tree->list, &processed);
+	}
+
+	list_splice_tail(&processed, &fsi->btrees_list);
+
+	mutex_unlock(&fsi->btrees_lock);
+
+	sc->nr_scanned = scanned;
+
+	ssdfs_account_reclaim(fsi, SSDFS_RECLAIM_BTREE_NODES,
+			      scanned, freed, scanned - freed);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("scanned %lu, freed %lu\n",
+		  scanned, freed);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return freed;
+}
+
+/*
+ * ssdfs_btree_nodes_cache_create() - create btree nodes cache
+ * @fsi: pointer on shared file system object
+ *
+ * This method initializes the list of btrees and registers
+ * the shrinker of clean btree leaf nodes.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+int ssdfs_btree_nodes_cache_create(struct ssdfs_fs_info *fsi)
+{
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi);
+
+	SSDFS_DBG("fsi %p\n", fsi);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	mutex_init(&fsi->btrees_lock);
+	INIT_LIST_HEAD(&fsi->btrees_list);
+	atomic64_set(&fsi->btree_nodes_count, 0);
+
+	fsi->btree_nodes_shrinker.count_objects = ssdfs_btree_nodes_count;
+	fsi->btree_nodes_shrinker.scan_objects = ssdfs_btree_nodes_scan;
+	fsi->btree_nodes_shrinker.seeks = DEFAULT_SEEKS;
+
+	err = register_shrinker(&fsi->btree_nodes_shrinker,
+				"ssdfs-btree:%s", fsi->sb->s_id);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to register btree nodes shrinker: "
+			  "err %d\n", err);
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_btree_nodes_cache_destroy() - destroy btree nodes cache
+ * @fsi: pointer on shared file system object
+ */
+void ssdfs_btree_nodes_cache_destroy(struct ssdfs_fs_info *fsi)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi);
+
+	SSDFS_DBG("fsi %p\n", fsi);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	unregister_shrinker(&fsi->btree_nodes_shrinker);
+}
+
 static
 int __ssdfs_btree_find_item(struct ssdfs_btree *tree,
 			    struct ssdfs_btree_search *search);
@@ -343,6 +638,8 @@ int ssdfs_btree_create(struct ssdfs_fs_info *fsi,
 
 	init_rwsem(&tree->lock);
 	spin_lock_init(&tree->nodes_lock);
+	atomic_set(&tree->prefetch_count, 0);
+	init_waitqueue_head(&tree->prefetch_wq);
 	tree->upper_node_id = SSDFS_BTREE_ROOT_NODE_ID;
 	INIT_RADIX_TREE(&tree->nodes, GFP_ATOMIC);
 
@@ -389,6 +686,10 @@ finish_root_node_creation:
 
 	atomic_set(&tree->state, SSDFS_BTREE_CREATED);
 
+	mutex_lock(&fsi->btrees_lock);
+	list_add_tail(&tree->list, &fsi->btrees_list);
+	mutex_unlock(&fsi->btrees_lock);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("finished\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
@@ -421,6 +722,22 @@ void ssdfs_btree_destroy(struct ssdfs_btree *tree)
 		  tree, tree->type, tree_state);
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	switch (tree_state) {
+	case SSDFS_BTREE_CREATED:
+	case SSDFS_BTREE_DIRTY:
+		mutex_lock(&tree->fsi->btrees_lock);
+		list_del_init(&tree->list);
+		mutex_unlock(&tree->fsi->btrees_lock);
+
+		wait_event(tree->prefetch_wq,
+			   atomic_read(&tree->prefetch_count) == 0);
+		break;
+
+	default:
+		/* tree is not in the list */
+		break;
+	}
+
 	switch (tree_state) {
 	case SSDFS_BTREE_CREATED:
 		/* expected state */
@@ -464,6 +781,8 @@ void ssdfs_btree_destroy(struct ssdfs_btree *tree)
 				   "index %llu\n",
 				   (u64)iter.index);
 		} else {
+			atomic64_dec(&tree->fsi->btree_nodes_count);
+
 			if (tree->btree_ops && tree->btree_ops->destroy_node)
 				tree->btree_ops->destroy_node(node);
 
@@ -1004,7 +1323,7 @@ int ssdfs_btree_flush(struct ssdfs_btree *tree)
 		return -ERANGE;
 	}
 
-	down_write(&tree->lock);
+	SSDFS_DOWN_WRITE(btree, &tree->lock);
 	err = ssdfs_btree_flush_nolock(tree);
 	up_write(&tree->lock);
 
@@ -1066,7 +1385,7 @@ int ssdfs_btree_destroy_node_range(struct ssdfs_btree *tree,
 		return -ERANGE;
 	}
 
-	down_write(&tree->lock);
+	SSDFS_DOWN_WRITE(btree, &tree->lock);
 
 	rcu_read_lock();
 
@@ -1743,6 +2062,9 @@ try_find_node:
 
 		radix_tree_preload_end();
 
+		if (!err)
+			atomic64_inc(&tree->fsi->btree_nodes_count);
+
 		if (err == -EEXIST)
 			goto try_find_node;
 		else if (unlikely(err)) {
@@ -1938,7 +2260,7 @@ ssdfs_btree_get_child_node_for_hash(struct ssdfs_btree *tree,
 		return ERR_PTR(err);
 	}
 
-	down_read(&parent->full_lock);
+	SSDFS_DOWN_READ(btree_node, &parent->full_lock);
 
 	parent_type = atomic_read(&parent->type);
 	if (parent_type <= SSDFS_BTREE_NODE_UNKNOWN_TYPE ||
@@ -2369,7 +2691,7 @@ int ssdfs_btree_update_parent_node_pointer(struct ssdfs_btree *tree,
 		return 0;
 	}
 
-	down_read(&parent->full_lock);
+	SSDFS_DOWN_READ(btree_node, &parent->full_lock);
 
 	down_read(&parent->header_lock);
 	ssdfs_memcpy(&area,
@@ -2430,7 +2752,7 @@ int ssdfs_btree_update_parent_node_pointer(struct ssdfs_btree *tree,
 			lock = NULL;
 		}
 
-		down_read(&parent->full_lock);
+		SSDFS_DOWN_READ(btree_node, &parent->full_lock);
 
 		if (err == -ENOENT) {
 			err = 0;
@@ -2711,7 +3033,7 @@ int __ssdfs_btree_add_node(struct ssdfs_btree *tree,
 		return err;
 	}
 
-	down_write(&tree->lock);
+	SSDFS_DOWN_WRITE(btree, &tree->lock);
 
 	err = ssdfs_check_leaf_node_absence(tree, search);
 	if (err == -EEXIST) {
@@ -2977,7 +3299,7 @@ int ssdfs_btree_find_right_sibling_leaf_node(struct ssdfs_btree *tree,
 
 	node_type = atomic_read(&node->type);
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	if (node_type == SSDFS_BTREE_ROOT_NODE) {
 		err = __ssdfs_btree_root_node_extract_index(node,
@@ -3233,6 +3555,64 @@ unable_find_leaf_node:
 	return -ENOENT;
 }
 
+/*
+ * ssdfs_btree_node_get_index_hash_range() - get hash range of index area
+ * @node: node object
+ * @start_hash: starting hash of index area [out]
+ * @end_hash: ending hash of index area [out]
+ *
+ * This method tries to read the hash range without the header lock.
+ * The header lock is taken only if the header has been modified
+ * during the read.
+ */
+static inline
+void ssdfs_btree_node_get_index_hash_range(struct ssdfs_btree_node *node,
+					   u64 *start_hash, u64 *end_hash)
+{
+	u32 version;
+
+	version = ssdfs_btree_node_header_read_begin(node);
+	*start_hash = READ_ONCE(node->index_area.start_hash);
+	*end_hash = READ_ONCE(node->index_area.end_hash);
+
+	if (!ssdfs_btree_node_header_read_retry(node, version))
+		return;
+
+	down_read(&node->header_lock);
+	*start_hash = node->index_area.start_hash;
+	*end_hash = node->index_area.end_hash;
+	up_read(&node->header_lock);
+}
+
+/*
+ * ssdfs_btree_node_get_items_hash_range() - get hash range of items area
+ * @node: node object
+ * @start_hash: starting hash of items area [out]
+ * @end_hash: ending hash of items area [out]
+ *
+ * This method tries to read the hash range without the header lock.
+ * The header lock is taken only if the header has been modified
+ * during the read.
+ */
+static inline
+void ssdfs_btree_node_get_items_hash_range(struct ssdfs_btree_node *node,
+					   u64 *start_hash, u64 *end_hash)
+{
+	u32 version;
+
+	version = ssdfs_btree_node_header_read_begin(node);
+	*start_hash = READ_ONCE(node->items_area.start_hash);
+	*end_hash = READ_ONCE(node->items_area.end_hash);
+
+	if (!ssdfs_btree_node_header_read_retry(node, version))
+		return;
+
+	down_read(&node->header_lock);
+	*start_hash = node->items_area.start_hash;
+	*end_hash = node->items_area.end_hash;
+	up_read(&node->header_lock);
+}
+
 /*
  * ssdfs_btree_find_leaf_node() - find a leaf node in the tree
  * @tree: btree object
@@ -3366,10 +3746,8 @@ int ssdfs_btree_find_leaf_node(struct ssdfs_btree *tree,
 			goto check_found_node;
 		}
 
-		down_read(&node->header_lock);
-		start_hash = node->index_area.start_hash;
-		end_hash = node->index_area.end_hash;
-		up_read(&node->header_lock);
+		ssdfs_btree_node_get_index_hash_range(node, &start_hash,
+						      &end_hash);
 
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("node_id %u, start_hash %llx, "
@@ -3404,12 +3782,11 @@ int ssdfs_btree_find_leaf_node(struct ssdfs_btree *tree,
 				goto finish_search_leaf_node;
 			}
 
-			down_read(&node->header_lock);
-			start_hash = node->items_area.start_hash;
-			end_hash = node->items_area.end_hash;
+			ssdfs_btree_node_get_items_hash_range(node,
+							      &start_hash,
+							      &end_hash);
 			is_found = start_hash <= search->request.start.hash &&
 				   search->request.start.hash <= end_hash;
-			up_read(&node->header_lock);
 
 #ifdef CONFIG_SSDFS_DEBUG
 			SSDFS_DBG("node_id %u, start_hash %llx, "
@@ -3610,7 +3987,7 @@ int ssdfs_btree_add_node(struct ssdfs_btree *tree,
 		return err;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 	err = ssdfs_btree_find_leaf_node(tree, search);
 	up_read(&tree->lock);
 
@@ -4065,7 +4442,7 @@ int ssdfs_btree_delete_node(struct ssdfs_btree *tree,
 		return -EBUSY;
 	}
 
-	down_write(&tree->lock);
+	SSDFS_DOWN_WRITE(btree, &tree->lock);
 	err = ssdfs_btree_delete_index_in_parent_node(tree, search);
 	up_write(&tree->lock);
 
@@ -4614,10 +4991,12 @@ finish_search_item:
 int ssdfs_btree_find_item(struct ssdfs_btree *tree,
 			  struct ssdfs_btree_search *search)
 {
+	ktime_t start;
 	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!tree || !search);
+	BUG_ON(tree->type >= SSDFS_BTREE_TYPE_MAX);
 
 	SSDFS_DBG("tree %p, type %#x, "
 		  "request->type %#x, request->flags %#x, "
@@ -4628,10 +5007,15 @@ int ssdfs_btree_find_item(struct ssdfs_btree *tree,
 		  search->request.end.hash);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&tree->lock);
+	start = ktime_get();
+
+	SSDFS_DOWN_READ(btree, &tree->lock);
 	err = __ssdfs_btree_find_item(tree, search);
 	up_read(&tree->lock);
 
+	ssdfs_account_lookup(tree->fsi, SSDFS_LOOKUP_BTREE_BASE + tree->type,
+			     start, err);
+
 	return err;
 }
 
@@ -4873,7 +5257,7 @@ int ssdfs_btree_find_range(struct ssdfs_btree *tree,
 		  search->request.end.hash);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 	err = __ssdfs_btree_find_range(tree, search);
 	up_read(&tree->lock);
 
@@ -4951,7 +5335,7 @@ int ssdfs_btree_allocate_item(struct ssdfs_btree *tree,
 		return -EINVAL;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 try_next_search:
 	err = ssdfs_btree_find_leaf_node(tree, search);
@@ -4969,7 +5353,7 @@ try_next_search:
 
 		up_read(&tree->lock);
 		err = ssdfs_btree_insert_node(tree, search);
-		down_read(&tree->lock);
+		SSDFS_DOWN_READ(btree, &tree->lock);
 
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to insert node: err %d\n",
@@ -5111,7 +5495,7 @@ int ssdfs_btree_allocate_range(struct ssdfs_btree *tree,
 		return -EINVAL;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 try_next_search:
 	err = ssdfs_btree_find_leaf_node(tree, search);
@@ -5129,7 +5513,7 @@ try_next_search:
 
 		up_read(&tree->lock);
 		err = ssdfs_btree_insert_node(tree, search);
-		down_read(&tree->lock);
+		SSDFS_DOWN_READ(btree, &tree->lock);
 
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to insert node: err %d\n",
@@ -5350,7 +5734,7 @@ int ssdfs_btree_add_item(struct ssdfs_btree *tree,
 		return -EINVAL;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 try_find_item:
 	err = __ssdfs_btree_find_item(tree, search);
@@ -5393,7 +5777,7 @@ try_find_item:
 	if (search->result.state == SSDFS_BTREE_SEARCH_PLEASE_ADD_NODE) {
 		up_read(&tree->lock);
 		err = ssdfs_btree_insert_node(tree, search);
-		down_read(&tree->lock);
+		SSDFS_DOWN_READ(btree, &tree->lock);
 
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to insert node: err %d\n",
@@ -5600,7 +5984,7 @@ int ssdfs_btree_add_range(struct ssdfs_btree *tree,
 		return -EINVAL;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 try_find_range:
 	err = __ssdfs_btree_find_range(tree, search);
@@ -5642,7 +6026,7 @@ try_find_range:
 	if (search->result.state == SSDFS_BTREE_SEARCH_PLEASE_ADD_NODE) {
 		up_read(&tree->lock);
 		err = ssdfs_btree_insert_node(tree, search);
-		down_read(&tree->lock);
+		SSDFS_DOWN_READ(btree, &tree->lock);
 
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to insert node: err %d\n",
@@ -5780,34 +6164,348 @@ finish_add_range:
 }
 
 /*
- * ssdfs_btree_change_item() - change an existing item in the btree
+ * is_ssdfs_btree_batch_item_in_place() - check item's place for the batch
  * @tree: btree object
- * @search: search object [in|out]
+ * @search: search object of the batch's first item
+ * @check: search object for the check
+ * @item: pointer on the checked item
+ * @prepare: batch preparation method
  *
- * This method tries to change the existing item in the tree.
+ * This method checks that the item should be inserted into
+ * the same node and the same position as the batch's first item.
+ * It means that no other item of the tree lies between them.
+ *
+ * RETURN:
+ * [true]   - item can be inserted as part of the batch.
+ * [false]  - item cannot be inserted as part of the batch.
+ * [negative] - error code.
+ */
+static
+int is_ssdfs_btree_batch_item_in_place(struct ssdfs_btree *tree,
+					struct ssdfs_btree_search *search,
+					struct ssdfs_btree_search *check,
+					void *item,
+					ssdfs_btree_batch_prepare_fn prepare)
+{
+	int err;
+
+	ssdfs_btree_search_init(check);
+
+	err = prepare(check, item, 1);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to prepare search request: err %d\n",
+			  err);
+		return err;
+	}
+
+	check->request.type = SSDFS_BTREE_SEARCH_FIND_ITEM;
+
+	err = ssdfs_btree_find_item(tree, check);
+	if (!err) {
+		SSDFS_ERR("item exists in the tree: hash %llx\n",
+			  check->request.start.hash);
+		return -EEXIST;
+	} else if (err != -ENODATA) {
+		SSDFS_ERR("fail to find item: hash %llx, err %d\n",
+			  check->request.start.hash, err);
+		return err;
+	}
+
+	if (check->node.child != search->node.child)
+		return false;
+
+	if (check->result.state != search->result.state)
+		return false;
+
+	return check->result.start_index == search->result.start_index;
+}
+
+/*
+ * ssdfs_btree_define_batch_chunk() - define chunk of batch for insertion
+ * @tree: btree object
+ * @search: search object [out]
+ * @check: search object for checks
+ * @items: pointer on the first item of the chunk
+ * @chunk: number of items in the chunk [in|out]
+ * @prepare: batch preparation method
+ *
+ * This method finds the leaf node for the chunk's first item
+ * and defines how many items can be inserted into the same
+ * position of this node without exceeding the fill factor.
  *
  * RETURN:
  * [success]
  * [failure] - error code:
  *
- * %-EINVAL     - invalid input.
  * %-ERANGE     - internal error.
+ * %-EEXIST     - item exists in the tree.
  */
-int ssdfs_btree_change_item(struct ssdfs_btree *tree,
-			    struct ssdfs_btree_search *search)
+static
+int ssdfs_btree_define_batch_chunk(struct ssdfs_btree *tree,
+				   struct ssdfs_btree_search *search,
+				   struct ssdfs_btree_search *check,
+				   u8 *items, u16 *chunk,
+				   ssdfs_btree_batch_prepare_fn prepare)
 {
-	struct ssdfs_btree_hierarchy *hierarchy = NULL;
-	int tree_state;
-	int tree_height;
-	int err = 0;
-
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!tree || !search);
-#endif /* CONFIG_SSDFS_DEBUG */
+	struct ssdfs_btree_node *node;
+	size_t item_size = tree->item_size;
+	u16 items_count, items_capacity;
+	u16 limit;
+	u16 lower, upper, cur;
+	int res;
+	int err;
 
-	tree_state = atomic_read(&tree->state);
+	ssdfs_btree_search_init(search);
 
-#ifdef CONFIG_SSDFS_TRACK_API_CALL
+	err = prepare(search, items, 1);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to prepare search request: err %d\n",
+			  err);
+		return err;
+	}
+
+	search->request.type = SSDFS_BTREE_SEARCH_FIND_ITEM;
+
+	err = ssdfs_btree_find_item(tree, search);
+	if (!err) {
+		SSDFS_ERR("item exists in the tree: hash %llx\n",
+			  search->request.start.hash);
+		return -EEXIST;
+	} else if (err != -ENODATA) {
+		SSDFS_ERR("fail to find item: hash %llx, err %d\n",
+			  search->request.start.hash, err);
+		return err;
+	}
+
+	switch (search->result.state) {
+	case SSDFS_BTREE_SEARCH_POSSIBLE_PLACE_FOUND:
+	case SSDFS_BTREE_SEARCH_OUT_OF_RANGE:
+		/* expected state */
+		break;
+
+	case SSDFS_BTREE_SEARCH_PLEASE_ADD_NODE:
+		/* insert one item and let the tree add the node */
+		*chunk = 1;
+		return 0;
+
+	default:
+		SSDFS_ERR("invalid search result's state %#x\n",
+			  search->result.state);
+		return -ERANGE;
+	}
+
+	node = search->node.child;
+	if (!node || atomic_read(&node->type) != SSDFS_BTREE_LEAF_NODE) {
+		*chunk = 1;
+		return 0;
+	}
+
+	down_read(&node->header_lock);
+	items_count = node->items_area.items_count;
+	items_capacity = node->items_area.items_capacity;
+	up_read(&node->header_lock);
+
+	limit = (u16)(((u32)items_capacity *
+			SSDFS_BTREE_BATCH_FILL_FACTOR) / 100);
+	if (items_count >= limit) {
+		/* node is filled already */
+		*chunk = 1;
+		return 0;
+	}
+
+	*chunk = min_t(u16, *chunk, limit - items_count);
+	if (*chunk <= 1)
+		return 0;
+
+	res = is_ssdfs_btree_batch_item_in_place(tree, search, check,
+					items + ((*chunk - 1) * item_size),
+					prepare);
+	if (res < 0)
+		return res;
+	else if (res)
+		return 0;
+
+	/*
+	 * Find the longest chunk that can be inserted
+	 * into the same position of the node.
+	 */
+	lower = 1;
+	upper = *chunk - 1;
+	while (lower < upper) {
+		cur = lower + ((upper - lower + 1) / 2);
+
+		res = is_ssdfs_btree_batch_item_in_place(tree, search, check,
+						items + ((cur - 1) * item_size),
+						prepare);
+		if (res < 0)
+			return res;
+		else if (res)
+			lower = cur;
+		else
+			upper = cur - 1;
+	}
+
+	*chunk = lower;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("node_id %u, items_count %u, "
+		  "items_capacity %u, chunk %u\n",
+		  node->node_id, items_count,
+		  items_capacity, *chunk);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return 0;
+}
+
+/*
+ * ssdfs_btree_add_batch() - add batch of sorted items into btree
+ * @tree: btree object
+ * @items: array of items sorted by hash
+ * @count: number of items in the array
+ * @prepare: method of search request preparation for items range
+ *
+ * This method tries to add the batch of sorted items into the tree.
+ * The batch is split into chunks. Every chunk fills the leaf node
+ * up to the fill factor and it is inserted by one operation.
+ * As a result, the tree's hierarchy is updated once per chunk
+ * instead of once per item. The @prepare method has to define
+ * the search request (flags, hash range, count) for a range
+ * of items.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ERANGE     - internal error.
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EEXIST     - item exists in the tree.
+ */
+int ssdfs_btree_add_batch(struct ssdfs_btree *tree,
+			  void *items, u32 count,
+			  ssdfs_btree_batch_prepare_fn prepare)
+{
+	struct ssdfs_btree_search *search = NULL;
+	struct ssdfs_btree_search *check = NULL;
+	size_t item_size;
+	u32 processed = 0;
+	u16 chunk;
+	u8 *ptr;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !items || !prepare);
+
+	SSDFS_DBG("tree %p, type %#x, count %u\n",
+		  tree, tree->type, count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (count == 0)
+		return 0;
+
+	item_size = tree->item_size;
+	if (item_size == 0) {
+		SSDFS_ERR("invalid item size\n");
+		return -EINVAL;
+	}
+
+	search = ssdfs_btree_search_alloc();
+	check = ssdfs_btree_search_alloc();
+	if (!search || !check) {
+		err = -ENOMEM;
+		SSDFS_ERR("fail to allocate btree search object\n");
+		goto finish_add_batch;
+	}
+
+	ssdfs_btree_search_init(search);
+	ssdfs_btree_search_init(check);
+
+	while (processed < count) {
+		ptr = (u8 *)items + (processed * item_size);
+		chunk = (u16)min_t(u32, count - processed, U16_MAX);
+
+		err = ssdfs_btree_define_batch_chunk(tree, search, check,
+						     ptr, &chunk, prepare);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to define chunk: "
+				  "processed %u, err %d\n",
+				  processed, err);
+			goto finish_add_batch;
+		}
+
+		err = prepare(search, ptr, chunk);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to prepare search request: "
+				  "err %d\n", err);
+			goto finish_add_batch;
+		}
+
+		ssdfs_btree_search_free_result_buf(search);
+
+		err = ssdfs_btree_search_alloc_result_buf(search,
+							  chunk * item_size);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to allocate memory for buffer\n");
+			goto finish_add_batch;
+		}
+
+		ssdfs_memcpy(search->result.buf, 0, search->result.buf_size,
+			     ptr, 0, chunk * item_size,
+			     chunk * item_size);
+		search->result.items_in_buffer = chunk;
+		search->request.type = SSDFS_BTREE_SEARCH_ADD_RANGE;
+
+		err = ssdfs_btree_add_range(tree, search);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to add the range into tree: "
+				  "start_hash %llx, end_hash %llx, err %d\n",
+				  search->request.start.hash,
+				  search->request.end.hash,
+				  err);
+			goto finish_add_batch;
+		}
+
+		processed += chunk;
+	}
+
+finish_add_batch:
+	if (check)
+		ssdfs_btree_search_free(check);
+	if (search)
+		ssdfs_btree_search_free(search);
+
+	return err;
+}
+
+/*
+ * ssdfs_btree_change_item() - change an existing item in the btree
+ * @tree: btree object
+ * @search: search object [in|out]
+ *
+ * This method tries to change the existing item in the tree.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_btree_change_item(struct ssdfs_btree *tree,
+			    struct ssdfs_btree_search *search)
+{
+	struct ssdfs_btree_hierarchy *hierarchy = NULL;
+	int tree_state;
+	int tree_height;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !search);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	tree_state = atomic_read(&tree->state);
+
+#ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("tree %p, type %#x, state %#x, "
 		  "request->type %#x, request->flags %#x, "
 		  "start_hash %llx, end_hash %llx\n",
@@ -5865,7 +6563,7 @@ int ssdfs_btree_change_item(struct ssdfs_btree *tree,
 		return -ERANGE;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 try_next_search:
 	err = ssdfs_btree_find_leaf_node(tree, search);
@@ -6040,7 +6738,7 @@ int ssdfs_btree_delete_item(struct ssdfs_btree *tree,
 		return -EINVAL;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 	err = __ssdfs_btree_find_item(tree, search);
 	if (unlikely(err)) {
@@ -6080,7 +6778,7 @@ try_delete_item:
 	if (search->result.state == SSDFS_BTREE_SEARCH_PLEASE_DELETE_NODE) {
 		up_read(&tree->lock);
 		err = ssdfs_btree_delete_node(tree, search);
-		down_read(&tree->lock);
+		SSDFS_DOWN_READ(btree, &tree->lock);
 
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to delete btree node: "
@@ -6221,7 +6919,7 @@ int ssdfs_btree_delete_range(struct ssdfs_btree *tree,
 		return -EINVAL;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 try_delete_next_range:
 	err = __ssdfs_btree_find_range(tree, search);
@@ -6271,7 +6969,7 @@ finish_delete_range:
 	if (search->result.state == SSDFS_BTREE_SEARCH_PLEASE_DELETE_NODE) {
 		up_read(&tree->lock);
 		err = ssdfs_btree_delete_node(tree, search);
-		down_read(&tree->lock);
+		SSDFS_DOWN_READ(btree, &tree->lock);
 
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to delete btree node: "
@@ -6446,7 +7144,7 @@ int ssdfs_btree_get_head_range(struct ssdfs_btree *tree,
 		return -ERANGE;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 	err = ssdfs_btree_radix_tree_find(tree,
 					  SSDFS_BTREE_ROOT_NODE_ID,
@@ -6470,7 +7168,7 @@ int ssdfs_btree_get_head_range(struct ssdfs_btree *tree,
 	if (is_ssdfs_btree_node_index_area_empty(node))
 		goto finish_get_range;
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_root_node_extract_index(node,
 						SSDFS_ROOT_NODE_LEFT_LEAF_NODE,
 						&key);
@@ -6593,7 +7291,7 @@ int ssdfs_btree_extract_range(struct ssdfs_btree *tree,
 		return -ERANGE;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 	err = ssdfs_btree_node_extract_range(start_index, count,
 					     search);
@@ -6649,7 +7347,7 @@ bool is_ssdfs_btree_empty(struct ssdfs_btree *tree)
 		return false;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 	err = ssdfs_btree_radix_tree_find(tree,
 					  SSDFS_BTREE_ROOT_NODE_ID,
@@ -6677,7 +7375,7 @@ bool is_ssdfs_btree_empty(struct ssdfs_btree *tree)
 	if (is_ssdfs_btree_node_index_area_empty(node))
 		goto finish_check_tree;
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_root_node_extract_index(node,
 						SSDFS_ROOT_NODE_LEFT_LEAF_NODE,
 						&key1);
@@ -6695,7 +7393,7 @@ bool is_ssdfs_btree_empty(struct ssdfs_btree *tree)
 		goto finish_check_tree;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_root_node_extract_index(node,
 						SSDFS_ROOT_NODE_RIGHT_LEAF_NODE,
 						&key2);
@@ -6814,7 +7512,7 @@ bool need_migrate_generic2inline_btree(struct ssdfs_btree *tree,
 		return false;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 	err = ssdfs_btree_radix_tree_find(tree,
 					  SSDFS_BTREE_ROOT_NODE_ID,
@@ -6841,7 +7539,7 @@ bool need_migrate_generic2inline_btree(struct ssdfs_btree *tree,
 		goto finish_check_tree;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_root_node_extract_index(node,
 						SSDFS_ROOT_NODE_LEFT_LEAF_NODE,
 						&key1);
@@ -6859,7 +7557,7 @@ bool need_migrate_generic2inline_btree(struct ssdfs_btree *tree,
 		goto finish_check_tree;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_root_node_extract_index(node,
 						SSDFS_ROOT_NODE_RIGHT_LEAF_NODE,
 						&key2);
@@ -6997,7 +7695,7 @@ int ssdfs_btree_synchronize_root_node(struct ssdfs_btree *tree,
 		return -ERANGE;
 	}
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 	err = ssdfs_btree_radix_tree_find(tree,
 					  SSDFS_BTREE_ROOT_NODE_ID,
@@ -7040,6 +7738,319 @@ finish_synchronize_root:
 	return err;
 }
 
+/*
+ * struct ssdfs_btree_prefetch_request - sibling nodes' prefetch request
+ * @work: work item
+ * @tree: btree object
+ * @parent: parent node of prefetched nodes
+ * @parent_version: parent's header version at the moment of request
+ * @descend: prefetch the first leaf nodes of the read index nodes
+ * @count: number of nodes for prefetch
+ * @keys: index keys of prefetched nodes
+ */
+struct ssdfs_btree_prefetch_request {
+	struct work_struct work;
+	struct ssdfs_btree *tree;
+	struct ssdfs_btree_node *parent;
+	u32 parent_version;
+	bool descend;
+	u16 count;
+	struct ssdfs_btree_index_key keys[SSDFS_BTREE_PREFETCH_NODES_MAX];
+};
+
+static
+void __ssdfs_btree_prefetch_nodes(struct ssdfs_btree *tree,
+				  struct ssdfs_btree_node *parent,
+				  struct ssdfs_btree_node_index_area *area,
+				  u16 start_pos, bool leaves_only);
+
+/*
+ * ssdfs_btree_prefetch_first_leaves() - prefetch first leaves of the node
+ * @tree: btree object
+ * @node: index or hybrid node
+ */
+static
+void ssdfs_btree_prefetch_first_leaves(struct ssdfs_btree *tree,
+					struct ssdfs_btree_node *node)
+{
+	struct ssdfs_btree_node_index_area area;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !node);
+	BUG_ON(!rwsem_is_locked(&tree->lock));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (atomic_read(&node->state) != SSDFS_BTREE_NODE_INITIALIZED)
+		return;
+
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
+
+	down_read(&node->header_lock);
+	ssdfs_memcpy(&area,
+		     0, sizeof(struct ssdfs_btree_node_index_area),
+		     &node->index_area,
+		     0, sizeof(struct ssdfs_btree_node_index_area),
+		     sizeof(struct ssdfs_btree_node_index_area));
+	up_read(&node->header_lock);
+
+	__ssdfs_btree_prefetch_nodes(tree, node, &area, 0, true);
+
+	up_read(&node->full_lock);
+}
+
+/*
+ * ssdfs_btree_prefetch_func() - read sibling nodes in the background
+ * @work: work item
+ *
+ * This method reads the requested nodes from the volume and
+ * adds the nodes into the tree. The request is ignored if
+ * the parent node has been modified since the moment of
+ * the request because the index keys could be stale.
+ */
+static
+void ssdfs_btree_prefetch_func(struct work_struct *work)
+{
+	struct ssdfs_btree_prefetch_request *req;
+	struct ssdfs_btree *tree;
+	struct ssdfs_btree_node *parent;
+	struct ssdfs_btree_node *node;
+	u32 node_id;
+	int i;
+
+	req = container_of(work, struct ssdfs_btree_prefetch_request, work);
+	tree = req->tree;
+	parent = req->parent;
+
+	SSDFS_DOWN_READ(btree, &tree->lock);
+
+	switch (atomic_read(&tree->state)) {
+	case SSDFS_BTREE_CREATED:
+	case SSDFS_BTREE_DIRTY:
+		/* expected state */
+		break;
+
+	default:
+		goto finish_prefetch;
+	}
+
+	for (i = 0; i < req->count; i++) {
+		if (ssdfs_btree_node_header_read_retry(parent,
+							req->parent_version))
+			break;
+
+		node_id = le32_to_cpu(req->keys[i].node_id);
+
+		spin_lock(&tree->nodes_lock);
+		node = radix_tree_lookup(&tree->nodes, node_id);
+		spin_unlock(&tree->nodes_lock);
+
+		if (node)
+			continue;
+
+		node = __ssdfs_btree_read_node(tree, parent, &req->keys[i],
+						req->keys[i].node_type,
+						node_id);
+		if (IS_ERR_OR_NULL(node)) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("fail to prefetch node: "
+				  "node_id %u, err %ld\n",
+				  node_id, PTR_ERR(node));
+#endif /* CONFIG_SSDFS_DEBUG */
+			break;
+		}
+
+		if (req->descend &&
+		    req->keys[i].node_type != SSDFS_BTREE_LEAF_NODE)
+			ssdfs_btree_prefetch_first_leaves(tree, node);
+	}
+
+finish_prefetch:
+	up_read(&tree->lock);
+
+	ssdfs_btree_node_put(parent);
+	ssdfs_btree_kfree(req);
+
+	if (atomic_dec_and_test(&tree->prefetch_count))
+		wake_up_all(&tree->prefetch_wq);
+}
+
+/*
+ * __ssdfs_btree_prefetch_nodes() - prefetch child nodes of the parent
+ * @tree: btree object
+ * @parent: parent node
+ * @area: index area of the parent node
+ * @start_pos: position of the first index for prefetch
+ * @leaves_only: stop on the first child that is not leaf node
+ *
+ * This method issues the background read of the child nodes
+ * of @parent starting from @start_pos. If the index nodes are
+ * prefetched (@leaves_only is false), then the first leaf nodes
+ * of every read index node are prefetched too.
+ */
+static
+void __ssdfs_btree_prefetch_nodes(struct ssdfs_btree *tree,
+				  struct ssdfs_btree_node *parent,
+				  struct ssdfs_btree_node_index_area *area,
+				  u16 start_pos, bool leaves_only)
+{
+	struct ssdfs_btree_prefetch_request *req;
+	struct ssdfs_btree_index_key *key;
+	struct ssdfs_btree_node *node;
+	int type;
+	u32 version;
+	u16 pos;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !parent || !area);
+	BUG_ON(!rwsem_is_locked(&tree->lock));
+	BUG_ON(!rwsem_is_locked(&parent->full_lock));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (start_pos >= area->index_count)
+		return;
+
+	version = ssdfs_btree_node_header_read_begin(parent);
+	if (version & 1)
+		return;
+
+	req = ssdfs_btree_kzalloc(sizeof(*req), GFP_NOFS | __GFP_NOWARN);
+	if (!req)
+		return;
+
+	type = atomic_read(&parent->type);
+
+	for (pos = start_pos; pos < area->index_count; pos++) {
+		if (req->count >= SSDFS_BTREE_PREFETCH_NODES_MAX)
+			break;
+
+		key = &req->keys[req->count];
+
+		if (type == SSDFS_BTREE_ROOT_NODE) {
+			err = __ssdfs_btree_root_node_extract_index(parent,
+								    pos, key);
+		} else {
+			err = __ssdfs_btree_common_node_extract_index(parent,
+								      area,
+								      pos,
+								      key);
+		}
+
+		if (unlikely(err))
+			break;
+
+		if (leaves_only && key->node_type != SSDFS_BTREE_LEAF_NODE)
+			break;
+
+		spin_lock(&tree->nodes_lock);
+		node = radix_tree_lookup(&tree->nodes,
+					 le32_to_cpu(key->node_id));
+		spin_unlock(&tree->nodes_lock);
+
+		if (!node)
+			req->count++;
+	}
+
+	if (req->count == 0) {
+		ssdfs_btree_kfree(req);
+		return;
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("parent %u, start_pos %u, count %u\n",
+		  parent->node_id, start_pos, req->count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	INIT_WORK(&req->work, ssdfs_btree_prefetch_func);
+	req->tree = tree;
+	req->parent = parent;
+	req->parent_version = version;
+	req->descend = !leaves_only;
+
+	ssdfs_btree_node_get(parent);
+	atomic_inc(&tree->prefetch_count);
+	queue_work(system_unbound_wq, &req->work);
+}
+
+/*
+ * ssdfs_btree_prefetch_siblings() - prefetch sibling leaf nodes
+ * @tree: btree object
+ * @parent: parent node
+ * @area: index area of the parent node
+ * @start_pos: position of the first index for prefetch
+ *
+ * This method issues the background read of the leaf nodes
+ * that follow the current one. As a result, a sequential scan
+ * of the leaf nodes finds the next nodes in memory (or under
+ * read) instead of reading every node synchronously.
+ */
+static inline
+void ssdfs_btree_prefetch_siblings(struct ssdfs_btree *tree,
+				   struct ssdfs_btree_node *parent,
+				   struct ssdfs_btree_node_index_area *area,
+				   u16 start_pos)
+{
+	__ssdfs_btree_prefetch_nodes(tree, parent, area, start_pos, true);
+}
+
+/*
+ * ssdfs_btree_prefetch_upper_levels() - prefetch children of root node
+ * @tree: btree object
+ *
+ * This method issues the background read of the nodes that
+ * the root node references and of the first leaf nodes of these
+ * nodes. The first lookup or readdir of a cold tree then finds
+ * the upper levels in memory (or under read) instead of reading
+ * the path from the root node by node. The nodes existing in
+ * memory are not read again.
+ */
+void ssdfs_btree_prefetch_upper_levels(struct ssdfs_btree *tree)
+{
+	struct ssdfs_btree_node *root;
+	struct ssdfs_btree_node_index_area area;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree);
+
+	SSDFS_DBG("tree %p, type %#x\n", tree, tree->type);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	SSDFS_DOWN_READ(btree, &tree->lock);
+
+	switch (atomic_read(&tree->state)) {
+	case SSDFS_BTREE_CREATED:
+	case SSDFS_BTREE_DIRTY:
+		/* expected state */
+		break;
+
+	default:
+		goto finish_prefetch;
+	}
+
+	err = ssdfs_btree_radix_tree_find(tree, SSDFS_BTREE_ROOT_NODE_ID,
+					  &root);
+	if (err || !root)
+		goto finish_prefetch;
+
+	SSDFS_DOWN_READ(btree_node, &root->full_lock);
+
+	down_read(&root->header_lock);
+	ssdfs_memcpy(&area,
+		     0, sizeof(struct ssdfs_btree_node_index_area),
+		     &root->index_area,
+		     0, sizeof(struct ssdfs_btree_node_index_area),
+		     sizeof(struct ssdfs_btree_node_index_area));
+	up_read(&root->header_lock);
+
+	__ssdfs_btree_prefetch_nodes(tree, root, &area, 0, false);
+
+	up_read(&root->full_lock);
+
+finish_prefetch:
+	up_read(&tree->lock);
+}
+
 /*
  * ssdfs_btree_get_next_hash() - get next node's starting hash
  * @tree: btree object
@@ -7080,14 +8091,14 @@ int ssdfs_btree_get_next_hash(struct ssdfs_btree *tree,
 
 	type = atomic_read(&parent->type);
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 	do {
 		u16 found_pos;
 
 		err = -ENOENT;
 
-		down_read(&parent->full_lock);
+		SSDFS_DOWN_READ(btree_node, &parent->full_lock);
 
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("old_hash %llx\n", old_hash);
@@ -7148,6 +8159,13 @@ int ssdfs_btree_get_next_hash(struct ssdfs_btree *tree,
 								    &index_key);
 		}
 
+		if (!err && parent == search->node.parent &&
+		    index_key.node_type == SSDFS_BTREE_LEAF_NODE) {
+			/* next node will be read by the caller */
+			ssdfs_btree_prefetch_siblings(tree, parent, &area,
+						      found_pos + 1);
+		}
+
 finish_index_search:
 		up_read(&parent->full_lock);
 
@@ -7230,7 +8248,7 @@ void ssdfs_debug_show_btree_node_indexes(struct ssdfs_btree *tree,
 		return;
 	}
 
-	down_read(&parent->full_lock);
+	SSDFS_DOWN_READ(btree_node, &parent->full_lock);
 
 	down_read(&parent->header_lock);
 	ssdfs_memcpy(&area,
@@ -7328,7 +8346,7 @@ void ssdfs_debug_btree_check_indexes(struct ssdfs_btree *tree,
 		return;
 	}
 
-	down_read(&parent->full_lock);
+	SSDFS_DOWN_READ(btree_node, &parent->full_lock);
 
 	down_read(&parent->header_lock);
 	ssdfs_memcpy(&area,
@@ -7472,7 +8490,7 @@ void ssdfs_debug_btree_check_indexes(struct ssdfs_btree *tree,
 continue_tree_check:
 		prev_hash = start_hash1;
 
-		down_read(&parent->full_lock);
+		SSDFS_DOWN_READ(btree_node, &parent->full_lock);
 	}
 
 finish_index_processing:
@@ -7498,7 +8516,7 @@ void ssdfs_check_btree_consistency(struct ssdfs_btree *tree)
 
 	BUG_ON(!tree);
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 	rcu_read_lock();
 	radix_tree_for_each_slot(slot1, &tree->nodes, &iter1,
@@ -7717,7 +8735,7 @@ void ssdfs_debug_btree_object(struct ssdfs_btree *tree)
 
 	BUG_ON(!tree);
 
-	down_read(&tree->lock);
+	SSDFS_DOWN_READ(btree, &tree->lock);
 
 	SSDFS_DBG("STATIC DATA: "
 		  "type %#x, owner_ino %llu, node_size %u, "
@@ -24,6 +24,21 @@
 
 struct ssdfs_btree;
 
+/* Maximal number of sibling leaf nodes for prefetch */
+#define SSDFS_BTREE_PREFETCH_NODES_MAX		(4)
+
+/* Target fill factor (in percents) of leaf nodes in batch insertion */
+#define SSDFS_BTREE_BATCH_FILL_FACTOR		(90)
+
+/*
+ * ssdfs_btree_batch_prepare_fn - prepare search request for items range
+ * @search: search object [out]
+ * @items: pointer on the first item of the range
+ * @count: number of items in the range
+ */
+typedef int (*ssdfs_btree_batch_prepare_fn)(struct ssdfs_btree_search *search,
+					    void *items, u16 count);
+
 /*
  * struct ssdfs_btree_descriptor_operations - btree descriptor operations
  * @init: initialize btree object by descriptor
@@ -82,6 +97,9 @@ struct ssdfs_btree_operations {
  * @nodes_lock: radix tree lock
  * @upper_node_id: last allocated node id
  * @nodes: nodes' radix tree
+ * @list: node of file system's list of btrees
+ * @prefetch_count: number of sibling nodes' prefetch requests in flight
+ * @prefetch_wq: wait queue of prefetch requests' completion
  * @fsi: pointer on shared file system object
  *
  * Btree nodes are organized by radix tree.
@@ -117,6 +135,11 @@ struct ssdfs_btree {
 	u32 upper_node_id;
 	struct radix_tree_root nodes;
 
+	struct list_head list;
+
+	atomic_t prefetch_count;
+	wait_queue_head_t prefetch_wq;
+
 	struct ssdfs_fs_info *fsi;
 };
 
@@ -141,6 +164,8 @@ int ssdfs_btree_create(struct ssdfs_fs_info *fsi,
 		    const struct ssdfs_btree_operations *btree_ops,
 		    struct ssdfs_btree *tree);
 void ssdfs_btree_destroy(struct ssdfs_btree *tree);
+int ssdfs_btree_nodes_cache_create(struct ssdfs_fs_info *fsi);
+void ssdfs_btree_nodes_cache_destroy(struct ssdfs_fs_info *fsi);
 int ssdfs_btree_flush(struct ssdfs_btree *tree);
 
 int ssdfs_btree_find_item(struct ssdfs_btree *tree,
@@ -156,6 +181,9 @@ int ssdfs_btree_add_item(struct ssdfs_btree *tree,
 			 struct ssdfs_btree_search *search);
 int ssdfs_btree_add_range(struct ssdfs_btree *tree,
 			  struct ssdfs_btree_search *search);
+int ssdfs_btree_add_batch(struct ssdfs_btree *tree,
+			  void *items, u32 count,
+			  ssdfs_btree_batch_prepare_fn prepare);
 int ssdfs_btree_change_item(struct ssdfs_btree *tree,
 			    struct ssdfs_btree_search *search);
 int ssdfs_btree_delete_item(struct ssdfs_btree *tree,
@@ -209,6 +237,7 @@ int ssdfs_btree_synchronize_root_node(struct ssdfs_btree *tree,
 int ssdfs_btree_get_next_hash(struct ssdfs_btree *tree,
 			      struct ssdfs_btree_search *search,
 			      u64 *next_hash);
+void ssdfs_btree_prefetch_upper_levels(struct ssdfs_btree *tree);
 
 void ssdfs_debug_show_btree_node_indexes(struct ssdfs_btree *tree,
 					 struct ssdfs_btree_node *parent);
@@ -1389,7 +1389,7 @@ int ssdfs_check_capability_move_to_sibling(struct ssdfs_btree_level *level)
 
 	node_type = atomic_read(&node->type);
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	if (node_type == SSDFS_BTREE_ROOT_NODE) {
 		err = __ssdfs_btree_root_node_extract_index(node,
@@ -2085,7 +2085,7 @@ ssdfs_check_capability_move_indexes_to_sibling(struct ssdfs_btree_level *level)
 
 	node_type = atomic_read(&node->type);
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	if (node_type == SSDFS_BTREE_ROOT_NODE) {
 		err = __ssdfs_btree_root_node_extract_index(node,
@@ -8089,7 +8089,7 @@ int ssdfs_btree_prepare_add_item(struct ssdfs_btree_level *parent,
 		end_hash = child->items_area.add.hash.end;
 		count = child->items_area.add.pos.count;
 
-		down_write(&node->header_lock);
+		ssdfs_btree_node_header_down_write(node);
 
 		if (node->items_area.items_count == 0) {
 			node->items_area.start_hash = start_hash;
@@ -8105,7 +8105,7 @@ int ssdfs_btree_prepare_add_item(struct ssdfs_btree_level *parent,
 				  free_space);
 		}
 
-		up_write(&node->header_lock);
+		ssdfs_btree_node_header_up_write(node);
 		break;
 
 	case SSDFS_HASH_RANGE_LEFT_ADJACENT:
@@ -8122,7 +8122,7 @@ int ssdfs_btree_prepare_add_item(struct ssdfs_btree_level *parent,
 		end_hash = child->items_area.add.hash.end;
 		count = child->items_area.add.pos.count;
 
-		down_write(&left_node->header_lock);
+		ssdfs_btree_node_header_down_write(left_node);
 
 		if (left_node->items_area.items_count == 0) {
 			left_node->items_area.start_hash = start_hash;
@@ -8140,7 +8140,7 @@ int ssdfs_btree_prepare_add_item(struct ssdfs_btree_level *parent,
 		}
 
 finish_left_adjacent_check:
-		up_write(&left_node->header_lock);
+		ssdfs_btree_node_header_up_write(left_node);
 		break;
 
 	case SSDFS_HASH_RANGE_INTERSECTION:
@@ -8155,7 +8155,7 @@ finish_left_adjacent_check:
 
 		count = child->items_area.add.pos.count;
 
-		down_write(&left_node->header_lock);
+		ssdfs_btree_node_header_down_write(left_node);
 
 		free_space = left_node->items_area.free_space;
 		min_item_size = left_node->items_area.min_item_size;
@@ -8168,7 +8168,7 @@ finish_left_adjacent_check:
 		}
 
 finish_intersection_check:
-		up_write(&left_node->header_lock);
+		ssdfs_btree_node_header_up_write(left_node);
 		break;
 
 	case SSDFS_HASH_RANGE_RIGHT_ADJACENT:
@@ -8185,7 +8185,7 @@ finish_intersection_check:
 		end_hash = child->items_area.add.hash.end;
 		count = child->items_area.add.pos.count;
 
-		down_write(&right_node->header_lock);
+		ssdfs_btree_node_header_down_write(right_node);
 
 		if (right_node->items_area.items_count == 0) {
 			right_node->items_area.start_hash = start_hash;
@@ -8203,7 +8203,7 @@ finish_intersection_check:
 		}
 
 finish_right_adjacent_check:
-		up_write(&right_node->header_lock);
+		ssdfs_btree_node_header_up_write(right_node);
 		break;
 
 	default:
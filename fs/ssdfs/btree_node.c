@@ -24,6 +24,7 @@
 #include <linux/mm.h>
 #include <linux/slab.h>
 #include <linux/pagevec.h>
+#include <linux/hash.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -548,10 +549,12 @@ ssdfs_btree_node_create(struct ssdfs_btree *tree,
 	ptr->node_ops = NULL;
 
 	atomic_set(&ptr->refs_count, 0);
+	atomic_set(&ptr->lru_referenced, 0);
 	atomic_set(&ptr->flags, 0);
 	atomic_set(&ptr->type, type);
 
 	init_rwsem(&ptr->header_lock);
+	atomic_set(&ptr->header_version, 0);
 	memset(&ptr->raw, 0xFF, sizeof(ptr->raw));
 
 	err = ssdfs_btree_node_create_empty_index_area(tree, ptr,
@@ -613,6 +616,10 @@ ssdfs_btree_node_create(struct ssdfs_btree *tree,
 	}
 
 	init_waitqueue_head(&ptr->wait_queue);
+
+	ptr->bloom.ptr = NULL;
+	ptr->bloom.bits_shift = 0;
+
 	init_rwsem(&ptr->full_lock);
 
 	atomic_set(&ptr->state, SSDFS_BTREE_NODE_CREATED);
@@ -707,7 +714,7 @@ int ssdfs_btree_create_root_node(struct ssdfs_btree_node *node,
 	atomic_set(&node->flags, hdr->flags);
 	atomic_set(&node->type, hdr->type);
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 	ssdfs_memcpy(&node->raw.root_node, 0, rnode_size,
 		     root_node, 0, rnode_size,
 		     rnode_size);
@@ -722,7 +729,7 @@ int ssdfs_btree_create_root_node(struct ssdfs_btree_node *node,
 		index2 = &root_node->indexes[SSDFS_ROOT_NODE_RIGHT_LEAF_NODE];
 		node->index_area.end_hash = le64_to_cpu(index2->hash);
 	}
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	spin_lock(&node->tree->nodes_lock);
 	node->tree->upper_node_id =
@@ -761,7 +768,7 @@ int ssdfs_btree_node_allocate_content_space(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	pagevec_init(&node->content.pvec);
 	for (i = 0; i < pages_count; i++) {
@@ -841,6 +848,132 @@ void ssdfs_btree_node_init_bmaps(struct ssdfs_btree_node *node,
 	}
 }
 
+/*
+ * ssdfs_btree_node_bloom_create() - create node's negative lookup filter
+ * @node: node object
+ * @items_capacity: maximum possible number of items in the node
+ *
+ * This method tries to allocate the bloom filter of the node.
+ * The filter is cleared if it has been allocated already.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - invalid input.
+ * %-ENOMEM     - fail to allocate memory.
+ */
+int ssdfs_btree_node_bloom_create(struct ssdfs_btree_node *node,
+				  u16 items_capacity)
+{
+	unsigned long *bmap;
+	u32 bits_count;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!node);
+
+	SSDFS_DBG("node_id %u, items_capacity %u\n",
+		  node->node_id, items_capacity);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (items_capacity == 0) {
+		SSDFS_ERR("invalid items_capacity %u\n",
+			  items_capacity);
+		return -ERANGE;
+	}
+
+	if (node->bloom.ptr) {
+		bitmap_zero(node->bloom.ptr, 1U << node->bloom.bits_shift);
+		return 0;
+	}
+
+	bits_count = (u32)items_capacity * SSDFS_BTREE_NODE_BLOOM_BITS_PER_ITEM;
+	bits_count = roundup_pow_of_two(max_t(u32, bits_count, BITS_PER_LONG));
+
+	bmap = ssdfs_btree_node_kzalloc(BITS_TO_LONGS(bits_count) *
+						sizeof(unsigned long),
+					GFP_KERNEL);
+	if (!bmap) {
+		SSDFS_ERR("fail to allocate bloom filter: "
+			  "bits_count %u\n", bits_count);
+		return -ENOMEM;
+	}
+
+	node->bloom.bits_shift = ilog2(bits_count);
+	node->bloom.ptr = bmap;
+
+	return 0;
+}
+
+/*
+ * ssdfs_btree_node_bloom_bit() - calculate bit position in the filter
+ * @node: node object
+ * @hash: item's hash
+ * @index: index of hash function
+ */
+static inline
+unsigned long ssdfs_btree_node_bloom_bit(struct ssdfs_btree_node *node,
+					 u64 hash, int index)
+{
+	u32 mask = (1U << node->bloom.bits_shift) - 1;
+	u32 h1 = hash_64(hash, 32);
+	u32 h2 = hash_64(~hash, 32) | 1;
+
+	return (h1 + (u32)index * h2) & mask;
+}
+
+/*
+ * ssdfs_btree_node_bloom_add() - add item's hash into the filter
+ * @node: node object
+ * @hash: item's hash
+ */
+void ssdfs_btree_node_bloom_add(struct ssdfs_btree_node *node, u64 hash)
+{
+	int i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!node);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!node->bloom.ptr)
+		return;
+
+	for (i = 0; i < SSDFS_BTREE_NODE_BLOOM_HASHES; i++) {
+		set_bit(ssdfs_btree_node_bloom_bit(node, hash, i),
+			node->bloom.ptr);
+	}
+}
+
+/*
+ * ssdfs_btree_node_bloom_may_contain() - check item's hash in the filter
+ * @node: node object
+ * @hash: item's hash
+ *
+ * RETURN:
+ * [false] - the node doesn't contain the item for sure.
+ * [true]  - the node could contain the item (or it has no filter).
+ */
+bool ssdfs_btree_node_bloom_may_contain(struct ssdfs_btree_node *node,
+					u64 hash)
+{
+	int i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!node);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!node->bloom.ptr)
+		return true;
+
+	for (i = 0; i < SSDFS_BTREE_NODE_BLOOM_HASHES; i++) {
+		if (!test_bit(ssdfs_btree_node_bloom_bit(node, hash, i),
+			      node->bloom.ptr))
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * ssdfs_btree_node_destroy() - destroy the btree node
  * @node: node object
@@ -907,6 +1040,10 @@ void ssdfs_btree_node_destroy(struct ssdfs_btree_node *node)
 			spin_unlock(&node->bmap_array.bmap[i].lock);
 		}
 
+		ssdfs_btree_node_kfree(node->bloom.ptr);
+		node->bloom.ptr = NULL;
+		node->bloom.bits_shift = 0;
+
 		if (rwsem_is_locked(&node->full_lock)) {
 			/* inform about possible trouble */
 			SSDFS_WARN("node is locked under destruction\n");
@@ -1258,7 +1395,7 @@ int ssdfs_btree_node_prepare_content(struct ssdfs_btree_node *node,
 	}
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 	err = __ssdfs_btree_node_prepare_content(node->tree->fsi, ptr,
 						 node->node_size,
 						 node->tree->owner_ino,
@@ -2844,7 +2981,7 @@ void ssdfs_btree_flush_root_node(struct ssdfs_btree_node *node,
 		  atomic_read(&node->type));
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	items_count = node->index_area.index_count;
 	root_node->header.height = (u8)atomic_read(&node->tree->height);
@@ -2868,7 +3005,7 @@ void ssdfs_btree_flush_root_node(struct ssdfs_btree_node *node,
 		  le64_to_cpu(root_node->indexes[1].hash));
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	spin_lock(&node->tree->nodes_lock);
 	root_node->header.upper_node_id =
@@ -3037,8 +3174,8 @@ int ssdfs_btree_node_prepare_flush_request(struct ssdfs_btree_node *node)
 		set_page_writeback(page);
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_lock_page(node->content.pvec.pages[0]);
 	ssdfs_btree_node_copy_header_nolock(node,
@@ -3129,7 +3266,7 @@ int ssdfs_btree_node_prepare_flush_request(struct ssdfs_btree_node *node)
 		clear_ssdfs_btree_node_dirty(node);
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	if (unlikely(err)) {
@@ -3562,6 +3699,14 @@ int ssdfs_btree_deleted_node_commit_log(struct ssdfs_btree_node *node)
 
 		pebc = &si->peb_array[i];
 
+		err = ssdfs_peb_container_start_flush_thread(pebc);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to start flush thread: "
+				  "seg %llu, peb_index %d, err %d\n",
+				  si->seg_id, i, err);
+			return err;
+		}
+
 		req = ssdfs_request_alloc();
 		if (IS_ERR_OR_NULL(req)) {
 			err = (req == NULL ? -ENOMEM : PTR_ERR(req));
@@ -4586,8 +4731,8 @@ int ssdfs_btree_node_resize_index_area(struct ssdfs_btree_node *node,
 		return -EOPNOTSUPP;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	index_size = node->index_area.index_size;
 	index_count = node->index_area.index_count;
@@ -4774,7 +4919,7 @@ int ssdfs_btree_node_resize_index_area(struct ssdfs_btree_node *node,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_resize_operation:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	if (err == -EOPNOTSUPP)
@@ -5219,6 +5364,7 @@ void ssdfs_btree_node_get(struct ssdfs_btree_node *node)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	WARN_ON(atomic_inc_return(&node->refs_count) <= 0);
+	atomic_set(&node->lru_referenced, 1);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("tree_type %#x, node_id %u, refs_count %d\n",
@@ -5319,296 +5465,50 @@ int ssdfs_btree_root_node_find_index(struct ssdfs_btree_node *node,
 	 page_off + (index * sizeof(struct ssdfs_btree_index_key))))
 
 /*
- * ssdfs_get_index_key_hash() - get hash from a range
+ * ssdfs_get_index_key_hash() - get hash of index record
  * @node: node object
  * @kaddr: pointer on starting address in the page
  * @page_off: offset from page's beginning in bytes
- * @index: requested starting index in the range
- * @upper_index: last index in the available range
- * @hash_index: available (not locked) index in the range [out]
- * @hash: hash value of found index [out]
+ * @index: requested index
+ * @hash: hash value of the index [out]
  *
- * This method tries to find any unlocked index in suggested
- * range.
+ * This method locks the index and reads its hash value.
  *
  * RETURN:
  * [success]
  * [failure] - error code:
  *
- * %-ENODATA    - unable to find the node's index.
+ * %-ERANGE     - internal error.
+ * %-ENODATA    - unable to lock the index.
  */
-static
+static inline
 int ssdfs_get_index_key_hash(struct ssdfs_btree_node *node,
 			     void *kaddr, u32 page_off,
-			     u32 index, u32 upper_index,
-			     u32 *hash_index, u64 *hash)
+			     u32 index, u64 *hash)
 {
 	struct ssdfs_btree_index_key *ptr;
-	int err = -ENODATA;
+	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!node || !kaddr || !hash_index || !hash);
+	BUG_ON(!node || !kaddr || !hash);
 	BUG_ON(!rwsem_is_locked(&node->full_lock));
-
-	SSDFS_DBG("kaddr %p, page_off %u, "
-		  "index %u, upper_index %u\n",
-		  kaddr, page_off, index, upper_index);
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	*hash = U64_MAX;
 
-	for (*hash_index = index; *hash_index <= upper_index; ++(*hash_index)) {
-		err = ssdfs_lock_index_range(node, *hash_index, 1);
-		if (unlikely(err)) {
-			SSDFS_ERR("fail to lock index %u, err %d\n",
-				  *hash_index, err);
-			break;
-		}
-
-		err = -EEXIST;
-		ptr = CUR_INDEX(kaddr, page_off, *hash_index);
-		*hash = le64_to_cpu(ptr->index.hash);
-
-		ssdfs_unlock_index_range(node, *hash_index, 1);
-
-		if (err == -EEXIST) {
-			err = 0;
-			break;
-		} else if (err == -ENODATA)
-			continue;
-		else if (unlikely(err))
-			break;
-	}
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("hash_index %u, hash %llx\n",
-		  *hash_index, *hash);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	return err;
-}
-
-/*
- * ssdfs_check_last_index() - check last index in the search
- * @node: node object
- * @kaddr: pointer on starting address in the page
- * @page_off: offset from page's beginning in bytes
- * @index: requested index for the check
- * @search_hash: hash for search
- * @range_start: first index in the index area
- * @range_end: last index in the index area
- * @prev_found: processed index on previous iteration
- * @found_index: value of found index [out]
- *
- * This method tries to check the index for the case when
- * range has only one index.
- *
- * RETURN:
- * [success]
- * [failure] - error code:
- *
- * %-ERANGE     - internal error.
- * %-ENOENT     - requested hash is located in previous range.
- * %-ENODATA    - unable to find the node's index.
- */
-static
-int ssdfs_check_last_index(struct ssdfs_btree_node *node,
-			   void *kaddr, u32 page_off,
-			   u32 index, u64 search_hash,
-			   u32 range_start, u32 range_end,
-			   u32 prev_found, u16 *found_index)
-{
-	u32 hash_index;
-	u64 hash;
-	int err = 0;
-
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!node || !kaddr || !found_index);
-	BUG_ON(!rwsem_is_locked(&node->full_lock));
-
-	SSDFS_DBG("kaddr %p, page_off %u, "
-		  "index %u, search_hash %llx, "
-		  "range_start %u, range_end %u, "
-		  "prev_found %u\n",
-		  kaddr, page_off, index, search_hash,
-		  range_start, range_end, prev_found);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	err = ssdfs_get_index_key_hash(node, kaddr, page_off,
-					index, index,
-					&hash_index, &hash);
+	err = ssdfs_lock_index_range(node, index, 1);
 	if (unlikely(err)) {
-		SSDFS_ERR("fail to get hash: "
-			  "index %u, err %d\n",
+		SSDFS_ERR("fail to lock index %u, err %d\n",
 			  index, err);
 		return err;
 	}
 
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("hash_index %u, hash %llx\n",
-		  hash_index, hash);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	if (hash_index != index) {
-		SSDFS_ERR("hash_index %u != index %u\n",
-			  hash_index, index);
-		return -ERANGE;
-	}
+	ptr = CUR_INDEX(kaddr, page_off, index);
+	*hash = le64_to_cpu(ptr->index.hash);
 
-	if (search_hash < hash) {
-		err = -ENOENT;
+	ssdfs_unlock_index_range(node, index, 1);
 
-#ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("unable to find index: "
-			  "index %u, search_hash %llx, "
-			  "hash %llx\n",
-			  hash_index, search_hash,
-			  hash);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-		if (prev_found < U16_MAX)
-			*found_index = prev_found;
-		else
-			*found_index = hash_index;
-	} else if (search_hash == hash) {
-		err = 0;
-		*found_index = hash_index;
-	} else {
-		err = -ENODATA;
-		*found_index = hash_index;
-	}
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("prev_found %u, found_index %u\n",
-		  prev_found, *found_index);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	return err;
-}
-
-/*
- * ssdfs_check_last_index_pair() - check last pair of indexes in the search
- * @node: node object
- * @kaddr: pointer on starting address in the page
- * @page_off: offset from page's beginning in bytes
- * @lower_index: starting index in the search
- * @upper_index: ending index in the search
- * @search_hash: hash for search
- * @range_start: first index in the index area
- * @range_end: last index in the index area
- * @prev_found: processed index on previous iteration
- * @found_index: value of found index [out]
- *
- * This method tries to find an index for the case when
- * range has only two indexes.
- *
- * RETURN:
- * [success]
- * [failure] - error code:
- *
- * %-ERANGE     - internal error.
- * %-ENOENT     - requested hash is located in previous range.
- * %-ENODATA    - unable to find the node's index.
- */
-static
-int ssdfs_check_last_index_pair(struct ssdfs_btree_node *node,
-				void *kaddr, u32 page_off,
-				u32 lower_index, u32 upper_index,
-				u64 search_hash,
-				u32 range_start, u32 range_end,
-				u32 prev_found, u16 *found_index)
-{
-	u32 hash_index;
-	u64 hash;
-	int err = 0;
-
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!node || !kaddr || !found_index);
-	BUG_ON(!rwsem_is_locked(&node->full_lock));
-
-	SSDFS_DBG("kaddr %p, page_off %u, "
-		  "lower_index %u, upper_index %u, "
-		  "search_hash %llx, range_start %u, prev_found %u\n",
-		  kaddr, page_off, lower_index, upper_index,
-		  search_hash, range_start, prev_found);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	err = ssdfs_get_index_key_hash(node, kaddr, page_off,
-					lower_index, upper_index,
-					&hash_index, &hash);
-	if (unlikely(err)) {
-		SSDFS_ERR("fail to get hash: "
-			  "lower_index %u, upper_index %u, err %d\n",
-			  lower_index, upper_index, err);
-		return err;
-	}
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("hash_index %u, hash %llx\n",
-		  hash_index, hash);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	if (hash_index == lower_index) {
-		if (search_hash < hash) {
-			err = -ENOENT;
-
-#ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("unable to find index: "
-				  "index %u, search_hash %llx, "
-				  "hash %llx\n",
-				  hash_index, search_hash,
-				  hash);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-			if (prev_found < U16_MAX)
-				*found_index = prev_found;
-			else
-				*found_index = hash_index;
-		} else if (search_hash == hash) {
-			err = 0;
-			*found_index = hash_index;
-		} else {
-			prev_found = hash_index;
-			err = ssdfs_check_last_index(node, kaddr, page_off,
-						     upper_index, search_hash,
-						     range_start, range_end,
-						     prev_found, found_index);
-			if (err == -ENOENT) {
-				err = 0;
-				*found_index = prev_found;
-			}
-		}
-	} else if (hash_index == upper_index) {
-		if (search_hash > hash) {
-			err = -ENODATA;
-			*found_index = upper_index;
-		} else if (search_hash == hash) {
-			err = 0;
-			*found_index = upper_index;
-		} else {
-			prev_found = hash_index;
-			err = ssdfs_check_last_index(node, kaddr, page_off,
-						     lower_index, search_hash,
-						     range_start, range_end,
-						     prev_found, found_index);
-			if (err == -ENOENT) {
-				err = 0;
-				*found_index = prev_found;
-			}
-		}
-	} else {
-		SSDFS_ERR("invalid index: hash_index %u, "
-			  "lower_index %u, upper_index %u\n",
-			  hash_index, lower_index, upper_index);
-		return -ERANGE;
-	}
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("prev_found %u, found_index %u, err %d\n",
-		  prev_found, *found_index, err);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	return err;
+	return 0;
 }
 
 /*
@@ -5629,6 +5529,7 @@ int ssdfs_check_last_index_pair(struct ssdfs_btree_node *node,
  * %-ERANGE     - internal error.
  * %-ENODATA    - unable to find the node's index.
  * %-ENOENT     - index record is outside of this memory page.
+ * %-EEXIST     - search hash has been found.
  */
 static
 int ssdfs_find_index_in_memory_page(struct ssdfs_btree_node *node,
@@ -5644,9 +5545,7 @@ int ssdfs_find_index_in_memory_page(struct ssdfs_btree_node *node,
 	u32 page_off;
 	u32 search_bytes;
 	u32 index_count;
-	u32 cur_index, upper_index, lower_index;
-	u32 range_start, range_end;
-	u32 prev_found;
+	u32 base, count, half;
 	u64 hash;
 	u32 processed_indexes = 0;
 	int err = -ENODATA;
@@ -5758,138 +5657,60 @@ int ssdfs_find_index_in_memory_page(struct ssdfs_btree_node *node,
 		  area->index_count, processed_indexes, index_count);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	cur_index = 0;
-	range_start = lower_index = 0;
-	range_end = upper_index = index_count - 1;
-
 	page = node->content.pvec.pages[page_index];
 	kaddr = kmap_local_page(page);
 
-	prev_found = *found_index;
-	while (lower_index <= upper_index) {
-		int diff = upper_index - lower_index;
-		u32 hash_index;
-
-#ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("lower_index %u, upper_index %u, diff %d\n",
-			  lower_index, upper_index, diff);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-		if (diff < 0) {
-			err = -ERANGE;
-			SSDFS_ERR("invalid diff: "
-				  "diff %d, lower_index %u, "
-				  "upper_index %u\n",
-				  diff, lower_index, upper_index);
-			goto finish_search;
-		}
-
-		if (diff == 0) {
-			err = ssdfs_check_last_index(node, kaddr, page_off,
-						     lower_index, search_hash,
-						     range_start, range_end,
-						     prev_found, found_index);
-			if (err == -ENOENT) {
-				if (prev_found < U16_MAX)
-					*found_index = prev_found;
-			} else if (err == -ENODATA) {
-				/*
-				 * Nothing was found
-				 */
-			} else if (unlikely(err)) {
-				SSDFS_ERR("fail to check the last index: "
-					  "index %u, err %d\n",
-					  lower_index, err);
-			}
-
-			*processed_bytes = search_bytes;
-			goto finish_search;
-		} else if (diff == 1) {
-			err = ssdfs_check_last_index_pair(node, kaddr,
-							  page_off,
-							  lower_index,
-							  upper_index,
-							  search_hash,
-							  range_start,
-							  range_end,
-							  prev_found,
-							  found_index);
-			if (err == -ENOENT) {
-				if (prev_found < U16_MAX)
-					*found_index = prev_found;
-			} else if (err == -ENODATA) {
-				/*
-				 * Nothing was found
-				 */
-			} else if (unlikely(err)) {
-				SSDFS_ERR("fail to check the last index pair: "
-					  "lower_index %u, upper_index %u, "
-					  "err %d\n",
-					  lower_index, upper_index, err);
-			}
-
-			*processed_bytes = search_bytes;
-			goto finish_search;
-		} else
-			cur_index = lower_index + (diff / 2);
-
+	/*
+	 * Find the last index with hash that is not bigger than
+	 * the search hash. The search range is halved on every
+	 * step without any data-dependent branch. So, the number
+	 * of steps depends on index_count only.
+	 */
+	base = 0;
+	count = index_count;
+	while (count > 1) {
+		half = count / 2;
 
 		err = ssdfs_get_index_key_hash(node, kaddr, page_off,
-						cur_index, upper_index,
-						&hash_index, &hash);
+						base + half, &hash);
 		if (unlikely(err)) {
 			SSDFS_WARN("fail to get hash: "
-				  "cur_index %u, upper_index %u, err %d\n",
-				  cur_index, upper_index, err);
+				   "index %u, err %d\n",
+				   base + half, err);
 			goto finish_search;
 		}
 
-#ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("search_hash %llx, hash %llx, "
-			  "hash_index %u, range_start %u, range_end %u\n",
-			  search_hash, hash, hash_index,
-			  range_start, range_end);
-#endif /* CONFIG_SSDFS_DEBUG */
+		base = (hash <= search_hash) ? base + half : base;
+		count -= half;
+	}
+
+	err = ssdfs_get_index_key_hash(node, kaddr, page_off,
+					base, &hash);
+	if (unlikely(err)) {
+		SSDFS_WARN("fail to get hash: "
+			   "index %u, err %d\n",
+			   base, err);
+		goto finish_search;
+	}
 
-		if (search_hash < hash) {
-			if (hash_index == range_start) {
-				err = -ENOENT;
-				*found_index = hash_index;
-#ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("unable to find index: "
-					  "index %u, search_hash %llx, "
-					  "hash %llx\n",
-					  hash_index, search_hash,
-					  hash);
-#endif /* CONFIG_SSDFS_DEBUG */
-				goto finish_search;
-			} else {
-				prev_found = lower_index;
-				upper_index = cur_index;
-			}
-		} else if (search_hash == hash) {
-			err = -EEXIST;
-			*found_index = cur_index;
-			*processed_bytes = search_bytes;
-			goto finish_search;
-		} else {
-			if (hash_index == range_end) {
-				err = -ENODATA;
-				*found_index = hash_index;
 #ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("unable to find index: "
-					  "index %u, search_hash %llx, "
-					  "hash %llx\n",
-					  hash_index, search_hash,
-					  hash);
+	SSDFS_DBG("search_hash %llx, hash %llx, index %u\n",
+		  search_hash, hash, base);
 #endif /* CONFIG_SSDFS_DEBUG */
-				goto finish_search;
-			} else {
-				prev_found = lower_index;
-				lower_index = cur_index;
-			}
-		}
-	};
+
+	*processed_bytes = search_bytes;
+	*found_index = base;
+
+	if (search_hash < hash) {
+		/* requested hash is located in previous range */
+		err = -ENOENT;
+	} else if (search_hash == hash)
+		err = -EEXIST;
+	else if ((base + 1) >= index_count) {
+		/* requested hash could be in the next range */
+		err = -ENODATA;
+	} else
+		err = 0;
 
 finish_search:
 	kunmap_local(kaddr);
@@ -5905,8 +5726,8 @@ finish_search:
 	}
 
 #ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("prev_found %u, found_index %u\n",
-		  prev_found, *found_index);
+	SSDFS_DBG("found_index %u, err %d\n",
+		  *found_index, err);
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	return err;
@@ -6549,6 +6370,73 @@ finish_hash_search:
 	return err;
 }
 
+/*
+ * ssdfs_btree_node_find_index_by_hash() - find index record by hash
+ * @node: node object
+ * @area: description of index area [out]
+ * @hash: hash value for the search
+ * @found_index: found position of index record in the node [out]
+ *
+ * The index records of the root node are stored in the node's
+ * header. So, the search in the root node is made under the header
+ * lock. Otherwise, the index area's descriptor is copied and
+ * the search is made without the header lock. The header lock
+ * is taken if the header has been modified during the copy
+ * or the search.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ERANGE     - internal error.
+ * %-ENODATA    - unable to find the node's index.
+ * %-EEXIST     - search hash has been found.
+ */
+static
+int ssdfs_btree_node_find_index_by_hash(struct ssdfs_btree_node *node,
+					struct ssdfs_btree_node_index_area *area,
+					u64 hash, u16 *found_index)
+{
+	size_t desc_size = sizeof(struct ssdfs_btree_node_index_area);
+	u32 version;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!node || !area || !found_index);
+	BUG_ON(!rwsem_is_locked(&node->full_lock));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (atomic_read(&node->type) != SSDFS_BTREE_ROOT_NODE) {
+		version = ssdfs_btree_node_header_read_begin(node);
+		ssdfs_memcpy(area, 0, desc_size,
+			     &node->index_area, 0, desc_size,
+			     desc_size);
+
+		if (!ssdfs_btree_node_header_read_retry(node, version)) {
+			err = ssdfs_find_index_by_hash(node, area, hash,
+							found_index);
+
+			/*
+			 * Index records are modified under the header lock.
+			 * The search result is valid if nobody has changed
+			 * the header during the search.
+			 */
+			if (!ssdfs_btree_node_header_read_retry(node, version))
+				return err;
+		}
+	}
+
+	down_read(&node->header_lock);
+	ssdfs_memcpy(area, 0, desc_size,
+		     &node->index_area, 0, desc_size,
+		     desc_size);
+	err = ssdfs_find_index_by_hash(node, area, hash, found_index);
+	up_read(&node->header_lock);
+
+	return err;
+}
+
 /*
  * ssdfs_btree_node_find_index_position() - find index's position
  * @node: node object
@@ -6573,7 +6461,6 @@ int ssdfs_btree_node_find_index_position(struct ssdfs_btree_node *node,
 					 u16 *found_position)
 {
 	struct ssdfs_btree_node_index_area area;
-	size_t desc_size = sizeof(struct ssdfs_btree_node_index_area);
 	int node_type;
 	int err = 0;
 
@@ -6617,7 +6504,7 @@ int ssdfs_btree_node_find_index_position(struct ssdfs_btree_node *node,
 
 	*found_position = U16_MAX;
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	node_type = atomic_read(&node->type);
 	if (node_type <= SSDFS_BTREE_NODE_UNKNOWN_TYPE ||
@@ -6628,13 +6515,8 @@ int ssdfs_btree_node_find_index_position(struct ssdfs_btree_node *node,
 		goto finish_index_search;
 	}
 
-	down_read(&node->header_lock);
-	ssdfs_memcpy(&area, 0, desc_size,
-		     &node->index_area, 0, desc_size,
-		     desc_size);
-	err = ssdfs_find_index_by_hash(node, &area, hash,
-					found_position);
-	up_read(&node->header_lock);
+	err = ssdfs_btree_node_find_index_by_hash(node, &area, hash,
+						  found_position);
 
 	if (err == -EEXIST) {
 		/* hash == found hash */
@@ -6684,7 +6566,6 @@ int ssdfs_btree_node_find_index(struct ssdfs_btree_search *search)
 {
 	struct ssdfs_btree_node *node;
 	struct ssdfs_btree_node_index_area area;
-	size_t desc_size = sizeof(struct ssdfs_btree_node_index_area);
 	int tree_height;
 	int node_type;
 	u16 found_index = U16_MAX;
@@ -6762,7 +6643,7 @@ int ssdfs_btree_node_find_index(struct ssdfs_btree_search *search)
 #endif /* CONFIG_SSDFS_DEBUG */
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	node_type = atomic_read(&node->type);
 	if (node_type <= SSDFS_BTREE_NODE_UNKNOWN_TYPE ||
@@ -6773,14 +6654,9 @@ int ssdfs_btree_node_find_index(struct ssdfs_btree_search *search)
 		goto finish_index_search;
 	}
 
-	down_read(&node->header_lock);
-	ssdfs_memcpy(&area, 0, desc_size,
-		     &node->index_area, 0, desc_size,
-		     desc_size);
-	err = ssdfs_find_index_by_hash(node, &area,
-					search->request.start.hash,
-					&found_index);
-	up_read(&node->header_lock);
+	err = ssdfs_btree_node_find_index_by_hash(node, &area,
+						  search->request.start.hash,
+						  &found_index);
 
 	if (err == -EEXIST) {
 		/* hash == found hash */
@@ -7753,8 +7629,8 @@ int ssdfs_btree_node_add_index(struct ssdfs_btree_node *node,
 	}
 
 	if (node_type == SSDFS_BTREE_ROOT_NODE) {
-		down_read(&node->full_lock);
-		down_write(&node->header_lock);
+		SSDFS_DOWN_READ(btree_node, &node->full_lock);
+		ssdfs_btree_node_header_down_write(node);
 
 		err = ssdfs_find_index_by_hash(node, &node->index_area,
 						hash, &found);
@@ -7784,7 +7660,7 @@ int ssdfs_btree_node_add_index(struct ssdfs_btree_node *node,
 		}
 
 finish_change_root_node:
-		up_write(&node->header_lock);
+		ssdfs_btree_node_header_up_write(node);
 		up_read(&node->full_lock);
 
 		if (unlikely(err)) {
@@ -7792,8 +7668,8 @@ finish_change_root_node:
 			return err;
 		}
 	} else {
-		down_write(&node->full_lock);
-		down_write(&node->header_lock);
+		SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+		ssdfs_btree_node_header_down_write(node);
 
 		err = ssdfs_find_index_by_hash(node, &node->index_area,
 						hash, &found);
@@ -7812,7 +7688,7 @@ finish_change_root_node:
 			SSDFS_ERR("fail to find an index: "
 				  "node_id %u, hash %llx, err %d\n",
 				  node->node_id, hash, err);
-			up_write(&node->header_lock);
+			ssdfs_btree_node_header_up_write(node);
 			up_write(&node->full_lock);
 			return err;
 		}
@@ -7824,7 +7700,7 @@ finish_change_root_node:
 			SSDFS_ERR("fail to lock index range: "
 				  "start %u, count %u, err %d\n",
 				  found, count, err);
-			up_write(&node->header_lock);
+			ssdfs_btree_node_header_up_write(node);
 			up_write(&node->full_lock);
 			return err;
 		}
@@ -7838,7 +7714,7 @@ finish_change_root_node:
 		if (!err)
 			err = ssdfs_set_dirty_index_range(node, found, count);
 
-		up_write(&node->header_lock);
+		ssdfs_btree_node_header_up_write(node);
 		up_read(&node->full_lock);
 
 		if (unlikely(err)) {
@@ -7979,7 +7855,7 @@ int __ssdfs_btree_node_change_index(struct ssdfs_btree_node *node,
 	}
 
 	if (node_type == SSDFS_BTREE_ROOT_NODE) {
-		down_read(&node->full_lock);
+		SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 		err = ssdfs_find_index_by_hash(node, &node->index_area,
 						old_hash, &found);
@@ -8012,7 +7888,7 @@ int __ssdfs_btree_node_change_index(struct ssdfs_btree_node *node,
 		BUG_ON(found == U16_MAX);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-		down_write(&node->header_lock);
+		ssdfs_btree_node_header_down_write(node);
 
 		err = ssdfs_btree_root_node_change_index(node, found,
 							 new_index);
@@ -8024,14 +7900,14 @@ int __ssdfs_btree_node_change_index(struct ssdfs_btree_node *node,
 				  found, err);
 		}
 
-		up_write(&node->header_lock);
+		ssdfs_btree_node_header_up_write(node);
 finish_change_root_node:
 		up_read(&node->full_lock);
 
 		if (unlikely(err))
 			return err;
 	} else {
-		down_read(&node->full_lock);
+		SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 		down_read(&node->header_lock);
 		ssdfs_memcpy(&area, 0, desc_size,
@@ -8066,8 +7942,8 @@ finish_change_root_node:
 		BUG_ON(found == U16_MAX);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-		down_write(&node->full_lock);
-		down_write(&node->header_lock);
+		SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+		ssdfs_btree_node_header_down_write(node);
 
 		err = ssdfs_lock_index_range(node, found, 1);
 		BUG_ON(err == -ENODATA);
@@ -8075,7 +7951,7 @@ finish_change_root_node:
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to lock index %u, err %d\n",
 				  found, err);
-			up_write(&node->header_lock);
+			ssdfs_btree_node_header_up_write(node);
 			up_write(&node->full_lock);
 			return err;
 		}
@@ -8090,7 +7966,7 @@ finish_change_root_node:
 		if (!err)
 			err = ssdfs_set_dirty_index_range(node, found, 1);
 
-		up_write(&node->header_lock);
+		ssdfs_btree_node_header_up_write(node);
 		up_read(&node->full_lock);
 
 		if (unlikely(err)) {
@@ -8940,8 +8816,8 @@ int ssdfs_btree_node_delete_index(struct ssdfs_btree_node *node,
 	}
 
 	if (node_type == SSDFS_BTREE_ROOT_NODE) {
-		down_read(&node->full_lock);
-		down_write(&node->header_lock);
+		SSDFS_DOWN_READ(btree_node, &node->full_lock);
+		ssdfs_btree_node_header_down_write(node);
 
 		if (is_ssdfs_btree_node_pre_deleted(node)) {
 			SSDFS_DBG("node %u is pre-deleted\n",
@@ -8975,14 +8851,14 @@ int ssdfs_btree_node_delete_index(struct ssdfs_btree_node *node,
 		}
 
 finish_change_root_node:
-		up_write(&node->header_lock);
+		ssdfs_btree_node_header_up_write(node);
 		up_read(&node->full_lock);
 
 		if (unlikely(err))
 			return err;
 	} else {
-		down_write(&node->full_lock);
-		down_write(&node->header_lock);
+		SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+		ssdfs_btree_node_header_down_write(node);
 
 		if (is_ssdfs_btree_node_pre_deleted(node)) {
 			SSDFS_DBG("node %u is pre-deleted\n",
@@ -9000,7 +8876,7 @@ finish_change_root_node:
 			SSDFS_ERR("fail to find an index: "
 				  "node_id %u, hash %llx, err %d\n",
 				  node->node_id, hash, err);
-			up_write(&node->header_lock);
+			ssdfs_btree_node_header_up_write(node);
 			up_write(&node->full_lock);
 			return err;
 		}
@@ -9019,7 +8895,7 @@ finish_change_root_node:
 			SSDFS_ERR("fail to lock index range: "
 				  "start %u, count %u, err %d\n",
 				  found, count, err);
-			up_write(&node->header_lock);
+			ssdfs_btree_node_header_up_write(node);
 			up_write(&node->full_lock);
 			return err;
 		}
@@ -9033,7 +8909,7 @@ finish_change_root_node:
 			err = ssdfs_set_dirty_index_range(node, found, count);
 
 finish_change_common_node:
-		up_write(&node->header_lock);
+		ssdfs_btree_node_header_up_write(node);
 		up_read(&node->full_lock);
 
 		if (unlikely(err)) {
@@ -9170,7 +9046,7 @@ int ssdfs_move_root2common_node_index_range(struct ssdfs_btree_node *src,
 	for (i = src_start, j = dst_start; i < upper_bound; i++, j++) {
 		struct ssdfs_btree_index_key index;
 
-		down_write(&src->full_lock);
+		SSDFS_DOWN_WRITE(btree_node, &src->full_lock);
 
 		err = __ssdfs_btree_root_node_extract_index(src, i,
 							    &index);
@@ -9188,11 +9064,11 @@ int ssdfs_move_root2common_node_index_range(struct ssdfs_btree_node *src,
 			return err;
 		}
 
-		down_write(&dst->full_lock);
+		SSDFS_DOWN_WRITE(btree_node, &dst->full_lock);
 
-		down_write(&dst->header_lock);
+		ssdfs_btree_node_header_down_write(dst);
 		err = ssdfs_btree_common_node_add_index(dst, j, &index);
-		up_write(&dst->header_lock);
+		ssdfs_btree_node_header_up_write(dst);
 
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to insert index: "
@@ -9210,11 +9086,11 @@ int ssdfs_move_root2common_node_index_range(struct ssdfs_btree_node *src,
 	}
 
 	for (i = 0; i < count; i++) {
-		down_write(&src->full_lock);
+		SSDFS_DOWN_WRITE(btree_node, &src->full_lock);
 
-		down_write(&src->header_lock);
+		ssdfs_btree_node_header_down_write(src);
 		err = ssdfs_btree_root_node_delete_index(src, src_start);
-		up_write(&src->header_lock);
+		ssdfs_btree_node_header_up_write(src);
 
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to delete index: "
@@ -9762,7 +9638,7 @@ int ssdfs_move_common2common_node_index_range(struct ssdfs_btree_node *src,
 	i = src_start;
 	j = dst_start;
 
-	down_write(&src->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &src->full_lock);
 	err = ssdfs_lock_whole_index_area(src);
 	downgrade_write(&src->full_lock);
 
@@ -9772,7 +9648,7 @@ int ssdfs_move_common2common_node_index_range(struct ssdfs_btree_node *src,
 		goto unlock_src_node;
 	}
 
-	down_write(&dst->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &dst->full_lock);
 	err = ssdfs_lock_whole_index_area(dst);
 	downgrade_write(&dst->full_lock);
 
@@ -9784,12 +9660,12 @@ int ssdfs_move_common2common_node_index_range(struct ssdfs_btree_node *src,
 	}
 
 	if (dst_start == 0 && dst_start != dst_index_count) {
-		down_write(&dst->header_lock);
+		ssdfs_btree_node_header_down_write(dst);
 		err = ssdfs_shift_range_right2(dst, &dst->index_area,
 						index_size,
 						0, dst_index_count,
 						count);
-		up_write(&dst->header_lock);
+		ssdfs_btree_node_header_up_write(dst);
 
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to shift index range right: "
@@ -9853,13 +9729,13 @@ int ssdfs_move_common2common_node_index_range(struct ssdfs_btree_node *src,
 		goto unlock_index_area;
 	}
 
-	down_write(&dst->header_lock);
+	ssdfs_btree_node_header_down_write(dst);
 	dst->index_area.index_count += processed;
 	err = __ssdfs_init_index_area_hash_range(dst,
 						 dst->index_area.index_count,
 						 &dst->index_area.start_hash,
 						 &dst->index_area.end_hash);
-	up_write(&dst->header_lock);
+	ssdfs_btree_node_header_up_write(dst);
 
 	if (unlikely(err)) {
 		SSDFS_ERR("fail to set the destination node's index range: "
@@ -9928,13 +9804,13 @@ finish_source_correction:
 		}
 	}
 
-	down_write(&src->header_lock);
+	ssdfs_btree_node_header_down_write(src);
 	src->index_area.index_count -= processed;
 	err = __ssdfs_init_index_area_hash_range(src,
 						 src->index_area.index_count,
 						 &src->index_area.start_hash,
 						 &src->index_area.end_hash);
-	up_write(&src->header_lock);
+	ssdfs_btree_node_header_up_write(src);
 
 	if (unlikely(err)) {
 		SSDFS_ERR("fail to set the source node's hash range: "
@@ -10501,7 +10377,7 @@ int ssdfs_btree_node_find_item(struct ssdfs_btree_search *search)
 		return -EOPNOTSUPP;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = node->node_ops->find_item(node, search);
 	up_read(&node->full_lock);
 
@@ -10677,7 +10553,7 @@ int ssdfs_btree_node_find_range(struct ssdfs_btree_search *search)
 		return -EOPNOTSUPP;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = node->node_ops->find_range(node, search);
 	up_read(&node->full_lock);
 
@@ -12608,7 +12484,7 @@ int ssdfs_copy_item_in_buffer(struct ssdfs_btree_node *node,
 	if (page_index > 0)
 		item_offset %= page_index * PAGE_SIZE;
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	if (page_index >= pagevec_count(&node->content.pvec)) {
 		err = -ERANGE;
@@ -13610,7 +13486,7 @@ int __ssdfs_extract_range_by_lookup_index(struct ssdfs_btree_node *node,
 		return err;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	bmap = &node->bmap_array.bmap[SSDFS_BTREE_NODE_LOCK_BMAP];
 
@@ -15568,7 +15444,7 @@ int ssdfs_invalidate_root_node_hierarchy(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	for (i = 0; i < SSDFS_BTREE_ROOT_NODE_INDEX_COUNT; i++) {
 		err = __ssdfs_btree_root_node_extract_index(node, i,
@@ -15581,7 +15457,7 @@ int ssdfs_invalidate_root_node_hierarchy(struct ssdfs_btree_node *node)
 		}
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	index_count = node->index_area.index_count;
 
@@ -15624,7 +15500,7 @@ int ssdfs_invalidate_root_node_hierarchy(struct ssdfs_btree_node *node)
 	set_ssdfs_btree_node_pre_deleted(node);
 
 finish_process_root_node:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 finish_invalidate_root_node_hierarchy:
 	up_write(&node->full_lock);
@@ -193,6 +193,25 @@ union ssdfs_aggregated_btree_node_header {
 	struct ssdfs_xattrs_btree_node_header xattrs_header;
 };
 
+/*
+ * struct ssdfs_btree_node_bloom_filter - node's negative lookup filter
+ * @ptr: bitmap of the filter
+ * @bits_shift: log2 of bits count in the bitmap
+ *
+ * The filter keeps the hashes of items that have been stored
+ * into the node. If the filter doesn't contain a hash then the node
+ * hasn't the item for sure and the lookup can skip the binary search.
+ * The deleted items are not excluded from the filter, so the filter
+ * can only report false positives.
+ */
+struct ssdfs_btree_node_bloom_filter {
+	unsigned long *ptr;
+	u32 bits_shift;
+};
+
+#define SSDFS_BTREE_NODE_BLOOM_BITS_PER_ITEM	(8)
+#define SSDFS_BTREE_NODE_BLOOM_HASHES		(3)
+
 /*
  * struct ssdfs_btree_node - btree node
  * @height: node's height
@@ -203,10 +222,12 @@ union ssdfs_aggregated_btree_node_header {
  * @tree: pointer on node's parent tree
  * @node_ops: btree's node operation specialization
  * @refs_count: reference counter
+ * @lru_referenced: node has been accessed since the last eviction scan
  * @state: node state
  * @flags: node's flags
  * @type: node type
  * @header_lock: header lock
+ * @header_version: header's version (odd value means modification)
  * @raw.root_node: root node copy
  * @raw.generic_header: generic node's header
  * @raw.inodes_header: inodes node's header
@@ -231,6 +252,7 @@ union ssdfs_aggregated_btree_node_header {
  * @flush_req: flush request
  * @bmap_array: partial locks, alloc and dirty bitmaps
  * @wait_queue: queue of threads are waiting partial lock
+ * @bloom: negative lookup filter of items' hashes
  * @full_lock: the whole node lock
  * @content: node's content
  */
@@ -257,6 +279,7 @@ struct ssdfs_btree_node {
 	 * than one.
 	 */
 	atomic_t refs_count;
+	atomic_t lru_referenced;
 
 	/* mutable data */
 	atomic_t state;
@@ -265,6 +288,7 @@ struct ssdfs_btree_node {
 
 	/* node's header */
 	struct rw_semaphore header_lock;
+	atomic_t header_version;
 	union {
 		struct ssdfs_btree_inline_root_node root_node;
 		struct ssdfs_btree_node_header generic_header;
@@ -296,6 +320,9 @@ struct ssdfs_btree_node {
 	struct ssdfs_state_bitmap_array bmap_array;
 	wait_queue_head_t wait_queue;
 
+	/* negative lookup filter */
+	struct ssdfs_btree_node_bloom_filter bloom;
+
 	/* node raw content */
 	struct rw_semaphore full_lock;
 	struct ssdfs_btree_node_content content;
@@ -351,6 +378,63 @@ u8 NODE2SEG_TYPE(u8 node_type)
 	return SSDFS_UNKNOWN_SEG_TYPE;
 }
 
+/*
+ * ssdfs_btree_node_header_down_write() - lock node's header for modification
+ * @node: node object
+ *
+ * The header's version is odd while the header is under modification.
+ * It gives the opportunity to read the header's fields without
+ * the header lock and to validate the read by means of the version.
+ */
+static inline
+void ssdfs_btree_node_header_down_write(struct ssdfs_btree_node *node)
+{
+	down_write(&node->header_lock);
+	atomic_inc(&node->header_version);
+	smp_mb__after_atomic();
+}
+
+/*
+ * ssdfs_btree_node_header_up_write() - finish node's header modification
+ * @node: node object
+ */
+static inline
+void ssdfs_btree_node_header_up_write(struct ssdfs_btree_node *node)
+{
+	smp_mb__before_atomic();
+	atomic_inc(&node->header_version);
+	up_write(&node->header_lock);
+}
+
+/*
+ * ssdfs_btree_node_header_read_begin() - begin optimistic header read
+ * @node: node object
+ *
+ * RETURN: header's version that should be validated after the read.
+ */
+static inline
+u32 ssdfs_btree_node_header_read_begin(struct ssdfs_btree_node *node)
+{
+	return (u32)atomic_read_acquire(&node->header_version);
+}
+
+/*
+ * ssdfs_btree_node_header_read_retry() - validate optimistic header read
+ * @node: node object
+ * @version: header's version at the beginning of the read
+ *
+ * RETURN: true if the read fields could be inconsistent and
+ * the header should be read under the header lock.
+ */
+static inline
+bool ssdfs_btree_node_header_read_retry(struct ssdfs_btree_node *node,
+					u32 version)
+{
+	smp_rmb();
+	return (version & 1) ||
+		(u32)atomic_read(&node->header_version) != version;
+}
+
 /*
  * RANGE_WITHOUT_INTERSECTION() - check that ranges have intersection
  * @start1: starting hash of the first range
@@ -605,6 +689,11 @@ int ssdfs_btree_node_allocate_bmaps(void *addr[SSDFS_BTREE_NODE_BMAP_COUNT],
 				    size_t bmap_bytes);
 void ssdfs_btree_node_init_bmaps(struct ssdfs_btree_node *node,
 				void *addr[SSDFS_BTREE_NODE_BMAP_COUNT]);
+int ssdfs_btree_node_bloom_create(struct ssdfs_btree_node *node,
+				  u16 items_capacity);
+void ssdfs_btree_node_bloom_add(struct ssdfs_btree_node *node, u64 hash);
+bool ssdfs_btree_node_bloom_may_contain(struct ssdfs_btree_node *node,
+					u64 hash);
 int ssdfs_btree_node_allocate_content_space(struct ssdfs_btree_node *node,
 					    u32 node_size);
 int __ssdfs_btree_node_prepare_content(struct ssdfs_fs_info *fsi,
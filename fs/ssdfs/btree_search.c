@@ -162,6 +162,21 @@ struct ssdfs_btree_search *ssdfs_btree_search_alloc(void)
 	return ptr;
 }
 
+/*
+ * ssdfs_btree_search_free_spare_buf() - free spare result buffer
+ * @search: btree search object
+ */
+static inline
+void ssdfs_btree_search_free_spare_buf(struct ssdfs_btree_search *search)
+{
+	if (search->spare_buf) {
+		ssdfs_btree_search_kfree(search->spare_buf);
+		search->spare_buf = NULL;
+	}
+
+	search->spare_buf_size = 0;
+}
+
 /*
  * ssdfs_btree_search_free() - free memory for btree search object
  */
@@ -188,23 +203,51 @@ void ssdfs_btree_search_free(struct ssdfs_btree_search *search)
 
 	ssdfs_btree_search_free_result_buf(search);
 	ssdfs_btree_search_free_result_name(search);
+	ssdfs_btree_search_free_spare_buf(search);
 
 	ssdfs_btree_search_cache_leaks_decrement(search);
 	kmem_cache_free(ssdfs_btree_search_obj_cachep, search);
 }
 
 /*
- * ssdfs_btree_search_init() - init btree search object
+ * __ssdfs_btree_search_init() - init btree search object
  * @search: btree search object [out]
+ * @keep_buf: keep the external result buffer for the next search?
  */
-void ssdfs_btree_search_init(struct ssdfs_btree_search *search)
+static
+void __ssdfs_btree_search_init(struct ssdfs_btree_search *search,
+				bool keep_buf)
 {
+	void *spare_buf = NULL;
+	size_t spare_buf_size = 0;
+
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!search);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	if (keep_buf &&
+	    search->result.buf_state == SSDFS_BTREE_SEARCH_EXTERNAL_BUFFER &&
+	    search->result.buf &&
+	    search->result.buf_size > search->spare_buf_size) {
+		ssdfs_btree_search_free_spare_buf(search);
+
+		spare_buf = search->result.buf;
+		spare_buf_size = search->result.buf_size;
+
+		search->result.buf = NULL;
+		search->result.buf_state =
+			SSDFS_BTREE_SEARCH_UNKNOWN_BUFFER_STATE;
+	} else if (keep_buf) {
+		spare_buf = search->spare_buf;
+		spare_buf_size = search->spare_buf_size;
+
+		search->spare_buf = NULL;
+		search->spare_buf_size = 0;
+	}
+
 	ssdfs_btree_search_free_result_buf(search);
 	ssdfs_btree_search_free_result_name(search);
+	ssdfs_btree_search_free_spare_buf(search);
 
 	if (search->node.parent) {
 		ssdfs_btree_node_put(search->node.parent);
@@ -225,6 +268,32 @@ void ssdfs_btree_search_init(struct ssdfs_btree_search *search)
 	search->result.buf_state = SSDFS_BTREE_SEARCH_UNKNOWN_BUFFER_STATE;
 	search->result.name = NULL;
 	search->result.name_state = SSDFS_BTREE_SEARCH_UNKNOWN_BUFFER_STATE;
+	search->spare_buf = spare_buf;
+	search->spare_buf_size = spare_buf_size;
+}
+
+/*
+ * ssdfs_btree_search_init() - init btree search object
+ * @search: btree search object [out]
+ */
+void ssdfs_btree_search_init(struct ssdfs_btree_search *search)
+{
+	__ssdfs_btree_search_init(search, false);
+}
+
+/*
+ * ssdfs_btree_search_reinit() - re-init btree search object
+ * @search: btree search object [out]
+ *
+ * This method prepares the search object for the next search
+ * in a sequence of searches (for example, iteration over the items
+ * of the tree). The external result buffer is not freed but it is
+ * kept as a spare one. The next allocation of the result buffer
+ * re-uses the spare buffer instead of allocating a new one.
+ */
+void ssdfs_btree_search_reinit(struct ssdfs_btree_search *search)
+{
+	__ssdfs_btree_search_init(search, true);
 }
 
 /*
@@ -583,6 +652,14 @@ int ssdfs_btree_search_alloc_result_buf(struct ssdfs_btree_search *search,
 	BUG_ON(!search);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	if (search->spare_buf && search->spare_buf_size >= buf_size) {
+		memset(search->spare_buf, 0, buf_size);
+		search->result.buf = search->spare_buf;
+		search->spare_buf = NULL;
+		search->spare_buf_size = 0;
+		goto finish_buf_allocation;
+	}
+
 	search->result.buf = ssdfs_btree_search_kzalloc(buf_size, GFP_KERNEL);
 	if (!search->result.buf) {
 		SSDFS_ERR("fail to allocate buffer: size %zu\n",
@@ -590,6 +667,7 @@ int ssdfs_btree_search_alloc_result_buf(struct ssdfs_btree_search *search,
 		return -ENOMEM;
 	}
 
+finish_buf_allocation:
 	search->result.buf_size = buf_size;
 	search->result.buf_state = SSDFS_BTREE_SEARCH_EXTERNAL_BUFFER;
 	search->result.items_in_buffer = 0;
@@ -288,6 +288,14 @@ enum {
  * @raw.peb2time: raw PEB2time set
  * @raw.invalidated_extent: invalidated extent buffer
  * @name: name string
+ * @spare_buf: external result buffer kept for the next search
+ * @spare_buf_size: size of the spare buffer in bytes
+ *
+ * The search object can be re-used for a sequence of searches
+ * (for example, iteration over the tree's items). In such case,
+ * ssdfs_btree_search_reinit() keeps the allocated external result
+ * buffer as the spare one instead of freeing it. The next request of
+ * the result buffer re-uses the spare buffer if it is big enough.
  */
 struct ssdfs_btree_search {
 	struct ssdfs_btree_search_request request;
@@ -308,6 +316,9 @@ struct ssdfs_btree_search {
 		struct ssdfs_raw_extent invalidated_extent;
 	} raw;
 	struct ssdfs_name_string name;
+
+	void *spare_buf;
+	size_t spare_buf_size;
 };
 
 /* Btree height's classification */
@@ -334,6 +345,7 @@ bool is_btree_search_contains_new_item(struct ssdfs_btree_search *search)
 struct ssdfs_btree_search *ssdfs_btree_search_alloc(void);
 void ssdfs_btree_search_free(struct ssdfs_btree_search *search);
 void ssdfs_btree_search_init(struct ssdfs_btree_search *search);
+void ssdfs_btree_search_reinit(struct ssdfs_btree_search *search);
 bool need_initialize_btree_search(struct ssdfs_btree_search *search);
 bool is_btree_search_request_valid(struct ssdfs_btree_search *search);
 bool is_btree_index_search_request_valid(struct ssdfs_btree_search *search,
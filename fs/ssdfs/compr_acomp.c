@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * SSDFS -- SSD-oriented File System.
+ *
+ * fs/ssdfs/compr_acomp.c - offload of compression into crypto acomp API.
+ *
+ * Copyright (c) 2023 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ * All rights reserved.
+ *
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/scatterlist.h>
+#include <linux/pagevec.h>
+#include <crypto/acompress.h>
+
+#include "peb_mapping_queue.h"
+#include "peb_mapping_table_cache.h"
+#include "page_vector.h"
+#include "ssdfs.h"
+#include "compression.h"
+
+/*
+ * Algorithms of crypto API that produce the same stream format
+ * as SSDFS compressors. ZLIB compressor stores zlib-wrapped stream
+ * but "deflate" algorithm of crypto API produces raw deflate stream.
+ * As a result, ZLIB cannot be offloaded.
+ */
+static const char * const ssdfs_acomp_alg_name[SSDFS_COMPR_TYPES_CNT] = {
+#ifdef CONFIG_SSDFS_LZO
+	[SSDFS_COMPR_LZO] = "lzo",
+#endif /* CONFIG_SSDFS_LZO */
+#ifdef CONFIG_SSDFS_ZSTD
+	[SSDFS_COMPR_ZSTD] = "zstd",
+#endif /* CONFIG_SSDFS_ZSTD */
+#ifdef CONFIG_SSDFS_LZ4
+	[SSDFS_COMPR_LZ4] = "lz4",
+#endif /* CONFIG_SSDFS_LZ4 */
+};
+
+/* suffix of drivers that wrap synchronous software implementation */
+#define SSDFS_ACOMP_SW_DRIVER_SUFFIX	"-scomp"
+
+static struct crypto_acomp *ssdfs_acomp_tfm[SSDFS_COMPR_TYPES_CNT];
+
+/*
+ * is_ssdfs_acomp_sw_driver() - check that driver is software one
+ * @tfm: acomp transformation
+ *
+ * Software implementation wrapped by acomp API has no benefits
+ * in comparison with native SSDFS compressor but it adds
+ * the overhead of request allocation and scatterlists.
+ */
+static inline
+bool is_ssdfs_acomp_sw_driver(struct crypto_acomp *tfm)
+{
+	const char *name = crypto_tfm_alg_driver_name(crypto_acomp_tfm(tfm));
+	size_t suffix_len = strlen(SSDFS_ACOMP_SW_DRIVER_SUFFIX);
+	size_t len = strlen(name);
+
+	if (len < suffix_len)
+		return false;
+
+	return strcmp(name + len - suffix_len,
+		      SSDFS_ACOMP_SW_DRIVER_SUFFIX) == 0;
+}
+
+int ssdfs_acomp_init(void)
+{
+	struct crypto_acomp *tfm;
+	int i;
+
+	for (i = 0; i < SSDFS_COMPR_TYPES_CNT; i++) {
+		ssdfs_acomp_tfm[i] = NULL;
+
+		if (!ssdfs_acomp_alg_name[i])
+			continue;
+
+		tfm = crypto_alloc_acomp(ssdfs_acomp_alg_name[i], 0, 0);
+		if (IS_ERR(tfm)) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("no acomp driver for %s: err %ld\n",
+				  ssdfs_acomp_alg_name[i], PTR_ERR(tfm));
+#endif /* CONFIG_SSDFS_DEBUG */
+			continue;
+		}
+
+		if (is_ssdfs_acomp_sw_driver(tfm)) {
+			crypto_free_acomp(tfm);
+			continue;
+		}
+
+		SSDFS_INFO("offload %s compression into %s\n",
+			   ssdfs_acomp_alg_name[i],
+			   crypto_tfm_alg_driver_name(crypto_acomp_tfm(tfm)));
+
+		ssdfs_acomp_tfm[i] = tfm;
+	}
+
+	return 0;
+}
+
+void ssdfs_acomp_exit(void)
+{
+	int i;
+
+	for (i = 0; i < SSDFS_COMPR_TYPES_CNT; i++) {
+		if (!ssdfs_acomp_tfm[i])
+			continue;
+
+		crypto_free_acomp(ssdfs_acomp_tfm[i]);
+		ssdfs_acomp_tfm[i] = NULL;
+	}
+}
+
+/*
+ * ssdfs_acomp_process() - submit request and wait the completion
+ * @type: compression type
+ * @compress: compress or decompress data?
+ * @src: source buffer
+ * @slen: size of source buffer in bytes
+ * @dst: destination buffer
+ * @dlen: size of destination buffer in bytes [in|out]
+ *
+ * This function submits the request to acomp driver and sleeps
+ * until the completion of the request. The CPU is free for
+ * another threads while the hardware processes the data.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EOPNOTSUPP - no acomp driver or buffers cannot be offloaded.
+ * %-ENOMEM     - unable to allocate request.
+ */
+static
+int ssdfs_acomp_process(int type, bool compress,
+			unsigned char *src, size_t slen,
+			unsigned char *dst, size_t *dlen)
+{
+	struct crypto_acomp *tfm;
+	struct acomp_req *req;
+	struct scatterlist src_sg, dst_sg;
+	DECLARE_CRYPTO_WAIT(wait);
+	int err;
+
+	tfm = ssdfs_acomp_tfm[type];
+	if (!tfm)
+		return -EOPNOTSUPP;
+
+	/* scatterlist requires linearly mapped memory */
+	if (!virt_addr_valid(src) || !virt_addr_valid(dst))
+		return -EOPNOTSUPP;
+
+	req = acomp_request_alloc(tfm);
+	if (!req)
+		return -ENOMEM;
+
+	sg_init_one(&src_sg, src, slen);
+	sg_init_one(&dst_sg, dst, *dlen);
+	acomp_request_set_params(req, &src_sg, &dst_sg, slen, *dlen);
+	acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+				   crypto_req_done, &wait);
+
+	if (compress)
+		err = crypto_wait_req(crypto_acomp_compress(req), &wait);
+	else
+		err = crypto_wait_req(crypto_acomp_decompress(req), &wait);
+
+	if (!err)
+		*dlen = req->dlen;
+
+	acomp_request_free(req);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("type %d, compress %#x, slen %zu, dlen %zu, err %d\n",
+		  type, compress, slen, *dlen, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return err;
+}
+
+/*
+ * ssdfs_acomp_compress() - compress data by means of acomp driver
+ * @type: compression type
+ * @data_in: uncompressed data
+ * @cdata_out: compressed data [out]
+ * @srclen: size of uncompressed data in bytes
+ * @destlen: size of buffer for compressed data in bytes [in|out]
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EOPNOTSUPP - compression cannot be offloaded.
+ * %-E2BIG      - data cannot be compressed.
+ */
+int ssdfs_acomp_compress(int type, unsigned char *data_in,
+			 unsigned char *cdata_out,
+			 size_t *srclen, size_t *destlen)
+{
+	size_t compr_size = *destlen;
+	int err;
+
+	err = ssdfs_acomp_process(type, true, data_in, *srclen,
+				  cdata_out, &compr_size);
+	if (err == -EOPNOTSUPP || err == -ENOMEM)
+		return -EOPNOTSUPP;
+	else if (err || compr_size >= *srclen) {
+		/* drivers report overflow by different error codes */
+		return -E2BIG;
+	}
+
+	*destlen = compr_size;
+	return 0;
+}
+
+/*
+ * ssdfs_acomp_decompress() - decompress data by means of acomp driver
+ * @type: compression type
+ * @cdata_in: compressed data
+ * @data_out: uncompressed data [out]
+ * @srclen: size of compressed data in bytes
+ * @destlen: size of uncompressed data in bytes
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EOPNOTSUPP - decompression cannot be offloaded.
+ * %-EIO        - corrupted data.
+ */
+int ssdfs_acomp_decompress(int type, unsigned char *cdata_in,
+			   unsigned char *data_out,
+			   size_t srclen, size_t destlen)
+{
+	size_t uncompr_size = destlen;
+	int err;
+
+	err = ssdfs_acomp_process(type, false, cdata_in, srclen,
+				  data_out, &uncompr_size);
+	if (err == -EOPNOTSUPP || err == -ENOMEM)
+		return -EOPNOTSUPP;
+	else if (err || uncompr_size != destlen) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("fail to decompress: type %d, "
+			  "uncompr_size %zu, destlen %zu, err %d\n",
+			  type, uncompr_size, destlen, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return -EIO;
+	}
+
+	return 0;
+}
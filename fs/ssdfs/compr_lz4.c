@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * SSDFS -- SSD-oriented File System.
+ *
+ * fs/ssdfs/compr_lz4.c - LZ4 compression support.
+ *
+ * Copyright (c) 2023 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ * All rights reserved.
+ *
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/init.h>
+#include <linux/pagemap.h>
+#include <linux/lz4.h>
+#include <linux/pagevec.h>
+
+#include "peb_mapping_queue.h"
+#include "peb_mapping_table_cache.h"
+#include "ssdfs.h"
+#include "compression.h"
+
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+atomic64_t ssdfs_lz4_page_leaks;
+atomic64_t ssdfs_lz4_memory_leaks;
+atomic64_t ssdfs_lz4_cache_leaks;
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+
+/*
+ * void ssdfs_lz4_cache_leaks_increment(void *kaddr)
+ * void ssdfs_lz4_cache_leaks_decrement(void *kaddr)
+ * void *ssdfs_lz4_kmalloc(size_t size, gfp_t flags)
+ * void *ssdfs_lz4_kzalloc(size_t size, gfp_t flags)
+ * void *ssdfs_lz4_kcalloc(size_t n, size_t size, gfp_t flags)
+ * void ssdfs_lz4_kfree(void *kaddr)
+ * struct page *ssdfs_lz4_alloc_page(gfp_t gfp_mask)
+ * struct page *ssdfs_lz4_add_pagevec_page(struct pagevec *pvec)
+ * void ssdfs_lz4_free_page(struct page *page)
+ * void ssdfs_lz4_pagevec_release(struct pagevec *pvec)
+ */
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+	SSDFS_MEMORY_LEAKS_CHECKER_FNS(lz4)
+#else
+	SSDFS_MEMORY_ALLOCATOR_FNS(lz4)
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+
+void ssdfs_lz4_memory_leaks_init(void)
+{
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+	atomic64_set(&ssdfs_lz4_page_leaks, 0);
+	atomic64_set(&ssdfs_lz4_memory_leaks, 0);
+	atomic64_set(&ssdfs_lz4_cache_leaks, 0);
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+}
+
+void ssdfs_lz4_check_memory_leaks(void)
+{
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+	if (atomic64_read(&ssdfs_lz4_page_leaks) != 0) {
+		SSDFS_ERR("LZ4: "
+			  "memory leaks include %lld pages\n",
+			  atomic64_read(&ssdfs_lz4_page_leaks));
+	}
+
+	if (atomic64_read(&ssdfs_lz4_memory_leaks) != 0) {
+		SSDFS_ERR("LZ4: "
+			  "memory allocator suffers from %lld leaks\n",
+			  atomic64_read(&ssdfs_lz4_memory_leaks));
+	}
+
+	if (atomic64_read(&ssdfs_lz4_cache_leaks) != 0) {
+		SSDFS_ERR("LZ4: "
+			  "caches suffers from %lld leaks\n",
+			  atomic64_read(&ssdfs_lz4_cache_leaks));
+	}
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+}
+
+static int ssdfs_lz4_compress(struct list_head *ws_ptr,
+				unsigned char *data_in,
+				unsigned char *cdata_out,
+				size_t *srclen, size_t *destlen);
+
+static int ssdfs_lz4_decompress(struct list_head *ws_ptr,
+				 unsigned char *cdata_in,
+				 unsigned char *data_out,
+				 size_t srclen, size_t destlen);
+
+static struct list_head *ssdfs_lz4_alloc_workspace(void);
+static void ssdfs_lz4_free_workspace(struct list_head *ptr);
+
+static const struct ssdfs_compress_ops ssdfs_lz4_compress_ops = {
+	.alloc_workspace = ssdfs_lz4_alloc_workspace,
+	.free_workspace = ssdfs_lz4_free_workspace,
+	.compress = ssdfs_lz4_compress,
+	.decompress = ssdfs_lz4_decompress,
+};
+
+static struct ssdfs_compressor lz4_compr = {
+	.type = SSDFS_COMPR_LZ4,
+	.compr_ops = &ssdfs_lz4_compress_ops,
+	.name = "lz4",
+};
+
+struct ssdfs_lz4_workspace {
+	void *mem;
+	struct list_head list;
+};
+
+static void ssdfs_lz4_free_workspace(struct list_head *ptr)
+{
+	struct ssdfs_lz4_workspace *workspace;
+
+	workspace = list_entry(ptr, struct ssdfs_lz4_workspace, list);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("workspace %p\n", workspace);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	vfree(workspace->mem);
+	ssdfs_lz4_kfree(workspace);
+}
+
+static struct list_head *ssdfs_lz4_alloc_workspace(void)
+{
+	struct ssdfs_lz4_workspace *workspace;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("try to allocate workspace\n");
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	workspace = ssdfs_lz4_kzalloc(sizeof(*workspace), GFP_KERNEL);
+	if (unlikely(!workspace)) {
+		SSDFS_ERR("unable to allocate memory for workspace\n");
+		return ERR_PTR(-ENOMEM);
+	}
+
+	workspace->mem = vmalloc(LZ4_MEM_COMPRESS);
+	if (unlikely(!workspace->mem)) {
+		SSDFS_ERR("unable to allocate memory for workspace\n");
+		ssdfs_lz4_free_workspace(&workspace->list);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	INIT_LIST_HEAD(&workspace->list);
+
+	return &workspace->list;
+}
+
+int ssdfs_lz4_init(void)
+{
+	return ssdfs_register_compressor(&lz4_compr);
+}
+
+void ssdfs_lz4_exit(void)
+{
+	ssdfs_unregister_compressor(&lz4_compr);
+}
+
+static int ssdfs_lz4_compress(struct list_head *ws,
+				unsigned char *data_in,
+				unsigned char *cdata_out,
+				size_t *srclen, size_t *destlen)
+{
+	struct ssdfs_lz4_workspace *workspace;
+	int compress_size;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!ws || !data_in || !cdata_out || !srclen || !destlen);
+
+	SSDFS_DBG("ws_ptr %p, data_in %p, cdata_out %p, "
+		  "srclen %zu, destlen %zu\n",
+		  ws, data_in, cdata_out, *srclen, *destlen);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	workspace = list_entry(ws, struct ssdfs_lz4_workspace, list);
+
+	/* LZ4_compress_default() returns 0 if output doesn't fit */
+	compress_size = LZ4_compress_default(data_in, cdata_out,
+					     *srclen, *destlen,
+					     workspace->mem);
+	if (compress_size <= 0 || compress_size >= *srclen) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("unable to compress: srclen %zu, "
+			  "destlen %zu, compress_size %d\n",
+			  *srclen, *destlen, compress_size);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return -E2BIG;
+	}
+
+	*destlen = compress_size;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("compress has succeded: srclen %zu, destlen %zu\n",
+		    *srclen, *destlen);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return 0;
+}
+
+static int ssdfs_lz4_decompress(struct list_head *ws,
+				 unsigned char *cdata_in,
+				 unsigned char *data_out,
+				 size_t srclen, size_t destlen)
+{
+	int decompress_size;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!ws || !cdata_in || !data_out);
+
+	SSDFS_DBG("ws_ptr %p, cdata_in %p, data_out %p, "
+		  "srclen %zu, destlen %zu\n",
+		  ws, cdata_in, data_out, srclen, destlen);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	decompress_size = LZ4_decompress_safe(cdata_in, data_out,
+					      srclen, destlen);
+	if (decompress_size < 0 || decompress_size != destlen) {
+		SSDFS_ERR("decompression failed: LZ4 decompressor err %d, "
+			  "srclen %zu, destlen %zu\n",
+			  decompress_size, srclen, destlen);
+		return -EINVAL;
+	}
+
+	return 0;
+}
@@ -0,0 +1,305 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * SSDFS -- SSD-oriented File System.
+ *
+ * fs/ssdfs/compr_zstd.c - ZSTD compression support.
+ *
+ * Copyright (c) 2023 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ * All rights reserved.
+ *
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/init.h>
+#include <linux/pagemap.h>
+#include <linux/zstd.h>
+#include <linux/pagevec.h>
+
+#include "peb_mapping_queue.h"
+#include "peb_mapping_table_cache.h"
+#include "ssdfs.h"
+#include "compression.h"
+
+#define COMPR_LEVEL CONFIG_SSDFS_ZSTD_COMPR_LEVEL
+
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+atomic64_t ssdfs_zstd_page_leaks;
+atomic64_t ssdfs_zstd_memory_leaks;
+atomic64_t ssdfs_zstd_cache_leaks;
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+
+/*
+ * void ssdfs_zstd_cache_leaks_increment(void *kaddr)
+ * void ssdfs_zstd_cache_leaks_decrement(void *kaddr)
+ * void *ssdfs_zstd_kmalloc(size_t size, gfp_t flags)
+ * void *ssdfs_zstd_kzalloc(size_t size, gfp_t flags)
+ * void *ssdfs_zstd_kcalloc(size_t n, size_t size, gfp_t flags)
+ * void ssdfs_zstd_kfree(void *kaddr)
+ * struct page *ssdfs_zstd_alloc_page(gfp_t gfp_mask)
+ * struct page *ssdfs_zstd_add_pagevec_page(struct pagevec *pvec)
+ * void ssdfs_zstd_free_page(struct page *page)
+ * void ssdfs_zstd_pagevec_release(struct pagevec *pvec)
+ */
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+	SSDFS_MEMORY_LEAKS_CHECKER_FNS(zstd)
+#else
+	SSDFS_MEMORY_ALLOCATOR_FNS(zstd)
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+
+void ssdfs_zstd_memory_leaks_init(void)
+{
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+	atomic64_set(&ssdfs_zstd_page_leaks, 0);
+	atomic64_set(&ssdfs_zstd_memory_leaks, 0);
+	atomic64_set(&ssdfs_zstd_cache_leaks, 0);
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+}
+
+void ssdfs_zstd_check_memory_leaks(void)
+{
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+	if (atomic64_read(&ssdfs_zstd_page_leaks) != 0) {
+		SSDFS_ERR("ZSTD: "
+			  "memory leaks include %lld pages\n",
+			  atomic64_read(&ssdfs_zstd_page_leaks));
+	}
+
+	if (atomic64_read(&ssdfs_zstd_memory_leaks) != 0) {
+		SSDFS_ERR("ZSTD: "
+			  "memory allocator suffers from %lld leaks\n",
+			  atomic64_read(&ssdfs_zstd_memory_leaks));
+	}
+
+	if (atomic64_read(&ssdfs_zstd_cache_leaks) != 0) {
+		SSDFS_ERR("ZSTD: "
+			  "caches suffers from %lld leaks\n",
+			  atomic64_read(&ssdfs_zstd_cache_leaks));
+	}
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+}
+
+static int ssdfs_zstd_compress(struct list_head *ws_ptr,
+				unsigned char *data_in,
+				unsigned char *cdata_out,
+				size_t *srclen, size_t *destlen);
+
+static int ssdfs_zstd_decompress(struct list_head *ws_ptr,
+				 unsigned char *cdata_in,
+				 unsigned char *data_out,
+				 size_t srclen, size_t destlen);
+
+static struct list_head *ssdfs_zstd_alloc_workspace(void);
+static void ssdfs_zstd_free_workspace(struct list_head *ptr);
+
+static const struct ssdfs_compress_ops ssdfs_zstd_compress_ops = {
+	.alloc_workspace = ssdfs_zstd_alloc_workspace,
+	.free_workspace = ssdfs_zstd_free_workspace,
+	.compress = ssdfs_zstd_compress,
+	.decompress = ssdfs_zstd_decompress,
+};
+
+static struct ssdfs_compressor zstd_compr = {
+	.type = SSDFS_COMPR_ZSTD,
+	.compr_ops = &ssdfs_zstd_compress_ops,
+	.name = "zstd",
+};
+
+/*
+ * struct ssdfs_zstd_workspace - ZSTD workspace
+ * @params: compression parameters
+ * @cctx_mem: memory of compression context
+ * @cctx_size: size of compression context's memory
+ * @dctx_mem: memory of decompression context
+ * @dctx_size: size of decompression context's memory
+ * @list: workspaces list
+ *
+ * SSDFS compresses not more than one memory page by one call.
+ * So, the compression parameters are estimated for PAGE_SIZE
+ * that keeps the workspace small even for high levels.
+ */
+struct ssdfs_zstd_workspace {
+	zstd_parameters params;
+	void *cctx_mem;
+	size_t cctx_size;
+	void *dctx_mem;
+	size_t dctx_size;
+	struct list_head list;
+};
+
+static void ssdfs_zstd_free_workspace(struct list_head *ptr)
+{
+	struct ssdfs_zstd_workspace *workspace;
+
+	workspace = list_entry(ptr, struct ssdfs_zstd_workspace, list);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("workspace %p\n", workspace);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	vfree(workspace->dctx_mem);
+	vfree(workspace->cctx_mem);
+	ssdfs_zstd_kfree(workspace);
+}
+
+static struct list_head *ssdfs_zstd_alloc_workspace(void)
+{
+	struct ssdfs_zstd_workspace *workspace;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("try to allocate workspace\n");
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	workspace = ssdfs_zstd_kzalloc(sizeof(*workspace), GFP_KERNEL);
+	if (unlikely(!workspace)) {
+		SSDFS_ERR("unable to allocate memory for workspace\n");
+		return ERR_PTR(-ENOMEM);
+	}
+
+	workspace->params = zstd_get_params(COMPR_LEVEL, PAGE_SIZE);
+
+	workspace->cctx_size =
+		zstd_cctx_workspace_bound(&workspace->params.cParams);
+	workspace->cctx_mem = vmalloc(workspace->cctx_size);
+	if (unlikely(!workspace->cctx_mem)) {
+		SSDFS_ERR("unable to allocate memory for compression\n");
+		goto failed_alloc_workspaces;
+	}
+
+	workspace->dctx_size = zstd_dctx_workspace_bound();
+	workspace->dctx_mem = vmalloc(workspace->dctx_size);
+	if (unlikely(!workspace->dctx_mem)) {
+		SSDFS_ERR("unable to allocate memory for decompression\n");
+		goto failed_alloc_workspaces;
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("cctx_size %zu, dctx_size %zu\n",
+		  workspace->cctx_size, workspace->dctx_size);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	INIT_LIST_HEAD(&workspace->list);
+
+	return &workspace->list;
+
+failed_alloc_workspaces:
+	ssdfs_zstd_free_workspace(&workspace->list);
+	return ERR_PTR(-ENOMEM);
+}
+
+int ssdfs_zstd_init(void)
+{
+	return ssdfs_register_compressor(&zstd_compr);
+}
+
+void ssdfs_zstd_exit(void)
+{
+	ssdfs_unregister_compressor(&zstd_compr);
+}
+
+static int ssdfs_zstd_compress(struct list_head *ws,
+				unsigned char *data_in,
+				unsigned char *cdata_out,
+				size_t *srclen, size_t *destlen)
+{
+	struct ssdfs_zstd_workspace *workspace;
+	zstd_cctx *cctx;
+	size_t compress_size;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!ws || !data_in || !cdata_out || !srclen || !destlen);
+
+	SSDFS_DBG("ws_ptr %p, data_in %p, cdata_out %p, "
+		  "srclen %zu, destlen %zu\n",
+		  ws, data_in, cdata_out, *srclen, *destlen);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	workspace = list_entry(ws, struct ssdfs_zstd_workspace, list);
+
+	cctx = zstd_init_cctx(workspace->cctx_mem, workspace->cctx_size);
+	if (!cctx) {
+		SSDFS_ERR("fail to init ZSTD compression context\n");
+		return -EINVAL;
+	}
+
+	compress_size = zstd_compress_cctx(cctx, cdata_out, *destlen,
+					   data_in, *srclen,
+					   &workspace->params);
+	if (zstd_is_error(compress_size)) {
+		if (zstd_get_error_code(compress_size) ==
+						ZSTD_error_dstSize_tooSmall) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("unable to compress: "
+				  "srclen %zu, destlen %zu\n",
+				  *srclen, *destlen);
+#endif /* CONFIG_SSDFS_DEBUG */
+			return -E2BIG;
+		}
+
+		SSDFS_ERR("ZSTD compression failed: internal err %d, "
+			  "srclen %zu, destlen %zu\n",
+			  zstd_get_error_code(compress_size),
+			  *srclen, *destlen);
+		return -EINVAL;
+	}
+
+	if (compress_size >= *srclen) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("unable to compress: srclen %zu, "
+			  "compress_size %zu\n",
+			  *srclen, compress_size);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return -E2BIG;
+	}
+
+	*destlen = compress_size;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("compress has succeded: srclen %zu, destlen %zu\n",
+		    *srclen, *destlen);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return 0;
+}
+
+static int ssdfs_zstd_decompress(struct list_head *ws,
+				 unsigned char *cdata_in,
+				 unsigned char *data_out,
+				 size_t srclen, size_t destlen)
+{
+	struct ssdfs_zstd_workspace *workspace;
+	zstd_dctx *dctx;
+	size_t decompress_size;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!ws || !cdata_in || !data_out);
+
+	SSDFS_DBG("ws_ptr %p, cdata_in %p, data_out %p, "
+		  "srclen %zu, destlen %zu\n",
+		  ws, cdata_in, data_out, srclen, destlen);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	workspace = list_entry(ws, struct ssdfs_zstd_workspace, list);
+
+	dctx = zstd_init_dctx(workspace->dctx_mem, workspace->dctx_size);
+	if (!dctx) {
+		SSDFS_ERR("fail to init ZSTD decompression context\n");
+		return -EINVAL;
+	}
+
+	decompress_size = zstd_decompress_dctx(dctx, data_out, destlen,
+					       cdata_in, srclen);
+	if (zstd_is_error(decompress_size) || decompress_size != destlen) {
+		SSDFS_ERR("decompression failed: ZSTD decompressor err %d, "
+			  "srclen %zu, destlen %zu\n",
+			  zstd_is_error(decompress_size) ?
+				zstd_get_error_code(decompress_size) : 0,
+			  srclen, destlen);
+		return -EINVAL;
+	}
+
+	return 0;
+}
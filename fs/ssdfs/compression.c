@@ -19,6 +19,10 @@
 #include <linux/rwsem.h>
 #include <linux/zlib.h>
 #include <linux/pagevec.h>
+#include <linux/workqueue.h>
+#include <linux/percpu.h>
+#include <linux/sort.h>
+#include <linux/log2.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -89,6 +93,25 @@ static spinlock_t compr_workspace_lock[SSDFS_COMPR_TYPES_CNT];
 static int compr_num_workspace[SSDFS_COMPR_TYPES_CNT];
 static atomic_t compr_alloc_workspace[SSDFS_COMPR_TYPES_CNT];
 static wait_queue_head_t compr_workspace_wait[SSDFS_COMPR_TYPES_CNT];
+static atomic64_t compr_workspace_waits[SSDFS_COMPR_TYPES_CNT];
+
+/*
+ * struct ssdfs_compr_percpu_ws - per-CPU cache of compression workspaces
+ * @lock: cache's lock
+ * @ws: cached workspace of every compression type
+ *
+ * Every CPU keeps one idle workspace of every compression type.
+ * The workspace of the current CPU is taken and returned without
+ * touching the global idle list and its lock. The global idle list
+ * is used as overflow storage only. The @lock is taken by the owner
+ * CPU and by the workspaces draining logic only.
+ */
+struct ssdfs_compr_percpu_ws {
+	spinlock_t lock;
+	struct list_head *ws[SSDFS_COMPR_TYPES_CNT];
+};
+
+static DEFINE_PER_CPU(struct ssdfs_compr_percpu_ws, ssdfs_compr_percpu_ws);
 
 static inline bool unable_compress(int type)
 {
@@ -184,8 +207,12 @@ int ssdfs_unregister_compressor(struct ssdfs_compressor *compr)
 	return 0;
 }
 
+/* workqueue of deferred metadata compression */
+static struct workqueue_struct *ssdfs_compr_wq;
+
 int ssdfs_compressors_init(void)
 {
+	int cpu;
 	int i;
 	int err;
 
@@ -198,6 +225,15 @@ int ssdfs_compressors_init(void)
 		spin_lock_init(&compr_workspace_lock[i]);
 		atomic_set(&compr_alloc_workspace[i], 0);
 		init_waitqueue_head(&compr_workspace_wait[i]);
+		atomic64_set(&compr_workspace_waits[i], 0);
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct ssdfs_compr_percpu_ws *pcp;
+
+		pcp = per_cpu_ptr(&ssdfs_compr_percpu_ws, cpu);
+		spin_lock_init(&pcp->lock);
+		memset(pcp->ws, 0, sizeof(pcp->ws));
 	}
 
 	err = ssdfs_zlib_init();
@@ -208,12 +244,44 @@ int ssdfs_compressors_init(void)
 	if (err)
 		goto zlib_exit;
 
-	err = ssdfs_register_compressor(&ssdfs_none_compr);
+	err = ssdfs_zstd_init();
 	if (err)
 		goto lzo_exit;
 
+	err = ssdfs_lz4_init();
+	if (err)
+		goto zstd_exit;
+
+	err = ssdfs_register_compressor(&ssdfs_none_compr);
+	if (err)
+		goto lz4_exit;
+
+	err = ssdfs_acomp_init();
+	if (err)
+		goto unregister_none_compr;
+
+	ssdfs_compr_wq = alloc_workqueue("ssdfs-compr",
+					 WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!ssdfs_compr_wq) {
+		err = -ENOMEM;
+		SSDFS_ERR("fail to create compression workqueue\n");
+		goto acomp_exit;
+	}
+
 	return 0;
 
+acomp_exit:
+	ssdfs_acomp_exit();
+
+unregister_none_compr:
+	ssdfs_unregister_compressor(&ssdfs_none_compr);
+
+lz4_exit:
+	ssdfs_lz4_exit();
+
+zstd_exit:
+	ssdfs_zstd_exit();
+
 lzo_exit:
 	ssdfs_lzo_exit();
 
@@ -228,6 +296,7 @@ void ssdfs_free_workspaces(void)
 {
 	struct list_head *workspace;
 	const struct ssdfs_compress_ops *ops;
+	int cpu;
 	int i;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -243,6 +312,24 @@ void ssdfs_free_workspaces(void)
 		BUG_ON(!ops);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+		for_each_possible_cpu(cpu) {
+			struct ssdfs_compr_percpu_ws *pcp;
+
+			pcp = per_cpu_ptr(&ssdfs_compr_percpu_ws, cpu);
+
+			spin_lock(&pcp->lock);
+			workspace = pcp->ws[i];
+			pcp->ws[i] = NULL;
+			spin_unlock(&pcp->lock);
+
+			if (!workspace)
+				continue;
+
+			if (ops->free_workspace)
+				ops->free_workspace(workspace);
+			atomic_dec(&compr_alloc_workspace[i]);
+		}
+
 		while (!list_empty(&compr_idle_workspace[i])) {
 			workspace = compr_idle_workspace[i].next;
 			list_del(workspace);
@@ -259,14 +346,94 @@ void ssdfs_compressors_exit(void)
 	SSDFS_DBG("deinitialize compressors subsystem\n");
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	if (ssdfs_compr_wq) {
+		destroy_workqueue(ssdfs_compr_wq);
+		ssdfs_compr_wq = NULL;
+	}
+
 	ssdfs_free_workspaces();
+	ssdfs_acomp_exit();
 	ssdfs_unregister_compressor(&ssdfs_none_compr);
 	ssdfs_zlib_exit();
 	ssdfs_lzo_exit();
+	ssdfs_zstd_exit();
+	ssdfs_lz4_exit();
+}
+
+/*
+ * ssdfs_queue_compression_work() - queue deferred compression
+ * @work: work item of compression
+ *
+ * This function queues the compression into the workqueue
+ * of deferred metadata compression.
+ */
+void ssdfs_queue_compression_work(struct work_struct *work)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!work || !ssdfs_compr_wq);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	queue_work(ssdfs_compr_wq, work);
+}
+
+/*
+ * ssdfs_percpu_workspace_get() - take workspace of the current CPU
+ * @type: compression type
+ *
+ * This function takes the cached workspace of the current CPU.
+ * Preemption is disabled for the exchange of the pointer only
+ * because compression itself can sleep.
+ *
+ * RETURN:
+ * [success] - pointer on workspace.
+ * [failure] - NULL (CPU has no cached workspace).
+ */
+static inline
+struct list_head *ssdfs_percpu_workspace_get(int type)
+{
+	struct ssdfs_compr_percpu_ws *pcp;
+	struct list_head *workspace;
+
+	pcp = get_cpu_ptr(&ssdfs_compr_percpu_ws);
+	spin_lock(&pcp->lock);
+	workspace = pcp->ws[type];
+	pcp->ws[type] = NULL;
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(&ssdfs_compr_percpu_ws);
+
+	return workspace;
+}
+
+/*
+ * ssdfs_percpu_workspace_put() - cache workspace on the current CPU
+ * @type: compression type
+ * @workspace: workspace
+ *
+ * RETURN:
+ * [true]  - workspace has been cached on the current CPU.
+ * [false] - the current CPU has cached workspace already.
+ */
+static inline
+bool ssdfs_percpu_workspace_put(int type, struct list_head *workspace)
+{
+	struct ssdfs_compr_percpu_ws *pcp;
+	bool is_cached = false;
+
+	pcp = get_cpu_ptr(&ssdfs_compr_percpu_ws);
+	spin_lock(&pcp->lock);
+	if (!pcp->ws[type]) {
+		pcp->ws[type] = workspace;
+		is_cached = true;
+	}
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(&ssdfs_compr_percpu_ws);
+
+	return is_cached;
 }
 
 /*
  * Find an available workspace or allocate a new one.
+ * The workspace of the current CPU is tried at first.
  * ERR_PTR is returned in the case of error.
  */
 static struct list_head *ssdfs_find_workspace(int type)
@@ -301,6 +468,10 @@ static struct list_head *ssdfs_find_workspace(int type)
 	workspace_wait = &compr_workspace_wait[type];
 	num_workspace = &compr_num_workspace[type];
 
+	workspace = ssdfs_percpu_workspace_get(type);
+	if (workspace)
+		return workspace;
+
 again:
 	spin_lock(workspace_lock);
 
@@ -316,6 +487,7 @@ again:
 		DEFINE_WAIT(wait);
 
 		spin_unlock(workspace_lock);
+		atomic64_inc(&compr_workspace_waits[type]);
 		prepare_to_wait(workspace_wait, &wait, TASK_UNINTERRUPTIBLE);
 		if (atomic_read(alloc_workspace) > cpus && !*num_workspace)
 			schedule();
@@ -334,6 +506,22 @@ again:
 	return workspace;
 }
 
+/*
+ * ssdfs_compr_workspace_waits() - get number of waits for free workspace
+ * @type: compression type
+ *
+ * The counter is incremented every time when the workspaces of
+ * compression type are exhausted and a caller has to wait. It shows
+ * the contention among the compressing threads.
+ */
+u64 ssdfs_compr_workspace_waits(int type)
+{
+	if (unknown_compression(type))
+		return 0;
+
+	return atomic64_read(&compr_workspace_waits[type]);
+}
+
 static void ssdfs_free_workspace(int type, struct list_head *workspace)
 {
 	struct list_head *idle_workspace;
@@ -363,6 +551,9 @@ static void ssdfs_free_workspace(int type, struct list_head *workspace)
 	workspace_wait = &compr_workspace_wait[type];
 	num_workspace = &compr_num_workspace[type];
 
+	if (ssdfs_percpu_workspace_put(type, workspace))
+		goto wake;
+
 	spin_lock(workspace_lock);
 	if (*num_workspace < num_online_cpus()) {
 		list_add_tail(workspace, idle_workspace);
@@ -381,14 +572,124 @@ wake:
 }
 
 #define SSDFS_DICT_SIZE			256
-#define SSDFS_MIN_MAX_DIFF_THRESHOLD	150
+#define SSDFS_SAMPLE_SIZE		16
+#define SSDFS_SAMPLE_DISTANCE		256
+#define SSDFS_BYTE_SET_THRESHOLD	64
+#define SSDFS_BYTE_CORE_SET_LOW		64
+#define SSDFS_BYTE_CORE_SET_HIGH	200
+#define SSDFS_CORE_SET_COVERAGE_PCT	90
+#define SSDFS_ENTROPY_LOW_PCT		65
+#define SSDFS_ENTROPY_HIGH_PCT		80
+
+/*
+ * ssdfs_ilog2_w() - integer binary logarithm of the fourth power
+ * @n: value
+ *
+ * The fourth power keeps two more bits of precision of the logarithm.
+ */
+static inline
+u32 ssdfs_ilog2_w(u64 n)
+{
+	return ilog2(n * n * n * n);
+}
+
+/*
+ * ssdfs_sample_entropy() - estimate Shannon entropy of the sample
+ * @counts: histogram of bytes in the sample
+ * @sample_size: size of the sample in bytes
+ *
+ * RETURN: entropy in percents of the maximal entropy (8 bits per byte).
+ */
+static
+u32 ssdfs_sample_entropy(u32 *counts, u32 sample_size)
+{
+	const u32 entropy_max = 8 * ssdfs_ilog2_w(2);
+	u32 sz_base = ssdfs_ilog2_w(sample_size);
+	u64 entropy_sum = 0;
+	int i;
+
+	for (i = 0; i < SSDFS_DICT_SIZE; i++) {
+		if (counts[i] == 0)
+			continue;
+
+		entropy_sum += (u64)counts[i] *
+				(sz_base - ssdfs_ilog2_w(counts[i]));
+	}
+
+	entropy_sum = div_u64(entropy_sum, sample_size);
+
+	return div_u64(entropy_sum * 100, entropy_max);
+}
+
+/*
+ * ssdfs_cmp_counts_desc() - compare histogram's counters (descending order)
+ */
+static int ssdfs_cmp_counts_desc(const void *a, const void *b)
+{
+	u32 count1 = *(const u32 *)a;
+	u32 count2 = *(const u32 *)b;
+
+	if (count1 < count2)
+		return 1;
+	else if (count1 > count2)
+		return -1;
+	return 0;
+}
+
+/*
+ * ssdfs_byte_core_set_size() - define size of the core set of bytes
+ * @counts: histogram of bytes in the sample (it will be sorted)
+ * @sample_size: size of the sample in bytes
+ *
+ * The core set is the minimal set of the most frequent bytes
+ * that covers SSDFS_CORE_SET_COVERAGE_PCT of the sample.
+ */
+static
+u32 ssdfs_byte_core_set_size(u32 *counts, u32 sample_size)
+{
+	u32 threshold = (sample_size * SSDFS_CORE_SET_COVERAGE_PCT) / 100;
+	u32 coreset_sum = 0;
+	u32 i;
+
+	sort(counts, SSDFS_DICT_SIZE, sizeof(u32),
+	     ssdfs_cmp_counts_desc, NULL);
+
+	for (i = 0; i < SSDFS_DICT_SIZE; i++) {
+		coreset_sum += counts[i];
+		if (coreset_sum > threshold)
+			return i + 1;
+	}
+
+	return SSDFS_DICT_SIZE;
+}
 
+/*
+ * ssdfs_can_compress_data() - estimate compressibility of data
+ * @page: memory page with data
+ * @data_size: size of data in bytes
+ *
+ * This function samples SSDFS_SAMPLE_SIZE bytes every
+ * SSDFS_SAMPLE_DISTANCE bytes of the data and checks the histogram
+ * of the sample: (1) number of distinct bytes, (2) Shannon entropy,
+ * (3) size of the core set of the most frequent bytes. It costs
+ * a small fraction of the compression attempt and it excludes
+ * the attempts to compress the incompressible data (media
+ * files, encrypted or already compressed data).
+ *
+ * RETURN:
+ * [true]  - data is likely to be compressed.
+ * [false] - data looks like incompressible.
+ */
 bool ssdfs_can_compress_data(struct page *page,
 			     unsigned data_size)
 {
-	unsigned *counts;
-	unsigned found_symbols = 0;
-	unsigned min, max;
+	u32 *counts;
+	u32 sample_size = 0;
+	u32 found_symbols = 0;
+	u32 entropy;
+	u32 core_set;
+	u32 offset, len;
+	bool can_compress;
 	u8 *kaddr;
 	int i;
 
@@ -401,37 +702,61 @@ bool ssdfs_can_compress_data(struct page *page,
 		return false;
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	counts = ssdfs_compr_kzalloc(sizeof(unsigned) * SSDFS_DICT_SIZE,
+	counts = ssdfs_compr_kzalloc(sizeof(u32) * SSDFS_DICT_SIZE,
 				     GFP_KERNEL);
 	if (!counts) {
 		SSDFS_WARN("fail to alloc array\n");
 		return true;
 	}
 
-	min = SSDFS_DICT_SIZE;
-	max = 0;
-
 	kaddr = (u8 *)kmap_local_page(page);
-	for (i = 0; i < data_size; i++) {
-		u8 *value = kaddr + i;
-		counts[*value]++;
-		if (counts[*value] == 1)
-			found_symbols++;
-		if (counts[*value] < min)
-			min = counts[*value];
-		if (counts[*value] > max)
-			max = counts[*value];
+	for (offset = 0; offset < data_size; offset += SSDFS_SAMPLE_DISTANCE) {
+		len = min_t(u32, SSDFS_SAMPLE_SIZE, data_size - offset);
+
+		for (i = 0; i < len; i++) {
+			u8 value = *(kaddr + offset + i);
+
+			if (counts[value]++ == 0)
+				found_symbols++;
+		}
+
+		sample_size += len;
 	}
 	kunmap_local(kaddr);
 
+	if (found_symbols < SSDFS_BYTE_SET_THRESHOLD) {
+		can_compress = true;
+		entropy = 0;
+		core_set = found_symbols;
+		goto finish_check;
+	}
+
+	entropy = ssdfs_sample_entropy(counts, sample_size);
+	if (entropy < SSDFS_ENTROPY_LOW_PCT) {
+		can_compress = true;
+		core_set = found_symbols;
+		goto finish_check;
+	}
+
+	core_set = ssdfs_byte_core_set_size(counts, sample_size);
+	if (core_set <= SSDFS_BYTE_CORE_SET_LOW)
+		can_compress = true;
+	else if (core_set >= SSDFS_BYTE_CORE_SET_HIGH)
+		can_compress = false;
+	else
+		can_compress = entropy < SSDFS_ENTROPY_HIGH_PCT;
+
+finish_check:
 	ssdfs_compr_kfree(counts);
 
 #ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("data_size %u, found_symbols %u, min %u, max %u\n",
-		  data_size, found_symbols, min, max);
+	SSDFS_DBG("data_size %u, sample_size %u, found_symbols %u, "
+		  "entropy %u, core_set %u, can_compress %#x\n",
+		  data_size, sample_size, found_symbols,
+		  entropy, core_set, can_compress);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	return (max - min) >= SSDFS_MIN_MAX_DIFF_THRESHOLD;
+	return can_compress;
 }
 
 int ssdfs_compress(int type, unsigned char *data_in, unsigned char *cdata_out,
@@ -458,6 +783,10 @@ int ssdfs_compress(int type, unsigned char *data_in, unsigned char *cdata_out,
 		goto failed_compress;
 	}
 
+	err = ssdfs_acomp_compress(type, data_in, cdata_out, srclen, destlen);
+	if (err != -EOPNOTSUPP)
+		goto finish_compress;
+
 	workspace = ssdfs_find_workspace(type);
 	if (PTR_ERR(workspace) == -EOPNOTSUPP &&
 	    ssdfs_compressors[type]->type == SSDFS_COMPR_NONE) {
@@ -474,6 +803,8 @@ int ssdfs_compress(int type, unsigned char *data_in, unsigned char *cdata_out,
 	err = ops->compress(workspace, data_in, cdata_out, srclen, destlen);
 
 	ssdfs_free_workspace(type, workspace);
+
+finish_compress:
 	if (err == -E2BIG) {
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("%s compressor is unable to compress data %p "
@@ -520,6 +851,12 @@ int ssdfs_decompress(int type, unsigned char *cdata_in, unsigned char *data_out,
 		goto failed_decompress;
 	}
 
+	/* fall back to software decompression in the case of any error */
+	err = ssdfs_acomp_decompress(type, cdata_in, data_out,
+				     srclen, destlen);
+	if (!err)
+		return 0;
+
 	workspace = ssdfs_find_workspace(type);
 	if (PTR_ERR(workspace) == -EOPNOTSUPP &&
 	    ssdfs_compressors[type]->type == SSDFS_COMPR_NONE) {
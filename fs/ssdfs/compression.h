@@ -28,12 +28,16 @@
  * SSDFS_COMPR_NONE: no compression
  * SSDFS_COMPR_ZLIB: ZLIB compression
  * SSDFS_COMPR_LZO: LZO compression
+ * SSDFS_COMPR_ZSTD: ZSTD compression
+ * SSDFS_COMPR_LZ4: LZ4 compression
  * SSDFS_COMPR_TYPES_CNT: count of supported compression types
  */
 enum {
 	SSDFS_COMPR_NONE,
 	SSDFS_COMPR_ZLIB,
 	SSDFS_COMPR_LZO,
+	SSDFS_COMPR_ZSTD,
+	SSDFS_COMPR_LZ4,
 	SSDFS_COMPR_TYPES_CNT,
 };
 
@@ -71,6 +75,12 @@ struct ssdfs_compressor {
 	const struct ssdfs_compress_ops *compr_ops;
 };
 
+/*
+ * Number of write requests of an inode that skip the compressibility
+ * check after the inode's data has been found incompressible.
+ */
+#define SSDFS_INCOMPRESSIBLE_BACKOFF	(16)
+
 /* Available SSDFS compressors */
 extern struct ssdfs_compressor *ssdfs_compressors[SSDFS_COMPR_TYPES_CNT];
 
@@ -82,6 +92,8 @@ int ssdfs_compress(int type, unsigned char *data_in, unsigned char *cdata_out,
 		    size_t *srclen, size_t *destlen);
 int ssdfs_decompress(int type, unsigned char *cdata_in, unsigned char *data_out,
 			size_t srclen, size_t destlen);
+u64 ssdfs_compr_workspace_waits(int type);
+void ssdfs_queue_compression_work(struct work_struct *work);
 
 #ifdef CONFIG_SSDFS_ZLIB
 /* compr_zlib.c */
@@ -101,4 +113,51 @@ static inline int ssdfs_lzo_init(void) { return 0; }
 static inline void ssdfs_lzo_exit(void) { return; }
 #endif /* CONFIG_SSDFS_LZO */
 
+#ifdef CONFIG_SSDFS_ZSTD
+/* compr_zstd.c */
+int ssdfs_zstd_init(void);
+void ssdfs_zstd_exit(void);
+#else
+static inline int ssdfs_zstd_init(void) { return 0; }
+static inline void ssdfs_zstd_exit(void) { return; }
+#endif /* CONFIG_SSDFS_ZSTD */
+
+#ifdef CONFIG_SSDFS_LZ4
+/* compr_lz4.c */
+int ssdfs_lz4_init(void);
+void ssdfs_lz4_exit(void);
+#else
+static inline int ssdfs_lz4_init(void) { return 0; }
+static inline void ssdfs_lz4_exit(void) { return; }
+#endif /* CONFIG_SSDFS_LZ4 */
+
+#ifdef CONFIG_SSDFS_ACOMP
+/* compr_acomp.c */
+int ssdfs_acomp_init(void);
+void ssdfs_acomp_exit(void);
+int ssdfs_acomp_compress(int type, unsigned char *data_in,
+			 unsigned char *cdata_out,
+			 size_t *srclen, size_t *destlen);
+int ssdfs_acomp_decompress(int type, unsigned char *cdata_in,
+			   unsigned char *data_out,
+			   size_t srclen, size_t destlen);
+#else
+static inline int ssdfs_acomp_init(void) { return 0; }
+static inline void ssdfs_acomp_exit(void) { return; }
+static inline
+int ssdfs_acomp_compress(int type, unsigned char *data_in,
+			 unsigned char *cdata_out,
+			 size_t *srclen, size_t *destlen)
+{
+	return -EOPNOTSUPP;
+}
+static inline
+int ssdfs_acomp_decompress(int type, unsigned char *cdata_in,
+			   unsigned char *data_out,
+			   size_t srclen, size_t destlen)
+{
+	return -EOPNOTSUPP;
+}
+#endif /* CONFIG_SSDFS_ACOMP */
+
 #endif /* _SSDFS_COMPRESSION_H */
@@ -340,6 +340,7 @@ int ssdfs_segment_select_flush_threads(struct ssdfs_segment_info *si,
  * [failure] - error code:
  *
  * %-EINVAL     - invalid input.
+ * %-EBUSY      - segment is current for another container already.
  */
 int ssdfs_current_segment_add(struct ssdfs_current_segment *cur_seg,
 			      struct ssdfs_segment_info *si)
@@ -425,7 +426,14 @@ int ssdfs_current_segment_add(struct ssdfs_current_segment *cur_seg,
 	state = atomic_cmpxchg(&si->obj_state,
 				SSDFS_SEG_OBJECT_CREATED,
 				SSDFS_CURRENT_SEG_OBJECT);
-	if (state < SSDFS_SEG_OBJECT_CREATED ||
+	if (state == SSDFS_CURRENT_SEG_OBJECT) {
+		ssdfs_segment_put_object(si);
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("segment %llu is current already\n",
+			  si->seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return -EBUSY;
+	} else if (state < SSDFS_SEG_OBJECT_CREATED ||
 	    state >= SSDFS_CURRENT_SEG_OBJECT) {
 		ssdfs_segment_put_object(si);
 		SSDFS_WARN("unexpected state %#x\n",
@@ -476,6 +484,9 @@ void ssdfs_current_segment_remove(struct ssdfs_current_segment *cur_seg)
 			   state);
 	}
 
+	/* flush threads commit the log of non-current segment */
+	wake_up_all(&cur_seg->real_seg->wait_queue[SSDFS_PEB_FLUSH_THREAD]);
+
 	ssdfs_segment_put_object(cur_seg->real_seg);
 	cur_seg->real_seg = NULL;
 }
@@ -484,6 +495,157 @@ void ssdfs_current_segment_remove(struct ssdfs_current_segment *cur_seg)
  *                 CURRENT SEGMENTS ARRAY FUNCTIONALITY                       *
  ******************************************************************************/
 
+/*
+ * ssdfs_current_segment_create_percpu_data_segs() - create per-CPU data segs
+ * @fsi: pointer on shared file system object
+ *
+ * This function creates the per-CPU current user data segments
+ * if such mode has been requested by mount option. The shared
+ * SSDFS_CUR_DATA_SEG object is used as the first item of the array.
+ * The rest of items are empty and they will receive a segment
+ * on the first write request from the CPU.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - unable to allocate memory.
+ */
+static
+int ssdfs_current_segment_create_percpu_data_segs(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_current_segs_array *array = fsi->cur_segs;
+	struct ssdfs_current_segment *shared;
+	u32 count;
+	u32 i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!array);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	array->data_segs_count = 0;
+	array->data_segs = NULL;
+	array->data_segs_buf = NULL;
+
+	if (!ssdfs_test_opt(fsi->mount_opts, PERCPU_CUR_SEGS))
+		return 0;
+
+	if (fsi->is_zns_device) {
+		/*
+		 * Every current segment keeps opened zones.
+		 * Open zones limitation makes per-CPU mode
+		 * impossible for the ZNS case.
+		 */
+		SSDFS_NOTICE("per-CPU current segments are "
+			     "not supported for ZNS device\n");
+		ssdfs_clear_opt(fsi->mount_opts, PERCPU_CUR_SEGS);
+		return 0;
+	}
+
+	count = min_t(u32, nr_cpu_ids, SSDFS_PERCPU_CUR_DATA_SEGS_MAX);
+	if (count <= 1)
+		return 0;
+
+	array->data_segs =
+		ssdfs_cur_seg_kcalloc(count,
+				sizeof(struct ssdfs_current_segment *),
+				GFP_KERNEL);
+	if (!array->data_segs) {
+		SSDFS_ERR("fail to allocate per-CPU data segments array\n");
+		return -ENOMEM;
+	}
+
+	array->data_segs_buf =
+		ssdfs_cur_seg_kcalloc(count - 1,
+				sizeof(struct ssdfs_current_segment),
+				GFP_KERNEL);
+	if (!array->data_segs_buf) {
+		ssdfs_cur_seg_kfree(array->data_segs);
+		array->data_segs = NULL;
+		SSDFS_ERR("fail to allocate per-CPU data segments buffer\n");
+		return -ENOMEM;
+	}
+
+	shared = array->objects[SSDFS_CUR_DATA_SEG];
+	array->data_segs[0] = shared;
+
+	for (i = 1; i < count; i++) {
+		struct ssdfs_current_segment *object;
+
+		object = &array->data_segs_buf[i - 1];
+		ssdfs_current_segment_init(fsi, SSDFS_CUR_DATA_SEG,
+					   shared->seg_id, object);
+		array->data_segs[i] = object;
+	}
+
+	array->data_segs_count = count;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("per-CPU current data segments count %u\n", count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return 0;
+}
+
+/*
+ * ssdfs_current_segment_create_data_streams() - create data streams
+ * @fsi: pointer on shared file system object
+ *
+ * This function creates the current segments of hot and cold
+ * user data streams if such mode has been requested by mount
+ * option. The segments are empty and they will receive a segment
+ * on the first write request of the stream.
+ */
+static
+void ssdfs_current_segment_create_data_streams(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_current_segs_array *array = fsi->cur_segs;
+	struct ssdfs_current_segment *shared;
+	int i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!array);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	for (i = 0; i < SSDFS_DATA_STREAMS_MAX; i++)
+		array->streams[i] = NULL;
+
+	if (!ssdfs_test_opt(fsi->mount_opts, DATA_TEMP_STREAMS))
+		return;
+
+	if (fsi->is_zns_device) {
+		/*
+		 * Every current segment keeps opened zones.
+		 * Open zones limitation makes data streams
+		 * impossible for the ZNS case.
+		 */
+		SSDFS_NOTICE("data temperature streams are "
+			     "not supported for ZNS device\n");
+		ssdfs_clear_opt(fsi->mount_opts, DATA_TEMP_STREAMS);
+		return;
+	}
+
+	shared = array->objects[SSDFS_CUR_DATA_SEG];
+
+	for (i = SSDFS_HOT_DATA_STREAM; i < SSDFS_DATA_STREAMS_MAX; i++) {
+		struct ssdfs_current_segment *object;
+		size_t offset;
+
+		offset = (i - SSDFS_HOT_DATA_STREAM) *
+				sizeof(struct ssdfs_current_segment);
+
+		object = (struct ssdfs_current_segment *)(array->streams_buf +
+								offset);
+		ssdfs_current_segment_init(fsi, SSDFS_CUR_DATA_SEG,
+					   shared->seg_id, object);
+		array->streams[i] = object;
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("data temperature streams are created\n");
+#endif /* CONFIG_SSDFS_DEBUG */
+}
+
 /*
  * ssdfs_current_segment_array_create() - create current segments array
  * @fsi: pointer on shared file system object
@@ -609,6 +771,16 @@ int ssdfs_current_segment_array_create(struct ssdfs_fs_info *fsi)
 		}
 	}
 
+	err = ssdfs_current_segment_create_percpu_data_segs(fsi);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to create per-CPU data segments: "
+			  "err %d\n", err);
+		i = SSDFS_CUR_SEGS_COUNT - 1;
+		goto destroy_cur_segs;
+	}
+
+	ssdfs_current_segment_create_data_streams(fsi);
+
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("DONE: create current segment array\n");
 #endif /* CONFIG_SSDFS_DEBUG */
@@ -653,9 +825,15 @@ void ssdfs_destroy_all_curent_segments(struct ssdfs_fs_info *fsi)
 	BUG_ON(rwsem_is_locked(&fsi->cur_segs->lock));
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&fsi->cur_segs->lock);
+	SSDFS_DOWN_WRITE(cur_segs, &fsi->cur_segs->lock);
 	for (i = 0; i < SSDFS_CUR_SEGS_COUNT; i++)
 		ssdfs_current_segment_destroy(fsi->cur_segs->objects[i]);
+	/* the first item is SSDFS_CUR_DATA_SEG object */
+	for (i = 1; i < fsi->cur_segs->data_segs_count; i++)
+		ssdfs_current_segment_destroy(fsi->cur_segs->data_segs[i]);
+	/* the warm stream is SSDFS_CUR_DATA_SEG object */
+	for (i = SSDFS_HOT_DATA_STREAM; i < SSDFS_DATA_STREAMS_MAX; i++)
+		ssdfs_current_segment_destroy(fsi->cur_segs->streams[i]);
 	up_write(&fsi->cur_segs->lock);
 }
 
@@ -678,6 +856,11 @@ void ssdfs_current_segment_array_destroy(struct ssdfs_fs_info *fsi)
 	BUG_ON(rwsem_is_locked(&fsi->cur_segs->lock));
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	if (fsi->cur_segs->data_segs_buf)
+		ssdfs_cur_seg_kfree(fsi->cur_segs->data_segs_buf);
+	if (fsi->cur_segs->data_segs)
+		ssdfs_cur_seg_kfree(fsi->cur_segs->data_segs);
+
 	ssdfs_cur_seg_kfree(fsi->cur_segs);
 	fsi->cur_segs = NULL;
 }
@@ -22,6 +22,28 @@
 #ifndef _SSDFS_CURRENT_SEGMENT_H
 #define _SSDFS_CURRENT_SEGMENT_H
 
+/* Upper bound of per-CPU current user data segments */
+#define SSDFS_PERCPU_CUR_DATA_SEGS_MAX		(64)
+
+/* Max number of attempts to find segment that is not current yet */
+#define SSDFS_CUR_SEG_GRAB_ATTEMPTS_MAX		(SSDFS_PERCPU_CUR_DATA_SEGS_MAX)
+
+/*
+ * User data streams (temperature of data)
+ */
+enum {
+	SSDFS_WARM_DATA_STREAM,
+	SSDFS_HOT_DATA_STREAM,
+	SSDFS_COLD_DATA_STREAM,
+	SSDFS_DATA_STREAMS_MAX
+};
+
+/* Number of updates of file's data that makes the file hot */
+#define SSDFS_HOT_DATA_UPDATES_THRESHOLD	(8)
+
+/* Age of file's last modification that makes the file cold */
+#define SSDFS_COLD_DATA_AGE_SECS		(24 * 60 * 60)
+
 /*
  * struct ssdfs_current_segment - current segment container
  * @lock: exclusive lock of current segment object
@@ -43,11 +65,37 @@ struct ssdfs_current_segment {
  * @lock: current segments array's lock
  * @objects: array of pointers on current segment objects
  * @buffer: buffer for all current segment objects
+ * @data_segs_count: number of per-CPU current user data segments
+ * @data_segs: array of pointers on per-CPU current user data segments
+ * @data_segs_buf: buffer for per-CPU current user data segment objects
+ * @streams: array of pointers on current segments of user data streams
+ * @streams_buf: buffer for current segments of hot and cold data streams
+ *
+ * The SSDFS_CUR_DATA_SEG object is shared by all CPUs by default.
+ * If per-CPU mode is enabled, then every CPU has own current
+ * user data segment. The first item of @data_segs array points
+ * on SSDFS_CUR_DATA_SEG object. Only this object's segment ID
+ * is stored in the volume state. Other per-CPU segments are
+ * in "using" state on the volume and they can be found by means of
+ * segment bitmap after remount.
+ *
+ * If temperature streams are enabled, then hot and cold user data
+ * are stored into dedicated current segments. The warm stream is
+ * represented by SSDFS_CUR_DATA_SEG (or per-CPU) object, so
+ * @streams[SSDFS_WARM_DATA_STREAM] is always NULL.
  */
 struct ssdfs_current_segs_array {
 	struct rw_semaphore lock;
 	struct ssdfs_current_segment *objects[SSDFS_CUR_SEGS_COUNT];
 	u8 buffer[sizeof(struct ssdfs_current_segment) * SSDFS_CUR_SEGS_COUNT];
+
+	u32 data_segs_count;
+	struct ssdfs_current_segment **data_segs;
+	struct ssdfs_current_segment *data_segs_buf;
+
+	struct ssdfs_current_segment *streams[SSDFS_DATA_STREAMS_MAX];
+	u8 streams_buf[sizeof(struct ssdfs_current_segment) *
+			(SSDFS_DATA_STREAMS_MAX - 1)];
 };
 
 /*
@@ -59,6 +107,78 @@ bool is_ssdfs_current_segment_empty(struct ssdfs_current_segment *cur_seg)
 	return cur_seg->real_seg == NULL;
 }
 
+static inline
+bool is_ssdfs_percpu_data_segs_enabled(struct ssdfs_current_segs_array *array)
+{
+	return array->data_segs_count > 1;
+}
+
+static inline
+bool is_ssdfs_data_streams_enabled(struct ssdfs_current_segs_array *array)
+{
+	return array->streams[SSDFS_HOT_DATA_STREAM] != NULL;
+}
+
+/*
+ * ssdfs_current_segment_select() - select current segment container
+ * @array: current segments array
+ * @cur_seg_type: current segment type
+ * @index: index of selected per-CPU data segment [out]
+ *
+ * This function returns the current segment container for
+ * @cur_seg_type. If per-CPU mode is enabled, then user data requests
+ * are directed into the current segment of the CPU. The caller
+ * has to hold the current segments array's lock.
+ */
+/*
+ * ssdfs_current_segment_cpu2index() - convert CPU into data segment's index
+ * @array: current segments array
+ * @cpu: CPU of the writer
+ *
+ * The per-CPU current data segments are split into equal groups
+ * for every NUMA node. The writer selects the current segment
+ * from the group of its node. The new segment is created by
+ * the writer and, as a result, it is associated with the same node.
+ */
+static inline
+u32 ssdfs_current_segment_cpu2index(struct ssdfs_current_segs_array *array,
+				    u32 cpu)
+{
+	u32 count = array->data_segs_count;
+	u32 per_node;
+	int node;
+
+	if (nr_node_ids <= 1 || count < nr_node_ids)
+		return cpu % count;
+
+	node = cpu_to_node(cpu);
+	if (node < 0)
+		return cpu % count;
+
+	per_node = count / nr_node_ids;
+
+	return (node * per_node) + (cpu % per_node);
+}
+
+static inline
+struct ssdfs_current_segment *
+ssdfs_current_segment_select(struct ssdfs_current_segs_array *array,
+			     int cur_seg_type, u32 *index)
+{
+	u32 cpu;
+
+	*index = 0;
+
+	if (cur_seg_type != SSDFS_CUR_DATA_SEG ||
+	    !is_ssdfs_percpu_data_segs_enabled(array))
+		return array->objects[cur_seg_type];
+
+	cpu = raw_smp_processor_id();
+	*index = ssdfs_current_segment_cpu2index(array, cpu);
+
+	return array->data_segs[*index];
+}
+
 /*
  * Current segment container's API
  */
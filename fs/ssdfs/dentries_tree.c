@@ -2222,6 +2222,14 @@ int ssdfs_dentries_tree_add_dentry(struct ssdfs_dentries_btree_info *tree,
  *
  * This method tries to add dentry into the tree.
  *
+ * The generic tree is only read-locked here, and the b-tree nodes
+ * are protected by their own locks. The creates in one directory
+ * are still serialized by the VFS, which holds the exclusive lock
+ * of the parent inode for every create, link or unlink. So,
+ * sharding the dentries tree by hash prefix would not let the
+ * creates of one directory run in parallel. It would also need
+ * several root nodes in the on-disk inode.
+ *
  * RETURN:
  * [success]
  * [failure] - error code:
@@ -4169,6 +4177,32 @@ ssdfs_dentries_tree_extract_inline_range(struct ssdfs_dentries_btree_info *tree,
 	return 0;
 }
 
+/*
+ * ssdfs_dentries_tree_prefetch() - prefetch upper levels of dentries tree
+ * @tree: dentries tree
+ *
+ * This method issues the background read of the root's children
+ * and the first leaf nodes of the generic dentries tree. The inline
+ * dentries array needs nothing for prefetch.
+ */
+void ssdfs_dentries_tree_prefetch(struct ssdfs_dentries_btree_info *tree)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree);
+
+	SSDFS_DBG("tree %p, type %#x\n",
+		  tree, atomic_read(&tree->type));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (atomic_read(&tree->type) != SSDFS_PRIVATE_DENTRIES_BTREE)
+		return;
+
+	down_read(&tree->lock);
+	if (atomic_read(&tree->type) == SSDFS_PRIVATE_DENTRIES_BTREE)
+		ssdfs_btree_prefetch_upper_levels(tree->generic_tree);
+	up_read(&tree->lock);
+}
+
 /*
  * ssdfs_dentries_tree_extract_range() - extract range of items
  * @tree: dentries tree
@@ -4594,8 +4628,8 @@ int ssdfs_dentries_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	err = ssdfs_btree_pre_flush_root_node(node);
 	if (unlikely(err)) {
@@ -4604,7 +4638,7 @@ int ssdfs_dentries_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 			  node->node_id, err);
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	return err;
@@ -4813,7 +4847,7 @@ int ssdfs_dentries_btree_create_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 	down_write(&node->bmap_array.lock);
 
 	switch (atomic_read(&node->type)) {
@@ -4993,7 +5027,7 @@ int ssdfs_dentries_btree_create_node(struct ssdfs_btree_node *node)
 
 finish_create_node:
 	up_write(&node->bmap_array.lock);
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		return err;
@@ -5023,11 +5057,85 @@ finish_create_node:
 		return err;
 	}
 
+	if (items_capacity > 0) {
+		err = ssdfs_btree_node_bloom_create(node, items_capacity);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to create bloom filter: "
+				  "node_id %u, err %d\n",
+				  node->node_id, err);
+			return err;
+		}
+	}
+
 	ssdfs_debug_btree_node_object(node);
 
 	return err;
 }
 
+/*
+ * ssdfs_dentries_btree_node_init_bloom() - build node's bloom filter
+ * @node: pointer on node object
+ * @items_capacity: maximum possible number of items in the node
+ *
+ * This method tries to create the bloom filter of the node
+ * and to add the hashes of all existing dentries into it.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - unable to allocate memory.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_dentries_btree_node_init_bloom(struct ssdfs_btree_node *node,
+					 u16 items_capacity)
+{
+	struct ssdfs_btree_node_items_area items_area;
+	struct ssdfs_dir_entry dentry;
+	int i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!node);
+	BUG_ON(!rwsem_is_locked(&node->full_lock));
+
+	SSDFS_DBG("node_id %u, items_capacity %u\n",
+		  node->node_id, items_capacity);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	err = ssdfs_btree_node_bloom_create(node, items_capacity);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to create bloom filter: "
+			  "node_id %u, err %d\n",
+			  node->node_id, err);
+		return err;
+	}
+
+	down_read(&node->header_lock);
+	ssdfs_memcpy(&items_area,
+		     0, sizeof(struct ssdfs_btree_node_items_area),
+		     &node->items_area,
+		     0, sizeof(struct ssdfs_btree_node_items_area),
+		     sizeof(struct ssdfs_btree_node_items_area));
+	up_read(&node->header_lock);
+
+	for (i = 0; i < items_area.items_count; i++) {
+		err = ssdfs_dentries_btree_node_get_dentry(node, &items_area,
+							   i, &dentry);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to get dentry: "
+				  "index %d, err %d\n", i, err);
+			return err;
+		}
+
+		ssdfs_btree_node_bloom_add(node,
+					   le64_to_cpu(dentry.hash_code));
+	}
+
+	return 0;
+}
+
 /*
  * ssdfs_dentries_btree_init_node() - init dentries tree's node
  * @node: pointer on node object
@@ -5105,7 +5213,7 @@ int ssdfs_dentries_btree_init_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	if (pagevec_count(&node->content.pvec) == 0) {
 		err = -ERANGE;
@@ -5148,7 +5256,7 @@ int ssdfs_dentries_btree_init_node(struct ssdfs_btree_node *node)
 		goto finish_init_operation;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&node->raw.dentries_header, 0, hdr_size,
 		     hdr, 0, hdr_size,
@@ -5324,7 +5432,7 @@ int ssdfs_dentries_btree_init_node(struct ssdfs_btree_node *node)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_header_init:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_init_operation;
@@ -5406,6 +5514,17 @@ finish_init_operation:
 	if (unlikely(err))
 		goto finish_init_node;
 
+	if (flags & SSDFS_BTREE_NODE_HAS_ITEMS_AREA) {
+		err = ssdfs_dentries_btree_node_init_bloom(node,
+							   items_capacity);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to init bloom filter: "
+				  "node_id %u, err %d\n",
+				  node->node_id, err);
+			goto finish_init_node;
+		}
+	}
+
 finish_init_node:
 	up_read(&node->full_lock);
 
@@ -5661,8 +5780,8 @@ int ssdfs_dentries_btree_pre_flush_node(struct ssdfs_btree_node *node)
 					 buffer.tree);
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&dentries_header, 0, hdr_size,
 		     &node->raw.dentries_header, 0, hdr_size,
@@ -5738,7 +5857,8 @@ int ssdfs_dentries_btree_pre_flush_node(struct ssdfs_btree_node *node)
 	}
 
 	dentries_header.node.check.bytes = cpu_to_le16((u16)hdr_size);
-	dentries_header.node.check.flags = cpu_to_le16(SSDFS_CRC32);
+	dentries_header.node.check.flags =
+		cpu_to_le16(ssdfs_csum_type(node->tree->fsi));
 
 	err = ssdfs_calculate_csum(&dentries_header.node.check,
 				   &dentries_header, hdr_size);
@@ -5752,7 +5872,7 @@ int ssdfs_dentries_btree_pre_flush_node(struct ssdfs_btree_node *node)
 		     hdr_size);
 
 finish_dentries_header_preparation:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_node_pre_flush;
@@ -6433,6 +6553,35 @@ void ssdfs_btree_search_result_no_data(struct ssdfs_btree_node *node,
 	}
 }
 
+/*
+ * ssdfs_dentries_btree_node_definitely_absent() - check the node's filter
+ * @node: pointer on node object
+ * @search: pointer on search request object
+ *
+ * This method checks that requested dentry is absent in the node
+ * for sure. Only lookup of one hash is checked by the filter.
+ */
+static inline
+bool ssdfs_dentries_btree_node_definitely_absent(struct ssdfs_btree_node *node,
+					struct ssdfs_btree_search *search)
+{
+	switch (search->request.type) {
+	case SSDFS_BTREE_SEARCH_FIND_ITEM:
+	case SSDFS_BTREE_SEARCH_FIND_RANGE:
+		/* continue logic */
+		break;
+
+	default:
+		return false;
+	}
+
+	if (search->request.start.hash != search->request.end.hash)
+		return false;
+
+	return !ssdfs_btree_node_bloom_may_contain(node,
+						   search->request.start.hash);
+}
+
 /*
  * ssdfs_dentries_btree_node_find_range() - find a range of items into the node
  * @node: pointer on node object
@@ -6532,6 +6681,16 @@ int ssdfs_dentries_btree_node_find_range(struct ssdfs_btree_node *node,
 	BUG_ON(lookup_index >= SSDFS_DENTRIES_BTREE_LOOKUP_TABLE_SIZE);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	if (ssdfs_dentries_btree_node_definitely_absent(node, search)) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("bloom filter excludes the hash: "
+			  "node_id %u, hash %llx\n",
+			  node->node_id, search->request.start.hash);
+#endif /* CONFIG_SSDFS_DEBUG */
+		ssdfs_btree_search_result_no_data(node, lookup_index, search);
+		return -ENODATA;
+	}
+
 	err = ssdfs_extract_range_by_lookup_index(node, lookup_index,
 						  search);
 	search->result.search_cno = ssdfs_current_cno(node->tree->fsi->sb);
@@ -7460,7 +7619,7 @@ int __ssdfs_dentries_btree_node_insert_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -7647,7 +7806,7 @@ finish_detect_affected_items:
 		goto unlock_items_range;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	node->items_area.items_count += search->request.count;
 	if (node->items_area.items_count > node->items_area.items_capacity) {
@@ -7749,6 +7908,9 @@ finish_detect_affected_items:
 			goto finish_items_area_correction;
 		}
 
+		ssdfs_btree_node_bloom_add(node,
+					   le64_to_cpu(dentry.hash_code));
+
 		name_len = le16_to_cpu(dentry.name_len);
 		if (name_len <= SSDFS_DENTRY_INLINE_NAME_MAX_LEN)
 			inline_names++;
@@ -7770,7 +7932,7 @@ finish_detect_affected_items:
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -8100,6 +8262,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 	bool name_was_inline, name_become_inline;
 	u16 item_index;
 	u64 start_hash, end_hash;
+	int i;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -8153,7 +8316,20 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 		return err;
 	}
 
-	down_write(&node->header_lock);
+	for (i = 0; i < range_len; i++) {
+		err = ssdfs_dentries_btree_node_get_dentry(node, area,
+							   item_index + i,
+							   &dentry);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to get dentry: err %d\n", err);
+			return err;
+		}
+
+		ssdfs_btree_node_bloom_add(node,
+					   le64_to_cpu(dentry.hash_code));
+	}
+
+	ssdfs_btree_node_header_down_write(node);
 
 	start_hash = node->items_area.start_hash;
 	end_hash = node->items_area.end_hash;
@@ -8231,7 +8407,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -8375,8 +8551,14 @@ int ssdfs_dentries_btree_node_change_item(struct ssdfs_btree_node *node,
 		return -EFAULT;
 	}
 
-	down_write(&node->full_lock);
+	/*
+	 * The change doesn't shift the items in the node. It needs
+	 * to lock the range of changing items only. As a result,
+	 * the changes of different items can be done concurrently.
+	 */
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
+try_define_changing_items:
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
 	switch (direction) {
@@ -8444,19 +8626,42 @@ int ssdfs_dentries_btree_node_change_item(struct ssdfs_btree_node *node,
 
 	err = ssdfs_lock_items_range(node, item_index, range_len);
 	if (err == -ENOENT) {
-		up_write(&node->full_lock);
+		up_read(&node->full_lock);
 		wake_up_all(&node->wait_queue);
 		return -ERANGE;
 	} else if (err == -ENODATA) {
-		up_write(&node->full_lock);
+		up_read(&node->full_lock);
 		wake_up_all(&node->wait_queue);
 		return -ERANGE;
 	} else if (unlikely(err))
 		BUG();
 
-finish_define_changing_items:
-	downgrade_write(&node->full_lock);
+	/*
+	 * Concurrent insert or delete could shift the items
+	 * before the range has been locked. Check the position again.
+	 */
+	down_read(&node->header_lock);
+	ssdfs_memcpy(&items_area,
+		     0, sizeof(struct ssdfs_btree_node_items_area),
+		     &node->items_area,
+		     0, sizeof(struct ssdfs_btree_node_items_area),
+		     sizeof(struct ssdfs_btree_node_items_area));
+	up_read(&node->header_lock);
+
+	if ((item_index + range_len) > items_area.items_count ||
+	    is_requested_position_correct(node, &items_area, search) !=
+						SSDFS_CORRECT_POSITION) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("items have been shifted: "
+			  "node_id %u, item_index %u\n",
+			  node->node_id, item_index);
+#endif /* CONFIG_SSDFS_DEBUG */
 
+		ssdfs_unlock_items_range(node, item_index, range_len);
+		goto try_define_changing_items;
+	}
+
+finish_define_changing_items:
 	if (unlikely(err))
 		goto finish_change_item;
 
@@ -8555,7 +8760,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	switch (atomic_read(&node->items_area.state)) {
 	case SSDFS_BTREE_NODE_ITEMS_AREA_EXIST:
@@ -8585,7 +8790,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		break;
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -8921,7 +9126,7 @@ int __ssdfs_dentries_btree_node_delete_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -9085,7 +9290,7 @@ finish_detect_affected_items:
 		}
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("INITIAL STATE: node_id %u, "
@@ -9277,7 +9482,7 @@ finish_detect_affected_items:
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -9519,7 +9724,7 @@ int ssdfs_dentries_btree_node_extract_range(struct ssdfs_btree_node *node,
 		  search->node.child);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_node_extract_range(node, start_index, count,
 						sizeof(struct ssdfs_dir_entry),
 						search);
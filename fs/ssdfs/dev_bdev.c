@@ -235,7 +235,9 @@ static int ssdfs_bdev_sync_page_request(struct super_block *sb,
 		goto finish_sync_page_request;
 	}
 
+	trace_ssdfs_bio_submit(bio);
 	err = submit_bio_wait(bio);
+	trace_ssdfs_bio_complete(bio);
 	if (unlikely(err)) {
 		SSDFS_ERR("fail to process request: "
 			  "err %d\n",
@@ -313,7 +315,9 @@ static int ssdfs_bdev_sync_pvec_request(struct super_block *sb,
 		}
 	}
 
+	trace_ssdfs_bio_submit(bio);
 	err = submit_bio_wait(bio);
+	trace_ssdfs_bio_complete(bio);
 	if (unlikely(err)) {
 		SSDFS_ERR("fail to process request: "
 			  "err %d\n",
@@ -411,6 +415,177 @@ int ssdfs_bdev_readpages(struct super_block *sb, struct pagevec *pvec,
 	return err;
 }
 
+/*
+ * ssdfs_bdev_async_read_end_io() - callback for asynchronous read end
+ *
+ * The state of pages is finalized here and the pages are unlocked.
+ * So, anybody who waits on the page lock sees the read result.
+ */
+static void ssdfs_bdev_async_read_end_io(struct bio *bio)
+{
+	struct ssdfs_io_batch *batch = bio->bi_private;
+	struct bio_vec *bvec;
+	struct bvec_iter_all iter_all;
+	unsigned long flags;
+
+	trace_ssdfs_bio_complete(bio);
+
+	bio_for_each_segment_all(bvec, bio, iter_all) {
+		struct page *page = bvec->bv_page;
+
+		if (bio->bi_status) {
+			ClearPageUptodate(page);
+			SetPageError(page);
+		} else {
+			SetPageUptodate(page);
+			ClearPageError(page);
+			flush_dcache_page(page);
+		}
+
+		ssdfs_unlock_page(page);
+	}
+
+	/*
+	 * The waiter takes the batch's lock after the wake up.
+	 * So, the batch cannot be gone until the lock is released.
+	 */
+	spin_lock_irqsave(&batch->lock, flags);
+	if (bio->bi_status && batch->err == 0)
+		batch->err = blk_status_to_errno(bio->bi_status);
+	if (atomic_dec_and_test(&batch->pending))
+		wake_up_all(&batch->wait);
+	spin_unlock_irqrestore(&batch->lock, flags);
+
+	ssdfs_bdev_bio_put(bio);
+}
+
+/*
+ * ssdfs_bdev_readpages_async() - submit pagevec read without waiting
+ * @sb: superblock object
+ * @pvec: pagevec
+ * @offset: offset in bytes from partition's begin
+ * @batch: batch of asynchronous read requests
+ *
+ * This function tries to submit the read of @pvec pages
+ * on @offset from partition's begin. The pages have to be
+ * locked by the caller. Every page is unlocked at the end of
+ * the request. The caller keeps the references of the pages.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM      - fail to allocate bio.
+ * %-ERANGE      - internal error.
+ */
+static
+int ssdfs_bdev_readpages_async(struct super_block *sb, struct pagevec *pvec,
+				loff_t offset, struct ssdfs_io_batch *batch)
+{
+	struct page *page;
+	struct bio *bio;
+	pgoff_t index = (pgoff_t)(offset >> PAGE_SHIFT);
+	int i;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pvec || !batch);
+
+	SSDFS_DBG("sb %p, offset %llu, pvec %p, count %u\n",
+		  sb, offset, pvec, pagevec_count(pvec));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (pagevec_count(pvec) == 0) {
+		SSDFS_WARN("empty page vector\n");
+		return 0;
+	}
+
+	bio = ssdfs_bdev_bio_alloc(sb->s_bdev, pagevec_count(pvec),
+				   REQ_OP_READ, GFP_NOIO);
+	if (IS_ERR_OR_NULL(bio)) {
+		err = !bio ? -ERANGE : PTR_ERR(bio);
+		SSDFS_ERR("fail to allocate bio: err %d\n",
+			  err);
+		goto fail_submit_request;
+	}
+
+	bio->bi_iter.bi_sector = index * (PAGE_SIZE >> 9);
+	bio_set_dev(bio, sb->s_bdev);
+	bio->bi_opf = REQ_OP_READ | REQ_RAHEAD;
+	bio->bi_private = batch;
+	bio->bi_end_io = ssdfs_bdev_async_read_end_io;
+
+	for (i = 0; i < pagevec_count(pvec); i++) {
+		page = pvec->pages[i];
+
+#ifdef CONFIG_SSDFS_DEBUG
+		BUG_ON(!page);
+		BUG_ON(!PageLocked(page));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		err = ssdfs_bdev_bio_add_page(bio, page, PAGE_SIZE, 0);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to add page %d into bio: "
+				  "err %d\n",
+				  i, err);
+			ssdfs_bdev_bio_put(bio);
+			goto fail_submit_request;
+		}
+	}
+
+	atomic_inc(&batch->pending);
+	trace_ssdfs_bio_submit(bio);
+	submit_bio(bio);
+
+	return 0;
+
+fail_submit_request:
+	for (i = 0; i < pagevec_count(pvec); i++) {
+		page = pvec->pages[i];
+		ClearPageUptodate(page);
+		SetPageError(page);
+		ssdfs_unlock_page(page);
+	}
+
+	return err;
+}
+
+/*
+ * ssdfs_bdev_wait_reads() - wait the end of asynchronous reads
+ * @sb: superblock object
+ * @batch: batch of asynchronous read requests
+ *
+ * This function waits the end of all requests of the @batch.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO         - I/O error.
+ */
+static
+int ssdfs_bdev_wait_reads(struct super_block *sb,
+			  struct ssdfs_io_batch *batch)
+{
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!batch);
+
+	SSDFS_DBG("sb %p, batch %p, pending %d\n",
+		  sb, batch, atomic_read(&batch->pending));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	wait_event(batch->wait, atomic_read(&batch->pending) == 0);
+
+	spin_lock_irq(&batch->lock);
+	err = batch->err;
+	batch->err = 0;
+	spin_unlock_irq(&batch->lock);
+
+	return err;
+}
+
 /*
  * ssdfs_bdev_read_pvec() - read from volume into buffer
  * @sb: superblock object
@@ -840,6 +1015,223 @@ int ssdfs_bdev_writepages(struct super_block *sb, loff_t to_off,
 	return err;
 }
 
+/*
+ * ssdfs_bdev_async_write_end_io() - callback for asynchronous write end
+ *
+ * The bio is moved into the list of completed requests of the batch.
+ * The state of pages is finalized by ssdfs_bdev_wait_writes() because
+ * cleaning the dirty state of a page could require a sleeping context.
+ */
+static void ssdfs_bdev_async_write_end_io(struct bio *bio)
+{
+	struct ssdfs_io_batch *batch = bio->bi_private;
+	unsigned long flags;
+
+	trace_ssdfs_bio_complete(bio);
+
+	/*
+	 * The waiter takes the batch's lock after the wake up.
+	 * So, the batch cannot be gone until the lock is released.
+	 */
+	spin_lock_irqsave(&batch->lock, flags);
+	if (bio->bi_status && batch->err == 0)
+		batch->err = blk_status_to_errno(bio->bi_status);
+	bio_list_add(&batch->completed, bio);
+	if (atomic_dec_and_test(&batch->pending))
+		wake_up_all(&batch->wait);
+	spin_unlock_irqrestore(&batch->lock, flags);
+}
+
+/*
+ * ssdfs_bdev_writepages_async() - submit pagevec write without waiting
+ * @sb: superblock object
+ * @to_off: offset in bytes from partition's begin
+ * @pvec: memory pages vector
+ * @from_off: offset in bytes from page's begin
+ * @len: size of data in bytes
+ * @batch: batch of asynchronous write requests
+ *
+ * This function tries to submit the write of @pvec data of @len size
+ * on @to_off from partition's begin. The pages stay locked until
+ * the request is finished by ssdfs_bdev_wait_writes() call.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EROFS       - file system in RO mode.
+ * %-ENOMEM      - fail to allocate bio.
+ * %-ERANGE      - internal error.
+ */
+static
+int ssdfs_bdev_writepages_async(struct super_block *sb, loff_t to_off,
+				struct pagevec *pvec,
+				u32 from_off, size_t len,
+				struct ssdfs_io_batch *batch)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
+	struct page *page;
+	struct bio *bio;
+	pgoff_t index = (pgoff_t)(to_off >> PAGE_SHIFT);
+	int i;
+#ifdef CONFIG_SSDFS_DEBUG
+	u32 remainder;
+#endif /* CONFIG_SSDFS_DEBUG */
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("sb %p, to_off %llu, pvec %p, from_off %u, len %zu\n",
+		  sb, to_off, pvec, from_off, len);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (sb->s_flags & SB_RDONLY) {
+		SSDFS_WARN("unable to write on RO file system\n");
+		return -EROFS;
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pvec || !batch);
+	BUG_ON((to_off >= ssdfs_bdev_device_size(sb)) ||
+		(len > (ssdfs_bdev_device_size(sb) - to_off)));
+	BUG_ON(len == 0);
+	div_u64_rem((u64)to_off, (u64)fsi->pagesize, &remainder);
+	BUG_ON(remainder);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (pagevec_count(pvec) == 0) {
+		SSDFS_WARN("empty pagevec\n");
+		return 0;
+	}
+
+	bio = ssdfs_bdev_bio_alloc(sb->s_bdev, pagevec_count(pvec),
+				   REQ_OP_WRITE, GFP_NOIO);
+	if (IS_ERR_OR_NULL(bio)) {
+		err = !bio ? -ERANGE : PTR_ERR(bio);
+		SSDFS_ERR("fail to allocate bio: err %d\n",
+			  err);
+		return err;
+	}
+
+	bio->bi_iter.bi_sector = index * (PAGE_SIZE >> 9);
+	bio_set_dev(bio, sb->s_bdev);
+	bio->bi_opf = REQ_OP_WRITE | REQ_SYNC;
+	bio->bi_private = batch;
+	bio->bi_end_io = ssdfs_bdev_async_write_end_io;
+
+	for (i = 0; i < pagevec_count(pvec); i++) {
+		page = pvec->pages[i];
+
+#ifdef CONFIG_SSDFS_DEBUG
+		BUG_ON(!page);
+		BUG_ON(!PageDirty(page));
+		BUG_ON(PageLocked(page));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		ssdfs_lock_page(page);
+
+		err = ssdfs_bdev_bio_add_page(bio, page, PAGE_SIZE, 0);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to add page %d into bio: "
+				  "err %d\n",
+				  i, err);
+			goto fail_submit_request;
+		}
+	}
+
+	atomic_inc(&fsi->pending_bios);
+	atomic_inc(&batch->pending);
+	trace_ssdfs_bio_submit(bio);
+	submit_bio(bio);
+
+	return 0;
+
+fail_submit_request:
+	for (; i >= 0; i--) {
+		page = pvec->pages[i];
+		SetPageError(page);
+		ssdfs_unlock_page(page);
+	}
+
+	for (i = 0; i < pagevec_count(pvec); i++)
+		ssdfs_put_page(pvec->pages[i]);
+
+	ssdfs_bdev_bio_put(bio);
+
+	return err;
+}
+
+/*
+ * ssdfs_bdev_wait_writes() - wait the end of asynchronous writes
+ * @sb: superblock object
+ * @batch: batch of asynchronous write requests
+ *
+ * This function waits the end of all requests of the @batch
+ * and finalizes the state of written pages.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO         - I/O error.
+ */
+static
+int ssdfs_bdev_wait_writes(struct super_block *sb,
+			   struct ssdfs_io_batch *batch)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
+	struct bio_list bios;
+	struct bio *bio;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!batch);
+
+	SSDFS_DBG("sb %p, batch %p, pending %d\n",
+		  sb, batch, atomic_read(&batch->pending));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	wait_event(batch->wait, atomic_read(&batch->pending) == 0);
+
+	spin_lock_irq(&batch->lock);
+	bio_list_init(&bios);
+	bio_list_merge(&bios, &batch->completed);
+	bio_list_init(&batch->completed);
+	err = batch->err;
+	batch->err = 0;
+	spin_unlock_irq(&batch->lock);
+
+	while ((bio = bio_list_pop(&bios)) != NULL) {
+		struct bio_vec *bvec;
+		struct bvec_iter_all iter_all;
+
+		bio_for_each_segment_all(bvec, bio, iter_all) {
+			struct page *page = bvec->bv_page;
+
+			if (bio->bi_status) {
+				SetPageError(page);
+				SSDFS_ERR("failed to write (err %d): "
+					  "page_index %llu\n",
+					  blk_status_to_errno(bio->bi_status),
+					  (unsigned long long)page_index(page));
+			} else {
+				ssdfs_clear_dirty_page(page);
+				SetPageUptodate(page);
+				ClearPageError(page);
+			}
+
+			ssdfs_unlock_page(page);
+			ssdfs_put_page(page);
+		}
+
+		ssdfs_bdev_bio_put(bio);
+
+		if (atomic_dec_and_test(&fsi->pending_bios))
+			wake_up_all(&wq);
+	}
+
+	return err;
+}
+
 /*
  * ssdfs_bdev_erase_end_io() - callback for erase operation end
  */
@@ -1127,6 +1519,159 @@ try_zeroout:
 	return 0;
 }
 
+/*
+ * ssdfs_bdev_async_trim_end_io() - callback for asynchronous discard end
+ */
+static void ssdfs_bdev_async_trim_end_io(struct bio *bio)
+{
+	struct ssdfs_io_batch *batch = bio->bi_private;
+	unsigned long flags;
+
+	/*
+	 * The waiter takes the batch's lock after the wake up.
+	 * So, the batch cannot be gone until the lock is released.
+	 */
+	spin_lock_irqsave(&batch->lock, flags);
+	if (bio->bi_status && batch->err == 0)
+		batch->err = blk_status_to_errno(bio->bi_status);
+	if (atomic_dec_and_test(&batch->pending))
+		wake_up_all(&batch->wait);
+	spin_unlock_irqrestore(&batch->lock, flags);
+
+	ssdfs_bdev_bio_put(bio);
+}
+
+/*
+ * ssdfs_bdev_trim_async() - submit discard without waiting
+ * @sb: superblock object
+ * @offset: offset in bytes from partition's begin
+ * @len: size in bytes
+ * @batch: batch of asynchronous discard requests
+ *
+ * This function tries to submit the discard of the PEBs' range
+ * as background requests. The range is split on the device's
+ * limit of discard request. The caller has to finish the batch
+ * by ssdfs_bdev_wait_trims() before the PEBs will be reused.
+ * Otherwise, the discard could be reordered with the new writes
+ * into the range.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EROFS       - file system in RO mode.
+ * %-EOPNOTSUPP  - device doesn't support discard.
+ * %-ENOMEM      - fail to allocate bio.
+ * %-ERANGE      - internal error.
+ */
+static
+int ssdfs_bdev_trim_async(struct super_block *sb, loff_t offset, size_t len,
+			  struct ssdfs_io_batch *batch)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
+	struct block_device *bdev = sb->s_bdev;
+	u32 erase_size = fsi->erasesize;
+	sector_t start_sector;
+	sector_t sectors_count;
+	sector_t granularity;
+	sector_t max_sectors;
+	sector_t req_sectors;
+	struct bio *bio;
+	u32 remainder;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!batch);
+
+	SSDFS_DBG("sb %p, offset %llu, len %zu\n",
+		  sb, (unsigned long long)offset, len);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (sb->s_flags & SB_RDONLY)
+		return -EROFS;
+
+	div_u64_rem((u64)len, (u64)erase_size, &remainder);
+	if (remainder || len == 0) {
+		SSDFS_WARN("len %llu, erase_size %u, remainder %u\n",
+			   (unsigned long long)len,
+			   erase_size, remainder);
+		return -ERANGE;
+	}
+
+	granularity = max_t(sector_t, 1,
+			    bdev_discard_granularity(bdev) >> SECTOR_SHIFT);
+	max_sectors = bdev_max_discard_sectors(bdev);
+	max_sectors = round_down(max_sectors, granularity);
+	if (max_sectors == 0)
+		return -EOPNOTSUPP;
+
+	start_sector = offset >> SECTOR_SHIFT;
+	sectors_count = len >> SECTOR_SHIFT;
+
+	while (sectors_count > 0) {
+		req_sectors = min_t(sector_t, sectors_count, max_sectors);
+
+		bio = ssdfs_bdev_bio_alloc(bdev, 0,
+					   REQ_OP_DISCARD | REQ_BACKGROUND,
+					   GFP_NOFS);
+		if (IS_ERR_OR_NULL(bio)) {
+			err = !bio ? -ERANGE : PTR_ERR(bio);
+			SSDFS_ERR("fail to allocate bio: err %d\n",
+				  err);
+			return err;
+		}
+
+		bio->bi_iter.bi_sector = start_sector;
+		bio->bi_iter.bi_size = req_sectors << SECTOR_SHIFT;
+		bio->bi_private = batch;
+		bio->bi_end_io = ssdfs_bdev_async_trim_end_io;
+
+		atomic_inc(&batch->pending);
+		submit_bio(bio);
+
+		start_sector += req_sectors;
+		sectors_count -= req_sectors;
+
+		cond_resched();
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_bdev_wait_trims() - wait the end of asynchronous discards
+ * @sb: superblock object
+ * @batch: batch of asynchronous discard requests
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO         - I/O error.
+ */
+static
+int ssdfs_bdev_wait_trims(struct super_block *sb,
+			  struct ssdfs_io_batch *batch)
+{
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!batch);
+
+	SSDFS_DBG("sb %p, batch %p, pending %d\n",
+		  sb, batch, atomic_read(&batch->pending));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	wait_event(batch->wait, atomic_read(&batch->pending) == 0);
+
+	spin_lock_irq(&batch->lock);
+	err = batch->err;
+	batch->err = 0;
+	spin_unlock_irq(&batch->lock);
+
+	return err;
+}
+
 /*
  * ssdfs_bdev_peb_isbad() - check that PEB is bad
  * @sb: superblock object
@@ -1177,11 +1722,17 @@ const struct ssdfs_device_ops ssdfs_bdev_devops = {
 	.read			= ssdfs_bdev_read,
 	.readpage		= ssdfs_bdev_readpage,
 	.readpages		= ssdfs_bdev_readpages,
+	.readpages_async	= ssdfs_bdev_readpages_async,
+	.wait_reads		= ssdfs_bdev_wait_reads,
 	.can_write_page		= ssdfs_bdev_can_write_page,
 	.writepage		= ssdfs_bdev_writepage,
 	.writepages		= ssdfs_bdev_writepages,
+	.writepages_async	= ssdfs_bdev_writepages_async,
+	.wait_writes		= ssdfs_bdev_wait_writes,
 	.erase			= ssdfs_bdev_erase,
 	.trim			= ssdfs_bdev_trim,
+	.trim_async		= ssdfs_bdev_trim_async,
+	.wait_trims		= ssdfs_bdev_wait_trims,
 	.peb_isbad		= ssdfs_bdev_peb_isbad,
 	.mark_peb_bad		= ssdfs_bdev_mark_peb_bad,
 	.sync			= ssdfs_bdev_sync,
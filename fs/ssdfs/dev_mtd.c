@@ -214,6 +214,76 @@ static int ssdfs_mtd_readpage(struct super_block *sb, struct page *page,
 	return err;
 }
 
+/*
+ * ssdfs_mtd_alloc_bounce_buffer() - allocate buffer for multi-page I/O
+ * @len: size of buffer in bytes
+ *
+ * MTD API works with linear buffers only. Every call of mtd_read() or
+ * mtd_write() takes the lock of the whole NAND chip and it prepares
+ * the ECC engine. So, the MTD operations are serialized by NAND core
+ * anyway and parallel operations on different dies cannot be issued
+ * by the file system. However, one operation for the whole sequence of
+ * pages lets the NAND core to process the pages without re-taking
+ * the chip and gives the driver the chance to use multi-page commands.
+ * The buffer is allocated by kmalloc() because NAND controllers are
+ * capable to use DMA for such memory. The caller falls back to
+ * the page-by-page I/O if the buffer cannot be allocated.
+ */
+static inline
+void *ssdfs_mtd_alloc_bounce_buffer(size_t len)
+{
+	return ssdfs_dev_mtd_kmalloc(len, GFP_NOFS | __GFP_NOWARN);
+}
+
+/*
+ * ssdfs_mtd_readpages_bounce() - read pages by one MTD operation
+ * @sb: superblock object
+ * @pvec: vector of memory pages
+ * @offset: offset in bytes from partition's begin
+ * @buf: bounce buffer
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO         - I/O error.
+ */
+static int ssdfs_mtd_readpages_bounce(struct super_block *sb,
+				      struct pagevec *pvec,
+				      loff_t offset, void *buf)
+{
+	size_t len = (size_t)pagevec_count(pvec) << PAGE_SHIFT;
+	struct page *page;
+	int i;
+	int err;
+
+	err = ssdfs_mtd_read(sb, offset, len, buf);
+
+	for (i = 0; i < pagevec_count(pvec); i++) {
+		page = pvec->pages[i];
+
+#ifdef CONFIG_SSDFS_DEBUG
+		BUG_ON(!page);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		if (err) {
+			ClearPageUptodate(page);
+			ssdfs_clear_page_private(page, 0);
+			SetPageError(page);
+		} else {
+			memcpy_to_page(page, 0,
+				       (u8 *)buf + ((size_t)i << PAGE_SHIFT),
+				       PAGE_SIZE);
+			SetPageUptodate(page);
+			ClearPageError(page);
+		}
+
+		ssdfs_unlock_page(page);
+	}
+
+	return err;
+}
+
 /*
  * ssdfs_mtd_readpages() - read pages from the volume
  * @sb: superblock object
@@ -233,6 +303,8 @@ static int ssdfs_mtd_readpages(struct super_block *sb, struct pagevec *pvec,
 				loff_t offset)
 {
 	struct page *page;
+	void *buf;
+	size_t buf_size;
 	loff_t cur_offset = offset;
 	u32 page_off;
 	u32 read_bytes = 0;
@@ -249,6 +321,25 @@ static int ssdfs_mtd_readpages(struct super_block *sb, struct pagevec *pvec,
 		return 0;
 	}
 
+	div_u64_rem(offset, PAGE_SIZE, &page_off);
+	if (pagevec_count(pvec) > 1 && page_off == 0) {
+		buf_size = (size_t)pagevec_count(pvec) << PAGE_SHIFT;
+		buf = ssdfs_mtd_alloc_bounce_buffer(buf_size);
+		if (buf) {
+			err = ssdfs_mtd_readpages_bounce(sb, pvec,
+							 offset, buf);
+			ssdfs_dev_mtd_kfree(buf);
+
+			if (unlikely(err)) {
+				SSDFS_ERR("fail to read pages: "
+					  "offset %llu, err %d\n",
+					  offset, err);
+			}
+
+			return err;
+		}
+	}
+
 	for (i = 0; i < pagevec_count(pvec); i++) {
 		page = pvec->pages[i];
 
@@ -404,6 +495,84 @@ static int ssdfs_mtd_writepage(struct super_block *sb, loff_t to_off,
 	return err;
 }
 
+/*
+ * ssdfs_mtd_writepages_bounce() - write pages by one MTD operation
+ * @sb: superblock object
+ * @to_off: offset in bytes from partition's begin
+ * @pvec: vector of memory pages
+ * @from_off: offset in bytes from page's begin
+ * @len: size of data in bytes
+ * @buf: bounce buffer
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO         - I/O error.
+ */
+static int ssdfs_mtd_writepages_bounce(struct super_block *sb, loff_t to_off,
+					struct pagevec *pvec,
+					u32 from_off, size_t len,
+					u8 *buf)
+{
+	struct mtd_info *mtd = SSDFS_FS_I(sb)->mtd;
+	struct page *page;
+	u32 page_off = from_off;
+	size_t copied = 0;
+	size_t copy_len;
+	size_t retlen = 0;
+	int i;
+	int ret;
+	int err = 0;
+
+	for (i = 0; i < pagevec_count(pvec); i++) {
+		page = pvec->pages[i];
+
+#ifdef CONFIG_SSDFS_DEBUG
+		BUG_ON(!page);
+		BUG_ON(!PageDirty(page));
+		BUG_ON(PageLocked(page));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		ssdfs_lock_page(page);
+
+		copy_len = min_t(size_t, (size_t)(PAGE_SIZE - page_off),
+					 len - copied);
+		if (copy_len > 0) {
+			memcpy_from_page(buf + copied, page,
+					 page_off, copy_len);
+		}
+
+		copied += copy_len;
+		page_off = 0;
+	}
+
+	ret = mtd_write(mtd, to_off, len, &retlen, buf);
+	if (ret || (retlen != len)) {
+		SSDFS_ERR("failed to write (err %d): offset %llu, "
+			  "len %zu, retlen %zu\n",
+			  ret, (unsigned long long)to_off, len, retlen);
+		err = -EIO;
+	}
+
+	for (i = 0; i < pagevec_count(pvec); i++) {
+		page = pvec->pages[i];
+
+		if (err)
+			SetPageError(page);
+		else {
+			ssdfs_clear_dirty_page(page);
+			SetPageUptodate(page);
+			ClearPageError(page);
+		}
+
+		ssdfs_unlock_page(page);
+		ssdfs_put_page(page);
+	}
+
+	return err;
+}
+
 /*
  * ssdfs_mtd_writepages() - write memory pages on volume
  * @sb: superblock object
@@ -426,6 +595,8 @@ static int ssdfs_mtd_writepages(struct super_block *sb, loff_t to_off,
 				struct pagevec *pvec, u32 from_off, size_t len)
 {
 	struct page *page;
+	u8 *buf;
+	size_t pvec_bytes;
 	loff_t cur_to_off = to_off;
 	u32 page_off = from_off;
 	u32 written_bytes = 0;
@@ -448,6 +619,27 @@ static int ssdfs_mtd_writepages(struct super_block *sb, loff_t to_off,
 		return 0;
 	}
 
+	/* every page of vector has to contain the data */
+	pvec_bytes = (size_t)pagevec_count(pvec) << PAGE_SHIFT;
+	if (pagevec_count(pvec) > 1 &&
+	    (pvec_bytes - PAGE_SIZE) < (from_off + len) &&
+	    (from_off + len) <= pvec_bytes) {
+		buf = ssdfs_mtd_alloc_bounce_buffer(len);
+		if (buf) {
+			err = ssdfs_mtd_writepages_bounce(sb, to_off, pvec,
+							  from_off, len, buf);
+			ssdfs_dev_mtd_kfree(buf);
+
+			if (unlikely(err)) {
+				SSDFS_ERR("fail to write pages: "
+					  "to_off %llu, len %zu, err %d\n",
+					  to_off, len, err);
+			}
+
+			return err;
+		}
+	}
+
 	for (i = 0; i < pagevec_count(pvec); i++) {
 		page = pvec->pages[i];
 
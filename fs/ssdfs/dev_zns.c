@@ -115,6 +115,304 @@ static int ssdfs_report_zone(struct blk_zone *zone,
 	return 0;
 }
 
+/*
+ * struct ssdfs_zns_zone_item - active zone of open zones manager
+ * @list: node of LRU list
+ * @start: first sector of zone
+ * @is_open: is zone in OPEN state?
+ * @inflight: number of write requests in flight
+ */
+struct ssdfs_zns_zone_item {
+	struct list_head list;
+	sector_t start;
+	bool is_open;
+	atomic_t inflight;
+};
+
+/*
+ * ssdfs_zns_open_zones_init() - initialize open zones manager
+ * @fsi: pointer on shared file system object
+ */
+void ssdfs_zns_open_zones_init(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_zns_open_zones *mgr = &fsi->zns_open_zones;
+
+	spin_lock_init(&mgr->lock);
+	mutex_init(&mgr->mutex);
+	INIT_LIST_HEAD(&mgr->lru);
+	mgr->count = 0;
+	mgr->max_open = bdev_max_open_zones(fsi->sb->s_bdev);
+}
+
+/*
+ * ssdfs_zns_open_zones_destroy() - destroy open zones manager
+ * @fsi: pointer on shared file system object
+ */
+void ssdfs_zns_open_zones_destroy(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_zns_open_zones *mgr = &fsi->zns_open_zones;
+	struct ssdfs_zns_zone_item *item, *tmp;
+
+	spin_lock(&mgr->lock);
+	list_for_each_entry_safe(item, tmp, &mgr->lru, list) {
+		list_del(&item->list);
+		ssdfs_dev_zns_kfree(item);
+	}
+	mgr->count = 0;
+	spin_unlock(&mgr->lock);
+}
+
+/*
+ * ssdfs_zns_find_zone_item() - find zone in open zones manager
+ * @mgr: open zones manager
+ * @start: first sector of zone
+ *
+ * The caller has to hold @mgr->lock.
+ */
+static inline
+struct ssdfs_zns_zone_item *
+ssdfs_zns_find_zone_item(struct ssdfs_zns_open_zones *mgr, sector_t start)
+{
+	struct ssdfs_zns_zone_item *item;
+
+	list_for_each_entry(item, &mgr->lru, list) {
+		if (item->start == start)
+			return item;
+	}
+
+	return NULL;
+}
+
+/*
+ * ssdfs_zns_close_lru_zone() - close the least recently written zone
+ * @sb: superblock object
+ *
+ * The caller has to hold the mutex of open zones manager.
+ * The closed zone stays active and it will be reopened
+ * on the next write.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EBUSY      - all open zones have write requests in flight.
+ */
+static int ssdfs_zns_close_lru_zone(struct super_block *sb)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
+	struct ssdfs_zns_open_zones *mgr = &fsi->zns_open_zones;
+	sector_t zone_size = fsi->erasesize >> SECTOR_SHIFT;
+	struct ssdfs_zns_zone_item *item, *victim = NULL;
+	int err;
+
+	spin_lock(&mgr->lock);
+	list_for_each_entry_reverse(item, &mgr->lru, list) {
+		if (item->is_open && atomic_read(&item->inflight) == 0) {
+			victim = item;
+			victim->is_open = false;
+			mgr->count--;
+			break;
+		}
+	}
+	spin_unlock(&mgr->lock);
+
+	if (!victim) {
+		SSDFS_WARN("open zones limit achieved: "
+			   "open zones %u\n", mgr->count);
+		return -EBUSY;
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("close zone: zone_start %llu\n",
+		  (u64)victim->start);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	err = blkdev_zone_mgmt(sb->s_bdev, REQ_OP_ZONE_CLOSE,
+				victim->start, zone_size, GFP_NOFS);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to close zone: "
+			  "zone_start %llu, err %d\n",
+			  (u64)victim->start, err);
+
+		spin_lock(&mgr->lock);
+		victim->is_open = true;
+		mgr->count++;
+		spin_unlock(&mgr->lock);
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_zns_activate_zone() - open zone in the open zones manager
+ * @sb: superblock object
+ * @zone_start: first sector of zone
+ *
+ * This function opens the zone explicitly. If the device's limit
+ * of open zones is achieved, then the least recently written zone
+ * is closed before the opening.
+ *
+ * RETURN:
+ * [success] - pointer on zone item.
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EBUSY      - all open zones have write requests in flight.
+ */
+static struct ssdfs_zns_zone_item *
+ssdfs_zns_activate_zone(struct super_block *sb, sector_t zone_start)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
+	struct ssdfs_zns_open_zones *mgr = &fsi->zns_open_zones;
+	sector_t zone_size = fsi->erasesize >> SECTOR_SHIFT;
+	struct ssdfs_zns_zone_item *item, *new_item = NULL;
+	int err = 0;
+
+	mutex_lock(&mgr->mutex);
+
+	spin_lock(&mgr->lock);
+	item = ssdfs_zns_find_zone_item(mgr, zone_start);
+	if (item && item->is_open) {
+		list_move(&item->list, &mgr->lru);
+		spin_unlock(&mgr->lock);
+		goto finish_activate_zone;
+	}
+	spin_unlock(&mgr->lock);
+
+	if (!item) {
+		new_item = ssdfs_dev_zns_kzalloc(sizeof(*new_item), GFP_NOFS);
+		if (!new_item) {
+			err = -ENOMEM;
+			SSDFS_ERR("fail to allocate zone item\n");
+			goto finish_activate_zone;
+		}
+
+		INIT_LIST_HEAD(&new_item->list);
+		new_item->start = zone_start;
+		new_item->is_open = false;
+		atomic_set(&new_item->inflight, 0);
+	}
+
+	while (mgr->max_open > 0 && mgr->count >= mgr->max_open) {
+		err = ssdfs_zns_close_lru_zone(sb);
+		if (err)
+			goto finish_activate_zone;
+	}
+
+	err = blkdev_zone_mgmt(sb->s_bdev, REQ_OP_ZONE_OPEN,
+				zone_start, zone_size, GFP_NOFS);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to open zone: "
+			  "zone_start %llu, open_zones %u, "
+			  "max_open %u, err %d\n",
+			  (u64)zone_start, mgr->count,
+			  mgr->max_open, err);
+		goto finish_activate_zone;
+	}
+
+	spin_lock(&mgr->lock);
+	if (new_item) {
+		item = new_item;
+		new_item = NULL;
+		list_add(&item->list, &mgr->lru);
+	} else
+		list_move(&item->list, &mgr->lru);
+	item->is_open = true;
+	mgr->count++;
+	spin_unlock(&mgr->lock);
+
+finish_activate_zone:
+	mutex_unlock(&mgr->mutex);
+
+	if (new_item)
+		ssdfs_dev_zns_kfree(new_item);
+
+	if (err)
+		return ERR_PTR(err);
+
+	return item;
+}
+
+/*
+ * ssdfs_zns_get_zone_for_write() - prepare zone for write request
+ * @sb: superblock object
+ * @zone_start: first sector of zone
+ *
+ * This function marks the zone as the most recently written one
+ * and it reopens the zone if the zone has been closed by the manager.
+ * The zones outside the manager (for example, reserved area of
+ * the volume) are ignored.
+ *
+ * RETURN:
+ * [success] - pointer on zone item or NULL.
+ * [failure] - error code.
+ */
+static struct ssdfs_zns_zone_item *
+ssdfs_zns_get_zone_for_write(struct super_block *sb, sector_t zone_start)
+{
+	struct ssdfs_zns_open_zones *mgr = &SSDFS_FS_I(sb)->zns_open_zones;
+	struct ssdfs_zns_zone_item *item;
+
+	spin_lock(&mgr->lock);
+	item = ssdfs_zns_find_zone_item(mgr, zone_start);
+	if (!item) {
+		spin_unlock(&mgr->lock);
+		return NULL;
+	} else if (item->is_open) {
+		list_move(&item->list, &mgr->lru);
+		atomic_inc(&item->inflight);
+		spin_unlock(&mgr->lock);
+		return item;
+	}
+	spin_unlock(&mgr->lock);
+
+	item = ssdfs_zns_activate_zone(sb, zone_start);
+	if (IS_ERR(item)) {
+		SSDFS_ERR("fail to reopen zone: "
+			  "zone_start %llu, err %ld\n",
+			  (u64)zone_start, PTR_ERR(item));
+		return item;
+	}
+
+	atomic_inc(&item->inflight);
+	return item;
+}
+
+/*
+ * ssdfs_zns_put_zone_after_write() - finish write request of zone
+ * @item: zone item (could be NULL)
+ */
+static inline
+void ssdfs_zns_put_zone_after_write(struct ssdfs_zns_zone_item *item)
+{
+	if (item)
+		atomic_dec(&item->inflight);
+}
+
+/*
+ * ssdfs_zns_forget_zone() - exclude zone from open zones manager
+ * @sb: superblock object
+ * @zone_start: first sector of zone
+ */
+static void ssdfs_zns_forget_zone(struct super_block *sb, sector_t zone_start)
+{
+	struct ssdfs_zns_open_zones *mgr = &SSDFS_FS_I(sb)->zns_open_zones;
+	struct ssdfs_zns_zone_item *item;
+
+	spin_lock(&mgr->lock);
+	item = ssdfs_zns_find_zone_item(mgr, zone_start);
+	if (item) {
+		list_del(&item->list);
+		if (item->is_open)
+			mgr->count--;
+	}
+	spin_unlock(&mgr->lock);
+
+	if (item)
+		ssdfs_dev_zns_kfree(item);
+}
+
 /*
  * ssdfs_zns_open_zone() - open zone
  * @sb: superblock object
@@ -123,6 +421,7 @@ static int ssdfs_report_zone(struct blk_zone *zone,
 static int ssdfs_zns_open_zone(struct super_block *sb, loff_t offset)
 {
 	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
+	struct ssdfs_zns_zone_item *item;
 	sector_t zone_sector = offset >> SECTOR_SHIFT;
 	sector_t zone_size = fsi->erasesize >> SECTOR_SHIFT;
 	u32 open_zones;
@@ -149,9 +448,10 @@ static int ssdfs_zns_open_zone(struct super_block *sb, loff_t offset)
 		   atomic_read(&fsi->open_zones));
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	err = blkdev_zone_mgmt(sb->s_bdev, REQ_OP_ZONE_OPEN,
-				zone_sector, zone_size, GFP_NOFS);
-	if (unlikely(err)) {
+	item = ssdfs_zns_activate_zone(sb, zone_sector);
+	if (IS_ERR(item)) {
+		err = PTR_ERR(item);
+		atomic_dec(&fsi->open_zones);
 		SSDFS_ERR("fail to open zone: "
 			  "zone_sector %llu, zone_size %llu, "
 			  "open_zones %u, max_open_zones %u, "
@@ -173,6 +473,7 @@ static int ssdfs_zns_open_zone(struct super_block *sb, loff_t offset)
 static int ssdfs_zns_reopen_zone(struct super_block *sb, loff_t offset)
 {
 	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
+	struct ssdfs_zns_zone_item *item;
 	struct blk_zone zone;
 	sector_t zone_sector = offset >> SECTOR_SHIFT;
 	sector_t zone_size = fsi->erasesize >> SECTOR_SHIFT;
@@ -236,9 +537,9 @@ static int ssdfs_zns_reopen_zone(struct super_block *sb, loff_t offset)
 		break;
 	}
 
-	err = blkdev_zone_mgmt(sb->s_bdev, REQ_OP_ZONE_OPEN,
-				zone_sector, zone_size, GFP_NOFS);
-	if (unlikely(err)) {
+	item = ssdfs_zns_activate_zone(sb, zone_sector);
+	if (IS_ERR(item)) {
+		err = PTR_ERR(item);
 		SSDFS_ERR("fail to open zone: "
 			  "zone_sector %llu, zone_size %llu, "
 			  "err %d\n",
@@ -329,6 +630,8 @@ static int ssdfs_zns_close_zone(struct super_block *sb, loff_t offset)
 		return err;
 	}
 
+	ssdfs_zns_forget_zone(sb, zone_sector);
+
 	open_zones = atomic_dec_return(&fsi->open_zones);
 	if (open_zones > fsi->max_open_zones) {
 		SSDFS_WARN("open zones limit exhausted: "
@@ -944,6 +1247,7 @@ int ssdfs_zns_writepage(struct super_block *sb, loff_t to_off,
 			struct page *page, u32 from_off, size_t len)
 {
 	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
+	struct ssdfs_zns_zone_item *item;
 	loff_t zone_start;
 #ifdef CONFIG_SSDFS_DEBUG
 	struct blk_zone zone;
@@ -975,14 +1279,19 @@ int ssdfs_zns_writepage(struct super_block *sb, loff_t to_off,
 	BUG_ON(PageLocked(page));
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	ssdfs_lock_page(page);
-	atomic_inc(&fsi->pending_bios);
-
 	zone_start = (to_off / fsi->erasesize) * fsi->erasesize;
 	zone_start >>= SECTOR_SHIFT;
 
+	item = ssdfs_zns_get_zone_for_write(sb, zone_start);
+	if (IS_ERR(item))
+		return PTR_ERR(item);
+
+	ssdfs_lock_page(page);
+	atomic_inc(&fsi->pending_bios);
+
 	err = ssdfs_zns_sync_page_request(sb, page, zone_start, to_off,
 					  REQ_OP_WRITE, REQ_SYNC);
+	ssdfs_zns_put_zone_after_write(item);
 	if (err) {
 		SetPageError(page);
 		SSDFS_ERR("failed to write (err %d): offset %llu\n",
@@ -1047,6 +1356,7 @@ int ssdfs_zns_writepages(struct super_block *sb, loff_t to_off,
 			 u32 from_off, size_t len)
 {
 	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
+	struct ssdfs_zns_zone_item *item;
 	struct page *page;
 	loff_t zone_start;
 	int i;
@@ -1082,6 +1392,13 @@ int ssdfs_zns_writepages(struct super_block *sb, loff_t to_off,
 		return 0;
 	}
 
+	zone_start = (to_off / fsi->erasesize) * fsi->erasesize;
+	zone_start >>= SECTOR_SHIFT;
+
+	item = ssdfs_zns_get_zone_for_write(sb, zone_start);
+	if (IS_ERR(item))
+		return PTR_ERR(item);
+
 	for (i = 0; i < pagevec_count(pvec); i++) {
 		page = pvec->pages[i];
 
@@ -1096,11 +1413,9 @@ int ssdfs_zns_writepages(struct super_block *sb, loff_t to_off,
 
 	atomic_inc(&fsi->pending_bios);
 
-	zone_start = (to_off / fsi->erasesize) * fsi->erasesize;
-	zone_start >>= SECTOR_SHIFT;
-
 	err = ssdfs_zns_sync_pvec_request(sb, pvec, zone_start, to_off,
 					  REQ_OP_WRITE, REQ_SYNC);
+	ssdfs_zns_put_zone_after_write(item);
 
 	for (i = 0; i < pagevec_count(pvec); i++) {
 		page = pvec->pages[i];
@@ -1149,6 +1464,283 @@ int ssdfs_zns_writepages(struct super_block *sb, loff_t to_off,
 	return err;
 }
 
+/*
+ * struct ssdfs_zns_append_ctx - context of asynchronous zone append
+ * @batch: batch of asynchronous write requests
+ * @expected_sector: sector of the intended placement of the data
+ * @written_sector: sector of the data that device has chosen
+ * @zone: zone item of open zones manager (could be NULL)
+ */
+struct ssdfs_zns_append_ctx {
+	struct ssdfs_io_batch *batch;
+	sector_t expected_sector;
+	sector_t written_sector;
+	struct ssdfs_zns_zone_item *zone;
+};
+
+/*
+ * ssdfs_zns_async_append_end_io() - callback for asynchronous append end
+ *
+ * Zone append returns the sector of the written data in the bio.
+ * Log's layout depends on the position of the data inside of the PEB.
+ * As a result, the data placed by device somewhere else than it is
+ * expected is treated as I/O error. The state of pages is finalized
+ * by ssdfs_zns_wait_writes() because cleaning the dirty state of a page
+ * could require a sleeping context.
+ */
+static void ssdfs_zns_async_append_end_io(struct bio *bio)
+{
+	struct ssdfs_zns_append_ctx *ctx = bio->bi_private;
+	struct ssdfs_io_batch *batch = ctx->batch;
+	unsigned long flags;
+
+	ctx->written_sector = bio->bi_iter.bi_sector;
+
+	/*
+	 * The waiter takes the batch's lock after the wake up.
+	 * So, the batch cannot be gone until the lock is released.
+	 */
+	spin_lock_irqsave(&batch->lock, flags);
+	if (bio->bi_status && batch->err == 0)
+		batch->err = blk_status_to_errno(bio->bi_status);
+	else if (ctx->written_sector != ctx->expected_sector &&
+		 batch->err == 0)
+		batch->err = -EIO;
+	bio_list_add(&batch->completed, bio);
+	if (atomic_dec_and_test(&batch->pending))
+		wake_up_all(&batch->wait);
+	spin_unlock_irqrestore(&batch->lock, flags);
+}
+
+/*
+ * ssdfs_zns_writepages_async() - submit zone append without waiting
+ * @sb: superblock object
+ * @to_off: offset in bytes from partition's begin
+ * @pvec: memory pages vector
+ * @from_off: offset in bytes from page's begin
+ * @len: size of data in bytes
+ * @batch: batch of asynchronous write requests
+ *
+ * This function tries to submit the zone append of @pvec data
+ * of @len size. Several appends of the same zone could be in flight
+ * simultaneously. The pages stay locked until the request is finished
+ * by ssdfs_zns_wait_writes() call.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EROFS       - file system in RO mode.
+ * %-ENOMEM      - fail to allocate memory.
+ * %-ERANGE      - internal error.
+ */
+static
+int ssdfs_zns_writepages_async(struct super_block *sb, loff_t to_off,
+				struct pagevec *pvec,
+				u32 from_off, size_t len,
+				struct ssdfs_io_batch *batch)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
+	struct ssdfs_zns_append_ctx *ctx;
+	struct page *page;
+	struct bio *bio;
+	loff_t zone_start;
+	int i;
+#ifdef CONFIG_SSDFS_DEBUG
+	u32 remainder;
+#endif /* CONFIG_SSDFS_DEBUG */
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("sb %p, to_off %llu, pvec %p, from_off %u, len %zu\n",
+		  sb, to_off, pvec, from_off, len);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (sb->s_flags & SB_RDONLY) {
+		SSDFS_WARN("unable to write on RO file system\n");
+		return -EROFS;
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pvec || !batch);
+	BUG_ON((to_off >= ssdfs_zns_device_size(sb)) ||
+		(len > (ssdfs_zns_device_size(sb) - to_off)));
+	BUG_ON(len == 0);
+	div_u64_rem((u64)to_off, (u64)fsi->pagesize, &remainder);
+	BUG_ON(remainder);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (pagevec_count(pvec) == 0) {
+		SSDFS_WARN("empty pagevec\n");
+		return 0;
+	}
+
+	ctx = ssdfs_dev_zns_kzalloc(sizeof(struct ssdfs_zns_append_ctx),
+				    GFP_NOIO);
+	if (!ctx) {
+		SSDFS_ERR("fail to allocate append context\n");
+		return -ENOMEM;
+	}
+
+	zone_start = (to_off / fsi->erasesize) * fsi->erasesize;
+	zone_start >>= SECTOR_SHIFT;
+
+	ctx->zone = ssdfs_zns_get_zone_for_write(sb, zone_start);
+	if (IS_ERR(ctx->zone)) {
+		err = PTR_ERR(ctx->zone);
+		ssdfs_dev_zns_kfree(ctx);
+		return err;
+	}
+
+	ctx->batch = batch;
+	ctx->expected_sector = to_off >> SECTOR_SHIFT;
+	ctx->written_sector = U64_MAX;
+
+	bio = ssdfs_bdev_bio_alloc(sb->s_bdev, pagevec_count(pvec),
+				   REQ_OP_ZONE_APPEND, GFP_NOIO);
+	if (IS_ERR_OR_NULL(bio)) {
+		err = !bio ? -ERANGE : PTR_ERR(bio);
+		SSDFS_ERR("fail to allocate bio: err %d\n",
+			  err);
+		ssdfs_zns_put_zone_after_write(ctx->zone);
+		ssdfs_dev_zns_kfree(ctx);
+		return err;
+	}
+
+	bio->bi_iter.bi_sector = zone_start;
+	bio_set_dev(bio, sb->s_bdev);
+	bio->bi_opf = REQ_OP_ZONE_APPEND | REQ_IDLE | REQ_SYNC;
+	bio->bi_private = ctx;
+	bio->bi_end_io = ssdfs_zns_async_append_end_io;
+
+	for (i = 0; i < pagevec_count(pvec); i++) {
+		page = pvec->pages[i];
+
+#ifdef CONFIG_SSDFS_DEBUG
+		BUG_ON(!page);
+		BUG_ON(!PageDirty(page));
+		BUG_ON(PageLocked(page));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		ssdfs_lock_page(page);
+
+		err = ssdfs_bdev_bio_add_page(bio, page, PAGE_SIZE, 0);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to add page %d into bio: "
+				  "err %d\n",
+				  i, err);
+			goto fail_submit_request;
+		}
+	}
+
+	atomic_inc(&fsi->pending_bios);
+	atomic_inc(&batch->pending);
+	submit_bio(bio);
+
+	return 0;
+
+fail_submit_request:
+	for (; i >= 0; i--) {
+		page = pvec->pages[i];
+		SetPageError(page);
+		ssdfs_unlock_page(page);
+	}
+
+	for (i = 0; i < pagevec_count(pvec); i++)
+		ssdfs_put_page(pvec->pages[i]);
+
+	ssdfs_bdev_bio_put(bio);
+	ssdfs_zns_put_zone_after_write(ctx->zone);
+	ssdfs_dev_zns_kfree(ctx);
+
+	return err;
+}
+
+/*
+ * ssdfs_zns_wait_writes() - wait the end of asynchronous appends
+ * @sb: superblock object
+ * @batch: batch of asynchronous write requests
+ *
+ * This function waits the end of all requests of the @batch
+ * and finalizes the state of written pages.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO         - I/O error or unexpected placement of data.
+ */
+static
+int ssdfs_zns_wait_writes(struct super_block *sb,
+			  struct ssdfs_io_batch *batch)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
+	struct bio_list bios;
+	struct bio *bio;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!batch);
+
+	SSDFS_DBG("sb %p, batch %p, pending %d\n",
+		  sb, batch, atomic_read(&batch->pending));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	wait_event(batch->wait, atomic_read(&batch->pending) == 0);
+
+	spin_lock_irq(&batch->lock);
+	bio_list_init(&bios);
+	bio_list_merge(&bios, &batch->completed);
+	bio_list_init(&batch->completed);
+	err = batch->err;
+	batch->err = 0;
+	spin_unlock_irq(&batch->lock);
+
+	while ((bio = bio_list_pop(&bios)) != NULL) {
+		struct ssdfs_zns_append_ctx *ctx = bio->bi_private;
+		struct bio_vec *bvec;
+		struct bvec_iter_all iter_all;
+		bool is_failed = bio->bi_status != BLK_STS_OK;
+
+		if (!is_failed &&
+		    ctx->written_sector != ctx->expected_sector) {
+			is_failed = true;
+			SSDFS_ERR("unexpected placement of data: "
+				  "expected_sector %llu, "
+				  "written_sector %llu\n",
+				  (u64)ctx->expected_sector,
+				  (u64)ctx->written_sector);
+		}
+
+		bio_for_each_segment_all(bvec, bio, iter_all) {
+			struct page *page = bvec->bv_page;
+
+			if (is_failed) {
+				SetPageError(page);
+				SSDFS_ERR("failed to write: "
+					  "page_index %llu\n",
+					  (unsigned long long)page_index(page));
+			} else {
+				ssdfs_clear_dirty_page(page);
+				SetPageUptodate(page);
+				ClearPageError(page);
+			}
+
+			ssdfs_unlock_page(page);
+			ssdfs_put_page(page);
+		}
+
+		ssdfs_zns_put_zone_after_write(ctx->zone);
+		ssdfs_dev_zns_kfree(ctx);
+		ssdfs_bdev_bio_put(bio);
+
+		if (atomic_dec_and_test(&fsi->pending_bios))
+			wake_up_all(&zns_wq);
+	}
+
+	return err;
+}
+
 /*
  * ssdfs_zns_trim() - initiate background erase operation
  * @sb: superblock object
@@ -1273,6 +1865,8 @@ const struct ssdfs_device_ops ssdfs_zns_devops = {
 	.can_write_page		= ssdfs_zns_can_write_page,
 	.writepage		= ssdfs_zns_writepage,
 	.writepages		= ssdfs_zns_writepages,
+	.writepages_async	= ssdfs_zns_writepages_async,
+	.wait_writes		= ssdfs_zns_wait_writes,
 	.erase			= ssdfs_zns_trim,
 	.trim			= ssdfs_zns_trim,
 	.peb_isbad		= ssdfs_zns_peb_isbad,
@@ -46,6 +46,7 @@
  */
 bool can_diff_on_write_metadata_be_used(struct ssdfs_btree_node *node)
 {
+	struct ssdfs_fs_info *fsi = node->tree->fsi;
 	struct ssdfs_state_bitmap *bmap;
 	unsigned long dirty_bits = 0;
 	unsigned long dirty_indexes = 0;
@@ -107,11 +108,7 @@ bool can_diff_on_write_metadata_be_used(struct ssdfs_btree_node *node)
 	total_bytes = ((u64)index_capacity * index_size) +
 			((u64)items_capacity * item_size);
 
-#ifdef CONFIG_SSDFS_DIFF_ON_WRITE_METADATA
-	if (percentage <= CONFIG_SSDFS_DIFF_ON_WRITE_METADATA_THRESHOLD) {
-#else
-	if (percentage <= SSDFS_DIFF_ON_WRITE_PCT_THRESHOLD) {
-#endif /* CONFIG_SSDFS_DIFF_ON_WRITE_METADATA */
+	if (percentage <= ssdfs_dow_threshold(fsi, SSDFS_DOW_METADATA)) {
 		dirty_bytes = sizeof(struct ssdfs_diff_blob_header);
 		dirty_bytes += bmap_bytes;
 		dirty_bytes += sizeof(node->raw);
@@ -126,6 +123,14 @@ bool can_diff_on_write_metadata_be_used(struct ssdfs_btree_node *node)
 finish_check:
 	up_read(&node->header_lock);
 
+#ifdef CONFIG_SSDFS_DIFF_ON_WRITE_METADATA
+	if (can_be_used)
+		ssdfs_dow_account_diff(fsi, SSDFS_DOW_METADATA,
+					dirty_bytes, total_bytes);
+	else if (index_count != 0 || items_count != 0)
+		ssdfs_dow_account_reject(fsi, SSDFS_DOW_METADATA);
+#endif /* CONFIG_SSDFS_DIFF_ON_WRITE_METADATA */
+
 	if (can_be_used) {
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("Diff-On-Write: node_id %u, height %u, type %#x, "
@@ -150,3 +155,149 @@ finish_check:
 	return false;
 #endif /* CONFIG_SSDFS_DIFF_ON_WRITE_METADATA */
 }
+
+/*
+ * ssdfs_dow_adapt_threshold() - re-calculate Diff-On-Write threshold
+ * @fsi: file system info object
+ * @type: data type (metadata or user data)
+ *
+ * This method finishes the current adaptation window and
+ * corrects the threshold on the basis of measured benefit.
+ * If diffs are too big relative to the replaced blocks or
+ * reads have to apply too many diffs, then threshold is decreased.
+ * If diffs are small but a lot of attempts have been rejected,
+ * then threshold is increased.
+ */
+static
+void ssdfs_dow_adapt_threshold(struct ssdfs_fs_info *fsi, int type)
+{
+	struct ssdfs_dow_stats *stats = &fsi->dow_stats[type];
+	u64 rejected, diff_bytes, block_bytes, reads, applied;
+	u64 diff_ratio = 0;
+	int threshold, old_threshold;
+
+	rejected = atomic64_xchg(&stats->win_rejected, 0);
+	diff_bytes = atomic64_xchg(&stats->win_diff_bytes, 0);
+	block_bytes = atomic64_xchg(&stats->win_block_bytes, 0);
+	reads = atomic64_xchg(&stats->win_reads, 0);
+	applied = atomic64_xchg(&stats->win_applied, 0);
+
+	if (block_bytes > 0)
+		diff_ratio = div64_u64(diff_bytes * 100, block_bytes);
+
+	old_threshold = atomic_read(&stats->threshold);
+	threshold = old_threshold;
+
+	if (reads > 0 && applied > reads * SSDFS_DOW_MAX_DIFFS_PER_READ)
+		threshold -= SSDFS_DOW_THRESHOLD_STEP;
+	else if (diff_ratio > SSDFS_DOW_POOR_DIFF_RATIO_PCT)
+		threshold -= SSDFS_DOW_THRESHOLD_STEP;
+	else if (block_bytes > 0 &&
+		 diff_ratio < SSDFS_DOW_GOOD_DIFF_RATIO_PCT &&
+		 rejected > (SSDFS_DOW_ADAPT_WINDOW / 2))
+		threshold += SSDFS_DOW_THRESHOLD_STEP;
+
+	threshold = clamp_t(int, threshold,
+			    SSDFS_DOW_THRESHOLD_MIN,
+			    SSDFS_DOW_THRESHOLD_MAX);
+	atomic_set(&stats->threshold, threshold);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("type %#x, rejected %llu, diff_bytes %llu, "
+		  "block_bytes %llu, reads %llu, applied %llu, "
+		  "old_threshold %d, threshold %d\n",
+		  type, rejected, diff_bytes, block_bytes,
+		  reads, applied, old_threshold, threshold);
+#endif /* CONFIG_SSDFS_DEBUG */
+}
+
+/*
+ * ssdfs_dow_window_step() - account decision in adaptation window
+ * @fsi: file system info object
+ * @type: data type (metadata or user data)
+ */
+static inline
+void ssdfs_dow_window_step(struct ssdfs_fs_info *fsi, int type)
+{
+	struct ssdfs_dow_stats *stats = &fsi->dow_stats[type];
+
+	if (atomic_inc_return(&stats->window) < SSDFS_DOW_ADAPT_WINDOW)
+		return;
+
+	atomic_set(&stats->window, 0);
+	ssdfs_dow_adapt_threshold(fsi, type);
+}
+
+/*
+ * ssdfs_dow_account_diff() - account prepared diff
+ * @fsi: file system info object
+ * @type: data type (metadata or user data)
+ * @diff_bytes: size of diff in bytes
+ * @block_bytes: size of block(s) replaced by the diff
+ */
+void ssdfs_dow_account_diff(struct ssdfs_fs_info *fsi, int type,
+			    u64 diff_bytes, u64 block_bytes)
+{
+	struct ssdfs_dow_stats *stats;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || type >= SSDFS_DOW_TYPE_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	stats = &fsi->dow_stats[type];
+
+	atomic64_inc(&stats->prepared);
+	atomic64_add(diff_bytes, &stats->diff_bytes);
+	atomic64_add(block_bytes, &stats->block_bytes);
+	atomic64_add(diff_bytes, &stats->win_diff_bytes);
+	atomic64_add(block_bytes, &stats->win_block_bytes);
+
+	ssdfs_dow_window_step(fsi, type);
+}
+
+/*
+ * ssdfs_dow_account_reject() - account rejected attempt to prepare diff
+ * @fsi: file system info object
+ * @type: data type (metadata or user data)
+ */
+void ssdfs_dow_account_reject(struct ssdfs_fs_info *fsi, int type)
+{
+	struct ssdfs_dow_stats *stats;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || type >= SSDFS_DOW_TYPE_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	stats = &fsi->dow_stats[type];
+
+	atomic64_inc(&stats->rejected);
+	atomic64_inc(&stats->win_rejected);
+
+	ssdfs_dow_window_step(fsi, type);
+}
+
+/*
+ * ssdfs_dow_account_read() - account read request that applied diffs
+ * @fsi: file system info object
+ * @type: data type (metadata or user data)
+ * @diffs_count: number of applied diff pages
+ */
+void ssdfs_dow_account_read(struct ssdfs_fs_info *fsi, int type,
+			    u32 diffs_count)
+{
+	struct ssdfs_dow_stats *stats;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || type >= SSDFS_DOW_TYPE_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (diffs_count == 0)
+		return;
+
+	stats = &fsi->dow_stats[type];
+
+	atomic64_inc(&stats->reads);
+	atomic64_add(diffs_count, &stats->applied);
+	atomic64_inc(&stats->win_reads);
+	atomic64_add(diffs_count, &stats->win_applied);
+}
@@ -22,11 +22,52 @@
 #ifndef _SSDFS_DIFF_ON_WRITE_H
 #define _SSDFS_DIFF_ON_WRITE_H
 
-#define SSDFS_DIFF_ON_WRITE_PCT_THRESHOLD	(25)
-
 #define SSDFS_DIRTY_ITEM	(0x1)
 #define SSDFS_DIRTY_ITEM_MASK	(0x1)
 
+/*
+ * ssdfs_dow_threshold() - get current Diff-On-Write threshold
+ * @fsi: file system info object
+ * @type: data type (metadata or user data)
+ *
+ * The threshold defined by user has priority over
+ * the adaptive one.
+ */
+static inline
+int ssdfs_dow_threshold(struct ssdfs_fs_info *fsi, int type)
+{
+	struct ssdfs_dow_stats *stats = &fsi->dow_stats[type];
+	int threshold = atomic_read(&stats->override);
+
+	if (threshold != SSDFS_DOW_THRESHOLD_ADAPTIVE)
+		return threshold;
+
+	return atomic_read(&stats->threshold);
+}
+
+/*
+ * ssdfs_dow_need_fold() - check that block's diff chain should be folded
+ * @fsi: file system info object
+ * @type: data type (metadata or user data)
+ * @blk_desc: block descriptor
+ *
+ * Every read of the block has to apply the whole chain of diffs.
+ * If the chain has reached the limit, then the next update has
+ * to store the full block state instead of one more diff.
+ */
+static inline
+bool ssdfs_dow_need_fold(struct ssdfs_fs_info *fsi, int type,
+			 struct ssdfs_block_descriptor *blk_desc)
+{
+	int diffs_count = SSDFS_BLK_DESC_DIFFS_COUNT(blk_desc);
+
+	if (diffs_count < atomic_read(&fsi->dow_fold_chain))
+		return false;
+
+	atomic64_inc(&fsi->dow_stats[type].folded);
+	return true;
+}
+
 /*
  * Diff-On-Write approach API
  */
@@ -34,6 +75,11 @@
 #ifdef CONFIG_SSDFS_DIFF_ON_WRITE
 
 bool can_diff_on_write_metadata_be_used(struct ssdfs_btree_node *node);
+void ssdfs_dow_account_diff(struct ssdfs_fs_info *fsi, int type,
+			    u64 diff_bytes, u64 block_bytes);
+void ssdfs_dow_account_reject(struct ssdfs_fs_info *fsi, int type);
+void ssdfs_dow_account_read(struct ssdfs_fs_info *fsi, int type,
+			    u32 diffs_count);
 
 /* TODO: freeze memory page state */
 int ssdfs_dow_freeze_page_state(struct page *page);
@@ -51,6 +97,23 @@ bool can_diff_on_write_metadata_be_used(struct ssdfs_btree_node *node)
 	return false;
 }
 
+static inline
+void ssdfs_dow_account_diff(struct ssdfs_fs_info *fsi, int type,
+			    u64 diff_bytes, u64 block_bytes)
+{
+}
+
+static inline
+void ssdfs_dow_account_reject(struct ssdfs_fs_info *fsi, int type)
+{
+}
+
+static inline
+void ssdfs_dow_account_read(struct ssdfs_fs_info *fsi, int type,
+			    u32 diffs_count)
+{
+}
+
 static inline
 int ssdfs_dow_freeze_page_state(struct page *page)
 {
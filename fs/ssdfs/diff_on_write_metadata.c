@@ -765,26 +765,6 @@ unlock_bmap:
 	return 0;
 }
 
-/*
- * BYTE_CONTAINS_STATE() - check that provided byte contains state
- * @value: pointer on analysed byte
- * @state: requested state
- *
- * RETURN:
- * [true]  - @value contains @state.
- * [false] - @value hasn't @state.
- */
-static inline
-bool BYTE_CONTAINS_STATE(u8 *value, int state)
-{
-	switch (state) {
-	case SSDFS_DIRTY_ITEM:
-		return *value != 0;
-	};
-
-	return false;
-}
-
 /*
  * ssdfs_metadata_find_first_dirty_item() - find first dirty item
  * @bmap: dirty bitmap
@@ -794,7 +774,8 @@ bool BYTE_CONTAINS_STATE(u8 *value, int state)
  * @found_item: pointer on found dirty item [out]
  *
  * This function tries to find a first dirty item
- * in range [@start, @max_blk).
+ * in range [@start, @max_blk). The bitmap is scanned
+ * a machine word at a time.
  *
  * RETURN:
  * [success] - @found_item contains found dirty item number.
@@ -811,13 +792,8 @@ int ssdfs_metadata_find_first_dirty_item(unsigned long *bmap,
 					 unsigned long max,
 					 unsigned long *found_item)
 {
-	const int state = SSDFS_DIRTY_ITEM;
-	const u8 state_bits = 1;
-	const int state_mask = SSDFS_DIRTY_ITEM_MASK;
-	u32 items_per_byte = SSDFS_ITEMS_PER_BYTE(state_bits);
-	unsigned long byte_index;
-	u32 items_diff;
-	int err;
+	unsigned long bits_count = bmap_bytes * BITS_PER_BYTE;
+	unsigned long found;
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!bmap || !found_item);
@@ -838,64 +814,53 @@ int ssdfs_metadata_find_first_dirty_item(unsigned long *bmap,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	*found_item = U32_MAX;
-	byte_index = start / items_per_byte;
-	items_diff = start % items_per_byte;
-
-	for (; byte_index < bmap_bytes; byte_index++) {
-		u8 *value;
-		u8 found_off;
-
-		value = (u8 *)bmap + byte_index;
-		err = FIND_FIRST_ITEM_IN_BYTE(value, state,
-					      state_bits, state_mask,
-					      items_diff,
-					      BYTE_CONTAINS_STATE,
-					      FIRST_STATE_IN_BYTE,
-					      &found_off);
-		if (err == -ENODATA) {
-			items_diff = 0;
-			continue;
-		} else if (unlikely(err)) {
-			SSDFS_ERR("fail to find item in byte: err %d\n",
-				  err);
-			return err;
-		}
 
-		*found_item = byte_index * items_per_byte;
-		*found_item += found_off;
+	bits_count = min_t(unsigned long, bits_count, max);
+	if (start >= bits_count)
+		return -ENODATA;
 
+	found = find_next_bit(bmap, bits_count, start);
+	if (found >= bits_count) {
 #ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("value %#x, byte_index %lu, "
-			  "found_off %u, found_item %lu\n",
-			  *value, byte_index,
-			  found_off, *found_item);
-
-		SSDFS_DBG("BMAP DUMP\n");
-		print_hex_dump_bytes("", DUMP_PREFIX_OFFSET,
-				     bmap,
-				     bmap_bytes);
-		SSDFS_DBG("\n");
+		SSDFS_DBG("no dirty item in range: "
+			  "start %lu, max %lu\n",
+			  start, max);
 #endif /* CONFIG_SSDFS_DEBUG */
+		return -ENODATA;
+	}
+
+	*found_item = found;
 
-		if (*found_item >= max) {
-#ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("item is out of range: "
-				  "found_item %lu, max %lu\n",
-				  *found_item, max);
-#endif /* CONFIG_SSDFS_DEBUG */
-			goto finish_search;
-		} else {
 #ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("item %lu has been found\n",
-				  *found_item);
+	SSDFS_DBG("item %lu has been found\n",
+		  *found_item);
 #endif /* CONFIG_SSDFS_DEBUG */
-		}
 
-		return 0;
-	}
+	return 0;
+}
+
+/*
+ * ssdfs_metadata_dirty_run_length() - get length of dirty items' run
+ * @bmap: dirty bitmap
+ * @bmap_bytes: number of bytes in bitmap
+ * @start: first dirty item of the run
+ * @max: upper bound for search
+ *
+ * The dirty items of the run are stored contiguously
+ * as in diff blob as in the node. So, the whole run
+ * can be applied by one copy operation.
+ */
+static inline
+unsigned long ssdfs_metadata_dirty_run_length(unsigned long *bmap,
+					      size_t bmap_bytes,
+					      unsigned long start,
+					      unsigned long max)
+{
+	unsigned long bits_count = bmap_bytes * BITS_PER_BYTE;
+
+	bits_count = min_t(unsigned long, bits_count, max);
 
-finish_search:
-	return -ENODATA;
+	return find_next_zero_bit(bmap, bits_count, start) - start;
 }
 
 /*
@@ -1583,6 +1548,15 @@ int ssdfs_btree_node_ready_for_diff(struct ssdfs_btree_node *node)
 			SSDFS_DBG("block descripor is exhausted: "
 				  "seg %llu, peb_index %u\n",
 				  seg_id, peb_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+			return -EAGAIN;
+		} else if (ssdfs_dow_need_fold(fsi, SSDFS_DOW_METADATA,
+					       &pos.blk_desc.buf)) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("diff chain should be folded: "
+				  "seg %llu, peb_index %u, "
+				  "logical_blk %u\n",
+				  seg_id, peb_index, cur_blk);
 #endif /* CONFIG_SSDFS_DEBUG */
 			return -EAGAIN;
 		} else {
@@ -2137,7 +2111,7 @@ int ssdfs_btree_node_prepare_diff(struct ssdfs_btree_node *node)
 	ssdfs_request_init(&node->flush_req);
 	ssdfs_get_request(&node->flush_req);
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	for (i = 0; i < len; i++) {
 		u32 cur_blk = logical_blk + i;
@@ -2317,6 +2291,8 @@ int ssdfs_btree_node_apply_indexes(struct ssdfs_fs_info *fsi,
 	u32 index_offset;
 	unsigned long search_start = start_bit;
 	unsigned long found_item = 0;
+	unsigned long run_len;
+	u32 run_bytes;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -2381,8 +2357,20 @@ int ssdfs_btree_node_apply_indexes(struct ssdfs_fs_info *fsi,
 			  found_item, index_offset);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+		run_len = ssdfs_metadata_dirty_run_length(bmap, bmap_bytes,
+							  found_item,
+							  max_bit);
+		run_bytes = run_len * index_size;
+
+		if ((*offset + run_bytes) > PAGE_SIZE) {
+			err = -ERANGE;
+			SSDFS_ERR("invalid run: offset %u, run_bytes %u\n",
+				  *offset, run_bytes);
+			goto finish_apply_indexes;
+		}
+
 		err = ssdfs_unaligned_write_pagevec(&req->result.pvec,
-						    index_offset, index_size,
+						    index_offset, run_bytes,
 						    (u8 *)kaddr + *offset);
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to apply btree node's index: "
@@ -2393,7 +2381,7 @@ int ssdfs_btree_node_apply_indexes(struct ssdfs_fs_info *fsi,
 			goto finish_apply_indexes;
 		}
 
-		*offset += index_size;
+		*offset += run_bytes;
 
 		if (*offset >= PAGE_SIZE) {
 			err = -ERANGE;
@@ -2402,7 +2390,7 @@ int ssdfs_btree_node_apply_indexes(struct ssdfs_fs_info *fsi,
 			goto finish_apply_indexes;
 		}
 
-		search_start = found_item + 1;
+		search_start = found_item + run_len;
 	}
 
 finish_apply_indexes:
@@ -2447,6 +2435,8 @@ int ssdfs_btree_node_apply_items(struct ssdfs_fs_info *fsi,
 	u32 item_offset;
 	unsigned long search_start = start_bit;
 	unsigned long found_item = 0;
+	unsigned long run_len;
+	u32 run_bytes;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -2514,8 +2504,20 @@ int ssdfs_btree_node_apply_items(struct ssdfs_fs_info *fsi,
 			  found_item - start_bit, item_offset);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+		run_len = ssdfs_metadata_dirty_run_length(bmap, bmap_bytes,
+							  found_item,
+							  max_bit);
+		run_bytes = run_len * item_size;
+
+		if ((*offset + run_bytes) > PAGE_SIZE) {
+			err = -ERANGE;
+			SSDFS_ERR("invalid run: offset %u, run_bytes %u\n",
+				  *offset, run_bytes);
+			goto finish_apply_items;
+		}
+
 		err = ssdfs_unaligned_write_pagevec(&req->result.pvec,
-						    item_offset, item_size,
+						    item_offset, run_bytes,
 						    (u8 *)kaddr + *offset);
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to apply btree node's item: "
@@ -2526,7 +2528,7 @@ int ssdfs_btree_node_apply_items(struct ssdfs_fs_info *fsi,
 			goto finish_apply_items;
 		}
 
-		*offset += item_size;
+		*offset += run_bytes;
 
 		if (*offset >= PAGE_SIZE) {
 			err = -ERANGE;
@@ -2535,7 +2537,7 @@ int ssdfs_btree_node_apply_items(struct ssdfs_fs_info *fsi,
 			goto finish_apply_items;
 		}
 
-		search_start = found_item + 1;
+		search_start = found_item + run_len;
 	}
 
 finish_apply_items:
@@ -2895,6 +2897,9 @@ int ssdfs_btree_node_apply_diffs(struct ssdfs_peb_info *pebi,
 		}
 	}
 
+	ssdfs_dow_account_read(fsi, SSDFS_DOW_METADATA,
+				pagevec_count(&req->result.diffs));
+
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("NODE CONTENT: pvec_size %u\n",
 		  pagevec_count(&req->result.pvec));
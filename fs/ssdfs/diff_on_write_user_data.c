@@ -180,7 +180,32 @@ int ssdfs_user_data_prepare_diff(struct ssdfs_peb_container *pebc,
 		return -ENOENT;
 	}
 
+	if (IS_SSDFS_BLK_STATE_PRE_ALLOCATED(&desc_off->blk_state)) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("pre-allocated block hasn't old state: "
+			  "seg %llu, peb_index %u, ino %llu\n",
+			  req->place.start.seg_id,
+			  pebc->peb_index,
+			  req->extent.ino);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return -ENOENT;
+	}
+
 	fsi = pebc->parent_si->fsi;
+
+	if (pos->blk_desc.status == SSDFS_BLK_DESC_BUF_INITIALIZED &&
+	    ssdfs_dow_need_fold(fsi, SSDFS_DOW_USER_DATA,
+				&pos->blk_desc.buf)) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("diff chain should be folded: "
+			  "seg %llu, peb_index %u, ino %llu\n",
+			  req->place.start.seg_id,
+			  pebc->peb_index,
+			  req->extent.ino);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return -ENOENT;
+	}
+
 	compression_type = fsi->metadata_options.user_data.compression;
 
 	mem_pages_per_block = fsi->pagesize / PAGE_SIZE;
@@ -190,7 +215,7 @@ int ssdfs_user_data_prepare_diff(struct ssdfs_peb_container *pebc,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	bits_threshold =
-		bits_count * CONFIG_SSDFS_DIFF_ON_WRITE_USER_DATA_THRESHOLD;
+		bits_count * ssdfs_dow_threshold(fsi, SSDFS_DOW_USER_DATA);
 	bits_threshold /= 100;
 
 	req->private.flags |= SSDFS_REQ_READ_ONLY_CACHE |
@@ -412,6 +437,13 @@ int ssdfs_user_data_prepare_diff(struct ssdfs_peb_container *pebc,
 finish_prepare_diff:
 	ssdfs_diff_kfree(bmap);
 
+	if (!err) {
+		ssdfs_dow_account_diff(fsi, SSDFS_DOW_USER_DATA,
+					write_offset,
+					(u64)pvec_size1 * PAGE_SIZE);
+	} else if (err == -E2BIG)
+		ssdfs_dow_account_reject(fsi, SSDFS_DOW_USER_DATA);
+
 	return err;
 }
 
@@ -774,6 +806,9 @@ int ssdfs_user_data_apply_diffs(struct ssdfs_peb_info *pebi,
 		}
 	}
 
+	ssdfs_dow_account_read(fsi, SSDFS_DOW_USER_DATA,
+				pagevec_count(&req->result.diffs));
+
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("LOGICAL BLOCK CONTENT: pvec_size %u\n",
 		  pagevec_count(&req->result.pvec));
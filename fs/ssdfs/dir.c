@@ -23,6 +23,7 @@
 #include "btree_search.h"
 #include "btree_node.h"
 #include "btree.h"
+#include "inodes_tree.h"
 #include "dentries_tree.h"
 #include "shared_dictionary.h"
 #include "xattr.h"
@@ -137,6 +138,9 @@ int ssdfs_inode_by_name(struct inode *dir,
 
 		ssdfs_btree_search_init(search);
 
+		/* the rest of the upper levels are read in the background */
+		ssdfs_dentries_tree_prefetch(ii->dentries_tree);
+
 		err = ssdfs_dentries_tree_find(ii->dentries_tree,
 						child->name,
 						child->len,
@@ -1693,6 +1697,73 @@ finish_check:
 	return is_invalid;
 }
 
+/*
+ * ssdfs_readdir_prefetch_inodes() - prefetch inodes of found dentries
+ * @fsi: pointer on shared file system object
+ * @search: search object with found dentries
+ * @items_count: number of found dentries
+ * @dot_hash: hash of "." name
+ * @dotdot_hash: hash of ".." name
+ *
+ * The readdir() is frequently followed by stat() of every name
+ * (ls -l, rsync, find). This method queues the background lookup
+ * of the dentries' raw inodes in the inodes btree. As a result,
+ * the inodes btree's nodes are read in batch instead of one
+ * synchronous lookup per stat() call.
+ */
+static
+void ssdfs_readdir_prefetch_inodes(struct ssdfs_fs_info *fsi,
+				   struct ssdfs_btree_search *search,
+				   u16 items_count,
+				   u64 dot_hash, u64 dotdot_hash)
+{
+	struct ssdfs_dir_entry *dentry;
+	size_t dentry_size = sizeof(struct ssdfs_dir_entry);
+	u64 ino[SSDFS_INODES_BTREE_PREFETCH_MAX];
+	u16 count = 0;
+	u64 hash;
+	int i;
+
+	if (!fsi->inodes_tree || !search->result.buf)
+		return;
+
+	for (i = 0; i < items_count; i++) {
+		dentry = (struct ssdfs_dir_entry *)((u8 *)search->result.buf +
+							(i * dentry_size));
+		hash = le64_to_cpu(dentry->hash_code);
+
+		if (dot_hash == hash || dotdot_hash == hash)
+			continue;
+
+		ino[count++] = le64_to_cpu(dentry->ino);
+
+		if (count >= SSDFS_INODES_BTREE_PREFETCH_MAX) {
+			ssdfs_inodes_btree_prefetch(fsi->inodes_tree,
+						    ino, count);
+			count = 0;
+		}
+	}
+
+	ssdfs_inodes_btree_prefetch(fsi->inodes_tree, ino, count);
+}
+
+/*
+ * The ssdfs_dir_open() is called by open(2) of the directory.
+ * The upper levels of a cold dentries tree are prefetched
+ * before the first readdir() or lookup of the directory.
+ */
+static int ssdfs_dir_open(struct inode *inode, struct file *file)
+{
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+
+	down_read(&ii->lock);
+	if (ii->dentries_tree)
+		ssdfs_dentries_tree_prefetch(ii->dentries_tree);
+	up_read(&ii->lock);
+
+	return 0;
+}
+
 /*
  * The ssdfs_readdir() is called when the VFS needs
  * to read the directory contents.
@@ -1832,7 +1903,7 @@ static int ssdfs_readdir(struct file *file, struct dir_context *ctx)
 	}
 
 	do {
-		ssdfs_btree_search_init(search);
+		ssdfs_btree_search_reinit(search);
 
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("ctx->pos %llu, start_hash %llx\n",
@@ -1915,6 +1986,9 @@ finish_tree_processing:
 
 		items_count = search->result.count;
 
+		ssdfs_readdir_prefetch_inodes(fsi, search, items_count,
+					      dot_hash, dotdot_hash);
+
 		for (i = 0; i < items_count; i++) {
 			u8 *start_ptr = (u8 *)search->result.buf;
 
@@ -2063,6 +2137,7 @@ const struct inode_operations ssdfs_dir_inode_operations = {
 };
 
 const struct file_operations ssdfs_dir_operations = {
+	.open		= ssdfs_dir_open,
 	.read		= generic_read_dir,
 	.iterate_shared	= ssdfs_readdir,
 	.unlocked_ioctl	= ssdfs_ioctl,
@@ -142,7 +142,7 @@ int ssdfs_dynamic_array_create(struct ssdfs_dynamic_array *array,
 		return -EINVAL;
 	}
 
-	if (bytes_count > PAGE_SIZE) {
+	if (bytes_count > SSDFS_DYNAMIC_ARRAY_BUFFER_MAX) {
 #ifdef CONFIG_SSDFS_DEBUG
 		BUG_ON(pages_count >= ssdfs_page_vector_max_threshold());
 #endif /* CONFIG_SSDFS_DEBUG */
@@ -186,8 +186,8 @@ int ssdfs_dynamic_array_create(struct ssdfs_dynamic_array *array,
 		array->bytes_count = PAGE_SIZE;
 		array->state = SSDFS_DYNAMIC_ARRAY_STORAGE_PAGE_VEC;
 	} else {
-		array->buf = ssdfs_dynamic_array_kzalloc(bytes_count,
-							 GFP_KERNEL);
+		array->buf = ssdfs_dynamic_array_kvzalloc(bytes_count,
+							  GFP_KERNEL);
 		if (!array->buf) {
 			SSDFS_ERR("fail to allocate memory: "
 				  "bytes_count %llu\n",
@@ -227,7 +227,7 @@ void ssdfs_dynamic_array_destroy(struct ssdfs_dynamic_array *array)
 
 	case SSDFS_DYNAMIC_ARRAY_STORAGE_BUFFER:
 		if (array->buf)
-			ssdfs_dynamic_array_kfree(array->buf);
+			ssdfs_dynamic_array_kvfree(array->buf);
 		break;
 
 	default:
@@ -248,10 +248,10 @@ void ssdfs_dynamic_array_destroy(struct ssdfs_dynamic_array *array)
  * @array: pointer on dynamic array object
  * @index: item index
  *
- * This method tries to get pointer on item. If short buffer
- * (< 4K) represents dynamic array, then the logic is pretty
- * straitforward. Otherwise, memory page is locked. The release
- * method should be called to unlock memory page.
+ * This method tries to get pointer on item. If contiguous buffer
+ * (SSDFS_DYNAMIC_ARRAY_BUFFER_MAX) represents dynamic array, then
+ * the logic is pretty straitforward. Otherwise, memory page is
+ * locked. The release method should be called to unlock memory page.
  *
  * RETURN:
  * [success] - pointer on requested item.
@@ -402,10 +402,11 @@ void *ssdfs_dynamic_array_get_locked(struct ssdfs_dynamic_array *array,
  * @index: item index
  * @items_count: items count in range [out]
  *
- * This method tries to get pointer on range of items. If short buffer
- * (< 4K) represents dynamic array, then the logic is pretty
- * straitforward. Otherwise, memory page is locked. The release
- * method should be called to unlock memory page.
+ * This method tries to get pointer on range of items. If contiguous
+ * buffer (SSDFS_DYNAMIC_ARRAY_BUFFER_MAX) represents dynamic array,
+ * then the logic is pretty straitforward. Otherwise, memory page
+ * is locked. The release method should be called to unlock
+ * memory page.
  *
  * RETURN:
  * [success] - pointer on requested range.
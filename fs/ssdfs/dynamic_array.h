@@ -44,6 +44,15 @@ struct ssdfs_dynamic_array {
 	void *buf;
 };
 
+/*
+ * The array of this size or smaller is stored in the virtually
+ * contiguous buffer (kvmalloc). So, the items can be accessed
+ * without kmap of every memory page and the whole content can be
+ * processed by linear loops. The bigger arrays are stored in
+ * the vector of pages that are allocated on demand.
+ */
+#define SSDFS_DYNAMIC_ARRAY_BUFFER_MAX	(16 * PAGE_SIZE)
+
 /* Dynamic array's states */
 enum {
 	SSDFS_DYNAMIC_ARRAY_STORAGE_ABSENT,
@@ -271,6 +271,56 @@ int ssdfs_extents_queue_remove_first(struct ssdfs_extents_queue *eq,
 	return err;
 }
 
+/*
+ * ssdfs_extents_queue_remove_batch() - move several extents into the batch
+ * @eq: extents queue
+ * @batch: list of extents' batch [out]
+ * @max_count: max number of extents in the batch
+ *
+ * This function moves up to @max_count extents from the head
+ * of @eq into the tail of @batch. The queue's lock is taken
+ * only once for the whole batch and the order of extents
+ * is kept.
+ *
+ * RETURN: number of extents moved into the batch.
+ */
+int ssdfs_extents_queue_remove_batch(struct ssdfs_extents_queue *eq,
+				     struct list_head *batch,
+				     int max_count)
+{
+	LIST_HEAD(tmp_list);
+	struct list_head *pos;
+	int count = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!eq || !batch);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (max_count <= 0)
+		return 0;
+
+	spin_lock(&eq->lock);
+	list_for_each(pos, &eq->list) {
+		if (++count >= max_count)
+			break;
+	}
+
+	if (pos == &eq->list)
+		list_splice_init(&eq->list, &tmp_list);
+	else
+		list_cut_position(&tmp_list, &eq->list, pos);
+	spin_unlock(&eq->lock);
+
+	list_splice_tail(&tmp_list, batch);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("max_count %d, count %d\n",
+		  max_count, count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return count;
+}
+
 /*
  * ssdfs_extents_queue_remove_all() - remove all extents from queue
  * @eq: extents queue
@@ -1792,3 +1842,140 @@ finish_invalidate_extent:
 
 	return err;
 }
+
+/*
+ * ssdfs_invalidate_segment_extents() - invalidate batch of segment's extents
+ * @fsi: pointer on shared file system object
+ * @seg_id: segment ID
+ * @extents: list of extents of the segment
+ *
+ * This method tries to invalidate all extents of @extents list
+ * in the segment @seg_id. The extents should be deleted from
+ * the extents tree beforehand. Every invalidated extent is removed
+ * from the list and freed. The commit log requests are issued
+ * only once for the whole batch. If the method fails, then
+ * the list contains the extents that haven't been invalidated.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - internal error.
+ * %-EBUSY      - segment is busy.
+ * %-ENODATA    - unable to invalidate logical extent.
+ */
+int ssdfs_invalidate_segment_extents(struct ssdfs_fs_info *fsi,
+				     u64 seg_id,
+				     struct list_head *extents)
+{
+	struct ssdfs_segment_info *si;
+	struct ssdfs_extent_info *ei, *tmp;
+	u32 start_blk;
+	u32 len;
+	int invalidated = 0;
+	int i;
+	int err = 0, err1;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !extents);
+	BUG_ON(seg_id == U64_MAX);
+
+	SSDFS_DBG("seg_id %llu\n", seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	si = ssdfs_grab_segment(fsi, SSDFS_USER_DATA_SEG_TYPE, seg_id, U64_MAX);
+	if (unlikely(IS_ERR_OR_NULL(si))) {
+		err = !si ? -ERANGE : PTR_ERR(si);
+		SSDFS_ERR("fail to grab segment object: "
+			  "seg %llu, err %d\n",
+			  seg_id, err);
+		return err;
+	}
+
+	err = ssdfs_mark_segment_under_invalidation(si);
+	if (err) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("segment %llu is busy\n",
+			  si->seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+		goto finish_invalidate_extents;
+	}
+
+	list_for_each_entry_safe(ei, tmp, extents, list) {
+#ifdef CONFIG_SSDFS_DEBUG
+		BUG_ON(ei->type != SSDFS_EXTENT_INFO_RAW_EXTENT);
+		BUG_ON(le64_to_cpu(ei->raw.extent.seg_id) != seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		start_blk = le32_to_cpu(ei->raw.extent.logical_blk);
+		len = le32_to_cpu(ei->raw.extent.len);
+
+		err = ssdfs_segment_invalidate_logical_extent(si,
+							      start_blk, len);
+		if (err == -ENODATA) {
+			SSDFS_DBG("unable to invalidate logical extent: "
+				  "seg %llu, extent (start_blk %u, len %u), "
+				  "err %d\n",
+				  seg_id, start_blk, len, err);
+			break;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to invalidate logical extent: "
+				  "seg %llu, extent (start_blk %u, len %u), "
+				  "err %d\n",
+				  seg_id, start_blk, len, err);
+			break;
+		}
+
+		list_del(&ei->list);
+		ssdfs_extent_info_free(ei);
+		invalidated++;
+	}
+
+	if (invalidated == 0)
+		goto revert_invalidation_state;
+
+	for (i = 0; i < si->pebs_count; i++) {
+		struct ssdfs_segment_request *req;
+
+		req = ssdfs_request_alloc();
+		if (IS_ERR_OR_NULL(req)) {
+			err1 = (req == NULL ? -ENOMEM : PTR_ERR(req));
+			SSDFS_ERR("fail to allocate segment request: err %d\n",
+				  err1);
+			err = err1;
+			goto revert_invalidation_state;
+		}
+
+		ssdfs_request_init(req);
+		ssdfs_get_request(req);
+
+		err1 = ssdfs_segment_commit_log_async2(si, SSDFS_REQ_ASYNC,
+						       i, req);
+		if (unlikely(err1)) {
+			SSDFS_ERR("commit log request failed: "
+				  "peb_index %d, err %d\n",
+				  i, err1);
+			ssdfs_put_request(req);
+			ssdfs_request_free(req);
+			err = err1;
+			goto revert_invalidation_state;
+		}
+	}
+
+revert_invalidation_state:
+	err1 = ssdfs_revert_invalidation_to_regular_activity(si);
+	if (unlikely(err1)) {
+		SSDFS_ERR("unexpected segment %llu activity\n",
+			  si->seg_id);
+	}
+
+finish_invalidate_extents:
+	ssdfs_segment_put_object(si);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("finished: invalidated %d, err %d\n",
+		  invalidated, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return err;
+}
@@ -72,6 +72,9 @@ void ssdfs_extents_queue_add_head(struct ssdfs_extents_queue *eq,
 				   struct ssdfs_extent_info *ei);
 int ssdfs_extents_queue_remove_first(struct ssdfs_extents_queue *eq,
 				      struct ssdfs_extent_info **ei);
+int ssdfs_extents_queue_remove_batch(struct ssdfs_extents_queue *eq,
+				     struct list_head *batch,
+				     int max_count);
 void ssdfs_extents_queue_remove_all(struct ssdfs_extents_queue *eq);
 
 /*
@@ -89,6 +92,9 @@ void ssdfs_extent_info_init(int type, void *ptr, u64 owner_ino,
 
 int ssdfs_invalidate_extent(struct ssdfs_fs_info *fsi,
 			    struct ssdfs_raw_extent *extent);
+int ssdfs_invalidate_segment_extents(struct ssdfs_fs_info *fsi,
+				     u64 seg_id,
+				     struct list_head *extents);
 int ssdfs_invalidate_extents_btree_index(struct ssdfs_fs_info *fsi,
 					 u64 owner_ino,
 					 struct ssdfs_btree_index_key *index);
@@ -880,6 +880,180 @@ int ssdfs_extents_tree_commit_logs_now(struct ssdfs_extents_btree_info *tree)
 	return ssdfs_commit_queue_issue_requests_sync(tree);
 }
 
+/*
+ * ssdfs_extents_tree_commit_updated_segs() - commit logs of updated segments
+ * @ii: pointer on in-core SSDFS inode
+ *
+ * This method tries to commit the logs of the segments that
+ * have received the inode's blocks (new or updated) since
+ * the last commit. The logs of other segments are not touched.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - internal error.
+ * %-ENOMEM     - fail to allocate memory.
+ */
+int ssdfs_extents_tree_commit_updated_segs(struct ssdfs_inode_info *ii)
+{
+	struct ssdfs_extents_btree_info *tree;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!ii);
+
+	SSDFS_DBG("ino %lu
+", ii->vfs_inode.i_ino);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	tree = SSDFS_EXTREE(ii);
+	if (!tree) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("extents tree is absent: ino %lu
+",
+			  ii->vfs_inode.i_ino);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return 0;
+	}
+
+	down_write(&tree->lock);
+	err = ssdfs_commit_queue_issue_requests_sync(tree);
+	up_write(&tree->lock);
+
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to commit logs: "
+			  "ino %lu, err %d\n",
+			  ii->vfs_inode.i_ino, err);
+	}
+
+	return err;
+}
+
+/*
+ * ssdfs_extmap_cache_init() - initialize cache of resolved extents
+ * @cache: cache of resolved extents
+ */
+static inline
+void ssdfs_extmap_cache_init(struct ssdfs_extmap_cache *cache)
+{
+	spin_lock_init(&cache->lock);
+	cache->version = 0;
+	cache->next = 0;
+	memset(cache->items, 0, sizeof(cache->items));
+}
+
+/*
+ * ssdfs_extmap_cache_version() - get version of extents tree's mapping
+ * @tree: extents tree
+ */
+static inline
+u64 ssdfs_extmap_cache_version(struct ssdfs_extents_btree_info *tree)
+{
+	u64 version;
+
+	spin_lock(&tree->extmap.lock);
+	version = tree->extmap.version;
+	spin_unlock(&tree->extmap.lock);
+
+	return version;
+}
+
+/*
+ * ssdfs_extmap_cache_invalidate() - empty cache of resolved extents
+ * @tree: extents tree
+ *
+ * This method has to be called after any modification
+ * of the extents tree.
+ */
+static
+void ssdfs_extmap_cache_invalidate(struct ssdfs_extents_btree_info *tree)
+{
+	spin_lock(&tree->extmap.lock);
+	tree->extmap.version++;
+	tree->extmap.next = 0;
+	memset(tree->extmap.items, 0, sizeof(tree->extmap.items));
+	spin_unlock(&tree->extmap.lock);
+}
+
+/*
+ * ssdfs_extmap_cache_lookup() - find resolved extent in the cache
+ * @tree: extents tree
+ * @blk: logical block in the file
+ * @seg_id: segment ID [out]
+ * @seg_blk: logical block in the segment [out]
+ * @len: number of blocks in the extent starting from @blk [out]
+ *
+ * RETURN:
+ * [true]  - the extent has been found.
+ * [false] - the cache doesn't contain the extent.
+ */
+static
+bool ssdfs_extmap_cache_lookup(struct ssdfs_extents_btree_info *tree,
+				u64 blk, u64 *seg_id, u32 *seg_blk, u32 *len)
+{
+	struct ssdfs_extmap_cache_item *item;
+	bool is_found = false;
+	int i;
+
+	spin_lock(&tree->extmap.lock);
+	for (i = 0; i < SSDFS_EXTMAP_CACHE_SIZE; i++) {
+		item = &tree->extmap.items[i];
+
+		if (item->len == 0)
+			continue;
+
+		if (item->file_blk <= blk &&
+		    blk < (item->file_blk + item->len)) {
+			u32 diff = (u32)(blk - item->file_blk);
+
+			*seg_id = item->seg_id;
+			*seg_blk = item->seg_blk + diff;
+			*len = item->len - diff;
+			is_found = true;
+			break;
+		}
+	}
+	spin_unlock(&tree->extmap.lock);
+
+	return is_found;
+}
+
+/*
+ * ssdfs_extmap_cache_add() - add resolved extent into the cache
+ * @tree: extents tree
+ * @version: version of the mapping at the beginning of the search
+ * @file_blk: starting logical block in the file
+ * @seg_id: segment ID
+ * @seg_blk: starting logical block in the segment
+ * @len: length of the extent in blocks
+ *
+ * The extent is ignored if the extents tree has been modified
+ * since the beginning of the search.
+ */
+static
+void ssdfs_extmap_cache_add(struct ssdfs_extents_btree_info *tree,
+			    u64 version, u64 file_blk,
+			    u64 seg_id, u32 seg_blk, u32 len)
+{
+	struct ssdfs_extmap_cache_item *item;
+
+	if (len == 0)
+		return;
+
+	spin_lock(&tree->extmap.lock);
+	if (tree->extmap.version == version) {
+		item = &tree->extmap.items[tree->extmap.next];
+		item->file_blk = file_blk;
+		item->seg_id = seg_id;
+		item->seg_blk = seg_blk;
+		item->len = len;
+		tree->extmap.next =
+			(tree->extmap.next + 1) % SSDFS_EXTMAP_CACHE_SIZE;
+	}
+	spin_unlock(&tree->extmap.lock);
+}
+
 /*
  * ssdfs_init_inline_root_node() - initialize inline root node
  * @fsi: pointer on shared file system object
@@ -977,6 +1151,7 @@ int ssdfs_extents_tree_create(struct ssdfs_fs_info *fsi,
 		     &fsi->segs_tree->extents_btree,
 		     0, sizeof(struct ssdfs_extents_btree_descriptor),
 		     sizeof(struct ssdfs_extents_btree_descriptor));
+	ssdfs_extmap_cache_init(&ptr->extmap);
 	ptr->owner = ii;
 	ptr->fsi = fsi;
 	atomic_set(&ptr->state, SSDFS_EXTENTS_BTREE_CREATED);
@@ -1841,7 +2016,7 @@ int __ssdfs_prepare_volume_extent(struct ssdfs_fs_info *fsi,
 {
 	struct ssdfs_inode_info *ii;
 	struct ssdfs_extents_btree_info *tree;
-	struct ssdfs_btree_search *search;
+	struct ssdfs_btree_search *search = NULL;
 	struct ssdfs_raw_fork *fork = NULL;
 	struct ssdfs_raw_extent *extent = NULL;
 	u32 pagesize = fsi->pagesize;
@@ -1851,6 +2026,7 @@ int __ssdfs_prepare_volume_extent(struct ssdfs_fs_info *fsi,
 	u64 blks_count;
 	u64 requested_blk, requested_len;
 	u64 processed_blks = 0;
+	u64 version;
 	int i;
 	int err = 0;
 
@@ -1890,6 +2066,14 @@ int __ssdfs_prepare_volume_extent(struct ssdfs_fs_info *fsi,
 		  requested_blk, requested_len);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	if (ssdfs_extmap_cache_lookup(tree, requested_blk,
+				      &seg_id, &logical_blk, &len)) {
+		len = min_t(u32, len, requested_len);
+		goto define_volume_extent;
+	}
+
+	version = ssdfs_extmap_cache_version(tree);
+
 	search = ssdfs_btree_search_alloc();
 	if (!search) {
 		SSDFS_ERR("fail to allocate btree search object\n");
@@ -1980,6 +2164,10 @@ int __ssdfs_prepare_volume_extent(struct ssdfs_fs_info *fsi,
 		    requested_blk < (start_blk + processed_blks + len)) {
 			u64 diff = requested_blk - (start_blk + processed_blks);
 
+			ssdfs_extmap_cache_add(tree, version,
+						start_blk + processed_blks,
+						seg_id, logical_blk, len);
+
 			logical_blk += (u32)diff;
 			len -= (u32)diff;
 			len = min_t(u32, len, requested_len);
@@ -1995,6 +2183,7 @@ int __ssdfs_prepare_volume_extent(struct ssdfs_fs_info *fsi,
 		goto finish_prepare_volume_extent;
 	}
 
+define_volume_extent:
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(logical_blk >= U16_MAX);
 	BUG_ON(len >= U16_MAX);
@@ -2271,6 +2460,9 @@ bool ssdfs_extents_tree_has_logical_block(u64 blk_offset, struct inode *inode)
 	struct ssdfs_inode_info *ii;
 	struct ssdfs_extents_btree_info *tree;
 	struct ssdfs_btree_search *search;
+	u64 seg_id;
+	u32 seg_blk;
+	u32 len;
 	ino_t ino;
 	bool is_found = false;
 	int err;
@@ -2296,6 +2488,10 @@ bool ssdfs_extents_tree_has_logical_block(u64 blk_offset, struct inode *inode)
 		return false;
 	}
 
+	if (ssdfs_extmap_cache_lookup(tree, blk_offset,
+				      &seg_id, &seg_blk, &len))
+		return true;
+
 	search = ssdfs_btree_search_alloc();
 	if (!search) {
 		SSDFS_ERR("fail to allocate btree search object\n");
@@ -2320,6 +2516,355 @@ bool ssdfs_extents_tree_has_logical_block(u64 blk_offset, struct inode *inode)
 	return is_found;
 }
 
+/*
+ * ssdfs_extents_iterate_fork() - iterate over extents of the fork
+ * @fork: raw fork
+ * @start_blk: first logical block of the range
+ * @end_blk: last logical block of the range
+ * @fn: extent's handler
+ * @ctx: handler's context
+ *
+ * RETURN:
+ * [zero]     - continue the iteration.
+ * [positive] - stop the iteration.
+ * [negative] - error code.
+ */
+static
+int ssdfs_extents_iterate_fork(struct ssdfs_raw_fork *fork,
+				u64 start_blk, u64 end_blk,
+				ssdfs_extents_iterate_fn fn, void *ctx)
+{
+	struct ssdfs_raw_extent *extent;
+	u64 file_blk;
+	u64 blks_count;
+	u64 processed_blks = 0;
+	u32 len;
+	int i;
+	int err;
+
+	file_blk = le64_to_cpu(fork->start_offset);
+	blks_count = le64_to_cpu(fork->blks_count);
+
+	if (file_blk >= U64_MAX || blks_count >= U64_MAX) {
+		SSDFS_ERR("corrupted fork: "
+			  "start_offset %llu, blks_count %llu\n",
+			  file_blk, blks_count);
+		return -ERANGE;
+	}
+
+	for (i = 0; i < SSDFS_INLINE_EXTENTS_COUNT; i++) {
+		if (processed_blks >= blks_count)
+			break;
+
+		extent = &fork->extents[i];
+		len = le32_to_cpu(extent->len);
+
+		if (len == 0 || len >= U32_MAX) {
+			SSDFS_ERR("corrupted extent: index %d\n", i);
+			return -ERANGE;
+		}
+
+		if (file_blk > end_blk)
+			return 1;
+
+		if ((file_blk + len) > start_blk) {
+			err = fn(file_blk, extent, ctx);
+			if (err)
+				return err;
+		}
+
+		file_blk += len;
+		processed_blks += len;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_extents_iterate_inline_forks() - iterate over inline forks
+ * @tree: extents tree
+ * @start_blk: first logical block of the range
+ * @end_blk: last logical block of the range
+ * @fn: extent's handler
+ * @ctx: handler's context
+ */
+static
+int ssdfs_extents_iterate_inline_forks(struct ssdfs_extents_btree_info *tree,
+					u64 start_blk, u64 end_blk,
+					ssdfs_extents_iterate_fn fn, void *ctx)
+{
+	struct ssdfs_raw_fork forks[SSDFS_INLINE_FORKS_COUNT];
+	size_t fork_size = sizeof(struct ssdfs_raw_fork);
+	s64 forks_count;
+	int i;
+	int err = 0;
+
+	down_read(&tree->lock);
+
+	forks_count = atomic64_read(&tree->forks_count);
+	if (forks_count < 0 || forks_count > SSDFS_INLINE_FORKS_COUNT) {
+		err = -ERANGE;
+		SSDFS_ERR("invalid forks_count %lld\n",
+			  forks_count);
+	} else if (forks_count > 0 && !tree->inline_forks) {
+		err = -ERANGE;
+		SSDFS_ERR("inline forks haven't been initialized\n");
+	} else if (forks_count > 0) {
+		ssdfs_memcpy(forks, 0, sizeof(forks),
+			     tree->inline_forks, 0, forks_count * fork_size,
+			     forks_count * fork_size);
+	}
+
+	up_read(&tree->lock);
+
+	if (unlikely(err))
+		return err;
+
+	for (i = 0; i < forks_count; i++) {
+		err = ssdfs_extents_iterate_fork(&forks[i],
+						 start_blk, end_blk,
+						 fn, ctx);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_extents_iterate_generic_tree() - iterate over forks of the btree
+ * @tree: extents tree
+ * @search: search object
+ * @start_blk: first logical block of the range
+ * @end_blk: last logical block of the range
+ * @fn: extent's handler
+ * @ctx: handler's context
+ *
+ * This method extracts the forks of the whole leaf node
+ * at once and moves to the next leaf node by means of
+ * the parent's index area.
+ */
+static
+int ssdfs_extents_iterate_generic_tree(struct ssdfs_extents_btree_info *tree,
+					struct ssdfs_btree_search *search,
+					u64 start_blk, u64 end_blk,
+					ssdfs_extents_iterate_fn fn, void *ctx)
+{
+	size_t fork_size = sizeof(struct ssdfs_raw_fork);
+	struct ssdfs_raw_fork *fork;
+	u8 *kaddr;
+	u64 hash = start_blk;
+	u64 start_hash, end_hash;
+	u16 items_count;
+	u32 i;
+	int err = 0;
+
+	do {
+		ssdfs_btree_search_init(search);
+		search->request.type = SSDFS_BTREE_SEARCH_FIND_ITEM;
+		search->request.flags =
+			SSDFS_BTREE_SEARCH_HAS_VALID_HASH_RANGE |
+			SSDFS_BTREE_SEARCH_HAS_VALID_COUNT;
+		search->request.start.hash = hash;
+		search->request.end.hash = hash;
+		search->request.count = 1;
+
+		down_read(&tree->lock);
+
+		err = ssdfs_btree_find_item(tree->generic_tree, search);
+		if (err == -ENODATA || err == -ENOENT) {
+			/* hole: process the found leaf node */
+			err = 0;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to find the fork: "
+				  "blk %llu, err %d\n",
+				  hash, err);
+			goto finish_extract_forks;
+		}
+
+		switch (search->node.state) {
+		case SSDFS_BTREE_SEARCH_FOUND_LEAF_NODE_DESC:
+			/* expected state */
+			break;
+
+		default:
+			err = -ENODATA;
+			goto finish_extract_forks;
+		}
+
+		err = ssdfs_btree_node_get_hash_range(search,
+						      &start_hash,
+						      &end_hash,
+						      &items_count);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to get hash range: err %d\n",
+				  err);
+			goto finish_extract_forks;
+		}
+
+		if (items_count == 0) {
+			err = -ENODATA;
+			goto finish_extract_forks;
+		}
+
+		err = ssdfs_btree_extract_range(tree->generic_tree,
+						0, items_count,
+						search);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to extract the range: "
+				  "items_count %u, err %d\n",
+				  items_count, err);
+			goto finish_extract_forks;
+		}
+
+finish_extract_forks:
+		up_read(&tree->lock);
+
+		if (err == -ENODATA) {
+			err = 0;
+			goto finish_iteration;
+		} else if (unlikely(err))
+			goto finish_iteration;
+
+		if (!search->result.buf ||
+		    search->result.buf_size <
+			(search->result.items_in_buffer * fork_size)) {
+			err = -ERANGE;
+			SSDFS_ERR("corrupted search result buffer\n");
+			goto finish_iteration;
+		}
+
+		kaddr = (u8 *)search->result.buf;
+
+		for (i = 0; i < search->result.items_in_buffer; i++) {
+			fork = (struct ssdfs_raw_fork *)kaddr;
+			fork += i;
+
+			err = ssdfs_extents_iterate_fork(fork,
+							 start_blk, end_blk,
+							 fn, ctx);
+			if (err)
+				goto finish_iteration;
+		}
+
+		if (end_hash >= end_blk)
+			goto finish_iteration;
+
+		err = ssdfs_btree_get_next_hash(tree->generic_tree,
+						search, &hash);
+
+		ssdfs_btree_search_forget_parent_node(search);
+		ssdfs_btree_search_forget_child_node(search);
+
+		if (err == -ENOENT) {
+			err = 0;
+			goto finish_iteration;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to get next hash: err %d\n",
+				  err);
+			goto finish_iteration;
+		}
+
+		cond_resched();
+	} while (hash <= end_blk);
+
+finish_iteration:
+	ssdfs_btree_search_forget_parent_node(search);
+	ssdfs_btree_search_forget_child_node(search);
+
+	return err;
+}
+
+/*
+ * ssdfs_extents_tree_iterate() - iterate over extents of the range
+ * @inode: pointer on VFS inode
+ * @start_blk: first logical block of the range
+ * @end_blk: last logical block of the range (inclusive)
+ * @fn: extent's handler
+ * @ctx: handler's context
+ *
+ * This method calls @fn for every extent that overlaps the range
+ * [@start_blk, @end_blk] in ascending order of logical blocks.
+ * The holes are skipped without any lookup for every block.
+ * The iteration stops if @fn returns a non-zero value.
+ *
+ * RETURN:
+ * [success] - zero or positive value (iteration has been stopped).
+ * [failure] - error code:
+ *
+ * %-ERANGE     - internal error.
+ * %-ENOMEM     - fail to allocate memory.
+ */
+int ssdfs_extents_tree_iterate(struct inode *inode,
+				u64 start_blk, u64 end_blk,
+				ssdfs_extents_iterate_fn fn, void *ctx)
+{
+	struct ssdfs_extents_btree_info *tree;
+	struct ssdfs_btree_search *search;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!inode || !fn);
+
+	SSDFS_DBG("ino %lu, start_blk %llu, end_blk %llu\n",
+		  inode->i_ino, start_blk, end_blk);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (start_blk > end_blk)
+		return 0;
+
+	tree = SSDFS_EXTREE(SSDFS_I(inode));
+	if (!tree) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("extents tree is absent: ino %lu\n",
+			  inode->i_ino);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return 0;
+	}
+
+	switch (atomic_read(&tree->state)) {
+	case SSDFS_EXTENTS_BTREE_CREATED:
+	case SSDFS_EXTENTS_BTREE_INITIALIZED:
+	case SSDFS_EXTENTS_BTREE_DIRTY:
+		/* expected state */
+		break;
+
+	default:
+		SSDFS_ERR("invalid extent tree's state %#x\n",
+			  atomic_read(&tree->state));
+		return -ERANGE;
+	};
+
+	switch (atomic_read(&tree->type)) {
+	case SSDFS_INLINE_FORKS_ARRAY:
+		err = ssdfs_extents_iterate_inline_forks(tree,
+							 start_blk, end_blk,
+							 fn, ctx);
+		break;
+
+	case SSDFS_PRIVATE_EXTENTS_BTREE:
+		search = ssdfs_btree_search_alloc();
+		if (!search) {
+			SSDFS_ERR("fail to allocate btree search object\n");
+			return -ENOMEM;
+		}
+
+		err = ssdfs_extents_iterate_generic_tree(tree, search,
+							 start_blk, end_blk,
+							 fn, ctx);
+		ssdfs_btree_search_free(search);
+		break;
+
+	default:
+		err = -ERANGE;
+		SSDFS_ERR("invalid extents tree type %#x\n",
+			  atomic_read(&tree->type));
+		break;
+	}
+
+	return err;
+}
+
 /*
  * ssdfs_extents_tree_add_extent() - add extent into extents tree
  * @inode: pointer on VFS inode
@@ -2800,6 +3345,76 @@ int ssdfs_extents_tree_find_fork(struct ssdfs_extents_btree_info *tree,
 	return err;
 }
 
+/*
+ * ssdfs_compact_fork_extents() - merge contiguous extents of the fork
+ * @fork: raw fork
+ *
+ * This method tries to merge the neighbouring extents of the fork
+ * that are physically contiguous (the same segment and adjacent
+ * logical blocks). The freed slots are moved to the end of the
+ * extents array.
+ *
+ * RETURN: number of freed slots.
+ */
+static
+int ssdfs_compact_fork_extents(struct ssdfs_raw_fork *fork)
+{
+	size_t desc_size = sizeof(struct ssdfs_raw_extent);
+	struct ssdfs_raw_extent *prev, *cur;
+	u64 seg1, seg2;
+	u32 lblk1, lblk2;
+	u32 len1, len2;
+	int merged = 0;
+	int i = 1;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fork);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	while (i < (SSDFS_INLINE_EXTENTS_COUNT - merged)) {
+		prev = &fork->extents[i - 1];
+		cur = &fork->extents[i];
+
+		seg1 = le64_to_cpu(prev->seg_id);
+		lblk1 = le32_to_cpu(prev->logical_blk);
+		len1 = le32_to_cpu(prev->len);
+
+		seg2 = le64_to_cpu(cur->seg_id);
+		lblk2 = le32_to_cpu(cur->logical_blk);
+		len2 = le32_to_cpu(cur->len);
+
+		if (len1 >= U32_MAX || len2 >= U32_MAX)
+			break;
+
+		if (seg1 != seg2 || (lblk1 + len1) != lblk2 ||
+		    (U32_MAX - len2) <= len1) {
+			i++;
+			continue;
+		}
+
+		le32_add_cpu(&prev->len, len2);
+
+		if ((i + 1) < SSDFS_INLINE_EXTENTS_COUNT) {
+			size_t bytes;
+
+			bytes = (SSDFS_INLINE_EXTENTS_COUNT - i - 1) * desc_size;
+			ssdfs_memmove(&fork->extents[i], 0, bytes,
+				      &fork->extents[i + 1], 0, bytes,
+				      bytes);
+		}
+
+		memset(&fork->extents[SSDFS_INLINE_EXTENTS_COUNT - 1],
+			0xFF, desc_size);
+		merged++;
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("merged extents %d\n", merged);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return merged;
+}
+
 /*
  * ssdfs_add_head_extent_into_fork() - add head extent into the fork
  * @blk: logical block number
@@ -2910,6 +3525,11 @@ int ssdfs_add_head_extent_into_fork(u64 blk,
 		return -ERANGE;
 	}
 
+	if (valid_extents == SSDFS_INLINE_EXTENTS_COUNT) {
+		/* try to free a slot for the new extent */
+		valid_extents -= ssdfs_compact_fork_extents(fork);
+	}
+
 	cur = &fork->extents[0];
 
 	seg1 = le64_to_cpu(cur->seg_id);
@@ -3075,6 +3695,11 @@ int ssdfs_add_tail_extent_into_fork(u64 blk,
 		return -ERANGE;
 	}
 
+	if (valid_extents == SSDFS_INLINE_EXTENTS_COUNT) {
+		/* try to free a slot for the new extent */
+		valid_extents -= ssdfs_compact_fork_extents(fork);
+	}
+
 	cur = &fork->extents[valid_extents - 1];
 
 	seg1 = le64_to_cpu(cur->seg_id);
@@ -4578,6 +5203,7 @@ int __ssdfs_extents_tree_add_extent(struct ssdfs_extents_btree_info *tree,
 	}
 
 finish_add_extent:
+	ssdfs_extmap_cache_invalidate(tree);
 	up_write(&tree->lock);
 	up_read(&ii->lock);
 
@@ -4884,6 +5510,8 @@ finish_change_generic_fork:
 		break;
 	}
 
+	ssdfs_extmap_cache_invalidate(tree);
+
 	return err;
 }
 
@@ -5335,6 +5963,7 @@ int ssdfs_extents_tree_move_extent(struct ssdfs_extents_btree_info *tree,
 	}
 
 finish_change_fork:
+	ssdfs_extmap_cache_invalidate(tree);
 	up_write(&tree->lock);
 
 	ssdfs_btree_search_forget_parent_node(search);
@@ -6463,6 +7092,7 @@ finish_truncate_inline_fork:
 		}
 
 finish_truncate_generic_fork:
+		ssdfs_extmap_cache_invalidate(tree);
 		up_read(&tree->lock);
 
 		ssdfs_btree_search_forget_parent_node(search);
@@ -6501,6 +7131,8 @@ finish_truncate_generic_fork:
 		break;
 	}
 
+	ssdfs_extmap_cache_invalidate(tree);
+
 	return err;
 }
 
@@ -6746,6 +7378,8 @@ finish_delete_generic_extent:
 		break;
 	}
 
+	ssdfs_extmap_cache_invalidate(tree);
+
 	return err;
 }
 
@@ -6982,6 +7616,8 @@ int ssdfs_extents_tree_delete_all(struct ssdfs_extents_btree_info *tree)
 		break;
 	}
 
+	ssdfs_extmap_cache_invalidate(tree);
+
 	return err;
 }
 
@@ -7331,8 +7967,8 @@ int ssdfs_extents_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	err = ssdfs_btree_pre_flush_root_node(node);
 	if (unlikely(err)) {
@@ -7341,7 +7977,7 @@ int ssdfs_extents_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 			  node->node_id, err);
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	return err;
@@ -7550,7 +8186,7 @@ int ssdfs_extents_btree_create_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 	down_write(&node->bmap_array.lock);
 
 	switch (atomic_read(&node->type)) {
@@ -7763,7 +8399,7 @@ int ssdfs_extents_btree_create_node(struct ssdfs_btree_node *node)
 
 finish_create_node:
 	up_write(&node->bmap_array.lock);
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		return err;
@@ -7878,7 +8514,7 @@ int ssdfs_extents_btree_init_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	if (pagevec_count(&node->content.pvec) == 0) {
 		err = -ERANGE;
@@ -7913,7 +8549,7 @@ int ssdfs_extents_btree_init_node(struct ssdfs_btree_node *node)
 		goto finish_init_operation;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&node->raw.extents_header, 0, hdr_size,
 		     hdr, 0, hdr_size,
@@ -8104,7 +8740,7 @@ int ssdfs_extents_btree_init_node(struct ssdfs_btree_node *node)
 	}
 
 finish_header_init:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_init_operation;
@@ -8255,7 +8891,7 @@ int ssdfs_extents_btree_add_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	switch (atomic_read(&node->items_area.state)) {
 	case SSDFS_BTREE_NODE_ITEMS_AREA_EXIST:
@@ -8278,7 +8914,7 @@ int ssdfs_extents_btree_add_node(struct ssdfs_btree_node *node)
 	}
 
 finish_add_node:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (err)
 		return err;
@@ -8417,8 +9053,8 @@ int ssdfs_extents_btree_pre_flush_node(struct ssdfs_btree_node *node)
 					 buffer.tree);
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&extents_header, 0, hdr_size,
 		     &node->raw.extents_header, 0, hdr_size,
@@ -8542,7 +9178,8 @@ int ssdfs_extents_btree_pre_flush_node(struct ssdfs_btree_node *node)
 	}
 
 	extents_header.node.check.bytes = cpu_to_le16((u16)hdr_size);
-	extents_header.node.check.flags = cpu_to_le16(SSDFS_CRC32);
+	extents_header.node.check.flags =
+		cpu_to_le16(ssdfs_csum_type(node->tree->fsi));
 
 	err = ssdfs_calculate_csum(&extents_header.node.check,
 				   &extents_header, hdr_size);
@@ -8556,7 +9193,7 @@ int ssdfs_extents_btree_pre_flush_node(struct ssdfs_btree_node *node)
 		     hdr_size);
 
 finish_extents_header_preparation:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_node_pre_flush;
@@ -10360,10 +10997,10 @@ int ssdfs_increase_forks_count_in_parent_nodes(struct ssdfs_btree_node *node,
 			return -ERANGE;
 		}
 
-		down_write(&parent_node->header_lock);
+		ssdfs_btree_node_header_down_write(parent_node);
 		hdr = &parent_node->raw.extents_header;
 		le32_add_cpu(&hdr->forks_count, count);
-		up_write(&parent_node->header_lock);
+		ssdfs_btree_node_header_up_write(parent_node);
 
 		node = parent_node;
 	} while (atomic_read(&node->type) != SSDFS_BTREE_ROOT_NODE);
@@ -10530,7 +11167,7 @@ int __ssdfs_extents_btree_node_insert_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -10631,7 +11268,7 @@ finish_detect_affected_items:
 		goto unlock_items_range;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("items_area.items_count %u, search->request.count %u\n",
@@ -10756,7 +11393,7 @@ finish_detect_affected_items:
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -11159,7 +11796,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 		return err;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	start_hash = node->items_area.start_hash;
 	end_hash = node->items_area.end_hash;
@@ -11299,7 +11936,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 		hdr->max_extent_blks = cpu_to_le32(max_extent_blks);
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -11427,7 +12064,7 @@ int ssdfs_define_first_invalid_index(struct ssdfs_btree_node *node,
 
 	if (!node_locked_outside) {
 		/* lock node locally */
-		down_read(&node->full_lock);
+		SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	}
 
 	down_read(&node->header_lock);
@@ -11524,7 +12161,7 @@ int ssdfs_decrease_forks_count_in_parent_nodes(struct ssdfs_btree_node *node,
 			return -ERANGE;
 		}
 
-		down_write(&parent_node->header_lock);
+		ssdfs_btree_node_header_down_write(parent_node);
 		hdr = &parent_node->raw.extents_header;
 		forks_count = le32_to_cpu(hdr->forks_count);
 		if (count > forks_count)
@@ -11533,7 +12170,7 @@ int ssdfs_decrease_forks_count_in_parent_nodes(struct ssdfs_btree_node *node,
 			forks_count -= count;
 			hdr->forks_count = cpu_to_le32(forks_count);
 		}
-		up_write(&parent_node->header_lock);
+		ssdfs_btree_node_header_up_write(parent_node);
 
 		if (unlikely(err)) {
 			SSDFS_WARN("invalid request: "
@@ -11711,13 +12348,13 @@ int ssdfs_invalidate_index_tail(struct ssdfs_btree_node *node,
 			goto finish_process_index_area;
 		}
 
-		down_write(&child->header_lock);
+		ssdfs_btree_node_header_down_write(child);
 		hdr = &child->raw.extents_header;
 		forks_count += le32_to_cpu(hdr->forks_count);
-		up_write(&child->header_lock);
+		ssdfs_btree_node_header_up_write(child);
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	for (i = index_area.index_count - 1; i >= start_index; i--) {
 		if (node_type == SSDFS_BTREE_ROOT_NODE) {
@@ -11767,7 +12404,7 @@ int ssdfs_invalidate_index_tail(struct ssdfs_btree_node *node,
 	}
 
 finish_index_deletion:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 finish_process_index_area:
 	ssdfs_unlock_whole_index_area(node);
@@ -11878,7 +12515,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		}
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	hdr = &node->raw.extents_header;
 	if (node->items_area.items_count == range_len) {
@@ -11900,7 +12537,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		break;
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -12255,7 +12892,7 @@ int ssdfs_change_item_and_invalidate_tail(struct ssdfs_btree_node *node,
 		return err;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	start_hash = node->items_area.start_hash;
 	end_hash = node->items_area.end_hash;
@@ -12369,7 +13006,7 @@ int ssdfs_change_item_and_invalidate_tail(struct ssdfs_btree_node *node,
 		hdr->max_extent_blks = cpu_to_le32(max_extent_blks);
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -12512,7 +13149,7 @@ int ssdfs_extents_btree_node_change_item(struct ssdfs_btree_node *node,
 		return -EFAULT;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -12862,7 +13499,7 @@ int __ssdfs_extents_btree_node_delete_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -13032,7 +13669,7 @@ finish_detect_affected_items:
 		}
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	if (node->items_area.items_count < range_len)
 		node->items_area.items_count = 0;
@@ -13226,7 +13863,7 @@ finish_detect_affected_items:
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -13457,7 +14094,7 @@ int ssdfs_extents_btree_node_extract_range(struct ssdfs_btree_node *node,
 		  search->node.child);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_node_extract_range(node, start_index, count,
 						sizeof(struct ssdfs_raw_fork),
 						search);
@@ -37,6 +37,49 @@ struct ssdfs_commit_queue {
 	u32 capacity;
 };
 
+/* Number of items in the cache of resolved extents */
+#define SSDFS_EXTMAP_CACHE_SIZE		(8)
+
+/*
+ * struct ssdfs_extmap_cache_item - resolved extent
+ * @file_blk: starting logical block in the file
+ * @seg_id: segment ID
+ * @seg_blk: starting logical block in the segment
+ * @len: length of the extent in blocks (zero means empty item)
+ */
+struct ssdfs_extmap_cache_item {
+	u64 file_blk;
+	u64 seg_id;
+	u32 seg_blk;
+	u32 len;
+};
+
+/*
+ * struct ssdfs_extmap_cache - cache of recently resolved extents
+ * @lock: cache's lock
+ * @version: version of the extents tree's mapping
+ * @next: index of the item for the next insertion
+ * @items: cached extents
+ *
+ * The conversion of file's logical block into the volume extent
+ * requires the search in the extents tree. The cache keeps the recently
+ * resolved extents. Any modification of the extents tree increments
+ * the version and empties the cache. An extent is added into the cache
+ * only if the version hasn't been changed since the beginning
+ * of the search.
+ */
+struct ssdfs_extmap_cache {
+	spinlock_t lock;
+	u64 version;
+	u32 next;
+	struct ssdfs_extmap_cache_item items[SSDFS_EXTMAP_CACHE_SIZE];
+};
+
+/* extent's handler prototype */
+typedef int (*ssdfs_extents_iterate_fn)(u64 file_blk,
+					struct ssdfs_raw_extent *extent,
+					void *ctx);
+
 /*
  * struct ssdfs_extents_btree_info - extents btree info
  * @type: extents btree type
@@ -51,6 +94,7 @@ struct ssdfs_commit_queue {
  * @root_buffer: buffer for root node
  * @updated_segs: updated segments queue
  * @desc: b-tree descriptor
+ * @extmap: cache of recently resolved extents
  * @owner: pointer on owner inode object
  * @fsi: pointer on shared file system object
  *
@@ -80,6 +124,7 @@ struct ssdfs_extents_btree_info {
 	struct ssdfs_commit_queue updated_segs;
 
 	struct ssdfs_extents_btree_descriptor desc;
+	struct ssdfs_extmap_cache extmap;
 	struct ssdfs_inode_info *owner;
 	struct ssdfs_fs_info *fsi;
 };
@@ -114,6 +159,7 @@ int ssdfs_extents_tree_flush(struct ssdfs_fs_info *fsi,
 			     struct ssdfs_inode_info *ii);
 int ssdfs_extents_tree_add_updated_seg_id(struct ssdfs_extents_btree_info *tree,
 					  u64 seg_id);
+int ssdfs_extents_tree_commit_updated_segs(struct ssdfs_inode_info *ii);
 
 int __ssdfs_prepare_volume_extent(struct ssdfs_fs_info *fsi,
 				  struct inode *inode,
@@ -125,6 +171,9 @@ int ssdfs_recommend_migration_extent(struct ssdfs_fs_info *fsi,
 				     struct ssdfs_segment_request *req,
 				     struct ssdfs_zone_fragment *fragment);
 bool ssdfs_extents_tree_has_logical_block(u64 blk_offset, struct inode *inode);
+int ssdfs_extents_tree_iterate(struct inode *inode,
+				u64 start_blk, u64 end_blk,
+				ssdfs_extents_iterate_fn fn, void *ctx);
 int ssdfs_extents_tree_add_extent(struct inode *inode,
 				  struct ssdfs_segment_request *req);
 int ssdfs_extents_tree_move_extent(struct ssdfs_extents_btree_info *tree,
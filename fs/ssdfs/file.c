@@ -19,6 +19,9 @@
 #include <linux/writeback.h>
 #include <linux/pagevec.h>
 #include <linux/blkdev.h>
+#include <linux/fiemap.h>
+#include <linux/falloc.h>
+#include <linux/iomap.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -122,6 +125,47 @@ bool can_file_be_inline(struct inode *inode, loff_t new_size)
 	return true;
 }
 
+/*
+ * The inline_max mount option limits the size of the files that
+ * become inline. The files that are inline already keep the whole
+ * capacity of the inode.
+ */
+static inline
+bool can_file_become_inline(struct inode *inode, loff_t new_size)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
+
+	if (!can_file_be_inline(inode, new_size))
+		return false;
+
+	if (is_ssdfs_file_inline(SSDFS_I(inode)))
+		return true;
+
+	return new_size <= fsi->inline_file_max;
+}
+
+/*
+ * The fallocate(FALLOC_FL_KEEP_SIZE) can pre-allocate blocks
+ * beyond the file's size. Such blocks are accounted in i_blocks.
+ */
+static inline
+bool ssdfs_file_has_blocks_beyond_eof(struct inode *inode)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
+	loff_t size = round_up(i_size_read(inode), fsi->pagesize);
+
+	return inode_get_bytes(inode) > size;
+}
+
+static inline
+bool is_ssdfs_file_block_pre_allocated(struct inode *inode, u64 blk)
+{
+	if (!ssdfs_file_has_blocks_beyond_eof(inode))
+		return false;
+
+	return ssdfs_extents_tree_has_logical_block(blk, inode);
+}
+
 static inline
 size_t ssdfs_inode_size_threshold(void)
 {
@@ -553,89 +597,9 @@ int ssdfs_read_folio(struct file *file, struct folio *folio)
 	return err;
 }
 
-static
-int ssdfs_check_read_request(struct ssdfs_segment_request *req)
-{
-	wait_queue_head_t *wq = NULL;
-	int err;
-
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!req);
-
-	SSDFS_DBG("req %p\n", req);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-check_req_state:
-	switch (atomic_read(&req->result.state)) {
-	case SSDFS_REQ_CREATED:
-	case SSDFS_REQ_STARTED:
-		wq = &req->private.wait_queue;
-
-		err = wait_event_killable_timeout(*wq,
-					has_request_been_executed(req),
-					SSDFS_DEFAULT_TIMEOUT);
-		if (err < 0)
-			WARN_ON(err < 0);
-		else
-			err = 0;
-
-		goto check_req_state;
-		break;
-
-	case SSDFS_REQ_FINISHED:
-		/* do nothing */
-		break;
-
-	case SSDFS_REQ_FAILED:
-		err = req->result.err;
-
-		if (!err) {
-			SSDFS_ERR("error code is absent: "
-				  "req %p, err %d\n",
-				  req, err);
-			err = -ERANGE;
-		}
-
-		SSDFS_ERR("read request is failed: "
-			  "err %d\n", err);
-		return err;
-
-	default:
-		SSDFS_ERR("invalid result's state %#x\n",
-		    atomic_read(&req->result.state));
-		return -ERANGE;
-	}
-
-	return 0;
-}
-
-static
-int ssdfs_wait_read_request_end(struct ssdfs_segment_request *req)
-{
-	int err = 0;
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("req %p\n", req);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	if (!req)
-		return 0;
-
-	err = ssdfs_check_read_request(req);
-	if (unlikely(err)) {
-		SSDFS_ERR("read request failed: "
-			  "err %d\n", err);
-	}
-
-	ssdfs_request_free(req);
-
-	return err;
-}
-
 struct ssdfs_readahead_env {
 	struct file *file;
 	unsigned mem_pages_count;
-	struct ssdfs_segment_request **reqs;
 	unsigned count;
 	unsigned capacity;
 
@@ -643,11 +607,26 @@ struct ssdfs_readahead_env {
 	struct ssdfs_logical_extent requested;
 	struct ssdfs_volume_extent place;
 	struct ssdfs_volume_extent cur_extent;
+
+	struct ssdfs_segment_info *si;
 };
 
+/*
+ * ssdfs_issue_read_request() - issue read request for readahead
+ * @env: readahead environment
+ *
+ * The request is not waited for. The read thread unlocks
+ * the pages and frees the request at the end of processing.
+ * The readers sleep on the page locks by means of the folio's
+ * wait queue, so io_uring can complete the buffered read
+ * asynchronously.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
 static
-struct ssdfs_segment_request *
-ssdfs_issue_read_request(struct ssdfs_readahead_env *env)
+int ssdfs_issue_read_request(struct ssdfs_readahead_env *env)
 {
 	struct ssdfs_fs_info *fsi;
 	struct ssdfs_segment_request *req = NULL;
@@ -678,7 +657,7 @@ ssdfs_issue_read_request(struct ssdfs_readahead_env *env)
 		err = (req == NULL ? -ENOMEM : PTR_ERR(req));
 		SSDFS_ERR("fail to allocate segment request: err %d\n",
 			  err);
-		return req;
+		return err;
 	}
 
 	ssdfs_request_init(req);
@@ -713,18 +692,33 @@ ssdfs_issue_read_request(struct ssdfs_readahead_env *env)
 		}
 	}
 
-	si = ssdfs_grab_segment(fsi, SSDFS_USER_DATA_SEG_TYPE,
-				req->place.start.seg_id, U64_MAX);
-	if (unlikely(IS_ERR_OR_NULL(si))) {
-		err = (si == NULL ? -ENOMEM : PTR_ERR(si));
-		SSDFS_ERR("fail to grab segment object: "
-			  "seg %llu, err %d\n",
-			  req->place.start.seg_id,
-			  err);
-		goto fail_issue_read_request;
+	/*
+	 * Sequential read usually reads many blocks of the same
+	 * segment. Keep the segment object between the requests
+	 * instead of looking for it for every block.
+	 */
+	si = env->si;
+	if (!si || si->seg_id != req->place.start.seg_id) {
+		if (si) {
+			ssdfs_segment_put_object(si);
+			env->si = NULL;
+		}
+
+		si = ssdfs_grab_segment(fsi, SSDFS_USER_DATA_SEG_TYPE,
+					req->place.start.seg_id, U64_MAX);
+		if (unlikely(IS_ERR_OR_NULL(si))) {
+			err = (si == NULL ? -ENOMEM : PTR_ERR(si));
+			SSDFS_ERR("fail to grab segment object: "
+				  "seg %llu, err %d\n",
+				  req->place.start.seg_id,
+				  err);
+			goto fail_issue_read_request;
+		}
+
+		env->si = si;
 	}
 
-	err = ssdfs_segment_read_block_async(si, SSDFS_REQ_ASYNC_NO_FREE, req);
+	err = ssdfs_segment_read_block_async(si, SSDFS_REQ_ASYNC, req);
 	if (unlikely(err)) {
 		SSDFS_ERR("read request failed: "
 			  "ino %llu, logical_offset %llu, size %u, err %d\n",
@@ -733,15 +727,13 @@ ssdfs_issue_read_request(struct ssdfs_readahead_env *env)
 		goto fail_issue_read_request;
 	}
 
-	ssdfs_segment_put_object(si);
-
-	return req;
+	return 0;
 
 fail_issue_read_request:
 	ssdfs_put_request(req);
 	ssdfs_request_free(req);
 
-	return ERR_PTR(err);
+	return err;
 }
 
 static
@@ -827,12 +819,8 @@ int ssdfs_readahead_block(struct ssdfs_readahead_env *env)
 	env->place.start.blk_index++;
 	env->place.len--;
 
-	env->reqs[env->count] = ssdfs_issue_read_request(env);
-	if (IS_ERR_OR_NULL(env->reqs[env->count])) {
-		err = (env->reqs[env->count] == NULL ? -ENOMEM :
-					PTR_ERR(env->reqs[env->count]));
-		env->reqs[env->count] = NULL;
-
+	err = ssdfs_issue_read_request(env);
+	if (unlikely(err)) {
 		if (err == -ENODATA) {
 #ifdef CONFIG_SSDFS_DEBUG
 			SSDFS_DBG("no data for the block: "
@@ -876,6 +864,10 @@ fail_readahead_block:
  * after starting I/O on each page. Usually the page will be
  * unlocked by the I/O completion handler. The ssdfs_readahead()
  * is only used for read-ahead, so read errors are ignored.
+ * The ssdfs_readahead() doesn't wait the end of read requests.
+ * It makes possible the nonblocking buffered read (IOCB_NOWAIT)
+ * and the waiting of page unlocking through folio's wait queue
+ * (IOCB_WAITQ).
  */
 static
 void ssdfs_readahead(struct readahead_control *rac)
@@ -890,7 +882,6 @@ void ssdfs_readahead(struct readahead_control *rac)
 	loff_t logical_offset;
 	loff_t file_size;
 	unsigned i, j;
-	int res;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -916,18 +907,11 @@ void ssdfs_readahead(struct readahead_control *rac)
 	env.capacity = env.mem_pages_count + mem_pages_per_block - 1;
 	env.capacity /= mem_pages_per_block;
 
-	env.reqs = ssdfs_file_kcalloc(env.capacity,
-				  sizeof(struct ssdfs_segment_request *),
-				  GFP_KERNEL);
-	if (!env.reqs) {
-		SSDFS_ERR("fail to allocate requests array\n");
-		return;
-	}
-
 	pagevec_init(&env.pvec);
 	memset(&env.requested, 0, sizeof(struct ssdfs_logical_extent));
 	memset(&env.place, 0, sizeof(struct ssdfs_volume_extent));
 	memset(&env.cur_extent, 0, sizeof(struct ssdfs_volume_extent));
+	env.si = NULL;
 
 	for (i = 0; i < env.capacity; i++) {
 		pagevec_reinit(&env.pvec);
@@ -976,24 +960,8 @@ void ssdfs_readahead(struct readahead_control *rac)
 		}
 	}
 
-	for (i = 0; i < env.count; i++) {
-		res = ssdfs_wait_read_request_end(env.reqs[i]);
-		if (res) {
-#ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("waiting has finished with issue: "
-				  "index %u, err %d\n",
-				  i, res);
-#endif /* CONFIG_SSDFS_DEBUG */
-		}
-
-		if (err == 0)
-			err = res;
-
-		env.reqs[i] = NULL;
-	}
-
-	if (env.reqs)
-		ssdfs_file_kfree(env.reqs);
+	if (env.si)
+		ssdfs_segment_put_object(env.si);
 
 	if (err) {
 #ifdef CONFIG_SSDFS_DEBUG
@@ -1179,6 +1147,7 @@ int ssdfs_wait_write_pool_requests_end(struct ssdfs_segment_request_pool *pool)
 	}
 
 	switch (pool->req_class) {
+	case SSDFS_PEB_PRE_ALLOCATE_DATA_REQ:
 	case SSDFS_PEB_CREATE_DATA_REQ:
 	case SSDFS_PEB_UPDATE_REQ:
 		/* expected class */
@@ -1326,6 +1295,39 @@ void ssdfs_clean_failed_request_pool(struct ssdfs_segment_request_pool *pool)
 	}
 }
 
+/*
+ * ssdfs_account_updated_segment() - remember segment with updated blocks
+ * @inode: pointer on VFS inode
+ * @seg_id: segment ID
+ *
+ * The update of existing blocks doesn't change the extents tree.
+ * But fsync() has to commit the log of the segment that keeps
+ * the updated blocks. The segment ID is stored into the commit
+ * queue of the extents tree for this purpose.
+ */
+static
+int ssdfs_account_updated_segment(struct inode *inode, u64 seg_id)
+{
+	struct ssdfs_extents_btree_info *etree;
+	int err;
+
+	etree = SSDFS_EXTREE(SSDFS_I(inode));
+	if (!etree)
+		return 0;
+
+	down_write(&etree->lock);
+	err = ssdfs_extents_tree_add_updated_seg_id(etree, seg_id);
+	up_write(&etree->lock);
+
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to add updated segment in queue: "
+			  "ino %lu, seg_id %llu, err %d\n",
+			  inode->i_ino, seg_id, err);
+	}
+
+	return err;
+}
+
 /*
  * ssdfs_update_block() - update block.
  * @fsi: pointer on shared file system object
@@ -1417,6 +1419,10 @@ int ssdfs_update_block(struct ssdfs_fs_info *fsi,
 			  batch->requested_extent.logical_offset,
 			  batch->requested_extent.data_bytes,
 			  err);
+	} else {
+		/* update history defines temperature of new data */
+		atomic_inc(&SSDFS_I(inode)->updates_count);
+		err = ssdfs_account_updated_segment(inode, si->seg_id);
 	}
 
 	ssdfs_segment_put_object(si);
@@ -1440,6 +1446,7 @@ int ssdfs_update_extent(struct ssdfs_fs_info *fsi,
 	struct page *page;
 	struct inode *inode;
 	u32 mem_pages;
+	int res;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -1510,6 +1517,17 @@ int ssdfs_update_extent(struct ssdfs_fs_info *fsi,
 		else
 			BUG();
 
+		if (!err)
+			atomic_inc(&SSDFS_I(inode)->updates_count);
+
+		if (!err || err == -EAGAIN) {
+			/* the extent could be processed partially */
+			res = ssdfs_account_updated_segment(inode,
+							    si->seg_id);
+			if (unlikely(res))
+				err = res;
+		}
+
 		ssdfs_segment_put_object(si);
 
 		if (err == -EAGAIN) {
@@ -1848,26 +1866,24 @@ int ssdfs_issue_async_write_request(struct ssdfs_fs_info *fsi,
 	BUG_ON(!wbc || !pool || !batch);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	if (req_type == SSDFS_BLOCK_BASED_REQUEST) {
-		err = ssdfs_issue_async_block_write_request(wbc, pool, batch);
-		if (err == -EAGAIN) {
-			wake_up_all(&fsi->pending_wq);
-
-			err = ssdfs_wait_write_pool_requests_end(pool);
-			if (unlikely(err)) {
-				SSDFS_ERR("write request failed: err %d\n",
-					  err);
-				return err;
-			}
-
+	/*
+	 * The batch keeps the whole contiguous run of dirty pages.
+	 * Every call creates the requests for the runs that can be
+	 * allocated in the current segment. The -EAGAIN means that
+	 * the pool is full. The rest of the batch is processed
+	 * after the end of pool's requests.
+	 */
+	do {
+		if (req_type == SSDFS_BLOCK_BASED_REQUEST) {
 			err = ssdfs_issue_async_block_write_request(wbc,
 								pool, batch);
-		}
-	} else if (req_type == SSDFS_EXTENT_BASED_REQUEST) {
-		err = ssdfs_issue_async_extent_write_request(wbc, pool, batch);
-		if (err == -EAGAIN) {
-			wake_up_all(&fsi->pending_wq);
+		} else if (req_type == SSDFS_EXTENT_BASED_REQUEST) {
+			err = ssdfs_issue_async_extent_write_request(wbc,
+								pool, batch);
+		} else
+			BUG();
 
+		if (err == -EAGAIN) {
 			err = ssdfs_wait_write_pool_requests_end(pool);
 			if (unlikely(err)) {
 				SSDFS_ERR("write request failed: err %d\n",
@@ -1875,19 +1891,15 @@ int ssdfs_issue_async_write_request(struct ssdfs_fs_info *fsi,
 				return err;
 			}
 
-			err = ssdfs_issue_async_extent_write_request(wbc,
-								pool, batch);
+			err = -EAGAIN;
 		}
-	} else
-		BUG();
+	} while (err == -EAGAIN);
 
 	if (err) {
 		SSDFS_ERR("fail to write async: err %d\n",
 			  err);
 	}
 
-	wake_up_all(&fsi->pending_wq);
-
 	return err;
 }
 
@@ -1905,26 +1917,24 @@ int ssdfs_issue_sync_write_request(struct ssdfs_fs_info *fsi,
 	BUG_ON(!wbc || !pool || !batch);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	if (req_type == SSDFS_BLOCK_BASED_REQUEST) {
-		err = ssdfs_issue_sync_block_write_request(wbc, pool, batch);
-		if (err == -EAGAIN) {
-			wake_up_all(&fsi->pending_wq);
-
-			err = ssdfs_wait_write_pool_requests_end(pool);
-			if (unlikely(err)) {
-				SSDFS_ERR("write request failed: err %d\n",
-					  err);
-				return err;
-			}
-
+	/*
+	 * The batch keeps the whole contiguous run of dirty pages.
+	 * Every call creates the requests for the runs that can be
+	 * allocated in the current segment. The -EAGAIN means that
+	 * the pool is full. The rest of the batch is processed
+	 * after the end of pool's requests.
+	 */
+	do {
+		if (req_type == SSDFS_BLOCK_BASED_REQUEST) {
 			err = ssdfs_issue_sync_block_write_request(wbc,
 								pool, batch);
-		}
-	} else if (req_type == SSDFS_EXTENT_BASED_REQUEST) {
-		err = ssdfs_issue_sync_extent_write_request(wbc, pool, batch);
-		if (err == -EAGAIN) {
-			wake_up_all(&fsi->pending_wq);
+		} else if (req_type == SSDFS_EXTENT_BASED_REQUEST) {
+			err = ssdfs_issue_sync_extent_write_request(wbc,
+								pool, batch);
+		} else
+			BUG();
 
+		if (err == -EAGAIN) {
 			err = ssdfs_wait_write_pool_requests_end(pool);
 			if (unlikely(err)) {
 				SSDFS_ERR("write request failed: err %d\n",
@@ -1932,11 +1942,9 @@ int ssdfs_issue_sync_write_request(struct ssdfs_fs_info *fsi,
 				return err;
 			}
 
-			err = ssdfs_issue_sync_extent_write_request(wbc,
-								pool, batch);
+			err = -EAGAIN;
 		}
-	} else
-		BUG();
+	} while (err == -EAGAIN);
 
 	if (err) {
 		SSDFS_ERR("fail to write sync: err %d\n",
@@ -1964,8 +1972,6 @@ int ssdfs_issue_sync_write_request(struct ssdfs_fs_info *fsi,
 		}
 	}
 
-	wake_up_all(&fsi->pending_wq);
-
 	return err;
 }
 
@@ -2145,8 +2151,16 @@ try_add_page_into_request:
 		BUG_ON(!last_page);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-		if (logical_offset == upper_bound &&
-		    can_be_merged_into_extent(last_page, page)) {
+		if (pagevec_space(&batch->pvec) == 0) {
+			/* batch is full */
+			err = ssdfs_issue_write_request(wbc, pool, batch,
+						    SSDFS_EXTENT_BASED_REQUEST);
+			if (err)
+				goto fail_write_pages;
+			else
+				goto try_add_page_into_request;
+		} else if (logical_offset == upper_bound &&
+			   can_be_merged_into_extent(last_page, page)) {
 			err = ssdfs_dirty_pages_batch_add_page(page, batch);
 			if (err) {
 				err = ssdfs_issue_write_request(wbc,
@@ -2570,49 +2584,6 @@ continue_unlock:
 			}
 		}
 
-		if (!is_ssdfs_file_inline(ii) &&
-		    is_ssdfs_dirty_batch_not_processed(&batch)) {
-			ret = ssdfs_issue_write_request(wbc, &pool, &batch,
-						SSDFS_EXTENT_BASED_REQUEST);
-			if (ret < 0) {
-				SSDFS_ERR("ino %lu, nr_to_write %lu, "
-					  "range_start %llu, range_end %llu, "
-					  "writeback_index %llu, "
-					  "wbc->range_cyclic %#x, "
-					  "index %llu, end %llu, "
-					  "done_index %llu\n",
-					  ino, wbc->nr_to_write,
-					  (u64)wbc->range_start,
-					  (u64)wbc->range_end,
-					  (u64)mapping->writeback_index,
-					  wbc->range_cyclic,
-					  (u64)index, (u64)end,
-					  (u64)done_index);
-
-				for (i = 0; i < pagevec_count(&batch.pvec); i++) {
-					struct page *page;
-
-					page = batch.pvec.pages[i];
-
-#ifdef CONFIG_SSDFS_DEBUG
-					BUG_ON(!page);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-					SSDFS_ERR("page %p, index %d, "
-						  "page->index %ld, "
-						  "PageLocked %#x, "
-						  "PageDirty %#x, "
-						  "PageWriteback %#x\n",
-						  page, i, page->index,
-						  PageLocked(page),
-						  PageDirty(page),
-						  PageWriteback(page));
-				}
-
-				goto out_writepages;
-			}
-		}
-
 		index = done_index;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -2624,6 +2595,55 @@ continue_unlock:
 		cond_resched();
 	};
 
+	/*
+	 * The dirty batch is kept between the lookups of dirty pages.
+	 * The pages are allocated on the volume only when the batch is
+	 * full or the contiguous range of dirty pages ends. As a result,
+	 * the file receives the extents as large as possible.
+	 */
+	if (!is_ssdfs_file_inline(ii) &&
+	    is_ssdfs_dirty_batch_not_processed(&batch)) {
+		ret = ssdfs_issue_write_request(wbc, &pool, &batch,
+					SSDFS_EXTENT_BASED_REQUEST);
+		if (ret < 0) {
+			SSDFS_ERR("ino %lu, nr_to_write %lu, "
+				  "range_start %llu, range_end %llu, "
+				  "writeback_index %llu, "
+				  "wbc->range_cyclic %#x, "
+				  "index %llu, end %llu, "
+				  "done_index %llu\n",
+				  ino, wbc->nr_to_write,
+				  (u64)wbc->range_start,
+				  (u64)wbc->range_end,
+				  (u64)mapping->writeback_index,
+				  wbc->range_cyclic,
+				  (u64)index, (u64)end,
+				  (u64)done_index);
+
+			for (i = 0; i < pagevec_count(&batch.pvec); i++) {
+				struct page *page;
+
+				page = batch.pvec.pages[i];
+
+#ifdef CONFIG_SSDFS_DEBUG
+				BUG_ON(!page);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+				SSDFS_ERR("page %p, index %d, "
+					  "page->index %ld, "
+					  "PageLocked %#x, "
+					  "PageDirty %#x, "
+					  "PageWriteback %#x\n",
+					  page, i, page->index,
+					  PageLocked(page),
+					  PageDirty(page),
+					  PageWriteback(page));
+			}
+
+			goto out_writepages;
+		}
+	}
+
 	if (!ret) {
 		ret = ssdfs_wait_write_pool_requests_end(&pool);
 		if (unlikely(ret)) {
@@ -2667,27 +2687,119 @@ static void ssdfs_write_failed(struct address_space *mapping, loff_t to)
 }
 
 /*
- * The ssdfs_write_begin() is called by the generic
- * buffered write code to ask the filesystem to prepare
- * to write len bytes at the given offset in the file.
+ * ssdfs_estimate_flush_throughput() - estimate user data flush throughput
+ * @fsi: pointer on shared file system object
+ *
+ * This function recalculates the throughput of user data flush
+ * requests not more frequently than once per second. The estimation
+ * is smoothed by the previous value.
+ *
+ * RETURN: number of finished user data flush requests per second.
  */
 static
-int ssdfs_write_begin(struct file *file, struct address_space *mapping,
-		      loff_t pos, unsigned len,
-		      struct page **pagep, void **fsdata)
+u64 ssdfs_estimate_flush_throughput(struct ssdfs_fs_info *fsi)
 {
-	struct inode *inode = mapping->host;
-	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
-	struct ssdfs_inode_info *ii = SSDFS_I(inode);
-	struct page *page;
-	pgoff_t index = pos >> PAGE_SHIFT;
-	unsigned blks = 0;
-	loff_t start_blk, end_blk, cur_blk;
-	u64 last_blk = U64_MAX;
-#ifdef CONFIG_SSDFS_DEBUG
-	u64 free_pages = 0;
+	struct ssdfs_write_throttle *throttle = &fsi->write_throttle;
+	unsigned long stamp = atomic_long_read(&throttle->stamp);
+	unsigned long now = jiffies;
+	u64 old_rate = atomic64_read(&throttle->reqs_per_sec);
+	u64 finished;
+	u64 rate;
+
+	if (time_before(now, stamp + HZ))
+		return old_rate;
+
+	if (atomic_long_cmpxchg(&throttle->stamp, stamp, now) != stamp) {
+		/* another writer has estimated the throughput */
+		return atomic64_read(&throttle->reqs_per_sec);
+	}
+
+	finished = atomic64_xchg(&throttle->finished_reqs, 0);
+	rate = div64_u64(finished * HZ, now - stamp);
+
+	if (old_rate != 0)
+		rate = div64_u64((old_rate * 3) + rate, 4);
+
+	atomic64_set(&throttle->reqs_per_sec, rate);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("finished %llu, old_rate %llu, rate %llu\n",
+		  finished, old_rate, rate);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return rate;
+}
+
+/*
+ * ssdfs_throttle_writer() - pace writer by user data flush throughput
+ * @fsi: pointer on shared file system object
+ *
+ * The generic balance_dirty_pages() doesn't know about the requests
+ * that are waiting in the queues of flush threads. If the backlog
+ * of user data flush requests needs more than the target time
+ * for draining, then the writer waits the end of flush requests.
+ * The waiting is limited by the target time. So, the writer
+ * makes progress even if the flush threads are stuck.
+ */
+static
+void ssdfs_throttle_writer(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_write_throttle *throttle = &fsi->write_throttle;
+	struct percpu_counter *backlog = &fsi->flushing_user_data_requests;
+	wait_queue_head_t *wq = &fsi->finish_user_data_flush_wq;
+	unsigned int target_msecs;
+	s64 limit;
+	u64 rate;
+
+	target_msecs = atomic_read(&throttle->target_msecs);
+	if (target_msecs == 0)
+		return;
+
+	limit = atomic_read(&throttle->min_reqs);
+
+	if (percpu_counter_read_positive(backlog) <= limit)
+		return;
+
+	rate = ssdfs_estimate_flush_throughput(fsi);
+	limit = max_t(s64, limit,
+			div_u64(rate * target_msecs, MSEC_PER_SEC));
+
+	if (percpu_counter_compare(backlog, limit) <= 0)
+		return;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("throttle writer: backlog %lld, limit %lld, rate %llu\n",
+		  percpu_counter_read_positive(backlog), limit, rate);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	wait_event_killable_timeout(*wq,
+			percpu_counter_read_positive(backlog) <= limit,
+			msecs_to_jiffies(target_msecs));
+}
+
+/*
+ * The ssdfs_write_begin() is called by the generic
+ * buffered write code to ask the filesystem to prepare
+ * to write len bytes at the given offset in the file.
+ */
+static
+int ssdfs_write_begin(struct file *file, struct address_space *mapping,
+		      loff_t pos, unsigned len,
+		      struct page **pagep, void **fsdata)
+{
+	struct inode *inode = mapping->host;
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+	struct page *page;
+	pgoff_t index = pos >> PAGE_SHIFT;
+	unsigned blks = 0;
+	loff_t start_blk, end_blk, cur_blk;
+	u64 last_blk = U64_MAX;
+#ifdef CONFIG_SSDFS_DEBUG
+	u64 free_pages = 0;
 #endif /* CONFIG_SSDFS_DEBUG */
 	bool is_new_blk = false;
+	bool was_inline;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -2703,6 +2815,8 @@ int ssdfs_write_begin(struct file *file, struct address_space *mapping,
 		  inode->i_ino, index);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	ssdfs_throttle_writer(fsi);
+
 	page = grab_cache_page_write_begin(mapping, index);
 	if (!page) {
 		SSDFS_ERR("fail to grab page: index %lu\n",
@@ -2717,7 +2831,9 @@ int ssdfs_write_begin(struct file *file, struct address_space *mapping,
 
 	ssdfs_account_locked_page(page);
 
-	if (can_file_be_inline(inode, pos + len)) {
+	was_inline = is_ssdfs_file_inline(ii);
+
+	if (can_file_become_inline(inode, pos + len)) {
 		if (!ii->inline_file) {
 			err = ssdfs_allocate_inline_file_buffer(inode);
 			if (unlikely(err)) {
@@ -2741,7 +2857,7 @@ try_regular_write:
 		start_blk = pos >> fsi->log_pagesize;
 		end_blk = (pos + len) >> fsi->log_pagesize;
 
-		if (can_file_be_inline(inode, i_size_read(inode))) {
+		if (was_inline) {
 #ifdef CONFIG_SSDFS_DEBUG
 			SSDFS_DBG("change from inline to regular file: "
 				  "old_size %llu, new_size %llu\n",
@@ -2768,6 +2884,10 @@ try_regular_write:
 			else
 				is_new_blk = cur_blk > last_blk;
 
+			if (is_new_blk &&
+			    is_ssdfs_file_block_pre_allocated(inode, cur_blk))
+				is_new_blk = false;
+
 #ifdef CONFIG_SSDFS_DEBUG
 			SSDFS_DBG("cur_blk %llu, is_new_blk %#x, blks %u\n",
 				  (u64)cur_blk, is_new_blk, blks);
@@ -2783,18 +2903,16 @@ try_regular_write:
 				}
 
 #ifdef CONFIG_SSDFS_DEBUG
-				spin_lock(&fsi->volume_state_lock);
-				free_pages = fsi->free_pages;
-				spin_unlock(&fsi->volume_state_lock);
+				free_pages =
+				    ssdfs_fs_counter_read(&fsi->free_pages);
 
 				SSDFS_DBG("free_pages %llu, blks %u, err %d\n",
 					  free_pages, blks, err);
 #endif /* CONFIG_SSDFS_DEBUG */
 
 				if (err) {
-					spin_lock(&fsi->volume_state_lock);
-					fsi->free_pages += blks;
-					spin_unlock(&fsi->volume_state_lock);
+					percpu_counter_add(&fsi->free_pages,
+							   blks);
 
 					ssdfs_unlock_page(page);
 					ssdfs_put_page(page);
@@ -2910,6 +3028,215 @@ out:
 	return err ? err : copied;
 }
 
+/*
+ * ssdfs_direct_read_block() - read block of file bypassing page cache
+ * @fsi: pointer on shared file system object
+ * @inode: pointer on VFS inode
+ * @blk: logical block in the file
+ * @offset: offset in the block
+ * @bytes: number of bytes to copy
+ * @iter: destination iterator
+ *
+ * This method reads the block into private memory pages of the request
+ * and copies the requested portion into @iter. A hole is reported
+ * as zeroed data.
+ *
+ * RETURN:
+ * [success] - number of copied bytes.
+ * [failure] - error code.
+ */
+static
+ssize_t ssdfs_direct_read_block(struct ssdfs_fs_info *fsi,
+				struct inode *inode,
+				u64 blk, u32 offset, size_t bytes,
+				struct iov_iter *iter)
+{
+	struct ssdfs_segment_request *req;
+	struct ssdfs_segment_info *si;
+	struct ssdfs_logical_extent extent;
+	struct ssdfs_volume_extent place;
+	u32 mem_pages = (fsi->pagesize + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	size_t copied = 0;
+	u32 i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("ino %lu, blk %llu, offset %u, bytes %zu\n",
+		  inode->i_ino, blk, offset, bytes);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	extent.ino = inode->i_ino;
+	extent.logical_offset = blk << fsi->log_pagesize;
+	extent.data_bytes = fsi->pagesize;
+	extent.cno = 0;
+	extent.parent_snapshot = 0;
+
+	err = __ssdfs_prepare_volume_extent(fsi, inode, &extent, &place);
+	if (err == -EAGAIN) {
+		/* only one block is necessary */
+		err = 0;
+	} else if (err == -ENODATA) {
+		/* hole */
+		return iov_iter_zero(bytes, iter);
+	} else if (unlikely(err)) {
+		SSDFS_ERR("fail to prepare volume extent: "
+			  "ino %lu, blk %llu, err %d\n",
+			  inode->i_ino, blk, err);
+		return err;
+	}
+
+	req = ssdfs_request_alloc();
+	if (IS_ERR_OR_NULL(req)) {
+		err = (req == NULL ? -ENOMEM : PTR_ERR(req));
+		SSDFS_ERR("fail to allocate segment request: err %d\n",
+			  err);
+		return err;
+	}
+
+	ssdfs_request_init(req);
+	ssdfs_get_request(req);
+
+	ssdfs_request_prepare_logical_extent(extent.ino,
+					     extent.logical_offset,
+					     extent.data_bytes,
+					     0, 0, req);
+	ssdfs_request_define_volume_extent(place.start.blk_index, 1, req);
+
+	for (i = 0; i < mem_pages; i++) {
+		err = ssdfs_request_add_allocated_page_locked(req);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to allocate memory page: err %d\n",
+				  err);
+			goto finish_read_block;
+		}
+	}
+
+	si = ssdfs_grab_segment(fsi, SSDFS_USER_DATA_SEG_TYPE,
+				place.start.seg_id, U64_MAX);
+	if (unlikely(IS_ERR_OR_NULL(si))) {
+		err = (si == NULL ? -ENOMEM : PTR_ERR(si));
+		SSDFS_ERR("fail to grab segment object: "
+			  "seg %llu, err %d\n",
+			  place.start.seg_id, err);
+		goto finish_read_block;
+	}
+
+	err = ssdfs_segment_read_block_sync(si, req);
+	if (!err)
+		err = SSDFS_WAIT_COMPLETION(&req->result.wait);
+	if (!err)
+		err = req->result.err;
+
+	ssdfs_segment_put_object(si);
+
+	if (unlikely(err)) {
+		SSDFS_ERR("read request failed: "
+			  "ino %lu, blk %llu, err %d\n",
+			  inode->i_ino, blk, err);
+		goto finish_read_block;
+	}
+
+	while (copied < bytes) {
+		struct page *page;
+		u32 page_index = (offset + copied) >> PAGE_SHIFT;
+		u32 page_off = (offset + copied) & (PAGE_SIZE - 1);
+		size_t len = min_t(size_t, bytes - copied,
+					PAGE_SIZE - page_off);
+		size_t res;
+
+		if (page_index >= pagevec_count(&req->result.pvec)) {
+			err = -ERANGE;
+			SSDFS_ERR("invalid page index %u\n",
+				  page_index);
+			goto finish_read_block;
+		}
+
+		page = req->result.pvec.pages[page_index];
+
+		res = copy_page_to_iter(page, page_off, len, iter);
+		copied += res;
+
+		if (res < len) {
+			err = -EFAULT;
+			break;
+		}
+	}
+
+finish_read_block:
+	ssdfs_request_unlock_and_remove_pages(req);
+	ssdfs_put_request(req);
+	ssdfs_request_free(req);
+
+	if (copied > 0)
+		return copied;
+
+	return err;
+}
+
+/*
+ * ssdfs_direct_read() - read file's content bypassing page cache
+ * @iocb: kernel I/O control block
+ * @iter: destination iterator
+ */
+static
+ssize_t ssdfs_direct_read(struct kiocb *iocb, struct iov_iter *iter)
+{
+	struct inode *inode = file_inode(iocb->ki_filp);
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+	loff_t pos = iocb->ki_pos;
+	loff_t isize;
+	ssize_t copied = 0;
+	ssize_t res = 0;
+
+	inode_lock_shared(inode);
+
+	if (is_ssdfs_file_inline(ii)) {
+		/* inline file's content is read by buffered I/O */
+		goto finish_direct_read;
+	}
+
+	isize = i_size_read(inode);
+
+	while (iov_iter_count(iter) > 0 && pos < isize) {
+		u64 blk = (u64)pos >> fsi->log_pagesize;
+		u32 offset = (u32)(pos & (fsi->pagesize - 1));
+		size_t bytes;
+
+		bytes = min_t(size_t, fsi->pagesize - offset,
+				iov_iter_count(iter));
+		bytes = min_t(size_t, bytes, isize - pos);
+
+		res = ssdfs_direct_read_block(fsi, inode, blk,
+					      offset, bytes, iter);
+		if (res <= 0)
+			break;
+
+		pos += res;
+		copied += res;
+
+		if (res < bytes)
+			break;
+
+		if (fatal_signal_pending(current)) {
+			res = -EINTR;
+			break;
+		}
+
+		cond_resched();
+	}
+
+	iocb->ki_pos = pos;
+
+finish_direct_read:
+	inode_unlock_shared(inode);
+
+	if (copied > 0)
+		return copied;
+
+	return res;
+}
+
 /*
  * The ssdfs_direct_IO() is called by the generic read/write
  * routines to perform direct_IO - that is IO requests which
@@ -2918,58 +3245,959 @@ out:
  */
 static ssize_t ssdfs_direct_IO(struct kiocb *iocb, struct iov_iter *iter)
 {
-	/* TODO: implement */
-	return -ERANGE;
+	if (iov_iter_rw(iter) == WRITE) {
+		/*
+		 * The generic code falls back to buffered write.
+		 * Then it writes back and invalidates the written
+		 * range of the page cache.
+		 */
+		return 0;
+	}
+
+	return ssdfs_direct_read(iocb, iter);
 }
 
 /*
- * The ssdfs_fsync() is called by the fsync(2) system call.
+ * ssdfs_issue_group_flush() - flush device cache on behalf of a group
+ * @fsi: pointer on shared file system object
+ *
+ * This function guarantees that device cache flush has been
+ * started after the call and has been finished before the return.
+ * Concurrent callers share one flush operation instead of issuing
+ * a series of serialized flushes.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code of device cache flush.
  */
-int ssdfs_fsync(struct file *file, loff_t start, loff_t end, int datasync)
+static
+int ssdfs_issue_group_flush(struct ssdfs_fs_info *fsi)
 {
-	struct inode *inode = file->f_mapping->host;
+	struct ssdfs_cache_flush_group *group = &fsi->flush_group;
+	u64 target;
 	int err;
 
+	target = atomic64_read(&group->started) + 1;
+
+	mutex_lock(&group->lock);
+
+	if (atomic64_read(&group->finished) >= target) {
+		err = group->err;
 #ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("ino %lu, start %llu, end %llu, datasync %#x\n",
-		  (unsigned long)inode->i_ino, (unsigned long long)start,
-		  (unsigned long long)end, datasync);
+		SSDFS_DBG("flush has been done by group: "
+			  "target %llu, err %d\n",
+			  target, err);
 #endif /* CONFIG_SSDFS_DEBUG */
+		goto finish_flush;
+	}
 
-	trace_ssdfs_sync_file_enter(inode);
+	target = atomic64_inc_return(&group->started);
+	err = blkdev_issue_flush(fsi->sb->s_bdev);
+	group->err = err;
+	atomic64_set(&group->finished, target);
+
+finish_flush:
+	mutex_unlock(&group->lock);
+
+	return err;
+}
+
+/*
+ * struct ssdfs_iomap_env - extent lookup environment
+ * @is_found: has the extent been found?
+ * @file_blk: starting logical block of the extent in the file
+ * @extent: found extent
+ */
+struct ssdfs_iomap_env {
+	bool is_found;
+	u64 file_blk;
+	struct ssdfs_raw_extent extent;
+};
+
+/*
+ * ssdfs_iomap_find_extent() - save the first extent of the range
+ * @file_blk: starting logical block of the extent in the file
+ * @extent: raw extent
+ * @ctx: pointer on extent lookup environment
+ */
+static
+int ssdfs_iomap_find_extent(u64 file_blk, struct ssdfs_raw_extent *extent,
+			    void *ctx)
+{
+	struct ssdfs_iomap_env *env = (struct ssdfs_iomap_env *)ctx;
+
+	env->is_found = true;
+	env->file_blk = file_blk;
+	env->extent = *extent;
+
+	return 1;
+}
+
+/*
+ * ssdfs_iomap_report_begin() - map the file's range for reporting
+ * @inode: pointer on VFS inode
+ * @pos: starting offset in the file
+ * @length: length of the range in bytes
+ * @flags: iomap flags
+ * @iomap: mapping of the range [out]
+ * @srcmap: source mapping (unused)
+ *
+ * This method finds the extent that contains @pos or the hole
+ * before the next extent. The physical address is the offset of
+ * the logical block on the volume, as it is reported by FIEMAP.
+ * The mapping is used only for FIEMAP and SEEK_DATA/SEEK_HOLE.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - internal error.
+ * %-ENOMEM     - fail to allocate memory.
+ */
+static
+int ssdfs_iomap_report_begin(struct inode *inode, loff_t pos, loff_t length,
+			     unsigned int flags, struct iomap *iomap,
+			     struct iomap *srcmap)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+	struct ssdfs_iomap_env env;
+	loff_t isize;
+	u64 blk, end_blk;
+	u64 seg_id, volume_blk;
+	u32 extent_off, len;
+	int err;
 
-	err = filemap_write_and_wait_range(inode->i_mapping, start, end);
-	if (err) {
-		trace_ssdfs_sync_file_exit(file, datasync, err);
 #ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("fsync failed: ino %lu, start %llu, "
-			  "end %llu, err %d\n",
-			  (unsigned long)inode->i_ino,
-			  (unsigned long long)start,
-			  (unsigned long long)end,
-			  err);
+	SSDFS_DBG("ino %lu, pos %lld, length %lld, flags %#x\n",
+		  inode->i_ino, pos, length, flags);
 #endif /* CONFIG_SSDFS_DEBUG */
+
+	iomap->bdev = inode->i_sb->s_bdev;
+	iomap->flags = 0;
+
+	isize = i_size_read(inode);
+	blk = (u64)pos >> fsi->log_pagesize;
+
+	if (pos >= isize) {
+		iomap->type = IOMAP_HOLE;
+		iomap->addr = IOMAP_NULL_ADDR;
+		iomap->offset = pos;
+		iomap->length = length;
+		return 0;
+	}
+
+	if (is_ssdfs_file_inline(ii)) {
+		iomap->type = IOMAP_INLINE;
+		iomap->addr = IOMAP_NULL_ADDR;
+		iomap->inline_data = ii->inline_file;
+		iomap->offset = 0;
+		iomap->length = isize;
+		return 0;
+	}
+
+	env.is_found = false;
+	end_blk = (u64)(isize - 1) >> fsi->log_pagesize;
+
+	err = ssdfs_extents_tree_iterate(inode, blk, end_blk,
+					 ssdfs_iomap_find_extent, &env);
+	if (err < 0) {
+		SSDFS_ERR("fail to iterate extents: "
+			  "ino %lu, pos %lld, err %d\n",
+			  inode->i_ino, pos, err);
 		return err;
 	}
 
-	inode_lock(inode);
-	sync_inode_metadata(inode, 1);
-	blkdev_issue_flush(inode->i_sb->s_bdev);
-	inode_unlock(inode);
+	iomap->offset = (loff_t)blk << fsi->log_pagesize;
 
-	trace_ssdfs_sync_file_exit(file, datasync, err);
+	if (!env.is_found) {
+		iomap->type = IOMAP_HOLE;
+		iomap->addr = IOMAP_NULL_ADDR;
+		iomap->length = pos + length - iomap->offset;
+		return 0;
+	} else if (env.file_blk > blk) {
+		iomap->type = IOMAP_HOLE;
+		iomap->addr = IOMAP_NULL_ADDR;
+		iomap->length = (loff_t)(env.file_blk - blk) <<
+							fsi->log_pagesize;
+		return 0;
+	}
 
-	return err;
+	extent_off = (u32)(blk - env.file_blk);
+	len = le32_to_cpu(env.extent.len);
+
+	if (extent_off >= len) {
+		SSDFS_ERR("invalid extent: file_blk %llu, len %u, blk %llu\n",
+			  env.file_blk, len, blk);
+		return -ERANGE;
+	}
+
+	seg_id = le64_to_cpu(env.extent.seg_id);
+	volume_blk = (seg_id * fsi->pages_per_seg) +
+			le32_to_cpu(env.extent.logical_blk) + extent_off;
+
+	iomap->type = IOMAP_MAPPED;
+	iomap->addr = volume_blk << fsi->log_pagesize;
+	iomap->length = (loff_t)(len - extent_off) << fsi->log_pagesize;
+
+	return 0;
 }
 
+static const struct iomap_ops ssdfs_iomap_report_ops = {
+	.iomap_begin	= ssdfs_iomap_report_begin,
+};
+
+/*
+ * ssdfs_seek_data_hole() - find the next data or hole
+ * @file: pointer on file object
+ * @offset: starting offset
+ * @whence: SEEK_DATA or SEEK_HOLE
+ *
+ * This method finds the next data or hole in the file
+ * by means of the iomap's iteration over the extents of the file.
+ */
+static
+loff_t ssdfs_seek_data_hole(struct file *file, loff_t offset, int whence)
+{
+	struct inode *inode = file->f_mapping->host;
+	const struct iomap_ops *ops = &ssdfs_iomap_report_ops;
+	int err;
+
+	inode_lock_shared(inode);
+
+	if (offset >= 0 && offset < i_size_read(inode)) {
+		/* dirty pages haven't got the extents yet */
+		err = filemap_write_and_wait_range(inode->i_mapping,
+						   offset, LLONG_MAX);
+		if (unlikely(err)) {
+			offset = err;
+			goto finish_seek;
+		}
+	}
+
+	switch (whence) {
+	case SEEK_DATA:
+		offset = iomap_seek_data(inode, offset, ops);
+		break;
+
+	case SEEK_HOLE:
+		offset = iomap_seek_hole(inode, offset, ops);
+		break;
+
+	default:
+		BUG();
+	}
+
+finish_seek:
+	inode_unlock_shared(inode);
+
+	if (offset < 0)
+		return offset;
+
+	return vfs_setpos(file, offset, inode->i_sb->s_maxbytes);
+}
+
+/*
+ * The ssdfs_file_llseek() is called by the lseek(2) system call.
+ */
+static
+loff_t ssdfs_file_llseek(struct file *file, loff_t offset, int whence)
+{
+	switch (whence) {
+	case SEEK_DATA:
+	case SEEK_HOLE:
+		return ssdfs_seek_data_hole(file, offset, whence);
+
+	default:
+		/* use generic implementation */
+		break;
+	}
+
+	return generic_file_llseek(file, offset, whence);
+}
+
+/*
+ * The ssdfs_fiemap() is called by the FS_IOC_FIEMAP ioctl.
+ */
+static
+int ssdfs_fiemap(struct inode *inode, struct fiemap_extent_info *fieinfo,
+		 u64 start, u64 len)
+{
+	int err;
+
+	inode_lock_shared(inode);
+	err = iomap_fiemap(inode, fieinfo, start, len,
+			   &ssdfs_iomap_report_ops);
+	inode_unlock_shared(inode);
+
+	return err;
+}
+
+/*
+ * ssdfs_inline_file_read_iter() - read inline file
+ * @iocb: kernel I/O control block
+ * @to: destination iterator
+ *
+ * This method copies the content of inline file from the inode's
+ * buffer into the user's buffer without any segment request.
+ *
+ * RETURN:
+ * [success] - number of read bytes.
+ * [failure] - negative error code.
+ */
+static
+ssize_t ssdfs_inline_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct inode *inode = file_inode(iocb->ki_filp);
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+	size_t inline_capacity;
+	loff_t pos = iocb->ki_pos;
+	loff_t size;
+	size_t count;
+	size_t copied;
+
+	inline_capacity = ssdfs_inode_inline_file_capacity(inode);
+	size = i_size_read(inode);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("ino %lu, pos %llu, size %llu, count %zu\n",
+		  inode->i_ino, (u64)pos, (u64)size,
+		  iov_iter_count(to));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (size > inline_capacity) {
+		SSDFS_ERR("file_size %llu is greater capacity %zu\n",
+			  (u64)size, inline_capacity);
+		return -E2BIG;
+	}
+
+	if (pos >= size)
+		return 0;
+
+	count = min_t(size_t, iov_iter_count(to), size - pos);
+	copied = copy_to_iter((u8 *)ii->inline_file + pos, count, to);
+	if (copied == 0)
+		return -EFAULT;
+
+	iocb->ki_pos += copied;
+	file_accessed(iocb->ki_filp);
+
+	return copied;
+}
+
+/*
+ * ssdfs_file_open() - open file
+ * @inode: inode object
+ * @file: file object
+ *
+ * The buffered read of the file doesn't wait the read requests
+ * in readahead. The page cache readers wait the page unlocking
+ * by means of folio's wait queue. It makes possible to declare
+ * the nonblocking (FMODE_NOWAIT) and asynchronous buffered
+ * read (FMODE_BUF_RASYNC) support for io_uring.
+ */
+static
+int ssdfs_file_open(struct inode *inode, struct file *file)
+{
+	int err;
+
+	err = generic_file_open(inode, file);
+	if (unlikely(err))
+		return err;
+
+	file->f_mode |= FMODE_NOWAIT | FMODE_BUF_RASYNC;
+
+	return 0;
+}
+
+/*
+ * ssdfs_file_read_iter() - read file
+ * @iocb: kernel I/O control block
+ * @to: destination iterator
+ *
+ * The inline file is read directly from the inode's buffer
+ * if the page cache is empty. Otherwise, the page cache
+ * keeps the actual state of the file.
+ *
+ * The nonblocking read (IOCB_NOWAIT) is served by the page cache.
+ * The direct I/O waits the end of read requests, so it returns
+ * -EAGAIN for the nonblocking read.
+ */
+static
+ssize_t ssdfs_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct inode *inode = file_inode(iocb->ki_filp);
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+	ssize_t ret;
+
+	if (iocb->ki_flags & IOCB_DIRECT) {
+		if (iocb->ki_flags & IOCB_NOWAIT)
+			return -EAGAIN;
+
+		return generic_file_read_iter(iocb, to);
+	}
+
+	if (!is_ssdfs_file_inline(ii))
+		return generic_file_read_iter(iocb, to);
+
+	if (!iov_iter_count(to))
+		return 0;
+
+	if (iocb->ki_flags & IOCB_NOWAIT) {
+		if (!inode_trylock_shared(inode))
+			return -EAGAIN;
+	} else
+		inode_lock_shared(inode);
+
+	if (is_ssdfs_file_inline(ii) && ii->inline_file &&
+	    inode->i_mapping->nrpages == 0) {
+		ret = ssdfs_inline_file_read_iter(iocb, to);
+		inode_unlock_shared(inode);
+		return ret;
+	}
+
+	inode_unlock_shared(inode);
+
+	return generic_file_read_iter(iocb, to);
+}
+
+/*
+ * ssdfs_inline_file_write_iter() - write inline file
+ * @iocb: kernel I/O control block
+ * @from: source iterator
+ *
+ * This method copies the user's data into the inode's buffer
+ * without any segment request. The caller has to check that
+ * the whole write fits into the inline file.
+ *
+ * RETURN:
+ * [success] - number of written bytes.
+ * [failure] - negative error code.
+ */
+static
+ssize_t ssdfs_inline_file_write_iter(struct kiocb *iocb,
+				     struct iov_iter *from)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+	loff_t pos = iocb->ki_pos;
+	loff_t size = i_size_read(inode);
+	size_t count = iov_iter_count(from);
+	size_t copied;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("ino %lu, pos %llu, size %llu, count %zu\n",
+		  inode->i_ino, (u64)pos, (u64)size, count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	err = file_remove_privs(file);
+	if (err)
+		return err;
+
+	err = file_update_time(file);
+	if (err)
+		return err;
+
+	if (!ii->inline_file) {
+		err = ssdfs_allocate_inline_file_buffer(inode);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to allocate inline buffer\n");
+			return err;
+		}
+	}
+
+	atomic_or(SSDFS_INODE_HAS_INLINE_FILE, &ii->private_flags);
+
+	if (pos > size)
+		memset((u8 *)ii->inline_file + size, 0, pos - size);
+
+	copied = copy_from_iter((u8 *)ii->inline_file + pos, count, from);
+	if (copied == 0)
+		return -EFAULT;
+
+	iocb->ki_pos += copied;
+
+	if (iocb->ki_pos > size) {
+		inode_add_bytes(inode, iocb->ki_pos - size);
+		i_size_write(inode, iocb->ki_pos);
+	}
+
+	mark_inode_dirty(inode);
+
+	return copied;
+}
+
+/*
+ * ssdfs_file_write_iter() - write file
+ * @iocb: kernel I/O control block
+ * @from: source iterator
+ *
+ * The write of inline file is copied directly into the inode's
+ * buffer if the file stays inline and the page cache is empty.
+ * Otherwise, the generic page cache based write is used.
+ *
+ * The write could wait the reservation of free pages and
+ * the flush of log. The nonblocking write (IOCB_NOWAIT)
+ * returns -EAGAIN and it is retried in blocking context.
+ */
+static
+ssize_t ssdfs_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct inode *inode = file_inode(iocb->ki_filp);
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+	ssize_t ret;
+
+	if (iocb->ki_flags & IOCB_NOWAIT)
+		return -EAGAIN;
+
+	if (iocb->ki_flags & IOCB_DIRECT)
+		return generic_file_write_iter(iocb, from);
+
+	inode_lock(inode);
+
+	ret = generic_write_checks(iocb, from);
+	if (ret <= 0)
+		goto finish_write_iter;
+
+	if (inode->i_mapping->nrpages == 0 &&
+	    (is_ssdfs_file_inline(ii) || i_size_read(inode) == 0) &&
+	    can_file_become_inline(inode, iocb->ki_pos + ret))
+		ret = ssdfs_inline_file_write_iter(iocb, from);
+	else
+		ret = __generic_file_write_iter(iocb, from);
+
+finish_write_iter:
+	inode_unlock(inode);
+
+	if (ret > 0)
+		ret = generic_write_sync(iocb, ret);
+
+	return ret;
+}
+
+/*
+ * The ssdfs_fsync() is called by the fsync(2) system call.
+ *
+ * Only the logs of the segments that keep the inode's blocks
+ * are committed. The fdatasync(2) skips the inodes b-tree if
+ * only the data of the file has been changed.
+ */
+int ssdfs_fsync(struct file *file, loff_t start, loff_t end, int datasync)
+{
+	struct inode *inode = file->f_mapping->host;
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+	struct ssdfs_extents_btree_info *etree;
+	bool need_sync_metadata = true;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("ino %lu, start %llu, end %llu, datasync %#x\n",
+		  (unsigned long)inode->i_ino, (unsigned long long)start,
+		  (unsigned long long)end, datasync);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	trace_ssdfs_sync_file_enter(inode);
+
+	err = filemap_write_and_wait_range(inode->i_mapping, start, end);
+	if (err) {
+		trace_ssdfs_sync_file_exit(file, datasync, err);
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("fsync failed: ino %lu, start %llu, "
+			  "end %llu, err %d\n",
+			  (unsigned long)inode->i_ino,
+			  (unsigned long long)start,
+			  (unsigned long long)end,
+			  err);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return err;
+	}
+
+	etree = SSDFS_EXTREE(ii);
+
+	if (datasync && etree && !is_ssdfs_file_inline(ii) &&
+	    !(inode->i_state & I_DIRTY_DATASYNC) &&
+	    atomic_read(&etree->state) != SSDFS_EXTENTS_BTREE_DIRTY) {
+		/* file's size and extents are untouched */
+		need_sync_metadata = false;
+	}
+
+	if (need_sync_metadata) {
+		inode_lock(inode);
+		err = sync_inode_metadata(inode, 1);
+		inode_unlock(inode);
+
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to sync inode metadata: "
+				  "ino %lu, err %d\n",
+				  inode->i_ino, err);
+			goto finish_fsync;
+		}
+	}
+
+	/*
+	 * The extents tree commits the logs of updated segments
+	 * during the flush. But updated blocks don't make the tree
+	 * dirty. So, commit the rest of the queue here.
+	 */
+	if (etree) {
+		err = ssdfs_extents_tree_commit_updated_segs(ii);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to commit updated segments: "
+				  "ino %lu, err %d\n",
+				  inode->i_ino, err);
+			goto finish_fsync;
+		}
+	}
+
+	ssdfs_issue_group_flush(SSDFS_FS_I(inode->i_sb));
+
+finish_fsync:
+
+	trace_ssdfs_sync_file_exit(file, datasync, err);
+
+	return err;
+}
+
+/*
+ * ssdfs_fallocate_issue_batch() - pre-allocate extent for the batch
+ * @fsi: pointer on shared file system object
+ * @pool: segment request pool
+ * @batch: batch of zeroed memory pages
+ *
+ * This method tries to pre-allocate the logical extent of the batch
+ * and to wait the end of pre-allocation.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOSPC     - volume hasn't free space.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_fallocate_issue_batch(struct ssdfs_fs_info *fsi,
+				struct ssdfs_segment_request_pool *pool,
+				struct ssdfs_dirty_pages_batch *batch)
+{
+	struct page *page;
+	int i;
+	int err;
+
+	if (pagevec_count(&batch->pvec) == 0)
+		return 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("ino %llu, logical_offset %llu, data_bytes %u\n",
+		  batch->requested_extent.ino,
+		  batch->requested_extent.logical_offset,
+		  batch->requested_extent.data_bytes);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	for (i = 0; i < pagevec_count(&batch->pvec); i++)
+		set_page_writeback(batch->pvec.pages[i]);
+
+	do {
+		err = ssdfs_segment_pre_alloc_data_extent_sync(fsi,
+								pool, batch);
+		if (err == -EAGAIN) {
+			err = ssdfs_wait_write_pool_requests_end(pool);
+			if (unlikely(err)) {
+				SSDFS_ERR("pre-allocation failed: err %d\n",
+					  err);
+				break;
+			}
+
+			err = -EAGAIN;
+		}
+	} while (err == -EAGAIN);
+
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to pre-allocate extent: "
+			  "ino %llu, logical_offset %llu, "
+			  "data_bytes %u, err %d\n",
+			  batch->requested_extent.ino,
+			  batch->requested_extent.logical_offset,
+			  batch->requested_extent.data_bytes,
+			  err);
+		ssdfs_clean_failed_request_pool(pool);
+	} else {
+		err = ssdfs_wait_write_pool_requests_end(pool);
+		if (unlikely(err)) {
+			SSDFS_ERR("pre-allocation failed: err %d\n",
+				  err);
+		}
+	}
+
+	for (i = 0; i < pagevec_count(&batch->pvec); i++) {
+		page = batch->pvec.pages[i];
+
+		if (PageWriteback(page)) {
+			/* request hasn't been finished successfully */
+			ssdfs_unlock_page(page);
+			end_page_writeback(page);
+		}
+
+		ssdfs_put_page(page);
+	}
+
+	ssdfs_segment_request_pool_init(pool);
+	ssdfs_dirty_pages_batch_init(batch);
+
+	return err;
+}
+
+/*
+ * ssdfs_fallocate_grab_block() - grab zeroed memory pages of the block
+ * @inode: pointer on VFS inode
+ * @blk: logical block number
+ * @batch: batch of zeroed memory pages [out]
+ *
+ * This method tries to add the locked memory pages of the block
+ * into the batch. The pages are zeroed if they haven't any content.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EEXIST     - the block's pages are dirty (writeback allocates it).
+ * %-ENOMEM     - fail to allocate memory page.
+ */
+static
+int ssdfs_fallocate_grab_block(struct inode *inode, u64 blk,
+				struct ssdfs_dirty_pages_batch *batch)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
+	struct address_space *mapping = inode->i_mapping;
+	u32 pages_per_blk = fsi->pagesize >> PAGE_SHIFT;
+	pgoff_t index = (blk << fsi->log_pagesize) >> PAGE_SHIFT;
+	unsigned int count = pagevec_count(&batch->pvec);
+	struct page *page;
+	u32 i;
+	int err = 0;
+
+	for (i = 0; i < pages_per_blk; i++) {
+		page = find_or_create_page(mapping, index + i,
+					   mapping_gfp_mask(mapping));
+		if (!page) {
+			err = -ENOMEM;
+			SSDFS_ERR("fail to grab page: index %lu\n",
+				  index + i);
+			goto fail_grab_block;
+		}
+
+		ssdfs_account_locked_page(page);
+
+		if (PageDirty(page) || PageWriteback(page)) {
+			err = -EEXIST;
+			ssdfs_unlock_page(page);
+			ssdfs_put_page(page);
+			goto fail_grab_block;
+		}
+
+		if (!PageUptodate(page)) {
+			ssdfs_memzero_page(page, 0, PAGE_SIZE, PAGE_SIZE);
+			SetPageUptodate(page);
+		}
+
+		err = ssdfs_dirty_pages_batch_add_page(page, batch);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to add page into batch: "
+				  "index %lu, err %d\n",
+				  index + i, err);
+			ssdfs_unlock_page(page);
+			ssdfs_put_page(page);
+			goto fail_grab_block;
+		}
+	}
+
+	return 0;
+
+fail_grab_block:
+	while (pagevec_count(&batch->pvec) > count) {
+		batch->pvec.nr--;
+		page = batch->pvec.pages[batch->pvec.nr];
+		ssdfs_unlock_page(page);
+		ssdfs_put_page(page);
+	}
+
+	if (pagevec_count(&batch->pvec) == 0)
+		ssdfs_dirty_pages_batch_init(batch);
+
+	return err;
+}
+
+/*
+ * ssdfs_fallocate() - pre-allocate space for the file
+ * @file: pointer on file object
+ * @mode: operation mode
+ * @offset: starting offset in bytes
+ * @len: length of the range in bytes
+ *
+ * This method pre-allocates the holes of the range by means
+ * of the segment pre-allocation requests. The pre-allocated
+ * blocks are read as zeros until the write path updates them.
+ * Only the default mode and FALLOC_FL_KEEP_SIZE are supported.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EOPNOTSUPP - unsupported mode or inline file.
+ * %-ENOSPC     - volume hasn't free space.
+ * %-ENOMEM     - fail to allocate memory.
+ * %-ERANGE     - internal error.
+ */
+static
+long ssdfs_fallocate(struct file *file, int mode,
+		     loff_t offset, loff_t len)
+{
+	struct inode *inode = file_inode(file);
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+	struct ssdfs_segment_request_pool pool;
+	struct ssdfs_dirty_pages_batch batch;
+	ino_t ino = inode->i_ino;
+	u32 pages_per_blk;
+	u64 start_blk, end_blk, blk;
+	u64 upper_bound;
+	loff_t new_size = offset + len;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("ino %lu, mode %#x, offset %llu, len %llu\n",
+		  inode->i_ino, mode, (u64)offset, (u64)len);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (mode & ~FALLOC_FL_KEEP_SIZE)
+		return -EOPNOTSUPP;
+
+	if (!S_ISREG(inode->i_mode))
+		return -EOPNOTSUPP;
+
+	if (fsi->pagesize < PAGE_SIZE)
+		return -EOPNOTSUPP;
+
+	if (offset < 0 || len <= 0)
+		return -EINVAL;
+
+	pages_per_blk = fsi->pagesize >> PAGE_SHIFT;
+
+	inode_lock(inode);
+
+	if (is_ssdfs_file_inline(ii) || !SSDFS_EXTREE(ii)) {
+		err = -EOPNOTSUPP;
+		goto finish_fallocate;
+	}
+
+	if (!(mode & FALLOC_FL_KEEP_SIZE)) {
+		err = inode_newsize_ok(inode, new_size);
+		if (err)
+			goto finish_fallocate;
+	}
+
+	ssdfs_segment_request_pool_init(&pool);
+	ssdfs_dirty_pages_batch_init(&batch);
+
+	start_blk = offset >> fsi->log_pagesize;
+	end_blk = (new_size - 1) >> fsi->log_pagesize;
+
+	for (blk = start_blk; blk <= end_blk; blk++) {
+		u64 logical_offset = blk << fsi->log_pagesize;
+
+		if (fatal_signal_pending(current)) {
+			err = -EINTR;
+			break;
+		}
+
+		if (is_ssdfs_logical_extent_invalid(&batch.requested_extent))
+			upper_bound = U64_MAX;
+		else {
+			upper_bound = batch.requested_extent.logical_offset +
+					batch.requested_extent.data_bytes;
+		}
+
+		if (pagevec_count(&batch.pvec) > 0 &&
+		    (logical_offset != upper_bound ||
+		     pagevec_space(&batch.pvec) < pages_per_blk)) {
+			err = ssdfs_fallocate_issue_batch(fsi, &pool, &batch);
+			if (unlikely(err))
+				break;
+		}
+
+		if (ssdfs_extents_tree_has_logical_block(blk, inode))
+			continue;
+
+		err = ssdfs_reserve_free_pages(fsi, 1, SSDFS_USER_DATA_PAGES);
+		if (err) {
+			err = -ENOSPC;
+			break;
+		}
+
+		err = ssdfs_fallocate_grab_block(inode, blk, &batch);
+		if (err == -EEXIST) {
+			/* dirty block will be allocated by writeback */
+			percpu_counter_inc(&fsi->free_pages);
+			err = 0;
+			continue;
+		} else if (unlikely(err)) {
+			percpu_counter_inc(&fsi->free_pages);
+			break;
+		}
+
+		if (is_ssdfs_logical_extent_invalid(&batch.requested_extent)) {
+			ssdfs_dirty_pages_batch_prepare_logical_extent(ino,
+								logical_offset,
+								fsi->pagesize,
+								0, 0,
+								&batch);
+		} else
+			batch.requested_extent.data_bytes += fsi->pagesize;
+	}
+
+	if (!err)
+		err = ssdfs_fallocate_issue_batch(fsi, &pool, &batch);
+	else if (pagevec_count(&batch.pvec) > 0)
+		ssdfs_fallocate_issue_batch(fsi, &pool, &batch);
+
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to pre-allocate range: "
+			  "ino %lu, offset %llu, len %llu, err %d\n",
+			  inode->i_ino, (u64)offset, (u64)len, err);
+	}
+
+	if (!err && !(mode & FALLOC_FL_KEEP_SIZE) &&
+	    new_size > i_size_read(inode))
+		i_size_write(inode, new_size);
+
+	inode->i_ctime = current_time(inode);
+	mark_inode_dirty(inode);
+
+finish_fallocate:
+	inode_unlock(inode);
+
+	return err;
+}
+
+/*
+ * The remap_file_range() method (FICLONE, FICLONERANGE) is not
+ * provided yet. A logical block of a segment is updated in place
+ * by the update path, so a block referenced by several files
+ * cannot be updated without changing all of them. Sharing blocks
+ * requires marking shared extents in the extents tree first.
+ * Until then, copy_file_range() falls back to the in-kernel copy
+ * by means of the splice methods.
+ */
 const struct file_operations ssdfs_file_operations = {
-	.llseek		= generic_file_llseek,
-	.read_iter	= generic_file_read_iter,
-	.write_iter	= generic_file_write_iter,
+	.llseek		= ssdfs_file_llseek,
+	.read_iter	= ssdfs_file_read_iter,
+	.write_iter	= ssdfs_file_write_iter,
 	.unlocked_ioctl	= ssdfs_ioctl,
 	.mmap		= generic_file_mmap,
-	.open		= generic_file_open,
+	.open		= ssdfs_file_open,
 	.fsync		= ssdfs_fsync,
+	.fallocate	= ssdfs_fallocate,
 	.splice_read	= generic_file_splice_read,
 	.splice_write	= iter_file_splice_write,
 };
@@ -2978,6 +4206,7 @@ const struct inode_operations ssdfs_file_inode_operations = {
 	.getattr	= ssdfs_getattr,
 	.setattr	= ssdfs_setattr,
 	.listxattr	= ssdfs_listxattr,
+	.fiemap		= ssdfs_fiemap,
 	.get_inode_acl	= ssdfs_get_acl,
 	.set_acl	= ssdfs_set_acl,
 };
@@ -90,7 +90,7 @@ static void ssdfs_handle_error(struct super_block *sb)
 	if (sb->s_flags & SB_RDONLY)
 		return;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	fsi->fs_state = SSDFS_ERROR_FS;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -218,6 +218,8 @@ static int ssdfs_read_inode(struct inode *inode)
 		goto finish_read_inode;
 	}
 
+	ssdfs_inodes_btree_readahead(fsi->inodes_tree, inode->i_ino);
+
 	switch (search->result.state) {
 	case SSDFS_BTREE_SEARCH_VALID_ITEM:
 		/* expected state */
@@ -538,6 +540,9 @@ static void ssdfs_init_inode(struct inode *dir,
 	inode_init_owner(&init_user_ns, inode, dir, mode);
 	ii->flags = ssdfs_mask_flags(mode,
 			 SSDFS_I(dir)->flags & SSDFS_FL_INHERITED);
+	atomic_set(&ii->private_flags,
+		   atomic_read(&SSDFS_I(dir)->private_flags) &
+				SSDFS_INODE_COMPR_POLICY_MASK);
 	ssdfs_set_inode_flags(inode);
 	inode->i_generation = get_random_u32();
 	inode->i_blkbits = fsi->log_pagesize;
@@ -771,9 +776,6 @@ static int ssdfs_truncate(struct inode *inode)
 		}
 	}
 
-	inode->i_mtime = inode->i_ctime = current_time(inode);
-	mark_inode_dirty(inode);
-
 	return 0;
 }
 
@@ -847,6 +849,32 @@ int ssdfs_setattr(struct user_namespace *mnt_userns,
 	return err;
 }
 
+/*
+ * ssdfs_inode_need_deferred_delete() - check that deletion can be deferred
+ * @inode: evicted inode
+ *
+ * The inline forks are truncated quickly. But the truncation of
+ * the extents btree needs to process all nodes of the tree.
+ * The content of such file is deleted in the background.
+ */
+static inline
+bool ssdfs_inode_need_deferred_delete(struct inode *inode)
+{
+	struct ssdfs_extents_btree_info *tree;
+
+	if (!S_ISREG(inode->i_mode))
+		return false;
+
+	if (IS_APPEND(inode) || IS_IMMUTABLE(inode))
+		return false;
+
+	tree = SSDFS_EXTREE(SSDFS_I(inode));
+	if (!tree)
+		return false;
+
+	return atomic_read(&tree->type) == SSDFS_PRIVATE_EXTENTS_BTREE;
+}
+
 /*
  * This method does all fs work to be done when in-core inode
  * is about to be gone, for whatever reason.
@@ -892,6 +920,18 @@ void ssdfs_evict_inode(struct inode *inode)
 
 	truncate_inode_pages_final(&inode->i_data);
 
+	if (want_delete && ssdfs_inode_need_deferred_delete(inode)) {
+		/*
+		 * The raw inode is kept in the inodes tree until
+		 * the end of the background deletion. So, the inode ID
+		 * and blocks of the file cannot be reused before it.
+		 */
+		i_size_write(inode, 0);
+		SSDFS_I(inode)->is_orphan = true;
+		clear_inode(inode);
+		return;
+	}
+
 	if (want_delete) {
 		sb_start_intwrite(inode->i_sb);
 
@@ -928,6 +968,58 @@ void ssdfs_evict_inode(struct inode *inode)
 	}
 }
 
+/*
+ * ssdfs_delete_orphan_inode() - delete content of evicted inode
+ * @inode: evicted inode
+ *
+ * This method truncates the extents tree, deletes the extended
+ * attributes and deallocates the raw inode of the file that
+ * has been evicted by ssdfs_evict_inode() as orphan. The method
+ * is called by the orphans' worker.
+ */
+void ssdfs_delete_orphan_inode(struct inode *inode)
+{
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
+	struct ssdfs_xattrs_btree_info *xattrs_tree;
+	ino_t ino = inode->i_ino;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!SSDFS_I(inode)->is_orphan);
+
+	SSDFS_DBG("ino %lu\n", ino);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	xattrs_tree = SSDFS_XATTREE(SSDFS_I(inode));
+
+	sb_start_intwrite(inode->i_sb);
+
+	err = ssdfs_truncate(inode);
+	if (err) {
+		SSDFS_WARN("fail to truncate inode: "
+			   "ino %lu, err %d\n",
+			   ino, err);
+	}
+
+	if (xattrs_tree) {
+		err = ssdfs_xattrs_tree_delete_all(xattrs_tree);
+		if (err) {
+			SSDFS_WARN("fail to truncate xattrs tree: "
+				   "ino %lu, err %d\n",
+				   ino, err);
+		}
+	}
+
+	err = ssdfs_inodes_btree_delete(fsi->inodes_tree, ino);
+	if (err) {
+		SSDFS_WARN("fail to deallocate raw inode: "
+			   "ino %lu, err %d\n",
+			   ino, err);
+	}
+
+	sb_end_intwrite(inode->i_sb);
+}
+
 /*
  * This method is called when the VFS needs to write an
  * inode to disc
@@ -953,6 +1045,7 @@ int ssdfs_write_inode(struct inode *inode, struct writeback_control *wbc)
 		sizeof(struct ssdfs_xattr_btree_descriptor);
 	int private_flags;
 	size_t raw_inode_size;
+	bool can_stage;
 	ino_t ino;
 	int err = 0;
 
@@ -960,6 +1053,13 @@ int ssdfs_write_inode(struct inode *inode, struct writeback_control *wbc)
 	SSDFS_DBG("ino %lu\n", (unsigned long)inode->i_ino);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	/*
+	 * The asynchronous write-back stages the raw inode only.
+	 * The staged raw inodes are applied into the inodes btree
+	 * in one pass by the flush of the tree.
+	 */
+	can_stage = !wbc || wbc->sync_mode != WB_SYNC_ALL;
+
 	down_read(&fsi->volume_sem);
 	raw_inode_size = le16_to_cpu(fsi->vs->inodes_btree.desc.item_size);
 	ssdfs_memcpy(&dentries_btree, 0, dentries_desc_size,
@@ -983,6 +1083,11 @@ int ssdfs_write_inode(struct inode *inode, struct writeback_control *wbc)
 	itree = fsi->inodes_tree;
 	ino = inode->i_ino;
 
+	if (can_stage) {
+		search = NULL;
+		goto prepare_raw_inode;
+	}
+
 	search = ssdfs_btree_search_alloc();
 	if (!search) {
 		SSDFS_ERR("fail to allocate btree search object\n");
@@ -1006,6 +1111,7 @@ int ssdfs_write_inode(struct inode *inode, struct writeback_control *wbc)
 		goto free_search_object;
 	}
 
+prepare_raw_inode:
 	down_write(&ii->lock);
 
 	ssdfs_init_raw_inode(ii);
@@ -1082,6 +1188,16 @@ int ssdfs_write_inode(struct inode *inode, struct writeback_control *wbc)
 
 	ri->checksum = ssdfs_crc32_le(ri, raw_inode_size);
 
+	if (can_stage) {
+		err = ssdfs_inodes_btree_stage_inode(itree, ino, ri);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to stage inode: "
+				  "ino %lu, err %d\n",
+				  ino, err);
+		}
+		goto finish_write_inode;
+	}
+
 	switch (search->result.buf_state) {
 	case SSDFS_BTREE_SEARCH_INLINE_BUFFER:
 	case SSDFS_BTREE_SEARCH_EXTERNAL_BUFFER:
@@ -1147,6 +1263,9 @@ finish_write_inode:
 		up_write(&fsi->volume_sem);
 	}
 
+	if (can_stage)
+		return 0;
+
 	err = ssdfs_inodes_btree_change(itree, ino, search);
 	if (unlikely(err)) {
 		SSDFS_ERR("fail to change inode: "
@@ -1190,9 +1309,7 @@ int ssdfs_statfs(struct dentry *dentry, struct kstatfs *buf)
 	pages_per_seg = fsi->pages_per_seg;
 	buf->f_blocks = nsegs * pages_per_seg;
 
-	spin_lock(&fsi->volume_state_lock);
-	buf->f_bfree = fsi->free_pages;
-	spin_unlock(&fsi->volume_state_lock);
+	buf->f_bfree = ssdfs_fs_counter_sum(&fsi->free_pages);
 
 	buf->f_bavail = buf->f_bfree;
 
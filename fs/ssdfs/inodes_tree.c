@@ -23,6 +23,8 @@
 #include <linux/mm.h>
 #include <linux/slab.h>
 #include <linux/pagevec.h>
+#include <linux/percpu.h>
+#include <linux/sched/signal.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -372,6 +374,48 @@ finish_get_first:
 	return 0;
 }
 
+/*
+ * ssdfs_free_inodes_queue_check_tail() - check the last free inodes range
+ * @q: free inodes queue
+ * @threshold: threshold of free inodes in the last range
+ * @upper_hash: hash value that follows the last range [out]
+ *
+ * This method checks that the queue contains only one range
+ * (the range of the last leaf node) and the range contains
+ * fewer free inodes than @threshold.
+ *
+ * RETURN:
+ * [true]  - the last leaf node is close to exhaustion.
+ * [false] - the queue has enough free inodes.
+ */
+static
+bool ssdfs_free_inodes_queue_check_tail(struct ssdfs_free_inode_range_queue *q,
+					u32 threshold, u64 *upper_hash)
+{
+	struct ssdfs_inodes_btree_range *last;
+	bool is_exhausted = false;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!q || !upper_hash);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	*upper_hash = U64_MAX;
+
+	spin_lock(&q->lock);
+	if (list_is_singular(&q->list)) {
+		last = list_last_entry(&q->list,
+					struct ssdfs_inodes_btree_range,
+					list);
+		if (last->area.count < threshold) {
+			*upper_hash = last->area.start_hash + last->area.count;
+			is_exhausted = true;
+		}
+	}
+	spin_unlock(&q->lock);
+
+	return is_exhausted;
+}
+
 /*
  * ssdfs_free_inodes_queue_remove_first() - remove first free inodes range
  * @q: free inodes queue
@@ -456,10 +500,413 @@ void ssdfs_free_inodes_queue_remove_all(struct ssdfs_free_inode_range_queue *q)
 	}
 }
 
+/*
+ * ssdfs_free_inodes_queue_get_batch() - reserve free inodes from the queue
+ * @q: free inodes queue
+ * @max_count: maximal number of reserved inodes
+ * @range: reserved free inodes range [out]
+ *
+ * This method tries to reserve up to @max_count free inodes
+ * from the first range of the queue.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - queue is empty.
+ */
+static
+int ssdfs_free_inodes_queue_get_batch(struct ssdfs_free_inode_range_queue *q,
+				      u16 max_count,
+				      struct ssdfs_inodes_btree_range *range)
+{
+	struct ssdfs_inodes_btree_range *first = NULL;
+	u16 count;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!q || !range);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	spin_lock(&q->lock);
+	first = list_first_entry_or_null(&q->list,
+					 struct ssdfs_inodes_btree_range,
+					 list);
+	if (first) {
+		count = min_t(u16, first->area.count, max_count);
+
+		range->node_id = first->node_id;
+		range->area.start_hash = first->area.start_hash;
+		range->area.start_index = first->area.start_index;
+		range->area.count = count;
+
+		first->area.start_hash += count;
+		first->area.start_index += count;
+		first->area.count -= count;
+
+		if (first->area.count == 0)
+			list_del(&first->list);
+		else
+			first = NULL;
+	}
+	spin_unlock(&q->lock);
+
+	if (first)
+		ssdfs_free_inodes_range_free(first);
+
+	return range->area.count > 0 ? 0 : -ENODATA;
+}
+
+/*
+ * ssdfs_inodes_percpu_cache_take() - take one free inode from the cache
+ * @cache: per-CPU cache of free inodes
+ * @range: free inode's range [out]
+ */
+static inline
+void ssdfs_inodes_percpu_cache_take(struct ssdfs_inodes_percpu_cache *cache,
+				    struct ssdfs_inodes_btree_range *range)
+{
+	range->node_id = cache->range.node_id;
+	range->area.start_hash = cache->range.area.start_hash;
+	range->area.start_index = cache->range.area.start_index;
+	range->area.count = 1;
+
+	cache->range.area.start_hash += 1;
+	cache->range.area.start_index += 1;
+	cache->range.area.count -= 1;
+}
+
+/*
+ * ssdfs_inodes_percpu_cache_get() - get free inode from per-CPU cache
+ * @tree: pointer on inodes btree object
+ * @range: free inode's range [out]
+ *
+ * This method tries to take the free inode from the cache of
+ * current CPU. The empty cache is refilled from the free inodes queue
+ * by a batch of inodes. If the queue is empty, then the method tries
+ * to take the free inode from the caches of other CPUs (including
+ * the offline ones).
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - no free inodes in the queue and caches.
+ */
+static
+int ssdfs_inodes_percpu_cache_get(struct ssdfs_inodes_btree_info *tree,
+				  struct ssdfs_inodes_btree_range *range)
+{
+	struct ssdfs_inodes_percpu_cache *cache;
+	int cpu;
+	int err = 0;
+
+	cache = get_cpu_ptr(tree->percpu_cache);
+	spin_lock(&cache->lock);
+	if (cache->range.area.count == 0) {
+		err = ssdfs_free_inodes_queue_get_batch(&tree->free_inodes_queue,
+					SSDFS_INODES_PERCPU_CACHE_BATCH,
+					&cache->range);
+	}
+	if (!err)
+		ssdfs_inodes_percpu_cache_take(cache, range);
+	spin_unlock(&cache->lock);
+	put_cpu_ptr(tree->percpu_cache);
+
+	if (err != -ENODATA)
+		return err;
+
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(tree->percpu_cache, cpu);
+
+		spin_lock(&cache->lock);
+		if (cache->range.area.count > 0) {
+			ssdfs_inodes_percpu_cache_take(cache, range);
+			err = 0;
+		}
+		spin_unlock(&cache->lock);
+
+		if (!err)
+			return 0;
+	}
+
+	return -ENODATA;
+}
+
+/*
+ * ssdfs_inodes_percpu_cache_create() - create per-CPU caches of free inodes
+ * @tree: pointer on inodes btree object
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - unable to allocate memory.
+ */
+static
+int ssdfs_inodes_percpu_cache_create(struct ssdfs_inodes_btree_info *tree)
+{
+	struct ssdfs_inodes_percpu_cache *cache;
+	int cpu;
+
+	tree->percpu_cache = alloc_percpu(struct ssdfs_inodes_percpu_cache);
+	if (!tree->percpu_cache)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(tree->percpu_cache, cpu);
+		spin_lock_init(&cache->lock);
+		ssdfs_free_inodes_range_init(&cache->range);
+		cache->range.area.count = 0;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_inodes_percpu_cache_destroy() - destroy per-CPU caches of free inodes
+ * @tree: pointer on inodes btree object
+ *
+ * The reserved inodes are free in the tree's nodes. So, it doesn't need
+ * to return them into the free inodes queue that is rebuilt on mount.
+ */
+static
+void ssdfs_inodes_percpu_cache_destroy(struct ssdfs_inodes_btree_info *tree)
+{
+	if (!tree->percpu_cache)
+		return;
+
+	free_percpu(tree->percpu_cache);
+	tree->percpu_cache = NULL;
+}
+
 /******************************************************************************
  *                     INODES TREE OBJECT FUNCTIONALITY                       *
  ******************************************************************************/
 
+/*
+ * ssdfs_inodes_btree_add_node_func() - add the next leaf node
+ * @work: work item
+ *
+ * This method adds the next leaf node into the inodes btree
+ * in the background. The hierarchy of the tree is processed
+ * by the worker instead of the inode allocation's thread.
+ */
+static
+void ssdfs_inodes_btree_add_node_func(struct work_struct *work)
+{
+	struct ssdfs_inodes_btree_info *tree;
+	struct ssdfs_btree_search *search;
+	u64 hash;
+	int err;
+
+	tree = container_of(work, struct ssdfs_inodes_btree_info,
+			    add_node_work);
+
+	switch (atomic_read(&tree->generic_tree.state)) {
+	case SSDFS_BTREE_CREATED:
+	case SSDFS_BTREE_DIRTY:
+		/* expected state */
+		break;
+
+	default:
+		goto finish_add_node;
+	}
+
+	spin_lock(&tree->lock);
+	hash = tree->add_node_hash;
+	spin_unlock(&tree->lock);
+
+	search = ssdfs_btree_search_alloc();
+	if (IS_ERR_OR_NULL(search)) {
+		SSDFS_ERR("fail to allocate btree search object\n");
+		goto finish_add_node;
+	}
+
+	ssdfs_btree_search_init(search);
+	search->request.type = SSDFS_BTREE_SEARCH_ALLOCATE_ITEM;
+	search->request.flags =
+		SSDFS_BTREE_SEARCH_HAS_VALID_HASH_RANGE |
+		SSDFS_BTREE_SEARCH_HAS_VALID_COUNT;
+	search->request.start.hash = hash;
+	search->request.end.hash = hash;
+	search->request.count = 1;
+
+	err = ssdfs_btree_add_node(&tree->generic_tree, search);
+	if (err == -EEXIST || err == -ENOSPC) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("node has not been added: "
+			  "hash %llx, err %d\n",
+			  hash, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+	} else if (unlikely(err)) {
+		SSDFS_ERR("fail to add the node: "
+			  "hash %llx, err %d\n",
+			  hash, err);
+	}
+
+	ssdfs_btree_search_free(search);
+
+finish_add_node:
+	atomic_set(&tree->add_node_pending, 0);
+}
+
+/*
+ * ssdfs_inodes_btree_queue_add_node() - queue adding of the next leaf node
+ * @tree: pointer on inodes btree object
+ *
+ * This method checks that the last leaf node is close to exhaustion
+ * and queues adding of the next leaf node. As a result, a burst of
+ * inode allocations doesn't wait for the processing of the tree's
+ * hierarchy when the last leaf node is full. The allocation thread
+ * adds the node by itself if the free inodes are exhausted before
+ * the worker finishes.
+ */
+static
+void ssdfs_inodes_btree_queue_add_node(struct ssdfs_inodes_btree_info *tree)
+{
+	u32 node_size = tree->generic_tree.node_size;
+	u32 threshold;
+	u64 hash;
+
+	if (tree->raw_inode_size == 0)
+		return;
+
+	threshold = node_size / tree->raw_inode_size;
+	threshold /= SSDFS_INODES_BTREE_ADD_NODE_RATIO;
+
+	if (!ssdfs_free_inodes_queue_check_tail(&tree->free_inodes_queue,
+						threshold, &hash))
+		return;
+
+	if (atomic_cmpxchg(&tree->add_node_pending, 0, 1) != 0)
+		return;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("queue adding of the node: hash %llx\n", hash);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	spin_lock(&tree->lock);
+	tree->add_node_hash = hash;
+	spin_unlock(&tree->lock);
+
+	queue_work(system_unbound_wq, &tree->add_node_work);
+}
+
+/*
+ * ssdfs_inodes_btree_forget_staged() - forget staged raw inodes
+ * @tree: pointer on inodes btree object
+ * @ino: starting inode ID number
+ * @count: number of inodes in the range
+ *
+ * This method excludes the staged images of the inodes range
+ * (for example, because the raw inodes are deleted or changed
+ * by the newer images).
+ */
+static
+void ssdfs_inodes_btree_forget_staged(struct ssdfs_inodes_btree_info *tree,
+				      ino_t ino, u16 count)
+{
+	struct ssdfs_staged_raw_inode *staged;
+	u16 i;
+
+	for (i = 0; i < count; i++) {
+		spin_lock(&tree->staged_lock);
+		staged = radix_tree_delete(&tree->staged_inodes, ino + i);
+		if (staged)
+			tree->staged_count--;
+		spin_unlock(&tree->staged_lock);
+
+		if (staged)
+			ssdfs_ino_tree_kfree(staged);
+	}
+}
+
+/*
+ * ssdfs_inodes_btree_extract_staged() - extract batch of staged raw inodes
+ * @tree: pointer on inodes btree object
+ * @start: starting inode ID number of the search
+ * @batch: array of pointers on staged raw inodes [out]
+ * @max_count: capacity of the array
+ *
+ * This method excludes the staged raw inodes from the radix tree
+ * in the ascending order of inode ID numbers.
+ *
+ * RETURN: number of extracted staged raw inodes.
+ */
+static
+unsigned int
+ssdfs_inodes_btree_extract_staged(struct ssdfs_inodes_btree_info *tree,
+				  unsigned long start,
+				  struct ssdfs_staged_raw_inode **batch,
+				  unsigned int max_count)
+{
+	unsigned int count;
+	unsigned int i;
+
+	spin_lock(&tree->staged_lock);
+	count = radix_tree_gang_lookup(&tree->staged_inodes,
+					(void **)batch, start, max_count);
+	for (i = 0; i < count; i++) {
+		radix_tree_delete(&tree->staged_inodes, batch[i]->ino);
+		tree->staged_count--;
+	}
+	spin_unlock(&tree->staged_lock);
+
+	return count;
+}
+
+/*
+ * ssdfs_inodes_btree_forget_all_staged() - free all staged raw inodes
+ * @tree: pointer on inodes btree object
+ */
+static
+void ssdfs_inodes_btree_forget_all_staged(struct ssdfs_inodes_btree_info *tree)
+{
+	struct ssdfs_staged_raw_inode *batch[SSDFS_INODES_BTREE_PREFETCH_MAX];
+	unsigned int count;
+	unsigned int i;
+
+	do {
+		count = ssdfs_inodes_btree_extract_staged(tree, 0, batch,
+							  ARRAY_SIZE(batch));
+		for (i = 0; i < count; i++) {
+			SSDFS_WARN("staged raw inode is lost: ino %llu\n",
+				   batch[i]->ino);
+			ssdfs_ino_tree_kfree(batch[i]);
+		}
+	} while (count > 0);
+}
+
+/*
+ * ssdfs_inodes_btree_copy_staged() - copy staged image into search buffer
+ * @tree: pointer on inodes btree object
+ * @ino: inode ID number
+ * @search: pointer on search request object
+ *
+ * The staged raw inode is newer than the raw inode in the node.
+ * So, the found raw inode is replaced by the staged image.
+ */
+static
+void ssdfs_inodes_btree_copy_staged(struct ssdfs_inodes_btree_info *tree,
+				    ino_t ino,
+				    struct ssdfs_btree_search *search)
+{
+	struct ssdfs_staged_raw_inode *staged;
+	size_t raw_inode_size = sizeof(struct ssdfs_inode);
+
+	if (!search->result.buf || search->result.buf_size < raw_inode_size)
+		return;
+
+	spin_lock(&tree->staged_lock);
+	staged = radix_tree_lookup(&tree->staged_inodes, ino);
+	if (staged) {
+		ssdfs_memcpy(search->result.buf, 0, search->result.buf_size,
+			     &staged->raw, 0, raw_inode_size,
+			     raw_inode_size);
+	}
+	spin_unlock(&tree->staged_lock);
+}
+
 /*
  * ssdfs_inodes_btree_create() - create inodes btree
  * @fsi: pointer on shared file system object
@@ -505,6 +952,16 @@ int ssdfs_inodes_btree_create(struct ssdfs_fs_info *fsi)
 
 	fsi->inodes_tree = ptr;
 
+	INIT_WORK(&ptr->add_node_work, ssdfs_inodes_btree_add_node_func);
+	ptr->add_node_hash = U64_MAX;
+	atomic_set(&ptr->add_node_pending, 0);
+
+	atomic64_set(&ptr->readahead_ino, 0);
+
+	spin_lock_init(&ptr->staged_lock);
+	INIT_RADIX_TREE(&ptr->staged_inodes, GFP_ATOMIC);
+	ptr->staged_count = 0;
+
 	err = ssdfs_btree_create(fsi,
 				 SSDFS_INODES_BTREE_INO,
 				 &ssdfs_inodes_btree_desc_ops,
@@ -516,7 +973,7 @@ int ssdfs_inodes_btree_create(struct ssdfs_fs_info *fsi)
 		goto fail_create_inodes_tree;
 	}
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	vs_flags = fsi->fs_flags;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -675,7 +1132,7 @@ free_search_object:
 		if (unlikely(err))
 			goto fail_create_inodes_tree;
 
-		spin_lock(&fsi->volume_state_lock);
+		SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 		vs_flags = fsi->fs_flags;
 		vs_flags &= ~SSDFS_HAS_INLINE_INODES_TREE;
 		fsi->fs_flags = vs_flags;
@@ -721,6 +1178,16 @@ free_search_object:
 #endif /* CONFIG_SSDFS_DEBUG */
 	}
 
+	/*
+	 * The reserved inodes are allocated sequentially without
+	 * the per-CPU caches. So, enable the caches only at the end.
+	 */
+	err = ssdfs_inodes_percpu_cache_create(ptr);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to create per-CPU caches of free inodes\n");
+		goto fail_create_inodes_tree;
+	}
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("DONE: create inodes btree\n");
 #else
@@ -730,6 +1197,7 @@ free_search_object:
 	return 0;
 
 fail_create_inodes_tree:
+	cancel_work_sync(&ptr->add_node_work);
 	fsi->inodes_tree = NULL;
 	ssdfs_ino_tree_kfree(ptr);
 	return err;
@@ -759,8 +1227,13 @@ void ssdfs_inodes_btree_destroy(struct ssdfs_fs_info *fsi)
 	ssdfs_debug_inodes_btree_object(fsi->inodes_tree);
 
 	tree = fsi->inodes_tree;
+	cancel_work_sync(&tree->add_node_work);
+	wait_event(tree->generic_tree.prefetch_wq,
+		   atomic_read(&tree->generic_tree.prefetch_count) == 0);
 	ssdfs_btree_destroy(&tree->generic_tree);
 	ssdfs_free_inodes_queue_remove_all(&tree->free_inodes_queue);
+	ssdfs_inodes_percpu_cache_destroy(tree);
+	ssdfs_inodes_btree_forget_all_staged(tree);
 
 	ssdfs_ino_tree_kfree(fsi->inodes_tree);
 	fsi->inodes_tree = NULL;
@@ -806,108 +1279,492 @@ int ssdfs_inodes_btree_flush(struct ssdfs_inodes_btree_info *tree)
 	fsi = tree->generic_tree.fsi;
 
 #ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!rwsem_is_locked(&fsi->volume_sem));
+	BUG_ON(!rwsem_is_locked(&fsi->volume_sem));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	flush_work(&tree->add_node_work);
+
+	err = ssdfs_inodes_btree_apply_staged(tree);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to apply staged raw inodes: err %d\n",
+			  err);
+		return err;
+	}
+
+	err = ssdfs_btree_flush(&tree->generic_tree);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to flush inodes btree: err %d\n",
+			  err);
+		return err;
+	}
+
+	spin_lock(&tree->lock);
+	ssdfs_memcpy(&fsi->vs->root_folder,
+		     0, sizeof(struct ssdfs_inode),
+		     &tree->root_folder,
+		     0, sizeof(struct ssdfs_inode),
+		     sizeof(struct ssdfs_inode));
+	upper_allocated_ino = tree->upper_allocated_ino;
+	allocated_inodes = tree->allocated_inodes;
+	free_inodes = tree->free_inodes;
+	inodes_capacity = tree->inodes_capacity;
+	leaf_nodes = tree->leaf_nodes;
+	nodes_count = tree->nodes_count;
+	spin_unlock(&tree->lock);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("allocated_inodes %llu, free_inodes %llu, "
+		  "inodes_capacity %llu\n",
+		  allocated_inodes, free_inodes, inodes_capacity);
+	WARN_ON((allocated_inodes + free_inodes) != inodes_capacity);
+
+	SSDFS_DBG("leaf_nodes %u, nodes_count %u\n",
+		  leaf_nodes, nodes_count);
+	WARN_ON(leaf_nodes >= nodes_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	fsi->vs->inodes_btree.allocated_inodes = cpu_to_le64(allocated_inodes);
+	fsi->vs->inodes_btree.free_inodes = cpu_to_le64(free_inodes);
+	fsi->vs->inodes_btree.inodes_capacity = cpu_to_le64(inodes_capacity);
+	fsi->vs->inodes_btree.leaf_nodes = cpu_to_le32(leaf_nodes);
+	fsi->vs->inodes_btree.nodes_count = cpu_to_le32(nodes_count);
+	fsi->vs->inodes_btree.upper_allocated_ino =
+				cpu_to_le64(upper_allocated_ino);
+
+#ifdef CONFIG_SSDFS_TRACK_API_CALL
+	SSDFS_ERR("finished\n");
+#else
+	SSDFS_DBG("finished\n");
+#endif /* CONFIG_SSDFS_TRACK_API_CALL */
+
+	ssdfs_debug_inodes_btree_object(fsi->inodes_tree);
+
+	return 0;
+}
+
+static inline
+bool need_initialize_inodes_btree_search(ino_t ino,
+					 struct ssdfs_btree_search *search)
+{
+	return need_initialize_btree_search(search) ||
+		search->request.start.hash != ino;
+}
+
+/*
+ * ssdfs_inodes_btree_find() - find raw inode
+ * @tree: pointer on inodes btree object
+ * @ino: inode ID value
+ * @search: pointer on search request object
+ *
+ * This method tries to find the raw inode for @ino.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_inodes_btree_find(struct ssdfs_inodes_btree_info *tree,
+			    ino_t ino,
+			    struct ssdfs_btree_search *search)
+{
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !search);
+
+	SSDFS_DBG("tree %p, ino %lu, search %p\n",
+		  tree, ino, search);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	search->request.type = SSDFS_BTREE_SEARCH_FIND_ITEM;
+
+	if (need_initialize_inodes_btree_search(ino, search)) {
+		ssdfs_btree_search_init(search);
+		search->request.type = SSDFS_BTREE_SEARCH_FIND_ITEM;
+		search->request.flags =
+			SSDFS_BTREE_SEARCH_HAS_VALID_HASH_RANGE |
+			SSDFS_BTREE_SEARCH_HAS_VALID_COUNT;
+		search->request.start.hash = ino;
+		search->request.end.hash = ino;
+		search->request.count = 1;
+	}
+
+	err = ssdfs_btree_find_item(&tree->generic_tree, search);
+	if (unlikely(err))
+		return err;
+
+	ssdfs_inodes_btree_copy_staged(tree, ino, search);
+
+	return 0;
+}
+
+/*
+ * ssdfs_inodes_btree_find_changed() - find next changed raw inode
+ * @tree: pointer on inodes btree object
+ * @ino: starting inode ID value [in|out]
+ * @start_time: starting timestamp of the time range
+ * @end_time: ending timestamp of the time range
+ * @raw_inode: buffer for the found raw inode [out]
+ *
+ * This method tries to find the first raw inode starting from
+ * @ino that has been created or changed during the time range
+ * (@start_time, @end_time]. The @ino is set on the found inode.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ERANGE     - internal error.
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EINTR      - the search has been interrupted by fatal signal.
+ * %-ENODATA    - no changed inodes starting from @ino.
+ */
+int ssdfs_inodes_btree_find_changed(struct ssdfs_inodes_btree_info *tree,
+				    u64 *ino, u64 start_time, u64 end_time,
+				    struct ssdfs_inode *raw_inode)
+{
+	struct ssdfs_btree_search *search;
+	struct ssdfs_inode *found;
+	size_t raw_inode_size = sizeof(struct ssdfs_inode);
+	u64 upper_ino;
+	u64 ctime, mtime;
+	u64 cur_ino;
+	int err = -ENODATA;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !ino || !raw_inode);
+
+	SSDFS_DBG("tree %p, ino %llu, start_time %llu, end_time %llu\n",
+		  tree, *ino, start_time, end_time);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (start_time >= end_time) {
+		SSDFS_ERR("invalid time range: "
+			  "start_time %llu, end_time %llu\n",
+			  start_time, end_time);
+		return -EINVAL;
+	}
+
+	spin_lock(&tree->lock);
+	upper_ino = tree->upper_allocated_ino;
+	spin_unlock(&tree->lock);
+
+	if (*ino > upper_ino)
+		return -ENODATA;
+
+	search = ssdfs_btree_search_alloc();
+	if (!search) {
+		SSDFS_ERR("fail to allocate btree search object\n");
+		return -ENOMEM;
+	}
+
+	for (cur_ino = *ino; cur_ino <= upper_ino; cur_ino++) {
+		if (fatal_signal_pending(current)) {
+			err = -EINTR;
+			break;
+		}
+
+		ssdfs_btree_search_init(search);
+
+		err = ssdfs_inodes_btree_find(tree, (ino_t)cur_ino, search);
+		if (err == -ENODATA) {
+			/* inode is not allocated */
+			err = -ENODATA;
+			continue;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to find the raw inode: "
+				  "ino %llu, err %d\n",
+				  cur_ino, err);
+			break;
+		}
+
+		if (search->result.state != SSDFS_BTREE_SEARCH_VALID_ITEM ||
+		    !search->result.buf ||
+		    search->result.items_in_buffer == 0) {
+			err = -ERANGE;
+			SSDFS_ERR("invalid search result: ino %llu\n",
+				  cur_ino);
+			break;
+		}
+
+		found = (struct ssdfs_inode *)search->result.buf;
+
+		if (le16_to_cpu(found->magic) != SSDFS_INODE_MAGIC) {
+			err = -ENODATA;
+			continue;
+		}
+
+		ctime = ssdfs_raw_inode_time(found->ctime, found->ctime_nsec);
+		mtime = ssdfs_raw_inode_time(found->mtime, found->mtime_nsec);
+
+		if ((ctime > start_time && ctime <= end_time) ||
+		    (mtime > start_time && mtime <= end_time)) {
+			ssdfs_memcpy(raw_inode, 0, raw_inode_size,
+				     found, 0, raw_inode_size,
+				     raw_inode_size);
+			*ino = cur_ino;
+			err = 0;
+			break;
+		}
+
+		err = -ENODATA;
+	}
+
+	ssdfs_btree_search_free(search);
+
+	return err;
+}
+
+/*
+ * struct ssdfs_inodes_btree_prefetch_request - raw inodes' prefetch request
+ * @work: work item
+ * @tree: pointer on inodes btree object
+ * @count: number of inodes for prefetch
+ * @ino: inode ID numbers for prefetch
+ */
+struct ssdfs_inodes_btree_prefetch_request {
+	struct work_struct work;
+	struct ssdfs_inodes_btree_info *tree;
+	u16 count;
+	u64 ino[SSDFS_INODES_BTREE_PREFETCH_MAX];
+};
+
+/*
+ * ssdfs_inodes_btree_prefetch_func() - read inodes' nodes in the background
+ * @work: work item
+ *
+ * This method looks up the requested raw inodes. As a result,
+ * the leaf nodes that contain the raw inodes are read from
+ * the volume and the following ssdfs_read_inode() calls find
+ * the nodes in memory.
+ */
+static
+void ssdfs_inodes_btree_prefetch_func(struct work_struct *work)
+{
+	struct ssdfs_inodes_btree_prefetch_request *req;
+	struct ssdfs_inodes_btree_info *tree;
+	struct ssdfs_btree_search *search;
+	int i;
+	int err;
+
+	req = container_of(work, struct ssdfs_inodes_btree_prefetch_request,
+			   work);
+	tree = req->tree;
+
+	search = ssdfs_btree_search_alloc();
+	if (!search) {
+		SSDFS_ERR("fail to allocate btree search object\n");
+		goto finish_prefetch;
+	}
+
+	for (i = 0; i < req->count; i++) {
+		switch (atomic_read(&tree->generic_tree.state)) {
+		case SSDFS_BTREE_CREATED:
+		case SSDFS_BTREE_DIRTY:
+			/* expected state */
+			break;
+
+		default:
+			goto free_search_object;
+		}
+
+		ssdfs_btree_search_reinit(search);
+
+		err = ssdfs_inodes_btree_find(tree, req->ino[i], search);
+		if (unlikely(err)) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("fail to prefetch raw inode: "
+				  "ino %llu, err %d\n",
+				  req->ino[i], err);
+#endif /* CONFIG_SSDFS_DEBUG */
+		}
+	}
+
+free_search_object:
+	ssdfs_btree_search_free(search);
+
+finish_prefetch:
+	ssdfs_ino_tree_kfree(req);
+
+	if (atomic_dec_and_test(&tree->generic_tree.prefetch_count))
+		wake_up_all(&tree->generic_tree.prefetch_wq);
+}
+
+/*
+ * ssdfs_inodes_btree_prefetch() - prefetch raw inodes
+ * @tree: pointer on inodes btree object
+ * @ino: array of inode ID numbers
+ * @count: number of items in the array
+ *
+ * This method queues the background lookup of raw inodes
+ * that are going to be requested soon (for example, by stat()
+ * calls after readdir()). The inodes that are in the inode
+ * cache already are skipped. Any failure simply means that
+ * the prefetch doesn't take place.
+ */
+void ssdfs_inodes_btree_prefetch(struct ssdfs_inodes_btree_info *tree,
+				 const u64 *ino, u16 count)
+{
+	struct ssdfs_inodes_btree_prefetch_request *req;
+	struct super_block *sb;
+	struct inode *inode;
+	int i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !ino);
+
+	SSDFS_DBG("tree %p, count %u\n", tree, count);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	err = ssdfs_btree_flush(&tree->generic_tree);
-	if (unlikely(err)) {
-		SSDFS_ERR("fail to flush inodes btree: err %d\n",
-			  err);
-		return err;
-	}
+	if (count == 0)
+		return;
 
-	spin_lock(&tree->lock);
-	ssdfs_memcpy(&fsi->vs->root_folder,
-		     0, sizeof(struct ssdfs_inode),
-		     &tree->root_folder,
-		     0, sizeof(struct ssdfs_inode),
-		     sizeof(struct ssdfs_inode));
-	upper_allocated_ino = tree->upper_allocated_ino;
-	allocated_inodes = tree->allocated_inodes;
-	free_inodes = tree->free_inodes;
-	inodes_capacity = tree->inodes_capacity;
-	leaf_nodes = tree->leaf_nodes;
-	nodes_count = tree->nodes_count;
-	spin_unlock(&tree->lock);
+	sb = tree->generic_tree.fsi->sb;
 
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("allocated_inodes %llu, free_inodes %llu, "
-		  "inodes_capacity %llu\n",
-		  allocated_inodes, free_inodes, inodes_capacity);
-	WARN_ON((allocated_inodes + free_inodes) != inodes_capacity);
+	req = ssdfs_ino_tree_kzalloc(sizeof(*req), GFP_NOFS | __GFP_NOWARN);
+	if (!req)
+		return;
 
-	SSDFS_DBG("leaf_nodes %u, nodes_count %u\n",
-		  leaf_nodes, nodes_count);
-	WARN_ON(leaf_nodes >= nodes_count);
-#endif /* CONFIG_SSDFS_DEBUG */
+	for (i = 0; i < count; i++) {
+		if (req->count >= SSDFS_INODES_BTREE_PREFETCH_MAX)
+			break;
 
-	fsi->vs->inodes_btree.allocated_inodes = cpu_to_le64(allocated_inodes);
-	fsi->vs->inodes_btree.free_inodes = cpu_to_le64(free_inodes);
-	fsi->vs->inodes_btree.inodes_capacity = cpu_to_le64(inodes_capacity);
-	fsi->vs->inodes_btree.leaf_nodes = cpu_to_le32(leaf_nodes);
-	fsi->vs->inodes_btree.nodes_count = cpu_to_le32(nodes_count);
-	fsi->vs->inodes_btree.upper_allocated_ino =
-				cpu_to_le64(upper_allocated_ino);
+		if (req->count > 0 && req->ino[req->count - 1] == ino[i])
+			continue;
 
-#ifdef CONFIG_SSDFS_TRACK_API_CALL
-	SSDFS_ERR("finished\n");
-#else
-	SSDFS_DBG("finished\n");
-#endif /* CONFIG_SSDFS_TRACK_API_CALL */
+		rcu_read_lock();
+		inode = find_inode_by_ino_rcu(sb, ino[i]);
+		rcu_read_unlock();
 
-	ssdfs_debug_inodes_btree_object(fsi->inodes_tree);
+		if (inode)
+			continue;
 
-	return 0;
-}
+		req->ino[req->count] = ino[i];
+		req->count++;
+	}
 
-static inline
-bool need_initialize_inodes_btree_search(ino_t ino,
-					 struct ssdfs_btree_search *search)
-{
-	return need_initialize_btree_search(search) ||
-		search->request.start.hash != ino;
+	if (req->count == 0) {
+		ssdfs_ino_tree_kfree(req);
+		return;
+	}
+
+	INIT_WORK(&req->work, ssdfs_inodes_btree_prefetch_func);
+	req->tree = tree;
+
+	atomic_inc(&tree->generic_tree.prefetch_count);
+	queue_work(system_unbound_wq, &req->work);
 }
 
 /*
- * ssdfs_inodes_btree_find() - find raw inode
+ * ssdfs_inodes_btree_get_free_inode() - get free inode for allocation
  * @tree: pointer on inodes btree object
- * @ino: inode ID value
- * @search: pointer on search request object
+ * @range: pointer on value that stores range pointer [out]
  *
- * This method tries to find the raw inode for @ino.
+ * This method takes the free inode from the per-CPU cache
+ * (if the caches have been created already) or from the free
+ * inodes queue.
  *
  * RETURN:
  * [success]
  * [failure] - error code:
  *
- * %-EINVAL     - invalid input.
+ * %-ENODATA    - no free inodes.
  * %-ERANGE     - internal error.
  */
-int ssdfs_inodes_btree_find(struct ssdfs_inodes_btree_info *tree,
-			    ino_t ino,
-			    struct ssdfs_btree_search *search)
+static
+int ssdfs_inodes_btree_get_free_inode(struct ssdfs_inodes_btree_info *tree,
+				      struct ssdfs_inodes_btree_range **range)
+{
+	struct ssdfs_free_inode_range_queue *q = &tree->free_inodes_queue;
+	struct ssdfs_inodes_btree_range *tmp;
+	int err;
+
+	if (!tree->percpu_cache)
+		return ssdfs_free_inodes_queue_get_first(q, range);
+
+	tmp = ssdfs_free_inodes_range_alloc();
+	if (!tmp) {
+		SSDFS_ERR("fail to allocate free inodes range\n");
+		return -ERANGE;
+	}
+
+	ssdfs_free_inodes_range_init(tmp);
+
+	err = ssdfs_inodes_percpu_cache_get(tree, tmp);
+	if (err) {
+		ssdfs_free_inodes_range_free(tmp);
+		return err;
+	}
+
+	*range = tmp;
+
+	return 0;
+}
+
+/*
+ * ssdfs_inodes_btree_readahead() - read the following leaf nodes ahead
+ * @tree: pointer on inodes btree object
+ * @ino: inode ID number of read inode
+ *
+ * The inodes that have been allocated together (for example, files
+ * of one folder) are located in the neighbouring leaf nodes. This
+ * method queues the background read of the leaf nodes that follow
+ * the node of @ino. As a result, a bulk stat() of many inodes finds
+ * the nodes in memory. The readahead isn't repeated for the range
+ * that has been requested already.
+ */
+void ssdfs_inodes_btree_readahead(struct ssdfs_inodes_btree_info *tree,
+				  ino_t ino)
 {
+	u64 ino_array[SSDFS_INODES_BTREE_READAHEAD_NODES];
+	u64 items_per_node;
+	u64 upper_ino;
+	u64 readahead_ino;
+	u64 next_ino;
+	u16 count = 0;
+	int i;
+
 #ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!tree || !search);
+	BUG_ON(!tree);
 
-	SSDFS_DBG("tree %p, ino %lu, search %p\n",
-		  tree, ino, search);
+	SSDFS_DBG("tree %p, ino %lu\n", tree, ino);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	search->request.type = SSDFS_BTREE_SEARCH_FIND_ITEM;
+	if (tree->raw_inode_size == 0)
+		return;
 
-	if (need_initialize_inodes_btree_search(ino, search)) {
-		ssdfs_btree_search_init(search);
-		search->request.type = SSDFS_BTREE_SEARCH_FIND_ITEM;
-		search->request.flags =
-			SSDFS_BTREE_SEARCH_HAS_VALID_HASH_RANGE |
-			SSDFS_BTREE_SEARCH_HAS_VALID_COUNT;
-		search->request.start.hash = ino;
-		search->request.end.hash = ino;
-		search->request.count = 1;
+	items_per_node = tree->generic_tree.node_size / tree->raw_inode_size;
+	if (items_per_node == 0)
+		return;
+
+	spin_lock(&tree->lock);
+	upper_ino = tree->upper_allocated_ino;
+	spin_unlock(&tree->lock);
+
+	next_ino = ((u64)ino / items_per_node + 1) * items_per_node;
+
+	readahead_ino = atomic64_read(&tree->readahead_ino);
+	if (next_ino < readahead_ino &&
+	    (readahead_ino - next_ino) <=
+			(items_per_node * SSDFS_INODES_BTREE_READAHEAD_NODES))
+		return;
+
+	for (i = 0; i < SSDFS_INODES_BTREE_READAHEAD_NODES; i++) {
+		if (next_ino > upper_ino)
+			break;
+
+		ino_array[count++] = next_ino;
+		next_ino += items_per_node;
 	}
 
-	return ssdfs_btree_find_item(&tree->generic_tree, search);
+	if (count == 0)
+		return;
+
+	atomic64_set(&tree->readahead_ino, next_ino);
+	ssdfs_inodes_btree_prefetch(tree, ino_array, count);
 }
 
 /*
@@ -948,8 +1805,7 @@ int ssdfs_inodes_btree_allocate(struct ssdfs_inodes_btree_info *tree,
 
 	*ino = ULONG_MAX;
 
-	err = ssdfs_free_inodes_queue_get_first(&tree->free_inodes_queue,
-						&range);
+	err = ssdfs_inodes_btree_get_free_inode(tree, &range);
 	if (err == -ENODATA) {
 		ssdfs_btree_search_init(search);
 		search->request.type = SSDFS_BTREE_SEARCH_ALLOCATE_ITEM;
@@ -977,9 +1833,7 @@ int ssdfs_inodes_btree_allocate(struct ssdfs_inodes_btree_info *tree,
 			return err;
 		}
 
-		err =
-		    ssdfs_free_inodes_queue_get_first(&tree->free_inodes_queue,
-							&range);
+		err = ssdfs_inodes_btree_get_free_inode(tree, &range);
 	}
 
 	if (unlikely(err)) {
@@ -1034,6 +1888,8 @@ int ssdfs_inodes_btree_allocate(struct ssdfs_inodes_btree_info *tree,
 		goto finish_inode_allocation;
 	}
 
+	ssdfs_inodes_btree_queue_add_node(tree);
+
 finish_inode_allocation:
 	ssdfs_free_inodes_range_free(range);
 
@@ -1048,7 +1904,7 @@ finish_inode_allocation:
 }
 
 /*
- * ssdfs_inodes_btree_change() - change raw inode
+ * __ssdfs_inodes_btree_change() - change raw inode
  * @tree: pointer on inodes btree object
  * @ino: inode ID value
  * @search: pointer on search request object
@@ -1062,7 +1918,8 @@ finish_inode_allocation:
  * %-EINVAL     - invalid input.
  * %-ERANGE     - internal error.
  */
-int ssdfs_inodes_btree_change(struct ssdfs_inodes_btree_info *tree,
+static
+int __ssdfs_inodes_btree_change(struct ssdfs_inodes_btree_info *tree,
 				ino_t ino,
 				struct ssdfs_btree_search *search)
 {
@@ -1121,6 +1978,222 @@ int ssdfs_inodes_btree_change(struct ssdfs_inodes_btree_info *tree,
 	return 0;
 }
 
+/*
+ * ssdfs_inodes_btree_change() - change raw inode
+ * @tree: pointer on inodes btree object
+ * @ino: inode ID value
+ * @search: pointer on search request object
+ *
+ * This method tries to change the raw inode for @ino.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_inodes_btree_change(struct ssdfs_inodes_btree_info *tree,
+				ino_t ino,
+				struct ssdfs_btree_search *search)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !search);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	/* the image of the search is newer than the staged one */
+	ssdfs_inodes_btree_forget_staged(tree, ino, 1);
+
+	return __ssdfs_inodes_btree_change(tree, ino, search);
+}
+
+/*
+ * ssdfs_inodes_btree_stage_inode() - stage raw inode for delayed change
+ * @tree: pointer on inodes btree object
+ * @ino: inode ID value
+ * @raw_inode: raw inode's image
+ *
+ * This method keeps the raw inode's image in memory instead of
+ * the change of the inodes btree's node. The image replaces the previously
+ * staged image of the same inode. As a result, the repeated write-back
+ * of the same inode between the flushes results in one change
+ * of the node. The staged images are applied by the flush of the tree
+ * or when the number of staged images reaches the threshold.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - unable to allocate memory.
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_inodes_btree_stage_inode(struct ssdfs_inodes_btree_info *tree,
+				   ino_t ino,
+				   const struct ssdfs_inode *raw_inode)
+{
+	struct ssdfs_staged_raw_inode *new_item;
+	struct ssdfs_staged_raw_inode *staged;
+	size_t raw_inode_size = sizeof(struct ssdfs_inode);
+	bool need_apply;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !raw_inode);
+
+	SSDFS_DBG("tree %p, ino %lu\n", tree, ino);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	new_item = ssdfs_ino_tree_kzalloc(sizeof(*new_item), GFP_NOFS);
+	if (!new_item) {
+		SSDFS_ERR("fail to allocate staged raw inode\n");
+		return -ENOMEM;
+	}
+
+	new_item->ino = ino;
+	ssdfs_memcpy(&new_item->raw, 0, raw_inode_size,
+		     raw_inode, 0, raw_inode_size,
+		     raw_inode_size);
+
+	err = radix_tree_preload(GFP_NOFS);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to preload radix tree: err %d\n",
+			  err);
+		ssdfs_ino_tree_kfree(new_item);
+		return err;
+	}
+
+	spin_lock(&tree->staged_lock);
+	staged = radix_tree_lookup(&tree->staged_inodes, ino);
+	if (staged) {
+		ssdfs_memcpy(&staged->raw, 0, raw_inode_size,
+			     raw_inode, 0, raw_inode_size,
+			     raw_inode_size);
+	} else {
+		err = radix_tree_insert(&tree->staged_inodes, ino, new_item);
+		if (!err) {
+			tree->staged_count++;
+			new_item = NULL;
+		}
+	}
+	need_apply = tree->staged_count >= SSDFS_INODES_BTREE_STAGED_MAX;
+	spin_unlock(&tree->staged_lock);
+
+	radix_tree_preload_end();
+
+	if (new_item)
+		ssdfs_ino_tree_kfree(new_item);
+
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to stage raw inode: "
+			  "ino %lu, err %d\n",
+			  ino, err);
+		return err;
+	}
+
+	if (need_apply)
+		return ssdfs_inodes_btree_apply_staged(tree);
+
+	return 0;
+}
+
+/*
+ * ssdfs_inodes_btree_apply_staged() - apply staged raw inodes into the tree
+ * @tree: pointer on inodes btree object
+ *
+ * This method changes the raw inodes in the tree's nodes by
+ * the staged images. The images are applied in the ascending order
+ * of inode ID numbers. So, the neighbouring raw inodes are changed
+ * in the same node one after another.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - unable to allocate memory.
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_inodes_btree_apply_staged(struct ssdfs_inodes_btree_info *tree)
+{
+	struct ssdfs_staged_raw_inode *batch[SSDFS_INODES_BTREE_PREFETCH_MAX];
+	struct ssdfs_btree_search *search;
+	size_t raw_inode_size = sizeof(struct ssdfs_inode);
+	unsigned long start = 0;
+	unsigned int count;
+	unsigned int i;
+	int res;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree);
+
+	SSDFS_DBG("tree %p, staged_count %u\n",
+		  tree, tree->staged_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	spin_lock(&tree->staged_lock);
+	count = tree->staged_count;
+	spin_unlock(&tree->staged_lock);
+
+	if (count == 0)
+		return 0;
+
+	search = ssdfs_btree_search_alloc();
+	if (!search) {
+		SSDFS_ERR("fail to allocate btree search object\n");
+		return -ENOMEM;
+	}
+
+	do {
+		count = ssdfs_inodes_btree_extract_staged(tree, start, batch,
+							  ARRAY_SIZE(batch));
+
+		for (i = 0; i < count; i++) {
+			ino_t ino = (ino_t)batch[i]->ino;
+
+			start = ino + 1;
+
+			ssdfs_btree_search_reinit(search);
+
+			res = ssdfs_inodes_btree_find(tree, ino, search);
+			if (unlikely(res)) {
+				SSDFS_ERR("fail to find inode: "
+					  "ino %lu, err %d\n",
+					  ino, res);
+				goto finish_apply_item;
+			}
+
+			if (!search->result.buf ||
+			    search->result.buf_size < raw_inode_size) {
+				res = -ERANGE;
+				SSDFS_ERR("invalid buffer: ino %lu\n", ino);
+				goto finish_apply_item;
+			}
+
+			ssdfs_memcpy(search->result.buf,
+				     0, search->result.buf_size,
+				     &batch[i]->raw, 0, raw_inode_size,
+				     raw_inode_size);
+
+			res = __ssdfs_inodes_btree_change(tree, ino, search);
+			if (unlikely(res)) {
+				SSDFS_ERR("fail to change inode: "
+					  "ino %lu, err %d\n",
+					  ino, res);
+			}
+
+finish_apply_item:
+			if (unlikely(res) && !err)
+				err = res;
+
+			ssdfs_ino_tree_kfree(batch[i]);
+		}
+	} while (count > 0);
+
+	ssdfs_btree_search_free(search);
+
+	return err;
+}
+
 /*
  * ssdfs_inodes_btree_delete_range() - delete a range of raw inodes
  * @tree: pointer on inodes btree object
@@ -1162,6 +2235,8 @@ int ssdfs_inodes_btree_delete_range(struct ssdfs_inodes_btree_info *tree,
 		return 0;
 	}
 
+	ssdfs_inodes_btree_forget_staged(tree, ino, count);
+
 	search = ssdfs_btree_search_alloc();
 	if (!search) {
 		SSDFS_ERR("fail to allocate btree search object\n");
@@ -1528,8 +2603,8 @@ int ssdfs_inodes_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	err = ssdfs_btree_pre_flush_root_node(node);
 	if (unlikely(err)) {
@@ -1538,7 +2613,7 @@ int ssdfs_inodes_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 			  node->node_id, err);
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	return err;
@@ -1689,7 +2764,7 @@ int ssdfs_inodes_btree_create_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 	down_write(&node->bmap_array.lock);
 
 	switch (atomic_read(&node->type)) {
@@ -1832,7 +2907,7 @@ int ssdfs_inodes_btree_create_node(struct ssdfs_btree_node *node)
 
 finish_create_node:
 	up_write(&node->bmap_array.lock);
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		return err;
@@ -2188,7 +3263,7 @@ int ssdfs_inodes_btree_init_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	if (pagevec_count(&node->content.pvec) == 0) {
 		err = -ERANGE;
@@ -2231,7 +3306,7 @@ int ssdfs_inodes_btree_init_node(struct ssdfs_btree_node *node)
 		goto finish_init_operation;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&node->raw.inodes_header, 0, hdr_size,
 		     hdr, 0, hdr_size,
@@ -2420,7 +3495,7 @@ int ssdfs_inodes_btree_init_node(struct ssdfs_btree_node *node)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_header_init:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_init_operation;
@@ -2685,7 +3760,7 @@ int ssdfs_inodes_btree_node_correct_hash_range(struct ssdfs_btree_node *node,
 		return 0;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	items_count = node->items_area.items_count;
 	items_capacity = node->items_area.items_capacity;
@@ -2705,7 +3780,7 @@ int ssdfs_inodes_btree_node_correct_hash_range(struct ssdfs_btree_node *node,
 		break;
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	switch (atomic_read(&node->type)) {
 	case SSDFS_BTREE_HYBRID_NODE:
@@ -3010,8 +4085,8 @@ int ssdfs_inodes_btree_pre_flush_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&inodes_header, 0, hdr_size,
 		     &node->raw.inodes_header, 0, hdr_size,
@@ -3066,7 +4141,8 @@ int ssdfs_inodes_btree_pre_flush_node(struct ssdfs_btree_node *node)
 	up_read(&node->bmap_array.lock);
 
 	inodes_header.node.check.bytes = cpu_to_le16((u16)hdr_size);
-	inodes_header.node.check.flags = cpu_to_le16(SSDFS_CRC32);
+	inodes_header.node.check.flags =
+		cpu_to_le16(ssdfs_csum_type(node->tree->fsi));
 
 	err = ssdfs_calculate_csum(&inodes_header.node.check,
 				   &inodes_header, hdr_size);
@@ -3080,7 +4156,7 @@ int ssdfs_inodes_btree_pre_flush_node(struct ssdfs_btree_node *node)
 		     hdr_size);
 
 finish_inodes_header_preparation:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_node_pre_flush;
@@ -3144,7 +4220,7 @@ int ssdfs_inodes_btree_flush_node(struct ssdfs_btree_node *node)
 
 	fsi = node->tree->fsi;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	fs_feature_compat = fsi->fs_feature_compat;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -3754,7 +4830,7 @@ int __ssdfs_btree_node_allocate_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	err = ssdfs_lock_items_range(node, start, count);
 	if (err == -ENOENT) {
@@ -3838,7 +4914,7 @@ int __ssdfs_btree_node_allocate_range(struct ssdfs_btree_node *node,
 	BUG_ON(search->result.count == 0 || search->result.count >= U16_MAX);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 	hdr = &node->raw.inodes_header;
 	le16_add_cpu(&hdr->valid_inodes, (u16)count);
 	down_read(&node->bmap_array.lock);
@@ -3870,7 +4946,7 @@ int __ssdfs_btree_node_allocate_range(struct ssdfs_btree_node *node,
 		  le16_to_cpu(hdr->valid_inodes));
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 finish_change_node_header:
 	if (unlikely(err))
@@ -4324,7 +5400,7 @@ int __ssdfs_inodes_btree_node_insert_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	inodes_count = search->request.count;
 
@@ -4365,7 +5441,7 @@ finish_detect_affected_items:
 		goto unlock_items_range;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	node->items_area.items_count += search->request.count;
 	if (node->items_area.items_count > node->items_area.items_capacity) {
@@ -4392,7 +5468,7 @@ finish_detect_affected_items:
 	node->items_area.free_space -= used_space;
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -4698,21 +5774,24 @@ int ssdfs_inodes_btree_node_change_item(struct ssdfs_btree_node *node,
 
 	item_index = (u16)found_index;
 
-	down_write(&node->full_lock);
+	/*
+	 * Every inode has the fixed position in the node.
+	 * It needs to lock the range of changing items only.
+	 * As a result, different inodes can be changed concurrently.
+	 */
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	err = ssdfs_lock_items_range(node, item_index, search->result.count);
 	if (err == -ENOENT) {
-		up_write(&node->full_lock);
+		up_read(&node->full_lock);
 		return -ERANGE;
 	} else if (err == -ENODATA) {
-		up_write(&node->full_lock);
+		up_read(&node->full_lock);
 		wake_up_all(&node->wait_queue);
 		return -ERANGE;
 	} else if (unlikely(err))
 		BUG();
 
-	downgrade_write(&node->full_lock);
-
 	if (!is_ssdfs_node_items_range_allocated(node, items_capacity,
 						 item_index,
 						 search->result.count)) {
@@ -4782,7 +5861,7 @@ int ssdfs_correct_hybrid_node_hashes(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	items_count = node->items_area.items_count;
 
@@ -4829,7 +5908,7 @@ int ssdfs_correct_hybrid_node_hashes(struct ssdfs_btree_node *node)
 	node->items_area.end_hash = end_hash;
 
 unlock_header:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (err == -ENODATA) {
 		err = 0;
@@ -4998,7 +6077,7 @@ int __ssdfs_inodes_btree_node_delete_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	err = ssdfs_lock_items_range(node, item_index, search->request.count);
 	if (err == -ENOENT) {
@@ -5054,7 +6133,7 @@ int __ssdfs_inodes_btree_node_delete_range(struct ssdfs_btree_node *node,
 	BUG_ON(search->request.count != search->result.count);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	hdr = &node->raw.inodes_header;
 	valid_inodes = le16_to_cpu(hdr->valid_inodes);
@@ -5097,7 +6176,7 @@ int __ssdfs_inodes_btree_node_delete_range(struct ssdfs_btree_node *node,
 		  node->items_area.end_hash);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 finish_change_node_header:
 	if (unlikely(err))
@@ -5380,7 +6459,7 @@ int ssdfs_inodes_btree_node_extract_range(struct ssdfs_btree_node *node,
 		  search->node.child);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_node_extract_range(node, start_index, count,
 						sizeof(struct ssdfs_inode),
 						search);
@@ -22,6 +22,26 @@
 #ifndef _SSDFS_INODES_TREE_H
 #define _SSDFS_INODES_TREE_H
 
+#include <linux/workqueue.h>
+
+/*
+ * The next leaf node is added in the background when the last
+ * free inodes range is shorter than the 1/N part of node's capacity.
+ */
+#define SSDFS_INODES_BTREE_ADD_NODE_RATIO	(4)
+
+/* Number of free inodes that CPU reserves from the queue at once */
+#define SSDFS_INODES_PERCPU_CACHE_BATCH		(16)
+
+/* Maximal number of staged raw inodes before applying into the tree */
+#define SSDFS_INODES_BTREE_STAGED_MAX		(256)
+
+/* Number of following leaf nodes for readahead on inode's read */
+#define SSDFS_INODES_BTREE_READAHEAD_NODES	(2)
+
+/* Maximal number of inodes in one prefetch request */
+#define SSDFS_INODES_BTREE_PREFETCH_MAX		(32)
+
 /*
  * struct ssdfs_inodes_range - items range
  * @start_hash: starting hash
@@ -58,6 +78,26 @@ struct ssdfs_free_inode_range_queue {
 	struct list_head list;
 };
 
+/*
+ * struct ssdfs_staged_raw_inode - raw inode waiting for applying into tree
+ * @ino: inode ID number
+ * @raw: raw inode's image
+ */
+struct ssdfs_staged_raw_inode {
+	u64 ino;
+	struct ssdfs_inode raw;
+};
+
+/*
+ * struct ssdfs_inodes_percpu_cache - per-CPU cache of free inodes
+ * @lock: cache's lock
+ * @range: free inodes range reserved by the CPU
+ */
+struct ssdfs_inodes_percpu_cache {
+	spinlock_t lock;
+	struct ssdfs_inodes_btree_range range;
+};
+
 /*
  * struct ssdfs_inodes_btree_info - inodes btree info
  * @generic_tree: generic btree description
@@ -71,7 +111,15 @@ struct ssdfs_free_inode_range_queue {
  * @leaf_nodes: count of leaf nodes in the whole tree
  * @nodes_count: count of all nodes in the whole tree
  * @raw_inode_size: size in bytes of raw inode
+ * @add_node_work: work of adding the next leaf node in the background
+ * @add_node_hash: starting hash of the next leaf node
+ * @add_node_pending: has the adding of the next leaf node been queued?
  * @free_inodes_queue: queue of free inode descriptors
+ * @percpu_cache: per-CPU caches of free inodes
+ * @readahead_ino: upper inode ID number of issued readahead
+ * @staged_lock: staged raw inodes' lock
+ * @staged_inodes: radix tree of staged raw inodes (by inode ID)
+ * @staged_count: number of staged raw inodes
  */
 struct ssdfs_inodes_btree_info {
 	struct ssdfs_btree generic_tree;
@@ -87,6 +135,10 @@ struct ssdfs_inodes_btree_info {
 	u32 nodes_count;
 	u16 raw_inode_size;
 
+	struct work_struct add_node_work;
+	u64 add_node_hash;
+	atomic_t add_node_pending;
+
 /*
  * Inodes btree should have special allocation queue.
  * If a btree nodes has free (not allocated) inodes
@@ -105,6 +157,14 @@ struct ssdfs_inodes_btree_info {
  * new items should be done from last leaf btree's node.
  */
 	struct ssdfs_free_inode_range_queue free_inodes_queue;
+
+	struct ssdfs_inodes_percpu_cache __percpu *percpu_cache;
+
+	atomic64_t readahead_ino;
+
+	spinlock_t staged_lock;
+	struct radix_tree_root staged_inodes;
+	u32 staged_count;
 };
 
 /*
@@ -136,6 +196,22 @@ bool is_free_inodes_range_invalid(struct ssdfs_inodes_btree_range *range)
 	return is_invalid;
 }
 
+/*
+ * Inline functions
+ */
+
+/*
+ * ssdfs_raw_inode_time() - convert raw inode's time into timestamp
+ * @secs: seconds
+ * @nsecs: nanoseconds
+ */
+static inline
+u64 ssdfs_raw_inode_time(__le64 secs, __le32 nsecs)
+{
+	return (le64_to_cpu(secs) * SSDFS_NANOSECS_PER_SEC) +
+		le32_to_cpu(nsecs);
+}
+
 /*
  * Free inodes range API
  */
@@ -156,9 +232,20 @@ int ssdfs_inodes_btree_allocate(struct ssdfs_inodes_btree_info *tree,
 int ssdfs_inodes_btree_find(struct ssdfs_inodes_btree_info *tree,
 			    ino_t ino,
 			    struct ssdfs_btree_search *search);
+int ssdfs_inodes_btree_find_changed(struct ssdfs_inodes_btree_info *tree,
+				    u64 *ino, u64 start_time, u64 end_time,
+				    struct ssdfs_inode *raw_inode);
+void ssdfs_inodes_btree_prefetch(struct ssdfs_inodes_btree_info *tree,
+				 const u64 *ino, u16 count);
+void ssdfs_inodes_btree_readahead(struct ssdfs_inodes_btree_info *tree,
+				  ino_t ino);
 int ssdfs_inodes_btree_change(struct ssdfs_inodes_btree_info *tree,
 				ino_t ino,
 				struct ssdfs_btree_search *search);
+int ssdfs_inodes_btree_stage_inode(struct ssdfs_inodes_btree_info *tree,
+				   ino_t ino,
+				   const struct ssdfs_inode *raw_inode);
+int ssdfs_inodes_btree_apply_staged(struct ssdfs_inodes_btree_info *tree);
 int ssdfs_inodes_btree_delete(struct ssdfs_inodes_btree_info *tree,
 				ino_t ino);
 int ssdfs_inodes_btree_delete_range(struct ssdfs_inodes_btree_info *tree,
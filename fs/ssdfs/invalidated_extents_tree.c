@@ -1382,8 +1382,8 @@ int ssdfs_invextree_pre_flush_root_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	err = ssdfs_btree_pre_flush_root_node(node);
 	if (unlikely(err)) {
@@ -1392,7 +1392,7 @@ int ssdfs_invextree_pre_flush_root_node(struct ssdfs_btree_node *node)
 			  node->node_id, err);
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	return err;
@@ -1542,7 +1542,7 @@ int ssdfs_invextree_create_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 	down_write(&node->bmap_array.lock);
 
 	switch (atomic_read(&node->type)) {
@@ -1713,7 +1713,7 @@ int ssdfs_invextree_create_node(struct ssdfs_btree_node *node)
 
 finish_create_node:
 	up_write(&node->bmap_array.lock);
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		return err;
@@ -1821,7 +1821,7 @@ int ssdfs_invextree_init_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	if (pagevec_count(&node->content.pvec) == 0) {
 		err = -ERANGE;
@@ -1856,7 +1856,7 @@ int ssdfs_invextree_init_node(struct ssdfs_btree_node *node)
 		goto finish_init_operation;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&node->raw.invextree_header, 0, hdr_size,
 		     hdr, 0, hdr_size,
@@ -2049,7 +2049,7 @@ int ssdfs_invextree_init_node(struct ssdfs_btree_node *node)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_header_init:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_init_operation;
@@ -2372,8 +2372,8 @@ int ssdfs_invextree_pre_flush_node(struct ssdfs_btree_node *node)
 					 generic_tree);
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&invextree_header, 0, hdr_size,
 		     &node->raw.invextree_header, 0, hdr_size,
@@ -2421,7 +2421,8 @@ int ssdfs_invextree_pre_flush_node(struct ssdfs_btree_node *node)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	invextree_header.node.check.bytes = cpu_to_le16((u16)hdr_size);
-	invextree_header.node.check.flags = cpu_to_le16(SSDFS_CRC32);
+	invextree_header.node.check.flags =
+		cpu_to_le16(ssdfs_csum_type(node->tree->fsi));
 
 	err = ssdfs_calculate_csum(&invextree_header.node.check,
 				   &invextree_header, hdr_size);
@@ -2435,7 +2436,7 @@ int ssdfs_invextree_pre_flush_node(struct ssdfs_btree_node *node)
 		     hdr_size);
 
 finish_invextree_header_preparation:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_node_pre_flush;
@@ -2499,7 +2500,7 @@ int ssdfs_invextree_flush_node(struct ssdfs_btree_node *node)
 
 	fsi = node->tree->fsi;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	fs_feature_compat = fsi->fs_feature_compat;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -4062,7 +4063,7 @@ int ssdfs_invextree_node_do_insert_range(struct ssdfs_invextree_info *tree,
 		return err;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	node->items_area.items_count += search->request.count;
 	if (node->items_area.items_count > node->items_area.items_capacity) {
@@ -4154,7 +4155,7 @@ int ssdfs_invextree_node_do_insert_range(struct ssdfs_invextree_info *tree,
 	atomic64_add(search->request.count, &tree->extents_count);
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -4279,7 +4280,7 @@ int ssdfs_invextree_node_merge_range_left(struct ssdfs_invextree_info *tree,
 		return err;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	if (search->request.count > 1) {
 		node->items_area.items_count += added_extents;
@@ -4376,7 +4377,7 @@ int ssdfs_invextree_node_merge_range_left(struct ssdfs_invextree_info *tree,
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -4500,7 +4501,7 @@ int ssdfs_invextree_node_merge_range_right(struct ssdfs_invextree_info *tree,
 		return err;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	if (search->request.count > 1) {
 		node->items_area.items_count += added_extents;
@@ -4597,7 +4598,7 @@ int ssdfs_invextree_node_merge_range_right(struct ssdfs_invextree_info *tree,
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -4770,7 +4771,7 @@ ssdfs_invextree_node_merge_left_and_right(struct ssdfs_invextree_info *tree,
 		return err;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	if (search->request.count <= 0) {
 		err = -ERANGE;
@@ -4902,7 +4903,7 @@ ssdfs_invextree_node_merge_left_and_right(struct ssdfs_invextree_info *tree,
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -4910,6 +4911,113 @@ finish_items_area_correction:
 	return err;
 }
 
+/*
+ * ssdfs_invextree_trim_left_overlap() - trim range overlapped by left extent
+ * @fsi: pointer on shared file system object
+ * @left: left extent in the node
+ * @prepared: inserting extent [in|out]
+ *
+ * This method excludes the logical blocks of @prepared that are
+ * invalidated by @left already. As a result, @prepared starts
+ * right after the end of @left and can be merged with it.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - extents are not overlapped.
+ * %-EEXIST     - @prepared is covered by @left completely.
+ */
+static
+int ssdfs_invextree_trim_left_overlap(struct ssdfs_fs_info *fsi,
+				      struct ssdfs_raw_extent *left,
+				      struct ssdfs_raw_extent *prepared)
+{
+	u32 left_start, left_end;
+	u32 start, end;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !left || !prepared);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (left->seg_id != prepared->seg_id)
+		return -ERANGE;
+
+	left_start = le32_to_cpu(left->logical_blk);
+	left_end = left_start + le32_to_cpu(left->len) - 1;
+	start = le32_to_cpu(prepared->logical_blk);
+	end = start + le32_to_cpu(prepared->len) - 1;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("left (start %u, end %u), prepared (start %u, end %u)\n",
+		  left_start, left_end, start, end);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (left_start > start || left_end < start)
+		return -ERANGE;
+
+	if (left_end >= end)
+		return -EEXIST;
+
+	prepared->logical_blk = cpu_to_le32(left_end + 1);
+	prepared->len = cpu_to_le32(end - left_end);
+
+	return 0;
+}
+
+/*
+ * ssdfs_invextree_trim_right_overlap() - trim range overlapped by right extent
+ * @fsi: pointer on shared file system object
+ * @right: right extent in the node
+ * @prepared: inserting extent [in|out]
+ *
+ * This method excludes the logical blocks of @prepared that are
+ * invalidated by @right already. As a result, @prepared ends
+ * right before the beginning of @right and can be merged with it.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - extents cannot be merged.
+ */
+static
+int ssdfs_invextree_trim_right_overlap(struct ssdfs_fs_info *fsi,
+					struct ssdfs_raw_extent *right,
+					struct ssdfs_raw_extent *prepared)
+{
+	u32 right_start, right_end;
+	u32 start, end;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !right || !prepared);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (right->seg_id != prepared->seg_id)
+		return -ERANGE;
+
+	right_start = le32_to_cpu(right->logical_blk);
+	right_end = right_start + le32_to_cpu(right->len) - 1;
+	start = le32_to_cpu(prepared->logical_blk);
+	end = start + le32_to_cpu(prepared->len) - 1;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("right (start %u, end %u), prepared (start %u, end %u)\n",
+		  right_start, right_end, start, end);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	/*
+	 * The extent that covers the right one completely
+	 * cannot be trimmed without the loss of blocks.
+	 */
+	if (start >= right_start || end < right_start || end > right_end)
+		return -ERANGE;
+
+	prepared->len = cpu_to_le32(right_start - start);
+
+	return 0;
+}
+
 /*
  * __ssdfs_invextree_node_insert_range() - insert range into node
  * @node: pointer on node object
@@ -5074,7 +5182,7 @@ int __ssdfs_invextree_node_insert_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -5162,6 +5270,37 @@ int __ssdfs_invextree_node_insert_range(struct ssdfs_btree_node *node,
 				 */
 				need_merge_with_left = true;
 			}
+		} else if (search->result.items_in_buffer == 1) {
+			prepared =
+				(struct ssdfs_raw_extent *)search->result.buf;
+
+			err = ssdfs_invextree_trim_left_overlap(fsi, &found,
+								prepared);
+			if (err == -EEXIST) {
+#ifdef CONFIG_SSDFS_DEBUG
+				SSDFS_DBG("extent is invalidated already\n");
+#endif /* CONFIG_SSDFS_DEBUG */
+				goto finish_detect_affected_items;
+			} else if (unlikely(err)) {
+				SSDFS_ERR("invalid range: item_index %u, "
+					  "cur_hash %llx, "
+					  "start_hash %llx, end_hash %llx\n",
+					  item_index, cur_hash,
+					  start_hash, end_hash);
+
+				ssdfs_show_extent_items(node, &items_area);
+				goto finish_detect_affected_items;
+			}
+
+			start_hash = ssdfs_invextree_calculate_hash(fsi,
+					le64_to_cpu(prepared->seg_id),
+					le32_to_cpu(prepared->logical_blk));
+			search->request.start.hash = start_hash;
+
+			/*
+			 * Trimmed and left extents need to be merged
+			 */
+			need_merge_with_left = true;
 		} else {
 			SSDFS_ERR("invalid range: item_index %u, "
 				  "cur_hash %llx, "
@@ -5208,6 +5347,33 @@ int __ssdfs_invextree_node_insert_range(struct ssdfs_btree_node *node,
 				 */
 				need_merge_with_right = true;
 			}
+		} else if (search->result.items_in_buffer == 1) {
+			prepared =
+				(struct ssdfs_raw_extent *)search->result.buf;
+
+			err = ssdfs_invextree_trim_right_overlap(fsi, &found,
+								 prepared);
+			if (unlikely(err)) {
+				SSDFS_ERR("invalid range: item_index %u, "
+					  "cur_hash %llx, "
+					  "start_hash %llx, end_hash %llx\n",
+					  item_index, cur_hash,
+					  start_hash, end_hash);
+
+				ssdfs_show_extent_items(node, &items_area);
+				goto finish_detect_affected_items;
+			}
+
+			end_hash = ssdfs_invextree_calculate_hash(fsi,
+					le64_to_cpu(prepared->seg_id),
+					le32_to_cpu(prepared->logical_blk) +
+					le32_to_cpu(prepared->len) - 1);
+			search->request.end.hash = end_hash;
+
+			/*
+			 * Trimmed and right extents need to be merged
+			 */
+			need_merge_with_right = true;
 		} else {
 			SSDFS_ERR("invalid range: item_index %u, "
 				  "cur_hash %llx, "
@@ -5631,7 +5797,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 		return err;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	start_hash = node->items_area.start_hash;
 	end_hash = node->items_area.end_hash;
@@ -5690,7 +5856,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -5803,7 +5969,7 @@ int ssdfs_invextree_node_change_item(struct ssdfs_btree_node *node,
 		return -EFAULT;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -5983,7 +6149,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	switch (atomic_read(&node->items_area.state)) {
 	case SSDFS_BTREE_NODE_ITEMS_AREA_EXIST:
@@ -6013,7 +6179,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		break;
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -6354,7 +6520,7 @@ int __ssdfs_invextree_node_delete_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -6501,7 +6667,7 @@ finish_detect_affected_items:
 		}
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("INITIAL STATE: node_id %u, "
@@ -6675,7 +6841,7 @@ finish_detect_affected_items:
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -6919,7 +7085,7 @@ int ssdfs_invextree_node_extract_range(struct ssdfs_btree_node *node,
 
 	fsi = node->tree->fsi;
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_node_extract_range(node, start_index, count,
 						sizeof(struct ssdfs_raw_extent),
 						search);
@@ -27,7 +27,12 @@
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
 #include "ssdfs.h"
+#include "btree_search.h"
+#include "btree_node.h"
+#include "btree.h"
+#include "inodes_tree.h"
 #include "testing.h"
+#include "compression.h"
 #include "ioctl.h"
 
 static int ssdfs_ioctl_getflags(struct file *file, void __user *arg)
@@ -102,6 +107,35 @@ static int ssdfs_ioctl_do_testing(struct file *file, void __user *arg)
 	return ssdfs_do_testing(fsi, &env);
 }
 
+static int ssdfs_ioctl_do_benchmark(struct file *file, void __user *arg)
+{
+	struct inode *inode = file_inode(file);
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
+	struct ssdfs_benchmark_environment *benv;
+	size_t benv_size = sizeof(struct ssdfs_benchmark_environment);
+	int err;
+
+	benv = kzalloc(benv_size, GFP_KERNEL);
+	if (!benv)
+		return -ENOMEM;
+
+	if (copy_from_user(&benv->env, arg, sizeof(benv->env))) {
+		err = -EFAULT;
+		goto free_environment;
+	}
+
+	err = ssdfs_do_benchmark(fsi, benv);
+	if (err)
+		goto free_environment;
+
+	if (copy_to_user(arg, benv, benv_size))
+		err = -EFAULT;
+
+free_environment:
+	kfree(benv);
+	return err;
+}
+
 static int ssdfs_ioctl_create_snapshot(struct file *file, void __user *arg)
 {
 	struct inode *inode = file_inode(file);
@@ -366,6 +400,160 @@ finish_list_snapshot_rules:
 	return err;
 }
 
+static int ssdfs_ioctl_list_changed_inodes(struct file *file,
+					   void __user *arg)
+{
+	struct inode *inode = file_inode(file);
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
+	struct ssdfs_snapshot_diff_info info;
+	struct ssdfs_changed_inode_details details;
+	struct ssdfs_inode raw_inode;
+	size_t info_size = sizeof(struct ssdfs_snapshot_diff_info);
+	size_t details_size = sizeof(struct ssdfs_changed_inode_details);
+	u64 written_bytes = 0;
+	u64 birthtime;
+	u64 ino;
+	int err = 0;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (copy_from_user(&info, arg, info_size))
+		return -EFAULT;
+
+	if (!info.buf || info.buf_size < details_size)
+		return -EINVAL;
+
+	if (info.end_time == U64_MAX)
+		info.end_time = ssdfs_current_timestamp();
+
+	ino = info.start_ino;
+	info.count = 0;
+
+	while ((written_bytes + details_size) <= info.buf_size) {
+		err = ssdfs_inodes_btree_find_changed(fsi->inodes_tree, &ino,
+						      info.start_time,
+						      info.end_time,
+						      &raw_inode);
+		if (err == -ENODATA) {
+			err = 0;
+			ino = U64_MAX;
+			break;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to find changed inode: "
+				  "ino %llu, err %d\n",
+				  ino, err);
+			goto finish_list_changed_inodes;
+		}
+
+		memset(&details, 0, details_size);
+
+		details.ino = ino;
+		details.mode = le16_to_cpu(raw_inode.mode);
+		details.ctime = ssdfs_raw_inode_time(raw_inode.ctime,
+						     raw_inode.ctime_nsec);
+		details.mtime = ssdfs_raw_inode_time(raw_inode.mtime,
+						     raw_inode.mtime_nsec);
+		details.size = le64_to_cpu(raw_inode.size);
+		details.parent_ino = le64_to_cpu(raw_inode.parent_ino);
+
+		birthtime = ssdfs_raw_inode_time(raw_inode.birthtime,
+						 raw_inode.birthtime_nsec);
+		if (birthtime > info.start_time)
+			details.flags |= SSDFS_INODE_CREATED_IN_RANGE;
+		else
+			details.flags |= SSDFS_INODE_CHANGED_IN_RANGE;
+
+		if (copy_to_user(info.buf + written_bytes,
+				 &details, details_size)) {
+			err = -EFAULT;
+			goto finish_list_changed_inodes;
+		}
+
+		written_bytes += details_size;
+		info.count++;
+		ino++;
+	}
+
+	info.start_ino = ino;
+
+	if (copy_to_user((struct ssdfs_snapshot_diff_info __user *)arg,
+			 &info, info_size))
+		err = -EFAULT;
+
+finish_list_changed_inodes:
+	return err;
+}
+
+static int ssdfs_ioctl_get_compr_policy(struct file *file, void __user *arg)
+{
+	struct inode *inode = file_inode(file);
+	u32 policy;
+
+	policy = (u32)ssdfs_inode_compr_policy(SSDFS_I(inode));
+	return put_user(policy, (u32 __user *)arg);
+}
+
+static int ssdfs_ioctl_set_compr_policy(struct file *file, void __user *arg)
+{
+	struct inode *inode = file_inode(file);
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+	int compr_type;
+	u32 policy;
+	int err = 0;
+
+	if (!inode_owner_or_capable(&init_user_ns, inode))
+		return -EACCES;
+
+	if (get_user(policy, (u32 __user *)arg))
+		return -EFAULT;
+
+	switch (policy) {
+	case SSDFS_COMPR_POLICY_DEFAULT:
+	case SSDFS_COMPR_POLICY_NONE:
+		compr_type = SSDFS_COMPR_NONE;
+		break;
+	case SSDFS_COMPR_POLICY_ZLIB:
+		compr_type = SSDFS_COMPR_ZLIB;
+		break;
+	case SSDFS_COMPR_POLICY_LZO:
+		compr_type = SSDFS_COMPR_LZO;
+		break;
+	case SSDFS_COMPR_POLICY_ZSTD:
+		compr_type = SSDFS_COMPR_ZSTD;
+		break;
+	case SSDFS_COMPR_POLICY_LZ4:
+		compr_type = SSDFS_COMPR_LZ4;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (!ssdfs_compressors[compr_type])
+		return -EOPNOTSUPP;
+
+	err = mnt_want_write_file(file);
+	if (err)
+		return err;
+
+	inode_lock(inode);
+	down_write(&ii->lock);
+
+	if (policy == SSDFS_COMPR_POLICY_NONE)
+		ii->flags |= SSDFS_NOCOMP_FL;
+	else
+		ii->flags &= ~SSDFS_NOCOMP_FL;
+
+	ssdfs_inode_set_compr_policy(ii, (int)policy);
+	inode->i_ctime = current_time(inode);
+	mark_inode_dirty(inode);
+
+	up_write(&ii->lock);
+	inode_unlock(inode);
+	mnt_drop_write_file(file);
+	return err;
+}
+
 /*
  * The ssdfs_ioctl() is called by the ioctl(2) system call.
  */
@@ -380,6 +568,8 @@ long ssdfs_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		return ssdfs_ioctl_setflags(file, argp);
 	case SSDFS_IOC_DO_TESTING:
 		return ssdfs_ioctl_do_testing(file, argp);
+	case SSDFS_IOC_DO_BENCHMARK:
+		return ssdfs_ioctl_do_benchmark(file, argp);
 	case SSDFS_IOC_CREATE_SNAPSHOT:
 		return ssdfs_ioctl_create_snapshot(file, argp);
 	case SSDFS_IOC_LIST_SNAPSHOTS:
@@ -394,6 +584,12 @@ long ssdfs_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		return ssdfs_ioctl_show_snapshot_details(file, argp);
 	case SSDFS_IOC_LIST_SNAPSHOT_RULES:
 		return ssdfs_ioctl_list_snapshot_rules(file, argp);
+	case SSDFS_IOC_LIST_CHANGED_INODES:
+		return ssdfs_ioctl_list_changed_inodes(file, argp);
+	case SSDFS_IOC_GET_COMPR_POLICY:
+		return ssdfs_ioctl_get_compr_policy(file, argp);
+	case SSDFS_IOC_SET_COMPR_POLICY:
+		return ssdfs_ioctl_set_compr_policy(file, argp);
 	}
 
 	return -ENOTTY;
@@ -45,5 +45,19 @@
 					     struct ssdfs_snapshot_info)
 #define SSDFS_IOC_LIST_SNAPSHOT_RULES	_IOWR(SSDFS_IOCTL_MAGIC, 8, \
 					     struct ssdfs_snapshot_info)
+#define SSDFS_IOC_LIST_CHANGED_INODES	_IOWR(SSDFS_IOCTL_MAGIC, 9, \
+					     struct ssdfs_snapshot_diff_info)
+
+/*
+ * Compression policy related IOCTLs (SSDFS_COMPR_POLICY_*)
+ */
+#define SSDFS_IOC_GET_COMPR_POLICY	_IOR(SSDFS_IOCTL_MAGIC, 10, __u32)
+#define SSDFS_IOC_SET_COMPR_POLICY	_IOW(SSDFS_IOCTL_MAGIC, 11, __u32)
+
+/*
+ * SSDFS_IOC_DO_BENCHMARK - run internal testing with timing of phases
+ */
+#define SSDFS_IOC_DO_BENCHMARK		_IOWR(SSDFS_IOCTL_MAGIC, 12, \
+					     struct ssdfs_benchmark_environment)
 
 #endif /* _SSDFS_IOCTL_H */
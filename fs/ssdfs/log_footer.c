@@ -673,7 +673,7 @@ int ssdfs_prepare_current_segment_ids(struct ssdfs_fs_info *fsi,
 	memset(array, 0xFF, size);
 
 	if (fsi->cur_segs) {
-		down_read(&fsi->cur_segs->lock);
+		SSDFS_DOWN_READ(cur_segs, &fsi->cur_segs->lock);
 		for (i = 0; i < count; i++) {
 			struct ssdfs_segment_info *real_seg;
 			u64 seg;
@@ -732,6 +732,7 @@ int ssdfs_prepare_volume_state_info_for_commit(struct ssdfs_fs_info *fsi,
 						u64 last_log_cno,
 						struct ssdfs_volume_state *vs)
 {
+	u64 free_pages;
 	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -756,12 +757,14 @@ int ssdfs_prepare_volume_state_info_for_commit(struct ssdfs_fs_info *fsi,
 	vs->magic.version.major = SSDFS_MAJOR_REVISION;
 	vs->magic.version.minor = SSDFS_MINOR_REVISION;
 
-	spin_lock(&fsi->volume_state_lock);
+	free_pages = ssdfs_fs_counter_sum(&fsi->free_pages);
+
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 
 	fsi->fs_mod_time = last_log_time;
 	fsi->fs_state = fs_state;
 
-	vs->free_pages = cpu_to_le64(fsi->free_pages);
+	vs->free_pages = cpu_to_le64(free_pages);
 	vs->timestamp = cpu_to_le64(last_log_time);
 	vs->cno = cpu_to_le64(last_log_cno);
 	vs->flags = cpu_to_le32(fsi->fs_flags);
@@ -889,7 +892,8 @@ int ssdfs_prepare_log_footer_for_commit(struct ssdfs_fs_info *fsi,
 	footer->log_flags = cpu_to_le32(log_flags);
 
 	footer->volume_state.check.bytes = cpu_to_le16(data_size);
-	footer->volume_state.check.flags = cpu_to_le16(SSDFS_CRC32);
+	footer->volume_state.check.flags =
+				cpu_to_le16(ssdfs_csum_type(fsi));
 
 	err = ssdfs_calculate_csum(&footer->volume_state.check,
 				   footer, data_size);
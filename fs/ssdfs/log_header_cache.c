@@ -0,0 +1,442 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * SSDFS -- SSD-oriented File System.
+ *
+ * fs/ssdfs/log_header_cache.c - log header/footer cache implementation.
+ *
+ * Copyright (c) 2023 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ * All rights reserved.
+ *
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/hash.h>
+#include <linux/pagevec.h>
+
+#include "peb_mapping_queue.h"
+#include "peb_mapping_table_cache.h"
+#include "page_vector.h"
+#include "ssdfs.h"
+#include "log_header_cache.h"
+
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+atomic64_t ssdfs_lhdr_cache_page_leaks;
+atomic64_t ssdfs_lhdr_cache_memory_leaks;
+atomic64_t ssdfs_lhdr_cache_cache_leaks;
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+
+/*
+ * void ssdfs_lhdr_cache_cache_leaks_increment(void *kaddr)
+ * void ssdfs_lhdr_cache_cache_leaks_decrement(void *kaddr)
+ * void *ssdfs_lhdr_cache_kmalloc(size_t size, gfp_t flags)
+ * void *ssdfs_lhdr_cache_kzalloc(size_t size, gfp_t flags)
+ * void *ssdfs_lhdr_cache_kcalloc(size_t n, size_t size, gfp_t flags)
+ * void ssdfs_lhdr_cache_kfree(void *kaddr)
+ * struct page *ssdfs_lhdr_cache_alloc_page(gfp_t gfp_mask)
+ * struct page *ssdfs_lhdr_cache_add_pagevec_page(struct pagevec *pvec)
+ * void ssdfs_lhdr_cache_free_page(struct page *page)
+ * void ssdfs_lhdr_cache_pagevec_release(struct pagevec *pvec)
+ */
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+	SSDFS_MEMORY_LEAKS_CHECKER_FNS(lhdr_cache)
+#else
+	SSDFS_MEMORY_ALLOCATOR_FNS(lhdr_cache)
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+
+void ssdfs_lhdr_cache_memory_leaks_init(void)
+{
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+	atomic64_set(&ssdfs_lhdr_cache_page_leaks, 0);
+	atomic64_set(&ssdfs_lhdr_cache_memory_leaks, 0);
+	atomic64_set(&ssdfs_lhdr_cache_cache_leaks, 0);
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+}
+
+void ssdfs_lhdr_cache_check_memory_leaks(void)
+{
+#ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
+	if (atomic64_read(&ssdfs_lhdr_cache_page_leaks) != 0) {
+		SSDFS_ERR("LOG HEADER CACHE: "
+			  "memory leaks include %lld pages\n",
+			  atomic64_read(&ssdfs_lhdr_cache_page_leaks));
+	}
+
+	if (atomic64_read(&ssdfs_lhdr_cache_memory_leaks) != 0) {
+		SSDFS_ERR("LOG HEADER CACHE: "
+			  "memory allocator suffers from %lld leaks\n",
+			  atomic64_read(&ssdfs_lhdr_cache_memory_leaks));
+	}
+
+	if (atomic64_read(&ssdfs_lhdr_cache_cache_leaks) != 0) {
+		SSDFS_ERR("LOG HEADER CACHE: "
+			  "caches suffers from %lld leaks\n",
+			  atomic64_read(&ssdfs_lhdr_cache_cache_leaks));
+	}
+#endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
+}
+
+static inline
+struct hlist_head *ssdfs_log_hdr_cache_bucket(struct ssdfs_log_hdr_cache *cache,
+					      u64 peb_id)
+{
+	return &cache->buckets[hash_64(peb_id, SSDFS_LOG_HDR_CACHE_HASH_BITS)];
+}
+
+/*
+ * __ssdfs_log_hdr_cache_lookup() - find item in the cache
+ * @cache: log header cache
+ * @peb_id: PEB identification number
+ * @page_off: page offset of header/footer inside of PEB
+ *
+ * This method tries to find the item in the hash table.
+ * The caller has to hold the cache's lock.
+ */
+static
+struct ssdfs_log_hdr_cache_item *
+__ssdfs_log_hdr_cache_lookup(struct ssdfs_log_hdr_cache *cache,
+			     u64 peb_id, u32 page_off)
+{
+	struct ssdfs_log_hdr_cache_item *item;
+	struct hlist_head *head;
+
+	head = ssdfs_log_hdr_cache_bucket(cache, peb_id);
+
+	hlist_for_each_entry(item, head, hnode) {
+		if (item->peb_id == peb_id && item->page_off == page_off)
+			return item;
+	}
+
+	return NULL;
+}
+
+/*
+ * ssdfs_log_hdr_cache_create() - create log header cache
+ * @fsi: pointer on shared file system object
+ *
+ * This method tries to create the cache of checked
+ * log headers and footers.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ */
+int ssdfs_log_hdr_cache_create(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_log_hdr_cache *cache;
+	int i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi);
+
+	SSDFS_DBG("fsi %p\n", fsi);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	cache = ssdfs_lhdr_cache_kzalloc(sizeof(struct ssdfs_log_hdr_cache),
+					 GFP_KERNEL);
+	if (!cache) {
+		SSDFS_ERR("fail to allocate log header cache\n");
+		return -ENOMEM;
+	}
+
+	spin_lock_init(&cache->lock);
+	for (i = 0; i < SSDFS_LOG_HDR_CACHE_BUCKETS; i++)
+		INIT_HLIST_HEAD(&cache->buckets[i]);
+	INIT_LIST_HEAD(&cache->lru);
+	cache->count = 0;
+	cache->capacity = SSDFS_LOG_HDR_CACHE_CAPACITY;
+
+	fsi->log_hdr_cache = cache;
+
+	return 0;
+}
+
+/*
+ * ssdfs_log_hdr_cache_destroy() - destroy log header cache
+ * @fsi: pointer on shared file system object
+ */
+void ssdfs_log_hdr_cache_destroy(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_log_hdr_cache *cache;
+	struct ssdfs_log_hdr_cache_item *item, *tmp;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi);
+
+	SSDFS_DBG("fsi %p\n", fsi);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	cache = fsi->log_hdr_cache;
+	if (!cache)
+		return;
+
+	list_for_each_entry_safe(item, tmp, &cache->lru, lru) {
+		hlist_del(&item->hnode);
+		list_del(&item->lru);
+		ssdfs_lhdr_cache_kfree(item);
+	}
+
+	ssdfs_lhdr_cache_kfree(cache);
+	fsi->log_hdr_cache = NULL;
+}
+
+/*
+ * ssdfs_log_hdr_cache_find() - get copy of cached header/footer
+ * @fsi: pointer on shared file system object
+ * @peb_id: PEB identification number
+ * @page_off: page offset of header/footer inside of PEB
+ * @buf: buffer for the copy [out]
+ * @buf_size: size of the buffer in bytes
+ *
+ * This method tries to copy the checked log header or footer
+ * from the cache into the buffer.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOENT     - the cache hasn't the requested item.
+ */
+int ssdfs_log_hdr_cache_find(struct ssdfs_fs_info *fsi,
+			     u64 peb_id, u32 page_off,
+			     void *buf, size_t buf_size)
+{
+	struct ssdfs_log_hdr_cache *cache;
+	struct ssdfs_log_hdr_cache_item *item;
+	size_t copy_size = min_t(size_t, buf_size,
+					SSDFS_LOG_HDR_CACHE_ITEM_SIZE);
+	int err = -ENOENT;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !buf);
+
+	SSDFS_DBG("peb %llu, page_off %u, buf_size %zu\n",
+		  peb_id, page_off, buf_size);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	cache = fsi->log_hdr_cache;
+	if (!cache)
+		return -ENOENT;
+
+	spin_lock(&cache->lock);
+	item = __ssdfs_log_hdr_cache_lookup(cache, peb_id, page_off);
+	if (item) {
+		list_move(&item->lru, &cache->lru);
+		ssdfs_memcpy(buf, 0, buf_size,
+			     item->buf, 0, SSDFS_LOG_HDR_CACHE_ITEM_SIZE,
+			     copy_size);
+		err = 0;
+	}
+	spin_unlock(&cache->lock);
+
+	return err;
+}
+
+/*
+ * ssdfs_log_hdr_cache_get_desc_array() - get log header's descriptors
+ * @fsi: pointer on shared file system object
+ * @peb_id: PEB identification number
+ * @page_off: page offset of log header inside of PEB
+ * @array: array of area's descriptors [out]
+ * @array_size: count of items into array
+ *
+ * This method tries to copy the array of area's descriptors
+ * from the cached segment header or partial log header.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOENT     - the cache hasn't the requested log header.
+ */
+int ssdfs_log_hdr_cache_get_desc_array(struct ssdfs_fs_info *fsi,
+					u64 peb_id, u32 page_off,
+					struct ssdfs_metadata_descriptor *array,
+					size_t array_size)
+{
+	struct ssdfs_log_hdr_cache *cache;
+	struct ssdfs_log_hdr_cache_item *item;
+	struct ssdfs_signature *magic;
+	size_t desc_size = sizeof(struct ssdfs_metadata_descriptor);
+	size_t array_bytes = array_size * desc_size;
+	int err = -ENOENT;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !array);
+	BUG_ON(array_size != SSDFS_SEG_HDR_DESC_MAX);
+
+	SSDFS_DBG("peb %llu, page_off %u\n",
+		  peb_id, page_off);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	cache = fsi->log_hdr_cache;
+	if (!cache)
+		return -ENOENT;
+
+	spin_lock(&cache->lock);
+	item = __ssdfs_log_hdr_cache_lookup(cache, peb_id, page_off);
+	if (!item)
+		goto finish_search;
+
+	magic = (struct ssdfs_signature *)item->buf;
+
+	if (__is_ssdfs_segment_header_magic_valid(magic)) {
+		struct ssdfs_segment_header *seg_hdr;
+
+		seg_hdr = SSDFS_SEG_HDR(item->buf);
+		ssdfs_memcpy(array, 0, array_bytes,
+			     seg_hdr->desc_array, 0, array_bytes,
+			     array_bytes);
+		err = 0;
+	} else if (is_ssdfs_partial_log_header_magic_valid(magic)) {
+		struct ssdfs_partial_log_header *pl_hdr;
+
+		pl_hdr = SSDFS_PLH(item->buf);
+		ssdfs_memcpy(array, 0, array_bytes,
+			     pl_hdr->desc_array, 0, array_bytes,
+			     array_bytes);
+		err = 0;
+	}
+
+	if (!err)
+		list_move(&item->lru, &cache->lru);
+
+finish_search:
+	spin_unlock(&cache->lock);
+
+	return err;
+}
+
+/*
+ * ssdfs_log_hdr_cache_add() - add checked header/footer into the cache
+ * @fsi: pointer on shared file system object
+ * @peb_id: PEB identification number
+ * @page_off: page offset of header/footer inside of PEB
+ * @buf: checked log header or footer
+ * @buf_size: size of the buffer in bytes
+ *
+ * This method tries to store the copy of checked log header
+ * or footer in the cache. The least recently used item is
+ * evicted if the cache is full. The caller is responsible
+ * for checking the header (footer) before adding.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ */
+int ssdfs_log_hdr_cache_add(struct ssdfs_fs_info *fsi,
+			    u64 peb_id, u32 page_off,
+			    void *buf, size_t buf_size)
+{
+	struct ssdfs_log_hdr_cache *cache;
+	struct ssdfs_log_hdr_cache_item *item, *found, *victim = NULL;
+	size_t copy_size = min_t(size_t, buf_size,
+					SSDFS_LOG_HDR_CACHE_ITEM_SIZE);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !buf);
+
+	SSDFS_DBG("peb %llu, page_off %u, buf_size %zu\n",
+		  peb_id, page_off, buf_size);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	cache = fsi->log_hdr_cache;
+	if (!cache)
+		return 0;
+
+	item = ssdfs_lhdr_cache_kzalloc(sizeof(struct ssdfs_log_hdr_cache_item),
+					GFP_NOFS);
+	if (!item) {
+		SSDFS_ERR("fail to allocate cache item\n");
+		return -ENOMEM;
+	}
+
+	INIT_HLIST_NODE(&item->hnode);
+	INIT_LIST_HEAD(&item->lru);
+	item->peb_id = peb_id;
+	item->page_off = page_off;
+	ssdfs_memcpy(item->buf, 0, SSDFS_LOG_HDR_CACHE_ITEM_SIZE,
+		     buf, 0, buf_size,
+		     copy_size);
+
+	spin_lock(&cache->lock);
+	found = __ssdfs_log_hdr_cache_lookup(cache, peb_id, page_off);
+	if (found) {
+		list_move(&found->lru, &cache->lru);
+	} else {
+		if (cache->count >= cache->capacity) {
+			victim = list_last_entry(&cache->lru,
+						 struct ssdfs_log_hdr_cache_item,
+						 lru);
+			hlist_del(&victim->hnode);
+			list_del(&victim->lru);
+			cache->count--;
+		}
+
+		hlist_add_head(&item->hnode,
+				ssdfs_log_hdr_cache_bucket(cache, peb_id));
+		list_add(&item->lru, &cache->lru);
+		cache->count++;
+	}
+	spin_unlock(&cache->lock);
+
+	if (found)
+		ssdfs_lhdr_cache_kfree(item);
+
+	if (victim)
+		ssdfs_lhdr_cache_kfree(victim);
+
+	return 0;
+}
+
+/*
+ * ssdfs_log_hdr_cache_invalidate_peb() - forget all items of PEB
+ * @fsi: pointer on shared file system object
+ * @peb_id: PEB identification number
+ *
+ * This method removes all cached headers and footers of the PEB.
+ * It has to be called before erasing the PEB.
+ */
+void ssdfs_log_hdr_cache_invalidate_peb(struct ssdfs_fs_info *fsi,
+					u64 peb_id)
+{
+	struct ssdfs_log_hdr_cache *cache;
+	struct ssdfs_log_hdr_cache_item *item;
+	struct hlist_node *tmp;
+	struct hlist_head *head;
+	HLIST_HEAD(dispose);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi);
+
+	SSDFS_DBG("peb %llu\n", peb_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	cache = fsi->log_hdr_cache;
+	if (!cache)
+		return;
+
+	spin_lock(&cache->lock);
+	head = ssdfs_log_hdr_cache_bucket(cache, peb_id);
+	hlist_for_each_entry_safe(item, tmp, head, hnode) {
+		if (item->peb_id != peb_id)
+			continue;
+
+		hlist_del(&item->hnode);
+		list_del(&item->lru);
+		cache->count--;
+		hlist_add_head(&item->hnode, &dispose);
+	}
+	spin_unlock(&cache->lock);
+
+	hlist_for_each_entry_safe(item, tmp, &dispose, hnode) {
+		hlist_del(&item->hnode);
+		ssdfs_lhdr_cache_kfree(item);
+	}
+}
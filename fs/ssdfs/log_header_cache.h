@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * SSDFS -- SSD-oriented File System.
+ *
+ * fs/ssdfs/log_header_cache.h - log header/footer cache declarations.
+ *
+ * Copyright (c) 2023 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ * All rights reserved.
+ *
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _SSDFS_LOG_HEADER_CACHE_H
+#define _SSDFS_LOG_HEADER_CACHE_H
+
+#include <linux/ssdfs_fs.h>
+
+#define SSDFS_LOG_HDR_CACHE_HASH_BITS		(6)
+#define SSDFS_LOG_HDR_CACHE_BUCKETS		(1 << SSDFS_LOG_HDR_CACHE_HASH_BITS)
+#define SSDFS_LOG_HDR_CACHE_CAPACITY		(256)
+#define SSDFS_LOG_HDR_CACHE_ITEM_SIZE		\
+	sizeof(struct ssdfs_segment_header)
+
+/*
+ * struct ssdfs_log_hdr_cache_item - cached log header or footer
+ * @hnode: hash table's node
+ * @lru: node of LRU list
+ * @peb_id: PEB identification number
+ * @page_off: page offset of header/footer inside of PEB
+ * @buf: copy of checked log header or footer
+ */
+struct ssdfs_log_hdr_cache_item {
+	struct hlist_node hnode;
+	struct list_head lru;
+	u64 peb_id;
+	u32 page_off;
+	u8 buf[SSDFS_LOG_HDR_CACHE_ITEM_SIZE];
+};
+
+/*
+ * struct ssdfs_log_hdr_cache - cache of checked log headers/footers
+ * @lock: cache's lock
+ * @buckets: hash table of items (hashed by PEB ID)
+ * @lru: LRU list of items (the most recently used item is the first)
+ * @count: number of items in the cache
+ * @capacity: maximum number of items in the cache
+ *
+ * Segment header, partial log header and log footer are immutable
+ * until the PEB is erased. The cache keeps copies of the headers and
+ * footers that have been checked (including the checksum) already.
+ * As a result, every header is read and checked only once,
+ * not on every code path that needs it. The items of a PEB have
+ * to be invalidated before the PEB is erased.
+ */
+struct ssdfs_log_hdr_cache {
+	spinlock_t lock;
+	struct hlist_head buckets[SSDFS_LOG_HDR_CACHE_BUCKETS];
+	struct list_head lru;
+	u32 count;
+	u32 capacity;
+};
+
+/*
+ * Log header cache's API
+ */
+int ssdfs_log_hdr_cache_create(struct ssdfs_fs_info *fsi);
+void ssdfs_log_hdr_cache_destroy(struct ssdfs_fs_info *fsi);
+int ssdfs_log_hdr_cache_find(struct ssdfs_fs_info *fsi,
+			     u64 peb_id, u32 page_off,
+			     void *buf, size_t buf_size);
+int ssdfs_log_hdr_cache_get_desc_array(struct ssdfs_fs_info *fsi,
+					u64 peb_id, u32 page_off,
+					struct ssdfs_metadata_descriptor *array,
+					size_t array_size);
+int ssdfs_log_hdr_cache_add(struct ssdfs_fs_info *fsi,
+			    u64 peb_id, u32 page_off,
+			    void *buf, size_t buf_size);
+void ssdfs_log_hdr_cache_invalidate_peb(struct ssdfs_fs_info *fsi,
+					u64 peb_id);
+
+#endif /* _SSDFS_LOG_HEADER_CACHE_H */
@@ -517,6 +517,11 @@ ssdfs_blk2off_table_create(struct ssdfs_fs_info *fsi,
 	init_rwsem(&ptr->translation_lock);
 	init_waitqueue_head(&ptr->wait_queue);
 
+	atomic64_set(&ptr->translation_gen, 0);
+	seqlock_init(&ptr->pos_cache.lock);
+	for (i = 0; i < SSDFS_BLK2OFF_POS_CACHE_SIZE; i++)
+		ptr->pos_cache.items[i].logical_blk = U16_MAX;
+
 	ptr->init_cno = U64_MAX;
 	ptr->used_logical_blks = 0;
 	ptr->free_logical_blks = items_count;
@@ -1680,6 +1685,9 @@ int ssdfs_process_used_translation_extent(struct ssdfs_blk2off_init *portion,
 	struct ssdfs_dynamic_array *lblk2off;
 	struct ssdfs_blk_desc_table_init_env *bdt_init;
 	struct ssdfs_blk_state_offset *state_off;
+	struct ssdfs_offset_position *run = NULL;
+	u32 run_start = U32_MAX;
+	u32 run_len = 0;
 	void *ptr;
 	u16 peb_index;
 	u16 sequence_id;
@@ -1818,6 +1826,32 @@ int ssdfs_process_used_translation_extent(struct ssdfs_blk2off_init *portion,
 
 	bitmap_clear(portion->bmap, 0, portion->capacity);
 
+	/*
+	 * Allocate the memory pages for the whole extent.
+	 * Then every memory page of positions array is mapped
+	 * only once for the run of logical blocks.
+	 */
+	if (len > 0) {
+		u32 last_blk = logical_blk + len - 1;
+
+		ptr = ssdfs_dynamic_array_get_locked(lblk2off, last_blk);
+		if (IS_ERR_OR_NULL(ptr)) {
+			err = (ptr == NULL ? -ENOENT : PTR_ERR(ptr));
+			SSDFS_ERR("fail to get logical block: "
+				  "logical_blk %u, err %d\n",
+				  last_blk, err);
+			return err;
+		}
+
+		err = ssdfs_dynamic_array_release(lblk2off, last_blk, ptr);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to release: "
+				  "logical_blk %u, err %d\n",
+				  last_blk, err);
+			return err;
+		}
+	}
+
 	down_read(&frag->lock);
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -1879,16 +1913,38 @@ int ssdfs_process_used_translation_extent(struct ssdfs_blk2off_init *portion,
 			goto finish_process_fragment;
 		}
 
-		pos = SSDFS_OFF_POS(ssdfs_dynamic_array_get_locked(lblk2off,
-								   cur_blk));
-		if (IS_ERR_OR_NULL(pos)) {
-			err = (pos == NULL ? -ENOENT : PTR_ERR(pos));
-			SSDFS_ERR("fail to get logical block: "
-				  "cur_blk %u, err %d\n",
-				  cur_blk, err);
-			goto finish_process_fragment;
+		if (!run || cur_blk < run_start ||
+		    cur_blk >= (run_start + run_len)) {
+			if (run) {
+				err = ssdfs_dynamic_array_release(lblk2off,
+								  run_start,
+								  run);
+				run = NULL;
+				if (unlikely(err)) {
+					SSDFS_ERR("fail to release: "
+						  "run_start %u, err %d\n",
+						  run_start, err);
+					goto finish_process_fragment;
+				}
+			}
+
+			ptr = ssdfs_dynamic_array_get_content_locked(lblk2off,
+								cur_blk,
+								&run_len);
+			if (IS_ERR_OR_NULL(ptr) || run_len == 0) {
+				err = IS_ERR(ptr) ? PTR_ERR(ptr) : -ENOENT;
+				SSDFS_ERR("fail to get logical block: "
+					  "cur_blk %u, err %d\n",
+					  cur_blk, err);
+				goto finish_process_fragment;
+			}
+
+			run = SSDFS_OFF_POS(ptr);
+			run_start = cur_blk;
 		}
 
+		pos = &run[cur_blk - run_start];
+
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("portion->cno %#llx, "
 			  "pos (cno %#llx, id %u, peb_index %u, "
@@ -1904,15 +1960,7 @@ int ssdfs_process_used_translation_extent(struct ssdfs_blk2off_init *portion,
 			SSDFS_DBG("logical block %u has been initialized already\n",
 				  cur_blk);
 #endif /* CONFIG_SSDFS_DEBUG */
-			err = ssdfs_dynamic_array_release(lblk2off,
-							  cur_blk, pos);
-			if (unlikely(err)) {
-				SSDFS_ERR("fail to release: "
-					  "cur_blk %u, err %d\n",
-					  cur_blk, err);
-				goto finish_process_fragment;
-			} else
-				continue;
+			continue;
 		}
 
 		peb_index = portion->peb_index;
@@ -1945,8 +1993,6 @@ int ssdfs_process_used_translation_extent(struct ssdfs_blk2off_init *portion,
 			SSDFS_ERR("fail to read block descriptor: "
 				  "cur_blk %u, err %d\n",
 				  cur_blk, err);
-			ssdfs_dynamic_array_release(lblk2off,
-						    cur_blk, pos);
 			goto finish_process_fragment;
 		} else
 			pos->blk_desc.status = SSDFS_BLK_DESC_BUF_INITIALIZED;
@@ -1991,8 +2037,6 @@ int ssdfs_process_used_translation_extent(struct ssdfs_blk2off_init *portion,
 					  state_off->peb_migration_id);
 			}
 
-			ssdfs_dynamic_array_release(lblk2off, cur_blk, pos);
-
 #ifdef CONFIG_SSDFS_DEBUG
 			BUG();
 #endif /* CONFIG_SSDFS_DEBUG */
@@ -2026,14 +2070,6 @@ int ssdfs_process_used_translation_extent(struct ssdfs_blk2off_init *portion,
 			  cur_blk);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-		err = ssdfs_dynamic_array_release(lblk2off, cur_blk, pos);
-		if (unlikely(err)) {
-			SSDFS_ERR("fail to release: "
-				  "cur_blk %u, err %d\n",
-				  cur_blk, err);
-			goto finish_process_fragment;
-		}
-
 		err = ssdfs_blk2off_table_bmap_set(&portion->table->lbmap,
 						   SSDFS_LBMAP_INIT_INDEX,
 						   cur_blk);
@@ -2046,6 +2082,17 @@ int ssdfs_process_used_translation_extent(struct ssdfs_blk2off_init *portion,
 	}
 
 finish_process_fragment:
+	if (run) {
+		int res = ssdfs_dynamic_array_release(lblk2off,
+						      run_start, run);
+		if (unlikely(res)) {
+			SSDFS_ERR("fail to release: "
+				  "run_start %u, err %d\n",
+				  run_start, res);
+			err = err ? err : res;
+		}
+	}
+
 	up_read(&frag->lock);
 
 	if (unlikely(err))
@@ -2705,7 +2752,7 @@ int ssdfs_blk2off_table_partial_init(struct ssdfs_blk2off_table *table,
 	portion.peb_index = peb_index;
 	portion.cno = cno;
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 	portion.capacity = table->lblk2off_capacity;
 
@@ -2906,7 +2953,7 @@ int ssdfs_blk2off_table_partial_clean_init(struct ssdfs_blk2off_table *table,
 		return 0;
 	}
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 	state = atomic_cmpxchg(&table->peb[peb_index].state,
 				SSDFS_BLK2OFF_TABLE_CREATED,
@@ -3085,7 +3132,7 @@ int ssdfs_blk2off_table_resize(struct ssdfs_blk2off_table *table,
 		  table, table->lblk2off_capacity, new_items_count);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 	if (new_items_count == table->lblk2off_capacity) {
 		SSDFS_WARN("new_items_count %u == lblk2off_capacity %u\n",
@@ -3323,7 +3370,7 @@ int ssdfs_blk2off_table_snapshot(struct ssdfs_blk2off_table *table,
 	snapshot->bmap_copy = NULL;
 	snapshot->tbl_copy = NULL;
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 	if (!ssdfs_blk2off_table_dirtied(table, peb_index)) {
 		err = -ENODATA;
@@ -4305,7 +4352,7 @@ ssdfs_blk2off_table_prepare_for_commit(struct ssdfs_blk2off_table *table,
 
 	fsi = table->fsi;
 
-	down_read(&table->translation_lock);
+	SSDFS_DOWN_READ(blk2off, &table->translation_lock);
 
 	pot_table = &table->peb[peb_index];
 
@@ -4441,7 +4488,7 @@ ssdfs_blk2off_table_forget_snapshot(struct ssdfs_blk2off_table *table,
 		  extent_array, extent_count);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 	pot_table = &table->peb[sp->peb_index];
 	last_sequence_id = ssdfs_sequence_array_last_id(pot_table->sequence);
@@ -5073,16 +5120,16 @@ int ssdfs_peb_store_blk2off_table_header(struct ssdfs_peb_info *pebi, u16 flags)
 
 	switch (fsi->metadata_options.blk2off_tbl.compression) {
 	case SSDFS_BLK2OFF_TBL_NOCOMPR_TYPE:
-		blk2off_tbl->hdr.check.flags = cpu_to_le16(SSDFS_CRC32);
+		blk2off_tbl->hdr.check.flags = cpu_to_le16(ssdfs_csum_type(fsi));
 		blk2off_tbl->hdr.chain_hdr.type = SSDFS_BLK2OFF_CHAIN_HDR;
 		break;
 	case SSDFS_BLK2OFF_TBL_ZLIB_COMPR_TYPE:
-		blk2off_tbl->hdr.check.flags = cpu_to_le16(SSDFS_CRC32 |
+		blk2off_tbl->hdr.check.flags = cpu_to_le16(ssdfs_csum_type(fsi) |
 						SSDFS_BLK2OFF_TBL_ZLIB_COMPR);
 		blk2off_tbl->hdr.chain_hdr.type = SSDFS_BLK2OFF_ZLIB_CHAIN_HDR;
 		break;
 	case SSDFS_BLK2OFF_TBL_LZO_COMPR_TYPE:
-		blk2off_tbl->hdr.check.flags = cpu_to_le16(SSDFS_CRC32 |
+		blk2off_tbl->hdr.check.flags = cpu_to_le16(ssdfs_csum_type(fsi) |
 						SSDFS_BLK2OFF_TBL_LZO_COMPR);
 		blk2off_tbl->hdr.chain_hdr.type = SSDFS_BLK2OFF_LZO_CHAIN_HDR;
 		break;
@@ -5459,7 +5506,7 @@ int ssdfs_peb_store_offsets_table_fragment(struct ssdfs_peb_info *pebi,
 
 	blk2off_tbl = &pebi->current_log.blk2off_tbl;
 
-	down_read(&table->translation_lock);
+	SSDFS_DOWN_READ(blk2off, &table->translation_lock);
 
 	pot_table = &table->peb[peb_index];
 
@@ -5708,6 +5755,7 @@ int ssdfs_peb_store_offsets_table(struct ssdfs_peb_info *pebi,
 	size_t ext_desc_size = sizeof(struct ssdfs_translation_extent);
 	size_t tbl_hdr_size = sizeof(struct ssdfs_blk2off_table_header);
 	u16 extent_count = 0;
+	u32 extents_capacity;
 	u16 peb_index;
 	u32 table_start_offset;
 	u16 sequence_id;
@@ -5775,19 +5823,36 @@ int ssdfs_peb_store_offsets_table(struct ssdfs_peb_info *pebi,
 		goto finish_store_off_table;
 	}
 
+	/*
+	 * Every extent covers at least one modified logical block.
+	 * The number of modified blocks is the upper bound of extents'
+	 * count. Usually, only a small portion of the table is changed
+	 * between logs. So, it doesn't make sense to allocate (and zero)
+	 * the array for the whole table's capacity on every commit.
+	 */
+	extents_capacity = bitmap_weight(snapshot.bmap_copy,
+					 snapshot.capacity);
+	extents_capacity = max_t(u32, extents_capacity, 1);
+	extents_capacity = min_t(u32, extents_capacity, snapshot.capacity);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("capacity %u, extents_capacity %u\n",
+		  snapshot.capacity, extents_capacity);
+#endif /* CONFIG_SSDFS_DEBUG */
+
 	err = ssdfs_dynamic_array_create(&extents,
-					 snapshot.capacity,
+					 extents_capacity,
 					 ext_desc_size,
 					 0);
 	if (unlikely(err)) {
 		SSDFS_ERR("fail to create extents array: "
 			  "capacity %u, desc_size %zu, err %d\n",
-			  snapshot.capacity, ext_desc_size, err);
+			  extents_capacity, ext_desc_size, err);
 		goto finish_store_off_table;
 	}
 
 	err = ssdfs_blk2off_table_extract_extents(&snapshot, &extents,
-						  snapshot.capacity,
+						  extents_capacity,
 						  &extent_count);
 	if (unlikely(err)) {
 		SSDFS_ERR("fail to extract the extent array: "
@@ -5975,7 +6040,7 @@ int ssdfs_blk2off_table_get_used_logical_blks(struct ssdfs_blk2off_table *tbl,
 		return -EAGAIN;
 	}
 
-	down_read(&tbl->translation_lock);
+	SSDFS_DOWN_READ(blk2off, &tbl->translation_lock);
 	*used_blks = tbl->used_logical_blks;
 	up_read(&tbl->translation_lock);
 
@@ -6019,7 +6084,7 @@ int ssdfs_blk2off_table_blk_desc_init(struct ssdfs_blk2off_table *table,
 		return -ERANGE;
 	}
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 	if (ssdfs_blk2off_table_bmap_vacant(&table->lbmap,
 					    SSDFS_LBMAP_STATE_INDEX,
@@ -6284,7 +6349,7 @@ bool has_logical_block_id_assigned(struct ssdfs_blk2off_table *table,
 	u16 capacity;
 	bool has_assigned = false;
 
-	down_read(&table->translation_lock);
+	SSDFS_DOWN_READ(blk2off, &table->translation_lock);
 	capacity = table->lblk2off_capacity;
 	has_assigned = !ssdfs_blk2off_table_bmap_vacant(&table->lbmap,
 						SSDFS_LBMAP_MODIFICATION_INDEX,
@@ -6295,6 +6360,45 @@ bool has_logical_block_id_assigned(struct ssdfs_blk2off_table *table,
 	return has_assigned;
 }
 
+/*
+ * ssdfs_blk2off_table_start_deferred_init() - start deferred initialization
+ * @table: pointer on table object
+ *
+ * The initialization of "used" PEBs' fragments could be deferred
+ * until the first lookup of the block that is not initialized yet.
+ * It is unknown before the initialization what PEB contains
+ * the block. So, this method starts the deferred initialization
+ * of all PEBs of the segment. The caller waits the end of full
+ * initialization as usual.
+ */
+static
+void ssdfs_blk2off_table_start_deferred_init(struct ssdfs_blk2off_table *table)
+{
+	struct ssdfs_segment_info *si;
+	int i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!table);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	si = table->parent_si;
+	if (!si || !si->peb_array)
+		return;
+
+	if (!ssdfs_test_opt(table->fsi->mount_opts, LAZY_BLK2OFF_INIT))
+		return;
+
+	for (i = 0; i < si->pebs_count; i++) {
+		err = ssdfs_peb_container_start_blk2off_init(&si->peb_array[i]);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to start offset table init: "
+				  "seg %llu, peb_index %d, err %d\n",
+				  si->seg_id, i, err);
+		}
+	}
+}
+
 /*
  * ssdfs_blk2off_table_convert() - convert logical block into offset
  * @table: pointer on table object
@@ -6339,7 +6443,7 @@ ssdfs_blk2off_table_convert(struct ssdfs_blk2off_table *table,
 
 	*peb_index = U16_MAX;
 
-	down_read(&table->translation_lock);
+	SSDFS_DOWN_READ(blk2off, &table->translation_lock);
 
 	if (logical_blk >= table->lblk2off_capacity) {
 		err = -EINVAL;
@@ -6393,7 +6497,7 @@ ssdfs_blk2off_table_convert(struct ssdfs_blk2off_table *table,
 				has_logical_block_id_assigned(table,
 							logical_blk),
 				SSDFS_DEFAULT_TIMEOUT);
-		down_read(&table->translation_lock);
+		SSDFS_DOWN_READ(blk2off, &table->translation_lock);
 
 		err = ssdfs_blk2off_table_get_checked_position(table,
 								logical_blk,
@@ -6446,6 +6550,9 @@ finish_fragment_lookup:
 finish_translation:
 	up_read(&table->translation_lock);
 
+	if (err == -EAGAIN)
+		ssdfs_blk2off_table_start_deferred_init(table);
+
 	if (err)
 		return ERR_PTR(err);
 
@@ -6467,6 +6574,81 @@ finish_translation:
 	return ptr;
 }
 
+/*
+ * ssdfs_blk2off_table_find_cached_position() - find cached offset position
+ * @table: pointer on table object
+ * @logical_blk: logical block number
+ * @pos: offset position [out]
+ *
+ * This method tries to find the offset position of logical block
+ * in the cache without taking the translation lock.
+ *
+ * RETURN:
+ * [true]  - @pos contains the actual offset position.
+ * [false] - the position is not cached or obsolete.
+ */
+static
+bool ssdfs_blk2off_table_find_cached_position(struct ssdfs_blk2off_table *table,
+					      u16 logical_blk,
+					      struct ssdfs_offset_position *pos)
+{
+	struct ssdfs_blk2off_pos_cache *cache = &table->pos_cache;
+	struct ssdfs_blk2off_pos_cache_item *item;
+	size_t off_pos_size = sizeof(struct ssdfs_offset_position);
+	unsigned int seq;
+	bool found;
+
+	item = &cache->items[logical_blk % SSDFS_BLK2OFF_POS_CACHE_SIZE];
+
+	do {
+		seq = read_seqbegin(&cache->lock);
+
+		found = item->logical_blk == logical_blk &&
+			item->gen == atomic64_read(&table->translation_gen);
+		if (found) {
+			ssdfs_memcpy(pos, 0, off_pos_size,
+				     &item->pos, 0, off_pos_size,
+				     off_pos_size);
+		}
+	} while (read_seqretry(&cache->lock, seq));
+
+	return found;
+}
+
+/*
+ * ssdfs_blk2off_table_cache_position() - cache offset position
+ * @table: pointer on table object
+ * @logical_blk: logical block number
+ * @pos: offset position
+ *
+ * This method stores the checked offset position of logical block
+ * into the cache. The caller has to hold the translation lock
+ * that guarantees the stable generation of the table.
+ */
+static
+void ssdfs_blk2off_table_cache_position(struct ssdfs_blk2off_table *table,
+					u16 logical_blk,
+					struct ssdfs_offset_position *pos)
+{
+	struct ssdfs_blk2off_pos_cache *cache = &table->pos_cache;
+	struct ssdfs_blk2off_pos_cache_item *item;
+	size_t off_pos_size = sizeof(struct ssdfs_offset_position);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!rwsem_is_locked(&table->translation_lock));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	item = &cache->items[logical_blk % SSDFS_BLK2OFF_POS_CACHE_SIZE];
+
+	write_seqlock(&cache->lock);
+	item->logical_blk = logical_blk;
+	item->gen = atomic64_read(&table->translation_gen);
+	ssdfs_memcpy(&item->pos, 0, off_pos_size,
+		     pos, 0, off_pos_size,
+		     off_pos_size);
+	write_sequnlock(&cache->lock);
+}
+
 /*
  * ssdfs_blk2off_table_get_offset_position() - get offset position
  * @table: pointer on table object
@@ -6488,6 +6670,7 @@ int ssdfs_blk2off_table_get_offset_position(struct ssdfs_blk2off_table *table,
 					    u16 logical_blk,
 					    struct ssdfs_offset_position *pos)
 {
+	ktime_t start;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -6497,7 +6680,15 @@ int ssdfs_blk2off_table_get_offset_position(struct ssdfs_blk2off_table *table,
 		  table, logical_blk);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&table->translation_lock);
+	start = ktime_get();
+
+	if (ssdfs_blk2off_table_find_cached_position(table, logical_blk, pos)) {
+		ssdfs_account_lookup(table->fsi, SSDFS_LOOKUP_BLK2OFF_CACHE,
+				     start, 0);
+		goto position_extracted;
+	}
+
+	SSDFS_DOWN_READ(blk2off, &table->translation_lock);
 
 	if (logical_blk >= table->lblk2off_capacity) {
 		err = -EINVAL;
@@ -6539,12 +6730,21 @@ int ssdfs_blk2off_table_get_offset_position(struct ssdfs_blk2off_table *table,
 		goto finish_extract_position;
 	}
 
+	ssdfs_blk2off_table_cache_position(table, logical_blk, pos);
+
 finish_extract_position:
 	up_read(&table->translation_lock);
 
+	if (err == -EAGAIN)
+		ssdfs_blk2off_table_start_deferred_init(table);
+
+	ssdfs_account_lookup(table->fsi, SSDFS_LOOKUP_BLK2OFF_TABLE,
+			     start, err);
+
 	if (err)
 		return err;
 
+position_extracted:
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("logical_blk %u, "
 		  "pos->cno %llu, pos->id %u, pos->peb_index %u, "
@@ -7240,7 +7440,7 @@ int ssdfs_blk2off_table_change_offset(struct ssdfs_blk2off_table *table,
 		return -EINVAL;
 	}
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 	if (logical_blk >= table->lblk2off_capacity) {
 		err = -EINVAL;
@@ -7390,6 +7590,9 @@ finish_fragment_modification:
 finish_table_modification:
 	up_write(&table->translation_lock);
 
+	if (err == -EAGAIN)
+		ssdfs_blk2off_table_start_deferred_init(table);
+
 	wake_up_all(&table->wait_queue);
 
 	return err;
@@ -7573,7 +7776,7 @@ int ssdfs_blk2off_table_allocate_extent(struct ssdfs_blk2off_table *table,
 		return -EAGAIN;
 	}
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 	if (table->free_logical_blks == 0) {
 		if (table->used_logical_blks != table->lblk2off_capacity) {
@@ -7713,6 +7916,9 @@ save_found_extent:
 finish_allocation:
 	up_write(&table->translation_lock);
 
+	if (err == -EAGAIN)
+		ssdfs_blk2off_table_start_deferred_init(table);
+
 	if (!err) {
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("extent (start %u, len %u) has been allocated\n",
@@ -7853,7 +8059,7 @@ int ssdfs_blk2off_table_free_extent(struct ssdfs_blk2off_table *table,
 
 	memset(&blk_desc, 0xFF, sizeof(struct ssdfs_block_descriptor));
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("used_logical_blks %u, free_logical_blks %u, "
@@ -8084,6 +8290,9 @@ finish_fragment_modification:
 finish_freeing:
 	up_write(&table->translation_lock);
 
+	if (err == -EAGAIN)
+		ssdfs_blk2off_table_start_deferred_init(table);
+
 	if (!err) {
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("extent (start %u, len %u) has been freed\n",
@@ -8218,7 +8427,7 @@ int ssdfs_blk2off_table_set_block_migration(struct ssdfs_blk2off_table *table,
 		return -EINVAL;
 	}
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 	if (logical_blk > table->last_allocated_blk) {
 		err = -EINVAL;
@@ -8428,7 +8637,7 @@ int ssdfs_blk2off_table_get_block_state(struct ssdfs_blk2off_table *table,
 
 	logical_blk = req->place.start.blk_index + req->result.processed_blks;
 
-	down_read(&table->translation_lock);
+	SSDFS_DOWN_READ(blk2off, &table->translation_lock);
 
 	if (logical_blk > table->last_allocated_blk) {
 		err = -EINVAL;
@@ -8709,7 +8918,7 @@ int ssdfs_blk2off_table_set_block_commit(struct ssdfs_blk2off_table *table,
 		return -EINVAL;
 	}
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 	if (logical_blk > table->last_allocated_blk) {
 		err = -EINVAL;
@@ -8804,7 +9013,7 @@ int ssdfs_blk2off_table_revert_migration_state(struct ssdfs_blk2off_table *tbl,
 		return -EINVAL;
 	}
 
-	down_write(&tbl->translation_lock);
+	ssdfs_blk2off_table_down_write(tbl);
 
 	for (i = 0; i <= tbl->last_allocated_blk; i++) {
 		blk = ssdfs_get_migrating_block(tbl, i, false);
@@ -8855,6 +9064,101 @@ finish_revert_migration_state:
 	return err;
 }
 
+/*
+ * ssdfs_blk2off_table_forget_block_migration() - forget block's migration
+ * @tbl: pointer on table object
+ * @logical_blk: logical block number
+ * @peb_index: PEB index in the segment
+ *
+ * This method drops the migration state of logical block. It is used
+ * when the migrating block has been moved into another segment instead
+ * of the destination PEB and the logical block is freed.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ERANGE     - internal logic error.
+ */
+int ssdfs_blk2off_table_forget_block_migration(struct ssdfs_blk2off_table *tbl,
+						u16 logical_blk,
+						u16 peb_index)
+{
+	struct ssdfs_migrating_block *blk = NULL;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tbl);
+
+	SSDFS_DBG("table %p, logical_blk %u, peb_index %u\n",
+		  tbl, logical_blk, peb_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (peb_index >= tbl->pebs_count) {
+		SSDFS_ERR("fail to forget block migration: "
+			  "peb_index %u >= pebs_count %u\n",
+			  peb_index, tbl->pebs_count);
+		return -EINVAL;
+	}
+
+	ssdfs_blk2off_table_down_write(tbl);
+
+	if (logical_blk > tbl->last_allocated_blk) {
+		err = -EINVAL;
+		SSDFS_ERR("fail to forget block migration: "
+			  "block %u > last_allocated_block %u\n",
+			  logical_blk,
+			  tbl->last_allocated_blk);
+		goto finish_forget_block_migration;
+	}
+
+	blk = ssdfs_get_migrating_block(tbl, logical_blk, false);
+	if (IS_ERR_OR_NULL(blk)) {
+		/* block is not under migration */
+		goto finish_forget_block_migration;
+	}
+
+	switch (blk->state) {
+	case SSDFS_LBLOCK_UNDER_MIGRATION:
+		/* expected state */
+		break;
+
+	default:
+		err = -ERANGE;
+		SSDFS_ERR("unexpected state %#x\n",
+			  blk->state);
+		goto finish_forget_block_migration;
+	}
+
+	if (blk->peb_index != peb_index) {
+		err = -ERANGE;
+		SSDFS_ERR("blk->peb_index %u != peb_index %u\n",
+			  blk->peb_index, peb_index);
+		goto finish_forget_block_migration;
+	}
+
+	blk->state = SSDFS_LBLOCK_UNKNOWN_STATE;
+	ssdfs_blk2off_pagevec_release(&blk->pvec);
+
+	ssdfs_blk2off_kfree(blk);
+	blk = NULL;
+
+	err = ssdfs_dynamic_array_set(&tbl->migrating_blks,
+					logical_blk, &blk);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to zero pointer: "
+			  "logical_blk %u, err %d\n",
+			  logical_blk, err);
+		goto finish_forget_block_migration;
+	}
+
+finish_forget_block_migration:
+	up_write(&tbl->translation_lock);
+
+	return err;
+}
+
 static inline
 int ssdfs_show_fragment_details(void *ptr)
 {
@@ -178,6 +178,37 @@ struct ssdfs_bitmap_array {
 	unsigned long *array[SSDFS_LBMAP_ARRAY_MAX];
 };
 
+#define SSDFS_BLK2OFF_POS_CACHE_SIZE	(32)
+
+/*
+ * struct ssdfs_blk2off_pos_cache_item - cached offset position
+ * @logical_blk: logical block number
+ * @gen: generation of translation table
+ * @pos: offset position of logical block
+ */
+struct ssdfs_blk2off_pos_cache_item {
+	u16 logical_blk;
+	u64 gen;
+	struct ssdfs_offset_position pos;
+};
+
+/*
+ * struct ssdfs_blk2off_pos_cache - cache of offset positions
+ * @lock: cache's lock
+ * @items: array of cached positions (indexed by logical block)
+ *
+ * The cache provides the lockless read path of translation of
+ * logical block into offset position. Position is cached by
+ * the reader that holds the translation lock. Any modification
+ * of the table increments the generation of the table under
+ * the exclusive translation lock. As a result, all cached
+ * positions become obsolete because of generation mismatch.
+ */
+struct ssdfs_blk2off_pos_cache {
+	seqlock_t lock;
+	struct ssdfs_blk2off_pos_cache_item items[SSDFS_BLK2OFF_POS_CACHE_SIZE];
+};
+
 /*
  * struct ssdfs_blk2off_table - in-core translation table
  * @flags: flags of translation table
@@ -186,6 +217,8 @@ struct ssdfs_bitmap_array {
  * @pages_per_seg: pages per segment
  * @type: translation table type
  * @translation_lock: lock of translation operation
+ * @translation_gen: generation of table (incremented by every update)
+ * @pos_cache: cache of offset positions for lockless lookup
  * @init_cno: last actual checkpoint
  * @used_logical_blks: count of used logical blocks
  * @free_logical_blks: count of free logical blocks
@@ -200,6 +233,7 @@ struct ssdfs_bitmap_array {
  * @full_init_end: wait of full init ending
  * @wait_queue: wait queue of blk2off table
  * @fsi: pointer on shared file system object
+ * @parent_si: pointer on parent segment object
  */
 struct ssdfs_blk2off_table {
 	atomic_t flags;
@@ -210,6 +244,8 @@ struct ssdfs_blk2off_table {
 	u8 type;
 
 	struct rw_semaphore translation_lock;
+	atomic64_t translation_gen;
+	struct ssdfs_blk2off_pos_cache pos_cache;
 	u64 init_cno;
 	u16 used_logical_blks;
 	u16 free_logical_blks;
@@ -227,6 +263,7 @@ struct ssdfs_blk2off_table {
 	wait_queue_head_t wait_queue;
 
 	struct ssdfs_fs_info *fsi;
+	struct ssdfs_segment_info *parent_si;
 };
 
 #define SSDFS_OFF_POS(ptr) \
@@ -302,6 +339,21 @@ size_t ssdfs_blk2off_table_bmap_bytes(size_t items_count)
 	return bytes;
 }
 
+/*
+ * ssdfs_blk2off_table_down_write() - lock translation table for update
+ * @table: pointer on table object
+ *
+ * This method takes the translation lock exclusively and makes
+ * obsolete all cached offset positions of the table.
+ */
+static inline
+void ssdfs_blk2off_table_down_write(struct ssdfs_blk2off_table *table)
+{
+	down_write(&table->translation_lock);
+	atomic64_inc(&table->translation_gen);
+	smp_mb__after_atomic();
+}
+
 static inline
 bool is_ssdfs_logical_block_migrating(int blk_state)
 {
@@ -422,6 +474,9 @@ int ssdfs_blk2off_table_set_block_commit(struct ssdfs_blk2off_table *table,
 					 u16 peb_index);
 int ssdfs_blk2off_table_revert_migration_state(struct ssdfs_blk2off_table *tbl,
 						u16 peb_index);
+int ssdfs_blk2off_table_forget_block_migration(struct ssdfs_blk2off_table *tbl,
+						u16 logical_blk,
+						u16 peb_index);
 
 #ifdef CONFIG_SSDFS_TESTING
 int ssdfs_blk2off_table_fragment_set_clean(struct ssdfs_blk2off_table *table,
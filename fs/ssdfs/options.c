@@ -41,6 +41,22 @@
  * Opt_fs_err_ro: remount in RO state if fs error is detected
  * Opt_fs_err_cont: continue execution if fs error is detected
  * Opt_ignore_fs_state: ignore on-disk file system state during mount
+ * Opt_percpu_cur_segs: use per-CPU current user data segments
+ * Opt_shared_cur_segs: use one shared current user data segment
+ * Opt_lazy_peb_threads: start flush threads of used PEBs on first update
+ * Opt_eager_peb_threads: start all PEB threads during segment creation
+ * Opt_temp_data_streams: separate user data by temperature
+ * Opt_single_data_stream: store all user data into one stream
+ * Opt_lazy_blk2off_init: init offset table of used PEBs on first miss
+ * Opt_eager_blk2off_init: init offset table during segment creation
+ * Opt_compr_btree_nodes: compress b-tree leaf and hybrid nodes
+ * Opt_raw_btree_nodes: store b-tree nodes without compression
+ * Opt_inline_max: maximal size of a new inline file in bytes
+ * Opt_inval_budget: maximal number of invalidated segments per second
+ * Opt_hwqueue_peb_affinity: bind PEB threads to CPU group of PEB
+ * Opt_no_peb_affinity: let scheduler to place PEB threads
+ * Opt_high_meta_prio: issue metadata segments' I/O with real-time priority
+ * Opt_normal_meta_prio: issue metadata and user data I/O with same priority
  * Opt_err: just end of array marker
  */
 enum {
@@ -49,6 +65,22 @@ enum {
 	Opt_fs_err_ro,
 	Opt_fs_err_cont,
 	Opt_ignore_fs_state,
+	Opt_percpu_cur_segs,
+	Opt_shared_cur_segs,
+	Opt_lazy_peb_threads,
+	Opt_eager_peb_threads,
+	Opt_temp_data_streams,
+	Opt_single_data_stream,
+	Opt_lazy_blk2off_init,
+	Opt_eager_blk2off_init,
+	Opt_compr_btree_nodes,
+	Opt_raw_btree_nodes,
+	Opt_inline_max,
+	Opt_inval_budget,
+	Opt_hwqueue_peb_affinity,
+	Opt_no_peb_affinity,
+	Opt_high_meta_prio,
+	Opt_normal_meta_prio,
 	Opt_err,
 };
 
@@ -58,6 +90,22 @@ static const match_table_t tokens = {
 	{Opt_fs_err_ro, "errors=remount-ro"},
 	{Opt_fs_err_cont, "errors=continue"},
 	{Opt_ignore_fs_state, "fs_state=ignore"},
+	{Opt_percpu_cur_segs, "cur_segs=percpu"},
+	{Opt_shared_cur_segs, "cur_segs=shared"},
+	{Opt_lazy_peb_threads, "peb_threads=lazy"},
+	{Opt_eager_peb_threads, "peb_threads=eager"},
+	{Opt_temp_data_streams, "data_streams=temperature"},
+	{Opt_single_data_stream, "data_streams=single"},
+	{Opt_lazy_blk2off_init, "blk2off_init=lazy"},
+	{Opt_eager_blk2off_init, "blk2off_init=eager"},
+	{Opt_compr_btree_nodes, "btree_nodes=compressed"},
+	{Opt_raw_btree_nodes, "btree_nodes=raw"},
+	{Opt_inline_max, "inline_max=%u"},
+	{Opt_inval_budget, "inval_budget=%u"},
+	{Opt_hwqueue_peb_affinity, "peb_affinity=hwqueue"},
+	{Opt_no_peb_affinity, "peb_affinity=none"},
+	{Opt_high_meta_prio, "meta_prio=high"},
+	{Opt_normal_meta_prio, "meta_prio=normal"},
 	{Opt_err, NULL},
 };
 
@@ -65,6 +113,7 @@ int ssdfs_parse_options(struct ssdfs_fs_info *fs_info, char *data)
 {
 	substring_t args[MAX_OPT_ARGS];
 	char *p, *name;
+	int value;
 
 	if (!data)
 		return 0;
@@ -94,6 +143,16 @@ int ssdfs_parse_options(struct ssdfs_fs_info *fs_info, char *data)
 			else if (!strcmp(name, "lzo"))
 				ssdfs_set_opt(fs_info->mount_opts,
 						COMPR_MODE_LZO);
+#endif
+#ifdef CONFIG_SSDFS_ZSTD
+			else if (!strcmp(name, "zstd"))
+				ssdfs_set_opt(fs_info->mount_opts,
+						COMPR_MODE_ZSTD);
+#endif
+#ifdef CONFIG_SSDFS_LZ4
+			else if (!strcmp(name, "lz4"))
+				ssdfs_set_opt(fs_info->mount_opts,
+						COMPR_MODE_LZ4);
 #endif
 			else {
 				SSDFS_ERR("unknown compressor %s\n", name);
@@ -128,6 +187,78 @@ int ssdfs_parse_options(struct ssdfs_fs_info *fs_info, char *data)
 			ssdfs_set_opt(fs_info->mount_opts, IGNORE_FS_STATE);
 			break;
 
+		case Opt_percpu_cur_segs:
+			ssdfs_set_opt(fs_info->mount_opts, PERCPU_CUR_SEGS);
+			break;
+
+		case Opt_shared_cur_segs:
+			ssdfs_clear_opt(fs_info->mount_opts, PERCPU_CUR_SEGS);
+			break;
+
+		case Opt_lazy_peb_threads:
+			ssdfs_set_opt(fs_info->mount_opts, LAZY_PEB_THREADS);
+			break;
+
+		case Opt_eager_peb_threads:
+			ssdfs_clear_opt(fs_info->mount_opts, LAZY_PEB_THREADS);
+			break;
+
+		case Opt_temp_data_streams:
+			ssdfs_set_opt(fs_info->mount_opts, DATA_TEMP_STREAMS);
+			break;
+
+		case Opt_single_data_stream:
+			ssdfs_clear_opt(fs_info->mount_opts, DATA_TEMP_STREAMS);
+			break;
+
+		case Opt_lazy_blk2off_init:
+			ssdfs_set_opt(fs_info->mount_opts, LAZY_BLK2OFF_INIT);
+			break;
+
+		case Opt_eager_blk2off_init:
+			ssdfs_clear_opt(fs_info->mount_opts, LAZY_BLK2OFF_INIT);
+			break;
+
+		case Opt_compr_btree_nodes:
+			ssdfs_set_opt(fs_info->mount_opts, COMPR_BTREE_NODES);
+			break;
+
+		case Opt_raw_btree_nodes:
+			ssdfs_clear_opt(fs_info->mount_opts, COMPR_BTREE_NODES);
+			break;
+
+		case Opt_inline_max:
+			if (match_int(&args[0], &value) || value < 0) {
+				SSDFS_ERR("invalid inline_max option\n");
+				return -EINVAL;
+			}
+			fs_info->inline_file_max = (u32)value;
+			break;
+
+		case Opt_inval_budget:
+			if (match_int(&args[0], &value) || value < 0) {
+				SSDFS_ERR("invalid inval_budget option\n");
+				return -EINVAL;
+			}
+			fs_info->invalidation_budget = (u32)value;
+			break;
+
+		case Opt_hwqueue_peb_affinity:
+			ssdfs_set_opt(fs_info->mount_opts, PEB_AFFINITY);
+			break;
+
+		case Opt_no_peb_affinity:
+			ssdfs_clear_opt(fs_info->mount_opts, PEB_AFFINITY);
+			break;
+
+		case Opt_high_meta_prio:
+			ssdfs_set_opt(fs_info->mount_opts, META_IO_PRIO);
+			break;
+
+		case Opt_normal_meta_prio:
+			ssdfs_clear_opt(fs_info->mount_opts, META_IO_PRIO);
+			break;
+
 		default:
 			SSDFS_ERR("unrecognized mount option '%s'\n", p);
 			return -EINVAL;
@@ -175,6 +306,12 @@ int ssdfs_show_options(struct seq_file *seq, struct dentry *root)
 	} else if (ssdfs_test_opt(fsi->mount_opts, COMPR_MODE_LZO)) {
 		compress_type = "lzo";
 		seq_printf(seq, ",compress=%s", compress_type);
+	} else if (ssdfs_test_opt(fsi->mount_opts, COMPR_MODE_ZSTD)) {
+		compress_type = "zstd";
+		seq_printf(seq, ",compress=%s", compress_type);
+	} else if (ssdfs_test_opt(fsi->mount_opts, COMPR_MODE_LZ4)) {
+		compress_type = "lz4";
+		seq_printf(seq, ",compress=%s", compress_type);
 	}
 
 	if (ssdfs_test_opt(fsi->mount_opts, ERRORS_PANIC))
@@ -187,5 +324,32 @@ int ssdfs_show_options(struct seq_file *seq, struct dentry *root)
 	if (ssdfs_test_opt(fsi->mount_opts, IGNORE_FS_STATE))
 		seq_puts(seq, ",fs_state=ignore");
 
+	if (ssdfs_test_opt(fsi->mount_opts, PERCPU_CUR_SEGS))
+		seq_puts(seq, ",cur_segs=percpu");
+
+	if (ssdfs_test_opt(fsi->mount_opts, LAZY_PEB_THREADS))
+		seq_puts(seq, ",peb_threads=lazy");
+
+	if (ssdfs_test_opt(fsi->mount_opts, DATA_TEMP_STREAMS))
+		seq_puts(seq, ",data_streams=temperature");
+
+	if (ssdfs_test_opt(fsi->mount_opts, LAZY_BLK2OFF_INIT))
+		seq_puts(seq, ",blk2off_init=lazy");
+
+	if (ssdfs_test_opt(fsi->mount_opts, COMPR_BTREE_NODES))
+		seq_puts(seq, ",btree_nodes=compressed");
+
+	if (ssdfs_test_opt(fsi->mount_opts, PEB_AFFINITY))
+		seq_puts(seq, ",peb_affinity=hwqueue");
+
+	if (ssdfs_test_opt(fsi->mount_opts, META_IO_PRIO))
+		seq_puts(seq, ",meta_prio=high");
+
+	if (fsi->inline_file_max != U32_MAX)
+		seq_printf(seq, ",inline_max=%u", fsi->inline_file_max);
+
+	if (fsi->invalidation_budget != 0)
+		seq_printf(seq, ",inval_budget=%u", fsi->invalidation_budget);
+
 	return 0;
 }
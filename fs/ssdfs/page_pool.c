@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * SSDFS -- SSD-oriented File System.
+ *
+ * fs/ssdfs/page_pool.c - per-CPU pool of recycled memory pages.
+ *
+ * Copyright (c) 2023 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ * All rights reserved.
+ *
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/highmem.h>
+#include <linux/percpu.h>
+#include <linux/shrinker.h>
+#include <linux/pagevec.h>
+
+#include "peb_mapping_queue.h"
+#include "peb_mapping_table_cache.h"
+#include "page_vector.h"
+#include "ssdfs.h"
+
+/*
+ * The page arrays, page vectors and dynamic arrays allocate and free
+ * the memory pages of log buffers, bitmaps and nodes' content
+ * constantly. The freed pages are kept in the per-CPU pool and
+ * they are reused by the next allocations instead of calling
+ * the buddy allocator. Every CPU keeps not more pages than
+ * the high watermark. The rest pages are returned to the system.
+ * The shrinker drains the pool under memory pressure.
+ */
+#define SSDFS_PAGE_POOL_PCP_HIGH	(64)
+
+/*
+ * struct ssdfs_page_pool_pcp - per-CPU pool of memory pages
+ * @lock: pool lock
+ * @count: number of pages in the pool
+ * @pages: array of pages
+ */
+struct ssdfs_page_pool_pcp {
+	spinlock_t lock;
+	unsigned int count;
+	struct page *pages[SSDFS_PAGE_POOL_PCP_HIGH];
+};
+
+static DEFINE_PER_CPU(struct ssdfs_page_pool_pcp, ssdfs_page_pool);
+static atomic_long_t ssdfs_page_pool_pages = ATOMIC_LONG_INIT(0);
+static bool ssdfs_page_pool_enabled;
+static struct shrinker ssdfs_page_pool_shrinker;
+
+/*
+ * can_page_be_recycled() - check that page can be kept in the pool
+ * @page: memory page
+ *
+ * Only the page without any other owner can be reused. The page
+ * from the page cache or the page under I/O is returned to the system.
+ */
+static inline
+bool can_page_be_recycled(struct page *page)
+{
+	if (page_ref_count(page) != 1)
+		return false;
+
+	if (PageHighMem(page) || PageCompound(page))
+		return false;
+
+	if (page->mapping || PageLocked(page) ||
+	    PageWriteback(page) || PagePrivate(page))
+		return false;
+
+	return true;
+}
+
+/*
+ * ssdfs_page_pool_get() - get page from the pool
+ * @gfp_mask: mask of the allocation
+ *
+ * RETURN:
+ * [success] - pointer on page.
+ * [failure] - NULL (the pool is empty).
+ */
+struct page *ssdfs_page_pool_get(gfp_t gfp_mask)
+{
+	struct ssdfs_page_pool_pcp *pcp;
+	struct page *page = NULL;
+	unsigned long flags;
+
+	if (!READ_ONCE(ssdfs_page_pool_enabled))
+		return NULL;
+
+	pcp = raw_cpu_ptr(&ssdfs_page_pool);
+
+	spin_lock_irqsave(&pcp->lock, flags);
+	if (pcp->count > 0) {
+		pcp->count--;
+		page = pcp->pages[pcp->count];
+		pcp->pages[pcp->count] = NULL;
+	}
+	spin_unlock_irqrestore(&pcp->lock, flags);
+
+	if (!page)
+		return NULL;
+
+	atomic_long_dec(&ssdfs_page_pool_pages);
+
+	if (gfp_mask & __GFP_ZERO)
+		clear_highpage(page);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("page %p, count %d\n",
+		  page, page_ref_count(page));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return page;
+}
+
+/*
+ * ssdfs_page_pool_put() - return page into the pool
+ * @page: memory page
+ *
+ * RETURN:
+ * [true]  - page has been kept in the pool.
+ * [false] - page should be freed by caller.
+ */
+bool ssdfs_page_pool_put(struct page *page)
+{
+	struct ssdfs_page_pool_pcp *pcp;
+	unsigned long flags;
+	bool added = false;
+
+	if (!READ_ONCE(ssdfs_page_pool_enabled))
+		return false;
+
+	if (!can_page_be_recycled(page))
+		return false;
+
+	ClearPageUptodate(page);
+	ClearPageDirty(page);
+	ClearPageError(page);
+	set_page_private(page, 0);
+	page->index = 0;
+
+	pcp = raw_cpu_ptr(&ssdfs_page_pool);
+
+	spin_lock_irqsave(&pcp->lock, flags);
+	if (pcp->count < SSDFS_PAGE_POOL_PCP_HIGH) {
+		pcp->pages[pcp->count] = page;
+		pcp->count++;
+		added = true;
+	}
+	spin_unlock_irqrestore(&pcp->lock, flags);
+
+	if (added)
+		atomic_long_inc(&ssdfs_page_pool_pages);
+
+	return added;
+}
+
+/*
+ * ssdfs_page_pool_drain() - return pages of the pool to the system
+ * @nr_to_free: max number of pages for freeing
+ *
+ * RETURN: number of freed pages.
+ */
+static
+unsigned long ssdfs_page_pool_drain(unsigned long nr_to_free)
+{
+	struct ssdfs_page_pool_pcp *pcp;
+	struct page *page;
+	unsigned long flags;
+	unsigned long freed = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(&ssdfs_page_pool, cpu);
+
+		spin_lock_irqsave(&pcp->lock, flags);
+		while (pcp->count > 0 && freed < nr_to_free) {
+			pcp->count--;
+			page = pcp->pages[pcp->count];
+			pcp->pages[pcp->count] = NULL;
+			__free_pages(page, 0);
+			freed++;
+		}
+		spin_unlock_irqrestore(&pcp->lock, flags);
+
+		if (freed >= nr_to_free)
+			break;
+	}
+
+	atomic_long_sub(freed, &ssdfs_page_pool_pages);
+
+	return freed;
+}
+
+static
+unsigned long ssdfs_page_pool_count(struct shrinker *shrink,
+				    struct shrink_control *sc)
+{
+	unsigned long count = atomic_long_read(&ssdfs_page_pool_pages);
+
+	return count > 0 ? count : SHRINK_EMPTY;
+}
+
+static
+unsigned long ssdfs_page_pool_scan(struct shrinker *shrink,
+				   struct shrink_control *sc)
+{
+	unsigned long freed;
+
+	freed = ssdfs_page_pool_drain(sc->nr_to_scan);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("nr_to_scan %lu, freed %lu\n",
+		  sc->nr_to_scan, freed);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return freed > 0 ? freed : SHRINK_STOP;
+}
+
+int ssdfs_page_pool_init(void)
+{
+	struct ssdfs_page_pool_pcp *pcp;
+	int cpu;
+	int err;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(&ssdfs_page_pool, cpu);
+		spin_lock_init(&pcp->lock);
+		pcp->count = 0;
+	}
+
+	ssdfs_page_pool_shrinker.count_objects = ssdfs_page_pool_count;
+	ssdfs_page_pool_shrinker.scan_objects = ssdfs_page_pool_scan;
+	ssdfs_page_pool_shrinker.seeks = DEFAULT_SEEKS;
+
+	err = register_shrinker(&ssdfs_page_pool_shrinker,
+				"ssdfs-page-pool");
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to register page pool shrinker: "
+			  "err %d\n", err);
+		return err;
+	}
+
+	WRITE_ONCE(ssdfs_page_pool_enabled, true);
+
+	return 0;
+}
+
+void ssdfs_page_pool_exit(void)
+{
+	WRITE_ONCE(ssdfs_page_pool_enabled, false);
+	unregister_shrinker(&ssdfs_page_pool_shrinker);
+	ssdfs_page_pool_drain(ULONG_MAX);
+}
@@ -53,6 +53,7 @@ atomic64_t ssdfs_peb_cache_leaks;
  * void *ssdfs_peb_kmalloc(size_t size, gfp_t flags)
  * void *ssdfs_peb_kzalloc(size_t size, gfp_t flags)
  * void *ssdfs_peb_kcalloc(size_t n, size_t size, gfp_t flags)
+ * void *ssdfs_peb_kzalloc_node(size_t size, gfp_t flags, int node)
  * void ssdfs_peb_kfree(void *kaddr)
  * struct page *ssdfs_peb_alloc_page(gfp_t gfp_mask)
  * struct page *ssdfs_peb_add_pagevec_page(struct pagevec *pvec)
@@ -351,12 +352,14 @@ int ssdfs_peb_current_log_prepare(struct ssdfs_peb_info *pebi)
 	struct ssdfs_fs_info *fsi;
 	struct ssdfs_peb_area *area;
 	struct ssdfs_peb_temp_buffer *write_buf;
+	struct ssdfs_peb_compr_job *job;
 	size_t blk_desc_size = sizeof(struct ssdfs_block_descriptor);
 	size_t blk2off_tbl_hdr_size = sizeof(struct ssdfs_blk2off_table_header);
 	size_t buf_size;
 	u16 flags;
 	size_t bmap_bytes;
 	size_t bmap_pages;
+	int node;
 	int i;
 	int err = 0;
 
@@ -366,6 +369,7 @@ int ssdfs_peb_current_log_prepare(struct ssdfs_peb_info *pebi)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	fsi = pebi->pebc->parent_si->fsi;
+	node = pebi->pebc->parent_si->node_id;
 	flags = fsi->metadata_options.blk2off_tbl.flags;
 	buf_size = ssdfs_peb_temp_buffer_default_size(fsi->pagesize);
 
@@ -403,6 +407,24 @@ int ssdfs_peb_current_log_prepare(struct ssdfs_peb_info *pebi)
 	pebi->current_log.blk2off_tbl.compressed_offset = blk2off_tbl_hdr_size;
 	pebi->current_log.blk2off_tbl.sequence_id = 0;
 
+	job = &pebi->current_log.blk_desc_compr;
+	memset(job, 0, sizeof(struct ssdfs_peb_compr_job));
+	init_completion(&job->done);
+	job->is_pending = false;
+
+	if (flags & SSDFS_BLK2OFF_TBL_MAKE_COMPRESSION) {
+		job->uncompr_buf_size = max_t(size_t, buf_size, PAGE_SIZE);
+		job->uncompr_buf = ssdfs_peb_kzalloc_node(job->uncompr_buf_size,
+							  GFP_KERNEL, node);
+		job->compr_buf = ssdfs_peb_kzalloc_node(PAGE_SIZE,
+							GFP_KERNEL, node);
+		if (!job->uncompr_buf || !job->compr_buf) {
+			err = -ENOMEM;
+			SSDFS_ERR("unable to allocate compression buffers\n");
+			goto free_compr_job_buffers;
+		}
+	}
+
 	for (i = 0; i < SSDFS_LOG_AREA_MAX; i++) {
 		struct ssdfs_peb_area_metadata *metadata;
 		size_t metadata_size = sizeof(struct ssdfs_peb_area_metadata);
@@ -422,8 +444,10 @@ int ssdfs_peb_current_log_prepare(struct ssdfs_peb_info *pebi)
 			area->metadata.reserved_offset = blk_table_size;
 
 			if (flags & SSDFS_BLK2OFF_TBL_MAKE_COMPRESSION) {
-				write_buf->ptr = ssdfs_peb_kzalloc(buf_size,
-								   GFP_KERNEL);
+				write_buf->ptr =
+					ssdfs_peb_kzalloc_node(buf_size,
+							       GFP_KERNEL,
+							       node);
 				if (!write_buf->ptr) {
 					err = -ENOMEM;
 					SSDFS_ERR("unable to allocate\n");
@@ -486,6 +510,17 @@ fail_init_current_log:
 		ssdfs_destroy_page_array(&area->array);
 	}
 
+free_compr_job_buffers:
+	if (job->uncompr_buf) {
+		ssdfs_peb_kfree(job->uncompr_buf);
+		job->uncompr_buf = NULL;
+	}
+
+	if (job->compr_buf) {
+		ssdfs_peb_kfree(job->compr_buf);
+		job->compr_buf = NULL;
+	}
+
 	ssdfs_page_vector_destroy(&pebi->current_log.bmap_snapshot);
 
 	return err;
@@ -499,6 +534,7 @@ static inline
 int ssdfs_peb_current_log_destroy(struct ssdfs_peb_info *pebi)
 {
 	struct ssdfs_peb_temp_buffer *write_buf;
+	struct ssdfs_peb_compr_job *job;
 	int i;
 	int err = 0;
 
@@ -511,6 +547,20 @@ int ssdfs_peb_current_log_destroy(struct ssdfs_peb_info *pebi)
 
 	ssdfs_peb_current_log_lock(pebi);
 
+	job = &pebi->current_log.blk_desc_compr;
+	ssdfs_peb_compr_job_wait(job);
+
+	if (job->uncompr_buf) {
+		ssdfs_peb_kfree(job->uncompr_buf);
+		job->uncompr_buf = NULL;
+		job->uncompr_buf_size = 0;
+	}
+
+	if (job->compr_buf) {
+		ssdfs_peb_kfree(job->compr_buf);
+		job->compr_buf = NULL;
+	}
+
 	for (i = 0; i < SSDFS_LOG_AREA_MAX; i++) {
 		struct ssdfs_page_array *area_pages;
 
@@ -579,6 +629,7 @@ int ssdfs_peb_object_create(struct ssdfs_peb_info *pebi,
 	int peb_type;
 	size_t buf_size;
 	u16 flags;
+	int i;
 	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -648,23 +699,31 @@ int ssdfs_peb_object_create(struct ssdfs_peb_info *pebi,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	init_rwsem(&pebi->read_buffer.lock);
-	if (flags & SSDFS_BLK2OFF_TBL_MAKE_COMPRESSION) {
-		pebi->read_buffer.blk_desc.ptr = ssdfs_peb_kzalloc(buf_size,
-								  GFP_KERNEL);
-		if (!pebi->read_buffer.blk_desc.ptr) {
+	pebi->read_buffer.access_counter = 0;
+	for (i = 0; i < SSDFS_PEB_BLK_DESC_CACHE_CAPACITY; i++) {
+		struct ssdfs_peb_read_buffer *buf;
+
+		buf = &pebi->read_buffer.blk_desc[i];
+
+		buf->ptr = NULL;
+		buf->log_start_page = U16_MAX;
+		buf->offset = U32_MAX;
+		buf->fragment_size = 0;
+		buf->buf_size = 0;
+		buf->last_access = 0;
+
+		if (!(flags & SSDFS_BLK2OFF_TBL_MAKE_COMPRESSION))
+			continue;
+
+		buf->ptr = ssdfs_peb_kzalloc_node(buf_size, GFP_KERNEL,
+						  pebc->parent_si->node_id);
+		if (!buf->ptr) {
 			err = -ENOMEM;
 			SSDFS_ERR("unable to allocate\n");
 			goto fail_conctruct_peb_obj;
 		}
 
-		pebi->read_buffer.blk_desc.offset = U32_MAX;
-		pebi->read_buffer.blk_desc.fragment_size = 0;
-		pebi->read_buffer.blk_desc.buf_size = buf_size;
-	} else {
-		pebi->read_buffer.blk_desc.ptr = NULL;
-		pebi->read_buffer.blk_desc.offset = U32_MAX;
-		pebi->read_buffer.blk_desc.fragment_size = 0;
-		pebi->read_buffer.blk_desc.buf_size = 0;
+		buf->buf_size = buf_size;
 	}
 
 	pebi->pebc = pebc;
@@ -770,6 +829,7 @@ int ssdfs_peb_object_destroy(struct ssdfs_peb_info *pebi)
 {
 	struct ssdfs_fs_info *fsi;
 	int state;
+	int i;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -794,12 +854,19 @@ int ssdfs_peb_object_destroy(struct ssdfs_peb_info *pebi)
 	err = ssdfs_peb_current_log_destroy(pebi);
 
 	down_write(&pebi->read_buffer.lock);
-	if (pebi->read_buffer.blk_desc.ptr) {
-		ssdfs_peb_kfree(pebi->read_buffer.blk_desc.ptr);
-		pebi->read_buffer.blk_desc.ptr = NULL;
-		pebi->read_buffer.blk_desc.offset = U32_MAX;
-		pebi->read_buffer.blk_desc.fragment_size = 0;
-		pebi->read_buffer.blk_desc.buf_size = 0;
+	for (i = 0; i < SSDFS_PEB_BLK_DESC_CACHE_CAPACITY; i++) {
+		struct ssdfs_peb_read_buffer *buf;
+
+		buf = &pebi->read_buffer.blk_desc[i];
+
+		if (buf->ptr) {
+			ssdfs_peb_kfree(buf->ptr);
+			buf->ptr = NULL;
+			buf->log_start_page = U16_MAX;
+			buf->offset = U32_MAX;
+			buf->fragment_size = 0;
+			buf->buf_size = 0;
+		}
 	}
 	up_write(&pebi->read_buffer.lock);
 
@@ -22,6 +22,8 @@
 #ifndef _SSDFS_PEB_H
 #define _SSDFS_PEB_H
 
+#include <linux/workqueue.h>
+
 #include "request_queue.h"
 
 #define SSDFS_BLKBMAP_FRAG_HDR_CAPACITY \
@@ -165,25 +167,33 @@ struct ssdfs_peb_journal_area_metadata {
 /*
  * struct ssdfs_peb_read_buffer - read buffer
  * @ptr: pointer on buffer
+ * @log_start_page: starting page of the log that contains fragment
  * @offset: logical offset in metadata structure
  * @fragment_size: size of fragment in bytes
  * @buf_size: buffer size in bytes
+ * @last_access: value of access counter at the last buffer's hit
  */
 struct ssdfs_peb_read_buffer {
 	void *ptr;
+	u16 log_start_page;
 	u32 offset;
 	size_t fragment_size;
 	size_t buf_size;
+	u64 last_access;
 };
 
+#define SSDFS_PEB_BLK_DESC_CACHE_CAPACITY	(4)
+
 /*
  * struct ssdfs_peb_temp_read_buffers - read temporary buffers
  * @lock: temporary buffers lock
- * @blk_desc: block descriptor table's temp read buffer
+ * @access_counter: counter of block descriptor cache's accesses
+ * @blk_desc: cache of decompressed block descriptor table's fragments
  */
 struct ssdfs_peb_temp_read_buffers {
 	struct rw_semaphore lock;
-	struct ssdfs_peb_read_buffer blk_desc;
+	u64 access_counter;
+	struct ssdfs_peb_read_buffer blk_desc[SSDFS_PEB_BLK_DESC_CACHE_CAPACITY];
 };
 
 /*
@@ -200,6 +210,34 @@ struct ssdfs_peb_temp_buffer {
 	size_t size;
 };
 
+/*
+ * struct ssdfs_peb_compr_job - deferred compression of metadata fragment
+ * @work: work item of compression
+ * @done: compression has been finished
+ * @is_pending: compression has been queued and result is not joined yet
+ * @compr_type: compression type
+ * @meta_desc: fragment descriptor of compressed fragment
+ * @uncompr_buf: buffer with uncompressed fragment
+ * @uncompr_buf_size: size of @uncompr_buf in bytes
+ * @uncompr_size: size of uncompressed fragment in bytes
+ * @compr_buf: buffer with compressed fragment
+ * @compr_size: size of compressed fragment in bytes
+ * @err: result of compression
+ */
+struct ssdfs_peb_compr_job {
+	struct work_struct work;
+	struct completion done;
+	bool is_pending;
+	int compr_type;
+	struct ssdfs_fragment_desc *meta_desc;
+	void *uncompr_buf;
+	size_t uncompr_buf_size;
+	size_t uncompr_size;
+	void *compr_buf;
+	size_t compr_size;
+	int err;
+};
+
 /*
  * struct ssdfs_peb_area_metadata - descriptor of area's items chain
  * @area.blk_desc.table: block descriptors area table
@@ -295,6 +333,7 @@ enum {
  * @bmap_snapshot: snapshot of block bitmap
  * @blk2off_tbl: blk2off table descriptor
  * @area: log's areas (main, diff updates, journal)
+ * @blk_desc_compr: deferred compression of block descriptors' fragment
  */
 struct ssdfs_peb_log {
 	struct mutex lock;
@@ -310,6 +349,7 @@ struct ssdfs_peb_log {
 	struct ssdfs_page_vector bmap_snapshot;
 	struct ssdfs_blk2off_table_area blk2off_tbl;
 	struct ssdfs_peb_area area[SSDFS_LOG_AREA_MAX];
+	struct ssdfs_peb_compr_job blk_desc_compr;
 };
 
 /*
@@ -550,6 +590,26 @@ void ssdfs_peb_set_current_log_state(struct ssdfs_peb_info *pebi,
 	return atomic_set(&pebi->current_log.state, state);
 }
 
+/*
+ * ssdfs_peb_compr_job_wait() - wait the end of deferred compression
+ * @job: deferred compression job
+ *
+ * This function waits the end of queued compression and
+ * discards its result.
+ */
+static inline
+void ssdfs_peb_compr_job_wait(struct ssdfs_peb_compr_job *job)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!job);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (job->is_pending) {
+		wait_for_completion(&job->done);
+		job->is_pending = false;
+	}
+}
+
 /*
  * ssdfs_peb_current_log_init() - initialize current log object
  * @pebi: pointer on PEB object
@@ -891,6 +951,23 @@ bool IS_SSDFS_BLK_STATE_OFFSET_INVALID(struct ssdfs_blk_state_offset *desc)
 	return false;
 }
 
+/*
+ * IS_SSDFS_BLK_STATE_PRE_ALLOCATED() - check that block is pre-allocated
+ * @desc: block state offset
+ *
+ * The pre-allocated block has reserved position in PEB
+ * but it hasn't any state in the log's areas yet.
+ */
+static inline
+bool IS_SSDFS_BLK_STATE_PRE_ALLOCATED(struct ssdfs_blk_state_offset *desc)
+{
+	if (!desc)
+		return false;
+
+	return desc->log_area >= SSDFS_LOG_AREA_MAX &&
+		le32_to_cpu(desc->byte_offset) >= U32_MAX;
+}
+
 /*
  * SSDFS_BLK_DESC_INIT() - init block descriptor
  * @blk_desc: block descriptor
@@ -932,6 +1009,24 @@ bool IS_SSDFS_BLK_DESC_READY_FOR_DIFF(struct ssdfs_block_descriptor *blk_desc)
 	return !IS_SSDFS_BLK_STATE_OFFSET_INVALID(&blk_desc->state[0]);
 }
 
+/*
+ * SSDFS_BLK_DESC_DIFFS_COUNT() - get number of diffs in block's chain
+ * @blk_desc: block descriptor
+ */
+static inline
+int SSDFS_BLK_DESC_DIFFS_COUNT(struct ssdfs_block_descriptor *blk_desc)
+{
+	int i;
+
+	for (i = 0; i < SSDFS_BLK_STATE_OFF_MAX; i++) {
+		if (IS_SSDFS_BLK_STATE_OFFSET_INVALID(&blk_desc->state[i]))
+			break;
+	}
+
+	/* the first state is the base state of the block */
+	return i > 0 ? i - 1 : 0;
+}
+
 static inline
 u8 SSDFS_GET_BLK_DESC_MIGRATION_ID(struct ssdfs_block_descriptor *blk_desc)
 {
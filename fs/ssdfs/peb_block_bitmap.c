@@ -1628,6 +1628,7 @@ int ssdfs_peb_blk_bmap_reserve_metapages(struct ssdfs_peb_blk_bmap *bmap,
 					 u32 count)
 {
 	struct ssdfs_block_bmap *cur_bmap = NULL;
+	atomic_t *seg_free_blks;
 	int reserving_blks = 0;
 	int err = 0;
 
@@ -1666,11 +1667,16 @@ int ssdfs_peb_blk_bmap_reserve_metapages(struct ssdfs_peb_blk_bmap *bmap,
 
 	reserving_blks = min_t(int, (int)count,
 				atomic_read(&bmap->peb_free_blks));
-	reserving_blks = min_t(int, reserving_blks,
-				atomic_read(&bmap->parent->seg_free_blks));
-
-	if (count > atomic_read(&bmap->peb_free_blks) ||
-	    count > atomic_read(&bmap->parent->seg_free_blks)) {
+	/*
+	 * Segment's free blocks can be reserved without
+	 * the modification lock. Take the blocks atomically.
+	 */
+	seg_free_blks = &bmap->parent->seg_free_blks;
+	reserving_blks = ssdfs_segment_blk_bmap_take_free_blks(seg_free_blks,
+								0,
+								reserving_blks);
+
+	if (count > reserving_blks) {
 		err = -ENOSPC;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -1724,7 +1730,6 @@ int ssdfs_peb_blk_bmap_reserve_metapages(struct ssdfs_peb_blk_bmap *bmap,
 	}
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	atomic_sub(reserving_blks, &bmap->parent->seg_free_blks);
 	atomic_add(reserving_blks, &bmap->parent->seg_reserved_metapages);
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -2732,6 +2737,7 @@ init_failed:
 
 		atomic_sub(range->len, &bmap->parent->seg_valid_blks);
 		atomic_add(range->len, &bmap->parent->seg_invalid_blks);
+		WRITE_ONCE(bmap->parent->last_invalidation, jiffies);
 	} else if (is_migrating &&
 			bmap_index == SSDFS_PEB_BLK_BMAP_DESTINATION) {
 		if (range->len > atomic_read(&bmap->peb_valid_blks)) {
@@ -2747,6 +2753,7 @@ init_failed:
 
 		atomic_sub(range->len, &bmap->parent->seg_valid_blks);
 		atomic_add(range->len, &bmap->parent->seg_invalid_blks);
+		WRITE_ONCE(bmap->parent->last_invalidation, jiffies);
 	}
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -4052,3 +4059,83 @@ finish_migration_stop:
 
 	return err;
 }
+
+/*
+ * ssdfs_peb_blk_bmap_compact() - compact idle block bitmaps of PEB
+ * @bmap: PEB's block bitmap object
+ * @force: compact block bitmaps independently from idle time
+ *
+ * This method tries to compact the source and destination
+ * block bitmaps of PEB container that haven't been accessed
+ * for a long time. The block bitmaps that are dirty, locked
+ * or recently used are skipped.
+ *
+ * RETURN:
+ * [success] - number of compacted block bitmaps.
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - unable to allocate memory.
+ */
+int ssdfs_peb_blk_bmap_compact(struct ssdfs_peb_blk_bmap *bmap, bool force)
+{
+	struct ssdfs_block_bmap *array[SSDFS_PEB_BLK_BMAP_INDEX_MAX];
+	int compacted = 0;
+	int i;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!bmap);
+
+	SSDFS_DBG("peb_index %u\n", bmap->peb_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!ssdfs_peb_blk_bmap_initialized(bmap))
+		return 0;
+
+	if (force) {
+		if (!down_read_trylock(&bmap->lock))
+			return 0;
+	} else
+		down_read(&bmap->lock);
+
+	array[SSDFS_PEB_BLK_BMAP_SOURCE] = bmap->src;
+	array[SSDFS_PEB_BLK_BMAP_DESTINATION] = bmap->dst;
+
+	for (i = 0; i < SSDFS_PEB_BLK_BMAP_INDEX_MAX; i++) {
+		if (!array[i])
+			continue;
+
+		err = ssdfs_block_bmap_compact(array[i], force);
+		switch (err) {
+		case 0:
+			compacted++;
+			break;
+
+		case -EBUSY:
+		case -EAGAIN:
+		case -E2BIG:
+			/* block bitmap cannot be compacted now */
+			err = 0;
+			break;
+
+		case -ENOMEM:
+			if (force) {
+				/* memory pressure: try another time */
+				err = 0;
+				goto finish_compaction;
+			}
+			fallthrough;
+
+		default:
+			SSDFS_ERR("fail to compact block bitmap: "
+				  "peb_index %u, index %d, err %d\n",
+				  bmap->peb_index, i, err);
+			goto finish_compaction;
+		}
+	}
+
+finish_compaction:
+	up_read(&bmap->lock);
+
+	return err ? err : compacted;
+}
@@ -152,6 +152,7 @@ int ssdfs_peb_blk_bmap_migrate(struct ssdfs_peb_blk_bmap *bmap,
 				int new_range_state,
 				struct ssdfs_block_bmap_range *range);
 int ssdfs_peb_blk_bmap_finish_migration(struct ssdfs_peb_blk_bmap *bmap);
+int ssdfs_peb_blk_bmap_compact(struct ssdfs_peb_blk_bmap *bmap, bool force);
 
 /*
  * PEB block bitmap internal API
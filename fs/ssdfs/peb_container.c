@@ -25,6 +25,10 @@
 #include <linux/pagemap.h>
 #include <linux/slab.h>
 #include <linux/kthread.h>
+#include <linux/cpumask.h>
+#include <linux/topology.h>
+#include <linux/blkdev.h>
+#include <linux/ioprio.h>
 #include <linux/pagevec.h>
 
 #include "peb_mapping_queue.h"
@@ -137,6 +141,133 @@ void ssdfs_peb_mark_request_block_uptodate(struct ssdfs_peb_container *pebc,
 	}
 }
 
+/*
+ * ssdfs_peb_set_thread_affinity() - bind PEB's thread to CPU group
+ * @pebc: pointer on PEB container
+ * @task: PEB's thread
+ *
+ * The PEB's threads run on the CPUs of the segment's NUMA node.
+ * It keeps the segment object and the log buffers local for
+ * the threads. The device's NUMA node is used if the segment
+ * hasn't been associated with any node.
+ *
+ * blk-mq selects the hardware queue by the CPU that submits the bio
+ * and the completion interrupt is delivered to the CPUs of the queue.
+ * If the peb_affinity option is enabled, then every PEB is assigned
+ * to a CPU of the node. All threads of the PEB are allowed to run
+ * on the SMT siblings of this CPU. As a result, the I/O of the same
+ * PEB is submitted and completed by the same group of CPUs.
+ */
+static
+void ssdfs_peb_set_thread_affinity(struct ssdfs_peb_container *pebc,
+				   struct task_struct *task)
+{
+	struct ssdfs_fs_info *fsi = pebc->parent_si->fsi;
+	struct block_device *bdev = fsi->sb->s_bdev;
+	int node = pebc->parent_si->node_id;
+	unsigned int cpus;
+	u64 index;
+	u32 remainder;
+	unsigned int cpu;
+	int err;
+
+	if (node == NUMA_NO_NODE && bdev && bdev->bd_disk)
+		node = bdev->bd_disk->node_id;
+
+	if (!ssdfs_test_opt(fsi->mount_opts, PEB_AFFINITY)) {
+		if (node == NUMA_NO_NODE || num_online_nodes() <= 1)
+			return;
+
+		err = set_cpus_allowed_ptr(task, cpumask_of_node(node));
+		if (unlikely(err)) {
+			SSDFS_WARN("fail to set affinity: "
+				   "seg_id %llu, peb_index %u, "
+				   "node %d, err %d\n",
+				   pebc->parent_si->seg_id, pebc->peb_index,
+				   node, err);
+		}
+
+		return;
+	}
+
+	if (node != NUMA_NO_NODE)
+		cpus = nr_cpus_node(node);
+	else
+		cpus = num_online_cpus();
+
+	if (cpus <= 1)
+		return;
+
+	index = pebc->parent_si->seg_id * fsi->pebs_per_seg;
+	index += pebc->peb_index;
+	div_u64_rem(index, cpus, &remainder);
+
+	cpu = cpumask_local_spread(remainder, node);
+
+	err = set_cpus_allowed_ptr(task, topology_sibling_cpumask(cpu));
+	if (unlikely(err)) {
+		SSDFS_WARN("fail to set affinity: "
+			   "seg_id %llu, peb_index %u, cpu %u, err %d\n",
+			   pebc->parent_si->seg_id, pebc->peb_index,
+			   cpu, err);
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("seg_id %llu, peb_index %u, node %d, cpu %u\n",
+		  pebc->parent_si->seg_id, pebc->peb_index,
+		  node, cpu);
+#endif /* CONFIG_SSDFS_DEBUG */
+}
+
+/*
+ * ssdfs_peb_set_thread_ioprio() - set I/O priority of PEB's thread
+ * @pebc: pointer on PEB container
+ * @task: PEB's thread
+ * @type: thread type
+ *
+ * The bio receives the I/O priority of the submitting task. The read
+ * and flush threads of metadata segments (mapping table, segment
+ * bitmap, b-tree nodes) receive the real-time I/O class if the
+ * meta_prio=high option is enabled. Then, the I/O scheduler
+ * dispatches the small metadata requests before the bulk
+ * user data writes on the same device. GC threads keep
+ * the default priority because migration is not latency-critical.
+ */
+static
+void ssdfs_peb_set_thread_ioprio(struct ssdfs_peb_container *pebc,
+				 struct task_struct *task, int type)
+{
+	struct ssdfs_segment_info *si = pebc->parent_si;
+	int ioprio;
+	int err;
+
+	if (!ssdfs_test_opt(si->fsi->mount_opts, META_IO_PRIO))
+		return;
+
+	if (si->seg_type == SSDFS_USER_DATA_SEG_TYPE)
+		return;
+
+	switch (type) {
+	case SSDFS_PEB_READ_THREAD:
+	case SSDFS_PEB_FLUSH_THREAD:
+		/* metadata I/O */
+		break;
+
+	default:
+		return;
+	}
+
+	ioprio = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_RT, IOPRIO_NORM);
+
+	err = set_task_ioprio(task, ioprio);
+	if (unlikely(err)) {
+		SSDFS_WARN("fail to set I/O priority: "
+			   "seg_id %llu, peb_index %u, "
+			   "thread_type %d, err %d\n",
+			   si->seg_id, pebc->peb_index, type, err);
+	}
+}
+
 /*
  * ssdfs_peb_start_thread() - start PEB's thread
  * @pebc: pointer on PEB container
@@ -172,13 +303,19 @@ int ssdfs_peb_start_thread(struct ssdfs_peb_container *pebc, int type)
 		  type);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+#ifdef CONFIG_SSDFS_PEB_READ_WORKQUEUE
+	if (type == SSDFS_PEB_READ_THREAD)
+		return ssdfs_peb_start_read_work(pebc);
+#endif /* CONFIG_SSDFS_PEB_READ_WORKQUEUE */
+
 	si = pebc->parent_si;
 	threadfn = thread_desc[type].threadfn;
 	fmt = thread_desc[type].fmt;
 
-	pebc->thread[type].task = kthread_create(threadfn, pebc, fmt,
-						 pebc->parent_si->seg_id,
-						 pebc->peb_index);
+	pebc->thread[type].task = kthread_create_on_node(threadfn, pebc,
+							 si->node_id, fmt,
+							 si->seg_id,
+							 pebc->peb_index);
 	if (IS_ERR_OR_NULL(pebc->thread[type].task)) {
 		err = PTR_ERR(pebc->thread[type].task);
 		if (err == -EINTR) {
@@ -197,6 +334,9 @@ int ssdfs_peb_start_thread(struct ssdfs_peb_container *pebc, int type)
 		return err;
 	}
 
+	ssdfs_peb_set_thread_affinity(pebc, pebc->thread[type].task);
+	ssdfs_peb_set_thread_ioprio(pebc, pebc->thread[type].task, type);
+
 	init_waitqueue_entry(&pebc->thread[type].wait,
 				pebc->thread[type].task);
 	add_wait_queue(&si->wait_queue[type],
@@ -238,6 +378,11 @@ int ssdfs_peb_stop_thread(struct ssdfs_peb_container *pebc, int type)
 		  type, pebc->thread[type].task);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+#ifdef CONFIG_SSDFS_PEB_READ_WORKQUEUE
+	if (type == SSDFS_PEB_READ_THREAD)
+		return ssdfs_peb_stop_read_work(pebc);
+#endif /* CONFIG_SSDFS_PEB_READ_WORKQUEUE */
+
 	if (!pebc->thread[type].task)
 		return 0;
 
@@ -852,6 +997,73 @@ fail_create_using_peb_obj:
 	return err;
 }
 
+/*
+ * can_peb_flush_thread_be_deferred() - check that flush thread can wait
+ * @pebc: pointer on PEB container
+ *
+ * The "used" PEB hasn't free pages. If the PEB isn't under
+ * migration, then the flush thread is needed only for update
+ * requests. It means that the flush thread can be started
+ * by the first update request. The read-only mount defers
+ * the flush threads of such PEBs always, because no update
+ * request is possible until remount in RW mode.
+ */
+static inline
+bool can_peb_flush_thread_be_deferred(struct ssdfs_peb_container *pebc)
+{
+	struct ssdfs_fs_info *fsi = pebc->parent_si->fsi;
+
+	if (!ssdfs_test_opt(fsi->mount_opts, LAZY_PEB_THREADS) &&
+	    !(fsi->sb->s_flags & SB_RDONLY))
+		return false;
+
+	switch (atomic_read(&pebc->items_state)) {
+	case SSDFS_PEB1_SRC_CONTAINER:
+	case SSDFS_PEB2_SRC_CONTAINER:
+		/* PEB isn't under migration */
+		return true;
+
+	default:
+		/* do nothing */
+		break;
+	}
+
+	return false;
+}
+
+/*
+ * can_peb_blk2off_init_be_deferred() - check that offset table init can wait
+ * @pebc: pointer on PEB container
+ *
+ * The last log of "used" PEB is processed during the block
+ * bitmap initialization. If the PEB isn't under migration,
+ * then the rest logs' fragments of offset translation table
+ * are needed only for the blocks that are not in the last log.
+ * It means that the rest fragments can be read on the first
+ * lookup of such block.
+ */
+static inline
+bool can_peb_blk2off_init_be_deferred(struct ssdfs_peb_container *pebc)
+{
+	struct ssdfs_fs_info *fsi = pebc->parent_si->fsi;
+
+	if (!ssdfs_test_opt(fsi->mount_opts, LAZY_BLK2OFF_INIT))
+		return false;
+
+	switch (atomic_read(&pebc->items_state)) {
+	case SSDFS_PEB1_SRC_CONTAINER:
+	case SSDFS_PEB2_SRC_CONTAINER:
+		/* PEB isn't under migration */
+		return true;
+
+	default:
+		/* do nothing */
+		break;
+	}
+
+	return false;
+}
+
 /*
  * ssdfs_create_used_peb_container() - create "used" PEB container
  * @pebi: pointer on PEB container
@@ -951,6 +1163,23 @@ int ssdfs_create_used_peb_container(struct ssdfs_peb_container *pebc,
 	else
 		BUG();
 
+	if (selected_peb == SSDFS_SRC_PEB &&
+	    can_peb_blk2off_init_be_deferred(pebc)) {
+		/*
+		 * Offset table will be initialized by first lookup
+		 * of the block that is absent in the last log
+		 */
+		atomic_set(&pebc->deferred_blk2off_cmd, command);
+
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("offset table init is deferred: "
+			  "seg %llu, peb_index %u\n",
+			  pebc->parent_si->seg_id,
+			  pebc->peb_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+		goto start_read_thread;
+	}
+
 	req3 = ssdfs_request_alloc();
 	if (IS_ERR_OR_NULL(req3)) {
 		err = (req3 == NULL ? -ENOMEM : PTR_ERR(req3));
@@ -971,6 +1200,7 @@ int ssdfs_create_used_peb_container(struct ssdfs_peb_container *pebc,
 	ssdfs_peb_read_request_cno(pebc);
 	ssdfs_requests_queue_add_tail(&pebc->read_rq, req3);
 
+start_read_thread:
 	err = ssdfs_peb_start_thread(pebc, SSDFS_PEB_READ_THREAD);
 	if (unlikely(err)) {
 		if (err == -EINTR) {
@@ -983,23 +1213,37 @@ int ssdfs_create_used_peb_container(struct ssdfs_peb_container *pebc,
 				  pebc->peb_index, err);
 		}
 
+		atomic_set(&pebc->deferred_blk2off_cmd, SSDFS_UNKNOWN_CMD);
 		ssdfs_requests_queue_remove_all(&pebc->read_rq, -ERANGE);
 		goto fail_create_used_peb_obj;
 	}
 
-	err = ssdfs_peb_start_thread(pebc, SSDFS_PEB_FLUSH_THREAD);
-	if (unlikely(err)) {
-		if (err == -EINTR) {
-			/*
-			 * Ignore this error.
-			 */
-		} else {
-			SSDFS_ERR("fail to start flush thread: "
-				  "peb_index %u, err %d\n",
-				  pebc->peb_index, err);
-		}
+	if (selected_peb == SSDFS_SRC_PEB &&
+	    can_peb_flush_thread_be_deferred(pebc)) {
+		/*
+		 * Flush thread will be started by first update request
+		 */
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("flush thread is deferred: "
+			  "seg %llu, peb_index %u\n",
+			  pebc->parent_si->seg_id,
+			  pebc->peb_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+	} else {
+		err = ssdfs_peb_start_thread(pebc, SSDFS_PEB_FLUSH_THREAD);
+		if (unlikely(err)) {
+			if (err == -EINTR) {
+				/*
+				 * Ignore this error.
+				 */
+			} else {
+				SSDFS_ERR("fail to start flush thread: "
+					  "peb_index %u, err %d\n",
+					  pebc->peb_index, err);
+			}
 
-		goto stop_read_thread;
+			goto stop_read_thread;
+		}
 	}
 
 	peb_blkbmap = &pebc->parent_si->blk_bmap.peb[pebc->peb_index];
@@ -1040,6 +1284,7 @@ stop_flush_thread:
 	ssdfs_peb_stop_thread(pebc, SSDFS_PEB_FLUSH_THREAD);
 
 stop_read_thread:
+	atomic_set(&pebc->deferred_blk2off_cmd, SSDFS_UNKNOWN_CMD);
 	ssdfs_requests_queue_remove_all(&pebc->read_rq, -ERANGE);
 	wake_up_all(&pebc->parent_si->wait_queue[SSDFS_PEB_READ_THREAD]);
 	ssdfs_peb_stop_thread(pebc, SSDFS_PEB_READ_THREAD);
@@ -2183,6 +2428,8 @@ int ssdfs_peb_container_create(struct ssdfs_fs_info *fsi,
 	pebc = &si->peb_array[peb_index];
 
 	memset(pebc, 0, sizeof(struct ssdfs_peb_container));
+	mutex_init(&pebc->thread_lock);
+	atomic_set(&pebc->deferred_blk2off_cmd, SSDFS_UNKNOWN_CMD);
 	mutex_init(&pebc->migration_lock);
 	atomic_set(&pebc->migration_state, SSDFS_PEB_UNKNOWN_MIGRATION_STATE);
 	atomic_set(&pebc->migration_phase, SSDFS_PEB_MIGRATION_STATUS_UNKNOWN);
@@ -2268,7 +2515,7 @@ int ssdfs_peb_container_create(struct ssdfs_fs_info *fsi,
 		  pebr.pebs[SSDFS_MAPTBL_RELATION_INDEX].consistency);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&pebc->lock);
+	SSDFS_DOWN_WRITE(pebc, &pebc->lock);
 
 	mtblpd = &pebr.pebs[SSDFS_MAPTBL_MAIN_INDEX];
 
@@ -3295,7 +3542,7 @@ int ssdfs_peb_container_prepare_zns_destination(struct ssdfs_peb_container *ptr)
 		return -ERANGE;
 	}
 
-	down_read(&fsi->cur_segs->lock);
+	SSDFS_DOWN_READ(cur_segs, &fsi->cur_segs->lock);
 
 	cur_seg = fsi->cur_segs->objects[SSDFS_CUR_DATA_UPDATE_SEG];
 
@@ -3450,6 +3697,123 @@ int ssdfs_peb_container_prepare_destination(struct ssdfs_peb_container *ptr)
 	return err;
 }
 
+/*
+ * ssdfs_peb_container_start_flush_thread() - start deferred flush thread
+ * @pebc: pointer on PEB container
+ *
+ * This method starts the flush thread of PEB container
+ * if the thread has been deferred during the container's
+ * creation. It needs to call the method before adding
+ * a request into the update queue.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ENOMEM     - unable to start the thread.
+ */
+int ssdfs_peb_container_start_flush_thread(struct ssdfs_peb_container *pebc)
+{
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebc || !pebc->parent_si);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!IS_ERR_OR_NULL(READ_ONCE(pebc->thread[SSDFS_PEB_FLUSH_THREAD].task)))
+		return 0;
+
+	mutex_lock(&pebc->thread_lock);
+
+	if (!IS_ERR_OR_NULL(pebc->thread[SSDFS_PEB_FLUSH_THREAD].task))
+		goto finish_start_thread;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("start deferred flush thread: "
+		  "seg %llu, peb_index %u\n",
+		  pebc->parent_si->seg_id,
+		  pebc->peb_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	err = ssdfs_peb_start_thread(pebc, SSDFS_PEB_FLUSH_THREAD);
+	if (unlikely(err)) {
+		pebc->thread[SSDFS_PEB_FLUSH_THREAD].task = NULL;
+		SSDFS_ERR("fail to start flush thread: "
+			  "seg %llu, peb_index %u, err %d\n",
+			  pebc->parent_si->seg_id,
+			  pebc->peb_index, err);
+	}
+
+finish_start_thread:
+	mutex_unlock(&pebc->thread_lock);
+
+	return err;
+}
+
+/*
+ * ssdfs_peb_container_start_blk2off_init() - start deferred offset table init
+ * @pebc: pointer on PEB container
+ *
+ * This method adds the deferred request of offset translation
+ * table initialization into the read queue of PEB container
+ * if the initialization has been deferred during the container's
+ * creation. The request is added only once.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - unable to allocate the request.
+ */
+int ssdfs_peb_container_start_blk2off_init(struct ssdfs_peb_container *pebc)
+{
+	struct ssdfs_segment_request *req;
+	int command;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebc || !pebc->parent_si);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (atomic_read(&pebc->deferred_blk2off_cmd) == SSDFS_UNKNOWN_CMD)
+		return 0;
+
+	command = atomic_xchg(&pebc->deferred_blk2off_cmd, SSDFS_UNKNOWN_CMD);
+	if (command == SSDFS_UNKNOWN_CMD)
+		return 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("start deferred offset table init: "
+		  "seg %llu, peb_index %u, command %#x\n",
+		  pebc->parent_si->seg_id,
+		  pebc->peb_index, command);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	req = ssdfs_request_alloc();
+	if (IS_ERR_OR_NULL(req)) {
+		err = (req == NULL ? -ENOMEM : PTR_ERR(req));
+		SSDFS_ERR("fail to allocate segment request: err %d\n",
+			  err);
+		atomic_set(&pebc->deferred_blk2off_cmd, command);
+		return err;
+	}
+
+	ssdfs_request_init(req);
+	ssdfs_get_request(req);
+	ssdfs_request_prepare_internal_data(SSDFS_PEB_READ_REQ,
+					    command,
+					    SSDFS_REQ_ASYNC,
+					    req);
+	ssdfs_request_define_segment(pebc->parent_si->seg_id, req);
+	ssdfs_peb_read_request_cno(pebc);
+	ssdfs_requests_queue_add_tail(&pebc->read_rq, req);
+
+	wake_up_all(&pebc->parent_si->wait_queue[SSDFS_PEB_READ_THREAD]);
+
+	return 0;
+}
+
 /*
  * ssdfs_peb_container_create_destination() - create destination
  * @ptr: pointer on PEB container
@@ -3494,7 +3858,7 @@ int ssdfs_peb_container_create_destination(struct ssdfs_peb_container *ptr)
 	fsi = ptr->parent_si->fsi;
 	si = ptr->parent_si;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	migration_threshold = fsi->migration_threshold;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -4562,7 +4926,7 @@ ssdfs_get_current_peb_locked(struct ssdfs_peb_container *pebc)
 try_get_current_peb:
 	switch (atomic_read(&pebc->migration_state)) {
 	case SSDFS_PEB_NOT_MIGRATING:
-		down_read(&pebc->lock);
+		SSDFS_DOWN_READ(pebc, &pebc->lock);
 		pebi = pebc->src_peb;
 		if (!pebi) {
 			err = -ERANGE;
@@ -4575,7 +4939,7 @@ try_get_current_peb:
 		break;
 
 	case SSDFS_PEB_UNDER_MIGRATION:
-		down_read(&pebc->lock);
+		SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 		pebi = pebc->src_peb;
 		if (!pebi) {
@@ -4925,7 +5289,7 @@ int ssdfs_peb_container_invalidate_block(struct ssdfs_peb_container *pebc,
 	peb_page = le16_to_cpu(desc->page_desc.peb_page);
 	peb_migration_id = desc->blk_state.peb_migration_id;
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	items_state = atomic_read(&pebc->items_state);
 	switch (items_state) {
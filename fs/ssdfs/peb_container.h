@@ -22,6 +22,8 @@
 #ifndef _SSDFS_PEB_CONTAINER_H
 #define _SSDFS_PEB_CONTAINER_H
 
+#include <linux/workqueue.h>
+
 #include "block_bitmap.h"
 #include "peb.h"
 
@@ -70,12 +72,36 @@ enum {
 	SSDFS_PEB_MIGRATION_PHASE_MAX
 };
 
+/*
+ * struct ssdfs_peb_io_stats - I/O statistics of PEB container
+ * @read_latency: histogram of read requests' service time
+ * @flush_latency: histogram of flush requests' service time
+ * @log_commits: number of committed logs
+ * @written_bytes: number of bytes written by logs' flush
+ *
+ * The bucket N of histogram counts the requests with service
+ * time in the [2^N, 2^(N+1)) microseconds range (the first bucket
+ * includes zero). The counters are updated by PEB's threads only.
+ */
+struct ssdfs_peb_io_stats {
+#define SSDFS_PEB_LATENCY_BUCKETS	(20)
+	atomic64_t read_latency[SSDFS_PEB_LATENCY_BUCKETS];
+	atomic64_t flush_latency[SSDFS_PEB_LATENCY_BUCKETS];
+	atomic64_t log_commits;
+	atomic64_t written_bytes;
+};
+
 /*
  * struct ssdfs_peb_container - PEB container
  * @peb_type: type of PEB
  * @peb_index: index of PEB in the array
  * @log_pages: count of pages in full log
  * @threads: PEB container's threads array
+ * @thread_lock: lock of deferred threads' startup
+ * @deferred_blk2off_cmd: deferred command of offset table initialization
+ * @read_work: work item of read requests processing
+ * @read_work_timeout: timeout of read work's idle rescheduling
+ * @read_work_started: read work has been started
  * @read_rq: read requests queue
  * @update_rq: update requests queue
  * @crq_ptr_lock: lock of pointer on create requests queue
@@ -93,6 +119,7 @@ enum {
  * @dst_peb: pointer on destination PEB
  * @dst_peb_refs: reference counter of destination PEB (sharing counter)
  * @items: buffers for PEB objects
+ * @io_stats: I/O statistics of PEB container
  * @peb_kobj: /sys/fs/ssdfs/<device>/<segN>/<pebN> kernel object
  * @peb_kobj_unregister: completion state for <pebN> kernel object
  */
@@ -104,6 +131,15 @@ struct ssdfs_peb_container {
 
 	/* PEB container's threads */
 	struct ssdfs_thread_info thread[SSDFS_PEB_THREAD_TYPE_MAX];
+	struct mutex thread_lock;
+	atomic_t deferred_blk2off_cmd;
+
+#ifdef CONFIG_SSDFS_PEB_READ_WORKQUEUE
+	/* Read requests processing on shared workqueue */
+	struct delayed_work read_work;
+	u64 read_work_timeout;
+	bool read_work_started;
+#endif /* CONFIG_SSDFS_PEB_READ_WORKQUEUE */
 
 	/* Read requests queue */
 	struct ssdfs_requests_queue read_rq;
@@ -139,6 +175,9 @@ struct ssdfs_peb_container {
 	atomic_t dst_peb_refs;
 	struct ssdfs_peb_info items[SSDFS_SEG_PEB_ITEMS_MAX];
 
+	/* I/O statistics */
+	struct ssdfs_peb_io_stats io_stats;
+
 	/* /sys/fs/ssdfs/<device>/<segN>/<pebN> */
 	struct kobject peb_kobj;
 	struct completion peb_kobj_unregister;
@@ -201,6 +240,45 @@ bool have_flush_requests(struct ssdfs_peb_container *pebc)
 	return !is_create_rq_empty || !is_update_rq_empty;
 }
 
+/*
+ * ssdfs_peb_start_request_service() - remember start of request's service
+ * @req: request
+ */
+static inline
+void ssdfs_peb_start_request_service(struct ssdfs_segment_request *req)
+{
+	req->private.service_start = ktime_get();
+}
+
+/*
+ * ssdfs_peb_account_request_service() - account request's service time
+ * @histogram: latency histogram
+ * @req: request
+ *
+ * The request that hasn't been taken from a queue by PEB's thread
+ * (for example, processed by the caller's thread) is not accounted.
+ */
+static inline
+void ssdfs_peb_account_request_service(atomic64_t *histogram,
+					struct ssdfs_segment_request *req)
+{
+	s64 usecs;
+	int bucket = 0;
+
+	if (req->private.service_start == 0)
+		return;
+
+	usecs = ktime_us_delta(ktime_get(), req->private.service_start);
+	req->private.service_start = 0;
+
+	if (usecs > 1) {
+		bucket = ilog2(usecs);
+		bucket = min_t(int, bucket, SSDFS_PEB_LATENCY_BUCKETS - 1);
+	}
+
+	atomic64_inc(&histogram[bucket]);
+}
+
 static inline
 bool is_ssdfs_peb_containing_user_data(struct ssdfs_peb_container *pebc)
 {
@@ -235,6 +313,8 @@ struct ssdfs_peb_info *
 ssdfs_get_peb_for_migration_id(struct ssdfs_peb_container *pebc,
 			       u8 migration_id);
 
+int ssdfs_peb_container_start_flush_thread(struct ssdfs_peb_container *pebc);
+int ssdfs_peb_container_start_blk2off_init(struct ssdfs_peb_container *pebc);
 int ssdfs_peb_container_create_destination(struct ssdfs_peb_container *ptr);
 int ssdfs_peb_container_forget_source(struct ssdfs_peb_container *pebc);
 int ssdfs_peb_container_forget_relation(struct ssdfs_peb_container *pebc);
@@ -245,6 +325,23 @@ int ssdfs_peb_container_change_state(struct ssdfs_peb_container *pebc);
  */
 int ssdfs_peb_gc_thread_func(void *data);
 int ssdfs_peb_read_thread_func(void *data);
+#ifdef CONFIG_SSDFS_PEB_READ_WORKQUEUE
+int ssdfs_peb_read_workqueue_init(void);
+void ssdfs_peb_read_workqueue_exit(void);
+int ssdfs_peb_start_read_work(struct ssdfs_peb_container *pebc);
+int ssdfs_peb_stop_read_work(struct ssdfs_peb_container *pebc);
+#else
+static inline
+int ssdfs_peb_read_workqueue_init(void)
+{
+	return 0;
+}
+
+static inline
+void ssdfs_peb_read_workqueue_exit(void)
+{
+}
+#endif /* CONFIG_SSDFS_PEB_READ_WORKQUEUE */
 int ssdfs_peb_flush_thread_func(void *data);
 
 u16 ssdfs_peb_estimate_reserved_metapages(u32 page_size, u32 pages_per_peb,
@@ -256,6 +353,8 @@ int ssdfs_peb_read_page(struct ssdfs_peb_container *pebc,
 int ssdfs_peb_readahead_pages(struct ssdfs_peb_container *pebc,
 			      struct ssdfs_segment_request *req,
 			      struct completion **end);
+int ssdfs_peb_read_page_by_current_thread(struct ssdfs_peb_container *pebc,
+					  struct ssdfs_segment_request *req);
 void ssdfs_peb_mark_request_block_uptodate(struct ssdfs_peb_container *pebc,
 					   struct ssdfs_segment_request *req,
 					   int blk_index);
@@ -27,6 +27,7 @@
 #include <linux/kthread.h>
 #include <linux/pagevec.h>
 #include <linux/delay.h>
+#include <linux/blkdev.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -50,6 +51,7 @@
 #include "extents_tree.h"
 #include "diff_on_write.h"
 #include "invalidated_extents_tree.h"
+#include "segment_tree.h"
 
 #include <trace/events/ssdfs.h>
 
@@ -224,6 +226,20 @@ struct ssdfs_pagevec_descriptor {
 	u32 *write_offset;
 };
 
+#define SSDFS_LOG_WRITE_CHUNKS_MAX		(8)
+
+/*
+ * struct ssdfs_log_write_chunk - written chunk of the log
+ * @pvec: pages of the chunk
+ * @index: index of the first page of the chunk in the PEB's cache
+ * @written_pages: number of written pages
+ */
+struct ssdfs_log_write_chunk {
+	struct pagevec pvec;
+	pgoff_t index;
+	pgoff_t written_pages;
+};
+
 /******************************************************************************
  *                         FLUSH THREAD FUNCTIONALITY                         *
  ******************************************************************************/
@@ -892,6 +908,97 @@ int is_log_partial(struct ssdfs_peb_info *pebi)
 	return SSDFS_CONTINUE_PARTIAL_LOG;
 }
 
+/*
+ * ssdfs_peb_account_log_workload() - account committed log in workload
+ * @pebi: pointer on PEB object
+ * @log_strategy: strategy of committed log
+ *
+ * This function takes into account the way of user data log's
+ * finishing. The log that has been filled completely increases
+ * the streaming score. The partial log that has been committed
+ * prematurely (for example, by sync request) decreases the score.
+ */
+static inline
+void ssdfs_peb_account_log_workload(struct ssdfs_peb_info *pebi,
+				    int log_strategy)
+{
+	struct ssdfs_segment_info *si = pebi->pebc->parent_si;
+	atomic_t *score = &si->fsi->data_log_stream_score;
+
+	if (si->seg_type != SSDFS_USER_DATA_SEG_TYPE)
+		return;
+
+	switch (log_strategy) {
+	case SSDFS_FINISH_PARTIAL_LOG:
+	case SSDFS_FINISH_FULL_LOG:
+		atomic_add_unless(score, 1, SSDFS_LOG_STREAM_SCORE_MAX);
+		break;
+
+	case SSDFS_START_PARTIAL_LOG:
+	case SSDFS_CONTINUE_PARTIAL_LOG:
+		atomic_add_unless(score, -1, -SSDFS_LOG_STREAM_SCORE_MAX);
+		break;
+
+	default:
+		/* do nothing */
+		break;
+	}
+}
+
+/*
+ * ssdfs_peb_adapt_log_pages() - define log size for the clean PEB
+ * @pebi: pointer on PEB object
+ *
+ * This function chooses the size of logs in the clean PEB
+ * on the basis of observed user data workload. Streaming
+ * workload receives larger logs that amortize the cost of
+ * segment header and reserved metadata. Otherwise, the PEB
+ * keeps the default log size of the segment, and sync writes
+ * are served by partial logs. The chosen size is stored in
+ * the segment header of every log. It means that the recovery
+ * logic retrieves the log size from the first log of the PEB.
+ */
+static
+void ssdfs_peb_adapt_log_pages(struct ssdfs_peb_info *pebi)
+{
+	struct ssdfs_segment_info *si = pebi->pebc->parent_si;
+	struct ssdfs_fs_info *fsi = si->fsi;
+	struct ssdfs_peb_log *log = &pebi->current_log;
+	u32 log_pages = pebi->pebc->log_pages;
+	u32 growth = 1;
+	int threshold = SSDFS_LOG_STREAM_SCORE_THRESHOLD;
+	int score;
+
+	if (si->seg_type != SSDFS_USER_DATA_SEG_TYPE)
+		return;
+
+	score = atomic_read(&fsi->data_log_stream_score);
+
+	while (growth < SSDFS_LOG_PAGES_GROWTH_MAX && score >= threshold) {
+		u32 candidate = log_pages * 2;
+
+		if (candidate > fsi->pages_per_peb || candidate > U16_MAX)
+			break;
+
+		if (fsi->pages_per_peb % candidate)
+			break;
+
+		log_pages = candidate;
+		growth *= 2;
+		threshold *= 4;
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("seg %llu, peb %llu, score %d, "
+		  "old log_pages %u, new log_pages %u\n",
+		  si->seg_id, pebi->peb_id, score,
+		  pebi->log_pages, log_pages);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	pebi->log_pages = log_pages;
+	log->free_data_pages = log_pages;
+}
+
 /*
  * ssdfs_peb_create_log() - create new log
  * @pebi: pointer on PEB object
@@ -978,6 +1085,13 @@ int ssdfs_peb_create_log(struct ssdfs_peb_info *pebi)
 		goto finish_log_create;
 	}
 
+	if (log->start_page == 0 &&
+	    atomic_read(&log->sequence_id) == 0 &&
+	    log->free_data_pages == pebi->log_pages) {
+		/* the first log of the clean PEB */
+		ssdfs_peb_adapt_log_pages(pebi);
+	}
+
 	log_strategy = is_log_partial(pebi);
 
 	switch (log_strategy) {
@@ -1088,6 +1202,9 @@ int ssdfs_peb_create_log(struct ssdfs_peb_info *pebi)
 	log->blk2off_tbl.reserved_offset = U32_MAX;
 	log->blk2off_tbl.compressed_offset = blk2off_tbl_hdr_size;
 
+	/* result of uncommitted log's compression is useless */
+	ssdfs_peb_compr_job_wait(&log->blk_desc_compr);
+
 	for (i = 0; i < SSDFS_LOG_AREA_MAX; i++) {
 		struct ssdfs_peb_area *area;
 		struct ssdfs_page_array *area_pages;
@@ -1445,6 +1562,86 @@ int ssdfs_peb_grow_log_area(struct ssdfs_peb_info *pebi, int area_type,
 	return 0;
 }
 
+/*
+ * ssdfs_peb_init_fragment_desc() - initialize fragment descriptor
+ * @from: fragment source descriptor
+ * @to: fragment destination descriptor [in|out]
+ *
+ * This function initializes fragment descriptor of stored fragment.
+ * It expects that checksum and compressed size have been defined.
+ */
+static inline
+void ssdfs_peb_init_fragment_desc(struct ssdfs_fragment_source *from,
+				  struct ssdfs_fragment_destination *to)
+{
+	BUG_ON(to->area_offset > to->write_offset);
+	to->desc->offset = cpu_to_le32(to->write_offset - to->area_offset);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	WARN_ON(to->compr_size > U16_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+	to->desc->compr_size = cpu_to_le16((u16)to->compr_size);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	WARN_ON(from->data_bytes > U16_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+	to->desc->uncompr_size = cpu_to_le16((u16)from->data_bytes);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	WARN_ON(from->sequence_id >= U8_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+	to->desc->sequence_id = from->sequence_id;
+	to->desc->magic = SSDFS_FRAGMENT_DESC_MAGIC;
+	to->desc->type = from->fragment_type;
+	to->desc->flags = from->fragment_flags;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("offset %u, compr_size %u, "
+		  "uncompr_size %u, checksum %#x\n",
+		  to->desc->offset,
+		  to->desc->compr_size,
+		  to->desc->uncompr_size,
+		  le32_to_cpu(to->desc->checksum));
+#endif /* CONFIG_SSDFS_DEBUG */
+}
+
+/*
+ * ssdfs_peb_prepare_uncompr_fragment() - prepare uncompressed fragment
+ * @from: fragment source descriptor
+ * @to: fragment destination descriptor [in|out]
+ *
+ * This function calculates the checksum of uncompressed fragment
+ * and initializes the fragment descriptor. The fragment's content
+ * is not copied by this function.
+ */
+static
+void ssdfs_peb_prepare_uncompr_fragment(struct ssdfs_fragment_source *from,
+					struct ssdfs_fragment_destination *to)
+{
+	unsigned char *src;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!from || !to);
+	BUG_ON(!from->page || !to->desc);
+	BUG_ON((from->start_offset + from->data_bytes) > PAGE_SIZE);
+	BUG_ON(from->fragment_type != SSDFS_FRAGMENT_UNCOMPR_BLOB);
+
+	SSDFS_DBG("page %p, start_offset %u, data_bytes %zu, "
+		  "sequence_id %u, write_offset %u\n",
+		  from->page, from->start_offset, from->data_bytes,
+		  from->sequence_id, to->write_offset);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	src = kmap_local_page(from->page);
+	to->desc->checksum = ssdfs_crc32_le(src + from->start_offset,
+					    from->data_bytes);
+	kunmap_local(src);
+
+	to->compr_size = from->data_bytes;
+
+	ssdfs_peb_init_fragment_desc(from, to);
+}
+
 /*
  * ssdfs_peb_store_fragment() - store fragment into page cache
  * @from: fragment source descriptor
@@ -1504,6 +1701,12 @@ int ssdfs_peb_store_fragment(struct ssdfs_fragment_source *from,
 	case SSDFS_FRAGMENT_LZO_BLOB:
 		compr_type = SSDFS_COMPR_LZO;
 		break;
+	case SSDFS_FRAGMENT_ZSTD_BLOB:
+		compr_type = SSDFS_COMPR_ZSTD;
+		break;
+	case SSDFS_FRAGMENT_LZ4_BLOB:
+		compr_type = SSDFS_COMPR_LZ4;
+		break;
 	default:
 		BUG();
 	};
@@ -1547,35 +1750,7 @@ int ssdfs_peb_store_fragment(struct ssdfs_fragment_source *from,
 		return err;
 	}
 
-	BUG_ON(to->area_offset > to->write_offset);
-	to->desc->offset = cpu_to_le32(to->write_offset - to->area_offset);
-
-#ifdef CONFIG_SSDFS_DEBUG
-	WARN_ON(to->compr_size > U16_MAX);
-#endif /* CONFIG_SSDFS_DEBUG */
-	to->desc->compr_size = cpu_to_le16((u16)to->compr_size);
-
-#ifdef CONFIG_SSDFS_DEBUG
-	WARN_ON(from->data_bytes > U16_MAX);
-#endif /* CONFIG_SSDFS_DEBUG */
-	to->desc->uncompr_size = cpu_to_le16((u16)from->data_bytes);
-
-#ifdef CONFIG_SSDFS_DEBUG
-	WARN_ON(from->sequence_id >= U8_MAX);
-#endif /* CONFIG_SSDFS_DEBUG */
-	to->desc->sequence_id = from->sequence_id;
-	to->desc->magic = SSDFS_FRAGMENT_DESC_MAGIC;
-	to->desc->type = from->fragment_type;
-	to->desc->flags = from->fragment_flags;
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("offset %u, compr_size %u, "
-		  "uncompr_size %u, checksum %#x\n",
-		  to->desc->offset,
-		  to->desc->compr_size,
-		  to->desc->uncompr_size,
-		  le32_to_cpu(to->desc->checksum));
-#endif /* CONFIG_SSDFS_DEBUG */
+	ssdfs_peb_init_fragment_desc(from, to);
 
 	return 0;
 }
@@ -1662,6 +1837,20 @@ int ssdfs_peb_store_data_block_fragment(struct ssdfs_peb_info *pebi,
 
 	to.area_offset = 0;
 	to.write_offset = write_offset;
+	to.free_space = PAGE_SIZE;
+	to.compr_size = 0;
+	to.desc = desc;
+
+	if (from->fragment_type == SSDFS_FRAGMENT_UNCOMPR_BLOB) {
+		/*
+		 * Uncompressed fragment is copied directly from
+		 * the source page into the area's pages. It doesn't
+		 * need in intermediate buffer.
+		 */
+		to.store = NULL;
+		ssdfs_peb_prepare_uncompr_fragment(from, &to);
+		goto store_fragment_into_area;
+	}
 
 	to.store = ssdfs_flush_kzalloc(PAGE_SIZE, GFP_KERNEL);
 	if (!to.store) {
@@ -1669,10 +1858,6 @@ int ssdfs_peb_store_data_block_fragment(struct ssdfs_peb_info *pebi,
 		return -ENOMEM;
 	}
 
-	to.free_space = PAGE_SIZE;
-	to.compr_size = 0;
-	to.desc = desc;
-
 	err = ssdfs_peb_store_fragment(from, &to);
 	if (err == -EAGAIN) {
 #ifdef CONFIG_SSDFS_DEBUG
@@ -1688,6 +1873,7 @@ int ssdfs_peb_store_data_block_fragment(struct ssdfs_peb_info *pebi,
 		goto free_compr_buffer;
 	}
 
+store_fragment_into_area:
 	BUG_ON(to.compr_size == 0);
 
 	do {
@@ -1740,11 +1926,21 @@ int ssdfs_peb_store_data_block_fragment(struct ssdfs_peb_info *pebi,
 		size = PAGE_SIZE - offset;
 		size = min_t(u32, size, to.compr_size - written_bytes);
 
-		err = ssdfs_memcpy_to_page(page,
-					   offset, PAGE_SIZE,
-					   to.store,
-					   written_bytes, to.free_space,
-					   size);
+		if (to.store) {
+			err = ssdfs_memcpy_to_page(page,
+						   offset, PAGE_SIZE,
+						   to.store,
+						   written_bytes, to.free_space,
+						   size);
+		} else {
+			err = ssdfs_memcpy_page(page, offset, PAGE_SIZE,
+						from->page,
+						from->start_offset +
+							written_bytes,
+						PAGE_SIZE,
+						size);
+		}
+
 		if (unlikely(err)) {
 			SSDFS_ERR("failt to copy: err %d\n", err);
 			goto finish_copy;
@@ -3065,10 +3261,43 @@ int ssdfs_peb_define_area_offset(struct ssdfs_peb_info *pebi,
 	return 0;
 }
 
+/*
+ * ssdfs_request_owner_inode() - get owner inode of user data request
+ * @req: segment request
+ *
+ * RETURN: pointer on inode or NULL (pages aren't in page cache).
+ */
+static inline
+struct ssdfs_inode_info *
+ssdfs_request_owner_inode(struct ssdfs_segment_request *req)
+{
+	struct page *page;
+
+	if (pagevec_count(&req->result.pvec) == 0)
+		return NULL;
+
+	page = req->result.pvec.pages[0];
+	if (!page || !page->mapping || !page->mapping->host)
+		return NULL;
+
+	return SSDFS_I(page->mapping->host);
+}
+
+/*
+ * ssdfs_prepare_user_data_options() - define compression of user data
+ * @fsi: pointer on shared file system object
+ * @req: segment request
+ * @compression: compression type [out]
+ *
+ * The compression policy of the owner inode has priority.
+ * The default policy follows the user data options of the volume.
+ */
 static inline
 void ssdfs_prepare_user_data_options(struct ssdfs_fs_info *fsi,
+				     struct ssdfs_segment_request *req,
 				     u8 *compression)
 {
+	struct ssdfs_inode_info *ii;
 	u16 flags;
 	u8 type;
 
@@ -3077,6 +3306,35 @@ void ssdfs_prepare_user_data_options(struct ssdfs_fs_info *fsi,
 
 	*compression = SSDFS_FRAGMENT_UNCOMPR_BLOB;
 
+	ii = ssdfs_request_owner_inode(req);
+	if (ii) {
+		switch (ssdfs_inode_compr_policy(ii)) {
+		case SSDFS_COMPR_POLICY_NONE:
+			*compression = SSDFS_FRAGMENT_UNCOMPR_BLOB;
+			return;
+
+		case SSDFS_COMPR_POLICY_ZLIB:
+			*compression = SSDFS_FRAGMENT_ZLIB_BLOB;
+			return;
+
+		case SSDFS_COMPR_POLICY_LZO:
+			*compression = SSDFS_FRAGMENT_LZO_BLOB;
+			return;
+
+		case SSDFS_COMPR_POLICY_ZSTD:
+			*compression = SSDFS_FRAGMENT_ZSTD_BLOB;
+			return;
+
+		case SSDFS_COMPR_POLICY_LZ4:
+			*compression = SSDFS_FRAGMENT_LZ4_BLOB;
+			return;
+
+		default:
+			/* follow volume's options */
+			break;
+		}
+	}
+
 	if (flags & SSDFS_USER_DATA_MAKE_COMPRESSION) {
 		switch (type) {
 		case SSDFS_USER_DATA_NOCOMPR_TYPE:
@@ -3090,10 +3348,68 @@ void ssdfs_prepare_user_data_options(struct ssdfs_fs_info *fsi,
 		case SSDFS_USER_DATA_LZO_COMPR_TYPE:
 			*compression = SSDFS_FRAGMENT_LZO_BLOB;
 			break;
+
+		case SSDFS_USER_DATA_ZSTD_COMPR_TYPE:
+			*compression = SSDFS_FRAGMENT_ZSTD_BLOB;
+			break;
+
+		case SSDFS_USER_DATA_LZ4_COMPR_TYPE:
+			*compression = SSDFS_FRAGMENT_LZ4_BLOB;
+			break;
 		}
 	}
 }
 
+/*
+ * ssdfs_prepare_btree_node_options() - define compression of b-tree node
+ * @fsi: pointer on shared file system object
+ * @compression: compression type [out]
+ *
+ * Leaf and hybrid nodes of dentries, extents and xattrs trees
+ * contain names and repetitive extent runs that compress well.
+ * The compression of the nodes' content is enabled by mount option.
+ * The fragments are decompressed transparently by read path.
+ */
+static inline
+void ssdfs_prepare_btree_node_options(struct ssdfs_fs_info *fsi,
+				      u8 *compression)
+{
+	*compression = SSDFS_FRAGMENT_UNCOMPR_BLOB;
+
+	if (!ssdfs_test_opt(fsi->mount_opts, COMPR_BTREE_NODES))
+		return;
+
+	if (ssdfs_test_opt(fsi->mount_opts, COMPR_MODE_NONE))
+		return;
+
+#if defined(CONFIG_SSDFS_ZLIB)
+	if (ssdfs_test_opt(fsi->mount_opts, COMPR_MODE_ZLIB)) {
+		*compression = SSDFS_FRAGMENT_ZLIB_BLOB;
+		return;
+	}
+#endif /* CONFIG_SSDFS_ZLIB */
+
+#if defined(CONFIG_SSDFS_ZSTD)
+	if (ssdfs_test_opt(fsi->mount_opts, COMPR_MODE_ZSTD)) {
+		*compression = SSDFS_FRAGMENT_ZSTD_BLOB;
+		return;
+	}
+#endif /* CONFIG_SSDFS_ZSTD */
+
+#if defined(CONFIG_SSDFS_LZ4)
+	if (ssdfs_test_opt(fsi->mount_opts, COMPR_MODE_LZ4)) {
+		*compression = SSDFS_FRAGMENT_LZ4_BLOB;
+		return;
+	}
+#endif /* CONFIG_SSDFS_LZ4 */
+
+#if defined(CONFIG_SSDFS_LZO)
+	*compression = SSDFS_FRAGMENT_LZO_BLOB;
+#elif defined(CONFIG_SSDFS_ZLIB)
+	*compression = SSDFS_FRAGMENT_ZLIB_BLOB;
+#endif
+}
+
 /*
  * ssdfs_peb_store_fragment_in_area() - try to store fragment into area
  * @pebi: pointer on PEB object
@@ -3160,7 +3476,17 @@ int ssdfs_peb_store_fragment_in_area(struct ssdfs_peb_info *pebi,
 		return err;
 	}
 
-	ssdfs_prepare_user_data_options(fsi, &compression_type);
+	switch (pebi->pebc->parent_si->seg_type) {
+	case SSDFS_LEAF_NODE_SEG_TYPE:
+	case SSDFS_HYBRID_NODE_SEG_TYPE:
+		ssdfs_prepare_btree_node_options(fsi, &compression_type);
+		break;
+
+	default:
+		ssdfs_prepare_user_data_options(fsi, req,
+						&compression_type);
+		break;
+	}
 
 	switch (compression_type) {
 	case SSDFS_FRAGMENT_UNCOMPR_BLOB:
@@ -3189,6 +3515,28 @@ int ssdfs_peb_store_fragment_in_area(struct ssdfs_peb_info *pebi,
 #endif
 		break;
 
+	case SSDFS_FRAGMENT_ZSTD_BLOB:
+#if defined(CONFIG_SSDFS_ZSTD)
+		estimated_compr_size =
+			ssdfs_peb_estimate_data_fragment_size(data_bytes);
+#else
+		compression_type = SSDFS_FRAGMENT_UNCOMPR_BLOB;
+		estimated_compr_size = data_bytes;
+		SSDFS_WARN("ZSTD compression is not supported\n");
+#endif
+		break;
+
+	case SSDFS_FRAGMENT_LZ4_BLOB:
+#if defined(CONFIG_SSDFS_LZ4)
+		estimated_compr_size =
+			ssdfs_peb_estimate_data_fragment_size(data_bytes);
+#else
+		compression_type = SSDFS_FRAGMENT_UNCOMPR_BLOB;
+		estimated_compr_size = data_bytes;
+		SSDFS_WARN("LZ4 compression is not supported\n");
+#endif
+		break;
+
 	default:
 		BUG();
 	}
@@ -3474,12 +3822,18 @@ bool is_ssdfs_block_full(u32 pagesize, u32 data_size)
  * @page_count: count of pages in the portion
  * @bytes_count: bytes number in the portion
  * @req: segment request
+ *
+ * If the inode's data has been found incompressible recently, then
+ * the check is skipped for the next SSDFS_INCOMPRESSIBLE_BACKOFF
+ * requests of the inode.
  */
 static
 bool can_ssdfs_pagevec_be_compressed(u32 start_page, u32 page_count,
 				     u32 bytes_count,
 				     struct ssdfs_segment_request *req)
 {
+	struct ssdfs_inode_info *ii;
+	bool can_be_compressed;
 	struct page *page;
 	int page_index;
 	u32 start_offset;
@@ -3496,6 +3850,18 @@ bool can_ssdfs_pagevec_be_compressed(u32 start_page, u32 page_count,
 		  start_page, page_count, bytes_count);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	ii = ssdfs_request_owner_inode(req);
+	if (ii && ssdfs_inode_compr_policy(ii) == SSDFS_COMPR_POLICY_NONE)
+		return false;
+
+	if (ii && atomic_dec_if_positive(&ii->compr_backoff) >= 0) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("ino %llu: incompressible data backoff\n",
+			  req->extent.ino);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return false;
+	}
+
 	for (i = 0; i < page_count; i++) {
 		int state;
 
@@ -3529,7 +3895,12 @@ bool can_ssdfs_pagevec_be_compressed(u32 start_page, u32 page_count,
 		tested_bytes += portion_size;
 	}
 
-	return can_compress[true] >= can_compress[false];
+	can_be_compressed = can_compress[true] >= can_compress[false];
+
+	if (ii && !can_be_compressed)
+		atomic_set(&ii->compr_backoff, SSDFS_INCOMPRESSIBLE_BACKOFF);
+
+	return can_be_compressed;
 }
 
 /*
@@ -4408,12 +4779,263 @@ finish_copy:
 	area->write_offset = *write_offset + blk_desc_size;
 
 #ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("area->write_offset %u, write_offset %u\n",
-		  area->write_offset, *write_offset);
+	SSDFS_DBG("area->write_offset %u, write_offset %u\n",
+		  area->write_offset, *write_offset);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (is_buffer_full)
+		return -E2BIG;
+
+	return 0;
+}
+
+/*
+ * ssdfs_peb_blk_desc_compr_type() - get compression type of blk desc area
+ * @fsi: pointer on shared file system object
+ */
+static inline
+u8 ssdfs_peb_blk_desc_compr_type(struct ssdfs_fs_info *fsi)
+{
+	switch (fsi->metadata_options.blk2off_tbl.compression) {
+	case SSDFS_BLK2OFF_TBL_NOCOMPR_TYPE:
+		return SSDFS_COMPR_NONE;
+	case SSDFS_BLK2OFF_TBL_ZLIB_COMPR_TYPE:
+		return SSDFS_COMPR_ZLIB;
+	case SSDFS_BLK2OFF_TBL_LZO_COMPR_TYPE:
+		return SSDFS_COMPR_LZO;
+	default:
+		BUG();
+	}
+
+	return SSDFS_COMPR_NONE;
+}
+
+/*
+ * ssdfs_peb_blk_desc_compr_work_fn() - compress blk desc fragment
+ * @work: work item of compression
+ */
+static
+void ssdfs_peb_blk_desc_compr_work_fn(struct work_struct *work)
+{
+	struct ssdfs_peb_compr_job *job;
+	size_t uncompr_size;
+
+	job = container_of(work, struct ssdfs_peb_compr_job, work);
+	uncompr_size = job->uncompr_size;
+	job->compr_size = PAGE_SIZE;
+
+	job->err = ssdfs_compress(job->compr_type,
+				  job->uncompr_buf, job->compr_buf,
+				  &uncompr_size, &job->compr_size);
+
+	complete(&job->done);
+}
+
+/*
+ * can_blk_desc_compression_be_deferred() - check deferred compression
+ * @pebi: pointer on PEB object
+ */
+static inline
+bool can_blk_desc_compression_be_deferred(struct ssdfs_peb_info *pebi)
+{
+	struct ssdfs_fs_info *fsi = pebi->pebc->parent_si->fsi;
+	int area_type = SSDFS_LOG_BLK_DESC_AREA;
+	struct ssdfs_peb_temp_buffer *buf;
+	struct ssdfs_peb_compr_job *job;
+
+	buf = &pebi->current_log.area[area_type].metadata.area.blk_desc.flush_buf;
+	job = &pebi->current_log.blk_desc_compr;
+
+	if (ssdfs_peb_blk_desc_compr_type(fsi) == SSDFS_COMPR_NONE)
+		return false;
+
+	if (!job->uncompr_buf || !job->compr_buf)
+		return false;
+
+	return job->uncompr_buf_size >= buf->size;
+}
+
+/*
+ * ssdfs_peb_defer_blk_desc_compression() - queue blk desc fragment compression
+ * @pebi: pointer on PEB object
+ * @meta_desc: fragment descriptor
+ * @uncompr_size: size of uncompressed fragment
+ *
+ * This function exchanges the full flush buffer of block descriptors
+ * with the spare one and queues the compression of the fragment
+ * into the workqueue. The flush thread continues to prepare the log
+ * in parallel with compression. The result has to be joined by
+ * ssdfs_peb_join_blk_desc_compression() before the next fragment
+ * compression or the storing of area's block table.
+ */
+static
+void ssdfs_peb_defer_blk_desc_compression(struct ssdfs_peb_info *pebi,
+					struct ssdfs_fragment_desc *meta_desc,
+					size_t uncompr_size)
+{
+	struct ssdfs_fs_info *fsi = pebi->pebc->parent_si->fsi;
+	int area_type = SSDFS_LOG_BLK_DESC_AREA;
+	struct ssdfs_peb_area *area;
+	struct ssdfs_peb_temp_buffer *buf;
+	struct ssdfs_peb_compr_job *job;
+	void *full_buf;
+	size_t full_buf_size;
+
+	area = &pebi->current_log.area[area_type];
+	buf = &area->metadata.area.blk_desc.flush_buf;
+	job = &pebi->current_log.blk_desc_compr;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(job->is_pending);
+	BUG_ON(uncompr_size > buf->size);
+
+	SSDFS_DBG("seg %llu, peb %llu, uncompr_size %zu\n",
+		  pebi->pebc->parent_si->seg_id,
+		  pebi->peb_id, uncompr_size);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	full_buf = buf->ptr;
+	full_buf_size = buf->size;
+
+	buf->ptr = job->uncompr_buf;
+	buf->size = job->uncompr_buf_size;
+	memset(buf->ptr, 0, buf->size);
+	buf->write_offset = 0;
+
+	job->uncompr_buf = full_buf;
+	job->uncompr_buf_size = full_buf_size;
+	job->uncompr_size = uncompr_size;
+	job->compr_type = ssdfs_peb_blk_desc_compr_type(fsi);
+	job->meta_desc = meta_desc;
+	job->compr_size = 0;
+	job->err = 0;
+	job->is_pending = true;
+
+	reinit_completion(&job->done);
+	INIT_WORK(&job->work, ssdfs_peb_blk_desc_compr_work_fn);
+	ssdfs_queue_compression_work(&job->work);
+}
+
+/*
+ * ssdfs_peb_join_blk_desc_compression() - join deferred compression
+ * @pebi: pointer on PEB object
+ *
+ * This function waits the end of deferred compression of
+ * block descriptors' fragment, stores the compressed fragment
+ * into the area and finalizes the fragment's descriptor.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - internal error.
+ * %-E2BIG      - compressed fragment is too big.
+ */
+static
+int ssdfs_peb_join_blk_desc_compression(struct ssdfs_peb_info *pebi)
+{
+	int area_type = SSDFS_LOG_BLK_DESC_AREA;
+	struct ssdfs_peb_area *area;
+	struct ssdfs_fragments_chain_header *chain_hdr;
+	struct ssdfs_fragment_desc *meta_desc;
+	struct ssdfs_peb_compr_job *job;
+	struct page *page;
+	pgoff_t page_index;
+	u32 offset, page_off;
+	size_t copied = 0;
+	size_t len;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebi);
+	BUG_ON(!is_ssdfs_peb_current_log_locked(pebi));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	area = &pebi->current_log.area[area_type];
+	chain_hdr = &area->metadata.area.blk_desc.table.chain_hdr;
+	job = &pebi->current_log.blk_desc_compr;
+
+	if (!job->is_pending)
+		return 0;
+
+	wait_for_completion(&job->done);
+	job->is_pending = false;
+
+	if (unlikely(job->err)) {
+		SSDFS_ERR("fail to compress fragment: "
+			  "data_bytes %zu, free_space %zu, err %d\n",
+			  job->uncompr_size, job->compr_size, job->err);
+		return job->err;
+	}
+
+	offset = area->compressed_offset;
+
+	while (copied < job->compr_size) {
+		page_index = offset / PAGE_SIZE;
+		page_off = offset % PAGE_SIZE;
+		len = min_t(size_t, PAGE_SIZE - page_off,
+			    job->compr_size - copied);
+
+		page = ssdfs_page_array_grab_page(&area->array, page_index);
+		if (IS_ERR_OR_NULL(page)) {
+			SSDFS_ERR("fail to get page %lu for area %#x\n",
+				  page_index, area_type);
+			return -ERANGE;
+		}
+
+		err = ssdfs_memcpy_to_page(page, page_off, PAGE_SIZE,
+					   job->compr_buf, copied, PAGE_SIZE,
+					   len);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to copy: err %d\n", err);
+		} else {
+			SetPageUptodate(page);
+
+			err = ssdfs_page_array_set_page_dirty(&area->array,
+								page_index);
+			if (unlikely(err)) {
+				SSDFS_ERR("fail to set page %lu dirty: "
+					  "err %d\n",
+					  page_index, err);
+			}
+		}
+
+		ssdfs_unlock_page(page);
+		ssdfs_put_page(page);
+
+		if (unlikely(err))
+			return err;
+
+		copied += len;
+		offset += len;
+	}
+
+	meta_desc = job->meta_desc;
+	meta_desc->offset = cpu_to_le32(area->compressed_offset);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	WARN_ON(job->compr_size > U16_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+	meta_desc->compr_size = cpu_to_le16((u16)job->compr_size);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("offset %u, compr_size %u, "
+		  "uncompr_size %u, checksum %#x\n",
+		  le32_to_cpu(meta_desc->offset),
+		  le16_to_cpu(meta_desc->compr_size),
+		  le16_to_cpu(meta_desc->uncompr_size),
+		  le32_to_cpu(meta_desc->checksum));
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	if (is_buffer_full)
-		return -E2BIG;
+	area->compressed_offset += job->compr_size;
+	le32_add_cpu(&chain_hdr->compr_bytes, job->compr_size);
+
+	/* the next fragment starts after the compressed one */
+	meta_desc = ssdfs_peb_get_area_cur_frag_desc(pebi, area_type);
+	if (!IS_ERR_OR_NULL(meta_desc) && meta_desc != job->meta_desc)
+		meta_desc->offset = cpu_to_le32(area->compressed_offset);
+
+	job->meta_desc = NULL;
 
 	return 0;
 }
@@ -4475,19 +5097,7 @@ int ssdfs_peb_compress_blk_descs_fragment(struct ssdfs_peb_info *pebi,
 		return -ERANGE;
 	}
 
-	switch (fsi->metadata_options.blk2off_tbl.compression) {
-	case SSDFS_BLK2OFF_TBL_NOCOMPR_TYPE:
-		compr_type = SSDFS_COMPR_NONE;
-		break;
-	case SSDFS_BLK2OFF_TBL_ZLIB_COMPR_TYPE:
-		compr_type = SSDFS_COMPR_ZLIB;
-		break;
-	case SSDFS_BLK2OFF_TBL_LZO_COMPR_TYPE:
-		compr_type = SSDFS_COMPR_LZO;
-		break;
-	default:
-		BUG();
-	}
+	compr_type = ssdfs_peb_blk_desc_compr_type(fsi);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!buf->ptr);
@@ -4820,6 +5430,25 @@ int ssdfs_peb_store_compressed_block_descriptor(struct ssdfs_peb_info *pebi,
 			return -ERANGE;
 		}
 
+		err = ssdfs_peb_join_blk_desc_compression(pebi);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to join blk desc compression: "
+				  "err %d\n", err);
+			return err;
+		}
+
+		if (fragments_count < SSDFS_NEXT_BLK_TABLE_INDEX &&
+		    can_blk_desc_compression_be_deferred(pebi)) {
+#ifdef CONFIG_SSDFS_DEBUG
+			WARN_ON(bytes_count > U16_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+			meta_desc->uncompr_size = cpu_to_le16((u16)bytes_count);
+
+			ssdfs_peb_defer_blk_desc_compression(pebi, meta_desc,
+							     bytes_count);
+			goto get_next_fragment_desc;
+		}
+
 		err = ssdfs_peb_compress_blk_descs_fragment(pebi,
 							    bytes_count,
 							    &compr_size);
@@ -4881,6 +5510,7 @@ int ssdfs_peb_store_compressed_block_descriptor(struct ssdfs_peb_info *pebi,
 			}
 		}
 
+get_next_fragment_desc:
 		meta_desc = ssdfs_peb_get_area_free_frag_desc(pebi, area_type);
 		if (IS_ERR(meta_desc)) {
 			SSDFS_ERR("fail to get vacant fragment descriptor: "
@@ -6546,7 +7176,7 @@ int __ssdfs_peb_update_block(struct ssdfs_peb_info *pebi,
 		}
 	}
 
-	down_write(&table->translation_lock);
+	ssdfs_blk2off_table_down_write(table);
 
 	migration_state = ssdfs_blk2off_table_get_block_migration(table, blk,
 								  peb_index);
@@ -7846,7 +8476,16 @@ int ssdfs_zone_move_extent(struct ssdfs_peb_info *pebi,
 	err = ssdfs_invextree_add(invextree, &extent, search);
 	ssdfs_btree_search_free(search);
 
-	if (unlikely(err)) {
+	if (err == -EEXIST) {
+		err = 0;
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("extent is invalidated already: "
+			  "seg_id %llu, logical_blk %u, len %u\n",
+			  le64_to_cpu(extent.seg_id),
+			  le32_to_cpu(extent.logical_blk),
+			  le32_to_cpu(extent.len));
+#endif /* CONFIG_SSDFS_DEBUG */
+	} else if (unlikely(err)) {
 		SSDFS_ERR("fail to add invalidated extent: "
 			  "seg_id %llu, logical_blk %u, "
 			  "len %u, err %d\n",
@@ -8829,6 +9468,8 @@ int ssdfs_peb_store_pagevec(struct ssdfs_pagevec_descriptor *desc)
 	case SSDFS_FRAGMENT_UNCOMPR_BLOB:
 	case SSDFS_FRAGMENT_ZLIB_BLOB:
 	case SSDFS_FRAGMENT_LZO_BLOB:
+	case SSDFS_FRAGMENT_ZSTD_BLOB:
+	case SSDFS_FRAGMENT_LZ4_BLOB:
 		/* valid type */
 		break;
 
@@ -9697,7 +10338,7 @@ int ssdfs_peb_store_dependent_blk_bmap(struct ssdfs_peb_info *pebi,
 			continue;
 		};
 
-		down_read(&cur_pebc->lock);
+		SSDFS_DOWN_READ(pebc, &cur_pebc->lock);
 		dst_peb = cur_pebc->dst_peb;
 		up_read(&cur_pebc->lock);
 
@@ -10059,17 +10700,17 @@ int ssdfs_peb_store_block_bmap(struct ssdfs_peb_info *pebi,
 
 	switch (compression) {
 	case SSDFS_BLK_BMAP_ZLIB_BLOB:
-		desc->check.flags = cpu_to_le16(SSDFS_CRC32 |
+		desc->check.flags = cpu_to_le16(ssdfs_csum_type(fsi) |
 						SSDFS_ZLIB_COMPRESSED);
 		break;
 
 	case SSDFS_BLK_BMAP_LZO_BLOB:
-		desc->check.flags = cpu_to_le16(SSDFS_CRC32 |
+		desc->check.flags = cpu_to_le16(ssdfs_csum_type(fsi) |
 						SSDFS_LZO_COMPRESSED);
 		break;
 
 	default:
-		desc->check.flags = cpu_to_le16(SSDFS_CRC32);
+		desc->check.flags = cpu_to_le16(ssdfs_csum_type(fsi));
 		break;
 	}
 
@@ -10233,7 +10874,7 @@ int ssdfs_peb_copy_area_pages_into_cache(struct ssdfs_peb_info *pebi,
 	if (area->has_metadata) {
 		void *kaddr;
 		u8 compression = fsi->metadata_options.blk2off_tbl.compression;
-		u16 metadata_flags = SSDFS_CRC32;
+		u16 metadata_flags = ssdfs_csum_type(fsi);
 
 		switch (area_type) {
 		case SSDFS_LOG_BLK_DESC_AREA:
@@ -10584,7 +11225,7 @@ int ssdfs_peb_move_area_pages_into_cache(struct ssdfs_peb_info *pebi,
 
 		kaddr = kmap_local_page(page);
 		desc->check.bytes = cpu_to_le16(blk_table_size);
-		desc->check.flags = cpu_to_le16(SSDFS_CRC32);
+		desc->check.flags = cpu_to_le16(ssdfs_csum_type(fsi));
 		err = ssdfs_calculate_csum(&desc->check, kaddr, blk_table_size);
 		kunmap_local(kaddr);
 		ssdfs_unlock_page(page);
@@ -10782,6 +11423,13 @@ int ssdfs_peb_store_blk_desc_table(struct ssdfs_peb_info *pebi,
 		  *cur_page, *write_offset);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	err = ssdfs_peb_join_blk_desc_compression(pebi);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to join blk desc compression: "
+			  "err %d\n", err);
+		return err;
+	}
+
 	if (is_peb_area_empty(pebi, area_type)) {
 		SSDFS_DBG("area %#x is empty\n", area_type);
 		return -ENODATA;
@@ -11487,18 +12135,149 @@ finish_segment_header_preparation:
 	return 0;
 }
 
+/*
+ * ssdfs_peb_release_written_chunk() - release pages of written chunk
+ * @pebi: pointer on PEB object
+ * @chunk: written chunk of the log
+ *
+ * This function cleans the dirty state of written pages
+ * in the PEB's cache and releases these pages.
+ */
+static
+void ssdfs_peb_release_written_chunk(struct ssdfs_peb_info *pebi,
+				     struct ssdfs_log_write_chunk *chunk)
+{
+	pgoff_t index = chunk->index;
+	pgoff_t end;
+	unsigned i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebi || !pebi->pebc || !chunk);
+	BUG_ON(chunk->written_pages == 0);
+
+	SSDFS_DBG("seg %llu, peb %llu, index %lu, written_pages %lu\n",
+		  pebi->pebc->parent_si->seg_id, pebi->peb_id,
+		  chunk->index, chunk->written_pages);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	for (i = 0; i < pagevec_count(&chunk->pvec); i++) {
+		struct page *page = chunk->pvec.pages[i];
+
+#ifdef CONFIG_SSDFS_DEBUG
+		BUG_ON(!page);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		if (i < chunk->written_pages) {
+			ssdfs_lock_page(page);
+			ClearPageUptodate(page);
+			ssdfs_clear_page_private(page, 0);
+			chunk->pvec.pages[i] = NULL;
+			ssdfs_unlock_page(page);
+		} else {
+			ssdfs_lock_page(page);
+			chunk->pvec.pages[i] = NULL;
+			ssdfs_unlock_page(page);
+		}
+	}
+
+	end = index + chunk->written_pages - 1;
+	err = ssdfs_page_array_clear_dirty_range(&pebi->cache,
+						 index,
+						 end);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to clean dirty pages: "
+			  "start %lu, end %lu, err %d\n",
+			  index, end, err);
+	}
+
+	err = ssdfs_page_array_release_pages(&pebi->cache,
+					     &index, end);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to release pages: "
+			  "seg_id %llu, peb_id %llu, "
+			  "start %lu, end %lu, err %d\n",
+			  pebi->pebc->parent_si->seg_id,
+			  pebi->peb_id, index, end, err);
+	}
+
+	pagevec_reinit(&chunk->pvec);
+}
+
+/*
+ * ssdfs_peb_complete_written_chunks() - complete the written chunks
+ * @pebi: pointer on PEB object
+ * @batch: batch of asynchronous write requests (optional)
+ * @chunks: array of written chunks
+ * @count: number of chunks in the array
+ *
+ * This function waits the end of asynchronous write requests
+ * (if @batch is not NULL) and releases pages of written chunks.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO     - I/O error.
+ */
+static
+int ssdfs_peb_complete_written_chunks(struct ssdfs_peb_info *pebi,
+				      struct ssdfs_io_batch *batch,
+				      struct ssdfs_log_write_chunk *chunks,
+				      int count)
+{
+	struct ssdfs_fs_info *fsi;
+	int i;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebi || !pebi->pebc || !chunks);
+	BUG_ON(!pebi->pebc->parent_si || !pebi->pebc->parent_si->fsi);
+
+	SSDFS_DBG("seg %llu, peb %llu, batch %p, count %d\n",
+		  pebi->pebc->parent_si->seg_id, pebi->peb_id,
+		  batch, count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	fsi = pebi->pebc->parent_si->fsi;
+
+	if (batch) {
+		err = fsi->devops->wait_writes(fsi->sb, batch);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to write log's pages: "
+				  "seg %llu, peb %llu, err %d\n",
+				  pebi->pebc->parent_si->seg_id,
+				  pebi->peb_id, err);
+
+			for (i = 0; i < count; i++)
+				pagevec_reinit(&chunks[i].pvec);
+
+			return err;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+		ssdfs_peb_release_written_chunk(pebi, &chunks[i]);
+
+	return 0;
+}
+
 /*
  * ssdfs_peb_flush_current_log_dirty_pages() - flush log's dirty pages
  * @pebi: pointer on PEB object
  * @write_offset: current write offset in log
  *
  * This function tries to flush the current log's dirty pages.
+ * If the device supports asynchronous writes then several chunks
+ * of the log are submitted under the plug and are in flight
+ * simultaneously. Otherwise, every chunk is written synchronously.
  *
  * RETURN:
  * [success]
  * [failure] - error code:
  *
  * %-ERANGE     - internal error.
+ * %-ENOMEM     - fail to allocate memory.
  */
 static
 int ssdfs_peb_flush_current_log_dirty_pages(struct ssdfs_peb_info *pebi,
@@ -11506,14 +12285,20 @@ int ssdfs_peb_flush_current_log_dirty_pages(struct ssdfs_peb_info *pebi,
 {
 	struct ssdfs_fs_info *fsi;
 	loff_t peb_offset;
-	struct pagevec pvec;
+	struct ssdfs_log_write_chunk *chunks;
+	struct ssdfs_log_write_chunk *chunk;
+	struct ssdfs_io_batch batch;
+	struct blk_plug plug;
+	bool is_async;
+	int chunks_capacity;
+	int chunks_count = 0;
 	u32 log_bytes, written_bytes;
 	u32 log_start_off;
 	unsigned flushed_pages;
 #ifdef CONFIG_SSDFS_CHECK_LOGICAL_BLOCK_EMPTYNESS
 	u32 pages_per_block;
 #endif /* CONFIG_SSDFS_CHECK_LOGICAL_BLOCK_EMPTYNESS */
-	int err = 0;
+	int err = 0, err2;
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!pebi || !pebi->pebc);
@@ -11532,7 +12317,20 @@ int ssdfs_peb_flush_current_log_dirty_pages(struct ssdfs_peb_info *pebi,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	fsi = pebi->pebc->parent_si->fsi;
-	pagevec_init(&pvec);
+
+	is_async = fsi->devops->writepages_async && fsi->devops->wait_writes;
+	chunks_capacity = is_async ? SSDFS_LOG_WRITE_CHUNKS_MAX : 1;
+
+	chunks = ssdfs_flush_kcalloc(chunks_capacity,
+				     sizeof(struct ssdfs_log_write_chunk),
+				     GFP_KERNEL);
+	if (!chunks) {
+		SSDFS_ERR("fail to allocate chunks array: "
+			  "capacity %d\n", chunks_capacity);
+		return -ENOMEM;
+	}
+
+	ssdfs_io_batch_init(&batch);
 
 	peb_offset = (pebi->peb_id * fsi->pages_per_peb) << fsi->log_pagesize;
 
@@ -11541,13 +12339,17 @@ int ssdfs_peb_flush_current_log_dirty_pages(struct ssdfs_peb_info *pebi,
 	written_bytes = 0;
 	flushed_pages = 0;
 
+	blk_start_plug(&plug);
+
 	while (written_bytes < log_bytes) {
 		pgoff_t index, end;
 		unsigned i;
 		u32 page_start_off, write_size;
 		loff_t iter_write_offset;
 		u32 pagevec_bytes;
-		pgoff_t written_pages = 0;
+
+		chunk = &chunks[chunks_count];
+		pagevec_init(&chunk->pvec);
 
 		index = pebi->current_log.start_page + flushed_pages;
 		end = (pgoff_t)pebi->current_log.start_page + pebi->log_pages;
@@ -11562,40 +12364,42 @@ int ssdfs_peb_flush_current_log_dirty_pages(struct ssdfs_peb_info *pebi,
 						    &index, end,
 						    SSDFS_DIRTY_PAGE_TAG,
 						    PAGEVEC_SIZE,
-						    &pvec);
+						    &chunk->pvec);
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to find dirty pages: "
 				  "index %lu, end %lu, err %d\n",
 				  index, end, err);
-			return -ERANGE;
+			err = -ERANGE;
+			goto finish_flush_log;
 		}
 
 		page_start_off = log_start_off + written_bytes;
 		page_start_off %= PAGE_SIZE;
 
-		pagevec_bytes = (u32)pagevec_count(&pvec) * PAGE_SIZE;
+		pagevec_bytes = (u32)pagevec_count(&chunk->pvec) * PAGE_SIZE;
 
 		write_size = min_t(u32,
 				   pagevec_bytes - page_start_off,
 				   log_bytes - written_bytes);
 
 		if ((written_bytes + write_size) > log_bytes) {
-			pagevec_reinit(&pvec);
+			pagevec_reinit(&chunk->pvec);
 			SSDFS_ERR("written_bytes %u > log_bytes %u\n",
 				  written_bytes + write_size,
 				  log_bytes);
-			return -ERANGE;
+			err = -ERANGE;
+			goto finish_flush_log;
 		}
 
 #ifdef CONFIG_SSDFS_DEBUG
 		BUG_ON(write_size % fsi->pagesize);
 		BUG_ON(written_bytes % fsi->pagesize);
 
-		for (i = 1; i < pagevec_count(&pvec); i++) {
+		for (i = 1; i < pagevec_count(&chunk->pvec); i++) {
 			struct page *page1, *page2;
 
-			page1 = pvec.pages[i - 1];
-			page2 = pvec.pages[i];
+			page1 = chunk->pvec.pages[i - 1];
+			page2 = chunk->pvec.pages[i];
 
 			if ((page_index(page1) + 1) != page_index(page2)) {
 				SSDFS_ERR("not contiguous log: "
@@ -11617,7 +12421,8 @@ int ssdfs_peb_flush_current_log_dirty_pages(struct ssdfs_peb_info *pebi,
 
 #ifdef CONFIG_SSDFS_CHECK_LOGICAL_BLOCK_EMPTYNESS
 		pages_per_block = fsi->pagesize / PAGE_SIZE;
-		for (i = 0; i < pagevec_count(&pvec); i += pages_per_block) {
+		for (i = 0; i < pagevec_count(&chunk->pvec);
+						i += pages_per_block) {
 			u64 byte_off;
 
 			if (!fsi->devops->can_write_page) {
@@ -11631,79 +12436,157 @@ int ssdfs_peb_flush_current_log_dirty_pages(struct ssdfs_peb_info *pebi,
 			err = fsi->devops->can_write_page(fsi->sb, byte_off,
 							  true);
 			if (err) {
-				pagevec_reinit(&pvec);
+				pagevec_reinit(&chunk->pvec);
 				ssdfs_fs_error(fsi->sb,
 					__FILE__, __func__, __LINE__,
 					"offset %llu err %d\n",
 					byte_off, err);
-				return err;
+				goto finish_flush_log;
 			}
 		}
 #endif /* CONFIG_SSDFS_CHECK_LOGICAL_BLOCK_EMPTYNESS */
 
-		err = fsi->devops->writepages(fsi->sb, iter_write_offset,
-						&pvec,
-						page_start_off,
-						write_size);
+		if (is_async) {
+			err = fsi->devops->writepages_async(fsi->sb,
+							    iter_write_offset,
+							    &chunk->pvec,
+							    page_start_off,
+							    write_size,
+							    &batch);
+		} else {
+			err = fsi->devops->writepages(fsi->sb,
+						      iter_write_offset,
+						      &chunk->pvec,
+						      page_start_off,
+						      write_size);
+		}
+
 		if (unlikely(err)) {
-			pagevec_reinit(&pvec);
+			pagevec_reinit(&chunk->pvec);
 			SSDFS_ERR("fail to flush pagevec: "
 				  "iter_write_offset %llu, write_size %u, "
 				  "err %d\n",
 				  iter_write_offset, write_size, err);
-			return err;
+			goto finish_flush_log;
 		}
 
-		written_pages = write_size / PAGE_SIZE;
+		chunk->index = index;
+		chunk->written_pages = write_size / PAGE_SIZE;
+		chunks_count++;
 
-		for (i = 0; i < pagevec_count(&pvec); i++) {
-			struct page *page = pvec.pages[i];
+		written_bytes += write_size;
+		flushed_pages += chunk->written_pages;
+		atomic64_add(write_size, &pebi->pebc->io_stats.written_bytes);
+		ssdfs_account_write_amplification(fsi, SSDFS_WA_DEVICE_WRITES,
+						  write_size);
 
-#ifdef CONFIG_SSDFS_DEBUG
-			BUG_ON(!page);
-#endif /* CONFIG_SSDFS_DEBUG */
+		if (chunks_count >= chunks_capacity ||
+		    written_bytes >= log_bytes) {
+			blk_finish_plug(&plug);
 
-			if (i < written_pages) {
-				ssdfs_lock_page(page);
-				ClearPageUptodate(page);
-				ssdfs_clear_page_private(page, 0);
-				pvec.pages[i] = NULL;
-				ssdfs_unlock_page(page);
-			} else {
-				ssdfs_lock_page(page);
-				pvec.pages[i] = NULL;
-				ssdfs_unlock_page(page);
+			err = ssdfs_peb_complete_written_chunks(pebi,
+						is_async ? &batch : NULL,
+						chunks, chunks_count);
+			chunks_count = 0;
+
+			if (unlikely(err)) {
+				SSDFS_ERR("fail to complete chunks: "
+					  "err %d\n", err);
+				goto free_chunks;
 			}
-		}
 
-		end = index + written_pages - 1;
-		err = ssdfs_page_array_clear_dirty_range(&pebi->cache,
-							 index,
-							 end);
-		if (unlikely(err)) {
-			SSDFS_ERR("fail to clean dirty pages: "
-				  "start %lu, end %lu, err %d\n",
-				  index, end, err);
+			blk_start_plug(&plug);
 		}
 
-		err = ssdfs_page_array_release_pages(&pebi->cache,
-						     &index, end);
-		if (unlikely(err)) {
-			SSDFS_ERR("fail to release pages: "
-				  "seg_id %llu, peb_id %llu, "
-				  "start %lu, end %lu, err %d\n",
-				  pebi->pebc->parent_si->seg_id,
-				  pebi->peb_id, index, end, err);
+		cond_resched();
+	};
+
+finish_flush_log:
+	blk_finish_plug(&plug);
+
+	if (chunks_count > 0) {
+		/* the log isn't completely submitted */
+		err2 = ssdfs_peb_complete_written_chunks(pebi,
+						is_async ? &batch : NULL,
+						chunks, chunks_count);
+		if (unlikely(err2)) {
+			SSDFS_ERR("fail to complete chunks: "
+				  "err %d\n", err2);
 		}
+	}
 
-		written_bytes += write_size;
-		flushed_pages += written_pages;
+free_chunks:
+	ssdfs_flush_kfree(chunks);
 
-		pagevec_reinit(&pvec);
-		cond_resched();
-	};
+	return err;
+}
 
-	return 0;
+/*
+ * ssdfs_peb_payload_wa_type() - category of PEB's payload
+ * @pebi: pointer on PEB object
+ */
+static inline
+int ssdfs_peb_payload_wa_type(struct ssdfs_peb_info *pebi)
+{
+	switch (pebi->pebc->peb_type) {
+	case SSDFS_MAPTBL_DATA_PEB_TYPE:
+		return SSDFS_WA_USER_DATA;
+
+	case SSDFS_MAPTBL_LNODE_PEB_TYPE:
+	case SSDFS_MAPTBL_HNODE_PEB_TYPE:
+	case SSDFS_MAPTBL_IDXNODE_PEB_TYPE:
+		return SSDFS_WA_BTREE_NODES;
+
+	case SSDFS_MAPTBL_MAPTBL_PEB_TYPE:
+		return SSDFS_WA_MAPTBL;
+
+	case SSDFS_MAPTBL_SEGBMAP_PEB_TYPE:
+		return SSDFS_WA_SEGBMAP;
+
+	default:
+		/* do nothing */
+		break;
+	}
+
+	return SSDFS_WA_OTHER_PAYLOAD;
+}
+
+/*
+ * ssdfs_peb_account_log_payload() - account stored areas of the log
+ * @pebi: pointer on PEB object
+ * @hdr_desc: pointer on area's descriptors array
+ *
+ * This method accounts the size of every stored area of the log
+ * for the estimation of write amplification.
+ */
+static
+void ssdfs_peb_account_log_payload(struct ssdfs_peb_info *pebi,
+				   struct ssdfs_metadata_descriptor *hdr_desc)
+{
+	struct ssdfs_fs_info *fsi = pebi->pebc->parent_si->fsi;
+	int payload_type = ssdfs_peb_payload_wa_type(pebi);
+	int index;
+
+	ssdfs_account_write_amplification(fsi, SSDFS_WA_BLK_BMAP,
+			le32_to_cpu(hdr_desc[SSDFS_BLK_BMAP_INDEX].size));
+	ssdfs_account_write_amplification(fsi, SSDFS_WA_BLK2OFF,
+			le32_to_cpu(hdr_desc[SSDFS_OFF_TABLE_INDEX].size));
+
+	index = SSDFS_AREA_TYPE2INDEX(SSDFS_LOG_BLK_DESC_AREA);
+	ssdfs_account_write_amplification(fsi, SSDFS_WA_BLK_DESC,
+				le32_to_cpu(hdr_desc[index].size));
+
+	index = SSDFS_AREA_TYPE2INDEX(SSDFS_LOG_DIFFS_AREA);
+	ssdfs_account_write_amplification(fsi, SSDFS_WA_DIFFS,
+				le32_to_cpu(hdr_desc[index].size));
+
+	index = SSDFS_AREA_TYPE2INDEX(SSDFS_LOG_JOURNAL_AREA);
+	ssdfs_account_write_amplification(fsi, payload_type,
+				le32_to_cpu(hdr_desc[index].size));
+
+	index = SSDFS_AREA_TYPE2INDEX(SSDFS_LOG_MAIN_AREA);
+	ssdfs_account_write_amplification(fsi, payload_type,
+				le32_to_cpu(hdr_desc[index].size));
 }
 
 /*
@@ -11887,6 +12770,9 @@ int ssdfs_peb_commit_log_payload(struct ssdfs_peb_info *pebi,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_commit_payload:
+	if (!err)
+		ssdfs_peb_account_log_payload(pebi, hdr_desc);
+
 	return err;
 }
 
@@ -13132,7 +14018,7 @@ u16 ssdfs_peb_calculate_reserved_metapages(u32 page_size,
 }
 
 /*
- * ssdfs_peb_commit_log() - commit current log
+ * __ssdfs_peb_commit_log() - commit current log
  * @pebi: pointer on PEB object
  * @cur_segs: current segment IDs array
  * @cur_segs_size: size of segment IDs array size in bytes
@@ -13147,8 +14033,8 @@ u16 ssdfs_peb_calculate_reserved_metapages(u32 page_size,
  * %-ERANGE     - internal error.
  */
 static
-int ssdfs_peb_commit_log(struct ssdfs_peb_info *pebi,
-			 __le64 *cur_segs, size_t cur_segs_size)
+int __ssdfs_peb_commit_log(struct ssdfs_peb_info *pebi,
+			   __le64 *cur_segs, size_t cur_segs_size)
 {
 	struct ssdfs_segment_info *si;
 	struct ssdfs_blk2off_table *table;
@@ -13361,6 +14247,8 @@ int ssdfs_peb_commit_log(struct ssdfs_peb_info *pebi,
 		return -ERANGE;
 	}
 
+	ssdfs_peb_account_log_workload(pebi, log_strategy);
+
 	table = pebi->pebc->parent_si->blk2off_table;
 
 	err = ssdfs_blk2off_table_revert_migration_state(table,
@@ -13383,6 +14271,35 @@ int ssdfs_peb_commit_log(struct ssdfs_peb_info *pebi,
 	return err;
 }
 
+/*
+ * ssdfs_peb_commit_log() - commit current log
+ * @pebi: pointer on PEB object
+ * @cur_segs: current segment IDs array
+ * @cur_segs_size: size of segment IDs array size in bytes
+ *
+ * This function tries to commit the current log and it traces
+ * the begin and the end of the commit.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+static
+int ssdfs_peb_commit_log(struct ssdfs_peb_info *pebi,
+			 __le64 *cur_segs, size_t cur_segs_size)
+{
+	int err;
+
+	trace_ssdfs_peb_commit_log_begin(pebi, 0);
+	err = __ssdfs_peb_commit_log(pebi, cur_segs, cur_segs_size);
+	trace_ssdfs_peb_commit_log_end(pebi, err);
+
+	if (!err)
+		atomic64_inc(&pebi->pebc->io_stats.log_commits);
+
+	return err;
+}
+
 /*
  * ssdfs_peb_remain_log_creation_thread() - remain as log creation thread
  * @pebc: pointer on PEB container
@@ -13929,6 +14846,53 @@ void ssdfs_finish_update_request(struct ssdfs_peb_container *pebc,
 	__ssdfs_finish_request(pebc, req, wait, err);
 }
 
+/*
+ * ssdfs_account_flush_request_bytes() - account bytes of flush request
+ * @pebc: pointer on PEB container
+ * @req: request
+ * @err: error of processing request
+ *
+ * The user data of create and update requests is the host writes.
+ * The blocks of GC and migration requests are the copies of
+ * valid data that are written by file system itself.
+ */
+static inline
+void ssdfs_account_flush_request_bytes(struct ssdfs_peb_container *pebc,
+					struct ssdfs_segment_request *req,
+					int err)
+{
+	struct ssdfs_fs_info *fsi = pebc->parent_si->fsi;
+	u64 bytes;
+
+	if (err || req->result.processed_blks <= 0)
+		return;
+
+	bytes = (u64)req->result.processed_blks * fsi->pagesize;
+
+	switch (req->private.class) {
+	case SSDFS_PEB_CREATE_DATA_REQ:
+	case SSDFS_PEB_UPDATE_REQ:
+	case SSDFS_PEB_PRE_ALLOC_UPDATE_REQ:
+	case SSDFS_PEB_DIFF_ON_WRITE_REQ:
+		if (pebc->peb_type == SSDFS_MAPTBL_DATA_PEB_TYPE) {
+			ssdfs_account_write_amplification(fsi,
+							  SSDFS_WA_HOST_DATA,
+							  bytes);
+		}
+		break;
+
+	case SSDFS_PEB_COLLECT_GARBAGE_REQ:
+	case SSDFS_ZONE_USER_DATA_MIGRATE_REQ:
+		ssdfs_account_write_amplification(fsi, SSDFS_WA_GC_COPIES,
+						  bytes);
+		break;
+
+	default:
+		/* do nothing */
+		break;
+	}
+}
+
 /*
  * ssdfs_finish_flush_request() - finish flush request
  * @pebc: pointer on PEB container
@@ -13950,6 +14914,10 @@ void ssdfs_finish_flush_request(struct ssdfs_peb_container *pebc,
 		  req, req->private.cmd, req->private.type, err);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	trace_ssdfs_request_complete(pebc, req, err);
+	ssdfs_peb_account_request_service(pebc->io_stats.flush_latency, req);
+	ssdfs_account_flush_request_bytes(pebc, req, err);
+
 	switch (req->private.class) {
 	case SSDFS_PEB_PRE_ALLOCATE_DATA_REQ:
 	case SSDFS_PEB_PRE_ALLOCATE_LNODE_REQ:
@@ -14078,14 +15046,12 @@ int ssdfs_peb_commit_log_on_thread_stop(struct ssdfs_peb_info *pebi,
 		 * Try to commit anyway.
 		 */
 
-		spin_lock(&fsi->volume_state_lock);
 		reserved_new_user_data_pages =
-			fsi->reserved_new_user_data_pages;
+		    ssdfs_fs_counter_sum(&fsi->reserved_new_user_data_pages);
 		updated_user_data_pages =
-			fsi->updated_user_data_pages;
+		    ssdfs_fs_counter_sum(&fsi->updated_user_data_pages);
 		flushing_user_data_requests =
-			fsi->flushing_user_data_requests;
-		spin_unlock(&fsi->volume_state_lock);
+		    ssdfs_fs_counter_sum(&fsi->flushing_user_data_requests);
 
 		SSDFS_WARN("PEB has dirty pages: "
 			   "seg %llu, peb %llu, peb_type %#x, "
@@ -14131,7 +15097,7 @@ int ssdfs_peb_get_current_log_state(struct ssdfs_peb_container *pebc)
 	fsi = pebc->parent_si->fsi;
 
 try_get_current_state:
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	switch (atomic_read(&pebc->migration_state)) {
 	case SSDFS_PEB_NOT_MIGRATING:
@@ -14550,10 +15516,10 @@ bool need_wait_next_create_data_request(struct ssdfs_peb_info *pebi)
 		goto finish_check;
 	}
 
-	spin_lock(&fsi->volume_state_lock);
-	reserved_pages = fsi->reserved_new_user_data_pages;
-	has_reserved_pages = fsi->reserved_new_user_data_pages > 0;
-	spin_unlock(&fsi->volume_state_lock);
+	reserved_pages =
+		ssdfs_fs_counter_read(&fsi->reserved_new_user_data_pages);
+	has_reserved_pages =
+		ssdfs_fs_counter_positive(&fsi->reserved_new_user_data_pages);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("reserved_pages %llu\n", reserved_pages);
@@ -14601,10 +15567,9 @@ bool need_wait_next_update_request(struct ssdfs_peb_info *pebi)
 		goto finish_check;
 	}
 
-	spin_lock(&fsi->volume_state_lock);
-	updated_pages = fsi->updated_user_data_pages;
-	has_updated_pages = fsi->updated_user_data_pages > 0;
-	spin_unlock(&fsi->volume_state_lock);
+	updated_pages = ssdfs_fs_counter_read(&fsi->updated_user_data_pages);
+	has_updated_pages =
+		ssdfs_fs_counter_positive(&fsi->updated_user_data_pages);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("updated_pages %llu\n", updated_pages);
@@ -14626,9 +15591,8 @@ bool no_more_updated_pages(struct ssdfs_peb_container *pebc)
 	if (!is_ssdfs_peb_containing_user_data(pebc))
 		return true;
 
-	spin_lock(&fsi->volume_state_lock);
-	has_updated_pages = fsi->updated_user_data_pages > 0;
-	spin_unlock(&fsi->volume_state_lock);
+	has_updated_pages =
+		ssdfs_fs_counter_positive(&fsi->updated_user_data_pages);
 
 	return !has_updated_pages;
 }
@@ -14697,16 +15661,17 @@ int wait_next_create_request(struct ssdfs_peb_container *pebc,
 		return -ERANGE;
 	}
 
-	spin_lock(&fsi->volume_state_lock);
-	reserved_pages = fsi->reserved_new_user_data_pages;
-	has_reserved_pages = reserved_pages > 0;
-	spin_unlock(&fsi->volume_state_lock);
+	reserved_pages =
+		ssdfs_fs_counter_read(&fsi->reserved_new_user_data_pages);
+	has_reserved_pages =
+		ssdfs_fs_counter_positive(&fsi->reserved_new_user_data_pages);
 
 	state = atomic_read(&si->obj_state);
 	is_current_seg = (state == SSDFS_CURRENT_SEG_OBJECT);
 
 	if (is_current_seg && has_reserved_pages) {
-		wq = &fsi->pending_wq;
+		wq = &si->wait_queue[SSDFS_PEB_FLUSH_THREAD];
+		ssdfs_segment_tree_mark_flush_waiter(fsi, si->seg_id);
 
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("wait next data request: reserved_pages %llu\n",
@@ -14799,13 +15764,13 @@ int wait_next_update_request(struct ssdfs_peb_container *pebc,
 		return -ERANGE;
 	}
 
-	spin_lock(&fsi->volume_state_lock);
-	updated_pages = fsi->updated_user_data_pages;
-	has_updated_pages = updated_pages > 0;
-	spin_unlock(&fsi->volume_state_lock);
+	updated_pages = ssdfs_fs_counter_read(&fsi->updated_user_data_pages);
+	has_updated_pages =
+		ssdfs_fs_counter_positive(&fsi->updated_user_data_pages);
 
 	if (has_updated_pages) {
-		wq = &fsi->pending_wq;
+		wq = &si->wait_queue[SSDFS_PEB_FLUSH_THREAD];
+		ssdfs_segment_tree_mark_flush_waiter(fsi, si->seg_id);
 
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("wait next update request: updated_pages %llu\n",
@@ -14899,7 +15864,8 @@ int wait_next_invalidate_request(struct ssdfs_peb_container *pebc,
 	state = atomic_read(&fsi->global_fs_state);
 	switch(state) {
 	case SSDFS_REGULAR_FS_OPERATIONS:
-		wq = &fsi->pending_wq;
+		wq = &si->wait_queue[SSDFS_PEB_FLUSH_THREAD];
+		ssdfs_segment_tree_mark_flush_waiter(fsi, si->seg_id);
 
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("wait next invalidate request\n");
@@ -14992,7 +15958,7 @@ int ssdfs_check_src_peb_init_state(struct ssdfs_peb_container *pebc)
 	u64 peb_id = U64_MAX;
 	int state = SSDFS_PEB_OBJECT_UNKNOWN_STATE;
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 	pebi = pebc->src_peb;
 	if (pebi) {
 		init_end = &pebi->init_end;
@@ -15013,7 +15979,7 @@ int ssdfs_check_dst_peb_init_state(struct ssdfs_peb_container *pebc)
 	u64 peb_id = U64_MAX;
 	int state = SSDFS_PEB_OBJECT_UNKNOWN_STATE;
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 	pebi = pebc->dst_peb;
 	if (pebi) {
 		init_end = &pebi->init_end;
@@ -15808,6 +16774,9 @@ process_flush_requests:
 			  req->private.class, req->private.cmd);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+		trace_ssdfs_request_dequeue(pebc, req, 0);
+		ssdfs_peb_start_request_service(req);
+
 		thread_state = SSDFS_FLUSH_THREAD_PROCESS_CREATE_REQUEST;
 		goto next_partial_step;
 		break;
@@ -15837,7 +16806,7 @@ process_flush_requests:
 			}
 		}
 
-		err = ssdfs_requests_queue_remove_first(&pebc->update_rq, &req);
+		err = ssdfs_requests_queue_remove_prio(&pebc->update_rq, &req);
 		if (err == -ENODATA) {
 			SSDFS_DBG("empty update queue\n");
 			err = 0;
@@ -15861,6 +16830,9 @@ process_flush_requests:
 			  req->private.class, req->private.cmd);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+		trace_ssdfs_request_dequeue(pebc, req, 0);
+		ssdfs_peb_start_request_service(req);
+
 		thread_state = SSDFS_FLUSH_THREAD_PROCESS_UPDATE_REQUEST;
 		goto next_partial_step;
 		break;
@@ -16857,18 +17829,20 @@ sleep_flush_thread:
 			ssdfs_peb_current_log_lock(pebi);
 
 			if (ssdfs_peb_has_dirty_pages(pebi)) {
+				struct percpu_counter *counter;
 				u64 reserved_new_user_data_pages;
 				u64 updated_user_data_pages;
 				u64 flushing_user_data_requests;
 
-				spin_lock(&fsi->volume_state_lock);
+				counter = &fsi->reserved_new_user_data_pages;
 				reserved_new_user_data_pages =
-					fsi->reserved_new_user_data_pages;
+					ssdfs_fs_counter_sum(counter);
+				counter = &fsi->updated_user_data_pages;
 				updated_user_data_pages =
-					fsi->updated_user_data_pages;
+					ssdfs_fs_counter_sum(counter);
+				counter = &fsi->flushing_user_data_requests;
 				flushing_user_data_requests =
-					fsi->flushing_user_data_requests;
-				spin_unlock(&fsi->volume_state_lock);
+					ssdfs_fs_counter_sum(counter);
 
 				SSDFS_WARN("seg %llu, peb %llu, peb_type %#x, "
 					  "global_fs_state %#x, "
@@ -247,6 +247,14 @@ finish_define_extent:
  *
  * This function tries to copy PEB's page into the buffer.
  *
+ * The migrated block is always moved through the memory. Copy offload
+ * (NVMe Simple Copy, ZNS copy) cannot be used here yet. The position of
+ * the block in the destination log is defined only by the log commit
+ * because the fragments are packed into the area buffers together
+ * with new data. Also the block descriptor of destination log needs
+ * the checksum of the data. Finally, the block layer has no copy
+ * operation that a device driver could implement.
+ *
  * RETURN:
  * [success]
  * [failure] - error code:
@@ -277,7 +285,7 @@ int __ssdfs_peb_copy_page(struct ssdfs_peb_container *pebc,
 
 	fsi = pebc->parent_si->fsi;
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	pebi = pebc->src_peb;
 
@@ -369,7 +377,7 @@ int ssdfs_peb_define_extent(struct ssdfs_peb_container *pebc,
 
 	fsi = pebc->parent_si->fsi;
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	pebi = pebc->src_peb;
 
@@ -962,77 +970,68 @@ int ssdfs_gc_convert_leb2peb(struct ssdfs_fs_info *fsi,
 }
 
 /*
- * should_ssdfs_segment_be_destroyed() - check necessity to destroy a segment
- * @si: pointer on segment object
+ * ssdfs_gc_convert_seg_lebs2pebs() - convert all LEBs of segment into PEBs
+ * @fsi: pointer on shared file system object
+ * @seg_id: segment ID number
+ * @leb_ids: buffer for LEB IDs of segment
+ * @pebr_array: array of PEBs association containers [out]
+ * @lebs_count: number of LEBs in segment
+ *
+ * This method tries to convert all LEBs of segment by one call
+ * of mapping table. Unmapped LEBs receive the association
+ * container with U64_MAX PEB IDs.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
  *
- * This method tries to check the necessity to destroy
- * a segment object.
+ * %-ERANGE     - internal error.
  */
 static
-bool should_ssdfs_segment_be_destroyed(struct ssdfs_segment_info *si)
+int ssdfs_gc_convert_seg_lebs2pebs(struct ssdfs_fs_info *fsi,
+				   u64 seg_id, u64 *leb_ids,
+				   struct ssdfs_maptbl_peb_relation *pebr_array,
+				   u32 lebs_count)
 {
-	struct ssdfs_peb_container *pebc;
-	struct ssdfs_peb_info *pebi;
-	u64 peb_id;
-	bool is_rq_empty;
-	bool is_fq_empty;
-	bool peb_has_dirty_pages = false;
-	bool is_blk_bmap_dirty = false;
-	bool dont_touch = false;
-	int i;
+	struct completion *init_end;
+	u8 peb_type = SSDFS_MAPTBL_UNKNOWN_PEB_TYPE;
+	u32 i;
+	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!si);
+	BUG_ON(!fsi || !leb_ids || !pebr_array);
 
-	SSDFS_DBG("seg_id %llu, refs_count %d\n",
-		  si->seg_id,
-		  atomic_read(&si->refs_count));
+	SSDFS_DBG("fsi %p, seg_id %llu, lebs_count %u\n",
+		  fsi, seg_id, lebs_count);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	if (atomic_read(&si->refs_count) > 0)
-		return false;
-
-	dont_touch = should_gc_doesnt_touch_segment(si);
-	if (dont_touch)
-		return false;
-
-	for (i = 0; i < si->pebs_count; i++) {
-		pebc = &si->peb_array[i];
-
-		is_rq_empty = is_ssdfs_requests_queue_empty(READ_RQ_PTR(pebc));
-		is_fq_empty = !have_flush_requests(pebc);
-
-		is_blk_bmap_dirty =
-			is_ssdfs_segment_blk_bmap_dirty(&si->blk_bmap, i);
-
-		pebi = ssdfs_get_current_peb_locked(pebc);
-		if (IS_ERR_OR_NULL(pebi))
-			return false;
+	for (i = 0; i < lebs_count; i++)
+		leb_ids[i] = ssdfs_get_leb_id_for_peb_index(fsi, seg_id, i);
 
-		ssdfs_peb_current_log_lock(pebi);
-		peb_has_dirty_pages = ssdfs_peb_has_dirty_pages(pebi);
-		peb_id = pebi->peb_id;
-		ssdfs_peb_current_log_unlock(pebi);
-		ssdfs_unlock_current_peb(pebc);
+	err = ssdfs_maptbl_convert_lebs2pebs(fsi, leb_ids, lebs_count,
+					     peb_type, pebr_array,
+					     &init_end);
+	if (err == -EAGAIN) {
+		err = SSDFS_WAIT_COMPLETION(init_end);
+		if (unlikely(err)) {
+			SSDFS_ERR("maptbl init failed: "
+				  "err %d\n", err);
+			return err;
+		}
 
-#ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("seg_id %llu, peb_id %llu, refs_count %d, "
-			  "peb_has_dirty_pages %#x, "
-			  "not empty: (read %#x, flush %#x), "
-			  "dont_touch %#x, is_blk_bmap_dirty %#x\n",
-			  si->seg_id, peb_id,
-			  atomic_read(&si->refs_count),
-			  peb_has_dirty_pages,
-			  !is_rq_empty, !is_fq_empty,
-			  dont_touch, is_blk_bmap_dirty);
-#endif /* CONFIG_SSDFS_DEBUG */
+		err = ssdfs_maptbl_convert_lebs2pebs(fsi, leb_ids, lebs_count,
+						     peb_type, pebr_array,
+						     &init_end);
+	}
 
-		if (!is_rq_empty || !is_fq_empty ||
-		    peb_has_dirty_pages || is_blk_bmap_dirty)
-			return false;
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to convert LEBs to PEBs: "
+			  "seg_id %llu, err %d\n",
+			  seg_id, err);
+		return err;
 	}
 
-	return true;
+	return 0;
 }
 
 /*
@@ -1051,8 +1050,6 @@ bool should_gc_work(struct ssdfs_fs_info *fsi, int type)
 #define GLOBAL_GC_FAILED_THREAD_WAKE_CONDITION() \
 	(kthread_should_stop())
 
-#define SSDFS_GC_LOW_BOUND_THRESHOLD	(50)
-#define SSDFS_GC_UPPER_BOUND_THRESHOLD	(1000)
 #define SSDFS_GC_DISTANCE_THRESHOLD	(5)
 #define SSDFS_GC_DEFAULT_SEARCH_STEP	(100)
 #define SSDFS_GC_DIRTY_SEG_SEARCH_STEP	(1000)
@@ -1080,6 +1077,203 @@ struct ssdfs_io_load_stats {
 	s64 reqs_count[SSDFS_MEASUREMENTS_MAX];
 };
 
+/*
+ * GC governor modes
+ */
+enum {
+	SSDFS_GC_IDLE_MODE,
+	SSDFS_GC_LOADED_MODE,
+	SSDFS_GC_BUSY_MODE,
+	SSDFS_GC_URGENT_MODE,
+};
+
+/*
+ * is_ssdfs_gc_urgent() - check that free space is lower than watermark
+ * @fsi: pointer on shared file system object
+ */
+static
+bool is_ssdfs_gc_urgent(struct ssdfs_fs_info *fsi)
+{
+	u32 urgent_pct;
+	u64 nsegs;
+	u64 total_pages;
+	u64 free_pages;
+
+	urgent_pct = atomic_read(&fsi->gc_governor.urgent_free_pct);
+	if (urgent_pct == 0)
+		return false;
+
+	mutex_lock(&fsi->resize_mutex);
+	nsegs = fsi->nsegs;
+	mutex_unlock(&fsi->resize_mutex);
+
+	total_pages = nsegs * fsi->pages_per_seg;
+
+	free_pages = ssdfs_fs_counter_read(&fsi->free_pages);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("free_pages %llu, total_pages %llu, urgent_pct %u\n",
+		  free_pages, total_pages, urgent_pct);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return free_pages * 100 < total_pages * urgent_pct;
+}
+
+/*
+ * ssdfs_gc_governor_mode() - define current mode of GC activity
+ * @fsi: pointer on shared file system object
+ * @reqs_count: current number of flush requests [out]
+ */
+static
+int ssdfs_gc_governor_mode(struct ssdfs_fs_info *fsi, s64 *reqs_count)
+{
+	*reqs_count = atomic64_read(&fsi->flush_reqs);
+
+	if (is_ssdfs_gc_urgent(fsi))
+		return SSDFS_GC_URGENT_MODE;
+
+	if (*reqs_count <= atomic_read(&fsi->gc_governor.idle_reqs))
+		return SSDFS_GC_IDLE_MODE;
+
+	if (*reqs_count >= atomic_read(&fsi->gc_governor.busy_reqs))
+		return SSDFS_GC_BUSY_MODE;
+
+	return SSDFS_GC_LOADED_MODE;
+}
+
+/*
+ * ssdfs_gc_governor_delay() - define delay before the next GC victim
+ * @fsi: pointer on shared file system object
+ *
+ * The delay grows linearly from idle delay up to busy delay
+ * with the growth of flush requests queue. GC has no delays
+ * in urgent mode.
+ *
+ * RETURN: delay in jiffies.
+ */
+static
+unsigned long ssdfs_gc_governor_delay(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_gc_governor *gov = &fsi->gc_governor;
+	u32 idle_delay = atomic_read(&gov->idle_delay_msecs);
+	u32 busy_delay = atomic_read(&gov->busy_delay_msecs);
+	s64 idle_reqs = atomic_read(&gov->idle_reqs);
+	s64 busy_reqs = atomic_read(&gov->busy_reqs);
+	s64 reqs_count;
+	u64 delay;
+
+	switch (ssdfs_gc_governor_mode(fsi, &reqs_count)) {
+	case SSDFS_GC_URGENT_MODE:
+		delay = 0;
+		break;
+
+	case SSDFS_GC_IDLE_MODE:
+		delay = idle_delay;
+		break;
+
+	case SSDFS_GC_BUSY_MODE:
+		delay = busy_delay;
+		break;
+
+	default:
+		delay = idle_delay;
+
+		if (busy_delay > idle_delay && busy_reqs > idle_reqs) {
+			delay += div64_u64((u64)(busy_delay - idle_delay) *
+						(reqs_count - idle_reqs),
+					   busy_reqs - idle_reqs);
+		}
+		break;
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("reqs_count %lld, delay %llu msecs\n",
+		  reqs_count, delay);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return msecs_to_jiffies(delay);
+}
+
+/*
+ * should_gc_continue() - should GC continue without new requests?
+ * @fsi: pointer on shared file system object
+ * @type: thread type
+ */
+static inline
+bool should_gc_continue(struct ssdfs_fs_info *fsi, int type)
+{
+	s64 reqs_count;
+
+	if (atomic_read(&fsi->gc_should_act[type]) > 0)
+		return true;
+
+	switch (ssdfs_gc_governor_mode(fsi, &reqs_count)) {
+	case SSDFS_GC_URGENT_MODE:
+		return true;
+
+	case SSDFS_GC_IDLE_MODE:
+		return atomic_read(&fsi->gc_governor.idle_scan_secs) > 0;
+
+	default:
+		/* do nothing */
+		break;
+	}
+
+	return false;
+}
+
+/*
+ * ssdfs_gc_wait_next_pass() - wait the request or idle state for GC pass
+ * @fsi: pointer on shared file system object
+ * @type: thread type
+ *
+ * GC thread sleeps until the request from migration scheme.
+ * If idle scan is enabled, then GC thread wakes up periodically
+ * and starts the pass by itself in idle or urgent mode.
+ */
+static
+void ssdfs_gc_wait_next_pass(struct ssdfs_fs_info *fsi, int type)
+{
+	wait_queue_head_t *wq = &fsi->gc_wait_queue[type];
+	unsigned long timeout;
+	u32 idle_scan_secs;
+	s64 reqs_count;
+
+	while (!GLOBAL_GC_THREAD_WAKE_CONDITION(fsi, type)) {
+		idle_scan_secs = atomic_read(&fsi->gc_governor.idle_scan_secs);
+
+		if (idle_scan_secs == 0)
+			timeout = MAX_SCHEDULE_TIMEOUT;
+		else
+			timeout = (unsigned long)idle_scan_secs * HZ;
+
+		wait_event_interruptible_timeout(*wq,
+			GLOBAL_GC_THREAD_WAKE_CONDITION(fsi, type),
+			timeout);
+
+		if (GLOBAL_GC_THREAD_WAKE_CONDITION(fsi, type))
+			break;
+
+		if (atomic_read(&fsi->gc_governor.idle_scan_secs) == 0)
+			continue;
+
+		switch (ssdfs_gc_governor_mode(fsi, &reqs_count)) {
+		case SSDFS_GC_IDLE_MODE:
+		case SSDFS_GC_URGENT_MODE:
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("start GC pass by itself: "
+				  "type %#x, reqs_count %lld\n",
+				  type, reqs_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+			return;
+
+		default:
+			/* continue to wait */
+			break;
+		}
+	}
+}
+
 /*
  * is_time_collect_garbage() - check that it's good time for GC activity
  * @fsi: pointer on shared file system object
@@ -1087,6 +1281,8 @@ struct ssdfs_io_load_stats {
  *
  * This method tries to estimate the I/O load with
  * the goal to define the good time for GC activity.
+ * GC works without regard to I/O load if free space
+ * is lower than urgent watermark.
  */
 static
 int is_time_collect_garbage(struct ssdfs_fs_info *fsi,
@@ -1144,14 +1340,22 @@ int is_time_collect_garbage(struct ssdfs_fs_info *fsi,
 		break;
 	}
 
-	if (reqs_count <= SSDFS_GC_LOW_BOUND_THRESHOLD) {
+	if (is_ssdfs_gc_urgent(fsi)) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("free space is lower than watermark: "
+			  "reqs_count %lld\n", reqs_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return SSDFS_COLLECT_GARBAGE_NOW;
+	}
+
+	if (reqs_count <= atomic_read(&fsi->gc_governor.idle_reqs)) {
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("reqs_count %lld\n", reqs_count);
 #endif /* CONFIG_SSDFS_DEBUG */
 		return SSDFS_COLLECT_GARBAGE_NOW;
 	}
 
-	if (reqs_count >= SSDFS_GC_UPPER_BOUND_THRESHOLD) {
+	if (reqs_count >= atomic_read(&fsi->gc_governor.busy_reqs)) {
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("reqs_count %lld\n", reqs_count);
 #endif /* CONFIG_SSDFS_DEBUG */
@@ -1364,6 +1568,8 @@ void ssdfs_gc_wait_commit_logs_end(struct ssdfs_fs_info *fsi,
 		if (pair->si != NULL) {
 			struct ssdfs_segment_info *si = pair->si;
 
+			ssdfs_segment_tree_lock_eviction(fsi);
+
 			ssdfs_segment_put_object(si);
 
 			if (should_ssdfs_segment_be_destroyed(si)) {
@@ -1381,6 +1587,8 @@ void ssdfs_gc_wait_commit_logs_end(struct ssdfs_fs_info *fsi,
 					}
 				}
 			}
+
+			ssdfs_segment_tree_unlock_eviction(fsi);
 		} else {
 			SSDFS_ERR("segment is NULL: "
 				  "item_index %d\n", i);
@@ -1390,6 +1598,32 @@ void ssdfs_gc_wait_commit_logs_end(struct ssdfs_fs_info *fsi,
 	memset(array, 0, sizeof(struct ssdfs_seg2req_pair_array));
 }
 
+/*
+ * The GC stimulates the migration by two steps. Every step migrates
+ * a range of pre-allocated blocks and a range of valid blocks.
+ * If every range contains only one block, then the PEB's log
+ * receives several blocks only. The GC processes the cold
+ * segments that are not updated for a long time. Such segment's
+ * destination PEB needs to be filled by big logs. Then, the read
+ * path and the PEB's initialization have to process fewer log
+ * headers, footers and blk2off table fragments.
+ */
+#define SSDFS_GC_MIGRATION_RANGES_PER_LOG	(4)
+
+/*
+ * ssdfs_gc_migration_range_len() - define length of migrating range
+ * @pebc: pointer on PEB container object
+ */
+static inline
+u32 ssdfs_gc_migration_range_len(struct ssdfs_peb_container *pebc)
+{
+	u32 range_len;
+
+	range_len = pebc->log_pages / SSDFS_GC_MIGRATION_RANGES_PER_LOG;
+
+	return max_t(u32, range_len, 1);
+}
+
 /*
  * ssdfs_gc_stimulate_migration() - stimulate migration
  * @si: pointer on segment object
@@ -1411,6 +1645,7 @@ int ssdfs_gc_stimulate_migration(struct ssdfs_segment_info *si,
 {
 	struct ssdfs_peb_info *pebi;
 	struct ssdfs_seg2req_pair *pair;
+	u32 range_len;
 	u32 index;
 	int count;
 	int err = 0;
@@ -1471,19 +1706,21 @@ int ssdfs_gc_stimulate_migration(struct ssdfs_segment_info *si,
 
 	ssdfs_unlock_current_peb(pebc);
 
+	range_len = ssdfs_gc_migration_range_len(pebc);
+
 	mutex_lock(&pebc->migration_lock);
 
 	for (count = 0; count < 2; count++) {
 		int err1, err2;
 
-		err1 = ssdfs_peb_prepare_range_migration(pebc, 1,
+		err1 = ssdfs_peb_prepare_range_migration(pebc, range_len,
 						SSDFS_BLK_PRE_ALLOCATED);
 		if (err1 && err1 != -ENODATA) {
 			err = err1;
 			break;
 		}
 
-		err2 = ssdfs_peb_prepare_range_migration(pebc, 1,
+		err2 = ssdfs_peb_prepare_range_migration(pebc, range_len,
 						SSDFS_BLK_VALID);
 		if (err2 && err2 != -ENODATA) {
 			err = err2;
@@ -1712,458 +1949,1080 @@ int ssdfs_revert_segment_to_regular_activity(struct ssdfs_segment_info *si)
 	return 0;
 }
 
+#define SSDFS_GC_VICTIMS_MAX		(8)
+#define SSDFS_GC_SCORE_SCALE		(1024)
+#define SSDFS_GC_AGE_MAX_SECS		(24 * 60 * 60)
+
 /*
- * ssdfs_generic_seg_gc_thread_func() - generic function of GC thread
+ * struct ssdfs_gc_victims - ranked victim segments of search window
+ * @count: number of victims in the array
+ * @pos: index of the next victim for processing
+ * @seg_id: array of victims' IDs (the best victim is the first)
+ * @score: array of victims' scores
+ * @next_seg_id: segment ID for continuation of the search
+ */
+struct ssdfs_gc_victims {
+	u32 count;
+	u32 pos;
+	u64 seg_id[SSDFS_GC_VICTIMS_MAX];
+	u64 score[SSDFS_GC_VICTIMS_MAX];
+	u64 next_seg_id;
+};
+
+/*
+ * ssdfs_gc_victim_score() - estimate benefit/cost ratio of segment's GC
  * @fsi: pointer on shared file system object
- * @thread_type: thread type
+ * @seg_id: segment ID
+ *
+ * This function estimates the value of segment's reclaim by means
+ * of cost-benefit formula: age * (1 - u) / (1 + u), where u is
+ * the fraction of valid blocks. The valid blocks are read and written
+ * by migration (cost is 1 + u), the invalid blocks are reclaimed
+ * (benefit is 1 - u). The age is the time since the latest invalidation
+ * in the segment. A cold segment is not expected to be invalidated
+ * more, so it is preferred. The estimation is possible only for
+ * the segments in the segments tree. Other segments receive
+ * the zero score and they are processed after the ranked ones.
+ */
+static
+u64 ssdfs_gc_victim_score(struct ssdfs_fs_info *fsi, u64 seg_id)
+{
+	struct ssdfs_segment_info *si;
+	struct ssdfs_segment_blk_bmap *bmap;
+	unsigned long age_secs;
+	int valid_blks;
+	int invalid_blks;
+	u64 score = 0;
+
+	ssdfs_segment_tree_lock_eviction(fsi);
+
+	si = ssdfs_segment_tree_find(fsi, seg_id);
+	if (IS_ERR_OR_NULL(si))
+		goto finish_estimation;
+
+	bmap = &si->blk_bmap;
+
+	if (atomic_read(&bmap->state) != SSDFS_SEG_BLK_BMAP_CREATED)
+		goto finish_estimation;
+
+	valid_blks = atomic_read(&bmap->seg_valid_blks);
+	invalid_blks = atomic_read(&bmap->seg_invalid_blks);
+
+	if (valid_blks < 0 || invalid_blks <= 0)
+		goto finish_estimation;
+
+	age_secs = (jiffies - READ_ONCE(bmap->last_invalidation)) / HZ;
+	age_secs = min_t(unsigned long, age_secs, SSDFS_GC_AGE_MAX_SECS);
+
+	score = (u64)invalid_blks * SSDFS_GC_SCORE_SCALE * (age_secs + 1);
+	score = div_u64(score, (2 * valid_blks) + invalid_blks);
+
+finish_estimation:
+	ssdfs_segment_tree_unlock_eviction(fsi);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("seg_id %llu, score %llu\n",
+		  seg_id, score);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return score;
+}
+
+/*
+ * ssdfs_gc_select_victims() - select and rank victims of search window
+ * @fsi: pointer on shared file system object
+ * @start_seg_id: starting segment ID of the window
+ * @max_seg_id: ending segment ID of the window
  * @seg_state: type of segment
  * @seg_state_mask: segment types' mask
+ * @victims: ranked victims [out]
  *
- * This function is the key logic of GC thread.
+ * This function finds up to SSDFS_GC_VICTIMS_MAX segments
+ * of requested state in the window and sorts them in the order
+ * of descending score.
  *
  * RETURN:
  * [success]
  * [failure] - error code:
  *
- * %-ERANGE     - internal error.
+ * %-ENODATA    - no segment for requested state was found.
  */
 static
-int ssdfs_generic_seg_gc_thread_func(struct ssdfs_fs_info *fsi,
-				     int thread_type,
-				     int seg_state, int seg_state_mask)
+int ssdfs_gc_select_victims(struct ssdfs_fs_info *fsi,
+			    u64 start_seg_id, u64 max_seg_id,
+			    int seg_state, int seg_state_mask,
+			    struct ssdfs_gc_victims *victims)
 {
-	struct ssdfs_segment_info *si;
-	struct ssdfs_peb_container *pebc;
-	struct ssdfs_maptbl_peb_relation pebr;
-	struct ssdfs_maptbl_peb_descriptor *pebd;
-	struct ssdfs_io_load_stats io_stats;
-	size_t io_stats_size = sizeof(struct ssdfs_io_load_stats);
-	wait_queue_head_t *wq;
-	struct ssdfs_segment_blk_bmap *seg_blkbmap;
-	struct ssdfs_peb_blk_bmap *peb_blkbmap;
-	struct ssdfs_seg2req_pair_array reqs_array;
-	u8 peb_type = SSDFS_MAPTBL_UNKNOWN_PEB_TYPE;
-	int seg_type = SSDFS_UNKNOWN_SEG_TYPE;
-	u64 seg_id = 0;
-	u64 max_seg_id;
-	u64 seg_id_step = SSDFS_GC_DEFAULT_SEARCH_STEP;
-	u64 nsegs;
-	u64 cur_leb_id;
-	u32 lebs_per_segment;
-	int gc_strategy;
-	int used_pages;
-	u32 i;
-	int err = 0;
+	u64 seg_id = start_seg_id;
+	u64 found_seg_id;
+	u64 score;
+	int i;
+	int err;
 
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!fsi);
+	victims->count = 0;
+	victims->pos = 0;
+	victims->next_seg_id = max_seg_id;
 
-	SSDFS_DBG("GC thread: thread_type %#x, "
-		  "seg_state %#x, seg_state_mask %#x\n",
-		  thread_type, seg_state, seg_state_mask);
-#endif /* CONFIG_SSDFS_DEBUG */
+	while (seg_id < max_seg_id &&
+		victims->count < SSDFS_GC_VICTIMS_MAX) {
+		err = ssdfs_gc_find_next_seg_id(fsi, seg_id, max_seg_id,
+						seg_state, seg_state_mask,
+						&found_seg_id);
+		if (err == -ENODATA)
+			break;
+		else if (unlikely(err))
+			return err;
 
-	wq = &fsi->gc_wait_queue[thread_type];
-	lebs_per_segment = fsi->pebs_per_seg;
-	memset(&reqs_array, 0, sizeof(struct ssdfs_seg2req_pair_array));
+		score = ssdfs_gc_victim_score(fsi, found_seg_id);
 
-repeat:
-	if (kthread_should_stop()) {
-		complete_all(&fsi->gc_thread[thread_type].full_stop);
-		return err;
-	} else if (unlikely(err))
-		goto sleep_failed_gc_thread;
+		/* insertion sort: the best victim is the first */
+		i = victims->count;
+		while (i > 0 && victims->score[i - 1] < score) {
+			victims->seg_id[i] = victims->seg_id[i - 1];
+			victims->score[i] = victims->score[i - 1];
+			i--;
+		}
 
-	mutex_lock(&fsi->resize_mutex);
-	nsegs = fsi->nsegs;
-	mutex_unlock(&fsi->resize_mutex);
+		victims->seg_id[i] = found_seg_id;
+		victims->score[i] = score;
+		victims->count++;
 
-	if (seg_id >= nsegs)
-		seg_id = 0;
+		seg_id = found_seg_id + 1;
+	}
 
-	while (seg_id < nsegs) {
-		peb_type = SSDFS_MAPTBL_UNKNOWN_PEB_TYPE;
-		seg_type = SSDFS_UNKNOWN_SEG_TYPE;
+	if (victims->count == 0)
+		return -ENODATA;
 
-		max_seg_id = seg_id + seg_id_step;
-		max_seg_id = min_t(u64, max_seg_id, nsegs);
+	if (victims->count >= SSDFS_GC_VICTIMS_MAX)
+		victims->next_seg_id = seg_id;
 
-		err = ssdfs_gc_find_next_seg_id(fsi, seg_id, max_seg_id,
-						seg_state, seg_state_mask,
-						&seg_id);
-		if (err == -ENODATA) {
-			err = 0;
+	return 0;
+}
 
-			if (max_seg_id >= nsegs) {
-				seg_id = 0;
-				SSDFS_DBG("GC hasn't found any victim\n");
-				goto finish_seg_processing;
-			}
+/*
+ * ssdfs_gc_drop_victims() - forget victims that haven't been processed
+ * @victims: ranked victims
+ *
+ * RETURN: segment ID for continuation of the search.
+ */
+static inline
+u64 ssdfs_gc_drop_victims(struct ssdfs_gc_victims *victims)
+{
+	u64 seg_id = victims->next_seg_id;
+	u32 i;
 
-			seg_id = max_seg_id;
+	for (i = victims->pos; i < victims->count; i++)
+		seg_id = min_t(u64, seg_id, victims->seg_id[i]);
 
-			wait_event_interruptible_timeout(*wq,
-					kthread_should_stop(), HZ);
+	victims->count = 0;
+	victims->pos = 0;
 
-			if (kthread_should_stop())
-				goto finish_seg_processing;
-			else
-				continue;
+	return seg_id;
+}
+
+#define SSDFS_GC_WORKERS_MAX		(8)
+
+struct ssdfs_gc_pool;
+
+/*
+ * struct ssdfs_gc_victim_ctx - context of victim segment's processing
+ * @pool: pool of GC workers
+ * @leb_ids: buffer of LEB IDs for LEB/PEB conversion
+ * @pebr_array: buffer of PEB relations for LEB/PEB conversion
+ * @reqs_array: array of stimulated migration requests
+ */
+struct ssdfs_gc_victim_ctx {
+	struct ssdfs_gc_pool *pool;
+	u64 *leb_ids;
+	struct ssdfs_maptbl_peb_relation *pebr_array;
+	struct ssdfs_seg2req_pair_array reqs_array;
+};
+
+/*
+ * struct ssdfs_gc_worker - GC worker
+ * @work: work item of GC worker
+ * @ctx: context of victim segment's processing
+ */
+struct ssdfs_gc_worker {
+	struct work_struct work;
+	struct ssdfs_gc_victim_ctx ctx;
+};
+
+/*
+ * struct ssdfs_gc_pool - pool of GC workers
+ * @fsi: pointer on shared file system object
+ * @thread_type: GC thread type
+ * @wq: workqueue of GC workers
+ * @workers_count: number of GC workers in the pool
+ * @workers: array of GC workers
+ * @lock: lock of victims array
+ * @victims: ranked victims of current search window
+ * @active: number of working GC workers
+ * @stop: should the processing of victims be stopped?
+ * @err: error of victims' processing
+ * @wait: wait queue of GC workers' completion
+ *
+ * GC thread ranks the victims of search window and the GC workers
+ * take the victims from the ranked array in the order of score.
+ * Every GC worker takes the next victim as soon as it finishes
+ * the previous one. So, the segments of different size
+ * and state are balanced between the GC workers.
+ */
+struct ssdfs_gc_pool {
+	struct ssdfs_fs_info *fsi;
+	int thread_type;
+
+	struct workqueue_struct *wq;
+	u32 workers_count;
+	struct ssdfs_gc_worker *workers;
+
+	spinlock_t lock;
+	struct ssdfs_gc_victims *victims;
+
+	atomic_t active;
+	bool stop;
+	int err;
+	wait_queue_head_t wait;
+};
+
+/*
+ * ssdfs_gc_should_stop() - should processing of victims be stopped?
+ * @ctx: context of victim segment's processing
+ */
+static inline
+bool ssdfs_gc_should_stop(struct ssdfs_gc_victim_ctx *ctx)
+{
+	return READ_ONCE(ctx->pool->stop) || kthread_should_stop();
+}
+
+/*
+ * ssdfs_gc_collect_victim() - stimulate migration of victim segment
+ * @ctx: context of victim segment's processing
+ * @seg_id: victim segment ID
+ *
+ * This function stimulates the migration of every PEB of victim
+ * segment that is under migration. The segment is marked
+ * by GC activity during the processing. As a result,
+ * the same segment is never processed by several GC workers.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINTR      - processing of victims should be stopped.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_gc_collect_victim(struct ssdfs_gc_victim_ctx *ctx, u64 seg_id)
+{
+	struct ssdfs_fs_info *fsi = ctx->pool->fsi;
+	struct ssdfs_segment_info *si;
+	struct ssdfs_peb_container *pebc;
+	struct ssdfs_maptbl_peb_relation pebr;
+	size_t peb_relation_size = sizeof(struct ssdfs_maptbl_peb_relation);
+	struct ssdfs_maptbl_peb_descriptor *pebd;
+	struct ssdfs_io_load_stats io_stats;
+	size_t io_stats_size = sizeof(struct ssdfs_io_load_stats);
+	wait_queue_head_t *wq;
+	struct ssdfs_segment_blk_bmap *seg_blkbmap;
+	struct ssdfs_peb_blk_bmap *peb_blkbmap;
+	u8 peb_type = SSDFS_MAPTBL_UNKNOWN_PEB_TYPE;
+	int seg_type = SSDFS_UNKNOWN_SEG_TYPE;
+	u64 cur_leb_id;
+	u32 lebs_per_segment;
+	int gc_strategy;
+	int used_pages;
+	u32 i;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("seg_id %llu, thread_type %#x\n",
+		  seg_id, ctx->pool->thread_type);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	wq = &fsi->gc_wait_queue[ctx->pool->thread_type];
+	lebs_per_segment = fsi->pebs_per_seg;
+
+	if (ctx->pebr_array) {
+		err = ssdfs_gc_convert_seg_lebs2pebs(fsi, seg_id,
+						     ctx->leb_ids,
+						     ctx->pebr_array,
+						     lebs_per_segment);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to convert LEBs to PEBs: "
+				  "seg_id %llu, err %d\n",
+				  seg_id, err);
+			return err;
+		}
+	}
+
+	for (i = 0; i < lebs_per_segment; i++) {
+		cur_leb_id = ssdfs_get_leb_id_for_peb_index(fsi, seg_id, i);
+		if (cur_leb_id >= U64_MAX) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("unexpected leb_id: "
+				  "seg_id %llu, peb_index %u\n",
+				  seg_id, i);
+#endif /* CONFIG_SSDFS_DEBUG */
+			continue;
+		}
+
+		if (ssdfs_gc_should_stop(ctx))
+			return -EINTR;
+
+		if (ctx->pebr_array) {
+			ssdfs_memcpy(&pebr, 0, peb_relation_size,
+				     &ctx->pebr_array[i], 0, peb_relation_size,
+				     peb_relation_size);
+			pebd = &pebr.pebs[SSDFS_MAPTBL_MAIN_INDEX];
+			err = pebd->peb_id == U64_MAX ? -ENODATA : 0;
+		} else
+			err = ssdfs_gc_convert_leb2peb(fsi, cur_leb_id, &pebr);
+
+		if (err == -ENODATA) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("LEB is not mapped: leb_id %llu\n",
+				  cur_leb_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+			continue;
 		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to convert LEB to PEB: "
+				  "leb_id %llu, peb_type %#x, err %d\n",
+				  cur_leb_id, peb_type, err);
+			return err;
+		}
+
+		pebd = &pebr.pebs[SSDFS_MAPTBL_MAIN_INDEX];
+
+		switch (pebd->state) {
+		case SSDFS_MAPTBL_MIGRATION_SRC_USED_STATE:
+		case SSDFS_MAPTBL_MIGRATION_SRC_PRE_DIRTY_STATE:
+			/* PEB is under migration */
+			break;
+
+		case SSDFS_MAPTBL_MIGRATION_SRC_DIRTY_STATE:
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("SRC PEB %llu is dirty\n",
+				  pebd->peb_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+			continue;
+
+		default:
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("LEB %llu is not migrating\n",
+				  cur_leb_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+			continue;
+		}
+
+		pebd = &pebr.pebs[SSDFS_MAPTBL_RELATION_INDEX];
+
+		switch (pebd->state) {
+		case SSDFS_MAPTBL_MIGRATION_DST_CLEAN_STATE:
+		case SSDFS_MAPTBL_MIGRATION_DST_USING_STATE:
+			/* stimulate migration */
+			break;
+
+		default:
+			continue;
+		}
+
+		if (ssdfs_gc_should_stop(ctx))
+			return -EINTR;
+
+		peb_type = pebd->type;
+		seg_type = PEB2SEG_TYPE(peb_type);
+		break;
+	}
+
+	if (i >= lebs_per_segment) {
+		/* segment hasn't valid blocks for migration */
+		return 0;
+	}
+
+	ssdfs_segment_tree_lock_eviction(fsi);
+
+	si = ssdfs_segment_tree_find(fsi, seg_id);
+	if (IS_ERR_OR_NULL(si)) {
+		ssdfs_segment_tree_unlock_eviction(fsi);
+
+		err = PTR_ERR(si);
+
+		if (err == 0) {
+			SSDFS_ERR("seg tree returns NULL\n");
+			return -ERANGE;
+		} else if (err != -ENODATA) {
 			SSDFS_ERR("fail to find segment: "
-				  "seg_id %llu, nsegs %llu, err %d\n",
-				  seg_id, nsegs, err);
-			goto sleep_failed_gc_thread;
+				  "seg %llu, err %d\n",
+				  seg_id, err);
+			return err;
 		}
 
+		/*
+		 * It needs to create the segment.
+		 */
+		si = ssdfs_grab_segment(fsi, seg_type, seg_id, U64_MAX);
+		if (unlikely(IS_ERR_OR_NULL(si))) {
+			err = !si ? -ERANGE : PTR_ERR(si);
+			SSDFS_ERR("fail to grab segment object: "
+				  "seg %llu, err %d\n",
+				  seg_id, err);
+			return err;
+		}
+	} else if (should_ssdfs_segment_be_destroyed(si)) {
+		/*
+		 * Segment hasn't requests in the queues.
+		 * But it is under migration.
+		 * Try to collect the garbage.
+		 */
+		ssdfs_segment_get_object(si);
+		ssdfs_segment_tree_unlock_eviction(fsi);
+	} else {
+		/*
+		 * Segment is in use. Only try to compact
+		 * the block bitmaps that are idle for a long time.
+		 */
+		ssdfs_segment_get_object(si);
+		ssdfs_segment_tree_unlock_eviction(fsi);
+
+		err = ssdfs_segment_blk_bmap_compact(&si->blk_bmap, false);
+		if (unlikely(err < 0)) {
+			SSDFS_WARN("fail to compact block bitmap: "
+				   "seg %llu, err %d\n",
+				   seg_id, err);
+		}
+
+		ssdfs_segment_put_object(si);
+		return 0;
+	}
+
+	err = ssdfs_mark_segment_under_gc_activity(si);
+	if (err) {
 #ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("found segment: "
-			  "seg_id %llu, seg_state %#x\n",
-			  seg_id, seg_state);
+		SSDFS_DBG("segment %llu is busy\n",
+			  si->seg_id);
 #endif /* CONFIG_SSDFS_DEBUG */
+		ssdfs_segment_put_object(si);
+		return 0;
+	}
 
-		if (kthread_should_stop())
-			goto finish_seg_processing;
+	for (; i < lebs_per_segment; i++) {
+		cur_leb_id = ssdfs_get_leb_id_for_peb_index(fsi, seg_id, i);
+		if (cur_leb_id >= U64_MAX) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("unexpected leb_id: "
+				  "seg_id %llu, peb_index %u\n",
+				  seg_id, i);
+#endif /* CONFIG_SSDFS_DEBUG */
+			continue;
+		}
 
-		i = 0;
+		if (ssdfs_gc_should_stop(ctx)) {
+			err = -EINTR;
+			goto finish_collection;
+		}
 
-		for (; i < lebs_per_segment; i++) {
-			cur_leb_id = ssdfs_get_leb_id_for_peb_index(fsi,
-								    seg_id,
-								    i);
-			if (cur_leb_id >= U64_MAX) {
+		err = ssdfs_gc_convert_leb2peb(fsi, cur_leb_id, &pebr);
+		if (err == -ENODATA) {
 #ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("unexpected leb_id: "
-					  "seg_id %llu, peb_index %u\n",
-					  seg_id, i);
+			SSDFS_DBG("LEB is not mapped: leb_id %llu\n",
+				  cur_leb_id);
 #endif /* CONFIG_SSDFS_DEBUG */
-				continue;
+			err = 0;
+			continue;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to convert LEB to PEB: "
+				  "leb_id %llu, peb_type %#x, err %d\n",
+				  cur_leb_id, peb_type, err);
+			goto finish_collection;
+		}
+
+		pebd = &pebr.pebs[SSDFS_MAPTBL_MAIN_INDEX];
+
+		switch (pebd->state) {
+		case SSDFS_MAPTBL_MIGRATION_SRC_USED_STATE:
+		case SSDFS_MAPTBL_MIGRATION_SRC_PRE_DIRTY_STATE:
+		case SSDFS_MAPTBL_MIGRATION_SRC_DIRTY_STATE:
+			/* PEB is under migration */
+			break;
+
+		default:
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("LEB %llu is not migrating\n",
+				  cur_leb_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+			continue;
+		}
+
+		pebd = &pebr.pebs[SSDFS_MAPTBL_RELATION_INDEX];
+
+		switch (pebd->state) {
+		case SSDFS_MAPTBL_MIGRATION_DST_CLEAN_STATE:
+		case SSDFS_MAPTBL_MIGRATION_DST_USING_STATE:
+			/* stimulate migration */
+			break;
+
+		default:
+			continue;
+		}
+
+		memset(&io_stats, 0, io_stats_size);
+		gc_strategy = SSDFS_UNDEFINED_GC_STATE;
+
+		do {
+			gc_strategy = is_time_collect_garbage(fsi, &io_stats);
+
+			switch (gc_strategy) {
+			case SSDFS_COLLECT_GARBAGE_NOW:
+				/* continue logic */
+				break;
+
+			case SSDFS_STOP_GC_ACTIVITY_NOW:
+				err = -EINTR;
+				goto finish_collection;
+
+			case SSDFS_WAIT_IDLE_STATE:
+				wait_event_interruptible_timeout(*wq,
+						ssdfs_gc_should_stop(ctx),
+						HZ);
+				break;
+
+			default:
+				err = -ERANGE;
+				SSDFS_ERR("unexpected strategy %#x\n",
+					  gc_strategy);
+				goto finish_collection;
 			}
 
-			if (kthread_should_stop())
-				goto finish_seg_processing;
+			if (ssdfs_gc_should_stop(ctx)) {
+				err = -EINTR;
+				goto finish_collection;
+			}
+		} while (gc_strategy == SSDFS_WAIT_IDLE_STATE);
 
-			err = ssdfs_gc_convert_leb2peb(fsi, cur_leb_id, &pebr);
+		pebc = &si->peb_array[i];
+
+		seg_blkbmap = &si->blk_bmap;
+		peb_blkbmap = &seg_blkbmap->peb[pebc->peb_index];
+
+		if (is_seg2req_pair_array_exhausted(&ctx->reqs_array))
+			ssdfs_gc_wait_commit_logs_end(fsi, &ctx->reqs_array);
+
+		used_pages = ssdfs_src_blk_bmap_get_used_pages(peb_blkbmap);
+		if (used_pages < 0) {
+			err = used_pages;
+			SSDFS_ERR("fail to get used pages: err %d\n",
+				  err);
+			goto finish_collection;
+		}
+
+		if (used_pages == 0) {
+			SSDFS_WARN("needs to finish migration: "
+				   "seg %llu, leb_id %llu, "
+				   "used_pages %d\n",
+				   seg_id, cur_leb_id, used_pages);
+		} else if (used_pages <= SSDFS_GC_FINISH_MIGRATION) {
+			ssdfs_segment_get_object(si);
+
+			err = ssdfs_gc_finish_migration(si, pebc,
+							&ctx->reqs_array);
+			if (unlikely(err)) {
+				SSDFS_ERR("fail to finish migration: "
+					  "seg %llu, leb_id %llu, "
+					  "err %d\n",
+					  seg_id, cur_leb_id, err);
+				err = 0;
+				ssdfs_segment_put_object(si);
+			}
+		} else {
+			ssdfs_segment_get_object(si);
+
+			err = ssdfs_gc_stimulate_migration(si, pebc,
+							   &ctx->reqs_array);
 			if (err == -ENODATA) {
 #ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("LEB is not mapped: leb_id %llu\n",
-					  cur_leb_id);
+				SSDFS_DBG("no data for migration: "
+					  "seg %llu, leb_id %llu, "
+					  "err %d\n",
+					  seg_id, cur_leb_id, err);
 #endif /* CONFIG_SSDFS_DEBUG */
-				continue;
+				err = 0;
+				ssdfs_segment_put_object(si);
 			} else if (unlikely(err)) {
-				SSDFS_ERR("fail to convert LEB to PEB: "
-					  "leb_id %llu, peb_type %#x, err %d\n",
-					  cur_leb_id, peb_type, err);
-				goto sleep_failed_gc_thread;
+				SSDFS_ERR("fail to stimulate migration: "
+					  "seg %llu, leb_id %llu, "
+					  "err %d\n",
+					  seg_id, cur_leb_id, err);
+				err = 0;
+				ssdfs_segment_put_object(si);
 			}
+		}
+	}
 
-			pebd = &pebr.pebs[SSDFS_MAPTBL_MAIN_INDEX];
+	if (is_seg2req_pair_array_exhausted(&ctx->reqs_array))
+		ssdfs_gc_wait_commit_logs_end(fsi, &ctx->reqs_array);
 
-			switch (pebd->state) {
-			case SSDFS_MAPTBL_MIGRATION_SRC_USED_STATE:
-			case SSDFS_MAPTBL_MIGRATION_SRC_PRE_DIRTY_STATE:
-				/* PEB is under migration */
-				break;
+finish_collection:
+	if (ssdfs_revert_segment_to_regular_activity(si)) {
+		SSDFS_ERR("segment %llu is under unexpected activity\n",
+			  si->seg_id);
+		ssdfs_segment_put_object(si);
+		return -ERANGE;
+	}
 
-			case SSDFS_MAPTBL_MIGRATION_SRC_DIRTY_STATE:
-#ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("SRC PEB %llu is dirty\n",
-					  pebd->peb_id);
-#endif /* CONFIG_SSDFS_DEBUG */
-				continue;
+	/*
+	 * The reference is kept till the eviction lock
+	 * is taken. Otherwise, the shrinker could destroy
+	 * the idle segment object in parallel.
+	 */
+	ssdfs_segment_tree_lock_eviction(fsi);
 
-			default:
+	ssdfs_segment_put_object(si);
+
+	if (should_ssdfs_segment_be_destroyed(si)) {
+		int res = ssdfs_segment_tree_remove(fsi, si);
+
+		if (unlikely(res)) {
+			SSDFS_WARN("fail to remove segment: "
+				   "seg %llu, err %d\n",
+				   si->seg_id, res);
+		} else {
+			res = ssdfs_segment_destroy_object(si);
+			if (res) {
+				SSDFS_WARN("fail to destroy: "
+					   "seg %llu, err %d\n",
+					   si->seg_id, res);
+			}
+		}
+	}
+
+	ssdfs_segment_tree_unlock_eviction(fsi);
+
+	return err;
+}
+
+/*
+ * ssdfs_gc_take_victim() - take the next victim of search window
+ * @pool: pool of GC workers
+ * @seg_id: victim segment ID [out]
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - no victims for processing.
+ */
+static inline
+int ssdfs_gc_take_victim(struct ssdfs_gc_pool *pool, u64 *seg_id)
+{
+	struct ssdfs_gc_victims *victims;
+	int err = 0;
+
+	spin_lock(&pool->lock);
+	victims = pool->victims;
+	if (READ_ONCE(pool->stop) || victims->pos >= victims->count)
+		err = -ENODATA;
+	else {
+		*seg_id = victims->seg_id[victims->pos];
+		victims->pos++;
+	}
+	spin_unlock(&pool->lock);
+
+	return err;
+}
+
+/*
+ * ssdfs_gc_stop_victims_processing() - stop processing of victims
+ * @pool: pool of GC workers
+ * @err: error code of processing
+ */
+static inline
+void ssdfs_gc_stop_victims_processing(struct ssdfs_gc_pool *pool, int err)
+{
+	spin_lock(&pool->lock);
+	WRITE_ONCE(pool->stop, true);
+	if (err != -EINTR && !pool->err)
+		pool->err = err;
+	spin_unlock(&pool->lock);
+
+	wake_up_all(&pool->fsi->gc_wait_queue[pool->thread_type]);
+}
+
+/*
+ * ssdfs_gc_process_victims() - process victims of search window
+ * @ctx: context of victim segment's processing
+ *
+ * This function takes the victims one by one until the ranked
+ * victims array is exhausted or the processing is stopped.
+ * The delay between the victims is defined by GC governor.
+ */
+static
+void ssdfs_gc_process_victims(struct ssdfs_gc_victim_ctx *ctx)
+{
+	struct ssdfs_gc_pool *pool = ctx->pool;
+	struct ssdfs_fs_info *fsi = pool->fsi;
+	wait_queue_head_t *wq = &fsi->gc_wait_queue[pool->thread_type];
+	u64 seg_id;
+	int err;
+
+	while (ssdfs_gc_take_victim(pool, &seg_id) == 0) {
 #ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("LEB %llu is not migrating\n",
-					  cur_leb_id);
+		SSDFS_DBG("take victim: seg_id %llu, thread_type %#x\n",
+			  seg_id, pool->thread_type);
 #endif /* CONFIG_SSDFS_DEBUG */
-				continue;
-			}
 
-			pebd = &pebr.pebs[SSDFS_MAPTBL_RELATION_INDEX];
+		err = ssdfs_gc_collect_victim(ctx, seg_id);
+		if (err) {
+			ssdfs_gc_stop_victims_processing(pool, err);
+			break;
+		}
 
-			switch (pebd->state) {
-			case SSDFS_MAPTBL_MIGRATION_DST_CLEAN_STATE:
-			case SSDFS_MAPTBL_MIGRATION_DST_USING_STATE:
-				/* stimulate migration */
-				break;
+		atomic_dec_if_positive(&fsi->gc_should_act[pool->thread_type]);
 
-			default:
-				continue;
-			}
+		if (ssdfs_gc_should_stop(ctx))
+			break;
 
-			if (kthread_should_stop())
-				goto finish_seg_processing;
+		if (!should_gc_continue(fsi, pool->thread_type)) {
+			ssdfs_gc_stop_victims_processing(pool, -EINTR);
+			break;
+		}
 
-			peb_type = pebd->type;
-			seg_type = PEB2SEG_TYPE(peb_type);
+		wait_event_interruptible_timeout(*wq,
+					ssdfs_gc_should_stop(ctx),
+					ssdfs_gc_governor_delay(fsi));
+		cond_resched();
+	}
 
-			goto try_to_find_seg_object;
-		}
+	ssdfs_gc_wait_commit_logs_end(fsi, &ctx->reqs_array);
+}
 
-		if (i >= lebs_per_segment) {
-			/* segment hasn't valid blocks for migration */
-			goto check_next_segment;
-		}
+/*
+ * ssdfs_gc_worker_func() - function of GC worker
+ * @work: work item of GC worker
+ */
+static
+void ssdfs_gc_worker_func(struct work_struct *work)
+{
+	struct ssdfs_gc_worker *worker;
+	struct ssdfs_gc_pool *pool;
 
-try_to_find_seg_object:
-		si = ssdfs_segment_tree_find(fsi, seg_id);
-		if (IS_ERR_OR_NULL(si)) {
-			err = PTR_ERR(si);
+	worker = container_of(work, struct ssdfs_gc_worker, work);
+	pool = worker->ctx.pool;
 
-			if (err == -ENODATA) {
-				/*
-				 * It needs to create the segment.
-				 */
-				err = 0;
-				goto try_create_seg_object;
-			} else if (err == 0) {
-				err = -ERANGE;
-				SSDFS_ERR("seg tree returns NULL\n");
-				goto finish_seg_processing;
-			} else {
-				SSDFS_ERR("fail to find segment: "
-					  "seg %llu, err %d\n",
-					  seg_id, err);
-				goto sleep_failed_gc_thread;
-			}
-		} else if (should_ssdfs_segment_be_destroyed(si)) {
-			/*
-			 * Segment hasn't requests in the queues.
-			 * But it is under migration.
-			 * Try to collect the garbage.
-			 */
-			ssdfs_segment_get_object(si);
-			goto try_collect_garbage;
-		} else
-			goto check_next_segment;
+	ssdfs_gc_process_victims(&worker->ctx);
 
-try_create_seg_object:
-		si = ssdfs_grab_segment(fsi, seg_type, seg_id, U64_MAX);
-		if (unlikely(IS_ERR_OR_NULL(si))) {
-			err = PTR_ERR(si);
-			SSDFS_ERR("fail to grab segment object: "
-				  "seg %llu, err %d\n",
-				  seg_id, err);
-			goto sleep_failed_gc_thread;
+	if (atomic_dec_and_test(&pool->active))
+		wake_up_all(&pool->wait);
+}
+
+/*
+ * ssdfs_gc_pool_init() - initialize pool of GC workers
+ * @pool: pool of GC workers
+ * @fsi: pointer on shared file system object
+ * @thread_type: GC thread type
+ *
+ * The number of GC workers is limited by the number of online CPUs.
+ * If the pool cannot be created, then GC thread processes
+ * the victims by itself.
+ */
+static
+void ssdfs_gc_pool_init(struct ssdfs_gc_pool *pool,
+			struct ssdfs_fs_info *fsi,
+			int thread_type)
+{
+	size_t peb_relation_size = sizeof(struct ssdfs_maptbl_peb_relation);
+	u32 lebs_per_segment = fsi->pebs_per_seg;
+	struct ssdfs_gc_victim_ctx *ctx;
+	u32 workers_count;
+	u32 i;
+
+	memset(pool, 0, sizeof(struct ssdfs_gc_pool));
+	pool->fsi = fsi;
+	pool->thread_type = thread_type;
+	spin_lock_init(&pool->lock);
+	atomic_set(&pool->active, 0);
+	init_waitqueue_head(&pool->wait);
+
+	workers_count = min_t(u32, num_online_cpus(), SSDFS_GC_WORKERS_MAX);
+
+	if (workers_count > 1) {
+		pool->wq = alloc_workqueue("ssdfs-gc-%d",
+					   WQ_UNBOUND | WQ_MEM_RECLAIM,
+					   workers_count, thread_type);
+		if (!pool->wq) {
+			SSDFS_DBG("unable to create GC workqueue\n");
+			workers_count = 1;
 		}
+	}
 
-try_collect_garbage:
-		for (; i < lebs_per_segment; i++) {
-			cur_leb_id = ssdfs_get_leb_id_for_peb_index(fsi,
-								    seg_id,
-								    i);
-			if (cur_leb_id >= U64_MAX) {
-#ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("unexpected leb_id: "
-					  "seg_id %llu, peb_index %u\n",
-					  seg_id, i);
-#endif /* CONFIG_SSDFS_DEBUG */
-				continue;
+	pool->workers = ssdfs_gc_kcalloc(workers_count,
+					 sizeof(struct ssdfs_gc_worker),
+					 GFP_KERNEL);
+	if (!pool->workers && workers_count > 1) {
+		SSDFS_DBG("unable to allocate GC workers\n");
+		destroy_workqueue(pool->wq);
+		pool->wq = NULL;
+		workers_count = 1;
+		pool->workers = ssdfs_gc_kcalloc(workers_count,
+					sizeof(struct ssdfs_gc_worker),
+					GFP_KERNEL);
+	}
+
+	if (!pool->workers) {
+		SSDFS_DBG("unable to allocate GC worker\n");
+		return;
+	}
+
+	pool->workers_count = workers_count;
+
+	for (i = 0; i < workers_count; i++) {
+		INIT_WORK(&pool->workers[i].work, ssdfs_gc_worker_func);
+		ctx = &pool->workers[i].ctx;
+		ctx->pool = pool;
+
+		ctx->leb_ids = ssdfs_gc_kcalloc(lebs_per_segment,
+						sizeof(u64), GFP_KERNEL);
+		ctx->pebr_array = ssdfs_gc_kcalloc(lebs_per_segment,
+						   peb_relation_size,
+						   GFP_KERNEL);
+		if (!ctx->leb_ids || !ctx->pebr_array) {
+			/* convert LEBs one by one */
+			SSDFS_DBG("unable to allocate LEB/PEB "
+				  "conversion buffers\n");
+
+			if (ctx->leb_ids) {
+				ssdfs_gc_kfree(ctx->leb_ids);
+				ctx->leb_ids = NULL;
 			}
 
-			if (kthread_should_stop()) {
-				ssdfs_segment_put_object(si);
-				goto finish_seg_processing;
+			if (ctx->pebr_array) {
+				ssdfs_gc_kfree(ctx->pebr_array);
+				ctx->pebr_array = NULL;
 			}
+		}
+	}
+}
 
-			err = ssdfs_gc_convert_leb2peb(fsi, cur_leb_id, &pebr);
-			if (err == -ENODATA) {
-#ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("LEB is not mapped: leb_id %llu\n",
-					  cur_leb_id);
-#endif /* CONFIG_SSDFS_DEBUG */
-				continue;
-			} else if (unlikely(err)) {
-				SSDFS_ERR("fail to convert LEB to PEB: "
-					  "leb_id %llu, peb_type %#x, err %d\n",
-					  cur_leb_id, peb_type, err);
-				ssdfs_segment_put_object(si);
-				goto sleep_failed_gc_thread;
-			}
+/*
+ * ssdfs_gc_pool_destroy() - destroy pool of GC workers
+ * @pool: pool of GC workers
+ */
+static
+void ssdfs_gc_pool_destroy(struct ssdfs_gc_pool *pool)
+{
+	struct ssdfs_gc_victim_ctx *ctx;
+	u32 i;
 
-			pebd = &pebr.pebs[SSDFS_MAPTBL_MAIN_INDEX];
+	if (pool->wq) {
+		destroy_workqueue(pool->wq);
+		pool->wq = NULL;
+	}
 
-			switch (pebd->state) {
-			case SSDFS_MAPTBL_MIGRATION_SRC_USED_STATE:
-			case SSDFS_MAPTBL_MIGRATION_SRC_PRE_DIRTY_STATE:
-			case SSDFS_MAPTBL_MIGRATION_SRC_DIRTY_STATE:
-				/* PEB is under migration */
-				break;
+	for (i = 0; i < pool->workers_count; i++) {
+		ctx = &pool->workers[i].ctx;
 
-			default:
-#ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("LEB %llu is not migrating\n",
-					  cur_leb_id);
-#endif /* CONFIG_SSDFS_DEBUG */
-				continue;
-			}
+		if (ctx->leb_ids)
+			ssdfs_gc_kfree(ctx->leb_ids);
+		if (ctx->pebr_array)
+			ssdfs_gc_kfree(ctx->pebr_array);
+	}
 
-			pebd = &pebr.pebs[SSDFS_MAPTBL_RELATION_INDEX];
+	if (pool->workers)
+		ssdfs_gc_kfree(pool->workers);
 
-			switch (pebd->state) {
-			case SSDFS_MAPTBL_MIGRATION_DST_CLEAN_STATE:
-			case SSDFS_MAPTBL_MIGRATION_DST_USING_STATE:
-				/* stimulate migration */
-				break;
+	pool->workers = NULL;
+	pool->workers_count = 0;
+}
 
-			default:
-				continue;
-			}
+/*
+ * ssdfs_gc_pool_process_victims() - process victims by GC workers
+ * @pool: pool of GC workers
+ * @victims: ranked victims of search window
+ *
+ * This function distributes the victims between GC workers
+ * and waits the end of processing. GC works by one worker
+ * under I/O load. The victims are processed by all workers
+ * in idle or urgent mode.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINTR      - processing of victims has been stopped.
+ * %-ENOMEM     - GC workers are absent.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_gc_pool_process_victims(struct ssdfs_gc_pool *pool,
+				  struct ssdfs_gc_victims *victims)
+{
+	u32 workers_count;
+	s64 reqs_count;
+	u32 i;
+
+	if (unlikely(!pool->workers)) {
+		SSDFS_ERR("GC workers are absent\n");
+		return -ENOMEM;
+	}
+
+	pool->victims = victims;
+	pool->stop = false;
+	pool->err = 0;
 
-			memset(&io_stats, 0, io_stats_size);
-			gc_strategy = SSDFS_UNDEFINED_GC_STATE;
+	switch (ssdfs_gc_governor_mode(pool->fsi, &reqs_count)) {
+	case SSDFS_GC_IDLE_MODE:
+	case SSDFS_GC_URGENT_MODE:
+		workers_count = min_t(u32, pool->workers_count,
+				      victims->count - victims->pos);
+		break;
 
-			do {
-				gc_strategy = is_time_collect_garbage(fsi,
-								    &io_stats);
+	default:
+		workers_count = 1;
+		break;
+	}
 
-				switch (gc_strategy) {
-				case SSDFS_COLLECT_GARBAGE_NOW:
-					goto collect_garbage_now;
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("victims %u, workers_count %u, reqs_count %lld\n",
+		  victims->count - victims->pos,
+		  workers_count, reqs_count);
+#endif /* CONFIG_SSDFS_DEBUG */
 
-				case SSDFS_STOP_GC_ACTIVITY_NOW:
-					ssdfs_segment_put_object(si);
-					goto finish_seg_processing;
+	if (!pool->wq || workers_count <= 1) {
+		ssdfs_gc_process_victims(&pool->workers[0].ctx);
+		goto finish_processing;
+	}
 
-				case SSDFS_WAIT_IDLE_STATE:
-					wait_event_interruptible_timeout(*wq,
-							kthread_should_stop(),
-							HZ);
+	atomic_set(&pool->active, workers_count);
 
-					if (kthread_should_stop()) {
-						ssdfs_segment_put_object(si);
-						goto finish_seg_processing;
-					}
-					break;
-
-				default:
-					err = -ERANGE;
-					SSDFS_ERR("unexpected strategy %#x\n",
-						  gc_strategy);
-					ssdfs_segment_put_object(si);
-					goto finish_seg_processing;
-				}
-			} while (gc_strategy == SSDFS_WAIT_IDLE_STATE);
+	for (i = 0; i < workers_count; i++)
+		queue_work(pool->wq, &pool->workers[i].work);
 
-collect_garbage_now:
-			if (kthread_should_stop()) {
-				ssdfs_segment_put_object(si);
-				goto finish_seg_processing;
-			}
+	wait_event_interruptible(pool->wait,
+				 atomic_read(&pool->active) == 0 ||
+				 kthread_should_stop());
 
-			pebc = &si->peb_array[i];
+	if (atomic_read(&pool->active) > 0) {
+		ssdfs_gc_stop_victims_processing(pool, -EINTR);
+		wait_event(pool->wait, atomic_read(&pool->active) == 0);
+	}
 
-			seg_blkbmap = &si->blk_bmap;
-			peb_blkbmap = &seg_blkbmap->peb[pebc->peb_index];
+finish_processing:
+	pool->victims = NULL;
 
-			if (is_seg2req_pair_array_exhausted(&reqs_array))
-				ssdfs_gc_wait_commit_logs_end(fsi, &reqs_array);
+	if (pool->err)
+		return pool->err;
+	else if (pool->stop || kthread_should_stop())
+		return -EINTR;
 
-			used_pages =
-				ssdfs_src_blk_bmap_get_used_pages(peb_blkbmap);
-			if (used_pages < 0) {
-				err = used_pages;
-				SSDFS_ERR("fail to get used pages: err %d\n",
-					  err);
-				ssdfs_segment_put_object(si);
-				goto sleep_failed_gc_thread;
-			}
+	return 0;
+}
+
+/*
+ * ssdfs_generic_seg_gc_thread_func() - generic function of GC thread
+ * @fsi: pointer on shared file system object
+ * @thread_type: thread type
+ * @seg_state: type of segment
+ * @seg_state_mask: segment types' mask
+ *
+ * This function is the key logic of GC thread. The victims
+ * of every search window are processed in the order of
+ * descending cost-benefit score by the pool of GC workers.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_generic_seg_gc_thread_func(struct ssdfs_fs_info *fsi,
+				     int thread_type,
+				     int seg_state, int seg_state_mask)
+{
+	struct ssdfs_gc_pool pool;
+	struct ssdfs_gc_victims victims;
+	wait_queue_head_t *wq;
+	u64 search_seg_id = 0;
+	u64 max_seg_id;
+	u64 seg_id_step = SSDFS_GC_DEFAULT_SEARCH_STEP;
+	u64 nsegs;
+	int err = 0;
 
-			err = ssdfs_mark_segment_under_gc_activity(si);
-			if (err) {
 #ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("segment %llu is busy\n",
-					  si->seg_id);
+	BUG_ON(!fsi);
+
+	SSDFS_DBG("GC thread: thread_type %#x, "
+		  "seg_state %#x, seg_state_mask %#x\n",
+		  thread_type, seg_state, seg_state_mask);
 #endif /* CONFIG_SSDFS_DEBUG */
-				goto check_next_segment;
-			}
 
-			if (used_pages == 0) {
-				SSDFS_WARN("needs to finish migration: "
-					   "seg %llu, leb_id %llu, "
-					   "used_pages %d\n",
-					   seg_id, cur_leb_id, used_pages);
-			} else if (used_pages <= SSDFS_GC_FINISH_MIGRATION) {
-				ssdfs_segment_get_object(si);
+	wq = &fsi->gc_wait_queue[thread_type];
+	memset(&victims, 0, sizeof(struct ssdfs_gc_victims));
 
-				err = ssdfs_gc_finish_migration(si, pebc,
-								&reqs_array);
-				if (unlikely(err)) {
-					SSDFS_ERR("fail to finish migration: "
-						  "seg %llu, leb_id %llu, "
-						  "err %d\n",
-						  seg_id, cur_leb_id, err);
-					err = 0;
-					ssdfs_segment_put_object(si);
-				}
-			} else {
-				ssdfs_segment_get_object(si);
-
-				err = ssdfs_gc_stimulate_migration(si, pebc,
-								   &reqs_array);
-				if (err == -ENODATA) {
-#ifdef CONFIG_SSDFS_DEBUG
-					SSDFS_DBG("no data for migration: "
-						  "seg %llu, leb_id %llu, "
-						  "err %d\n",
-						  seg_id, cur_leb_id, err);
-#endif /* CONFIG_SSDFS_DEBUG */
-					err = 0;
-					ssdfs_segment_put_object(si);
-				} else if (unlikely(err)) {
-					SSDFS_ERR("fail to stimulate migration: "
-						  "seg %llu, leb_id %llu, "
-						  "err %d\n",
-						  seg_id, cur_leb_id, err);
-					err = 0;
-					ssdfs_segment_put_object(si);
-				}
-			}
-		}
+	ssdfs_gc_pool_init(&pool, fsi, thread_type);
+	if (!pool.workers)
+		err = -ENOMEM;
 
-		ssdfs_segment_put_object(si);
+repeat:
+	if (kthread_should_stop()) {
+		ssdfs_gc_pool_destroy(&pool);
+		complete_all(&fsi->gc_thread[thread_type].full_stop);
+		return err;
+	} else if (unlikely(err))
+		goto sleep_failed_gc_thread;
 
-		if (is_seg2req_pair_array_exhausted(&reqs_array))
-			ssdfs_gc_wait_commit_logs_end(fsi, &reqs_array);
+	mutex_lock(&fsi->resize_mutex);
+	nsegs = fsi->nsegs;
+	mutex_unlock(&fsi->resize_mutex);
 
-		err = ssdfs_revert_segment_to_regular_activity(si);
-		if (unlikely(err)) {
-			SSDFS_ERR("segment %llu is under unexpected activity\n",
-				  si->seg_id);
-			goto sleep_failed_gc_thread;
-		}
+	if (search_seg_id >= nsegs)
+		search_seg_id = 0;
 
-		if (should_ssdfs_segment_be_destroyed(si)) {
-			err = ssdfs_segment_tree_remove(fsi, si);
-			if (unlikely(err)) {
-				SSDFS_WARN("fail to remove segment: "
-					   "seg %llu, err %d\n",
-					   si->seg_id, err);
-			} else {
-				err = ssdfs_segment_destroy_object(si);
-				if (err) {
-					SSDFS_WARN("fail to destroy: "
-						   "seg %llu, err %d\n",
-						   si->seg_id, err);
-				}
-			}
-		}
+	while (search_seg_id < nsegs) {
+		max_seg_id = search_seg_id + seg_id_step;
+		max_seg_id = min_t(u64, max_seg_id, nsegs);
 
-check_next_segment:
-		seg_id++;
+		err = ssdfs_gc_select_victims(fsi, search_seg_id, max_seg_id,
+					      seg_state, seg_state_mask,
+					      &victims);
+		if (err == -ENODATA) {
+			err = 0;
 
-		atomic_dec(&fsi->gc_should_act[thread_type]);
+			if (max_seg_id >= nsegs) {
+				search_seg_id = 0;
+				SSDFS_DBG("GC hasn't found any victim\n");
+				goto finish_seg_processing;
+			}
 
-		if (kthread_should_stop())
-			goto finish_seg_processing;
+			search_seg_id = max_seg_id;
 
-		if (atomic_read(&fsi->gc_should_act[thread_type]) > 0) {
 			wait_event_interruptible_timeout(*wq,
-						kthread_should_stop(),
-						HZ);
-		} else
+					kthread_should_stop(),
+					ssdfs_gc_governor_delay(fsi));
+
+			if (kthread_should_stop())
+				goto finish_seg_processing;
+			else
+				continue;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to find segment: "
+				  "seg_id %llu, nsegs %llu, err %d\n",
+				  search_seg_id, nsegs, err);
+			goto sleep_failed_gc_thread;
+		}
+
+		search_seg_id = victims.next_seg_id;
+
+		err = ssdfs_gc_pool_process_victims(&pool, &victims);
+		if (err == -EINTR) {
+			err = 0;
 			goto finish_seg_processing;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to process victims: "
+				  "thread_type %#x, err %d\n",
+				  thread_type, err);
+			goto sleep_failed_gc_thread;
+		}
 
 		if (kthread_should_stop())
 			goto finish_seg_processing;
@@ -2172,16 +3031,17 @@ check_next_segment:
 finish_seg_processing:
 	atomic_set(&fsi->gc_should_act[thread_type], 0);
 
-	ssdfs_gc_wait_commit_logs_end(fsi, &reqs_array);
+	if (victims.pos < victims.count)
+		search_seg_id = ssdfs_gc_drop_victims(&victims);
 
-	wait_event_interruptible(*wq,
-		GLOBAL_GC_THREAD_WAKE_CONDITION(fsi, thread_type));
+	ssdfs_gc_wait_next_pass(fsi, thread_type);
 	goto repeat;
 
 sleep_failed_gc_thread:
 	atomic_set(&fsi->gc_should_act[thread_type], 0);
 
-	ssdfs_gc_wait_commit_logs_end(fsi, &reqs_array);
+	if (victims.pos < victims.count)
+		search_seg_id = ssdfs_gc_drop_victims(&victims);
 
 	wait_event_interruptible(*wq,
 		GLOBAL_GC_FAILED_THREAD_WAKE_CONDITION());
@@ -2343,8 +3203,12 @@ repeat:
 		}
 
 try_to_find_seg_object:
+		ssdfs_segment_tree_lock_eviction(fsi);
+
 		si = ssdfs_segment_tree_find(fsi, seg_id);
 		if (IS_ERR_OR_NULL(si)) {
+			ssdfs_segment_tree_unlock_eviction(fsi);
+
 			err = PTR_ERR(si);
 
 			if (err == -ENODATA) {
@@ -2374,8 +3238,12 @@ try_to_find_seg_object:
 						   si->seg_id, err);
 				}
 			}
-		} else
+
+			ssdfs_segment_tree_unlock_eviction(fsi);
+		} else {
+			ssdfs_segment_tree_unlock_eviction(fsi);
 			goto check_next_segment;
+		}
 
 try_set_pre_erase_state:
 		for (; i < lebs_per_segment; i++) {
@@ -2612,8 +3480,12 @@ int ssdfs_collect_dirty_segments_now(struct ssdfs_fs_info *fsi)
 		}
 
 try_to_find_seg_object:
+		ssdfs_segment_tree_lock_eviction(fsi);
+
 		si = ssdfs_segment_tree_find(fsi, seg_id);
 		if (IS_ERR_OR_NULL(si)) {
+			ssdfs_segment_tree_unlock_eviction(fsi);
+
 			err = PTR_ERR(si);
 
 			if (err == -ENODATA) {
@@ -2643,8 +3515,12 @@ try_to_find_seg_object:
 						   si->seg_id, err);
 				}
 			}
-		} else
+
+			ssdfs_segment_tree_unlock_eviction(fsi);
+		} else {
+			ssdfs_segment_tree_unlock_eviction(fsi);
 			goto check_next_segment;
+		}
 
 try_set_pre_erase_state:
 		for (; i < lebs_per_segment; i++) {
@@ -232,6 +232,79 @@ int ssdfs_peb_mapping_queue_remove_first(struct ssdfs_peb_mapping_queue *pmq,
 	return err;
 }
 
+/*
+ * ssdfs_peb_mapping_queue_remove_batch() - move several mappings into batch
+ * @pmq: PEB mappings queue
+ * @batch: list of PEB mappings' batch [out]
+ * @max_count: max number of PEB mappings in the batch
+ *
+ * This function moves up to @max_count PEB mappings from the head
+ * of @pmq into the tail of @batch. The queue's lock is taken
+ * only once for the whole batch and the order of mappings
+ * is kept.
+ *
+ * RETURN: number of PEB mappings moved into the batch.
+ */
+int ssdfs_peb_mapping_queue_remove_batch(struct ssdfs_peb_mapping_queue *pmq,
+					 struct list_head *batch,
+					 int max_count)
+{
+	LIST_HEAD(tmp_list);
+	struct list_head *pos;
+	int count = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pmq || !batch);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (max_count <= 0)
+		return 0;
+
+	spin_lock(&pmq->lock);
+	list_for_each(pos, &pmq->list) {
+		if (++count >= max_count)
+			break;
+	}
+
+	if (pos == &pmq->list)
+		list_splice_init(&pmq->list, &tmp_list);
+	else
+		list_cut_position(&tmp_list, &pmq->list, pos);
+	spin_unlock(&pmq->lock);
+
+	list_splice_tail(&tmp_list, batch);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("max_count %d, count %d\n",
+		  max_count, count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return count;
+}
+
+/*
+ * ssdfs_peb_mapping_queue_return_batch() - return batch at the queue's head
+ * @pmq: PEB mappings queue
+ * @batch: list of PEB mappings' batch
+ *
+ * This function returns the unprocessed PEB mappings of @batch
+ * at the head of @pmq in the same order.
+ */
+void ssdfs_peb_mapping_queue_return_batch(struct ssdfs_peb_mapping_queue *pmq,
+					  struct list_head *batch)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pmq || !batch);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (list_empty(batch))
+		return;
+
+	spin_lock(&pmq->lock);
+	list_splice_init(batch, &pmq->list);
+	spin_unlock(&pmq->lock);
+}
+
 /*
  * ssdfs_peb_mapping_queue_remove_all() - remove all PEB mappings from queue
  * @pmq: PEB mappings queue
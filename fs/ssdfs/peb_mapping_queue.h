@@ -49,6 +49,11 @@ void ssdfs_peb_mapping_queue_add_head(struct ssdfs_peb_mapping_queue *pmq,
 				      struct ssdfs_peb_mapping_info *pmi);
 int ssdfs_peb_mapping_queue_remove_first(struct ssdfs_peb_mapping_queue *pmq,
 					 struct ssdfs_peb_mapping_info **pmi);
+int ssdfs_peb_mapping_queue_remove_batch(struct ssdfs_peb_mapping_queue *pmq,
+					 struct list_head *batch,
+					 int max_count);
+void ssdfs_peb_mapping_queue_return_batch(struct ssdfs_peb_mapping_queue *pmq,
+					  struct list_head *batch);
 void ssdfs_peb_mapping_queue_remove_all(struct ssdfs_peb_mapping_queue *pmq);
 
 /*
@@ -27,6 +27,7 @@
 #include <linux/slab.h>
 #include <linux/pagevec.h>
 #include <linux/delay.h>
+#include <linux/seqlock.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -382,6 +383,7 @@ int ssdfs_maptbl_create_fragment(struct ssdfs_fs_info *fsi, u32 index)
 	ptr = &fsi->maptbl->desc_array[index];
 
 	init_rwsem(&ptr->lock);
+	seqcount_init(&ptr->seq);
 	ptr->fragment_id = index;
 	ptr->fragment_pages = fsi->maptbl->fragment_pages;
 	ptr->start_leb = U64_MAX;
@@ -395,6 +397,7 @@ int ssdfs_maptbl_create_fragment(struct ssdfs_fs_info *fsi, u32 index)
 	ptr->reserved_pebs = 0;
 	ptr->pre_erase_pebs = 0;
 	ptr->recovering_pebs = 0;
+	ssdfs_maptbl_wear_stats_init(&ptr->wear);
 
 	err = ssdfs_create_page_array(ptr->fragment_pages, &ptr->array);
 	if (unlikely(err)) {
@@ -1412,6 +1415,7 @@ int ssdfs_maptbl_check_pebtbl_page(struct ssdfs_peb_container *pebc,
 	u16 unused_pebs = 0;
 	unsigned long *bmap;
 	int pre_erase_pebs, recovering_pebs;
+	u16 i;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -1572,6 +1576,25 @@ int ssdfs_maptbl_check_pebtbl_page(struct ssdfs_peb_container *pebc,
 		  reserved_pebs, unused_pebs);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	for (i = 0; i < pebs_count; i++) {
+		struct ssdfs_peb_descriptor *desc;
+
+		desc = GET_PEB_DESCRIPTOR(kaddr, i);
+		if (IS_ERR_OR_NULL(desc)) {
+			err = IS_ERR(desc) ? PTR_ERR(desc) : -ERANGE;
+			SSDFS_ERR("fail to get peb_descriptor: "
+				  "index %u, err %d\n",
+				  i, err);
+			goto finish_pebtbl_check;
+		}
+
+		if (desc->state == SSDFS_MAPTBL_BAD_PEB_STATE)
+			continue;
+
+		ssdfs_maptbl_wear_stats_add(&fdesc->wear,
+					    le32_to_cpu(desc->erase_cycles));
+	}
+
 finish_pebtbl_check:
 	kunmap_local(kaddr);
 	ssdfs_unlock_page(page);
@@ -1593,15 +1616,11 @@ finish_pebtbl_check:
 		if (unused_lebs > threshold) {
 			unused_pages = (u64)unused_pebs * fsi->pages_per_peb;
 
-			spin_lock(&fsi->volume_state_lock);
-			fsi->free_pages += unused_pages;
-			free_pages = fsi->free_pages;
-			spin_unlock(&fsi->volume_state_lock);
+			percpu_counter_add(&fsi->free_pages, unused_pages);
+			free_pages = ssdfs_fs_counter_read(&fsi->free_pages);
 		} else {
 #ifdef CONFIG_SSDFS_DEBUG
-			spin_lock(&fsi->volume_state_lock);
-			free_pages = fsi->free_pages;
-			spin_unlock(&fsi->volume_state_lock);
+			free_pages = ssdfs_fs_counter_read(&fsi->free_pages);
 #endif /* CONFIG_SSDFS_DEBUG */
 		}
 
@@ -1740,7 +1759,7 @@ int ssdfs_maptbl_fragment_init(struct ssdfs_peb_container *pebc,
 		return -ERANGE;
 	}
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	ssdfs_maptbl_fragment_desc_init(tbl, area, fdesc);
 
@@ -1940,7 +1959,7 @@ finish_fragment_init:
 		}
 	}
 
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	complete_all(&fdesc->init_end);
 
@@ -2015,6 +2034,9 @@ void ssdfs_sb_maptbl_header_correct_state(struct ssdfs_peb_mapping_table *tbl)
  * @req: segment request
  *
  * This method tries to copy dirty page into request.
+ * The checksum of the page has been calculated by
+ * ssdfs_maptbl_set_fragment_checksum() under the same
+ * fragment's lock. So, it is re-checked in debug mode only.
  *
  * RETURN:
  * [success]
@@ -2030,11 +2052,13 @@ int ssdfs_maptbl_copy_dirty_page(struct ssdfs_peb_mapping_table *tbl,
 {
 	struct page *spage, *dpage;
 	void *kaddr1, *kaddr2;
+#ifdef CONFIG_SSDFS_DEBUG
 	struct ssdfs_leb_table_fragment_header *lhdr;
 	struct ssdfs_peb_table_fragment_header *phdr;
-	__le16 *magic;
 	__le32 csum;
 	u32 bytes_count;
+#endif /* CONFIG_SSDFS_DEBUG */
+	__le16 *magic;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -2053,6 +2077,7 @@ int ssdfs_maptbl_copy_dirty_page(struct ssdfs_peb_mapping_table *tbl,
 
 	magic = (__le16 *)kaddr1;
 	if (*magic == cpu_to_le16(SSDFS_LEB_TABLE_MAGIC)) {
+#ifdef CONFIG_SSDFS_DEBUG
 		lhdr = (struct ssdfs_leb_table_fragment_header *)kaddr1;
 		bytes_count = le32_to_cpu(lhdr->bytes_count);
 		csum = lhdr->checksum;
@@ -2066,7 +2091,9 @@ int ssdfs_maptbl_copy_dirty_page(struct ssdfs_peb_mapping_table *tbl,
 			lhdr->checksum = csum;
 			goto end_copy_dirty_page;
 		}
+#endif /* CONFIG_SSDFS_DEBUG */
 	} else if (*magic == cpu_to_le16(SSDFS_PEB_TABLE_MAGIC)) {
+#ifdef CONFIG_SSDFS_DEBUG
 		phdr = (struct ssdfs_peb_table_fragment_header *)kaddr1;
 		bytes_count = le32_to_cpu(phdr->bytes_count);
 		csum = phdr->checksum;
@@ -2080,6 +2107,7 @@ int ssdfs_maptbl_copy_dirty_page(struct ssdfs_peb_mapping_table *tbl,
 			phdr->checksum = csum;
 			goto end_copy_dirty_page;
 		}
+#endif /* CONFIG_SSDFS_DEBUG */
 	} else {
 		err = -ERANGE;
 		SSDFS_ERR("corrupted maptbl's page: index %lu\n",
@@ -2485,7 +2513,7 @@ int ssdfs_maptbl_update_fragment(struct ssdfs_peb_mapping_table *tbl,
 			  (pgoff_t)(tbl->fragment_pages - page_index));
 	end = page_index + range_len - 1;
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	fdesc->flush_req_count = 0;
 
@@ -2723,7 +2751,7 @@ finish_fragment_update:
 		}
 	}
 
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	pagevec_reinit(&pvec);
 	return err;
@@ -2953,11 +2981,11 @@ check_req_state:
 	case SSDFS_REQ_STARTED:
 		wq = &req->private.wait_queue;
 
-		up_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_unlock(fdesc);
 		err = wait_event_killable_timeout(*wq,
 					has_request_been_executed(req),
 					SSDFS_DEFAULT_TIMEOUT);
-		down_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_lock(fdesc);
 
 		if (err < 0)
 			WARN_ON(err < 0);
@@ -3029,7 +3057,7 @@ int ssdfs_maptbl_wait_flush_end(struct ssdfs_peb_mapping_table *tbl)
 	for (i = 0; i < fragments_count; i++) {
 		fdesc = &tbl->desc_array[i];
 
-		down_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_lock(fdesc);
 
 		switch (atomic_read(&fdesc->state)) {
 		case SSDFS_MAPTBL_FRAG_DIRTY:
@@ -3068,7 +3096,7 @@ int ssdfs_maptbl_wait_flush_end(struct ssdfs_peb_mapping_table *tbl)
 		}
 
 finish_fragment_processing:
-		up_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 		if (unlikely(err))
 			return err;
@@ -3285,7 +3313,7 @@ int ssdfs_maptbl_commit_logs(struct ssdfs_peb_mapping_table *tbl)
 	for (i = 0; i < fragments_count; i++) {
 		fdesc = &tbl->desc_array[i];
 
-		down_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_lock(fdesc);
 
 		switch (atomic_read(&fdesc->state)) {
 		case SSDFS_MAPTBL_FRAG_DIRTY:
@@ -3310,7 +3338,7 @@ int ssdfs_maptbl_commit_logs(struct ssdfs_peb_mapping_table *tbl)
 		}
 
 finish_fragment_processing:
-		up_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 		if (unlikely(err))
 			return err;
@@ -3355,7 +3383,7 @@ int ssdfs_maptbl_wait_commit_logs_end(struct ssdfs_peb_mapping_table *tbl)
 	for (i = 0; i < fragments_count; i++) {
 		fdesc = &tbl->desc_array[i];
 
-		down_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_lock(fdesc);
 
 		switch (atomic_read(&fdesc->state)) {
 		case SSDFS_MAPTBL_FRAG_DIRTY:
@@ -3410,7 +3438,7 @@ int ssdfs_maptbl_wait_commit_logs_end(struct ssdfs_peb_mapping_table *tbl)
 		}
 
 finish_fragment_processing:
-		up_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 		if (unlikely(err))
 			return err;
@@ -3670,9 +3698,9 @@ int ssdfs_maptbl_prepare_migration(struct ssdfs_peb_mapping_table *tbl)
 			return -ERANGE;
 		}
 
-		down_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_lock(fdesc);
 		err = __ssdfs_maptbl_prepare_migration(tbl, fdesc, i);
-		up_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to prepare migration: "
@@ -3720,7 +3748,7 @@ int ssdfs_maptbl_wait_prepare_migration_end(struct ssdfs_peb_mapping_table *tbl)
 	for (i = 0; i < fragments_count; i++) {
 		fdesc = &tbl->desc_array[i];
 
-		down_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_lock(fdesc);
 
 		for (j = 0; j < fdesc->flush_req_count; j++) {
 			req1 = &fdesc->flush_req1[j];
@@ -3745,7 +3773,7 @@ int ssdfs_maptbl_wait_prepare_migration_end(struct ssdfs_peb_mapping_table *tbl)
 		}
 
 finish_fragment_processing:
-		up_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 		if (unlikely(err))
 			return err;
@@ -3945,6 +3973,8 @@ int ssdfs_maptbl_resize(struct ssdfs_peb_mapping_table *tbl,
  *
  * This method tries to extract PEB ID and PEB descriptor
  * for the index of PEB descriptor in the PEB table.
+ * The caller has to hold the fragment's lock or to check
+ * the fragment's modification sequence after the call.
  *
  * RETURN:
  * [success]
@@ -3966,7 +3996,6 @@ int ssdfs_maptbl_get_peb_descriptor(struct ssdfs_maptbl_fragment_desc *fdesc,
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!fdesc || !peb_id || !peb_desc);
-	BUG_ON(!rwsem_is_locked(&fdesc->lock));
 
 	SSDFS_DBG("fdesc %p, index %u, peb_id %p, peb_desc %p\n",
 		  fdesc, index, peb_id, peb_desc);
@@ -4134,6 +4163,8 @@ pgoff_t LEBTBL_PAGE_INDEX(struct ssdfs_maptbl_fragment_desc *fdesc,
  *
  * This method tries to extract LEB descriptor
  * for the LEB ID number.
+ * The caller has to hold the fragment's lock or to check
+ * the fragment's modification sequence after the call.
  *
  * RETURN:
  * [success]
@@ -4154,7 +4185,6 @@ int ssdfs_maptbl_get_leb_descriptor(struct ssdfs_maptbl_fragment_desc *fdesc,
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!fdesc || !leb_desc);
-	BUG_ON(!rwsem_is_locked(&fdesc->lock));
 
 	SSDFS_DBG("fdesc %p, leb_id %llu, leb_desc %p\n",
 		  fdesc, leb_id, leb_desc);
@@ -4286,6 +4316,8 @@ ssdfs_maptbl_get_fragment_descriptor(struct ssdfs_peb_mapping_table *tbl,
  * @pebr: PEB relation [out]
  *
  * This method tries to retrieve PEB relation for @leb_desc.
+ * The caller has to hold the fragment's lock or to check
+ * the fragment's modification sequence after the call.
  *
  * RETURN:
  * [success]
@@ -4307,7 +4339,6 @@ int ssdfs_maptbl_get_peb_relation(struct ssdfs_maptbl_fragment_desc *fdesc,
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!fdesc || !leb_desc || !pebr);
-	BUG_ON(!rwsem_is_locked(&fdesc->lock));
 
 	SSDFS_DBG("fdesc %p, leb_desc %p, pebr %p\n",
 		  fdesc, leb_desc, pebr);
@@ -4374,6 +4405,56 @@ int ssdfs_maptbl_get_peb_relation(struct ssdfs_maptbl_fragment_desc *fdesc,
 	return 0;
 }
 
+/*
+ * ssdfs_maptbl_get_peb_relation_lockless() - lock-free PEB relation lookup
+ * @fdesc: fragment descriptor
+ * @leb_id: LEB ID number
+ * @pebr: PEB relation [out]
+ *
+ * This method tries to retrieve PEB relation for @leb_id without
+ * taking the fragment's lock. The result is valid only if
+ * the fragment's modification sequence has not been changed
+ * during the lookup. The method never waits for a writer but
+ * it asks the caller to repeat the lookup under the fragment's lock.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EBUSY      - fragment is under modification (use the lock).
+ * %-ENODATA    - unitialized LEB descriptor.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_maptbl_get_peb_relation_lockless(struct ssdfs_maptbl_fragment_desc *fdesc,
+					   u64 leb_id,
+					   struct ssdfs_maptbl_peb_relation *pebr)
+{
+	struct ssdfs_leb_descriptor leb_desc;
+	unsigned int seq;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fdesc || !pebr);
+
+	SSDFS_DBG("fdesc %p, leb_id %llu, pebr %p\n",
+		  fdesc, leb_id, pebr);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	seq = raw_read_seqcount(&fdesc->seq);
+	if (seq & 1)
+		return -EBUSY;
+
+	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
+	if (!err)
+		err = ssdfs_maptbl_get_peb_relation(fdesc, &leb_desc, pebr);
+
+	if (read_seqcount_retry(&fdesc->seq, seq))
+		return -EBUSY;
+
+	return err;
+}
+
 /*
  * should_cache_peb_info() - check that PEB info is cached
  * @peb_type: PEB type
@@ -5464,7 +5545,7 @@ void ssdfs_maptbl_set_fragment_dirty(struct ssdfs_peb_mapping_table *tbl,
 }
 
 /*
- * ssdfs_maptbl_convert_leb2peb() - get description of PEBs
+ * __ssdfs_maptbl_convert_leb2peb() - get description of PEBs
  * @fsi: file system info object
  * @leb_id: LEB ID number
  * @peb_type: PEB type
@@ -5483,11 +5564,12 @@ void ssdfs_maptbl_set_fragment_dirty(struct ssdfs_peb_mapping_table *tbl,
  * %-ENODATA    - LEB doesn't mapped to PEB yet.
  * %-ERANGE     - internal error.
  */
-int ssdfs_maptbl_convert_leb2peb(struct ssdfs_fs_info *fsi,
-				 u64 leb_id,
-				 u8 peb_type,
-				 struct ssdfs_maptbl_peb_relation *pebr,
-				 struct completion **end)
+static
+int __ssdfs_maptbl_convert_leb2peb(struct ssdfs_fs_info *fsi,
+				   u64 leb_id,
+				   u8 peb_type,
+				   struct ssdfs_maptbl_peb_relation *pebr,
+				   struct completion **end)
 {
 	struct ssdfs_peb_mapping_table *tbl;
 	struct ssdfs_maptbl_cache *cache;
@@ -5653,7 +5735,26 @@ start_convert_leb2peb:
 
 	switch (consistency) {
 	case SSDFS_PEB_STATE_CONSISTENT:
-		down_read(&fdesc->lock);
+		err = ssdfs_maptbl_get_peb_relation_lockless(fdesc, leb_id,
+							     pebr);
+		if (err != -EBUSY) {
+			if (err == -ENODATA) {
+#ifdef CONFIG_SSDFS_DEBUG
+				SSDFS_DBG("unable to get peb relation: "
+					  "leb_id %llu, err %d\n",
+					  leb_id, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+			} else if (unlikely(err)) {
+				SSDFS_ERR("fail to get peb relation: "
+					  "leb_id %llu, err %d\n",
+					  leb_id, err);
+			}
+			break;
+		}
+
+		memset(pebr, 0xFF, peb_relation_size);
+
+		SSDFS_DOWN_READ(maptbl_frag, &fdesc->lock);
 
 		err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 		if (unlikely(err)) {
@@ -5684,7 +5785,7 @@ finish_consistent_case:
 
 	case SSDFS_PEB_STATE_INCONSISTENT:
 		down_write(&cache->lock);
-		down_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_lock(fdesc);
 
 		err = ssdfs_maptbl_cache_convert_leb2peb_nolock(cache,
 								leb_id,
@@ -5763,7 +5864,7 @@ finish_consistent_case:
 		}
 
 finish_inconsistent_case:
-		up_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_unlock(fdesc);
 		up_write(&cache->lock);
 
 		if (!err) {
@@ -5774,7 +5875,7 @@ finish_inconsistent_case:
 
 	case SSDFS_PEB_STATE_PRE_DELETED:
 		down_write(&cache->lock);
-		down_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_lock(fdesc);
 
 		err = ssdfs_maptbl_cache_convert_leb2peb_nolock(cache,
 								leb_id,
@@ -5830,7 +5931,7 @@ finish_inconsistent_case:
 		}
 
 finish_pre_deleted_case:
-		up_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_unlock(fdesc);
 		up_write(&cache->lock);
 
 		if (!err) {
@@ -5904,6 +6005,370 @@ finish_conversion:
 	return err;
 }
 
+/*
+ * ssdfs_maptbl_convert_leb2peb() - get description of PEBs
+ * @fsi: file system info object
+ * @leb_id: LEB ID number
+ * @peb_type: PEB type
+ * @pebr: description of PEBs relation [out]
+ * @end: pointer on completion for waiting init ending [out]
+ *
+ * This method tries to get description of PEBs for the
+ * LEB ID number. The conversion is accounted as the cache lookup
+ * if the fragment of mapping table hasn't been accessed.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EAGAIN     - fragment is under initialization yet.
+ * %-EFAULT     - maptbl has inconsistent state.
+ * %-ENODATA    - LEB doesn't mapped to PEB yet.
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_maptbl_convert_leb2peb(struct ssdfs_fs_info *fsi,
+				 u64 leb_id,
+				 u8 peb_type,
+				 struct ssdfs_maptbl_peb_relation *pebr,
+				 struct completion **end)
+{
+	ktime_t start = ktime_get();
+	int err;
+
+	err = __ssdfs_maptbl_convert_leb2peb(fsi, leb_id, peb_type,
+					     pebr, end);
+
+	ssdfs_account_lookup(fsi,
+			     *end ? SSDFS_LOOKUP_MAPTBL_FRAGMENT :
+				    SSDFS_LOOKUP_MAPTBL_CACHE,
+			     start, err);
+
+	return err;
+}
+
+/*
+ * ssdfs_maptbl_get_wear_stats() - get wear statistics of mapping table
+ * @tbl: pointer on mapping table object
+ * @stats: wear statistics of the whole mapping table [out]
+ *
+ * This method aggregates the wear statistics of all
+ * initialized fragments of mapping table.
+ */
+void ssdfs_maptbl_get_wear_stats(struct ssdfs_peb_mapping_table *tbl,
+				 struct ssdfs_maptbl_wear_stats *stats)
+{
+	struct ssdfs_maptbl_fragment_desc *fdesc;
+	int state;
+	u32 i;
+	int j;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tbl || !stats);
+
+	SSDFS_DBG("tbl %p, stats %p\n", tbl, stats);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	ssdfs_maptbl_wear_stats_init(stats);
+
+	down_read(&tbl->tbl_lock);
+
+	for (i = 0; i < tbl->fragments_count; i++) {
+		fdesc = &tbl->desc_array[i];
+
+		state = atomic_read(&fdesc->state);
+		if (state == SSDFS_MAPTBL_FRAG_INIT_FAILED ||
+		    state == SSDFS_MAPTBL_FRAG_CREATED)
+			continue;
+
+		SSDFS_DOWN_READ(maptbl_frag, &fdesc->lock);
+
+		stats->min_erase_cycles = min_t(u32, stats->min_erase_cycles,
+						fdesc->wear.min_erase_cycles);
+		stats->max_erase_cycles = max_t(u32, stats->max_erase_cycles,
+						fdesc->wear.max_erase_cycles);
+		stats->total_erase_cycles += fdesc->wear.total_erase_cycles;
+		stats->pebs_count += fdesc->wear.pebs_count;
+
+		for (j = 0; j < SSDFS_MAPTBL_WEAR_BUCKETS; j++)
+			stats->histogram[j] += fdesc->wear.histogram[j];
+
+		up_read(&fdesc->lock);
+	}
+
+	up_read(&tbl->tbl_lock);
+}
+
+/*
+ * ssdfs_maptbl_convert_lebs2pebs_nolock() - convert LEBs of one fragment
+ * @tbl: pointer on mapping table object
+ * @leb_ids: array of LEB ID numbers
+ * @count: number of items in arrays
+ * @pebr_array: array of PEBs relation descriptions [out]
+ * @processed: number of processed items [in|out]
+ * @end: pointer on completion for waiting init ending [out]
+ *
+ * This method converts the sequence of LEBs that starts from
+ * @processed item and belongs to the same fragment. The fragment's
+ * lock is taken only once for the whole sequence. The caller
+ * has to hold the mapping table's lock.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EAGAIN     - fragment is under initialization yet.
+ * %-EFAULT     - fragment is corrupted.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_maptbl_convert_lebs2pebs_nolock(struct ssdfs_peb_mapping_table *tbl,
+				u64 *leb_ids, u32 count,
+				struct ssdfs_maptbl_peb_relation *pebr_array,
+				u32 *processed,
+				struct completion **end)
+{
+	struct ssdfs_maptbl_fragment_desc *fdesc;
+	struct ssdfs_leb_descriptor leb_desc;
+	size_t peb_relation_size = sizeof(struct ssdfs_maptbl_peb_relation);
+	u64 leb_id;
+	u32 i = *processed;
+	int state;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tbl || !leb_ids || !pebr_array || !processed || !end);
+	BUG_ON(!rwsem_is_locked(&tbl->tbl_lock));
+	BUG_ON(*processed >= count);
+
+	SSDFS_DBG("tbl %p, count %u, processed %u\n",
+		  tbl, count, *processed);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	fdesc = ssdfs_maptbl_get_fragment_descriptor(tbl, leb_ids[i]);
+	if (IS_ERR_OR_NULL(fdesc)) {
+		err = IS_ERR(fdesc) ? PTR_ERR(fdesc) : -ERANGE;
+		SSDFS_ERR("fail to get fragment descriptor: "
+			  "leb_id %llu, err %d\n",
+			  leb_ids[i], err);
+		return err;
+	}
+
+	*end = &fdesc->init_end;
+
+	state = atomic_read(&fdesc->state);
+	if (state == SSDFS_MAPTBL_FRAG_INIT_FAILED) {
+		SSDFS_ERR("fragment is corrupted: leb_id %llu\n",
+			  leb_ids[i]);
+		return -EFAULT;
+	} else if (state == SSDFS_MAPTBL_FRAG_CREATED) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("fragment is under initialization: "
+			  "leb_id %llu\n", leb_ids[i]);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return -EAGAIN;
+	}
+
+	SSDFS_DOWN_READ(maptbl_frag, &fdesc->lock);
+
+	for (; i < count; i++) {
+		leb_id = leb_ids[i];
+
+		memset(&pebr_array[i], 0xFF, peb_relation_size);
+
+		if (leb_id == U64_MAX)
+			continue;
+
+		if (leb_id < fdesc->start_leb ||
+		    leb_id >= (fdesc->start_leb + fdesc->lebs_count)) {
+			/* LEB belongs to another fragment */
+			break;
+		}
+
+		err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id,
+						      &leb_desc);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to get leb descriptor: "
+				  "leb_id %llu, err %d\n",
+				  leb_id, err);
+			goto finish_fragment_processing;
+		}
+
+		err = ssdfs_maptbl_get_peb_relation(fdesc, &leb_desc,
+						    &pebr_array[i]);
+		if (err == -ENODATA) {
+			err = 0;
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("LEB is not mapped: leb_id %llu\n",
+				  leb_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+			memset(&pebr_array[i], 0xFF, peb_relation_size);
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to get peb relation: "
+				  "leb_id %llu, err %d\n",
+				  leb_id, err);
+			goto finish_fragment_processing;
+		}
+	}
+
+finish_fragment_processing:
+	up_read(&fdesc->lock);
+
+	*processed = i;
+
+	return err;
+}
+
+/*
+ * ssdfs_maptbl_convert_lebs2pebs() - get description of PEBs for LEBs array
+ * @fsi: file system info object
+ * @leb_ids: array of LEB ID numbers
+ * @count: number of items in arrays
+ * @peb_type: PEB type
+ * @pebr_array: array of PEBs relation descriptions [out]
+ * @end: pointer on completion for waiting init ending [out]
+ *
+ * This method tries to get description of PEBs for the array
+ * of LEB ID numbers. The mapping table's lock is taken once
+ * for the whole array and every fragment's lock is taken once
+ * for a sequence of LEBs that belongs to the fragment.
+ * Unmapped LEBs (and U64_MAX items of @leb_ids) receive
+ * the relation with U64_MAX PEB IDs. The LEBs of PEB types
+ * that are processed by means of maptbl cache are converted
+ * one by one by ssdfs_maptbl_convert_leb2peb().
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EAGAIN     - fragment is under initialization yet.
+ * %-EFAULT     - maptbl has inconsistent state.
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_maptbl_convert_lebs2pebs(struct ssdfs_fs_info *fsi,
+				   u64 *leb_ids, u32 count,
+				   u8 peb_type,
+				   struct ssdfs_maptbl_peb_relation *pebr_array,
+				   struct completion **end)
+{
+	struct ssdfs_peb_mapping_table *tbl;
+	struct ssdfs_maptbl_cache *cache;
+	struct ssdfs_maptbl_peb_relation cached_pebr;
+	struct ssdfs_maptbl_peb_descriptor *ptr;
+	size_t peb_relation_size = sizeof(struct ssdfs_maptbl_peb_relation);
+	u32 i;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !leb_ids || !pebr_array || !end);
+
+	SSDFS_DBG("fsi %p, count %u, peb_type %#x\n",
+		  fsi, count, peb_type);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	*end = NULL;
+	tbl = fsi->maptbl;
+	cache = &fsi->maptbl_cache;
+
+	if (count == 0)
+		return 0;
+
+	if (!tbl || should_cache_peb_info(peb_type) ||
+	    (rwsem_is_locked(&tbl->tbl_lock) &&
+	     atomic_read(&tbl->flags) & SSDFS_MAPTBL_UNDER_FLUSH)) {
+		for (i = 0; i < count; i++) {
+			memset(&pebr_array[i], 0xFF, peb_relation_size);
+
+			if (leb_ids[i] == U64_MAX)
+				continue;
+
+			err = ssdfs_maptbl_convert_leb2peb(fsi, leb_ids[i],
+							   peb_type,
+							   &pebr_array[i],
+							   end);
+			if (err == -ENODATA) {
+				err = 0;
+				memset(&pebr_array[i], 0xFF,
+					peb_relation_size);
+			} else if (unlikely(err))
+				return err;
+		}
+
+		return 0;
+	}
+
+	if (atomic_read(&tbl->flags) & SSDFS_MAPTBL_ERROR) {
+		ssdfs_fs_error(tbl->fsi->sb,
+				__FILE__, __func__, __LINE__,
+				"maptbl has corrupted state\n");
+		return -EFAULT;
+	}
+
+	down_read(&tbl->tbl_lock);
+
+	i = 0;
+	while (i < count) {
+		if (leb_ids[i] == U64_MAX) {
+			memset(&pebr_array[i], 0xFF, peb_relation_size);
+			i++;
+			continue;
+		}
+
+		err = ssdfs_maptbl_convert_lebs2pebs_nolock(tbl, leb_ids, count,
+							    pebr_array, &i,
+							    end);
+		if (err == -EAGAIN) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("fragment is under initialization: "
+				  "leb_id %llu\n", leb_ids[i]);
+#endif /* CONFIG_SSDFS_DEBUG */
+			goto finish_conversion;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to convert LEBs to PEBs: "
+				  "leb_id %llu, err %d\n",
+				  leb_ids[i], err);
+			goto finish_conversion;
+		}
+	}
+
+finish_conversion:
+	up_read(&tbl->tbl_lock);
+
+	if (err)
+		return err;
+
+	for (i = 0; i < count; i++) {
+		ptr = &pebr_array[i].pebs[SSDFS_MAPTBL_MAIN_INDEX];
+
+		if (ptr->peb_id == U64_MAX)
+			continue;
+
+		if (!should_cache_peb_info(ptr->type))
+			continue;
+
+		err = ssdfs_maptbl_cache_convert_leb2peb(cache, leb_ids[i],
+							 &cached_pebr);
+		if (err == -ENODATA) {
+			err = 0;
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("cache has nothing for leb_id %llu\n",
+				  leb_ids[i]);
+#endif /* CONFIG_SSDFS_DEBUG */
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to convert LEB to PEB: "
+				  "leb_id %llu, err %d\n",
+				  leb_ids[i], err);
+			return err;
+		} else {
+			/* use the cached value */
+			ssdfs_memcpy(&pebr_array[i], 0, peb_relation_size,
+				     &cached_pebr, 0, peb_relation_size,
+				     peb_relation_size);
+		}
+	}
+
+	return 0;
+}
+
 /*
  * is_mapped_leb2peb() - check that LEB is mapped
  * @fdesc: fragment descriptor
@@ -6178,11 +6643,9 @@ int ssdfs_maptbl_decrease_reserved_pebs(struct ssdfs_fs_info *fsi,
 		hdr->reserved_pebs = cpu_to_le16(new_reservation);
 		desc->reserved_pebs -= new_unused_pebs;
 
-		spin_lock(&fsi->volume_state_lock);
 		new_free_pages = (u64)new_unused_pebs * fsi->pages_per_peb;
-		fsi->free_pages += new_free_pages;
-		free_pages = fsi->free_pages;
-		spin_unlock(&fsi->volume_state_lock);
+		percpu_counter_add(&fsi->free_pages, new_free_pages);
+		free_pages = ssdfs_fs_counter_read(&fsi->free_pages);
 
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("free_pages %llu, new_free_pages %llu\n",
@@ -6251,7 +6714,6 @@ int ssdfs_maptbl_increase_reserved_pebs(struct ssdfs_fs_info *fsi,
 	u16 used_pebs;
 	u16 unused_pebs;
 	u64 free_pages = 0;
-	u64 free_pebs = 0;
 	u64 reserved_pages = 0;
 	int err = 0;
 
@@ -6303,19 +6765,15 @@ int ssdfs_maptbl_increase_reserved_pebs(struct ssdfs_fs_info *fsi,
 		if (reserved_pebs < used_pebs && unused_pebs >= used_pebs) {
 			reserved_pebs = used_pebs;
 
-			spin_lock(&fsi->volume_state_lock);
-			free_pages = fsi->free_pages;
-			free_pebs = div64_u64(free_pages, fsi->pages_per_peb);
-			if (reserved_pebs <= free_pebs) {
-				reserved_pages = (u64)reserved_pebs *
-							fsi->pages_per_peb;
-				fsi->free_pages -= reserved_pages;
-				free_pages = fsi->free_pages;
+			reserved_pages = (u64)reserved_pebs *
+						fsi->pages_per_peb;
+			if (ssdfs_fs_counter_try_sub(&fsi->free_pages,
+						     reserved_pages)) {
 				hdr->reserved_pebs = cpu_to_le16(reserved_pebs);
 				desc->reserved_pebs += reserved_pebs;
 			} else
 				err = -ENOSPC;
-			spin_unlock(&fsi->volume_state_lock);
+			free_pages = ssdfs_fs_counter_read(&fsi->free_pages);
 
 #ifdef CONFIG_SSDFS_DEBUG
 			SSDFS_DBG("free_pages %llu, reserved_pages %llu, "
@@ -6351,18 +6809,13 @@ int ssdfs_maptbl_increase_reserved_pebs(struct ssdfs_fs_info *fsi,
 		return -ENOSPC;
 	}
 
-	spin_lock(&fsi->volume_state_lock);
-	free_pages = fsi->free_pages;
-	free_pebs = div64_u64(free_pages, fsi->pages_per_peb);
-	if (reserved_pebs <= free_pebs) {
-		reserved_pages = (u64)reserved_pebs * fsi->pages_per_peb;
-		fsi->free_pages -= reserved_pages;
-		free_pages = fsi->free_pages;
+	reserved_pages = (u64)reserved_pebs * fsi->pages_per_peb;
+	if (ssdfs_fs_counter_try_sub(&fsi->free_pages, reserved_pages)) {
 		le16_add_cpu(&hdr->reserved_pebs, reserved_pebs);
 		desc->reserved_pebs += reserved_pebs;
 	} else
 		err = -ENOSPC;
-	spin_unlock(&fsi->volume_state_lock);
+	free_pages = ssdfs_fs_counter_read(&fsi->free_pages);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("free_pages %llu, reserved_pages %llu, "
@@ -6377,231 +6830,52 @@ int ssdfs_maptbl_increase_reserved_pebs(struct ssdfs_fs_info *fsi,
 }
 
 /*
- * ssdfs_maptbl_get_erase_threshold() - detect erase threshold for fragment
- * @hdr: PEB table fragment's header
- * @start: start item for search
- * @max: upper bound for the search
- * @used_pebs: number of used PEBs
- * @found: found item index [out]
- * @erase_cycles: erase cycles for found item [out]
- *
- * This method tries to detect the erase threshold of
- * PEB table's fragment.
- *
- * RETURN:
- * [success]
- * [failure] - error code:
- *
- * %-EINVAL     - invalid input.
- * %-ENODATA    - unable to detect the erase threshold.
- */
-static int
-ssdfs_maptbl_get_erase_threshold(struct ssdfs_peb_table_fragment_header *hdr,
-				 unsigned long start, unsigned long max,
-				 unsigned long used_pebs,
-				 unsigned long *found, u32 *threshold)
-{
-	struct ssdfs_peb_descriptor *desc;
-	unsigned long *bmap;
-	unsigned long index, index1;
-	u32 found_cycles;
-	int step = 1;
-	int err = 0;
-
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!hdr || !found || !threshold);
-
-	SSDFS_DBG("hdr %p, start_peb %llu, pebs_count %u, "
-		  "start %lu, max %lu, used_pebs %lu\n",
-		  hdr,
-		  le64_to_cpu(hdr->start_peb),
-		  le16_to_cpu(hdr->pebs_count),
-		  start, max, used_pebs);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	bmap = (unsigned long *)&hdr->bmaps[SSDFS_PEBTBL_USED_BMAP][0];
-
-	*found = ULONG_MAX;
-	*threshold = U32_MAX;
-
-	index = max - 1;
-	while (index > 0) {
-#ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("index %lu, used_pebs %lu\n",
-			  index, used_pebs);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-		index1 = bitmap_find_next_zero_area(bmap,
-						    max, index,
-						    1, 0);
-		if (index1 >= max) {
-#ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("try next: index1 %lu >= max %lu\n",
-				  index1, max);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-			desc = GET_PEB_DESCRIPTOR(hdr, (u16)index);
-			if (IS_ERR_OR_NULL(desc)) {
-				err = IS_ERR(desc) ? PTR_ERR(desc) : -ERANGE;
-				SSDFS_ERR("fail to get peb_descriptor: "
-					  "index %lu, err %d\n",
-					  index, err);
-				return err;
-			}
-
-			if (desc->state != SSDFS_MAPTBL_BAD_PEB_STATE) {
-				found_cycles = le32_to_cpu(desc->erase_cycles);
-
-#ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("index %lu, found_cycles %u, "
-					  "threshold %u\n",
-					  index, found_cycles, *threshold);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-				if (*threshold > found_cycles)
-					*threshold = found_cycles;
-			}
-
-			goto try_next_index;
-		} else
-			index = index1;
-
-		if (index == *found)
-			goto finish_search;
-
-		desc = GET_PEB_DESCRIPTOR(hdr, (u16)index);
-		if (IS_ERR_OR_NULL(desc)) {
-			err = IS_ERR(desc) ? PTR_ERR(desc) : -ERANGE;
-			SSDFS_ERR("fail to get peb_descriptor: "
-				  "index %lu, err %d\n",
-				  index, err);
-			return err;
-		}
-
-		if (desc->state != SSDFS_MAPTBL_BAD_PEB_STATE) {
-			found_cycles = le32_to_cpu(desc->erase_cycles);
-
-#ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("index %lu, found_cycles %u, threshold %u\n",
-				  index, found_cycles, *threshold);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-			if (*found >= ULONG_MAX) {
-				*threshold = found_cycles;
-				*found = index;
-			} else if (*threshold > found_cycles) {
-				*threshold = found_cycles;
-				*found = index;
-			} else if (*threshold == found_cycles) {
-				/* continue search */
-				*found = index;
-			} else if ((*threshold + 1) <= found_cycles) {
-				*found = index;
-				goto finish_search;
-			}
-		}
-
-try_next_index:
-		if (index <= step)
-			break;
-
-		index -= step;
-		step *= 2;
-
-		while ((index - start) < step && step >= 2)
-			step /= 2;
-	}
-
-	if (*found >= ULONG_MAX) {
-		index = bitmap_find_next_zero_area(bmap,
-						   max, 0,
-						   1, 0);
-		if (index < max) {
-			desc = GET_PEB_DESCRIPTOR(hdr, (u16)index);
-			if (IS_ERR_OR_NULL(desc)) {
-				err = IS_ERR(desc) ? PTR_ERR(desc) : -ERANGE;
-				SSDFS_ERR("fail to get peb_descriptor: "
-					  "index %lu, err %d\n",
-					  index, err);
-				return err;
-			}
-
-			if (desc->state != SSDFS_MAPTBL_BAD_PEB_STATE) {
-				found_cycles = le32_to_cpu(desc->erase_cycles);
-				*threshold = found_cycles;
-				*found = index;
-			}
-		}
-	}
-
-finish_search:
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("found %lu, threshold %u\n",
-		  *found, *threshold);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	return 0;
-}
-
-/*
- * __ssdfs_maptbl_find_unused_peb() - find unused PEB
+ * __ssdfs_maptbl_find_unused_peb() - find the least worn unused PEB in range
  * @hdr: PEB table fragment's header
  * @start: start item for search
  * @max: upper bound for the search
- * @threshold: erase threshold for fragment
- * @found: found item index [out]
+ * @lower_bound: lower bound of erase cycles in the fragment
+ * @found: the least worn found item index [in|out]
+ * @erase_cycles: erase cycles for found item [in|out]
  *
- * This method tries to find unused PEB in the bitmap of
- * PEB table's fragment.
+ * This method tries to find the unused PEB with the minimal
+ * erase cycles in the range [@start, @max) of PEB table's fragment.
+ * The @found and @erase_cycles keep the best candidate that
+ * has been found by previous calls. The search stops when
+ * the PEB with @lower_bound erase cycles has been found.
  *
  * RETURN:
- * [success]
+ * [success] - PEB with @lower_bound erase cycles has been found.
  * [failure] - error code:
  *
- * %-EINVAL     - invalid input.
- * %-ENODATA    - unable to find unused PEB.
+ * %-ERANGE     - internal error.
+ * %-ENODATA    - the whole range has been checked.
  */
 static
 int __ssdfs_maptbl_find_unused_peb(struct ssdfs_peb_table_fragment_header *hdr,
 				   unsigned long start, unsigned long max,
-				   u32 threshold, unsigned long *found)
+				   u32 lower_bound, unsigned long *found,
+				   u32 *erase_cycles)
 {
 	struct ssdfs_peb_descriptor *desc;
 	unsigned long *bmap;
 	unsigned long index;
-	int err = -ENODATA;
+	u32 found_cycles;
+	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!hdr || !found);
+	BUG_ON(!hdr || !found || !erase_cycles);
 
-	SSDFS_DBG("hdr %p, start %lu, max %lu, threshold %u\n",
-		  hdr, start, max, threshold);
+	SSDFS_DBG("hdr %p, start %lu, max %lu, lower_bound %u\n",
+		  hdr, start, max, lower_bound);
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	bmap = (unsigned long *)&hdr->bmaps[SSDFS_PEBTBL_USED_BMAP][0];
 
-	*found = ULONG_MAX;
-
-	if (start >= max) {
-#ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("start %lu >= max %lu\n",
-			  start, max);
-#endif /* CONFIG_SSDFS_DEBUG */
-		return -ENODATA;
-	}
-
-	do {
-		index = bitmap_find_next_zero_area(bmap, max, start, 1, 0);
-
-#ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("start %lu, max %lu, index %lu\n",
-			  start, max, index);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-		if (index >= max) {
-			SSDFS_DBG("unable to find the unused peb\n");
-			return -ENODATA;
-		}
+	while (start < max) {
+		index = find_next_zero_bit(bmap, max, start);
+		if (index >= max)
+			break;
 
 #ifdef CONFIG_SSDFS_DEBUG
 		BUG_ON(index >= U16_MAX);
@@ -6616,32 +6890,28 @@ int __ssdfs_maptbl_find_unused_peb(struct ssdfs_peb_table_fragment_header *hdr,
 			return err;
 		}
 
-		if (desc->state != SSDFS_MAPTBL_BAD_PEB_STATE) {
-			u32 found_cycles = le32_to_cpu(desc->erase_cycles);
+		start = index + 1;
 
-#ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("index %lu, found_cycles %u, threshold %u\n",
-				  index, found_cycles, threshold);
-#endif /* CONFIG_SSDFS_DEBUG */
+		if (desc->state == SSDFS_MAPTBL_BAD_PEB_STATE)
+			continue;
+
+		found_cycles = le32_to_cpu(desc->erase_cycles);
 
-			if (found_cycles <= threshold) {
-				*found = index;
 #ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("found: index %lu, "
-					  "found_cycles %u, threshold %u\n",
-					  *found, found_cycles, threshold);
+		SSDFS_DBG("index %lu, found_cycles %u, erase_cycles %u\n",
+			  index, found_cycles, *erase_cycles);
 #endif /* CONFIG_SSDFS_DEBUG */
-				return 0;
-			} else {
-				/* continue to search */
-				*found = ULONG_MAX;
-			}
+
+		if (*found >= ULONG_MAX || found_cycles < *erase_cycles) {
+			*found = index;
+			*erase_cycles = found_cycles;
 		}
 
-		start = index + 1;
-	} while (start < max);
+		if (found_cycles <= lower_bound)
+			return 0;
+	}
 
-	return err;
+	return -ENODATA;
 }
 
 /*
@@ -6649,12 +6919,15 @@ int __ssdfs_maptbl_find_unused_peb(struct ssdfs_peb_table_fragment_header *hdr,
  * @hdr: PEB table fragment's header
  * @start: start item for search
  * @max: upper bound for the search
- * @used_pebs: number of used PEBs
+ * @lower_bound: lower bound of erase cycles in the fragment
  * @found: found item index [out]
  * @erase_cycles: erase cycles for found item [out]
  *
- * This method tries to find unused PEB in the bitmap of
- * PEB table's fragment.
+ * This method tries to find the least worn unused PEB in
+ * the bitmap of PEB table's fragment. The search starts from
+ * @start item and it wraps around at @max. The first found item
+ * with the minimal erase cycles is selected. As a result,
+ * the PEBs with equal wear are selected in round-robin manner.
  *
  * RETURN:
  * [success]
@@ -6666,18 +6939,16 @@ int __ssdfs_maptbl_find_unused_peb(struct ssdfs_peb_table_fragment_header *hdr,
 static
 int ssdfs_maptbl_find_unused_peb(struct ssdfs_peb_table_fragment_header *hdr,
 				 unsigned long start, unsigned long max,
-				 unsigned long used_pebs,
+				 u32 lower_bound,
 				 unsigned long *found, u32 *erase_cycles)
 {
-	u32 threshold = U32_MAX;
-	unsigned long found_for_threshold;
 	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!hdr || !found || !erase_cycles);
 
-	SSDFS_DBG("hdr %p, start %lu, max %lu\n",
-		  hdr, start, max);
+	SSDFS_DBG("hdr %p, start %lu, max %lu, lower_bound %u\n",
+		  hdr, start, max, lower_bound);
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	if (start >= max) {
@@ -6686,25 +6957,20 @@ int ssdfs_maptbl_find_unused_peb(struct ssdfs_peb_table_fragment_header *hdr,
 		return -EINVAL;
 	}
 
-	err = ssdfs_maptbl_get_erase_threshold(hdr, 0, max, used_pebs,
-						found, &threshold);
-	if (unlikely(err)) {
-		SSDFS_ERR("fail to detect erase threshold: err %d\n", err);
-		return err;
-	} else if (threshold >= U32_MAX) {
-		SSDFS_ERR("invalid erase threshold %u\n", threshold);
-		return -ERANGE;
-	}
-
-	*erase_cycles = threshold;
-	found_for_threshold = *found;
+	*found = ULONG_MAX;
+	*erase_cycles = U32_MAX;
 
-	err = __ssdfs_maptbl_find_unused_peb(hdr, start, max,
-					     threshold, found);
+	err = __ssdfs_maptbl_find_unused_peb(hdr, start, max, lower_bound,
+					     found, erase_cycles);
 	if (err == -ENODATA) {
-		err = __ssdfs_maptbl_find_unused_peb(hdr,
-						     0, start,
-						     threshold, found);
+		err = __ssdfs_maptbl_find_unused_peb(hdr, 0, start,
+						     lower_bound,
+						     found, erase_cycles);
+	}
+
+	if (err == -ENODATA && *found < ULONG_MAX) {
+		/* the least worn PEB has been found */
+		err = 0;
 	}
 
 	if (err == -ENODATA) {
@@ -6720,8 +6986,8 @@ int ssdfs_maptbl_find_unused_peb(struct ssdfs_peb_table_fragment_header *hdr,
 		int i;
 
 		SSDFS_DBG("unable to find unused PEB: "
-			  "found_for_threshold %lu, threshold %u\n",
-			  found_for_threshold, threshold);
+			  "start %lu, max %lu\n",
+			  start, max);
 
 		bmap = (unsigned long *)&hdr->bmaps[SSDFS_PEBTBL_USED_BMAP][0];
 		start_peb = le64_to_cpu(hdr->start_peb);
@@ -6754,6 +7020,11 @@ int ssdfs_maptbl_find_unused_peb(struct ssdfs_peb_table_fragment_header *hdr,
 		return err;
 	}
 
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("found %lu, erase_cycles %u\n",
+		  *found, *erase_cycles);
+#endif /* CONFIG_SSDFS_DEBUG */
+
 	return 0;
 }
 
@@ -6861,7 +7132,8 @@ u16 ssdfs_maptbl_select_unused_peb(struct ssdfs_maptbl_fragment_desc *fdesc,
 		last_selected_peb = 0;
 
 	err = ssdfs_maptbl_find_unused_peb(hdr, last_selected_peb,
-					   pebs_count, used_pebs,
+					   pebs_count,
+					   fdesc->wear.min_erase_cycles,
 					   &found, &erase_cycles);
 	if (err == -ENODATA) {
 		SSDFS_DBG("unable to find the unused peb\n");
@@ -7066,7 +7338,6 @@ finish_page_processing:
 static
 int ssdfs_maptbl_reserve_free_pages(struct ssdfs_fs_info *fsi)
 {
-	u64 free_pebs = 0;
 	u64 free_pages = 0;
 	u64 reserved_pages = 0;
 	int err = 0;
@@ -7075,19 +7346,10 @@ int ssdfs_maptbl_reserve_free_pages(struct ssdfs_fs_info *fsi)
 	BUG_ON(!fsi);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	spin_lock(&fsi->volume_state_lock);
-	free_pages = fsi->free_pages;
-	free_pebs = div64_u64(free_pages, fsi->pages_per_peb);
-	if (free_pebs >= 1) {
-		reserved_pages = fsi->pages_per_peb;
-		if (fsi->free_pages >= reserved_pages) {
-			fsi->free_pages -= reserved_pages;
-			free_pages = fsi->free_pages;
-		} else
-			err = -ERANGE;
-	} else
+	reserved_pages = fsi->pages_per_peb;
+	if (!ssdfs_fs_counter_try_sub(&fsi->free_pages, reserved_pages))
 		err = -ENOSPC;
-	spin_unlock(&fsi->volume_state_lock);
+	free_pages = ssdfs_fs_counter_read(&fsi->free_pages);
 
 	if (unlikely(err)) {
 		SSDFS_WARN("fail to reserve PEB: "
@@ -7112,10 +7374,8 @@ void ssdfs_maptbl_free_reserved_pages(struct ssdfs_fs_info *fsi)
 	BUG_ON(!fsi);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	spin_lock(&fsi->volume_state_lock);
-	fsi->free_pages += fsi->pages_per_peb;
-	free_pages = fsi->free_pages;
-	spin_unlock(&fsi->volume_state_lock);
+	percpu_counter_add(&fsi->free_pages, fsi->pages_per_peb);
+	free_pages = ssdfs_fs_counter_read(&fsi->free_pages);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("free_pages %llu\n",
@@ -7593,7 +7853,7 @@ int ssdfs_maptbl_map_leb2peb(struct ssdfs_fs_info *fsi,
 		goto finish_mapping;
 	}
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -7634,7 +7894,7 @@ int ssdfs_maptbl_map_leb2peb(struct ssdfs_fs_info *fsi,
 	}
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -7998,7 +8258,7 @@ int ssdfs_maptbl_recommend_search_range(struct ssdfs_fs_info *fsi,
 			goto finish_check;
 		}
 
-		down_read(&fdesc->lock);
+		SSDFS_DOWN_READ(maptbl_frag, &fdesc->lock);
 
 		found_start_leb = fdesc->start_leb;
 		found_end_leb = fdesc->start_leb + fdesc->lebs_count;
@@ -8384,7 +8644,7 @@ int ssdfs_maptbl_change_peb_state(struct ssdfs_fs_info *fsi,
 	}
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -8464,7 +8724,7 @@ int ssdfs_maptbl_change_peb_state(struct ssdfs_fs_info *fsi,
 	}
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -8777,7 +9037,7 @@ int ssdfs_maptbl_prepare_pre_erase_state(struct ssdfs_fs_info *fsi,
 	}
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -8842,7 +9102,7 @@ int ssdfs_maptbl_prepare_pre_erase_state(struct ssdfs_fs_info *fsi,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -8969,7 +9229,7 @@ int ssdfs_maptbl_set_pre_erased_snapshot_peb(struct ssdfs_fs_info *fsi,
 	}
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	if (peb_id < fdesc->start_leb ||
 	    peb_id > (fdesc->start_leb + fdesc->lebs_count)) {
@@ -9025,7 +9285,7 @@ int ssdfs_maptbl_set_pre_erased_snapshot_peb(struct ssdfs_fs_info *fsi,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, peb_id);
@@ -9557,7 +9817,7 @@ int ssdfs_maptbl_add_migration_peb(struct ssdfs_fs_info *fsi,
 	}
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -9659,7 +9919,7 @@ int ssdfs_maptbl_add_migration_peb(struct ssdfs_fs_info *fsi,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -9840,7 +10100,7 @@ int ssdfs_maptbl_erase_reserved_peb_now(struct ssdfs_fs_info *fsi,
 		goto finish_erase_reserved_peb;
 	}
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -9894,7 +10154,7 @@ int ssdfs_maptbl_erase_reserved_peb_now(struct ssdfs_fs_info *fsi,
 				peb_id, SSDFS_ERASE_RESULT_UNKNOWN,
 				&res);
 
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 	err = ssdfs_maptbl_erase_peb(fsi, &res);
 	if (unlikely(err)) {
 		SSDFS_ERR("fail to erase: "
@@ -9902,7 +10162,7 @@ int ssdfs_maptbl_erase_reserved_peb_now(struct ssdfs_fs_info *fsi,
 			  peb_id, err);
 		goto finish_erase_reserved_peb;
 	}
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	switch (res.state) {
 	case SSDFS_ERASE_DONE:
@@ -9928,7 +10188,7 @@ int ssdfs_maptbl_erase_reserved_peb_now(struct ssdfs_fs_info *fsi,
 	}
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -9992,6 +10252,29 @@ bool is_ssdfs_peb_contains_snapshot(struct ssdfs_fs_info *fsi,
 
 	tree = fsi->snapshots.tree;
 
+	range.start = peb_create_time;
+	range.end = last_log_time;
+
+	err = ssdfs_snaptime_index_check(tree, &range);
+	if (err == -ENODATA) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("time index hasn't snapshot: "
+			  "start_timestamp %llu, end_timestamp %llu\n",
+			  peb_create_time, last_log_time);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return false;
+	} else if (err == -EAGAIN) {
+		/* index is not ready yet -> check the btree */
+		err = 0;
+	} else {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("time index contains snapshot: "
+			  "start_timestamp %llu, end_timestamp %llu\n",
+			  peb_create_time, last_log_time);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return true;
+	}
+
 	search = ssdfs_btree_search_alloc();
 	if (!search) {
 		err = -ENOMEM;
@@ -9999,9 +10282,6 @@ bool is_ssdfs_peb_contains_snapshot(struct ssdfs_fs_info *fsi,
 		goto finish_search_snapshots_range;
 	}
 
-	range.start = peb_create_time;
-	range.end = last_log_time;
-
 	ssdfs_btree_search_init(search);
 	err = ssdfs_snapshots_btree_check_range(tree, &range, search);
 	if (err == -ENODATA) {
@@ -10227,7 +10507,7 @@ int ssdfs_maptbl_exclude_migration_peb(struct ssdfs_fs_info *fsi,
 	}
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -10379,7 +10659,7 @@ int ssdfs_maptbl_exclude_migration_peb(struct ssdfs_fs_info *fsi,
 					peb_id, SSDFS_ERASE_RESULT_UNKNOWN,
 					&res);
 
-		up_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_unlock(fdesc);
 		err = ssdfs_maptbl_erase_peb(fsi, &res);
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to erase: "
@@ -10387,7 +10667,7 @@ int ssdfs_maptbl_exclude_migration_peb(struct ssdfs_fs_info *fsi,
 				  peb_id, err);
 			goto finish_exclude_migrating_peb;
 		}
-		down_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_lock(fdesc);
 
 		switch (res.state) {
 		case SSDFS_ERASE_DONE:
@@ -10456,7 +10736,7 @@ int ssdfs_maptbl_exclude_migration_peb(struct ssdfs_fs_info *fsi,
 	wake_up(&tbl->wait_queue);
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -10654,7 +10934,7 @@ int ssdfs_maptbl_set_shared_destination_peb(struct ssdfs_peb_mapping_table *tbl,
 		return err;
 	}
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -10696,7 +10976,7 @@ int ssdfs_maptbl_set_shared_destination_peb(struct ssdfs_peb_mapping_table *tbl,
 	}
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -10878,7 +11158,7 @@ int __ssdfs_maptbl_set_indirect_relation(struct ssdfs_peb_mapping_table *tbl,
 		return err;
 	}
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -10920,7 +11200,7 @@ int __ssdfs_maptbl_set_indirect_relation(struct ssdfs_peb_mapping_table *tbl,
 	}
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -11198,7 +11478,7 @@ __ssdfs_maptbl_set_zns_indirect_relation(struct ssdfs_peb_mapping_table *tbl,
 		return err;
 	}
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -11240,7 +11520,7 @@ __ssdfs_maptbl_set_zns_indirect_relation(struct ssdfs_peb_mapping_table *tbl,
 	}
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -11501,7 +11781,7 @@ ssdfs_maptbl_clear_shared_destination_peb(struct ssdfs_peb_mapping_table *tbl,
 		return err;
 	}
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -11543,7 +11823,7 @@ ssdfs_maptbl_clear_shared_destination_peb(struct ssdfs_peb_mapping_table *tbl,
 	}
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -11728,7 +12008,7 @@ int __ssdfs_maptbl_break_indirect_relation(struct ssdfs_peb_mapping_table *tbl,
 		return err;
 	}
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -11791,7 +12071,7 @@ int __ssdfs_maptbl_break_indirect_relation(struct ssdfs_peb_mapping_table *tbl,
 	}
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -12095,7 +12375,7 @@ __ssdfs_maptbl_break_zns_indirect_relation(struct ssdfs_peb_mapping_table *tbl,
 		return err;
 	}
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	err = ssdfs_maptbl_get_leb_descriptor(fdesc, leb_id, &leb_desc);
 	if (unlikely(err)) {
@@ -12158,7 +12438,7 @@ __ssdfs_maptbl_break_zns_indirect_relation(struct ssdfs_peb_mapping_table *tbl,
 	}
 
 finish_fragment_change:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err)
 		ssdfs_maptbl_set_fragment_dirty(tbl, fdesc, leb_id);
@@ -12275,14 +12555,12 @@ int __ssdfs_reserve_free_pages(struct ssdfs_fs_info *fsi, u32 count,
 
 	*free_pages = 0;
 
-	spin_lock(&fsi->volume_state_lock);
-	*free_pages = fsi->free_pages;
-	if (fsi->free_pages >= count) {
+	if (ssdfs_fs_counter_try_sub(&fsi->free_pages, count)) {
 		err = -EEXIST;
-		fsi->free_pages -= count;
 		switch (type) {
 		case SSDFS_USER_DATA_PAGES:
-			fsi->reserved_new_user_data_pages += count;
+			percpu_counter_add(&fsi->reserved_new_user_data_pages,
+					   count);
 			break;
 
 		default:
@@ -12290,11 +12568,13 @@ int __ssdfs_reserve_free_pages(struct ssdfs_fs_info *fsi, u32 count,
 			break;
 		};
 #ifdef CONFIG_SSDFS_DEBUG
-		reserved = fsi->reserved_new_user_data_pages;
+		reserved =
+		    ssdfs_fs_counter_read(&fsi->reserved_new_user_data_pages);
 #endif /* CONFIG_SSDFS_DEBUG */
 	} else
 		err = -ENOSPC;
-	spin_unlock(&fsi->volume_state_lock);
+
+	*free_pages = ssdfs_fs_counter_read(&fsi->free_pages);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("reserved %llu\n", reserved);
@@ -12356,7 +12636,7 @@ int ssdfs_try2increase_free_pages(struct ssdfs_fs_info *fsi)
 			down_read(&tbl->tbl_lock);
 		}
 
-		down_read(&fdesc->lock);
+		SSDFS_DOWN_READ(maptbl_frag, &fdesc->lock);
 		err = ssdfs_maptbl_try_decrease_reserved_pebs(tbl, fdesc);
 		up_read(&fdesc->lock);
 
@@ -12384,7 +12664,6 @@ int ssdfs_wait_maptbl_init_ending(struct ssdfs_fs_info *fsi, u32 count)
 	struct ssdfs_maptbl_fragment_desc *fdesc;
 	u32 fragments_count;
 	int state;
-	u64 free_pages;
 	u32 i;
 	int err = 0;
 
@@ -12428,11 +12707,8 @@ int ssdfs_wait_maptbl_init_ending(struct ssdfs_fs_info *fsi, u32 count)
 				goto finish_wait_init;
 			}
 
-			spin_lock(&fsi->volume_state_lock);
-			free_pages = fsi->free_pages;
-			spin_unlock(&fsi->volume_state_lock);
-
-			if (free_pages >= count)
+			if (percpu_counter_compare(&fsi->free_pages,
+						   count) >= 0)
 				goto finish_wait_init;
 
 			down_read(&tbl->tbl_lock);
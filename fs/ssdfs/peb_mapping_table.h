@@ -29,9 +29,33 @@
 #define SSDFS_PRE_ERASE_PEB_THRESHOLD_PCT	(3)
 #define SSDFS_UNUSED_LEB_THRESHOLD_PCT		(1)
 
+#define SSDFS_MAPTBL_WEAR_BUCKETS		(16)
+
+/*
+ * struct ssdfs_maptbl_wear_stats - wear statistics of fragment
+ * @min_erase_cycles: lower bound of erase cycles of fragment's PEBs
+ * @max_erase_cycles: maximal erase cycles of fragment's PEBs
+ * @total_erase_cycles: total erase cycles of fragment's PEBs
+ * @pebs_count: number of accounted (not bad) PEBs
+ * @histogram: number of PEBs in every bucket of erase cycles
+ *
+ * The bucket N (N > 0) accounts PEBs with erase cycles
+ * in the range [2^(N-1), 2^N). The bucket 0 accounts PEBs
+ * that have never been erased. The last bucket accounts
+ * all PEBs with larger number of erase cycles.
+ */
+struct ssdfs_maptbl_wear_stats {
+	u32 min_erase_cycles;
+	u32 max_erase_cycles;
+	u64 total_erase_cycles;
+	u32 pebs_count;
+	u32 histogram[SSDFS_MAPTBL_WEAR_BUCKETS];
+};
+
 /*
  * struct ssdfs_maptbl_fragment_desc - fragment descriptor
  * @lock: fragment lock
+ * @seq: modification sequence counter (for lock-free readers)
  * @state: fragment state
  * @fragment_id: fragment's ID in the whole sequence
  * @fragment_pages: count of memory pages in fragment
@@ -46,6 +70,7 @@
  * @reserved_pebs: count of reserved PEBs in fragment
  * @pre_erase_pebs: count of PEBs in pre-erase state per fragment
  * @recovering_pebs: count of recovering PEBs per fragment
+ * @wear: wear statistics of fragment's PEBs
  * @array: fragment's memory pages
  * @init_end: wait of init ending
  * @flush_req1: main flush requests array
@@ -55,6 +80,7 @@
  */
 struct ssdfs_maptbl_fragment_desc {
 	struct rw_semaphore lock;
+	seqcount_t seq;
 	atomic_t state;
 
 	u32 fragment_id;
@@ -75,6 +101,8 @@ struct ssdfs_maptbl_fragment_desc {
 	u32 pre_erase_pebs;
 	u32 recovering_pebs;
 
+	struct ssdfs_maptbl_wear_stats wear;
+
 	struct ssdfs_page_array array;
 	struct completion init_end;
 
@@ -232,6 +260,7 @@ enum {
 	SSDFS_IGNORE_ERASE,
 	SSDFS_ERASE_FAILURE,
 	SSDFS_BAD_BLOCK_DETECTED,
+	SSDFS_ERASE_SUBMITTED,
 	SSDFS_ERASE_RESULT_MAX
 };
 
@@ -263,10 +292,44 @@ struct ssdfs_erase_result_array {
 
 #define SSDFS_ERASE_RESULTS_PER_FRAGMENT	(10)
 
+/*
+ * High watermark of dirty PEBs (in units of max erase operations)
+ * that makes maptbl thread to erase the dirty PEBs without delay.
+ */
+#define SSDFS_MAPTBL_PRE_ERASE_HIGH_WATERMARK	(2)
+
 /*
  * Inline functions
  */
 
+/*
+ * ssdfs_maptbl_fragment_write_lock() - lock fragment for modification
+ * @fdesc: fragment descriptor
+ *
+ * The fragment's modification sequence is odd while the fragment
+ * is locked for write. Lock-free readers are unable to take
+ * this sequence and they fall back to the fragment's lock. The
+ * writer can sleep inside of the critical section because the
+ * readers never spin on the sequence counter.
+ */
+static inline
+void ssdfs_maptbl_fragment_write_lock(struct ssdfs_maptbl_fragment_desc *fdesc)
+{
+	down_write(&fdesc->lock);
+	raw_write_seqcount_begin(&fdesc->seq);
+}
+
+/*
+ * ssdfs_maptbl_fragment_write_unlock() - unlock modified fragment
+ * @fdesc: fragment descriptor
+ */
+static inline
+void ssdfs_maptbl_fragment_write_unlock(struct ssdfs_maptbl_fragment_desc *fdesc)
+{
+	raw_write_seqcount_end(&fdesc->seq);
+	up_write(&fdesc->lock);
+}
+
 /*
  * SSDFS_ERASE_RESULT_INIT() - init erase result
  * @fragment_index: index of mapping table's fragment
@@ -288,6 +351,71 @@ void SSDFS_ERASE_RESULT_INIT(u32 fragment_index, u16 peb_index,
 	result->state = state;
 }
 
+/*
+ * SSDFS_MAPTBL_WEAR_BUCKET() - define bucket of wear histogram
+ * @erase_cycles: erase cycles of PEB
+ */
+static inline
+int SSDFS_MAPTBL_WEAR_BUCKET(u32 erase_cycles)
+{
+	int bucket = erase_cycles == 0 ? 0 : ilog2(erase_cycles) + 1;
+
+	return min_t(int, bucket, SSDFS_MAPTBL_WEAR_BUCKETS - 1);
+}
+
+/*
+ * ssdfs_maptbl_wear_stats_init() - init wear statistics
+ * @stats: wear statistics
+ */
+static inline
+void ssdfs_maptbl_wear_stats_init(struct ssdfs_maptbl_wear_stats *stats)
+{
+	memset(stats, 0, sizeof(struct ssdfs_maptbl_wear_stats));
+	stats->min_erase_cycles = U32_MAX;
+}
+
+/*
+ * ssdfs_maptbl_wear_stats_add() - account PEB in wear statistics
+ * @stats: wear statistics
+ * @erase_cycles: erase cycles of PEB
+ */
+static inline
+void ssdfs_maptbl_wear_stats_add(struct ssdfs_maptbl_wear_stats *stats,
+				 u32 erase_cycles)
+{
+	stats->min_erase_cycles = min_t(u32, stats->min_erase_cycles,
+					erase_cycles);
+	stats->max_erase_cycles = max_t(u32, stats->max_erase_cycles,
+					erase_cycles);
+	stats->total_erase_cycles += erase_cycles;
+	stats->pebs_count++;
+	stats->histogram[SSDFS_MAPTBL_WEAR_BUCKET(erase_cycles)]++;
+}
+
+/*
+ * ssdfs_maptbl_wear_stats_erase() - account erase operation of PEB
+ * @stats: wear statistics
+ * @erase_cycles: erase cycles of PEB before the erase
+ *
+ * The minimal erase cycles value stays as the lower bound
+ * because the PEB with minimal erase cycles could be not unique.
+ */
+static inline
+void ssdfs_maptbl_wear_stats_erase(struct ssdfs_maptbl_wear_stats *stats,
+				   u32 erase_cycles)
+{
+	int old_bucket = SSDFS_MAPTBL_WEAR_BUCKET(erase_cycles);
+	int new_bucket = SSDFS_MAPTBL_WEAR_BUCKET(erase_cycles + 1);
+
+	if (stats->histogram[old_bucket] > 0)
+		stats->histogram[old_bucket]--;
+	stats->histogram[new_bucket]++;
+
+	stats->max_erase_cycles = max_t(u32, stats->max_erase_cycles,
+					erase_cycles + 1);
+	stats->total_erase_cycles++;
+}
+
 /*
  * DEFINE_PEB_INDEX_IN_FRAGMENT() - define PEB index in the whole fragment
  * @fdesc: fragment descriptor
@@ -566,12 +694,10 @@ void ssdfs_account_updated_user_data_pages(struct ssdfs_fs_info *fsi,
 		  fsi, count);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	spin_lock(&fsi->volume_state_lock);
-	fsi->updated_user_data_pages += count;
+	percpu_counter_add(&fsi->updated_user_data_pages, count);
 #ifdef CONFIG_SSDFS_DEBUG
-	updated = fsi->updated_user_data_pages;
+	updated = ssdfs_fs_counter_read(&fsi->updated_user_data_pages);
 #endif /* CONFIG_SSDFS_DEBUG */
-	spin_unlock(&fsi->volume_state_lock);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("updated %llu\n", updated);
@@ -593,6 +719,13 @@ int ssdfs_maptbl_convert_leb2peb(struct ssdfs_fs_info *fsi,
 				 u64 leb_id, u8 peb_type,
 				 struct ssdfs_maptbl_peb_relation *pebr,
 				 struct completion **end);
+void ssdfs_maptbl_get_wear_stats(struct ssdfs_peb_mapping_table *tbl,
+				 struct ssdfs_maptbl_wear_stats *stats);
+int ssdfs_maptbl_convert_lebs2pebs(struct ssdfs_fs_info *fsi,
+				   u64 *leb_ids, u32 count,
+				   u8 peb_type,
+				   struct ssdfs_maptbl_peb_relation *pebr_array,
+				   struct completion **end);
 int ssdfs_maptbl_map_leb2peb(struct ssdfs_fs_info *fsi,
 			     u64 leb_id, u8 peb_type,
 			     struct ssdfs_maptbl_peb_relation *pebr,
@@ -23,6 +23,8 @@
 #include <linux/rwsem.h>
 #include <linux/slab.h>
 #include <linux/pagevec.h>
+#include <linux/hash.h>
+#include <linux/seqlock.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -88,11 +90,48 @@ void ssdfs_map_cache_check_memory_leaks(void)
 #endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
 }
 
+#define SSDFS_MAPTBL_CACHE_LOOKASIDE_BITS	(7)
+#define SSDFS_MAPTBL_CACHE_LOOKASIDE_SIZE	\
+	(1 << SSDFS_MAPTBL_CACHE_LOOKASIDE_BITS)
+
+/*
+ * struct ssdfs_maptbl_cache_lookaside_item - cached LEB/PEB conversion
+ * @leb_id: LEB ID number (U64_MAX means empty slot)
+ * @pebr: description of PEBs relation
+ */
+struct ssdfs_maptbl_cache_lookaside_item {
+	u64 leb_id;
+	struct ssdfs_maptbl_peb_relation pebr;
+};
+
+/*
+ * struct ssdfs_maptbl_cache_lookaside - lookaside of LEB/PEB conversions
+ * @lock: sequential lock of lookaside
+ * @items: direct-mapped (hashed by LEB ID) array of conversions
+ *
+ * The lookaside keeps the results of recent conversions that
+ * have been found in the maptbl cache. The readers access the
+ * lookaside without any lock (retrying if a writer is active).
+ * The items are added under read lock of maptbl cache and every
+ * modification of maptbl cache invalidates the item of LEB under
+ * write lock of maptbl cache. As a result, the lookaside cannot
+ * keep a stale conversion.
+ */
+struct ssdfs_maptbl_cache_lookaside {
+	seqlock_t lock;
+	struct ssdfs_maptbl_cache_lookaside_item
+			items[SSDFS_MAPTBL_CACHE_LOOKASIDE_SIZE];
+};
+
 /*
  * ssdfs_maptbl_cache_init() - init mapping table cache
  */
 void ssdfs_maptbl_cache_init(struct ssdfs_maptbl_cache *cache)
 {
+	struct ssdfs_maptbl_cache_lookaside *lookaside;
+	size_t lookaside_size = sizeof(struct ssdfs_maptbl_cache_lookaside);
+	int i;
+
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!cache);
 
@@ -103,6 +142,18 @@ void ssdfs_maptbl_cache_init(struct ssdfs_maptbl_cache *cache)
 	pagevec_init(&cache->pvec);
 	atomic_set(&cache->bytes_count, 0);
 	ssdfs_peb_mapping_queue_init(&cache->pm_queue);
+
+	lookaside = ssdfs_map_cache_kzalloc(lookaside_size, GFP_KERNEL);
+	if (!lookaside) {
+		/* maptbl cache is able to work without lookaside */
+		SSDFS_DBG("unable to allocate lookaside\n");
+	} else {
+		seqlock_init(&lookaside->lock);
+		for (i = 0; i < SSDFS_MAPTBL_CACHE_LOOKASIDE_SIZE; i++)
+			lookaside->items[i].leb_id = U64_MAX;
+	}
+
+	cache->lookaside = lookaside;
 }
 
 /*
@@ -118,6 +169,140 @@ void ssdfs_maptbl_cache_destroy(struct ssdfs_maptbl_cache *cache)
 
 	ssdfs_map_cache_pagevec_release(&cache->pvec);
 	ssdfs_peb_mapping_queue_remove_all(&cache->pm_queue);
+
+	if (cache->lookaside) {
+		ssdfs_map_cache_kfree(cache->lookaside);
+		cache->lookaside = NULL;
+	}
+}
+
+static inline
+struct ssdfs_maptbl_cache_lookaside_item *
+ssdfs_maptbl_cache_lookaside_slot(struct ssdfs_maptbl_cache_lookaside *ptr,
+				  u64 leb_id)
+{
+	return &ptr->items[hash_64(leb_id, SSDFS_MAPTBL_CACHE_LOOKASIDE_BITS)];
+}
+
+/*
+ * ssdfs_maptbl_cache_lookaside_find() - lock-free LEB/PEB conversion
+ * @cache: maptbl cache object
+ * @leb_id: LEB ID number
+ * @pebr: description of PEBs relation [out]
+ *
+ * This method tries to find the conversion in the lookaside
+ * without taking the maptbl cache's lock.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - lookaside hasn't the conversion.
+ */
+static
+int ssdfs_maptbl_cache_lookaside_find(struct ssdfs_maptbl_cache *cache,
+				      u64 leb_id,
+				      struct ssdfs_maptbl_peb_relation *pebr)
+{
+	struct ssdfs_maptbl_cache_lookaside *lookaside = cache->lookaside;
+	struct ssdfs_maptbl_cache_lookaside_item *item;
+	size_t pebr_size = sizeof(struct ssdfs_maptbl_peb_relation);
+	unsigned int seq;
+	bool found;
+
+	if (!lookaside)
+		return -ENODATA;
+
+	item = ssdfs_maptbl_cache_lookaside_slot(lookaside, leb_id);
+
+	do {
+		seq = read_seqbegin(&lookaside->lock);
+
+		found = item->leb_id == leb_id;
+		if (found)
+			memcpy(pebr, &item->pebr, pebr_size);
+	} while (read_seqretry(&lookaside->lock, seq));
+
+	return found ? 0 : -ENODATA;
+}
+
+/*
+ * ssdfs_maptbl_cache_lookaside_add() - store the conversion in lookaside
+ * @cache: maptbl cache object
+ * @leb_id: LEB ID number
+ * @pebr: description of PEBs relation
+ *
+ * This method stores the found conversion in the lookaside.
+ * The conversion of PEB in inconsistent or pre-deleted state
+ * is not stored because such conversion needs the processing
+ * under maptbl cache's lock. The caller has to hold
+ * the maptbl cache's lock.
+ */
+static
+void ssdfs_maptbl_cache_lookaside_add(struct ssdfs_maptbl_cache *cache,
+				      u64 leb_id,
+				      struct ssdfs_maptbl_peb_relation *pebr)
+{
+	struct ssdfs_maptbl_cache_lookaside *lookaside = cache->lookaside;
+	struct ssdfs_maptbl_cache_lookaside_item *item;
+	size_t pebr_size = sizeof(struct ssdfs_maptbl_peb_relation);
+	int i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!rwsem_is_locked(&cache->lock));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!lookaside)
+		return;
+
+	for (i = SSDFS_MAPTBL_MAIN_INDEX; i < SSDFS_MAPTBL_RELATION_MAX; i++) {
+		switch (pebr->pebs[i].consistency) {
+		case SSDFS_PEB_STATE_INCONSISTENT:
+		case SSDFS_PEB_STATE_PRE_DELETED:
+			return;
+
+		default:
+			/* continue check */
+			break;
+		}
+	}
+
+	item = ssdfs_maptbl_cache_lookaside_slot(lookaside, leb_id);
+
+	write_seqlock(&lookaside->lock);
+	item->leb_id = leb_id;
+	memcpy(&item->pebr, pebr, pebr_size);
+	write_sequnlock(&lookaside->lock);
+}
+
+/*
+ * ssdfs_maptbl_cache_lookaside_forget() - invalidate LEB's conversion
+ * @cache: maptbl cache object
+ * @leb_id: LEB ID number
+ *
+ * This method invalidates the conversion of LEB in the lookaside.
+ * The caller has to hold the maptbl cache's lock for write.
+ */
+static
+void ssdfs_maptbl_cache_lookaside_forget(struct ssdfs_maptbl_cache *cache,
+					 u64 leb_id)
+{
+	struct ssdfs_maptbl_cache_lookaside *lookaside = cache->lookaside;
+	struct ssdfs_maptbl_cache_lookaside_item *item;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!rwsem_is_locked(&cache->lock));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!lookaside)
+		return;
+
+	item = ssdfs_maptbl_cache_lookaside_slot(lookaside, leb_id);
+
+	write_seqlock(&lookaside->lock);
+	if (item->leb_id == leb_id)
+		item->leb_id = U64_MAX;
+	write_sequnlock(&lookaside->lock);
 }
 
 /*
@@ -1399,8 +1584,14 @@ int __ssdfs_maptbl_cache_convert_leb2peb(struct ssdfs_maptbl_cache *cache,
 		  cache, leb_id, pebr);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	err = ssdfs_maptbl_cache_lookaside_find(cache, leb_id, pebr);
+	if (!err)
+		return 0;
+
 	down_read(&cache->lock);
 	err = ssdfs_maptbl_cache_convert_leb2peb_nolock(cache, leb_id, pebr);
+	if (!err)
+		ssdfs_maptbl_cache_lookaside_add(cache, leb_id, pebr);
 	up_read(&cache->lock);
 
 	return err;
@@ -2787,6 +2978,7 @@ int ssdfs_maptbl_cache_map_leb2peb(struct ssdfs_maptbl_cache *cache,
 		pebr->pebs[SSDFS_MAPTBL_MAIN_INDEX].shared_peb_index;
 
 	down_write(&cache->lock);
+	ssdfs_maptbl_cache_lookaside_forget(cache, leb_id);
 
 	for (i = 0; i < pagevec_count(&cache->pvec); i++) {
 		page = cache->pvec.pages[i];
@@ -3676,6 +3868,8 @@ int ssdfs_maptbl_cache_change_peb_state_nolock(struct ssdfs_maptbl_cache *cache,
 		  cache, leb_id, peb_state, consistency);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	ssdfs_maptbl_cache_lookaside_forget(cache, leb_id);
+
 	switch (consistency) {
 	case SSDFS_PEB_STATE_CONSISTENT:
 	case SSDFS_PEB_STATE_INCONSISTENT:
@@ -3927,6 +4121,7 @@ int ssdfs_maptbl_cache_add_migration_peb(struct ssdfs_maptbl_cache *cache,
 		pebr->pebs[SSDFS_MAPTBL_RELATION_INDEX].shared_peb_index;
 
 	down_write(&cache->lock);
+	ssdfs_maptbl_cache_lookaside_forget(cache, leb_id);
 
 	for (i = 0; i < pagevec_count(&cache->pvec); i++) {
 		page = cache->pvec.pages[i];
@@ -4283,6 +4478,8 @@ int ssdfs_maptbl_cache_forget_leb2peb_nolock(struct ssdfs_maptbl_cache *cache,
 		  cache, leb_id, consistency);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	ssdfs_maptbl_cache_lookaside_forget(cache, leb_id);
+
 	memset(&res, 0xFF, sizeof(struct ssdfs_maptbl_cache_search_result));
 	res.pebs[SSDFS_MAPTBL_MAIN_INDEX].state =
 				SSDFS_MAPTBL_CACHE_ITEM_UNKNOWN;
@@ -24,12 +24,15 @@
 
 #include <linux/ssdfs_fs.h>
 
+struct ssdfs_maptbl_cache_lookaside;
+
 /*
  * struct ssdfs_maptbl_cache - maptbl cache
  * @lock: lock of maptbl cache
  * @pvec: memory pages of maptbl cache
  * @bytes_count: count of bytes in maptbl cache
  * @pm_queue: PEB mappings queue
+ * @lookaside: lock-free lookaside of recent LEB/PEB conversions
  */
 struct ssdfs_maptbl_cache {
 	struct rw_semaphore lock;
@@ -37,6 +40,8 @@ struct ssdfs_maptbl_cache {
 	atomic_t bytes_count;
 
 	struct ssdfs_peb_mapping_queue pm_queue;
+
+	struct ssdfs_maptbl_cache_lookaside *lookaside;
 };
 
 /*
@@ -30,6 +30,7 @@
 #include "ssdfs.h"
 #include "page_array.h"
 #include "peb_mapping_table.h"
+#include "log_header_cache.h"
 
 #include <trace/events/ssdfs.h>
 
@@ -426,7 +427,7 @@ int ssdfs_maptbl_collect_dirty_pebs(struct ssdfs_peb_mapping_table *tbl,
 	if (erases_per_stripe == 0)
 		erases_per_stripe = 1;
 
-	down_read(&fdesc->lock);
+	SSDFS_DOWN_READ(maptbl_frag, &fdesc->lock);
 
 	if (fdesc->pre_erase_pebs == 0) {
 		/* no dirty PEBs */
@@ -495,6 +496,8 @@ int ssdfs_maptbl_erase_peb(struct ssdfs_fs_info *fsi,
 		  peb_id, (u64)offset);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	ssdfs_log_hdr_cache_invalidate_peb(fsi, peb_id);
+
 	if (result->state == SSDFS_BAD_BLOCK_DETECTED) {
 		err = fsi->devops->mark_peb_bad(fsi->sb, offset);
 		if (unlikely(err)) {
@@ -527,12 +530,249 @@ int ssdfs_maptbl_erase_peb(struct ssdfs_fs_info *fsi,
 	return 0;
 }
 
+#define SSDFS_MAPTBL_ERASE_RANGE_MAX	(16)
+#define SSDFS_MAPTBL_ASYNC_ERASE_MAX	(64)
+
+/*
+ * ssdfs_maptbl_define_erase_range() - define range of adjacent PEBs
+ * @fsi: file system info object
+ * @array: array of erase operation results
+ * @start: index of the first item in the range
+ *
+ * This method defines the number of items (starting from @start)
+ * that describe the adjacent PEBs for the same trim request.
+ *
+ * RETURN: number of items in the range.
+ */
+static
+u32 ssdfs_maptbl_define_erase_range(struct ssdfs_fs_info *fsi,
+				    struct ssdfs_erase_result_array *array,
+				    u32 start)
+{
+	struct ssdfs_erase_result *prev, *cur;
+	u64 max_peb_id = (LLONG_MAX - 1) / fsi->erasesize;
+	u32 count = 1;
+
+	prev = &array->ptr[start];
+
+	if (prev->state != SSDFS_ERASE_RESULT_UNKNOWN ||
+	    prev->peb_id >= max_peb_id)
+		return count;
+
+	while ((start + count) < array->size &&
+		count < SSDFS_MAPTBL_ERASE_RANGE_MAX) {
+		cur = &array->ptr[start + count];
+
+		if (cur->state != SSDFS_ERASE_RESULT_UNKNOWN)
+			break;
+
+		if (cur->peb_id != (prev->peb_id + 1) ||
+		    cur->peb_id >= max_peb_id)
+			break;
+
+		prev = cur;
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * ssdfs_maptbl_erase_peb_range() - erase range of adjacent PEBs
+ * @fsi: file system info object
+ * @results: array of erase operation results [in|out]
+ * @count: number of adjacent PEBs in the range
+ *
+ * This method tries to erase adjacent PEBs by one trim request.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EROFS   - file system in RO state.
+ * %-EFAULT  - range erase has failed (erase PEBs one by one).
+ */
+static
+int ssdfs_maptbl_erase_peb_range(struct ssdfs_fs_info *fsi,
+				 struct ssdfs_erase_result *results,
+				 u32 count)
+{
+	loff_t offset;
+	size_t len = (size_t)fsi->erasesize * count;
+	u32 i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !results || count == 0);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	offset = results[0].peb_id * fsi->erasesize;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("peb_id %llu, count %u, offset %llu, len %zu\n",
+		  results[0].peb_id, count, (u64)offset, len);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	for (i = 0; i < count; i++)
+		ssdfs_log_hdr_cache_invalidate_peb(fsi, results[i].peb_id);
+
+	err = fsi->devops->trim(fsi->sb, offset, len);
+	if (err == -EROFS) {
+		SSDFS_DBG("file system has READ_ONLY state\n");
+		return err;
+	} else if (unlikely(err)) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("range erase failure: "
+			  "peb_id %llu, count %u, err %d\n",
+			  results[0].peb_id, count, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return -EFAULT;
+	}
+
+	for (i = 0; i < count; i++)
+		results[i].state = SSDFS_ERASE_DONE;
+
+	return 0;
+}
+
+/*
+ * ssdfs_maptbl_finish_async_erase() - finish window of asynchronous erases
+ * @fsi: file system info object
+ * @array: array of erase operation results [in|out]
+ * @start: index of the first item in the window
+ * @end: index of the item after the window
+ * @batch: batch of asynchronous discard requests
+ *
+ * This method waits the end of submitted discards. The PEBs
+ * of the window are marked as erased in the case of success.
+ * Otherwise, the PEBs stay untouched and they will be erased
+ * one by one for detection of the failed PEB.
+ */
+static
+void ssdfs_maptbl_finish_async_erase(struct ssdfs_fs_info *fsi,
+				     struct ssdfs_erase_result_array *array,
+				     u32 start, u32 end,
+				     struct ssdfs_io_batch *batch)
+{
+	u32 i;
+	int err;
+
+	err = fsi->devops->wait_trims(fsi->sb, batch);
+	if (unlikely(err)) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("async erase failure: "
+			  "start %u, end %u, err %d\n",
+			  start, end, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+	}
+
+	for (i = start; i < end; i++) {
+		struct ssdfs_erase_result *result = &array->ptr[i];
+
+		if (result->state != SSDFS_ERASE_SUBMITTED)
+			continue;
+
+		if (err)
+			result->state = SSDFS_ERASE_RESULT_UNKNOWN;
+		else
+			result->state = SSDFS_ERASE_DONE;
+	}
+}
+
+/*
+ * ssdfs_maptbl_erase_pebs_array_async() - erase PEBs asynchronously
+ * @fsi: file system info object
+ * @array: array of erase operation results [in|out]
+ *
+ * This method submits the discards of all ranges of adjacent PEBs
+ * without waiting the end of every request. The number of PEBs
+ * under erase is limited by SSDFS_MAPTBL_ASYNC_ERASE_MAX. So, the
+ * discards don't saturate the device at the expense of the writes.
+ * All submitted discards are finished before this method returns
+ * because the erased PEBs could be reused right after that.
+ * The PEBs that failed to be erased keep the unknown state.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EROFS   - file system in RO state.
+ */
+static
+int ssdfs_maptbl_erase_pebs_array_async(struct ssdfs_fs_info *fsi,
+					struct ssdfs_erase_result_array *array)
+{
+	struct ssdfs_io_batch batch;
+	u64 max_peb_id = (LLONG_MAX - 1) / fsi->erasesize;
+	u32 window_start = 0;
+	u32 inflight = 0;
+	u32 i, j;
+	u32 count;
+	int err = 0;
+
+	ssdfs_io_batch_init(&batch);
+
+	for (i = 0; i < array->size; i += count) {
+		struct ssdfs_erase_result *result = &array->ptr[i];
+		loff_t offset;
+		size_t len;
+
+		count = ssdfs_maptbl_define_erase_range(fsi, array, i);
+
+		if (result->state != SSDFS_ERASE_RESULT_UNKNOWN ||
+		    result->peb_id >= max_peb_id)
+			continue;
+
+		if ((inflight + count) > SSDFS_MAPTBL_ASYNC_ERASE_MAX) {
+			ssdfs_maptbl_finish_async_erase(fsi, array,
+							window_start, i,
+							&batch);
+			window_start = i;
+			inflight = 0;
+		}
+
+		for (j = i; j < (i + count); j++)
+			ssdfs_log_hdr_cache_invalidate_peb(fsi,
+							   array->ptr[j].peb_id);
+
+		offset = result->peb_id * fsi->erasesize;
+		len = (size_t)fsi->erasesize * count;
+
+		err = fsi->devops->trim_async(fsi->sb, offset, len, &batch);
+		if (unlikely(err)) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("unable to submit erase: "
+				  "peb_id %llu, count %u, err %d\n",
+				  result->peb_id, count, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+			break;
+		}
+
+		for (j = i; j < (i + count); j++)
+			array->ptr[j].state = SSDFS_ERASE_SUBMITTED;
+
+		inflight += count;
+	}
+
+	ssdfs_maptbl_finish_async_erase(fsi, array, window_start,
+					array->size, &batch);
+
+	if (err == -EROFS)
+		return err;
+
+	return 0;
+}
+
 /*
  * ssdfs_maptbl_erase_pebs_array() - erase PEBs
  * @fsi: file system info object
  * @array: array of erase operation results [in|out]
  *
- * This method tries to erase dirty PEBs.
+ * This method tries to erase dirty PEBs. The adjacent PEBs
+ * are erased by one trim request. The requests are submitted
+ * asynchronously if the device supports it. If such request fails,
+ * then the PEBs of the range are erased one by one for detection
+ * of the failed PEB.
  *
  * RETURN:
  * [success]
@@ -544,7 +784,8 @@ static inline
 int ssdfs_maptbl_erase_pebs_array(struct ssdfs_fs_info *fsi,
 				  struct ssdfs_erase_result_array *array)
 {
-	u32 i;
+	u32 i, j;
+	u32 count;
 	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -560,15 +801,40 @@ int ssdfs_maptbl_erase_pebs_array(struct ssdfs_fs_info *fsi,
 	if (array->size == 0)
 		return 0;
 
-	for (i = 0; i < array->size; i++) {
-		err = ssdfs_maptbl_erase_peb(fsi, &array->ptr[i]);
-		if (unlikely(err)) {
+	if (fsi->devops->trim_async && fsi->devops->wait_trims) {
+		err = ssdfs_maptbl_erase_pebs_array_async(fsi, array);
+		if (err == -EROFS)
+			return err;
+	}
+
+	for (i = 0; i < array->size; i += count) {
+		if (array->ptr[i].state == SSDFS_ERASE_DONE) {
+			count = 1;
+			continue;
+		}
+
+		count = ssdfs_maptbl_define_erase_range(fsi, array, i);
+
+		if (count > 1) {
+			err = ssdfs_maptbl_erase_peb_range(fsi,
+							   &array->ptr[i],
+							   count);
+			if (err == -EROFS)
+				return err;
+			else if (!err)
+				continue;
+		}
+
+		for (j = i; j < (i + count); j++) {
+			err = ssdfs_maptbl_erase_peb(fsi, &array->ptr[j]);
+			if (unlikely(err)) {
 #ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("unable to erase PEB: "
-				  "peb_id %llu, err %d\n",
-				  array->ptr[i].peb_id, err);
+				SSDFS_DBG("unable to erase PEB: "
+					  "peb_id %llu, err %d\n",
+					  array->ptr[j].peb_id, err);
 #endif /* CONFIG_SSDFS_DEBUG */
-			return err;
+				return err;
+			}
 		}
 	}
 
@@ -668,6 +934,8 @@ int ssdfs_maptbl_correct_peb_state(struct ssdfs_maptbl_fragment_desc *fdesc,
 		goto finish_page_processing;
 	}
 
+	ssdfs_maptbl_wear_stats_erase(&fdesc->wear,
+				      le32_to_cpu(ptr->erase_cycles));
 	le32_add_cpu(&ptr->erase_cycles, 1);
 	ptr->type = SSDFS_MAPTBL_UNKNOWN_PEB_TYPE;
 
@@ -814,7 +1082,7 @@ ssdfs_maptbl_correct_fragment_dirty_pebs(struct ssdfs_peb_mapping_table *tbl,
 		return -ERANGE;
 	}
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	if (fdesc->pre_erase_pebs == 0) {
 		SSDFS_ERR("fdesc->pre_erase_pebs == 0\n");
@@ -858,7 +1126,7 @@ ssdfs_maptbl_correct_fragment_dirty_pebs(struct ssdfs_peb_mapping_table *tbl,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_fragment_correction:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err) {
 		if (is_ssdfs_maptbl_going_to_be_destroyed(tbl)) {
@@ -1322,7 +1590,7 @@ int ssdfs_maptbl_collect_recovering_pebs(struct ssdfs_peb_mapping_table *tbl,
 		return 0;
 	}
 
-	down_read(&fdesc->lock);
+	SSDFS_DOWN_READ(maptbl_frag, &fdesc->lock);
 
 	if (fdesc->recovering_pebs == 0) {
 		/* no PEBs for recovering */
@@ -1688,7 +1956,7 @@ ssdfs_correct_fragment_recovered_pebs(struct ssdfs_peb_mapping_table *tbl,
 		return -ERANGE;
 	}
 
-	down_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_lock(fdesc);
 
 	if (fdesc->recovering_pebs == 0) {
 		SSDFS_ERR("fdesc->recovering_pebs == 0\n");
@@ -1713,7 +1981,7 @@ ssdfs_correct_fragment_recovered_pebs(struct ssdfs_peb_mapping_table *tbl,
 		 fragment_index == array->ptr[*item_index].fragment_index);
 
 finish_fragment_correction:
-	up_write(&fdesc->lock);
+	ssdfs_maptbl_fragment_write_unlock(fdesc);
 
 	if (!err) {
 		if (is_ssdfs_maptbl_going_to_be_destroyed(tbl)) {
@@ -2321,7 +2589,7 @@ int ssdfs_maptbl_resolve_peb_mapping(struct ssdfs_peb_mapping_table *tbl,
 	switch (consistency) {
 	case SSDFS_PEB_STATE_INCONSISTENT:
 		down_write(&cache->lock);
-		down_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_lock(fdesc);
 
 		err = ssdfs_maptbl_cache_convert_leb2peb_nolock(cache,
 								pmi->leb_id,
@@ -2378,7 +2646,7 @@ int ssdfs_maptbl_resolve_peb_mapping(struct ssdfs_peb_mapping_table *tbl,
 		}
 
 finish_inconsistent_case:
-		up_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_unlock(fdesc);
 		up_write(&cache->lock);
 
 		if (!err) {
@@ -2389,7 +2657,7 @@ finish_inconsistent_case:
 
 	case SSDFS_PEB_STATE_PRE_DELETED:
 		down_write(&cache->lock);
-		down_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_lock(fdesc);
 
 		err = ssdfs_maptbl_cache_convert_leb2peb_nolock(cache,
 								pmi->leb_id,
@@ -2423,7 +2691,7 @@ finish_inconsistent_case:
 		}
 
 finish_pre_deleted_case:
-		up_write(&fdesc->lock);
+		ssdfs_maptbl_fragment_write_unlock(fdesc);
 		up_write(&cache->lock);
 
 		if (!err) {
@@ -2507,6 +2775,32 @@ finish_erase_dirty_pebs:
 }
 #endif /* CONFIG_SSDFS_TESTING */
 
+/*
+ * is_maptbl_erase_pool_low() - check that erased PEBs are needed urgently
+ * @tbl: mapping table object
+ *
+ * The erase of dirty PEBs is repeated without delay (while
+ * the previous round was able to erase something) if somebody
+ * waits for the end of erase operation (there is no clean PEB
+ * for mapping) or the number of dirty PEBs is above
+ * the high watermark. Otherwise, the dirty PEBs are erased
+ * in the background once per second with the pace that
+ * is limited by the current I/O load.
+ */
+static inline
+bool is_maptbl_erase_pool_low(struct ssdfs_peb_mapping_table *tbl)
+{
+	int threshold;
+
+	if (wq_has_sleeper(&tbl->erase_ops_end_wq))
+		return true;
+
+	threshold = atomic_read(&tbl->max_erase_ops) *
+				SSDFS_MAPTBL_PRE_ERASE_HIGH_WATERMARK;
+
+	return atomic_read(&tbl->pre_erase_pebs) > threshold;
+}
+
 #define MAPTBL_PTR(tbl) \
 	((struct ssdfs_peb_mapping_table *)(tbl))
 #define MAPTBL_THREAD_WAKE_CONDITION(tbl, cache) \
@@ -2516,6 +2810,13 @@ finish_erase_dirty_pebs:
 #define MAPTBL_FAILED_THREAD_WAKE_CONDITION() \
 	(kthread_should_stop())
 
+/*
+ * The PEB mappings are taken from the queue by batches.
+ * It decreases the contention on the queue's lock with
+ * the threads that add the PEB mappings into the queue.
+ */
+#define SSDFS_MAPTBL_PM_BATCH_MAX	(64)
+
 /*
  * ssdfs_maptbl_thread_func() - maptbl object's thread's function
  */
@@ -2525,9 +2826,11 @@ int ssdfs_maptbl_thread_func(void *data)
 	struct ssdfs_fs_info *fsi;
 	struct ssdfs_peb_mapping_table *tbl = data;
 	struct ssdfs_maptbl_cache *cache;
+	struct ssdfs_peb_mapping_queue *pmq;
 	struct ssdfs_peb_mapping_info *pmi;
 	wait_queue_head_t *wait_queue;
 	struct ssdfs_erase_result_array array = {NULL, 0, 0};
+	int pre_erase_pebs;
 	int i;
 	int err = 0;
 
@@ -2542,6 +2845,7 @@ int ssdfs_maptbl_thread_func(void *data)
 
 	fsi = tbl->fsi;
 	cache = &fsi->maptbl_cache;
+	pmq = &cache->pm_queue;
 	wait_queue = &tbl->wait_queue;
 
 	down_read(&tbl->tbl_lock);
@@ -2605,50 +2909,51 @@ repeat:
 		goto sleep_maptbl_thread;
 	}
 
-	while (!is_ssdfs_peb_mapping_queue_empty(&cache->pm_queue)) {
-		err = ssdfs_peb_mapping_queue_remove_first(&cache->pm_queue,
-							   &pmi);
-		if (err == -ENODATA) {
-			/* empty queue */
-			err = 0;
-			break;
-		} else if (err == -ENOENT) {
-			SSDFS_WARN("request queue contains NULL request\n");
-			err = 0;
-			continue;
-		} else if (unlikely(err < 0)) {
-			SSDFS_CRIT("fail to get request from the queue: "
-				   "err %d\n",
-				   err);
-			goto check_next_step;
-		}
+	while (!is_ssdfs_peb_mapping_queue_empty(pmq)) {
+		LIST_HEAD(batch);
 
-		err = ssdfs_maptbl_resolve_peb_mapping(tbl, cache, pmi);
-		if (err == -EBUSY) {
-			err = 0;
-			ssdfs_peb_mapping_queue_add_tail(&cache->pm_queue,
-							 pmi);
-			goto sleep_maptbl_thread;
-		} else if (err == -EAGAIN) {
-			ssdfs_peb_mapping_queue_add_tail(&cache->pm_queue,
-							 pmi);
-			continue;
-		} else if (unlikely(err)) {
-			ssdfs_peb_mapping_queue_add_tail(&cache->pm_queue,
-							 pmi);
-			SSDFS_ERR("failed to resolve inconsistency: "
-				  "leb_id %llu, peb_id %llu, err %d\n",
-				  pmi->leb_id, pmi->peb_id, err);
-			goto check_next_step;
-		}
+		ssdfs_peb_mapping_queue_remove_batch(pmq, &batch,
+						SSDFS_MAPTBL_PM_BATCH_MAX);
 
-		ssdfs_peb_mapping_info_free(pmi);
+		while (!list_empty(&batch)) {
+			pmi = list_first_entry(&batch,
+					       struct ssdfs_peb_mapping_info,
+					       list);
+			list_del(&pmi->list);
 
-		if (kthread_should_stop())
-			goto repeat;
+			err = ssdfs_maptbl_resolve_peb_mapping(tbl, cache, pmi);
+			if (err == -EBUSY) {
+				err = 0;
+				ssdfs_peb_mapping_queue_add_tail(pmq, pmi);
+				ssdfs_peb_mapping_queue_return_batch(pmq,
+								     &batch);
+				goto sleep_maptbl_thread;
+			} else if (err == -EAGAIN) {
+				ssdfs_peb_mapping_queue_add_tail(pmq, pmi);
+				continue;
+			} else if (unlikely(err)) {
+				ssdfs_peb_mapping_queue_add_tail(pmq, pmi);
+				ssdfs_peb_mapping_queue_return_batch(pmq,
+								     &batch);
+				SSDFS_ERR("failed to resolve inconsistency: "
+					  "leb_id %llu, peb_id %llu, err %d\n",
+					  pmi->leb_id, pmi->peb_id, err);
+				goto check_next_step;
+			}
+
+			ssdfs_peb_mapping_info_free(pmi);
+
+			if (kthread_should_stop()) {
+				ssdfs_peb_mapping_queue_return_batch(pmq,
+								     &batch);
+				goto repeat;
+			}
+		}
 	}
 
 	if (has_maptbl_pre_erase_pebs(tbl)) {
+		pre_erase_pebs = atomic_read(&tbl->pre_erase_pebs);
+
 		err = ssdfs_maptbl_process_dirty_pebs(tbl, &array);
 		if (err == -EBUSY || err == -EAGAIN) {
 			err = 0;
@@ -2660,6 +2965,14 @@ repeat:
 				  err);
 		}
 
+		if (!err &&
+		    atomic_read(&tbl->pre_erase_pebs) < pre_erase_pebs &&
+		    is_maptbl_erase_pool_low(tbl)) {
+			/* refill the pool of erased PEBs without delay */
+			cond_resched();
+			goto repeat;
+		}
+
 		wait_event_interruptible_timeout(*wait_queue,
 					kthread_should_stop(), HZ);
 	}
@@ -40,6 +40,12 @@
 #include "peb_mapping_table.h"
 #include "segment_bitmap.h"
 #include "segment.h"
+#include "current_segment.h"
+#include "btree_search.h"
+#include "btree_node.h"
+#include "btree.h"
+#include "shared_extents_tree.h"
+#include "extents_tree.h"
 
 #ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
 atomic64_t ssdfs_migration_page_leaks;
@@ -131,6 +137,14 @@ int ssdfs_peb_start_migration(struct ssdfs_peb_container *pebc)
 	fsi = pebc->parent_si->fsi;
 	si = pebc->parent_si;
 
+	err = ssdfs_peb_container_start_flush_thread(pebc);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to start flush thread: "
+			  "seg %llu, peb_index %u, err %d\n",
+			  si->seg_id, pebc->peb_index, err);
+		return err;
+	}
+
 	mutex_lock(&pebc->migration_lock);
 
 check_migration_state:
@@ -308,7 +322,7 @@ try_define_items_state:
 			return false;
 		}
 
-		down_read(&pebc->lock);
+		SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 		if (!pebc->dst_peb) {
 			err = -ERANGE;
@@ -478,6 +492,214 @@ bool should_migration_be_finished(struct ssdfs_peb_container *pebc)
 	return !is_pebs_relation_alive(pebc) || has_peb_migration_done(pebc);
 }
 
+/*
+ * is_ssdfs_cold_data() - check that file's data is cold
+ * @inode: pointer on inode object
+ *
+ * The write life hint of inode has priority. Otherwise, the file
+ * is cold if it is not frequently updated and it has not been
+ * modified during SSDFS_COLD_DATA_AGE_SECS.
+ */
+static
+bool is_ssdfs_cold_data(struct inode *inode)
+{
+	time64_t age;
+
+	switch (inode->i_write_hint) {
+	case WRITE_LIFE_SHORT:
+		return false;
+
+	case WRITE_LIFE_LONG:
+	case WRITE_LIFE_EXTREME:
+		return true;
+
+	default:
+		/* use update history */
+		break;
+	}
+
+	if (atomic_read(&SSDFS_I(inode)->updates_count) >=
+					SSDFS_HOT_DATA_UPDATES_THRESHOLD)
+		return false;
+
+	age = ktime_get_real_seconds() - inode->i_mtime.tv_sec;
+
+	return age >= SSDFS_COLD_DATA_AGE_SECS;
+}
+
+/*
+ * ssdfs_peb_relocate_cold_range() - move cold blocks into cold segment
+ * @si: segment object
+ * @pebc: pointer on PEB container
+ * @range: range of copied valid blocks
+ * @req: request with content of the blocks
+ *
+ * The valid blocks are migrated into destination PEB of the same
+ * segment. As a result, cold blocks are mixed with hot ones again
+ * and they are copied by every migration of the PEB. This method
+ * tries to move the cold blocks of the file into the current segment
+ * of cold data stream. The extents tree of the file is corrected
+ * and the logical blocks of the range are freed in the segment.
+ * The relocation is possible only if temperature streams are
+ * enabled, the inode is in memory and the range is the contiguous
+ * piece of file's extent. Flush thread doesn't relocate the blocks
+ * because it cannot wait the extents tree's lock.
+ *
+ * RETURN:
+ * [success] - the request has been added into the cold segment.
+ * [failure] - error code:
+ *
+ * %-ENOENT     - the range should be migrated inside of the segment.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_peb_relocate_cold_range(struct ssdfs_segment_info *si,
+				  struct ssdfs_peb_container *pebc,
+				  struct ssdfs_block_bmap_range *range,
+				  struct ssdfs_segment_request *req)
+{
+	struct ssdfs_fs_info *fsi = si->fsi;
+	struct inode *inode;
+	struct ssdfs_extents_btree_info *etree;
+	struct ssdfs_btree_search *search;
+	struct ssdfs_logical_extent requested;
+	struct ssdfs_volume_extent place;
+	struct ssdfs_blk2off_range new_extent;
+	struct ssdfs_raw_extent old_raw_extent;
+	struct ssdfs_raw_extent new_raw_extent;
+	u64 ino = req->extent.ino;
+	u64 blk;
+	u64 seg_id;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("seg_id %llu, peb_index %u, ino %llu, "
+		  "range (start %u, len %u)\n",
+		  si->seg_id, pebc->peb_index, ino,
+		  range->start, range->len);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!is_ssdfs_peb_containing_user_data(pebc))
+		return -ENOENT;
+
+	if (current == READ_ONCE(pebc->thread[SSDFS_PEB_FLUSH_THREAD].task))
+		return -ENOENT;
+
+	if (!is_ssdfs_data_streams_enabled(fsi->cur_segs))
+		return -ENOENT;
+
+	if (ino >= U64_MAX || range->len == 0)
+		return -ENOENT;
+
+	inode = ilookup(fsi->sb, ino);
+	if (!inode)
+		return -ENOENT;
+
+	if (!S_ISREG(inode->i_mode) || !is_ssdfs_cold_data(inode)) {
+		err = -ENOENT;
+		goto finish_relocation;
+	}
+
+	etree = SSDFS_EXTREE(SSDFS_I(inode));
+	if (!etree) {
+		err = -ENOENT;
+		goto finish_relocation;
+	}
+
+	ssdfs_memcpy(&requested, 0, sizeof(struct ssdfs_logical_extent),
+		     &req->extent, 0, sizeof(struct ssdfs_logical_extent),
+		     sizeof(struct ssdfs_logical_extent));
+
+	err = __ssdfs_prepare_volume_extent(fsi, inode, &requested, &place);
+	if (err ||
+	    place.start.seg_id != si->seg_id ||
+	    place.start.blk_index != range->start ||
+	    place.len != range->len) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("range is not contiguous piece of extent: "
+			  "ino %llu, err %d\n",
+			  ino, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+		err = -ENOENT;
+		goto finish_relocation;
+	}
+
+	search = ssdfs_btree_search_alloc();
+	if (!search) {
+		err = -ENOENT;
+		goto finish_relocation;
+	}
+
+	blk = req->extent.logical_offset >> fsi->log_pagesize;
+
+	old_raw_extent.seg_id = cpu_to_le64(si->seg_id);
+	old_raw_extent.logical_blk = cpu_to_le32(range->start);
+	old_raw_extent.len = cpu_to_le32(range->len);
+
+	err = ssdfs_segment_relocate_cold_extent_async(fsi, req, &seg_id,
+							&new_extent);
+	if (err) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("unable to relocate cold extent: "
+			  "ino %llu, err %d\n",
+			  ino, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+		err = -ENOENT;
+		goto free_search_object;
+	}
+
+	/* the request belongs to the cold segment from this point */
+
+	new_raw_extent.seg_id = cpu_to_le64(seg_id);
+	new_raw_extent.logical_blk = cpu_to_le32(new_extent.start_lblk);
+	new_raw_extent.len = cpu_to_le32(new_extent.len);
+
+	ssdfs_btree_search_init(search);
+	err = ssdfs_extents_tree_move_extent(etree, blk,
+					     &old_raw_extent,
+					     &new_raw_extent,
+					     search);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to move extent: "
+			  "ino %llu, blk %llu, "
+			  "old_extent (seg_id %llu, logical_blk %u, len %u), "
+			  "new_extent (seg_id %llu, logical_blk %u, len %u), "
+			  "err %d\n",
+			  ino, blk, si->seg_id, range->start, range->len,
+			  seg_id, new_extent.start_lblk, new_extent.len,
+			  err);
+
+		/* old blocks keep the data, new ones are orphaned */
+		ssdfs_shextree_add_pre_invalid_extent(fsi->shextree, ino,
+							&new_raw_extent);
+		goto free_search_object;
+	}
+
+	err = ssdfs_segment_release_relocated_extent(si, pebc->peb_index,
+						     range->start,
+						     range->len);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to release relocated extent: "
+			  "seg %llu, range (start %u, len %u), err %d\n",
+			  si->seg_id, range->start, range->len, err);
+		goto free_search_object;
+	}
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("cold range has been relocated: "
+		  "ino %llu, new_extent (seg_id %llu, "
+		  "logical_blk %u, len %u)\n",
+		  ino, seg_id, new_extent.start_lblk, new_extent.len);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+free_search_object:
+	ssdfs_btree_search_free(search);
+
+finish_relocation:
+	iput(inode);
+	return err;
+}
+
 /*
  * ssdfs_peb_migrate_valid_blocks_range() - migrate valid blocks
  * @si: segment object
@@ -574,16 +796,24 @@ repeat_valid_blocks_processing:
 	req->result.processed_blks = 0;
 	atomic_set(&req->result.state, SSDFS_UNKNOWN_REQ_RESULT);
 
-	err = ssdfs_segment_migrate_range_async(si, req);
-	if (unlikely(err)) {
-		SSDFS_ERR("fail to migrate range: err %d\n",
-			  err);
-		goto fail_process_valid_blocks;
-	}
-
 	sub_range.start = copy_range.start;
 	sub_range.len = processed_blks;
 
+	err = ssdfs_peb_relocate_cold_range(si, pebc, &sub_range, req);
+	if (err == -ENOENT) {
+		err = ssdfs_segment_migrate_range_async(si, req);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to migrate range: err %d\n",
+				  err);
+			goto fail_process_valid_blocks;
+		}
+	} else if (unlikely(err)) {
+		SSDFS_ERR("fail to relocate cold range: "
+			  "(start %u, len %u), err %d\n",
+			  sub_range.start, sub_range.len, err);
+		goto finish_valid_blocks_processing;
+	}
+
 	err = ssdfs_peb_blk_bmap_invalidate(peb_blkbmap,
 					    SSDFS_PEB_BLK_BMAP_SOURCE,
 					    &sub_range);
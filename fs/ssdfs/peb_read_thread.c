@@ -50,6 +50,7 @@
 #include "diff_on_write.h"
 #include "shared_extents_tree.h"
 #include "invalidated_extents_tree.h"
+#include "log_header_cache.h"
 
 #include <trace/events/ssdfs.h>
 
@@ -121,6 +122,29 @@ struct ssdfs_segbmap_extent {
 	u16 fragment_size;
 };
 
+/*
+ * is_ssdfs_fragment_blob_type() - check type of data fragment
+ * @type: fragment descriptor's type
+ */
+static inline
+bool is_ssdfs_fragment_blob_type(u8 type)
+{
+	switch (type) {
+	case SSDFS_FRAGMENT_UNCOMPR_BLOB:
+	case SSDFS_FRAGMENT_ZLIB_BLOB:
+	case SSDFS_FRAGMENT_LZO_BLOB:
+	case SSDFS_FRAGMENT_ZSTD_BLOB:
+	case SSDFS_FRAGMENT_LZ4_BLOB:
+		return true;
+
+	default:
+		/* do nothing */
+		break;
+	}
+
+	return false;
+}
+
 static
 void ssdfs_prepare_blk_bmap_init_env(struct ssdfs_blk_bmap_init_env *env,
 				     u32 pages_per_peb)
@@ -411,7 +435,7 @@ int ssdfs_peb_release_pages(struct ssdfs_peb_container *pebc)
 		  pebc->parent_si->seg_id, pebc->peb_index);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_write(&pebc->lock);
+	SSDFS_DOWN_WRITE(pebc, &pebc->lock);
 
 	pebi = pebc->src_peb;
 	if (pebi) {
@@ -607,6 +631,11 @@ int ssdfs_peb_read_log_hdr_desc_array(struct ssdfs_peb_info *pebi,
 	fsi = pebi->pebc->parent_si->fsi;
 	page_off = log_start_page;
 
+	err = ssdfs_log_hdr_cache_get_desc_array(fsi, pebi->peb_id, page_off,
+						 array, array_size);
+	if (!err)
+		return 0;
+
 	page = ssdfs_page_array_get_page_locked(&pebi->cache, page_off);
 	if (unlikely(IS_ERR_OR_NULL(page))) {
 #ifdef CONFIG_SSDFS_DEBUG
@@ -924,6 +953,7 @@ free_buf:
  * @pebi: pointer on PEB object
  * @frag: fragment descriptor
  * @area_offset: area offset in bytes
+ * @buf: buffer for decompressed fragment [out]
  *
  * This function tries to decompress block descriptor fragment.
  *
@@ -938,16 +968,16 @@ free_buf:
 static
 int ssdfs_decompress_blk_desc_fragment(struct ssdfs_peb_info *pebi,
 					struct ssdfs_fragment_desc *frag,
-					u32 area_offset)
+					u32 area_offset,
+					struct ssdfs_peb_read_buffer *buf)
 {
-	struct ssdfs_peb_read_buffer *buf;
 	u16 uncompr_size;
 	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!pebi || !pebi->pebc || !pebi->pebc->parent_si);
 	BUG_ON(!pebi->pebc->parent_si->fsi);
-	BUG_ON(!frag);
+	BUG_ON(!frag || !buf);
 	BUG_ON(!rwsem_is_locked(&pebi->read_buffer.lock));
 
 	SSDFS_DBG("seg %llu, peb %llu, area_offset %u\n",
@@ -956,7 +986,6 @@ int ssdfs_decompress_blk_desc_fragment(struct ssdfs_peb_info *pebi,
 		  area_offset);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	buf = &pebi->read_buffer.blk_desc;
 	uncompr_size = le16_to_cpu(frag->uncompr_size);
 
 	if (buf->buf_size < uncompr_size) {
@@ -987,8 +1016,11 @@ int ssdfs_decompress_blk_desc_fragment(struct ssdfs_peb_info *pebi,
  * @pebi: pointer on PEB object
  * @meta_desc: area descriptor
  * @offset: offset in bytes to read block descriptor
+ * @buf: buffer for decompressed fragment [out]
  *
- * This function tries to decompress block descriptor fragment.
+ * This function tries to decompress block descriptor fragment
+ * that contains the requested @offset. The logical offset of
+ * the fragment's beginning is stored into @buf.
  *
  * RETURN:
  * [success]
@@ -1001,7 +1033,8 @@ int ssdfs_decompress_blk_desc_fragment(struct ssdfs_peb_info *pebi,
 static
 int ssdfs_peb_decompress_blk_desc_fragment(struct ssdfs_peb_info *pebi,
 				struct ssdfs_metadata_descriptor *meta_desc,
-				u32 offset)
+				u32 offset,
+				struct ssdfs_peb_read_buffer *buf)
 {
 	struct ssdfs_area_block_table table;
 	size_t tbl_size = sizeof(struct ssdfs_area_block_table);
@@ -1017,7 +1050,7 @@ int ssdfs_peb_decompress_blk_desc_fragment(struct ssdfs_peb_info *pebi,
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!pebi || !pebi->pebc || !pebi->pebc->parent_si);
 	BUG_ON(!pebi->pebc->parent_si->fsi);
-	BUG_ON(!meta_desc);
+	BUG_ON(!meta_desc || !buf);
 	BUG_ON(!rwsem_is_locked(&pebi->read_buffer.lock));
 
 	SSDFS_DBG("seg %llu, peb %llu, offset %u\n",
@@ -1122,13 +1155,15 @@ try_read_area_block_table:
 
 			if (offset < (fragment_offset + frag_uncompr_size)) {
 				err = ssdfs_decompress_blk_desc_fragment(pebi,
-							frag, portion_offset);
+							frag, portion_offset,
+							buf);
 				if (unlikely(err)) {
 					SSDFS_ERR("fail to decompress: "
 						  "err %d\n", err);
 					return err;
 				}
 
+				buf->offset = fragment_offset;
 				break;
 			}
 		}
@@ -1156,30 +1191,87 @@ try_read_area_block_table:
 	return 0;
 }
 
+/*
+ * ssdfs_peb_find_cached_blk_desc_fragment() - find cached fragment
+ * @buf: temporary read buffers
+ * @log_start_page: starting page of the log
+ * @offset: offset in bytes of block descriptor
+ *
+ * This method tries to find the decompressed fragment
+ * of block descriptor table that contains the requested
+ * block descriptor.
+ *
+ * RETURN:
+ * [success] - pointer on the buffer with the fragment.
+ * [failure] - NULL (fragment is not in the cache).
+ */
 static inline
-bool is_read_buffer_offset_invalid(struct ssdfs_peb_temp_read_buffers *buf)
+struct ssdfs_peb_read_buffer *
+ssdfs_peb_find_cached_blk_desc_fragment(struct ssdfs_peb_temp_read_buffers *buf,
+					u16 log_start_page, u32 offset)
 {
-	return buf->blk_desc.offset >= U32_MAX;
+	size_t blk_desc_size = sizeof(struct ssdfs_block_descriptor);
+	int i;
+
+	for (i = 0; i < SSDFS_PEB_BLK_DESC_CACHE_CAPACITY; i++) {
+		struct ssdfs_peb_read_buffer *cached = &buf->blk_desc[i];
+		u64 upper_bound;
+
+		if (!cached->ptr || cached->offset >= U32_MAX)
+			continue;
+
+		if (cached->log_start_page != log_start_page)
+			continue;
+
+		upper_bound = (u64)cached->offset + cached->fragment_size;
+
+		if (offset >= cached->offset &&
+		    ((u64)offset + blk_desc_size) <= upper_bound)
+			return cached;
+	}
+
+	return NULL;
 }
 
+/*
+ * ssdfs_peb_select_blk_desc_cache_victim() - select buffer for a fragment
+ * @buf: temporary read buffers
+ *
+ * This method selects the unused or the least recently used buffer
+ * for storing the decompressed fragment of block descriptor table.
+ */
 static inline
-bool read_buffer_has_no_requested_data(struct ssdfs_peb_temp_read_buffers *buf,
-				       u32 offset)
+struct ssdfs_peb_read_buffer *
+ssdfs_peb_select_blk_desc_cache_victim(struct ssdfs_peb_temp_read_buffers *buf)
 {
-	u32 lower_bound = buf->blk_desc.offset;
-	u32 upper_bound = buf->blk_desc.offset + buf->blk_desc.fragment_size;
+	struct ssdfs_peb_read_buffer *victim = &buf->blk_desc[0];
+	int i;
+
+	for (i = 0; i < SSDFS_PEB_BLK_DESC_CACHE_CAPACITY; i++) {
+		struct ssdfs_peb_read_buffer *cached = &buf->blk_desc[i];
+
+		if (cached->offset >= U32_MAX)
+			return cached;
 
-	return offset < lower_bound || upper_bound;
+		if (cached->last_access < victim->last_access)
+			victim = cached;
+	}
+
+	return victim;
 }
 
 /*
  * ssdfs_peb_read_block_descriptor() - read block descriptor
  * @pebi: pointer on PEB object
+ * @log_start_page: starting page of the log
  * @meta_desc: area descriptor
  * @offset: offset in bytes to read block descriptor
  * @blk_desc: block descriptor [out]
  *
- * This function tries to read block descriptor.
+ * This function tries to read block descriptor. The compressed
+ * fragments of block descriptor table are decompressed into
+ * the PEB's cache. So, the reads of several block descriptors
+ * from the same fragment decompress the fragment only once.
  *
  * RETURN:
  * [success]
@@ -1191,12 +1283,14 @@ bool read_buffer_has_no_requested_data(struct ssdfs_peb_temp_read_buffers *buf,
  */
 static
 int ssdfs_peb_read_block_descriptor(struct ssdfs_peb_info *pebi,
+				    u16 log_start_page,
 				    struct ssdfs_metadata_descriptor *meta_desc,
 				    u32 offset,
 				    struct ssdfs_block_descriptor *blk_desc)
 {
 	struct ssdfs_fs_info *fsi;
 	struct ssdfs_peb_temp_read_buffers *buf;
+	struct ssdfs_peb_read_buffer *cached = NULL;
 	size_t blk_desc_size = sizeof(struct ssdfs_block_descriptor);
 	int compr_type = SSDFS_COMPR_NONE;
 	u16 flags;
@@ -1207,10 +1301,10 @@ int ssdfs_peb_read_block_descriptor(struct ssdfs_peb_info *pebi,
 	BUG_ON(!pebi->pebc->parent_si->fsi);
 	BUG_ON(!meta_desc || !blk_desc);
 
-	SSDFS_DBG("seg %llu, peb %llu, offset %u\n",
+	SSDFS_DBG("seg %llu, peb %llu, log_start_page %u, offset %u\n",
 		  pebi->pebc->parent_si->seg_id,
 		  pebi->peb_id,
-		  offset);
+		  log_start_page, offset);
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	fsi = pebi->pebc->parent_si->fsi;
@@ -1233,40 +1327,42 @@ int ssdfs_peb_read_block_descriptor(struct ssdfs_peb_info *pebi,
 
 		down_write(&buf->lock);
 
-		if (!buf->blk_desc.ptr) {
-			err = -ENOMEM;
-			SSDFS_ERR("buffer is not allocated\n");
-			goto finish_decompress;
-		}
+		cached = ssdfs_peb_find_cached_blk_desc_fragment(buf,
+								log_start_page,
+								offset);
+		if (cached) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("Read block descsriptor from the buffer\n");
+#endif /* CONFIG_SSDFS_DEBUG */
+		} else {
+			cached = ssdfs_peb_select_blk_desc_cache_victim(buf);
 
-		if (is_read_buffer_offset_invalid(buf)) {
-			err = ssdfs_peb_decompress_blk_desc_fragment(pebi,
-								     meta_desc,
-								     offset);
-			if (unlikely(err)) {
-				SSDFS_ERR("fail to decompress: err %d\n",
-					  err);
+			if (!cached->ptr) {
+				err = -ENOMEM;
+				SSDFS_ERR("buffer is not allocated\n");
 				goto finish_decompress;
 			}
 
-			buf->blk_desc.offset = offset;
-		} else if (read_buffer_has_no_requested_data(buf, offset)) {
+			cached->offset = U32_MAX;
+			cached->fragment_size = 0;
+
 			err = ssdfs_peb_decompress_blk_desc_fragment(pebi,
 								     meta_desc,
-								     offset);
+								     offset,
+								     cached);
 			if (unlikely(err)) {
 				SSDFS_ERR("fail to decompress: err %d\n",
 					  err);
+				cached->offset = U32_MAX;
+				cached->fragment_size = 0;
 				goto finish_decompress;
 			}
 
-			buf->blk_desc.offset = offset;
-		} else {
-#ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("Read block descsriptor from the buffer\n");
-#endif /* CONFIG_SSDFS_DEBUG */
+			cached->log_start_page = log_start_page;
 		}
 
+		cached->last_access = ++buf->access_counter;
+
 finish_decompress:
 		downgrade_write(&buf->lock);
 
@@ -1278,16 +1374,16 @@ finish_decompress:
 
 		err = ssdfs_memcpy(blk_desc,
 				   0, blk_desc_size,
-				   buf->blk_desc.ptr,
-				   offset - buf->blk_desc.offset,
-				   buf->blk_desc.fragment_size,
+				   cached->ptr,
+				   offset - cached->offset,
+				   cached->fragment_size,
 				   blk_desc_size);
 		if (unlikely(err)) {
 			SSDFS_ERR("invalid buffer state: "
 				  "offset %u, buffer (offset %u, size %zu)\n",
 				  offset,
-				  buf->blk_desc.offset,
-				  buf->blk_desc.fragment_size);
+				  cached->offset,
+				  cached->fragment_size);
 			goto finish_read_compressed_blk_desc;
 		}
 
@@ -1329,7 +1425,16 @@ finish_read_compressed_blk_desc:
  * @desc_off: descriptor of physical offset
  * @blk_desc: block descriptor [out]
  *
- * This function tries to get block descriptor.
+ * This function tries to get block descriptor. The block descriptor
+ * is not searched in the block descriptor table. The offset
+ * translation table stores the byte offset of the descriptor
+ * from the area's beginning (blk_state.byte_offset). So, the read
+ * goes straight to the descriptor. Only the compressed area needs
+ * to find the fragment with the requested offset. Every area
+ * block table describes not more than SSDFS_FRAGMENTS_CHAIN_MAX
+ * fragments and the decompressed fragments are cached. It is why
+ * a sorted index of block descriptors at the end of the area
+ * is not stored in the log.
  *
  * RETURN:
  * [success]
@@ -1409,9 +1514,11 @@ int ssdfs_peb_find_block_descriptor(struct ssdfs_peb_info *pebi,
 		  area_offset, blk_desc_off);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	err = ssdfs_peb_read_block_descriptor(pebi, &array[area_index],
-					      area_offset + blk_desc_off,
-					      blk_desc);
+	err = ssdfs_peb_read_block_descriptor(pebi,
+					le16_to_cpu(blk_state->log_start_page),
+					&array[area_index],
+					area_offset + blk_desc_off,
+					blk_desc);
 	if (err) {
 		page_off = (area_offset + blk_desc_off) / PAGE_SIZE;
 		pages_count = (area_size + PAGE_SIZE - 1) / PAGE_SIZE;
@@ -1461,9 +1568,11 @@ int ssdfs_peb_find_block_descriptor(struct ssdfs_peb_info *pebi,
 
 		pagevec_reinit(&pvec);
 
-		err = ssdfs_peb_read_block_descriptor(pebi, &array[area_index],
-						     area_offset + blk_desc_off,
-						     blk_desc);
+		err = ssdfs_peb_read_block_descriptor(pebi,
+					le16_to_cpu(blk_state->log_start_page),
+					&array[area_index],
+					area_offset + blk_desc_off,
+					blk_desc);
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to read block descriptor: "
 				  "peb %llu, area_offset %u, byte_offset %u, "
@@ -1930,7 +2039,9 @@ int ssdfs_read_checked_fragment(struct ssdfs_peb_info *pebi,
 	}
 
 	is_compressed = (desc->type == SSDFS_FRAGMENT_ZLIB_BLOB ||
-			 desc->type == SSDFS_FRAGMENT_LZO_BLOB);
+			 desc->type == SSDFS_FRAGMENT_LZO_BLOB ||
+			 desc->type == SSDFS_FRAGMENT_ZSTD_BLOB ||
+			 desc->type == SSDFS_FRAGMENT_LZ4_BLOB);
 
 	if (desc->type == SSDFS_FRAGMENT_UNCOMPR_BLOB) {
 		if (compr_size != uncompr_size) {
@@ -2003,6 +2114,10 @@ int ssdfs_read_checked_fragment(struct ssdfs_peb_info *pebi,
 			type = SSDFS_COMPR_ZLIB;
 		else if (desc->type == SSDFS_FRAGMENT_LZO_BLOB)
 			type = SSDFS_COMPR_LZO;
+		else if (desc->type == SSDFS_FRAGMENT_ZSTD_BLOB)
+			type = SSDFS_COMPR_ZSTD;
+		else if (desc->type == SSDFS_FRAGMENT_LZ4_BLOB)
+			type = SSDFS_COMPR_LZ4;
 		else
 			BUG();
 
@@ -2356,8 +2471,7 @@ int ssdfs_peb_read_area_fragment(struct ssdfs_peb_info *pebi,
 			goto free_bufs;
 		}
 
-		if (cur_desc->type < SSDFS_FRAGMENT_UNCOMPR_BLOB ||
-		    cur_desc->type > SSDFS_FRAGMENT_LZO_BLOB) {
+		if (!is_ssdfs_fragment_blob_type(cur_desc->type)) {
 			err = -EIO;
 			SSDFS_ERR("invalid fragment descriptor type\n");
 			goto free_bufs;
@@ -2662,8 +2776,7 @@ int ssdfs_peb_read_area_diff_fragment(struct ssdfs_peb_info *pebi,
 		goto free_bufs;
 	}
 
-	if (frag_desc.type < SSDFS_FRAGMENT_UNCOMPR_BLOB ||
-	    frag_desc.type > SSDFS_FRAGMENT_LZO_BLOB) {
+	if (!is_ssdfs_fragment_blob_type(frag_desc.type)) {
 		err = -EIO;
 		SSDFS_ERR("invalid fragment descriptor type\n");
 		goto free_bufs;
@@ -3180,6 +3293,82 @@ finish_read_block_state:
 	return err;
 }
 
+/*
+ * ssdfs_peb_read_pre_allocated_block() - read pre-allocated block
+ * @fsi: file system info object
+ * @req: request
+ *
+ * The pre-allocated block has no state on the volume yet.
+ * This function zeroes the memory pages of the block.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - internal error.
+ * %-EIO        - request hasn't memory page.
+ */
+static
+int ssdfs_peb_read_pre_allocated_block(struct ssdfs_fs_info *fsi,
+					struct ssdfs_segment_request *req)
+{
+	struct page *page;
+	u32 read_bytes;
+	u32 data_bytes;
+	u32 page_off;
+	u32 len;
+	int page_index;
+	int err;
+
+	read_bytes = req->result.processed_blks * fsi->pagesize;
+
+	if (read_bytes >= req->extent.data_bytes) {
+		SSDFS_ERR("read_bytes %u >= req->extent.data_bytes %u\n",
+			  read_bytes, req->extent.data_bytes);
+		return -ERANGE;
+	}
+
+	data_bytes = req->extent.data_bytes - read_bytes;
+	data_bytes = min_t(u32, data_bytes, fsi->pagesize);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("ino %llu, logical_offset %llu, "
+		  "read_bytes %u, data_bytes %u\n",
+		  req->extent.ino, req->extent.logical_offset,
+		  read_bytes, data_bytes);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	while (data_bytes > 0) {
+		page_index = (int)(read_bytes >> PAGE_SHIFT);
+		page_off = read_bytes % PAGE_SIZE;
+		len = min_t(u32, data_bytes, PAGE_SIZE - page_off);
+
+		if (pagevec_count(&req->result.pvec) <= page_index) {
+			SSDFS_ERR("page_index %d >= pagevec_count %u\n",
+				  page_index,
+				  pagevec_count(&req->result.pvec));
+			return -EIO;
+		}
+
+		page = req->result.pvec.pages[page_index];
+
+		err = ssdfs_memzero_page(page, page_off, PAGE_SIZE, len);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to zero page: "
+				  "page_off %u, len %u, err %d\n",
+				  page_off, len, err);
+			return err;
+		}
+
+		read_bytes += len;
+		data_bytes -= len;
+	}
+
+	req->result.processed_blks++;
+
+	return 0;
+}
+
 /*
  * ssdfs_peb_read_page() - read page from PEB
  * @pebc: pointer on PEB container
@@ -3307,9 +3496,15 @@ int ssdfs_peb_read_page(struct ssdfs_peb_container *pebc,
 			return 0;
 	}
 
-	down_read(&pebc->lock);
-
 	blk_state = &desc_off->blk_state;
+
+	if (IS_SSDFS_BLK_STATE_PRE_ALLOCATED(blk_state)) {
+		/* pre-allocated block hasn't content yet */
+		return ssdfs_peb_read_pre_allocated_block(fsi, req);
+	}
+
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
+
 	log_start_page = le16_to_cpu(blk_state->log_start_page);
 
 	if (log_start_page >= fsi->pages_per_peb) {
@@ -3371,6 +3566,242 @@ finish_read_page:
 	return err;
 }
 
+/*
+ * ssdfs_peb_prefetch_cache_pages() - read run of pages into PEB's cache
+ * @pebi: pointer on PEB object
+ * @start: index of the first page in the run
+ * @count: number of pages in the run
+ *
+ * This function tries to read the contiguous run of pages
+ * into PEB's cache by one I/O request. The run is finished
+ * by the first page that is in the cache already.
+ */
+static
+void ssdfs_peb_prefetch_cache_pages(struct ssdfs_peb_info *pebi,
+				    u32 start, u32 count)
+{
+	struct ssdfs_fs_info *fsi;
+	struct pagevec pvec;
+	struct page *page;
+	u32 i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebi || !pebi->pebc || !pebi->pebc->parent_si);
+	BUG_ON(count > PAGEVEC_SIZE);
+
+	SSDFS_DBG("seg %llu, peb %llu, start %u, count %u\n",
+		  pebi->pebc->parent_si->seg_id, pebi->peb_id,
+		  start, count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	fsi = pebi->pebc->parent_si->fsi;
+
+	pagevec_init(&pvec);
+
+	for (i = 0; i < count; i++) {
+		page = ssdfs_page_array_grab_page(&pebi->cache, start + i);
+		if (IS_ERR_OR_NULL(page)) {
+			SSDFS_ERR("fail to grab page: index %u\n",
+				  start + i);
+			break;
+		}
+
+		if (PageUptodate(page) || PageDirty(page)) {
+			ssdfs_unlock_page(page);
+			ssdfs_put_page(page);
+			break;
+		}
+
+		pagevec_add(&pvec, page);
+	}
+
+	if (pagevec_count(&pvec) == 0)
+		return;
+
+	/* pages are unlocked by the read operation */
+	err = ssdfs_read_pagevec_from_volume(fsi, pebi->peb_id,
+					     start << PAGE_SHIFT,
+					     &pvec);
+	if (unlikely(err)) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("unable to read pages: "
+			  "peb_id %llu, start %u, count %u, err %d\n",
+			  pebi->peb_id, start,
+			  pagevec_count(&pvec), err);
+#endif /* CONFIG_SSDFS_DEBUG */
+	}
+
+	for (i = 0; i < pagevec_count(&pvec); i++) {
+		ssdfs_put_page(pvec.pages[i]);
+		pvec.pages[i] = NULL;
+	}
+
+	pagevec_reinit(&pvec);
+}
+
+/*
+ * ssdfs_peb_readahead_prefetch() - prefetch read-ahead window
+ * @pebc: pointer on PEB container
+ * @req: request
+ * @blks_count: number of logical blocks in the request
+ *
+ * This function resolves the logical blocks of the read-ahead window
+ * through the offset translation table and the block descriptors.
+ * The physically contiguous runs of main area's pages are read into
+ * PEB's cache by one I/O request per run. As a result, the block-by-block
+ * processing of the request finds the data in the cache. The prefetch
+ * is the best effort: it stops on the first block that cannot be
+ * resolved simply and leaves the rest of the window for the regular
+ * processing.
+ */
+static
+void ssdfs_peb_readahead_prefetch(struct ssdfs_peb_container *pebc,
+				  struct ssdfs_segment_request *req,
+				  u32 blks_count)
+{
+	struct ssdfs_fs_info *fsi;
+	struct ssdfs_blk2off_table *table;
+	struct ssdfs_peb_info *pebi;
+	struct ssdfs_phys_offset_descriptor *desc_off;
+	struct ssdfs_blk_state_offset *state_off;
+	struct ssdfs_metadata_descriptor blk_desc_array[SSDFS_SEG_HDR_DESC_MAX];
+	struct ssdfs_metadata_descriptor area_desc[SSDFS_SEG_HDR_DESC_MAX];
+	u16 area_log_start_page = U16_MAX;
+	u32 processed_blks = req->result.processed_blks;
+	u32 mem_pages_per_block;
+	u32 committed_pages;
+	u32 run_start = U32_MAX;
+	u32 run_len = 0;
+	u32 i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebc || !pebc->parent_si || !pebc->parent_si->fsi);
+	BUG_ON(!req);
+
+	SSDFS_DBG("seg %llu, peb_index %u, processed_blks %u, "
+		  "blks_count %u\n",
+		  pebc->parent_si->seg_id, pebc->peb_index,
+		  processed_blks, blks_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	fsi = pebc->parent_si->fsi;
+	table = pebc->parent_si->blk2off_table;
+
+	if ((blks_count - processed_blks) < 2)
+		return;
+
+	if (req->private.flags & SSDFS_REQ_READ_ONLY_CACHE)
+		return;
+
+	if (atomic_read(&pebc->migration_state) != SSDFS_PEB_NOT_MIGRATING)
+		return;
+
+	mem_pages_per_block = ssdfs_phys_page_to_mem_page_count(fsi, 1);
+	if (mem_pages_per_block == 0 || mem_pages_per_block > PAGEVEC_SIZE)
+		return;
+
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
+
+	pebi = pebc->src_peb;
+	if (!pebi)
+		goto finish_prefetch;
+
+	ssdfs_peb_current_log_lock(pebi);
+	committed_pages = min_t(u32, pebi->current_log.start_page,
+				fsi->pages_per_peb);
+	ssdfs_peb_current_log_unlock(pebi);
+
+	committed_pages *= mem_pages_per_block;
+
+	for (i = processed_blks; i < blks_count; i++) {
+		struct ssdfs_offset_position pos = {0};
+		int migration_state = SSDFS_LBLOCK_UNKNOWN_STATE;
+		u16 logical_blk = req->place.start.blk_index + i;
+		u16 peb_index;
+		u16 log_start_page;
+		int area_index;
+		u32 byte_off;
+		u32 page_index;
+
+		desc_off = ssdfs_blk2off_table_convert(table, logical_blk,
+							&peb_index,
+							&migration_state,
+							&pos);
+		if (IS_ERR_OR_NULL(desc_off))
+			break;
+
+		if (peb_index != pebc->peb_index ||
+		    is_ssdfs_logical_block_migrating(migration_state))
+			break;
+
+		req->result.processed_blks = i;
+
+		err = ssdfs_blk_desc_buffer_init(pebc, req, desc_off, &pos,
+						 blk_desc_array,
+						 SSDFS_SEG_HDR_DESC_MAX);
+		if (unlikely(err))
+			break;
+
+		state_off = &pos.blk_desc.buf.state[0];
+
+		if (IS_SSDFS_BLK_STATE_OFFSET_INVALID(state_off) ||
+		    state_off->log_area != SSDFS_LOG_MAIN_AREA ||
+		    state_off->peb_migration_id !=
+					ssdfs_get_peb_migration_id(pebi))
+			break;
+
+		log_start_page = le16_to_cpu(state_off->log_start_page);
+
+		if (log_start_page != area_log_start_page) {
+			err = ssdfs_peb_read_log_hdr_desc_array(pebi, req,
+							log_start_page,
+							area_desc,
+							SSDFS_SEG_HDR_DESC_MAX);
+			if (unlikely(err))
+				break;
+
+			area_log_start_page = log_start_page;
+		}
+
+		area_index = SSDFS_AREA_TYPE2INDEX(state_off->log_area);
+		if (area_index >= SSDFS_SEG_HDR_DESC_MAX)
+			break;
+
+		byte_off = le32_to_cpu(area_desc[area_index].offset);
+		byte_off += le32_to_cpu(state_off->byte_offset);
+
+		if (byte_off % PAGE_SIZE)
+			break;
+
+		page_index = byte_off >> PAGE_SHIFT;
+
+		if ((page_index + mem_pages_per_block) > committed_pages)
+			break;
+
+		if (run_len > 0 && page_index == (run_start + run_len) &&
+		    (run_len + mem_pages_per_block) <= PAGEVEC_SIZE) {
+			run_len += mem_pages_per_block;
+			continue;
+		}
+
+		if (run_len > 0)
+			ssdfs_peb_prefetch_cache_pages(pebi, run_start, run_len);
+
+		run_start = page_index;
+		run_len = mem_pages_per_block;
+	}
+
+	if (run_len > 0)
+		ssdfs_peb_prefetch_cache_pages(pebi, run_start, run_len);
+
+finish_prefetch:
+	up_read(&pebc->lock);
+
+	req->result.processed_blks = processed_blks;
+}
+
 /*
  * ssdfs_peb_readahead_pages() - read-ahead pages from PEB
  * @pebc: pointer on PEB container
@@ -3417,6 +3848,8 @@ int ssdfs_peb_readahead_pages(struct ssdfs_peb_container *pebc,
 	pages_count = req->extent.data_bytes + fsi->pagesize - 1;
 	pages_count >>= fsi->log_pagesize;
 
+	ssdfs_peb_readahead_prefetch(pebc, req, pages_count);
+
 	for (i = req->result.processed_blks; i < pages_count; i++) {
 		int err = ssdfs_peb_read_page(pebc, req, end);
 		if (err == -EAGAIN) {
@@ -3743,6 +4176,10 @@ check_header_magic:
 		goto fail_read_log_header;
 	}
 
+	/* header has been checked, no need to check it again */
+	ssdfs_log_hdr_cache_add(fsi, pebi->peb_id, page_off,
+				kaddr, SSDFS_LOG_HDR_CACHE_ITEM_SIZE);
+
 fail_read_log_header:
 	kunmap_local(kaddr);
 	ssdfs_unlock_page(page);
@@ -3776,25 +4213,177 @@ fail_read_log_header:
 }
 
 /*
- * ssdfs_peb_read_all_log_headers() - read all PEB's log headers
+ * ssdfs_peb_prefetch_log_headers() - submit reads of expected log headers
  * @pebi: pointer on PEB object
- * @req: read request
- *
- * This function tries to read all headers and footers of
- * the PEB's logs.
- *
- * RETURN:
- * [success]
- * [failure] - error code:
- *
- * %-ERANGE     - internal error.
- * %-ENOMEM     - fail to allocate memory.
+ * @batch: batch of asynchronous read requests
+ * @pages: array of prefetched pages [out]
+ * @capacity: capacity of the array
+ *
+ * Every full log starts from the page that is multiple of
+ * the log's size. This function submits the reads of all these
+ * pages at once without waiting the end of the requests.
+ * The sequential walk through the log headers finds the pages
+ * in the PEB's cache and waits on the page lock only if the read
+ * is still in flight. The prefetched page of index (i + 1) *
+ * log_pages is stored in @pages[i] with the reference of
+ * the caller.
  */
 static
-int ssdfs_peb_read_all_log_headers(struct ssdfs_peb_info *pebi,
-				   struct ssdfs_segment_request *req)
+void ssdfs_peb_prefetch_log_headers(struct ssdfs_peb_info *pebi,
+				   struct ssdfs_io_batch *batch,
+				   struct page **pages, u32 capacity)
 {
 	struct ssdfs_fs_info *fsi;
+	struct pagevec pvec;
+	struct page *page;
+	loff_t offset;
+	u32 page_off;
+	u32 i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebi || !pebi->pebc || !pebi->pebc->parent_si);
+	BUG_ON(!batch || !pages);
+
+	SSDFS_DBG("seg %llu, peb %llu, log_pages %u, capacity %u\n",
+		  pebi->pebc->parent_si->seg_id,
+		  pebi->peb_id, pebi->log_pages, capacity);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	fsi = pebi->pebc->parent_si->fsi;
+
+	for (i = 0; i < capacity; i++) {
+		page_off = (i + 1) * pebi->log_pages;
+
+		page = ssdfs_page_array_grab_page(&pebi->cache, page_off);
+		if (unlikely(IS_ERR_OR_NULL(page))) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("fail to grab page: index %u\n",
+				  page_off);
+#endif /* CONFIG_SSDFS_DEBUG */
+			break;
+		}
+
+		if (PageUptodate(page) || PageDirty(page)) {
+			ssdfs_unlock_page(page);
+			ssdfs_put_page(page);
+			continue;
+		}
+
+		pagevec_init(&pvec);
+		pagevec_add(&pvec, page);
+
+		offset = (loff_t)pebi->peb_id * fsi->erasesize;
+		offset += (loff_t)page_off * PAGE_SIZE;
+
+		err = fsi->devops->readpages_async(fsi->sb, &pvec,
+						   offset, batch);
+		if (unlikely(err)) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("fail to submit read: "
+				  "page_off %u, err %d\n",
+				  page_off, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+			ssdfs_put_page(page);
+			break;
+		}
+
+		pages[i] = page;
+	}
+}
+
+/*
+ * ssdfs_peb_forget_prefetched_log_headers() - finish log headers prefetch
+ * @pebi: pointer on PEB object
+ * @batch: batch of asynchronous read requests
+ * @pages: array of prefetched pages
+ * @capacity: capacity of the array
+ * @end_page: page where the walk through log headers has stopped
+ *
+ * This function waits the end of prefetch requests and drops
+ * the references of prefetched pages. The pages beyond @end_page
+ * and the pages that were not read successfully are deleted
+ * from the PEB's cache because they don't contain the committed state.
+ */
+static
+void ssdfs_peb_forget_prefetched_log_headers(struct ssdfs_peb_info *pebi,
+					     struct ssdfs_io_batch *batch,
+					     struct page **pages,
+					     u32 capacity, u32 end_page)
+{
+	struct ssdfs_fs_info *fsi;
+	struct page *page;
+	u32 page_off;
+	u32 i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebi || !pebi->pebc || !pebi->pebc->parent_si);
+	BUG_ON(!batch || !pages);
+
+	SSDFS_DBG("seg %llu, peb %llu, capacity %u, end_page %u\n",
+		  pebi->pebc->parent_si->seg_id,
+		  pebi->peb_id, capacity, end_page);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	fsi = pebi->pebc->parent_si->fsi;
+
+	err = fsi->devops->wait_reads(fsi->sb, batch);
+	if (unlikely(err)) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("some prefetch requests failed: err %d\n",
+			  err);
+#endif /* CONFIG_SSDFS_DEBUG */
+	}
+
+	for (i = 0; i < capacity; i++) {
+		page = pages[i];
+
+		if (!page)
+			continue;
+
+		page_off = (i + 1) * pebi->log_pages;
+
+		if (page_off > end_page || !PageUptodate(page)) {
+			struct page *deleted;
+
+			deleted = ssdfs_page_array_delete_page(&pebi->cache,
+								page_off);
+			if (IS_ERR_OR_NULL(deleted)) {
+				SSDFS_WARN("fail to delete page: "
+					   "page_off %u\n",
+					   page_off);
+			}
+		}
+
+		ssdfs_put_page(page);
+		pages[i] = NULL;
+	}
+}
+
+/*
+ * ssdfs_peb_read_all_log_headers() - read all PEB's log headers
+ * @pebi: pointer on PEB object
+ * @req: read request
+ *
+ * This function tries to read all headers and footers of
+ * the PEB's logs.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - internal error.
+ * %-ENOMEM     - fail to allocate memory.
+ */
+static
+int ssdfs_peb_read_all_log_headers(struct ssdfs_peb_info *pebi,
+				   struct ssdfs_segment_request *req)
+{
+	struct ssdfs_fs_info *fsi;
+	struct ssdfs_io_batch batch;
+	struct page **pages = NULL;
+	u32 capacity = 0;
 	u32 log_bytes = U32_MAX;
 	u32 page_off;
 	int err = 0;
@@ -3816,14 +4405,17 @@ int ssdfs_peb_read_all_log_headers(struct ssdfs_peb_info *pebi,
 	fsi = pebi->pebc->parent_si->fsi;
 	page_off = 0;
 
+	ssdfs_io_batch_init(&batch);
+
 	do {
 		u32 pages_per_log;
 
 		err = __ssdfs_peb_read_log_header(fsi, pebi, page_off,
 						  &log_bytes);
-		if (err == -ENODATA)
-			return 0;
-		else if (unlikely(err)) {
+		if (err == -ENODATA) {
+			err = 0;
+			goto finish_read_log_headers;
+		} else if (unlikely(err)) {
 			SSDFS_ERR("fail to read log header: "
 				  "seg %llu, peb %llu, page_off %u, "
 				  "err %d\n",
@@ -3831,19 +4423,57 @@ int ssdfs_peb_read_all_log_headers(struct ssdfs_peb_info *pebi,
 				  pebi->peb_id,
 				  page_off,
 				  err);
-			return err;
+			goto finish_read_log_headers;
 		}
 
 #ifdef CONFIG_SSDFS_DEBUG
 		BUG_ON(log_bytes >= U32_MAX);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+		if (page_off == 0) {
+			/*
+			 * The first log exists. Submit the reads of
+			 * the rest logs' headers at once because
+			 * every read of the walk is synchronous.
+			 */
+			if (fsi->devops->readpages_async &&
+			    fsi->devops->wait_reads &&
+			    fsi->pagesize == PAGE_SIZE &&
+			    pebi->log_pages > 0 &&
+			    pebi->log_pages < fsi->pages_per_peb) {
+				capacity = fsi->pages_per_peb / pebi->log_pages;
+				capacity--;
+			}
+
+			if (capacity > 0) {
+				pages = ssdfs_read_kcalloc(capacity,
+							sizeof(struct page *),
+							GFP_KERNEL);
+				if (!pages)
+					capacity = 0;
+			}
+
+			if (capacity > 0) {
+				ssdfs_peb_prefetch_log_headers(pebi, &batch,
+								pages,
+								capacity);
+			}
+		}
+
 		pages_per_log = log_bytes + fsi->pagesize - 1;
 		pages_per_log /= fsi->pagesize;
 		page_off += pages_per_log;
 	} while (page_off < fsi->pages_per_peb);
 
-	return 0;
+finish_read_log_headers:
+	if (pages) {
+		ssdfs_peb_forget_prefetched_log_headers(pebi, &batch,
+							pages, capacity,
+							page_off);
+		ssdfs_read_kfree(pages);
+	}
+
+	return err;
 }
 
 /*
@@ -3873,7 +4503,7 @@ int ssdfs_peb_read_src_all_log_headers(struct ssdfs_peb_container *pebc,
 	BUG_ON(!req);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	pebi = pebc->src_peb;
 	if (!pebi) {
@@ -3941,7 +4571,7 @@ int ssdfs_peb_read_dst_all_log_headers(struct ssdfs_peb_container *pebc,
 	BUG_ON(!req);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	pebi = pebc->dst_peb;
 	if (!pebi) {
@@ -4016,6 +4646,11 @@ int ssdfs_peb_get_log_pages_count(struct ssdfs_fs_info *fsi,
 	SSDFS_DBG("peb %llu, env %p\n", pebi->peb_id, env);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	err = ssdfs_log_hdr_cache_find(fsi, pebi->peb_id, pages_off,
+					env->log_hdr, hdr_buf_size);
+	if (!err)
+		goto define_log_pages;
+
 	page = ssdfs_page_array_get_page_locked(&pebi->cache, 0);
 	if (IS_ERR_OR_NULL(page)) {
 		err = ssdfs_read_checked_segment_header(fsi,
@@ -4043,6 +4678,7 @@ int ssdfs_peb_get_log_pages_count(struct ssdfs_fs_info *fsi,
 #endif /* CONFIG_SSDFS_DEBUG */
 	}
 
+define_log_pages:
 	magic = (struct ssdfs_signature *)env->log_hdr;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -4211,6 +4847,9 @@ int ssdfs_find_last_partial_log(struct ssdfs_fs_info *fsi,
 				return -EIO;
 			}
 
+			ssdfs_log_hdr_cache_add(fsi, pebi->peb_id, i,
+						env->log_hdr, hdr_buf_size);
+
 			if (*new_log_start_page >= U16_MAX) {
 				SSDFS_ERR("invalid new_log_start_page\n");
 				return -EIO;
@@ -4280,6 +4919,9 @@ int ssdfs_find_last_partial_log(struct ssdfs_fs_info *fsi,
 				return -EIO;
 			}
 
+			ssdfs_log_hdr_cache_add(fsi, pebi->peb_id, i,
+						env->log_hdr, hdr_buf_size);
+
 			flags = le32_to_cpu(pl_hdr->pl_flags);
 
 			if (flags & SSDFS_PARTIAL_HEADER_INSTEAD_FOOTER) {
@@ -4466,8 +5108,11 @@ finish_last_log_search:
  * ssdfs_check_log_header() - check log's header
  * @fsi: file system info object
  * @env: init environment [in|out]
+ * @is_checked: header has been checked already
  *
- * This function checks the log's header.
+ * This function checks the log's header. The consistency check
+ * (including checksum) is skipped if the header has been checked
+ * already (for example, it was taken from the log header cache).
  *
  * RETURN:
  * [success]
@@ -4478,7 +5123,8 @@ finish_last_log_search:
  */
 static inline
 int ssdfs_check_log_header(struct ssdfs_fs_info *fsi,
-			   struct ssdfs_read_init_env *env)
+			   struct ssdfs_read_init_env *env,
+			   bool is_checked)
 {
 	struct ssdfs_signature *magic = NULL;
 	struct ssdfs_segment_header *seg_hdr = NULL;
@@ -4502,11 +5148,13 @@ int ssdfs_check_log_header(struct ssdfs_fs_info *fsi,
 	if (__is_ssdfs_segment_header_magic_valid(magic)) {
 		seg_hdr = SSDFS_SEG_HDR(env->log_hdr);
 
-		err = ssdfs_check_segment_header(fsi, seg_hdr,
-						 false);
-		if (unlikely(err)) {
-			SSDFS_ERR("log header is corrupted\n");
-			return -EIO;
+		if (!is_checked) {
+			err = ssdfs_check_segment_header(fsi, seg_hdr,
+							 false);
+			if (unlikely(err)) {
+				SSDFS_ERR("log header is corrupted\n");
+				return -EIO;
+			}
 		}
 
 		env->has_seg_hdr = true;
@@ -4514,11 +5162,13 @@ int ssdfs_check_log_header(struct ssdfs_fs_info *fsi,
 	} else if (is_ssdfs_partial_log_header_magic_valid(magic)) {
 		pl_hdr = SSDFS_PLH(env->log_hdr);
 
-		err = ssdfs_check_partial_log_header(fsi, pl_hdr,
-						     false);
-		if (unlikely(err)) {
-			SSDFS_ERR("partial log header is corrupted\n");
-			return -EIO;
+		if (!is_checked) {
+			err = ssdfs_check_partial_log_header(fsi, pl_hdr,
+							     false);
+			if (unlikely(err)) {
+				SSDFS_ERR("partial log header is corrupted\n");
+				return -EIO;
+			}
 		}
 
 		env->has_seg_hdr = false;
@@ -4531,6 +5181,189 @@ int ssdfs_check_log_header(struct ssdfs_fs_info *fsi,
 	return 0;
 }
 
+/*
+ * ssdfs_peb_read_checked_log_header() - read and check log's header
+ * @pebi: pointer on PEB object
+ * @env: init environment [in|out]
+ * @pages_off: page offset of the log's header
+ *
+ * This function tries to take the log's header from the cache
+ * of checked log headers. Otherwise, it reads the header from
+ * the PEB's cache or from the volume, checks the header and
+ * stores the checked header into the log header cache.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO        - I/O error.
+ * %-ENODATA    - valid magic is not detected.
+ */
+static
+int ssdfs_peb_read_checked_log_header(struct ssdfs_peb_info *pebi,
+				      struct ssdfs_read_init_env *env,
+				      u32 pages_off)
+{
+	struct ssdfs_fs_info *fsi;
+	struct page *page;
+	size_t hdr_buf_size = sizeof(struct ssdfs_segment_header);
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebi || !pebi->pebc || !pebi->pebc->parent_si);
+	BUG_ON(!env || !env->log_hdr);
+
+	SSDFS_DBG("seg %llu, peb %llu, pages_off %u\n",
+		  pebi->pebc->parent_si->seg_id,
+		  pebi->peb_id, pages_off);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	fsi = pebi->pebc->parent_si->fsi;
+
+	err = ssdfs_log_hdr_cache_find(fsi, pebi->peb_id, pages_off,
+					env->log_hdr, hdr_buf_size);
+	if (!err)
+		return ssdfs_check_log_header(fsi, env, true);
+
+	page = ssdfs_page_array_get_page_locked(&pebi->cache, pages_off);
+	if (IS_ERR_OR_NULL(page)) {
+		err = ssdfs_read_checked_segment_header(fsi,
+							pebi->peb_id,
+							pages_off,
+							env->log_hdr,
+							false);
+		if (err) {
+			SSDFS_ERR("fail to read checked segment header: "
+				  "peb %llu, err %d\n",
+				  pebi->peb_id, err);
+			return err;
+		}
+	} else {
+		ssdfs_memcpy_from_page(env->log_hdr, 0, hdr_buf_size,
+					page, 0, PAGE_SIZE,
+					hdr_buf_size);
+
+		ssdfs_unlock_page(page);
+		ssdfs_put_page(page);
+
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("page %p, count %d\n",
+			  page, page_ref_count(page));
+#endif /* CONFIG_SSDFS_DEBUG */
+	}
+
+	err = ssdfs_check_log_header(fsi, env, false);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to check log header: "
+			  "err %d\n", err);
+		return err;
+	}
+
+	err = ssdfs_log_hdr_cache_add(fsi, pebi->peb_id, pages_off,
+				      env->log_hdr, hdr_buf_size);
+	if (unlikely(err)) {
+		/* cache is only an optimization */
+		SSDFS_DBG("unable to cache log header: "
+			  "peb %llu, pages_off %u, err %d\n",
+			  pebi->peb_id, pages_off, err);
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_peb_read_checked_log_footer() - read and check log's footer
+ * @pebi: pointer on PEB object
+ * @env: init environment [in|out]
+ * @bytes_off: offset of the log's footer in bytes
+ *
+ * This function tries to take the log's footer from the cache
+ * of checked log headers/footers. Otherwise, it reads the footer
+ * from the PEB's cache or from the volume, checks the footer and
+ * stores the checked footer into the log header cache.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO        - I/O error.
+ */
+static
+int ssdfs_peb_read_checked_log_footer(struct ssdfs_peb_info *pebi,
+				      struct ssdfs_read_init_env *env,
+				      u32 bytes_off)
+{
+	struct ssdfs_fs_info *fsi;
+	size_t footer_size = sizeof(struct ssdfs_log_footer);
+	u32 pages_off;
+	struct page *page;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebi || !pebi->pebc || !pebi->pebc->parent_si);
+	BUG_ON(!env || !env->log_hdr || !env->footer);
+
+	SSDFS_DBG("seg %llu, peb %llu, bytes_off %u\n",
+		  pebi->pebc->parent_si->seg_id,
+		  pebi->peb_id, bytes_off);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	fsi = pebi->pebc->parent_si->fsi;
+	pages_off = bytes_off / fsi->pagesize;
+
+	err = ssdfs_log_hdr_cache_find(fsi, pebi->peb_id, pages_off,
+					env->footer, footer_size);
+	if (!err)
+		return 0;
+
+	page = ssdfs_page_array_get_page_locked(&pebi->cache, pages_off);
+	if (IS_ERR_OR_NULL(page)) {
+		err = ssdfs_read_checked_log_footer(fsi,
+						    env->log_hdr,
+						    pebi->peb_id,
+						    bytes_off,
+						    env->footer,
+						    false);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to read checked log footer: "
+				  "seg %llu, peb %llu, bytes_off %u\n",
+				  pebi->pebc->parent_si->seg_id,
+				  pebi->peb_id, bytes_off);
+			return err;
+		}
+	} else {
+		ssdfs_memcpy_from_page(env->footer, 0, footer_size,
+					page, 0, PAGE_SIZE,
+					footer_size);
+
+		ssdfs_unlock_page(page);
+		ssdfs_put_page(page);
+
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("page %p, count %d\n",
+			  page, page_ref_count(page));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		err = ssdfs_check_log_footer(fsi, env->log_hdr,
+					     env->footer, true);
+		if (unlikely(err)) {
+			/* keep the footer but don't cache it */
+			return 0;
+		}
+	}
+
+	err = ssdfs_log_hdr_cache_add(fsi, pebi->peb_id, pages_off,
+				      env->footer, footer_size);
+	if (unlikely(err)) {
+		/* cache is only an optimization */
+		SSDFS_DBG("unable to cache log footer: "
+			  "peb %llu, pages_off %u, err %d\n",
+			  pebi->peb_id, pages_off, err);
+	}
+
+	return 0;
+}
+
 /*
  * ssdfs_get_segment_header_blk_bmap_desc() - get block bitmap's descriptor
  * @pebi: pointer on PEB object
@@ -4553,10 +5386,7 @@ int ssdfs_get_segment_header_blk_bmap_desc(struct ssdfs_peb_info *pebi,
 {
 	struct ssdfs_fs_info *fsi;
 	struct ssdfs_segment_header *seg_hdr = NULL;
-	size_t footer_size = sizeof(struct ssdfs_log_footer);
-	u32 pages_off;
 	u32 bytes_off;
-	struct page *page;
 	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -4584,36 +5414,15 @@ int ssdfs_get_segment_header_blk_bmap_desc(struct ssdfs_peb_info *pebi,
 		*desc = &seg_hdr->desc_array[SSDFS_LOG_FOOTER_INDEX];
 
 		bytes_off = le32_to_cpu((*desc)->offset);
-		pages_off = bytes_off / fsi->pagesize;
-
-		page = ssdfs_page_array_get_page_locked(&pebi->cache,
-							pages_off);
-		if (IS_ERR_OR_NULL(page)) {
-			err = ssdfs_read_checked_log_footer(fsi,
-							    env->log_hdr,
-							    pebi->peb_id,
-							    bytes_off,
-							    env->footer,
-							    false);
-			if (unlikely(err)) {
-				SSDFS_ERR("fail to read checked log footer: "
-					  "seg %llu, peb %llu, bytes_off %u\n",
-					  pebi->pebc->parent_si->seg_id,
-					  pebi->peb_id, bytes_off);
-				return err;
-			}
-		} else {
-			ssdfs_memcpy_from_page(env->footer, 0, footer_size,
-						page, 0, PAGE_SIZE,
-						footer_size);
 
-			ssdfs_unlock_page(page);
-			ssdfs_put_page(page);
-
-#ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("page %p, count %d\n",
-				  page, page_ref_count(page));
-#endif /* CONFIG_SSDFS_DEBUG */
+		err = ssdfs_peb_read_checked_log_footer(pebi, env, bytes_off);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to read checked log footer: "
+				  "seg %llu, peb %llu, bytes_off %u
+",
+				  pebi->pebc->parent_si->seg_id,
+				  pebi->peb_id, bytes_off);
+			return err;
 		}
 
 		if (!ssdfs_log_footer_has_blk_bmap(env->footer)) {
@@ -4652,10 +5461,7 @@ int ssdfs_get_partial_header_blk_bmap_desc(struct ssdfs_peb_info *pebi,
 {
 	struct ssdfs_fs_info *fsi;
 	struct ssdfs_partial_log_header *pl_hdr = NULL;
-	size_t footer_size = sizeof(struct ssdfs_log_footer);
-	u32 pages_off;
 	u32 bytes_off;
-	struct page *page;
 	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -4683,36 +5489,15 @@ int ssdfs_get_partial_header_blk_bmap_desc(struct ssdfs_peb_info *pebi,
 		*desc = &pl_hdr->desc_array[SSDFS_LOG_FOOTER_INDEX];
 
 		bytes_off = le32_to_cpu((*desc)->offset);
-		pages_off = bytes_off / fsi->pagesize;
-
-		page = ssdfs_page_array_get_page_locked(&pebi->cache,
-							pages_off);
-		if (IS_ERR_OR_NULL(page)) {
-			err = ssdfs_read_checked_log_footer(fsi,
-							    env->log_hdr,
-							    pebi->peb_id,
-							    bytes_off,
-							    env->footer,
-							    false);
-			if (unlikely(err)) {
-				SSDFS_ERR("fail to read checked log footer: "
-					  "seg %llu, peb %llu, bytes_off %u\n",
-					  pebi->pebc->parent_si->seg_id,
-					  pebi->peb_id, bytes_off);
-				return err;
-			}
-		} else {
-			ssdfs_memcpy_from_page(env->footer, 0, footer_size,
-						page, 0, PAGE_SIZE,
-						footer_size);
-
-			ssdfs_unlock_page(page);
-			ssdfs_put_page(page);
 
-#ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("page %p, count %d\n",
-				  page, page_ref_count(page));
-#endif /* CONFIG_SSDFS_DEBUG */
+		err = ssdfs_peb_read_checked_log_footer(pebi, env, bytes_off);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to read checked log footer: "
+				  "seg %llu, peb %llu, bytes_off %u
+",
+				  pebi->pebc->parent_si->seg_id,
+				  pebi->peb_id, bytes_off);
+			return err;
 		}
 
 		if (!ssdfs_log_footer_has_blk_bmap(env->footer)) {
@@ -4756,7 +5541,6 @@ int ssdfs_pre_fetch_block_bitmap(struct ssdfs_peb_info *pebi,
 	void *kaddr;
 	u32 pages_off;
 	u32 bytes_off;
-	size_t hdr_buf_size = sizeof(struct ssdfs_segment_header);
 	u32 area_offset, area_size;
 	u32 cur_page, page_start, page_end;
 	size_t read_bytes;
@@ -4776,37 +5560,12 @@ int ssdfs_pre_fetch_block_bitmap(struct ssdfs_peb_info *pebi,
 	pages_off = env->log_offset;
 	pebsize = fsi->pages_per_peb * fsi->pagesize;
 
-	page = ssdfs_page_array_get_page_locked(&pebi->cache, pages_off);
-	if (IS_ERR_OR_NULL(page)) {
-		err = ssdfs_read_checked_segment_header(fsi,
-							pebi->peb_id,
-							pages_off,
-							env->log_hdr,
-							false);
-		if (err) {
-			SSDFS_ERR("fail to read checked segment header: "
-				  "peb %llu, err %d\n",
-				  pebi->peb_id, err);
-			return err;
-		}
-	} else {
-		ssdfs_memcpy_from_page(env->log_hdr, 0, hdr_buf_size,
-					page, 0, PAGE_SIZE,
-					hdr_buf_size);
-
-		ssdfs_unlock_page(page);
-		ssdfs_put_page(page);
-
-#ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("page %p, count %d\n",
-			  page, page_ref_count(page));
-#endif /* CONFIG_SSDFS_DEBUG */
-	}
-
-	err = ssdfs_check_log_header(fsi, env);
+	err = ssdfs_peb_read_checked_log_header(pebi, env, pages_off);
 	if (unlikely(err)) {
-		SSDFS_ERR("fail to check log header: "
-			  "err %d\n", err);
+		SSDFS_ERR("fail to read checked log header: "
+			  "peb %llu, pages_off %u, err %d
+",
+			  pebi->peb_id, pages_off, err);
 		return err;
 	}
 
@@ -6102,9 +6861,7 @@ int ssdfs_pre_fetch_blk2off_table_area(struct ssdfs_peb_info *pebi,
 {
 	struct ssdfs_fs_info *fsi;
 	struct ssdfs_metadata_descriptor *desc = NULL;
-	struct page *page;
 	u32 pages_off;
-	size_t hdr_buf_size = sizeof(struct ssdfs_segment_header);
 	u16 flags;
 	bool is_compressed = false;
 	int err = 0;
@@ -6120,37 +6877,12 @@ int ssdfs_pre_fetch_blk2off_table_area(struct ssdfs_peb_info *pebi,
 	fsi = pebi->pebc->parent_si->fsi;
 	pages_off = env->log_offset;
 
-	page = ssdfs_page_array_get_page_locked(&pebi->cache, pages_off);
-	if (IS_ERR_OR_NULL(page)) {
-		err = ssdfs_read_checked_segment_header(fsi,
-							pebi->peb_id,
-							pages_off,
-							env->log_hdr,
-							false);
-		if (err) {
-			SSDFS_ERR("fail to read checked segment header: "
-				  "peb %llu, err %d\n",
-				  pebi->peb_id, err);
-			return err;
-		}
-	} else {
-		ssdfs_memcpy_from_page(env->log_hdr, 0, hdr_buf_size,
-					page, 0, PAGE_SIZE,
-					hdr_buf_size);
-
-		ssdfs_unlock_page(page);
-		ssdfs_put_page(page);
-
-#ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("page %p, count %d\n",
-			  page, page_ref_count(page));
-#endif /* CONFIG_SSDFS_DEBUG */
-	}
-
-	err = ssdfs_check_log_header(fsi, env);
+	err = ssdfs_peb_read_checked_log_header(pebi, env, pages_off);
 	if (unlikely(err)) {
-		SSDFS_ERR("fail to check log header: "
-			  "err %d\n", err);
+		SSDFS_ERR("fail to read checked log header: "
+			  "peb %llu, pages_off %u, err %d
+",
+			  pebi->peb_id, pages_off, err);
 		return err;
 	}
 
@@ -6491,64 +7223,37 @@ int ssdfs_read_blk_desc_compressed_byte_stream(struct ssdfs_peb_info *pebi,
  * %-ERANGE     - internal error.
  * %-EIO        - I/O error.
  * %-ENOMEM     - fail to allocate memory.
- * %-ENOENT     - blk desc table is absent.
- */
-static
-int ssdfs_pre_fetch_blk_desc_table_area(struct ssdfs_peb_info *pebi,
-					struct ssdfs_read_init_env *env)
-{
-	struct ssdfs_fs_info *fsi;
-	struct ssdfs_metadata_descriptor *desc = NULL;
-	struct page *page;
-	u32 pages_off;
-	size_t hdr_buf_size = sizeof(struct ssdfs_segment_header);
-	u16 flags;
-	int err = 0;
-
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!pebi || !pebi->pebc || !env);
-
-	SSDFS_DBG("seg %llu, peb %llu, peb_index %u\n",
-		  pebi->pebc->parent_si->seg_id,
-		  pebi->peb_id, pebi->peb_index);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	fsi = pebi->pebc->parent_si->fsi;
-	pages_off = env->log_offset;
-	env->bdt_init.read_off = 0;
-	env->bdt_init.write_off = 0;
-
-	page = ssdfs_page_array_get_page_locked(&pebi->cache, pages_off);
-	if (IS_ERR_OR_NULL(page)) {
-		err = ssdfs_read_checked_segment_header(fsi,
-							pebi->peb_id,
-							pages_off,
-							env->log_hdr,
-							false);
-		if (err) {
-			SSDFS_ERR("fail to read checked segment header: "
-				  "peb %llu, err %d\n",
-				  pebi->peb_id, err);
-			return err;
-		}
-	} else {
-		ssdfs_memcpy_from_page(env->log_hdr, 0, hdr_buf_size,
-					page, 0, PAGE_SIZE,
-					hdr_buf_size);
-
-		ssdfs_unlock_page(page);
-		ssdfs_put_page(page);
+ * %-ENOENT     - blk desc table is absent.
+ */
+static
+int ssdfs_pre_fetch_blk_desc_table_area(struct ssdfs_peb_info *pebi,
+					struct ssdfs_read_init_env *env)
+{
+	struct ssdfs_fs_info *fsi;
+	struct ssdfs_metadata_descriptor *desc = NULL;
+	u32 pages_off;
+	u16 flags;
+	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("page %p, count %d\n",
-			  page, page_ref_count(page));
+	BUG_ON(!pebi || !pebi->pebc || !env);
+
+	SSDFS_DBG("seg %llu, peb %llu, peb_index %u\n",
+		  pebi->pebc->parent_si->seg_id,
+		  pebi->peb_id, pebi->peb_index);
 #endif /* CONFIG_SSDFS_DEBUG */
-	}
 
-	err = ssdfs_check_log_header(fsi, env);
+	fsi = pebi->pebc->parent_si->fsi;
+	pages_off = env->log_offset;
+	env->bdt_init.read_off = 0;
+	env->bdt_init.write_off = 0;
+
+	err = ssdfs_peb_read_checked_log_header(pebi, env, pages_off);
 	if (unlikely(err)) {
-		SSDFS_ERR("fail to check log header: "
-			  "err %d\n", err);
+		SSDFS_ERR("fail to read checked log header: "
+			  "peb %llu, pages_off %u, err %d
+",
+			  pebi->peb_id, pages_off, err);
 		return err;
 	}
 
@@ -6642,14 +7347,10 @@ int ssdfs_read_checked_block_bitmap_header(struct ssdfs_peb_info *pebi,
 					   struct ssdfs_read_init_env *env)
 {
 	struct ssdfs_fs_info *fsi;
-	struct page *page;
 	u32 pages_off;
 	u32 area_offset;
 	struct ssdfs_metadata_descriptor *desc = NULL;
 	size_t bmap_hdr_size = sizeof(struct ssdfs_block_bitmap_header);
-	size_t hdr_buf_size = max_t(size_t,
-				sizeof(struct ssdfs_segment_header),
-				sizeof(struct ssdfs_partial_log_header));
 	u32 pebsize;
 	u32 read_bytes = 0;
 	int err;
@@ -6673,29 +7374,12 @@ int ssdfs_read_checked_block_bitmap_header(struct ssdfs_peb_info *pebi,
 	pages_off = env->log_offset;
 	pebsize = fsi->pages_per_peb * fsi->pagesize;
 
-	page = ssdfs_page_array_get_page_locked(&pebi->cache, pages_off);
-	if (IS_ERR_OR_NULL(page)) {
-		SSDFS_ERR("fail to read checked segment header: "
-			  "peb %llu\n", pebi->peb_id);
-		return -ERANGE;
-	} else {
-		ssdfs_memcpy_from_page(env->log_hdr, 0, hdr_buf_size,
-					page, 0, PAGE_SIZE,
-					hdr_buf_size);
-
-		ssdfs_unlock_page(page);
-		ssdfs_put_page(page);
-
-#ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("page %p, count %d\n",
-			  page, page_ref_count(page));
-#endif /* CONFIG_SSDFS_DEBUG */
-	}
-
-	err = ssdfs_check_log_header(fsi, env);
+	err = ssdfs_peb_read_checked_log_header(pebi, env, pages_off);
 	if (unlikely(err)) {
-		SSDFS_ERR("fail to check log header: "
-			  "err %d\n", err);
+		SSDFS_ERR("fail to read checked log header: "
+			  "peb %llu, pages_off %u, err %d
+",
+			  pebi->peb_id, pages_off, err);
 		return err;
 	}
 
@@ -7824,7 +8508,7 @@ int ssdfs_src_peb_init_using_metadata_state(struct ssdfs_peb_container *pebc,
 		return -ERANGE;
 	};
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	pebi = pebc->src_peb;
 	if (!pebi) {
@@ -7954,7 +8638,7 @@ int ssdfs_dst_peb_init_using_metadata_state(struct ssdfs_peb_container *pebc,
 		return -ERANGE;
 	};
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	pebi = pebc->dst_peb;
 	if (!pebi) {
@@ -8119,7 +8803,7 @@ int ssdfs_src_peb_init_used_metadata_state(struct ssdfs_peb_container *pebc,
 		return -ERANGE;
 	};
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	pebi = pebc->src_peb;
 	if (!pebi) {
@@ -8300,7 +8984,7 @@ int ssdfs_dst_peb_init_used_metadata_state(struct ssdfs_peb_container *pebc,
 		return -ERANGE;
 	};
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	pebi = pebc->dst_peb;
 	if (!pebi) {
@@ -8632,6 +9316,9 @@ int ssdfs_find_prev_partial_log(struct ssdfs_fs_info *fsi,
 				return -EIO;
 			}
 
+			ssdfs_log_hdr_cache_add(fsi, pebi->peb_id, i,
+						env->log_hdr, hdr_buf_size);
+
 			if (start_offset == i) {
 				/*
 				 * Requested starting log_offset points out
@@ -8671,6 +9358,9 @@ int ssdfs_find_prev_partial_log(struct ssdfs_fs_info *fsi,
 				return -EIO;
 			}
 
+			ssdfs_log_hdr_cache_add(fsi, pebi->peb_id, i,
+						env->log_hdr, hdr_buf_size);
+
 			env->has_seg_hdr = false;
 			env->has_footer = ssdfs_pl_has_footer(pl_hdr);
 
@@ -9167,7 +9857,7 @@ int ssdfs_src_peb_complete_init_blk2off_table(struct ssdfs_peb_container *pebc,
 		  pebc->parent_si->seg_id, pebc->peb_index);
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	pebi = pebc->src_peb;
 	if (!pebi) {
@@ -9234,7 +9924,7 @@ int ssdfs_dst_peb_complete_init_blk2off_table(struct ssdfs_peb_container *pebc,
 		  pebc->parent_si->seg_id, pebc->peb_index);
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	items_state = atomic_read(&pebc->items_state);
 	switch (items_state) {
@@ -10279,8 +10969,8 @@ int ssdfs_peb_init_maptbl_object(struct ssdfs_peb_container *pebc,
 {
 	struct ssdfs_fs_info *fsi;
 	struct ssdfs_maptbl_area area = {0};
-	u64 logical_offset;
-	u32 logical_blk;
+	u64 start_offset, logical_offset;
+	u32 start_blk, logical_blk;
 	u32 fragment_bytes;
 	u32 blks_per_fragment;
 	int i;
@@ -10329,8 +11019,8 @@ int ssdfs_peb_init_maptbl_object(struct ssdfs_peb_container *pebc,
 		goto end_init;
 	}
 
-	logical_offset = req->extent.logical_offset;
-	logical_blk = req->place.start.blk_index;
+	start_offset = req->extent.logical_offset;
+	start_blk = req->place.start.blk_index;
 
 	blks_per_fragment =
 		(fragment_bytes + fsi->pagesize - 1) / fsi->pagesize;
@@ -10339,9 +11029,18 @@ int ssdfs_peb_init_maptbl_object(struct ssdfs_peb_container *pebc,
 	BUG_ON(blks_per_fragment >= U16_MAX);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	/*
+	 * Every fragment is initialized and the waiters of the fragment
+	 * are woken up as soon as the fragment has been read. As a result,
+	 * the accessors wait only the fragment they need while the rest
+	 * fragments of the PEB are loaded in the background. The position
+	 * of every fragment is calculated from the beginning of the PEB's
+	 * area because an accumulated error would cause the reading of
+	 * the wrong blocks for all fragments after the second one.
+	 */
 	for (i = 0; i < fsi->maptbl->fragments_per_peb; i++) {
-		logical_offset = logical_offset + ((u64)fragment_bytes * i);
-		logical_blk = logical_blk + (blks_per_fragment * i);
+		logical_offset = start_offset + ((u64)fragment_bytes * i);
+		logical_blk = start_blk + (blks_per_fragment * i);
 
 #ifdef CONFIG_SSDFS_DEBUG
 		BUG_ON(logical_blk >= U16_MAX);
@@ -10703,7 +11402,7 @@ int ssdfs_peb_read_src_last_log_footer(struct ssdfs_peb_container *pebc,
 
 	fsi = pebc->parent_si->fsi;
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	pebi = pebc->src_peb;
 	if (!pebi) {
@@ -10776,7 +11475,7 @@ int ssdfs_peb_read_dst_last_log_footer(struct ssdfs_peb_container *pebc,
 
 	fsi = pebc->parent_si->fsi;
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 
 	pebi = pebc->dst_peb;
 	if (!pebi) {
@@ -11105,6 +11804,9 @@ void ssdfs_finish_read_request(struct ssdfs_peb_container *pebc,
 		  req->private.type, err);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	trace_ssdfs_request_complete(pebc, req, err);
+	ssdfs_peb_account_request_service(pebc->io_stats.read_latency, req);
+
 	if (!err) {
 		for (i = 0; i < req->result.processed_blks; i++)
 			ssdfs_peb_mark_request_block_uptodate(pebc, req, i);
@@ -11212,6 +11914,108 @@ void ssdfs_finish_read_request(struct ssdfs_peb_container *pebc,
 	ssdfs_peb_finish_read_request_cno(pebc);
 }
 
+/*
+ * ssdfs_peb_read_page_by_current_thread() - read page in caller's context
+ * @pebc: pointer on PEB container
+ * @req: read request
+ *
+ * This function tries to process the read request in the context
+ * of the caller without delegation to the PEB's read thread.
+ * The request is processed only if the PEB is not under migration
+ * and nobody waits in the read queue (initialization requests
+ * are queued and they have to be processed first). Asynchronous
+ * request is processed only if all necessary data is in the PEB's
+ * cache because the caller doesn't expect to wait for I/O. The read
+ * request counter of the PEB should be incremented by the caller.
+ *
+ * RETURN:
+ * [success] - request has been processed and finished.
+ * [failure] - error code:
+ *
+ * %-EAGAIN     - request should be processed by read thread.
+ */
+int ssdfs_peb_read_page_by_current_thread(struct ssdfs_peb_container *pebc,
+					  struct ssdfs_segment_request *req)
+{
+	struct ssdfs_segment_info *si;
+	struct completion *end = NULL;
+	wait_queue_head_t *wait;
+	u32 processed_blks;
+	bool only_cache;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebc || !pebc->parent_si || !req);
+
+	SSDFS_DBG("req %p, class %#x, cmd %#x, type %#x\n",
+		  req, req->private.class, req->private.cmd,
+		  req->private.type);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	si = pebc->parent_si;
+
+	if (req->private.cmd != SSDFS_READ_PAGE)
+		return -EAGAIN;
+
+	if (req->private.flags & (SSDFS_REQ_READ_ONLY_CACHE |
+				  SSDFS_REQ_PREPARE_DIFF))
+		return -EAGAIN;
+
+	if (atomic_read(&pebc->migration_state) != SSDFS_PEB_NOT_MIGRATING)
+		return -EAGAIN;
+
+	if (!is_ssdfs_requests_queue_empty(&pebc->read_rq))
+		return -EAGAIN;
+
+	switch (req->private.type) {
+	case SSDFS_REQ_SYNC:
+		only_cache = false;
+		break;
+
+	case SSDFS_REQ_ASYNC:
+	case SSDFS_REQ_ASYNC_NO_FREE:
+		only_cache = true;
+		break;
+
+	default:
+		return -EAGAIN;
+	}
+
+	processed_blks = req->result.processed_blks;
+
+	if (only_cache)
+		req->private.flags |= SSDFS_REQ_READ_ONLY_CACHE;
+
+	atomic_set(&req->result.state, SSDFS_REQ_STARTED);
+
+	err = ssdfs_peb_read_page(pebc, req, &end);
+
+	if (only_cache)
+		req->private.flags &= ~SSDFS_REQ_READ_ONLY_CACHE;
+
+	if (err == -EAGAIN || (only_cache && err == -ENOENT)) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("delegate request to read thread: "
+			  "seg %llu, peb_index %u, err %d\n",
+			  si->seg_id, pebc->peb_index, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+		req->result.processed_blks = processed_blks;
+		atomic_set(&req->result.state, SSDFS_REQ_CREATED);
+		return -EAGAIN;
+	} else if (unlikely(err)) {
+		ssdfs_fs_error(si->fsi->sb,
+				__FILE__, __func__, __LINE__,
+				"fail to read page: "
+				"seg %llu, peb_index %u, err %d\n",
+				si->seg_id, pebc->peb_index, err);
+	}
+
+	wait = &si->wait_queue[SSDFS_PEB_READ_THREAD];
+	ssdfs_finish_read_request(pebc, req, wait, err);
+
+	return 0;
+}
+
 #define READ_THREAD_WAKE_CONDITION(pebc) \
 	(kthread_should_stop() || \
 	 !is_ssdfs_requests_queue_empty(READ_RQ_PTR(pebc)))
@@ -11236,6 +12040,7 @@ int ssdfs_peb_read_thread_func(void *data)
 	struct ssdfs_peb_container *pebc = data;
 	wait_queue_head_t *wait_queue;
 	struct ssdfs_segment_request *req;
+	LIST_HEAD(batch);
 	u64 timeout = READ_THREAD_WAKEUP_TIMEOUT;
 	int err = 0;
 
@@ -11261,32 +12066,38 @@ repeat:
 		goto sleep_read_thread;
 
 	do {
-		err = ssdfs_requests_queue_remove_first(&pebc->read_rq,
-							&req);
+		err = ssdfs_requests_queue_remove_batch(&pebc->read_rq,
+							&batch);
 		if (err == -ENODATA) {
 			/* empty queue */
 			err = 0;
 			break;
-		} else if (err == -ENOENT) {
-			SSDFS_WARN("request queue contains NULL request\n");
-			err = 0;
-			continue;
 		} else if (unlikely(err < 0)) {
-			SSDFS_CRIT("fail to get request from the queue: "
+			SSDFS_CRIT("fail to get requests from the queue: "
 				   "err %d\n",
 				   err);
 			goto sleep_failed_read_thread;
 		}
 
-		err = ssdfs_process_read_request(pebc, req);
-		if (unlikely(err)) {
-			SSDFS_ERR("fail to process read request: "
-				  "seg %llu, peb_index %u, err %d\n",
-				  pebc->parent_si->seg_id,
-				  pebc->peb_index, err);
-		}
+		while (!list_empty(&batch)) {
+			req = list_first_entry(&batch,
+						struct ssdfs_segment_request,
+						list);
+			list_del(&req->list);
 
-		ssdfs_finish_read_request(pebc, req, wait_queue, err);
+			trace_ssdfs_request_dequeue(pebc, req, 0);
+			ssdfs_peb_start_request_service(req);
+
+			err = ssdfs_process_read_request(pebc, req);
+			if (unlikely(err)) {
+				SSDFS_ERR("fail to process read request: "
+					  "seg %llu, peb_index %u, err %d\n",
+					  pebc->parent_si->seg_id,
+					  pebc->peb_index, err);
+			}
+
+			ssdfs_finish_read_request(pebc, req, wait_queue, err);
+		}
 	} while (!is_ssdfs_requests_queue_empty(&pebc->read_rq));
 
 sleep_read_thread:
@@ -11324,3 +12135,236 @@ sleep_failed_read_thread:
 			READ_FAILED_THREAD_WAKE_CONDITION());
 	goto repeat;
 }
+
+#ifdef CONFIG_SSDFS_PEB_READ_WORKQUEUE
+static struct workqueue_struct *ssdfs_peb_read_wq;
+
+/*
+ * ssdfs_peb_read_workqueue_init() - create shared read workqueue
+ *
+ * This function creates the workqueue that is shared by
+ * all PEB containers for read requests processing.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to create workqueue.
+ */
+int ssdfs_peb_read_workqueue_init(void)
+{
+	ssdfs_peb_read_wq = alloc_workqueue("ssdfs-peb-read",
+					    WQ_MEM_RECLAIM, 0);
+	if (!ssdfs_peb_read_wq) {
+		SSDFS_ERR("fail to create read workqueue\n");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_peb_read_workqueue_exit() - destroy shared read workqueue
+ */
+void ssdfs_peb_read_workqueue_exit(void)
+{
+	if (ssdfs_peb_read_wq) {
+		destroy_workqueue(ssdfs_peb_read_wq);
+		ssdfs_peb_read_wq = NULL;
+	}
+}
+
+/*
+ * ssdfs_peb_read_work_func() - process read requests of PEB container
+ * @work: work item of PEB container
+ *
+ * This function processes all read requests of PEB container's
+ * queue. The work item is never executed concurrently with itself.
+ * As a result, the requests of the same PEB container are processed
+ * in the order of the queue. Finally, the work item is rescheduled
+ * with timeout for the PEB cache's memory release.
+ */
+static
+void ssdfs_peb_read_work_func(struct work_struct *work)
+{
+	struct delayed_work *dwork = to_delayed_work(work);
+	struct ssdfs_peb_container *pebc;
+	wait_queue_head_t *wait_queue;
+	struct ssdfs_segment_request *req;
+	LIST_HEAD(batch);
+	int err = 0;
+
+	pebc = container_of(dwork, struct ssdfs_peb_container, read_work);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("read work: seg %llu, peb_index %u\n",
+		  pebc->parent_si->seg_id, pebc->peb_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	wait_queue = &pebc->parent_si->wait_queue[SSDFS_PEB_READ_THREAD];
+
+	while (!is_ssdfs_requests_queue_empty(&pebc->read_rq)) {
+		err = ssdfs_requests_queue_remove_batch(&pebc->read_rq,
+							&batch);
+		if (err == -ENODATA) {
+			/* empty queue */
+			err = 0;
+			break;
+		} else if (unlikely(err < 0)) {
+			SSDFS_CRIT("fail to get requests from the queue: "
+				   "err %d\n",
+				   err);
+			ssdfs_peb_release_pages(pebc);
+			return;
+		}
+
+		while (!list_empty(&batch)) {
+			req = list_first_entry(&batch,
+						struct ssdfs_segment_request,
+						list);
+			list_del(&req->list);
+
+			trace_ssdfs_request_dequeue(pebc, req, 0);
+			ssdfs_peb_start_request_service(req);
+
+			err = ssdfs_process_read_request(pebc, req);
+			if (unlikely(err)) {
+				SSDFS_ERR("fail to process read request: "
+					  "seg %llu, peb_index %u, err %d\n",
+					  pebc->parent_si->seg_id,
+					  pebc->peb_index, err);
+			}
+
+			ssdfs_finish_read_request(pebc, req, wait_queue, err);
+		}
+	}
+
+	if (is_it_time_free_peb_cache_memory(pebc)) {
+		err = ssdfs_peb_release_pages(pebc);
+		if (err == -ENODATA) {
+			pebc->read_work_timeout =
+				min_t(u64, pebc->read_work_timeout * 2,
+					   (u64)SSDFS_DEFAULT_TIMEOUT);
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to release pages: "
+				  "err %d\n", err);
+		} else
+			pebc->read_work_timeout = READ_THREAD_WAKEUP_TIMEOUT;
+	}
+
+	queue_delayed_work(ssdfs_peb_read_wq, dwork,
+			   pebc->read_work_timeout);
+}
+
+/*
+ * ssdfs_peb_read_work_wake() - wake up function of read work
+ * @wait: wait queue entry of PEB container
+ * @mode: wake up mode
+ * @sync: synchronous wake up
+ * @key: wake up key
+ *
+ * This function is called instead of waking up the read thread.
+ * It schedules the PEB container's work item if the read
+ * requests queue is not empty.
+ */
+static
+int ssdfs_peb_read_work_wake(struct wait_queue_entry *wait,
+			     unsigned int mode, int sync, void *key)
+{
+	struct ssdfs_peb_container *pebc = wait->private;
+	struct ssdfs_requests_queue *rq = &pebc->read_rq;
+
+	/* lockless check because wait queue's lock is held */
+	if (llist_empty(&rq->incoming) && list_empty_careful(&rq->list))
+		return 0;
+
+	mod_delayed_work(ssdfs_peb_read_wq, &pebc->read_work, 0);
+	return 1;
+}
+
+/*
+ * ssdfs_peb_start_read_work() - start read work of PEB container
+ * @pebc: pointer on PEB container
+ *
+ * This function registers the PEB container's work item
+ * in the segment's read wait queue and schedules it.
+ *
+ * RETURN:
+ * [success] - read work has been started.
+ * [failure] - error code:
+ *
+ * %-ERANGE     - shared workqueue is absent.
+ */
+int ssdfs_peb_start_read_work(struct ssdfs_peb_container *pebc)
+{
+	struct ssdfs_segment_info *si;
+	struct wait_queue_entry *wait;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebc || !pebc->parent_si);
+
+	SSDFS_DBG("seg_id %llu, peb_index %u\n",
+		  pebc->parent_si->seg_id,
+		  pebc->peb_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!ssdfs_peb_read_wq) {
+		SSDFS_ERR("read workqueue is absent\n");
+		return -ERANGE;
+	}
+
+	if (pebc->read_work_started)
+		return 0;
+
+	si = pebc->parent_si;
+	wait = &pebc->thread[SSDFS_PEB_READ_THREAD].wait;
+
+	INIT_DELAYED_WORK(&pebc->read_work, ssdfs_peb_read_work_func);
+	pebc->read_work_timeout = READ_THREAD_WAKEUP_TIMEOUT;
+
+	init_waitqueue_func_entry(wait, ssdfs_peb_read_work_wake);
+	wait->private = pebc;
+	add_wait_queue(&si->wait_queue[SSDFS_PEB_READ_THREAD], wait);
+
+	pebc->read_work_started = true;
+	queue_delayed_work(ssdfs_peb_read_wq, &pebc->read_work, 0);
+
+	return 0;
+}
+
+/*
+ * ssdfs_peb_stop_read_work() - stop read work of PEB container
+ * @pebc: pointer on PEB container
+ *
+ * This function removes the PEB container's work item from
+ * the segment's read wait queue and waits the ending of
+ * the work item's execution.
+ *
+ * RETURN:
+ * [success] - read work has been stopped.
+ */
+int ssdfs_peb_stop_read_work(struct ssdfs_peb_container *pebc)
+{
+	struct ssdfs_segment_info *si;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebc || !pebc->parent_si);
+
+	SSDFS_DBG("seg_id %llu, peb_index %u\n",
+		  pebc->parent_si->seg_id,
+		  pebc->peb_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!pebc->read_work_started)
+		return 0;
+
+	si = pebc->parent_si;
+
+	remove_wait_queue(&si->wait_queue[SSDFS_PEB_READ_THREAD],
+			  &pebc->thread[SSDFS_PEB_READ_THREAD].wait);
+	cancel_delayed_work_sync(&pebc->read_work);
+	pebc->read_work_started = false;
+
+	return 0;
+}
+#endif /* CONFIG_SSDFS_PEB_READ_WORKQUEUE */
@@ -1813,10 +1813,10 @@ static int ssdfs_initialize_fs_info(struct ssdfs_fs_info *fsi)
 
 	spin_lock_init(&fsi->volume_state_lock);
 
-	fsi->free_pages = 0;
-	fsi->reserved_new_user_data_pages = 0;
-	fsi->updated_user_data_pages = 0;
-	fsi->flushing_user_data_requests = 0;
+	percpu_counter_set(&fsi->free_pages, 0);
+	percpu_counter_set(&fsi->reserved_new_user_data_pages, 0);
+	percpu_counter_set(&fsi->updated_user_data_pages, 0);
+	percpu_counter_set(&fsi->flushing_user_data_requests, 0);
 	fsi->fs_mount_time = ssdfs_current_timestamp();
 	fsi->fs_mod_time = le64_to_cpu(fsi->vs->timestamp);
 	ssdfs_init_boot_vs_mount_timediff(fsi);
@@ -1887,7 +1887,7 @@ static int ssdfs_initialize_fs_info(struct ssdfs_fs_info *fsi)
 		  fsi->sb_lebs[SSDFS_PREV_SB_SEG][SSDFS_COPY_SB_SEG],
 		  fsi->sb_pebs[SSDFS_PREV_SB_SEG][SSDFS_COPY_SB_SEG]);
 	SSDFS_DBG("nsegs %llu, free_pages %llu\n",
-		  fsi->nsegs, fsi->free_pages);
+		  fsi->nsegs, ssdfs_fs_counter_sum(&fsi->free_pages));
 	SSDFS_DBG("fs_mount_time %llu, fs_mod_time %llu, fs_mount_cno %llu\n",
 		  fsi->fs_mount_time, fsi->fs_mod_time, fsi->fs_mount_cno);
 	SSDFS_DBG("fs_flags %#x, fs_state %#x, fs_errors %#x\n",
@@ -2024,6 +2024,7 @@ static int ssdfs_read_maptbl_cache(struct ssdfs_fs_info *fsi)
 	struct page *page;
 	void *kaddr;
 	u64 prev_end_leb;
+	u16 csum_type;
 	u32 csum = ~0;
 	int i;
 	int err = 0;
@@ -2047,6 +2048,7 @@ static int ssdfs_read_maptbl_cache(struct ssdfs_fs_info *fsi)
 	meta_desc = &seg_hdr->desc_array[SSDFS_MAPTBL_CACHE_INDEX];
 	read_off = le32_to_cpu(meta_desc->offset);
 	bytes_count = le32_to_cpu(meta_desc->size);
+	csum_type = le16_to_cpu(meta_desc->check.flags);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(bytes_count >= INT_MAX);
@@ -2119,8 +2121,8 @@ static int ssdfs_read_maptbl_cache(struct ssdfs_fs_info *fsi)
 
 		prev_end_leb = le64_to_cpu(maptbl_cache_hdr->end_leb);
 
-		csum = crc32(csum, kaddr,
-			     le16_to_cpu(maptbl_cache_hdr->bytes_count));
+		csum = ssdfs_csum_update(csum_type, csum, kaddr,
+				le16_to_cpu(maptbl_cache_hdr->bytes_count));
 
 unlock_cur_page:
 		kunmap_local(kaddr);
@@ -2318,7 +2320,9 @@ static inline int ssdfs_read_snapshot_rules(struct ssdfs_fs_info *fsi)
 
 		ssdfs_lock_page(page);
 		kaddr = kmap_local_page(page);
-		csum = crc32(csum, kaddr, le16_to_cpu(meta_desc->check.bytes));
+		csum = ssdfs_csum_update(le16_to_cpu(meta_desc->check.flags),
+					 csum, kaddr,
+					 le16_to_cpu(meta_desc->check.bytes));
 		kunmap_local(kaddr);
 		ssdfs_unlock_page(page);
 	}
@@ -2355,7 +2359,7 @@ static inline int ssdfs_read_snapshot_rules(struct ssdfs_fs_info *fsi)
 			     &info, 0, rule_size,
 			     rule_size);
 
-		ssdfs_snapshot_rules_list_add_tail(rules_list, ptr);
+		ssdfs_snapshot_rules_list_add(rules_list, ptr);
 
 		read_off += rule_size;
 	}
@@ -2385,6 +2389,8 @@ static int ssdfs_init_recovery_environment(struct ssdfs_fs_info *fsi,
 
 	atomic_set(&env->state, SSDFS_RECOVERY_UNKNOWN_STATE);
 
+	memset(&env->headers, 0, sizeof(struct ssdfs_recovery_read_batch));
+
 	err = ssdfs_init_sb_info(fsi, &env->sbi);
 	if (likely(!err))
 		err = ssdfs_init_sb_info(fsi, &env->sbi_backup);
@@ -2397,6 +2403,266 @@ static int ssdfs_init_recovery_environment(struct ssdfs_fs_info *fsi,
 	return 0;
 }
 
+/*
+ * ssdfs_recovery_wait_headers() - wait the end of headers' reads
+ * @env: recovery environment
+ */
+static void ssdfs_recovery_wait_headers(struct ssdfs_recovery_env *env)
+{
+	struct ssdfs_recovery_read_batch *batch = &env->headers;
+	struct ssdfs_fs_info *fsi = env->fsi;
+	int err;
+
+	if (!batch->need_wait)
+		return;
+
+	/* failed pages are not uptodate and they are read again */
+	err = fsi->devops->wait_reads(fsi->sb, &batch->io);
+#ifdef CONFIG_SSDFS_DEBUG
+	if (unlikely(err))
+		SSDFS_DBG("some headers' reads failed: err %d\n", err);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	batch->need_wait = false;
+}
+
+/*
+ * ssdfs_recovery_readahead_headers() - submit reads of PEB headers
+ * @env: recovery environment
+ * @start_offset: offset of the first header in bytes
+ * @end_offset: upper bound of the scanned range in bytes
+ * @step: distance between the headers in bytes
+ *
+ * The search walks through the volume by means of synchronous
+ * reads of the headers with @step distance. This function submits
+ * the reads of the next SSDFS_RECOVERY_READ_BATCH_SIZE headers
+ * at once. Then, ssdfs_recovery_read_header() takes the header
+ * from the batch and it submits the next batch when the walk
+ * reaches the end of current one. Nothing is submitted if
+ * device doesn't support the asynchronous reads or the header
+ * is not page aligned. The walk falls back to synchronous reads
+ * in such case.
+ */
+void ssdfs_recovery_readahead_headers(struct ssdfs_recovery_env *env,
+				      u64 start_offset, u64 end_offset,
+				      u64 step)
+{
+	struct ssdfs_recovery_read_batch *batch;
+	struct ssdfs_fs_info *fsi;
+	struct pagevec pvec;
+	struct page *page;
+	size_t hdr_size = sizeof(struct ssdfs_segment_header);
+	u64 dev_size;
+	u64 offset;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!env || !env->fsi);
+
+	SSDFS_DBG("env %p, start_offset %llu, end_offset %llu, step %llu\n",
+		  env, start_offset, end_offset, step);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	batch = &env->headers;
+	fsi = env->fsi;
+
+	ssdfs_recovery_wait_headers(env);
+
+	batch->count = 0;
+	batch->end_offset = end_offset;
+	batch->step = 0;
+
+	if (!fsi->devops->readpages_async || !fsi->devops->wait_reads)
+		return;
+
+	if (hdr_size > PAGE_SIZE || step == 0 || step % PAGE_SIZE)
+		return;
+
+	batch->step = step;
+
+	/* unaligned header is read synchronously */
+	offset = start_offset;
+	if (offset % PAGE_SIZE)
+		offset = div64_u64(offset, step) * step + step;
+
+	dev_size = fsi->devops->device_size(fsi->sb);
+
+	ssdfs_io_batch_init(&batch->io);
+
+	while (batch->count < SSDFS_RECOVERY_READ_BATCH_SIZE &&
+		offset < end_offset && (offset + PAGE_SIZE) <= dev_size) {
+		page = batch->pages[batch->count];
+
+		if (!page) {
+			page = ssdfs_recovery_alloc_page(GFP_KERNEL |
+							 __GFP_ZERO);
+			if (IS_ERR_OR_NULL(page))
+				break;
+
+			batch->pages[batch->count] = page;
+		}
+
+		ClearPageUptodate(page);
+		ssdfs_lock_page(page);
+
+		pagevec_init(&pvec);
+		pagevec_add(&pvec, page);
+
+		err = fsi->devops->readpages_async(fsi->sb, &pvec,
+						   offset, &batch->io);
+		if (unlikely(err)) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("fail to submit read: "
+				  "offset %llu, err %d\n",
+				  offset, err);
+#endif /* CONFIG_SSDFS_DEBUG */
+			break;
+		}
+
+		batch->offsets[batch->count] = offset;
+		batch->count++;
+		offset += step;
+	}
+
+	batch->need_wait = batch->count > 0;
+}
+
+/*
+ * ssdfs_recovery_read_header() - read PEB header
+ * @env: recovery environment
+ * @offset: offset of the header in bytes
+ * @size: size of the header in bytes
+ * @buf: buffer for the header [out]
+ *
+ * This function copies the header from the batch of asynchronous
+ * reads. The header is read synchronously if the batch doesn't
+ * contain the requested offset.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+int ssdfs_recovery_read_header(struct ssdfs_recovery_env *env,
+				u64 offset, size_t size, void *buf)
+{
+	struct ssdfs_recovery_read_batch *batch;
+	struct ssdfs_fs_info *fsi;
+	struct page *page;
+	u32 i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!env || !env->fsi || !buf);
+
+	SSDFS_DBG("env %p, offset %llu, size %zu\n",
+		  env, offset, size);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	batch = &env->headers;
+	fsi = env->fsi;
+
+	if (batch->step > 0 && offset < batch->end_offset &&
+	    offset % PAGE_SIZE == 0 && size <= PAGE_SIZE &&
+	    (batch->count == 0 ||
+	     offset > batch->offsets[batch->count - 1])) {
+		ssdfs_recovery_readahead_headers(env, offset,
+						 batch->end_offset,
+						 batch->step);
+	}
+
+	for (i = 0; i < batch->count; i++) {
+		if (batch->offsets[i] != offset)
+			continue;
+
+		ssdfs_recovery_wait_headers(env);
+
+		page = batch->pages[i];
+		if (!PageUptodate(page))
+			break;
+
+		err = ssdfs_memcpy_from_page(buf, 0, size,
+					     page, 0, PAGE_SIZE,
+					     size);
+		if (unlikely(err))
+			break;
+
+		return 0;
+	}
+
+	return fsi->devops->read(fsi->sb, offset, size, buf);
+}
+
+/*
+ * ssdfs_recovery_forget_headers() - finish the batch of headers' reads
+ * @env: recovery environment
+ */
+void ssdfs_recovery_forget_headers(struct ssdfs_recovery_env *env)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!env);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	ssdfs_recovery_wait_headers(env);
+
+	env->headers.count = 0;
+	env->headers.step = 0;
+}
+
+/*
+ * ssdfs_recovery_release_headers() - free buffers of headers' reads
+ * @env: recovery environment
+ */
+static void ssdfs_recovery_release_headers(struct ssdfs_recovery_env *env)
+{
+	int i;
+
+	ssdfs_recovery_forget_headers(env);
+
+	for (i = 0; i < SSDFS_RECOVERY_READ_BATCH_SIZE; i++) {
+		if (!env->headers.pages[i])
+			continue;
+
+		ssdfs_recovery_free_page(env->headers.pages[i]);
+		env->headers.pages[i] = NULL;
+	}
+}
+
+/*
+ * ssdfs_recovery_threads_count() - define number of recovery threads
+ * @fsi: pointer on shared file system object
+ * @stripes_count: number of stripes on the volume
+ *
+ * The recovery threads mostly wait the reads of PEB headers.
+ * So, the number of threads follows the number of online CPUs
+ * but it is limited by the queue depth of the device because
+ * every thread keeps SSDFS_RECOVERY_READ_BATCH_SIZE reads
+ * in flight.
+ */
+static
+u32 ssdfs_recovery_threads_count(struct ssdfs_fs_info *fsi,
+				 u32 stripes_count)
+{
+	struct block_device *bdev = fsi->sb->s_bdev;
+	u32 threads_count = num_online_cpus();
+	u32 depth;
+
+	if (bdev) {
+		depth = bdev_get_queue(bdev)->nr_requests;
+		depth /= SSDFS_RECOVERY_READ_BATCH_SIZE;
+		threads_count = min_t(u32, threads_count, max_t(u32, depth, 1));
+	}
+
+	threads_count = max_t(u32, threads_count, SSDFS_RECOVERY_THREADS);
+	threads_count = min_t(u32, threads_count, SSDFS_RECOVERY_THREADS_MAX);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("threads_count %u, stripes_count %u\n",
+		  threads_count, stripes_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return min_t(u32, threads_count, stripes_count);
+}
+
 static inline bool has_thread_finished(struct ssdfs_recovery_env *env)
 {
 	switch (atomic_read(&env->state)) {
@@ -2731,6 +2997,8 @@ int ssdfs_gather_superblock_info(struct ssdfs_fs_info *fsi, int silent)
 	bool has_sb_peb_found1, has_sb_peb_found2;
 	bool has_iteration_succeeded;
 	u16 calculated;
+	ktime_t start = ktime_get();
+	int search_phase = SSDFS_MOUNT_SB_FAST_SEARCH;
 	int i;
 	int err = 0;
 
@@ -2756,6 +3024,9 @@ int ssdfs_gather_superblock_info(struct ssdfs_fs_info *fsi, int silent)
 	if (err)
 		goto forget_buf;
 
+	ssdfs_account_mount_phase(fsi, SSDFS_MOUNT_VOLUME_HEADER, start);
+	start = ktime_get();
+
 	vh = SSDFS_VH(fsi->sbi.vh_buf);
 	fragments_count = le32_to_cpu(vh->maptbl.fragments_count);
 	pebs_per_fragment = le16_to_cpu(vh->maptbl.pebs_per_fragment);
@@ -2767,7 +3038,7 @@ int ssdfs_gather_superblock_info(struct ssdfs_fs_info *fsi, int silent)
 	pebs_per_volume = div_u64(dev_size, erasesize);
 
 	stripes_count = fragments_count * stripes_per_fragment;
-	threads_count = min_t(u32, SSDFS_RECOVERY_THREADS, stripes_count);
+	threads_count = ssdfs_recovery_threads_count(fsi, stripes_count);
 
 	has_sb_peb_found1 = false;
 	has_sb_peb_found2 = false;
@@ -2801,6 +3072,7 @@ int ssdfs_gather_superblock_info(struct ssdfs_fs_info *fsi, int silent)
 			SSDFS_ERR("fail to prepare sb info: err %d\n", err);
 
 			for (; i >= 0; i--) {
+				ssdfs_recovery_release_headers(&array[i]);
 				ssdfs_destruct_sb_info(&array[i].sbi);
 				ssdfs_destruct_sb_info(&array[i].sbi_backup);
 			}
@@ -2931,6 +3203,10 @@ int ssdfs_gather_superblock_info(struct ssdfs_fs_info *fsi, int silent)
 	};
 
 try_slow_search:
+	ssdfs_account_mount_phase(fsi, SSDFS_MOUNT_SB_FAST_SEARCH, start);
+	start = ktime_get();
+	search_phase = SSDFS_MOUNT_SB_SLOW_SEARCH;
+
 	jobs_count = 1;
 
 	processed_stripes = 0;
@@ -3039,8 +3315,12 @@ finish_sb_peb_search:
 	for (i = 0; i < threads_count; i++)
 		ssdfs_recovery_stop_thread(&array[i]);
 
+	ssdfs_account_mount_phase(fsi, search_phase, start);
+	fsi->mount_profile.sb_search = search_phase;
+
 destruct_sb_info:
 	for (i = 0; i < threads_count; i++) {
+		ssdfs_recovery_release_headers(&array[i]);
 		ssdfs_destruct_sb_info(&array[i].sbi);
 		ssdfs_destruct_sb_info(&array[i].sbi_backup);
 	}
@@ -3092,6 +3372,8 @@ free_environment:
 			  "trying old algorithm!!!\n");
 #endif /* CONFIG_SSDFS_DEBUG */
 
+		start = ktime_get();
+
 		err = ssdfs_find_any_valid_sb_segment(fsi, 0);
 		if (err)
 			goto forget_buf;
@@ -3099,8 +3381,14 @@ free_environment:
 		err = ssdfs_find_latest_valid_sb_segment(fsi);
 		if (err)
 			goto forget_buf;
+
+		ssdfs_account_mount_phase(fsi, SSDFS_MOUNT_SB_FALLBACK_SEARCH,
+					  start);
+		fsi->mount_profile.sb_search = SSDFS_MOUNT_SB_FALLBACK_SEARCH;
 	}
 
+	start = ktime_get();
+
 	err = ssdfs_find_latest_valid_sb_info2(fsi);
 	if (err) {
 		SSDFS_ERR("unable to find latest valid sb info: "
@@ -3125,6 +3413,8 @@ free_environment:
 			goto forget_buf;
 	}
 
+	ssdfs_account_mount_phase(fsi, SSDFS_MOUNT_VOLUME_STATE, start);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("DONE: gather superblock info\n");
 #else
@@ -16,6 +16,28 @@
 
 #define SSDFS_RESERVED_SB_SEGS		(6)
 #define SSDFS_RECOVERY_THREADS		(12)
+#define SSDFS_RECOVERY_THREADS_MAX	(64)
+#define SSDFS_RECOVERY_READ_BATCH_SIZE	(16)
+
+/*
+ * struct ssdfs_recovery_read_batch - batch of PEB headers' reads
+ * @io: batch of asynchronous read requests
+ * @pages: buffers of the headers
+ * @offsets: offsets of the headers on the volume
+ * @count: number of submitted reads
+ * @end_offset: upper bound of the scanned range
+ * @step: distance between the headers in bytes
+ * @need_wait: are the reads in flight?
+ */
+struct ssdfs_recovery_read_batch {
+	struct ssdfs_io_batch io;
+	struct page *pages[SSDFS_RECOVERY_READ_BATCH_SIZE];
+	u64 offsets[SSDFS_RECOVERY_READ_BATCH_SIZE];
+	u32 count;
+	u64 end_offset;
+	u64 step;
+	bool need_wait;
+};
 
 /*
  * struct ssdfs_found_peb - found PEB details
@@ -104,6 +126,7 @@ struct ssdfs_found_protected_pebs {
  * @last_vh: buffer for last valid volume header
  * @sbi: superblock info
  * @sbi_backup: backup copy of superblock info
+ * @headers: batch of asynchronous reads of PEB headers
  * @request_wait_queue: request wait queue of recovery thread
  * @result_wait_queue: result wait queue of recovery thread
  * @thread: descriptor of recovery thread
@@ -120,6 +143,8 @@ struct ssdfs_recovery_env {
 	struct ssdfs_sb_info sbi;
 	struct ssdfs_sb_info sbi_backup;
 
+	struct ssdfs_recovery_read_batch headers;
+
 	wait_queue_head_t request_wait_queue;
 	wait_queue_head_t result_wait_queue;
 	struct ssdfs_thread_info thread;
@@ -424,6 +449,12 @@ void SSDFS_RECOVERY_SET_THIRD_SLOW_TRY(struct ssdfs_recovery_env *env)
 int ssdfs_recovery_start_thread(struct ssdfs_recovery_env *env,
 				u32 id);
 int ssdfs_recovery_stop_thread(struct ssdfs_recovery_env *env);
+void ssdfs_recovery_readahead_headers(struct ssdfs_recovery_env *env,
+				      u64 start_offset, u64 end_offset,
+				      u64 step);
+int ssdfs_recovery_read_header(struct ssdfs_recovery_env *env,
+				u64 offset, size_t size, void *buf);
+void ssdfs_recovery_forget_headers(struct ssdfs_recovery_env *env);
 void ssdfs_backup_sb_info2(struct ssdfs_recovery_env *env);
 void ssdfs_restore_sb_info2(struct ssdfs_recovery_env *env);
 int ssdfs_read_checked_sb_info3(struct ssdfs_recovery_env *env,
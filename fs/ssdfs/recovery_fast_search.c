@@ -285,6 +285,9 @@ int ssdfs_find_valid_protected_pebs(struct ssdfs_recovery_env *env)
 		  lower_peb, upper_peb);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	ssdfs_recovery_readahead_headers(env, lower_off, upper_off + 1,
+			(u64)SSDFS_MAPTBL_PROTECTION_STEP * env->fsi->erasesize);
+
 	while (lower_peb <= upper_peb) {
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("lower_peb %llu, lower_off %llu\n",
@@ -293,10 +296,10 @@ int ssdfs_find_valid_protected_pebs(struct ssdfs_recovery_env *env)
 			  upper_peb, (u64)upper_off);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-		err = env->fsi->devops->read(sb,
-					     lower_off,
-					     hdr_size,
-					     env->sbi.vh_buf);
+		err = ssdfs_recovery_read_header(env,
+						 lower_off,
+						 hdr_size,
+						 env->sbi.vh_buf);
 		vh = SSDFS_VH(env->sbi.vh_buf);
 		magic_valid = is_ssdfs_magic_valid(&vh->magic);
 		cno = le64_to_cpu(SSDFS_SEG_HDR(env->sbi.vh_buf)->cno);
@@ -396,6 +399,8 @@ define_last_cno_peb:
 			goto finish_search;
 	}
 
+	ssdfs_recovery_forget_headers(env);
+
 	found = &env->found->array[SSDFS_UPPER_PEB_INDEX];
 
 	if (found->peb.peb_id >= U64_MAX)
@@ -415,6 +420,8 @@ define_last_cno_peb:
 	return 0;
 
 finish_search:
+	ssdfs_recovery_forget_headers(env);
+
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("unable to find valid PEB\n");
 #endif /* CONFIG_SSDFS_DEBUG */
@@ -196,8 +196,8 @@ int ssdfs_read_and_check_volume_header(struct ssdfs_recovery_env *env,
 	sb = env->fsi->sb;
 	dev_size = env->fsi->devops->device_size(sb);
 
-	err = env->fsi->devops->read(sb, offset, hdr_size,
-				     env->sbi.vh_buf);
+	err = ssdfs_recovery_read_header(env, offset, hdr_size,
+					 env->sbi.vh_buf);
 	if (err)
 		goto found_corrupted_peb;
 
@@ -260,9 +260,13 @@ int __ssdfs_find_any_valid_volume_header2(struct ssdfs_recovery_env *env,
 		return err;
 	}
 
+	ssdfs_recovery_readahead_headers(env, start_offset, end_offset, step);
+
 	while (*SSDFS_RECOVERY_CUR_OFF_PTR(env) < end_offset) {
-		if (kthread_should_stop())
-			return -ENOENT;
+		if (kthread_should_stop()) {
+			err = -ENOENT;
+			goto finish_search;
+		}
 
 		err = ssdfs_read_and_check_volume_header(env,
 					*SSDFS_RECOVERY_CUR_OFF_PTR(env));
@@ -271,13 +275,17 @@ int __ssdfs_find_any_valid_volume_header2(struct ssdfs_recovery_env *env,
 			SSDFS_DBG("found offset %llu\n",
 				  *SSDFS_RECOVERY_CUR_OFF_PTR(env));
 #endif /* CONFIG_SSDFS_DEBUG */
-			return 0;
+			goto finish_search;
 		}
 
 		*SSDFS_RECOVERY_CUR_OFF_PTR(env) += step;
 	}
 
-	return -E2BIG;
+	err = -E2BIG;
+
+finish_search:
+	ssdfs_recovery_forget_headers(env);
+	return err;
 }
 
 int ssdfs_find_any_valid_sb_segment2(struct ssdfs_recovery_env *env,
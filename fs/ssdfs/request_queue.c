@@ -38,6 +38,8 @@
 #include "btree.h"
 #include "snapshots_tree.h"
 
+#include <trace/events/ssdfs.h>
+
 #ifdef CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING
 atomic64_t ssdfs_req_queue_page_leaks;
 atomic64_t ssdfs_req_queue_memory_leaks;
@@ -96,6 +98,28 @@ void ssdfs_req_queue_check_memory_leaks(void)
 
 static struct kmem_cache *ssdfs_seg_req_obj_cachep;
 
+/*
+ * struct ssdfs_seg_req_obj_pool - per-CPU pool of recycled requests
+ * @lock: pool's lock
+ * @list: list of free request objects
+ * @count: number of request objects in the pool
+ *
+ * Freed request objects are kept in the pool of the current CPU
+ * and they are reused by the next allocation on this CPU.
+ * It excludes the slab allocator and memory cgroup accounting
+ * from the hot path. The @lock is taken by the owner CPU and
+ * by the pools draining logic only.
+ */
+struct ssdfs_seg_req_obj_pool {
+	spinlock_t lock;
+	struct list_head list;
+	unsigned int count;
+};
+
+#define SSDFS_SEG_REQ_OBJ_POOL_MAX	(64)
+
+static DEFINE_PER_CPU(struct ssdfs_seg_req_obj_pool, ssdfs_seg_req_obj_pools);
+
 void ssdfs_zero_seg_req_obj_cache_ptr(void)
 {
 	ssdfs_seg_req_obj_cachep = NULL;
@@ -109,16 +133,65 @@ void ssdfs_init_seg_req_object_once(void *obj)
 	memset(req_obj, 0, sizeof(struct ssdfs_segment_request));
 }
 
+/*
+ * ssdfs_seg_req_obj_pools_init() - initialize per-CPU request pools
+ */
+static
+void ssdfs_seg_req_obj_pools_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ssdfs_seg_req_obj_pool *pool;
+
+		pool = per_cpu_ptr(&ssdfs_seg_req_obj_pools, cpu);
+		spin_lock_init(&pool->lock);
+		INIT_LIST_HEAD(&pool->list);
+		pool->count = 0;
+	}
+}
+
+/*
+ * ssdfs_seg_req_obj_pools_drain() - return pooled requests into slab cache
+ */
+static
+void ssdfs_seg_req_obj_pools_drain(void)
+{
+	struct ssdfs_segment_request *req, *tmp;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ssdfs_seg_req_obj_pool *pool;
+		LIST_HEAD(drained);
+
+		pool = per_cpu_ptr(&ssdfs_seg_req_obj_pools, cpu);
+
+		spin_lock(&pool->lock);
+		list_splice_init(&pool->list, &drained);
+		pool->count = 0;
+		spin_unlock(&pool->lock);
+
+		list_for_each_entry_safe(req, tmp, &drained, list) {
+			list_del(&req->list);
+			kmem_cache_free(ssdfs_seg_req_obj_cachep, req);
+		}
+	}
+}
+
 void ssdfs_shrink_seg_req_obj_cache(void)
 {
-	if (ssdfs_seg_req_obj_cachep)
+	if (ssdfs_seg_req_obj_cachep) {
+		ssdfs_seg_req_obj_pools_drain();
 		kmem_cache_shrink(ssdfs_seg_req_obj_cachep);
+	}
 }
 
 void ssdfs_destroy_seg_req_obj_cache(void)
 {
-	if (ssdfs_seg_req_obj_cachep)
+	if (ssdfs_seg_req_obj_cachep) {
+		ssdfs_seg_req_obj_pools_drain();
 		kmem_cache_destroy(ssdfs_seg_req_obj_cachep);
+	}
 }
 
 int ssdfs_init_seg_req_obj_cache(void)
@@ -134,6 +207,8 @@ int ssdfs_init_seg_req_obj_cache(void)
 		return -ENOMEM;
 	}
 
+	ssdfs_seg_req_obj_pools_init();
+
 	return 0;
 }
 
@@ -149,6 +224,38 @@ void ssdfs_requests_queue_init(struct ssdfs_requests_queue *rq)
 
 	spin_lock_init(&rq->lock);
 	INIT_LIST_HEAD(&rq->list);
+	init_llist_head(&rq->incoming);
+}
+
+/*
+ * ssdfs_requests_queue_move_incoming() - move incoming requests into queue
+ * @rq: requests queue
+ *
+ * This function moves the lock-free list of newly added
+ * requests at the tail of the queue's list. The caller
+ * has to hold the queue's lock.
+ */
+static inline
+void ssdfs_requests_queue_move_incoming(struct ssdfs_requests_queue *rq)
+{
+	struct llist_node *nodes;
+	struct ssdfs_segment_request *req, *tmp;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!rq);
+	lockdep_assert_held(&rq->lock);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	nodes = llist_del_all(&rq->incoming);
+	if (!nodes)
+		return;
+
+	/* incoming list keeps the newest request first */
+	nodes = llist_reverse_order(nodes);
+
+	llist_for_each_entry_safe(req, tmp, nodes, llist) {
+		list_add_tail(&req->list, &rq->list);
+	}
 }
 
 /*
@@ -163,13 +270,68 @@ bool is_ssdfs_requests_queue_empty(struct ssdfs_requests_queue *rq)
 	BUG_ON(!rq);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	if (!llist_empty(&rq->incoming))
+		return false;
+
 	spin_lock(&rq->lock);
-	is_empty = list_empty_careful(&rq->list);
+	is_empty = list_empty_careful(&rq->list) &&
+			llist_empty(&rq->incoming);
 	spin_unlock(&rq->lock);
 
 	return is_empty;
 }
 
+/*
+ * ssdfs_requests_queue_count() - get number of requests in the queue
+ * @rq: requests queue
+ *
+ * The producers add requests at the head of @incoming list only.
+ * So, the list can be walked under the queue's lock that excludes
+ * the moving of the incoming requests by the consumer.
+ */
+u32 ssdfs_requests_queue_count(struct ssdfs_requests_queue *rq)
+{
+	struct ssdfs_segment_request *req;
+	struct llist_node *node;
+	u32 count = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!rq);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	spin_lock(&rq->lock);
+	list_for_each_entry(req, &rq->list, list)
+		count++;
+	llist_for_each(node, READ_ONCE(rq->incoming.first))
+		count++;
+	spin_unlock(&rq->lock);
+
+	return count;
+}
+
+/*
+ * ssdfs_request_define_deadline() - define request's processing deadline
+ * @fsi: pointer on shared file system object
+ * @req: request
+ *
+ * This function defines the deadline of request's processing
+ * by means of latency target of request's priority class.
+ */
+static inline
+void ssdfs_request_define_deadline(struct ssdfs_fs_info *fsi,
+				   struct ssdfs_segment_request *req)
+{
+	int prio = ssdfs_request_priority_class(req);
+	unsigned int latency;
+
+	latency = atomic_read(&fsi->req_latency_msecs[prio]);
+	req->private.deadline = jiffies + msecs_to_jiffies(latency);
+
+	/* zero deadline means that deadline is undefined */
+	if (req->private.deadline == 0)
+		req->private.deadline = 1;
+}
+
 /*
  * ssdfs_requests_queue_add_head() - add request at the head of queue
  * @rq: requests queue
@@ -211,6 +373,8 @@ void ssdfs_requests_queue_add_head_inc(struct ssdfs_fs_info *fsi,
 		  req->private.cmd);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	ssdfs_request_define_deadline(fsi, req);
+	trace_ssdfs_request_enqueue(req, true);
 	ssdfs_requests_queue_add_head(rq, req);
 	atomic64_inc(&fsi->flush_reqs);
 
@@ -224,6 +388,9 @@ void ssdfs_requests_queue_add_head_inc(struct ssdfs_fs_info *fsi,
  * ssdfs_requests_queue_add_tail() - add request at the tail of queue
  * @rq: requests queue
  * @req: request
+ *
+ * This function adds request into the queue without
+ * the queue's lock acquiring.
  */
 void ssdfs_requests_queue_add_tail(struct ssdfs_requests_queue *rq,
 				   struct ssdfs_segment_request *req)
@@ -237,9 +404,8 @@ void ssdfs_requests_queue_add_tail(struct ssdfs_requests_queue *rq,
 		  req->private.cmd);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	spin_lock(&rq->lock);
-	list_add_tail(&req->list, &rq->list);
-	spin_unlock(&rq->lock);
+	trace_ssdfs_request_enqueue(req, false);
+	llist_add(&req->llist, &rq->incoming);
 }
 
 /*
@@ -261,6 +427,7 @@ void ssdfs_requests_queue_add_tail_inc(struct ssdfs_fs_info *fsi,
 		  req->private.cmd);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	ssdfs_request_define_deadline(fsi, req);
 	ssdfs_requests_queue_add_tail(rq, req);
 	atomic64_inc(&fsi->flush_reqs);
 
@@ -270,6 +437,202 @@ void ssdfs_requests_queue_add_tail_inc(struct ssdfs_fs_info *fsi,
 #endif /* CONFIG_SSDFS_DEBUG */
 }
 
+/*
+ * ssdfs_requests_queue_add_tail_list_inc() - add list of requests into queue
+ * @fsi: pointer on shared file system object
+ * @rq: requests queue
+ * @list: list of prepared requests
+ * @count: number of requests in the list
+ *
+ * This function moves all requests of @list at the tail
+ * of @rq by means of one lock-free operation.
+ */
+void ssdfs_requests_queue_add_tail_list_inc(struct ssdfs_fs_info *fsi,
+					    struct ssdfs_requests_queue *rq,
+					    struct list_head *list,
+					    u32 count)
+{
+	struct ssdfs_segment_request *req, *tmp;
+	struct llist_node *first = NULL;
+	struct llist_node *last = NULL;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !rq || !list);
+
+	SSDFS_DBG("count %u\n", count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (list_empty(list))
+		return;
+
+	/* incoming list keeps the newest request first */
+	list_for_each_entry_safe(req, tmp, list, list) {
+		list_del(&req->list);
+		ssdfs_request_define_deadline(fsi, req);
+		trace_ssdfs_request_enqueue(req, false);
+
+		req->llist.next = first;
+		first = &req->llist;
+
+		if (!last)
+			last = first;
+	}
+
+	llist_add_batch(first, last, &rq->incoming);
+
+	atomic64_add(count, &fsi->flush_reqs);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("flush_reqs %lld\n",
+		  atomic64_read(&fsi->flush_reqs));
+#endif /* CONFIG_SSDFS_DEBUG */
+}
+
+/*
+ * can_update_requests_be_merged() - check that requests can be merged
+ * @tail: request at the tail of queue
+ * @req: new request
+ * @pagesize: logical block size in bytes
+ *
+ * Two update requests can be merged if they are asynchronous,
+ * the @tail hasn't been processed yet, and @req continues
+ * the @tail as in the file as in the segment.
+ */
+static inline
+bool can_update_requests_be_merged(struct ssdfs_segment_request *tail,
+				   struct ssdfs_segment_request *req,
+				   u32 pagesize)
+{
+	u64 tail_end;
+	u32 tail_bytes;
+
+	if (tail->private.class != SSDFS_PEB_UPDATE_REQ ||
+	    tail->private.type != SSDFS_REQ_ASYNC ||
+	    tail->private.flags != req->private.flags)
+		return false;
+
+	switch (tail->private.cmd) {
+	case SSDFS_UPDATE_BLOCK:
+	case SSDFS_UPDATE_EXTENT:
+		/* expected command */
+		break;
+
+	default:
+		return false;
+	}
+
+	if (atomic_read(&tail->result.state) != SSDFS_REQ_CREATED ||
+	    tail->result.processed_blks != 0)
+		return false;
+
+	if (tail->extent.ino != req->extent.ino ||
+	    tail->extent.cno != req->extent.cno ||
+	    tail->extent.parent_snapshot != req->extent.parent_snapshot)
+		return false;
+
+	tail_bytes = (u32)tail->place.len * pagesize;
+	if (tail->extent.data_bytes != tail_bytes)
+		return false;
+
+	tail_end = tail->extent.logical_offset + tail->extent.data_bytes;
+	if (tail_end != req->extent.logical_offset)
+		return false;
+
+	if (tail->place.start.seg_id != req->place.start.seg_id ||
+	    ((u32)tail->place.start.blk_index + tail->place.len) !=
+					req->place.start.blk_index)
+		return false;
+
+	if ((u32)tail->place.len + req->place.len >= U16_MAX)
+		return false;
+
+	if (pagevec_space(&tail->result.pvec) <
+				pagevec_count(&req->result.pvec))
+		return false;
+
+	return true;
+}
+
+/*
+ * ssdfs_requests_queue_merge_tail() - merge request with queue's tail
+ * @rq: requests queue
+ * @req: new update request
+ * @pagesize: logical block size in bytes
+ *
+ * This function tries to merge the new asynchronous update request
+ * with the request at the tail of the queue. If @req continues
+ * the tail's logical blocks of the same inode, then memory pages
+ * of @req are moved into the tail request and the tail request
+ * is converted into the extent update. The @req is not added
+ * into the queue in such case and the caller has to free it.
+ *
+ * RETURN:
+ * [true]  - @req has been merged with the tail request.
+ * [false] - @req has to be added into the queue.
+ */
+bool ssdfs_requests_queue_merge_tail(struct ssdfs_requests_queue *rq,
+				     struct ssdfs_segment_request *req,
+				     u32 pagesize)
+{
+	struct ssdfs_segment_request *tail;
+	bool is_merged = false;
+	int i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!rq || !req);
+
+	SSDFS_DBG("seg_id %llu, ino %llu, logical_offset %llu, "
+		  "blk_index %u, len %u\n",
+		  req->place.start.seg_id, req->extent.ino,
+		  req->extent.logical_offset,
+		  req->place.start.blk_index, req->place.len);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (req->private.class != SSDFS_PEB_UPDATE_REQ ||
+	    req->private.type != SSDFS_REQ_ASYNC)
+		return false;
+
+	switch (req->private.cmd) {
+	case SSDFS_UPDATE_BLOCK:
+	case SSDFS_UPDATE_EXTENT:
+		/* expected command */
+		break;
+
+	default:
+		return false;
+	}
+
+	spin_lock(&rq->lock);
+
+	ssdfs_requests_queue_move_incoming(rq);
+
+	if (list_empty(&rq->list))
+		goto finish_merge;
+
+	tail = list_last_entry(&rq->list, struct ssdfs_segment_request, list);
+
+	if (!can_update_requests_be_merged(tail, req, pagesize))
+		goto finish_merge;
+
+	for (i = 0; i < pagevec_count(&req->result.pvec); i++)
+		pagevec_add(&tail->result.pvec, req->result.pvec.pages[i]);
+	pagevec_reinit(&req->result.pvec);
+
+	tail->extent.data_bytes += req->extent.data_bytes;
+	tail->place.len += req->place.len;
+	tail->private.cmd = SSDFS_UPDATE_EXTENT;
+	is_merged = true;
+
+finish_merge:
+	spin_unlock(&rq->lock);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("is_merged %#x\n", is_merged);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return is_merged;
+}
+
 /*
  * is_request_command_valid() - check request's command validity
  * @class: request's class
@@ -348,6 +711,8 @@ int ssdfs_requests_queue_remove_first(struct ssdfs_requests_queue *rq,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	spin_lock(&rq->lock);
+	if (list_empty_careful(&rq->list))
+		ssdfs_requests_queue_move_incoming(rq);
 	is_empty = list_empty_careful(&rq->list);
 	if (!is_empty) {
 		*req = list_first_entry_or_null(&rq->list,
@@ -381,6 +746,217 @@ int ssdfs_requests_queue_remove_first(struct ssdfs_requests_queue *rq,
 	return 0;
 }
 
+/*
+ * is_request_reordering_barrier() - check that request cannot be bypassed
+ * @req: request
+ *
+ * Log commit, migration start and invalidation requests rely on
+ * processing of all preceding requests. The rest requests
+ * cannot be moved ahead of such request.
+ */
+static inline
+bool is_request_reordering_barrier(struct ssdfs_segment_request *req)
+{
+	switch (req->private.cmd) {
+	case SSDFS_COMMIT_LOG_NOW:
+	case SSDFS_START_MIGRATION_NOW:
+	case SSDFS_EXTENT_WAS_INVALIDATED:
+		return true;
+
+	default:
+		/* do nothing */
+		break;
+	}
+
+	return false;
+}
+
+/*
+ * are_requests_overlapping() - check that requests could depend on each other
+ * @req1: first request
+ * @req2: second request
+ *
+ * Requests of the same inode or requests with overlapping ranges
+ * of logical blocks have to be processed in order of the queue.
+ */
+static inline
+bool are_requests_overlapping(struct ssdfs_segment_request *req1,
+			      struct ssdfs_segment_request *req2)
+{
+	u32 start1, end1;
+	u32 start2, end2;
+
+	if (req1->extent.ino == req2->extent.ino)
+		return true;
+
+	if (req1->place.start.seg_id != req2->place.start.seg_id)
+		return false;
+
+	start1 = req1->place.start.blk_index;
+	end1 = start1 + max_t(u32, req1->place.len, 1);
+	start2 = req2->place.start.blk_index;
+	end2 = start2 + max_t(u32, req2->place.len, 1);
+
+	return start1 < end2 && start2 < end1;
+}
+
+/*
+ * ssdfs_request_effective_priority() - define current priority of request
+ * @req: request
+ *
+ * Request with expired deadline is processed as synchronous one.
+ * It guarantees that background requests are not starved.
+ */
+static inline
+int ssdfs_request_effective_priority(struct ssdfs_segment_request *req)
+{
+	unsigned long deadline = req->private.deadline;
+
+	if (deadline != 0 && time_after_eq(jiffies, deadline))
+		return SSDFS_REQ_PRIO_SYNC;
+
+	return ssdfs_request_priority_class(req);
+}
+
+/*
+ * ssdfs_requests_queue_remove_prio() - get request with highest priority
+ * @rq: requests queue
+ * @req: selected request [out]
+ *
+ * This function selects a request with highest priority among several
+ * first requests in @rq, removes it from queue and returns as @req.
+ * Synchronous requests bypass the preceding asynchronous and background
+ * (GC, migration) requests if the bypassed requests have not expired
+ * their deadlines and are independent from the selected request.
+ * Otherwise, the first request in @rq is selected.
+ *
+ * RETURN:
+ * [success] - @req contains pointer on request.
+ * [failure] - error code:
+ *
+ * %-ENODATA     - queue is empty.
+ */
+int ssdfs_requests_queue_remove_prio(struct ssdfs_requests_queue *rq,
+				     struct ssdfs_segment_request **req)
+{
+#define SSDFS_REQ_PRIO_SCAN_MAX		(16)
+	struct ssdfs_segment_request *first, *cur, *prev, *best;
+	int best_prio, prio;
+	int scanned = 0;
+	bool is_independent;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!rq || !req);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	spin_lock(&rq->lock);
+
+	ssdfs_requests_queue_move_incoming(rq);
+
+	if (list_empty(&rq->list)) {
+		spin_unlock(&rq->lock);
+		SSDFS_WARN("requests queue is empty\n");
+		return -ENODATA;
+	}
+
+	first = list_first_entry(&rq->list, struct ssdfs_segment_request, list);
+	best = first;
+	best_prio = ssdfs_request_effective_priority(first);
+
+	if (best_prio == SSDFS_REQ_PRIO_SYNC ||
+	    is_request_reordering_barrier(first))
+		goto remove_request;
+
+	cur = first;
+	list_for_each_entry_continue(cur, &rq->list, list) {
+		if (++scanned > SSDFS_REQ_PRIO_SCAN_MAX)
+			break;
+
+		if (is_request_reordering_barrier(cur))
+			break;
+
+		prio = ssdfs_request_effective_priority(cur);
+		if (prio >= best_prio)
+			continue;
+
+		is_independent = true;
+		prev = cur;
+		list_for_each_entry_continue_reverse(prev, &rq->list, list) {
+			if (are_requests_overlapping(prev, cur)) {
+				is_independent = false;
+				break;
+			}
+		}
+
+		if (!is_independent)
+			continue;
+
+		best = cur;
+		best_prio = prio;
+
+		if (best_prio == SSDFS_REQ_PRIO_SYNC)
+			break;
+	}
+
+remove_request:
+	list_del(&best->list);
+	spin_unlock(&rq->lock);
+
+	*req = best;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!is_request_command_valid((*req)->private.class,
+					 (*req)->private.cmd));
+	BUG_ON((*req)->private.type >= SSDFS_REQ_TYPE_MAX);
+
+	SSDFS_DBG("seg_id %llu, class %#x, cmd %#x, "
+		  "bypassed_head %#x\n",
+		  (*req)->place.start.seg_id,
+		  (*req)->private.class,
+		  (*req)->private.cmd,
+		  best != first);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return 0;
+}
+
+/*
+ * ssdfs_requests_queue_remove_batch() - remove all requests from queue
+ * @rq: requests queue
+ * @batch: list of extracted requests [out]
+ *
+ * This function moves all requests of @rq at the tail of @batch
+ * by means of one queue's lock acquiring. It gives the consumer
+ * thread the opportunity to drain the queue in one go.
+ *
+ * RETURN:
+ * [success] - @batch contains requests.
+ * [failure] - error code:
+ *
+ * %-ENODATA     - queue is empty.
+ */
+int ssdfs_requests_queue_remove_batch(struct ssdfs_requests_queue *rq,
+				      struct list_head *batch)
+{
+	bool is_empty;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!rq || !batch);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	spin_lock(&rq->lock);
+	ssdfs_requests_queue_move_incoming(rq);
+	is_empty = list_empty_careful(&rq->list);
+	if (!is_empty)
+		list_splice_tail_init(&rq->list, batch);
+	spin_unlock(&rq->lock);
+
+	if (is_empty)
+		return -ENODATA;
+
+	return 0;
+}
+
 /*
  * ssdfs_requests_queue_remove_all() - remove all requests from queue
  * @rq: requests queue
@@ -400,6 +976,7 @@ void ssdfs_requests_queue_remove_all(struct ssdfs_requests_queue *rq,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	spin_lock(&rq->lock);
+	ssdfs_requests_queue_move_incoming(rq);
 	is_empty = list_empty_careful(&rq->list);
 	if (!is_empty)
 		list_replace_init(&rq->list, &tmp_list);
@@ -506,19 +1083,37 @@ void ssdfs_requests_queue_remove_all(struct ssdfs_requests_queue *rq,
  */
 struct ssdfs_segment_request *ssdfs_request_alloc(void)
 {
+	struct ssdfs_seg_req_obj_pool *pool;
 	struct ssdfs_segment_request *ptr;
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!ssdfs_seg_req_obj_cachep);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	pool = get_cpu_ptr(&ssdfs_seg_req_obj_pools);
+	spin_lock(&pool->lock);
+	ptr = list_first_entry_or_null(&pool->list,
+					struct ssdfs_segment_request,
+					list);
+	if (ptr) {
+		list_del(&ptr->list);
+		pool->count--;
+	}
+	spin_unlock(&pool->lock);
+	put_cpu_ptr(&ssdfs_seg_req_obj_pools);
+
+	if (ptr)
+		goto finish_alloc;
+
 	ptr = kmem_cache_alloc(ssdfs_seg_req_obj_cachep, GFP_KERNEL);
 	if (!ptr) {
 		SSDFS_ERR("fail to allocate memory for request\n");
 		return ERR_PTR(-ENOMEM);
 	}
 
+finish_alloc:
 	ssdfs_req_queue_cache_leaks_increment(ptr);
+	trace_ssdfs_request_alloc(ptr);
 
 	return ptr;
 }
@@ -528,6 +1123,9 @@ struct ssdfs_segment_request *ssdfs_request_alloc(void)
  */
 void ssdfs_request_free(struct ssdfs_segment_request *req)
 {
+	struct ssdfs_seg_req_obj_pool *pool;
+	bool is_recycled = false;
+
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!ssdfs_seg_req_obj_cachep);
 #endif /* CONFIG_SSDFS_DEBUG */
@@ -536,7 +1134,19 @@ void ssdfs_request_free(struct ssdfs_segment_request *req)
 		return;
 
 	ssdfs_req_queue_cache_leaks_decrement(req);
-	kmem_cache_free(ssdfs_seg_req_obj_cachep, req);
+
+	pool = get_cpu_ptr(&ssdfs_seg_req_obj_pools);
+	spin_lock(&pool->lock);
+	if (pool->count < SSDFS_SEG_REQ_OBJ_POOL_MAX) {
+		list_add(&req->list, &pool->list);
+		pool->count++;
+		is_recycled = true;
+	}
+	spin_unlock(&pool->lock);
+	put_cpu_ptr(&ssdfs_seg_req_obj_pools);
+
+	if (!is_recycled)
+		kmem_cache_free(ssdfs_seg_req_obj_cachep, req);
 }
 
 /*
@@ -549,13 +1159,19 @@ void ssdfs_request_init(struct ssdfs_segment_request *req)
 	BUG_ON(!req);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	memset(req, 0, sizeof(struct ssdfs_segment_request));
+	/*
+	 * The page vectors are initialized by counters only.
+	 * It excludes the clearing of page pointers' arrays.
+	 */
+	memset(req, 0, offsetof(struct ssdfs_segment_request, result));
 
 	INIT_LIST_HEAD(&req->list);
 	atomic_set(&req->private.refs_count, 0);
 	init_waitqueue_head(&req->private.wait_queue);
 	pagevec_init(&req->result.pvec);
+	pagevec_init(&req->result.old_state);
 	pagevec_init(&req->result.diffs);
+	req->result.processed_blks = 0;
 	atomic_set(&req->result.state, SSDFS_REQ_CREATED);
 	init_completion(&req->result.wait);
 	req->result.err = 0;
@@ -23,15 +23,25 @@
 #define _SSDFS_REQUEST_QUEUE_H
 
 #include <linux/pagevec.h>
+#include <linux/llist.h>
 
 /*
  * struct ssdfs_requests_queue - requests queue descriptor
  * @lock: requests queue's lock
  * @list: requests queue's list
+ * @incoming: lock-free list of newly added requests
+ *
+ * The queue is multi-producer/single-consumer oriented.
+ * Producers add requests at the tail of the queue without
+ * the lock by means of @incoming list. The consumer moves
+ * the @incoming requests into @list under the @lock before
+ * the dequeue. The @lock serializes the consumers and
+ * the adding of requests at the head of the queue.
  */
 struct ssdfs_requests_queue {
 	spinlock_t lock;
 	struct list_head list;
+	struct llist_head incoming;
 };
 
 /*
@@ -156,6 +166,8 @@ struct ssdfs_logical_extent {
  * @type: request type
  * @refs_count: reference counter
  * @flags: request flags
+ * @deadline: time (jiffies) when request should be processed
+ * @service_start: time when PEB's thread has taken the request
  * @wait_queue: queue for result waiting
  */
 struct ssdfs_request_internal_data {
@@ -164,6 +176,8 @@ struct ssdfs_request_internal_data {
 	int type;
 	atomic_t refs_count;
 	u32 flags;
+	unsigned long deadline;
+	ktime_t service_start;
 	wait_queue_head_t wait_queue;
 };
 
@@ -190,6 +204,7 @@ struct ssdfs_request_result {
 /*
  * struct ssdfs_segment_request - segment I/O request
  * @list: requests queue list
+ * @llist: lock-free list of incoming requests
  * @extent: logical extent descriptor
  * @place: logical blocks placement in segment
  * @private: internal data of request
@@ -197,6 +212,7 @@ struct ssdfs_request_result {
  */
 struct ssdfs_segment_request {
 	struct list_head list;
+	struct llist_node llist;
 	struct ssdfs_logical_extent extent;
 	struct ssdfs_volume_extent place;
 	struct ssdfs_request_internal_data private;
@@ -425,6 +441,36 @@ void ssdfs_request_prepare_internal_data(int class, int cmd, int type,
 	req->private.type = type;
 }
 
+/*
+ * ssdfs_request_priority_class() - define priority class of request
+ * @req: segment request
+ *
+ * Garbage collection and migration requests are background ones.
+ * Other requests are prioritized in correspondence with their type.
+ */
+static inline
+int ssdfs_request_priority_class(struct ssdfs_segment_request *req)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!req);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	switch (req->private.class) {
+	case SSDFS_PEB_COLLECT_GARBAGE_REQ:
+	case SSDFS_ZONE_USER_DATA_MIGRATE_REQ:
+		return SSDFS_REQ_PRIO_BACKGROUND;
+
+	default:
+		/* continue logic */
+		break;
+	}
+
+	if (req->private.type == SSDFS_REQ_SYNC)
+		return SSDFS_REQ_PRIO_SYNC;
+
+	return SSDFS_REQ_PRIO_ASYNC;
+}
+
 /*
  * ssdfs_request_define_segment() - define segment number
  * @seg_id: segment number
@@ -496,18 +542,30 @@ bool has_request_been_executed(struct ssdfs_segment_request *req)
  */
 void ssdfs_requests_queue_init(struct ssdfs_requests_queue *rq);
 bool is_ssdfs_requests_queue_empty(struct ssdfs_requests_queue *rq);
+u32 ssdfs_requests_queue_count(struct ssdfs_requests_queue *rq);
 void ssdfs_requests_queue_add_tail(struct ssdfs_requests_queue *rq,
 				   struct ssdfs_segment_request *req);
 void ssdfs_requests_queue_add_tail_inc(struct ssdfs_fs_info *fsi,
 					struct ssdfs_requests_queue *rq,
 					struct ssdfs_segment_request *req);
+void ssdfs_requests_queue_add_tail_list_inc(struct ssdfs_fs_info *fsi,
+					    struct ssdfs_requests_queue *rq,
+					    struct list_head *list,
+					    u32 count);
 void ssdfs_requests_queue_add_head(struct ssdfs_requests_queue *rq,
 				   struct ssdfs_segment_request *req);
 void ssdfs_requests_queue_add_head_inc(struct ssdfs_fs_info *fsi,
 					struct ssdfs_requests_queue *rq,
 					struct ssdfs_segment_request *req);
+bool ssdfs_requests_queue_merge_tail(struct ssdfs_requests_queue *rq,
+				     struct ssdfs_segment_request *req,
+				     u32 pagesize);
 int ssdfs_requests_queue_remove_first(struct ssdfs_requests_queue *rq,
 				      struct ssdfs_segment_request **req);
+int ssdfs_requests_queue_remove_prio(struct ssdfs_requests_queue *rq,
+				     struct ssdfs_segment_request **req);
+int ssdfs_requests_queue_remove_batch(struct ssdfs_requests_queue *rq,
+				      struct list_head *batch);
 void ssdfs_requests_queue_remove_all(struct ssdfs_requests_queue *rq,
 				     int err);
 
@@ -56,6 +56,8 @@ atomic64_t ssdfs_seg_obj_cache_leaks;
  * void *ssdfs_seg_obj_kmalloc(size_t size, gfp_t flags)
  * void *ssdfs_seg_obj_kzalloc(size_t size, gfp_t flags)
  * void *ssdfs_seg_obj_kcalloc(size_t n, size_t size, gfp_t flags)
+ * void *ssdfs_seg_obj_kcalloc_node(size_t n, size_t size,
+ *				    gfp_t flags, int node)
  * void ssdfs_seg_obj_kfree(void *kaddr)
  * struct page *ssdfs_seg_obj_alloc_page(gfp_t gfp_mask)
  * struct page *ssdfs_seg_obj_add_pagevec_page(struct pagevec *pvec)
@@ -150,7 +152,10 @@ int ssdfs_init_seg_obj_cache(void)
  * ssdfs_segment_allocate_object() - allocate segment object
  * @seg_id: segment number
  *
- * This function tries to allocate segment object.
+ * This function tries to allocate segment object. The segment
+ * is associated with the NUMA node of the caller. Usually, it is
+ * the node of the writer that needs a new current segment.
+ * The memory of segment and the PEBs' threads are placed on this node.
  *
  * RETURN:
  * [success] - pointer on allocated segment object
@@ -161,8 +166,9 @@ int ssdfs_init_seg_obj_cache(void)
 struct ssdfs_segment_info *ssdfs_segment_allocate_object(u64 seg_id)
 {
 	struct ssdfs_segment_info *ptr;
+	int node = numa_node_id();
 
-	ptr = kmem_cache_alloc(ssdfs_seg_obj_cachep, GFP_KERNEL);
+	ptr = kmem_cache_alloc_node(ssdfs_seg_obj_cachep, GFP_KERNEL, node);
 	if (!ptr) {
 		SSDFS_ERR("fail to allocate memory for segment %llu\n",
 			  seg_id);
@@ -175,12 +181,15 @@ struct ssdfs_segment_info *ssdfs_segment_allocate_object(u64 seg_id)
 	atomic_set(&ptr->obj_state, SSDFS_SEG_OBJECT_UNDER_CREATION);
 	atomic_set(&ptr->activity_type, SSDFS_SEG_OBJECT_NO_ACTIVITY);
 	ptr->seg_id = seg_id;
+	ptr->node_id = node;
 	atomic_set(&ptr->refs_count, 0);
 	init_waitqueue_head(&ptr->object_queue);
+	INIT_LIST_HEAD(&ptr->lru);
+	atomic_set(&ptr->lru_referenced, 0);
 
 #ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("segment object %p, seg_id %llu\n",
-		  ptr, seg_id);
+	SSDFS_DBG("segment object %p, seg_id %llu, node %d\n",
+		  ptr, seg_id, node);
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	return ptr;
@@ -450,9 +459,9 @@ int ssdfs_segment_create_object(struct ssdfs_fs_info *fsi,
 	si->invalidated_user_data_pages = 0;
 
 	si->pebs_count = fsi->pebs_per_seg;
-	si->peb_array = ssdfs_seg_obj_kcalloc(si->pebs_count,
-				       sizeof(struct ssdfs_peb_container),
-				       GFP_KERNEL);
+	si->peb_array = ssdfs_seg_obj_kcalloc_node(si->pebs_count,
+					sizeof(struct ssdfs_peb_container),
+					GFP_KERNEL, si->node_id);
 	if (!si->peb_array) {
 		err = -ENOMEM;
 		SSDFS_ERR("fail to allocate memory for peb array\n");
@@ -515,6 +524,8 @@ int ssdfs_segment_create_object(struct ssdfs_fs_info *fsi,
 		goto destroy_seg_obj;
 	}
 
+	si->blk2off_table->parent_si = si;
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("create PEB containers: seg %llu\n", seg);
 #else
@@ -675,6 +686,79 @@ void ssdfs_segment_put_object(struct ssdfs_segment_info *si)
 		wake_up_all(&si->object_queue);
 }
 
+/*
+ * should_ssdfs_segment_be_destroyed() - check necessity to destroy a segment
+ * @si: pointer on segment object
+ *
+ * This method tries to check the necessity to destroy
+ * a segment object.
+ */
+bool should_ssdfs_segment_be_destroyed(struct ssdfs_segment_info *si)
+{
+	struct ssdfs_peb_container *pebc;
+	struct ssdfs_peb_info *pebi;
+	u64 peb_id;
+	bool is_rq_empty;
+	bool is_fq_empty;
+	bool peb_has_dirty_pages = false;
+	bool is_blk_bmap_dirty = false;
+	bool dont_touch = false;
+	int i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!si);
+
+	SSDFS_DBG("seg_id %llu, refs_count %d\n",
+		  si->seg_id,
+		  atomic_read(&si->refs_count));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (atomic_read(&si->refs_count) > 0)
+		return false;
+
+	dont_touch = should_gc_doesnt_touch_segment(si);
+	if (dont_touch)
+		return false;
+
+	for (i = 0; i < si->pebs_count; i++) {
+		pebc = &si->peb_array[i];
+
+		is_rq_empty = is_ssdfs_requests_queue_empty(READ_RQ_PTR(pebc));
+		is_fq_empty = !have_flush_requests(pebc);
+
+		is_blk_bmap_dirty =
+			is_ssdfs_segment_blk_bmap_dirty(&si->blk_bmap, i);
+
+		pebi = ssdfs_get_current_peb_locked(pebc);
+		if (IS_ERR_OR_NULL(pebi))
+			return false;
+
+		ssdfs_peb_current_log_lock(pebi);
+		peb_has_dirty_pages = ssdfs_peb_has_dirty_pages(pebi);
+		peb_id = pebi->peb_id;
+		ssdfs_peb_current_log_unlock(pebi);
+		ssdfs_unlock_current_peb(pebc);
+
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("seg_id %llu, peb_id %llu, refs_count %d, "
+			  "peb_has_dirty_pages %#x, "
+			  "not empty: (read %#x, flush %#x), "
+			  "dont_touch %#x, is_blk_bmap_dirty %#x\n",
+			  si->seg_id, peb_id,
+			  atomic_read(&si->refs_count),
+			  peb_has_dirty_pages,
+			  !is_rq_empty, !is_fq_empty,
+			  dont_touch, is_blk_bmap_dirty);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		if (!is_rq_empty || !is_fq_empty ||
+		    peb_has_dirty_pages || is_blk_bmap_dirty)
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * ssdfs_segment_detect_search_range() - detect search range
  * @fsi: pointer on shared file system object
@@ -920,7 +1004,10 @@ finish_search:
  * @seg_id: found segment ID [out]
  * @seg_state: found segment state [out]
  *
- * This method tries to find a new segment.
+ * This method tries to find a new segment. First of all,
+ * the method tries to claim a clean segment that has been
+ * pre-found by segment bitmap's background thread.
+ * Otherwise, the segment bitmap is searched.
  *
  * RETURN:
  * [success]
@@ -936,6 +1023,8 @@ int ssdfs_find_new_segment(struct ssdfs_fs_info *fsi, int seg_type,
 			   int *seg_state)
 {
 	u64 cur_id = start_search_id;
+	int mask, new_state;
+	int res;
 	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -945,6 +1034,24 @@ int ssdfs_find_new_segment(struct ssdfs_fs_info *fsi, int seg_type,
 		  fsi, seg_type, start_search_id);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	mask = SEG_TYPE2MASK(seg_type);
+	new_state = SEG_TYPE_TO_USING_STATE(seg_type);
+
+	res = ssdfs_segbmap_claim_cached_segment(fsi->segbmap, seg_type,
+						 mask, new_state, seg_id);
+	if (res >= 0) {
+		*seg_state = res;
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("found cached seg_id %llu\n", *seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return 0;
+	} else if (res != -ENODATA) {
+		SSDFS_ERR("fail to claim cached segment: "
+			  "seg_type %#x, err %d\n",
+			  seg_type, res);
+		return res;
+	}
+
 	while (cur_id < fsi->nsegs) {
 		err = __ssdfs_find_new_segment(fsi, seg_type, cur_id,
 						seg_id, seg_state);
@@ -1058,11 +1165,11 @@ __ssdfs_create_new_segment(struct ssdfs_fs_info *fsi,
 
 	err = ssdfs_segment_tree_add(fsi, si);
 	if (err == -EEXIST) {
-		wait_queue_head_t *wq = &si->object_queue;
+		wait_queue_head_t *wq;
 
 		ssdfs_segment_free_object(si);
 
-		si = ssdfs_segment_tree_find(fsi, seg_id);
+		si = ssdfs_segment_tree_find_get(fsi, seg_id);
 		if (IS_ERR_OR_NULL(si)) {
 			SSDFS_ERR("fail to find segment: "
 				  "seg %llu, err %d\n",
@@ -1070,7 +1177,7 @@ __ssdfs_create_new_segment(struct ssdfs_fs_info *fsi,
 			return ERR_PTR(err);
 		}
 
-		ssdfs_segment_get_object(si);
+		wq = &si->object_queue;
 
 		err = wait_event_killable_timeout(*wq,
 				is_ssdfs_segment_created(si),
@@ -1197,7 +1304,7 @@ ssdfs_grab_segment(struct ssdfs_fs_info *fsi, int seg_type, u64 seg_id,
 		}
 	}
 
-	si = ssdfs_segment_tree_find(fsi, seg_id);
+	si = ssdfs_segment_tree_find_get(fsi, seg_id);
 	if (IS_ERR_OR_NULL(si)) {
 		err = PTR_ERR(si);
 
@@ -1310,7 +1417,6 @@ create_segment_object:
 	}
 
 	wq = &si->object_queue;
-	ssdfs_segment_get_object(si);
 
 	switch (atomic_read(&si->obj_state)) {
 	case SSDFS_SEG_OBJECT_CREATED:
@@ -1408,6 +1514,12 @@ int __ssdfs_segment_read_block(struct ssdfs_segment_info *si,
 
 	ssdfs_peb_read_request_cno(pebc);
 
+	err = ssdfs_peb_read_page_by_current_thread(pebc, req);
+	if (!err) {
+		/* request has been processed by current thread */
+		return 0;
+	}
+
 	rq = &pebc->read_rq;
 	ssdfs_requests_queue_add_tail(rq, req);
 
@@ -2491,6 +2603,8 @@ int __ssdfs_segment_add_data_block(struct ssdfs_current_segment *cur_seg,
 	struct ssdfs_segment_info *si;
 	int seg_type;
 	u64 start = U64_MAX;
+	u64 found_seg_id;
+	int attempts = 0;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -2529,6 +2643,9 @@ try_current_segment:
 	if (is_ssdfs_current_segment_empty(cur_seg)) {
 add_new_current_segment:
 		start = cur_seg->seg_id + 1;
+		attempts = 0;
+
+grab_new_segment:
 		si = ssdfs_grab_segment(fsi, seg_type, U64_MAX, start);
 		if (IS_ERR_OR_NULL(si)) {
 			err = (si == NULL ? -ENOMEM : PTR_ERR(si));
@@ -2555,12 +2672,26 @@ add_new_current_segment:
 			goto finish_add_block;
 		}
 
+		found_seg_id = si->seg_id;
 		err = ssdfs_current_segment_add(cur_seg, si);
 		/*
 		 * ssdfs_grab_segment() has got object already.
 		 */
 		ssdfs_segment_put_object(si);
-		if (unlikely(err)) {
+		if (err == -EBUSY) {
+			/*
+			 * Segment is current for another
+			 * current segment container already.
+			 */
+			if (++attempts >= SSDFS_CUR_SEG_GRAB_ATTEMPTS_MAX) {
+				err = -ENOSPC;
+				SSDFS_DBG("unable to find free segment\n");
+				goto finish_add_block;
+			}
+
+			start = found_seg_id + 1;
+			goto grab_new_segment;
+		} else if (unlikely(err)) {
 			SSDFS_ERR("fail to add segment %llu as current: "
 				  "err %d\n",
 				  si->seg_id, err);
@@ -2665,6 +2796,152 @@ finish_add_block:
 	return 0;
 }
 
+/*
+ * ssdfs_define_data_stream() - define user data stream for batch
+ * @batch: dirty pages batch
+ *
+ * This function estimates the temperature of new data. The write
+ * life hint of inode has priority. Otherwise, the history of
+ * data updates of the file is used: the new blocks of frequently
+ * updated file are treated as hot data.
+ */
+static
+int ssdfs_define_data_stream(struct ssdfs_dirty_pages_batch *batch)
+{
+	struct page *page;
+	struct inode *inode;
+
+	if (batch->processed_pages >= pagevec_count(&batch->pvec))
+		return SSDFS_WARM_DATA_STREAM;
+
+	page = batch->pvec.pages[batch->processed_pages];
+	if (!page || !page->mapping)
+		return SSDFS_WARM_DATA_STREAM;
+
+	inode = page->mapping->host;
+
+	switch (inode->i_write_hint) {
+	case WRITE_LIFE_SHORT:
+		return SSDFS_HOT_DATA_STREAM;
+
+	case WRITE_LIFE_LONG:
+	case WRITE_LIFE_EXTREME:
+		return SSDFS_COLD_DATA_STREAM;
+
+	default:
+		/* use update history */
+		break;
+	}
+
+	if (atomic_read(&SSDFS_I(inode)->updates_count) >=
+					SSDFS_HOT_DATA_UPDATES_THRESHOLD)
+		return SSDFS_HOT_DATA_STREAM;
+
+	return SSDFS_WARM_DATA_STREAM;
+}
+
+/*
+ * ssdfs_add_data_into_current_segment() - add data into current segment
+ * @fsi: pointer on shared file system object
+ * @pool: pool of segment requests [in|out]
+ * @batch: dirty pages batch [in|out]
+ * @add_data: method of adding data into current segment
+ *
+ * This function selects the current segment for user data
+ * and tries to add the data into it. If temperature streams are
+ * enabled, then hot and cold data are added into current segments
+ * of these streams. Warm data (or data of full hot/cold stream)
+ * is added into the regular current segment. If per-CPU current segments
+ * are enabled, then CPU's own current segment is used. If CPU's
+ * segment is full and no clean segment can be found, then the function
+ * tries to steal free space of other CPUs' current segments.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOSPC     - segment hasn't free pages.
+ * %-EAGAIN     - request pool is full.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_add_data_into_current_segment(struct ssdfs_fs_info *fsi,
+			struct ssdfs_segment_request_pool *pool,
+			struct ssdfs_dirty_pages_batch *batch,
+			int (*add_data)(struct ssdfs_current_segment *cur_seg,
+					struct ssdfs_segment_request_pool *pool,
+					struct ssdfs_dirty_pages_batch *batch))
+{
+	struct ssdfs_current_segs_array *array;
+	struct ssdfs_current_segment *cur_seg;
+	int cur_seg_type;
+	u32 index;
+	u32 i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !pool || !batch || !add_data);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	array = fsi->cur_segs;
+	cur_seg_type = CUR_SEG_TYPE(pool->req_class);
+
+	down_read(&array->lock);
+
+	if (cur_seg_type == SSDFS_CUR_DATA_SEG &&
+	    is_ssdfs_data_streams_enabled(array)) {
+		int stream = ssdfs_define_data_stream(batch);
+
+		if (stream != SSDFS_WARM_DATA_STREAM) {
+			cur_seg = array->streams[stream];
+			err = add_data(cur_seg, pool, batch);
+			if (err != -ENOSPC)
+				goto finish_add_data;
+
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("data stream %d is full\n", stream);
+#endif /* CONFIG_SSDFS_DEBUG */
+		}
+	}
+
+	cur_seg = ssdfs_current_segment_select(array, cur_seg_type, &index);
+	err = add_data(cur_seg, pool, batch);
+
+	if (err != -ENOSPC)
+		goto finish_add_data;
+
+	if (cur_seg_type != SSDFS_CUR_DATA_SEG ||
+	    !is_ssdfs_percpu_data_segs_enabled(array))
+		goto finish_add_data;
+
+	/*
+	 * CPU's current segment is full and there is
+	 * no clean segment. Try other CPUs' segments.
+	 */
+	for (i = 1; i < array->data_segs_count; i++) {
+		u32 steal_index = (index + i) % array->data_segs_count;
+
+		cur_seg = array->data_segs[steal_index];
+		if (is_ssdfs_current_segment_empty(cur_seg))
+			continue;
+
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("try to steal current segment: "
+			  "index %u, steal_index %u\n",
+			  index, steal_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		err = add_data(cur_seg, pool, batch);
+		if (err != -ENOSPC)
+			break;
+	}
+
+finish_add_data:
+	up_read(&array->lock);
+
+	return err;
+}
+
 /*
  * __ssdfs_segment_add_data_block_sync() - add new data block synchronously
  * @fsi: pointer on shared file system object
@@ -2690,9 +2967,6 @@ int __ssdfs_segment_add_data_block_sync(struct ssdfs_fs_info *fsi,
 					struct ssdfs_segment_request_pool *pool,
 					struct ssdfs_dirty_pages_batch *batch)
 {
-	struct ssdfs_current_segment *cur_seg;
-	int err;
-
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!fsi || !pool || !batch);
 	BUG_ON(pool->req_class <= SSDFS_PEB_READ_REQ ||
@@ -2711,12 +2985,8 @@ int __ssdfs_segment_add_data_block_sync(struct ssdfs_fs_info *fsi,
 	pool->req_command = SSDFS_CREATE_BLOCK;
 	pool->req_type = req_type;
 
-	down_read(&fsi->cur_segs->lock);
-	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(pool->req_class)];
-	err = __ssdfs_segment_add_data_block(cur_seg, pool, batch);
-	up_read(&fsi->cur_segs->lock);
-
-	return err;
+	return ssdfs_add_data_into_current_segment(fsi, pool, batch,
+					__ssdfs_segment_add_data_block);
 }
 
 /*
@@ -2744,9 +3014,6 @@ int __ssdfs_segment_add_data_block_async(struct ssdfs_fs_info *fsi,
 					 struct ssdfs_segment_request_pool *pool,
 					 struct ssdfs_dirty_pages_batch *batch)
 {
-	struct ssdfs_current_segment *cur_seg;
-	int err;
-
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!fsi || !pool || !batch);
 	BUG_ON(req_class <= SSDFS_PEB_READ_REQ ||
@@ -2777,12 +3044,8 @@ int __ssdfs_segment_add_data_block_async(struct ssdfs_fs_info *fsi,
 	pool->req_command = SSDFS_CREATE_BLOCK;
 	pool->req_type = req_type;
 
-	down_read(&fsi->cur_segs->lock);
-	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(pool->req_class)];
-	err = __ssdfs_segment_add_data_block(cur_seg, pool, batch);
-	up_read(&fsi->cur_segs->lock);
-
-	return err;
+	return ssdfs_add_data_into_current_segment(fsi, pool, batch,
+					__ssdfs_segment_add_data_block);
 }
 
 /*
@@ -2915,6 +3178,8 @@ int __ssdfs_segment_add_block(struct ssdfs_current_segment *cur_seg,
 	struct ssdfs_segment_info *si;
 	int seg_type;
 	u64 start = U64_MAX;
+	u64 found_seg_id;
+	int attempts = 0;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -2950,6 +3215,9 @@ try_current_segment:
 	if (is_ssdfs_current_segment_empty(cur_seg)) {
 add_new_current_segment:
 		start = cur_seg->seg_id + 1;
+		attempts = 0;
+
+grab_new_segment:
 		si = ssdfs_grab_segment(cur_seg->fsi, seg_type,
 					U64_MAX, start);
 		if (IS_ERR_OR_NULL(si)) {
@@ -2977,12 +3245,26 @@ add_new_current_segment:
 			goto finish_add_block;
 		}
 
+		found_seg_id = si->seg_id;
 		err = ssdfs_current_segment_add(cur_seg, si);
 		/*
 		 * ssdfs_grab_segment() has got object already.
 		 */
 		ssdfs_segment_put_object(si);
-		if (unlikely(err)) {
+		if (err == -EBUSY) {
+			/*
+			 * Segment is current for another
+			 * current segment container already.
+			 */
+			if (++attempts >= SSDFS_CUR_SEG_GRAB_ATTEMPTS_MAX) {
+				err = -ENOSPC;
+				SSDFS_DBG("unable to find free segment\n");
+				goto finish_add_block;
+			}
+
+			start = found_seg_id + 1;
+			goto grab_new_segment;
+		} else if (unlikely(err)) {
 			SSDFS_ERR("fail to add segment %llu as current: "
 				  "err %d\n",
 				  si->seg_id, err);
@@ -3164,7 +3446,7 @@ int __ssdfs_segment_add_block_sync(struct ssdfs_fs_info *fsi,
 					    SSDFS_CREATE_BLOCK,
 					    req_type, req);
 
-	down_read(&fsi->cur_segs->lock);
+	SSDFS_DOWN_READ(cur_segs, &fsi->cur_segs->lock);
 	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(req_class)];
 	err = __ssdfs_segment_add_block(cur_seg, req, seg_id, extent);
 	up_read(&fsi->cur_segs->lock);
@@ -3229,7 +3511,7 @@ int __ssdfs_segment_add_block_async(struct ssdfs_fs_info *fsi,
 					    SSDFS_CREATE_BLOCK,
 					    req_type, req);
 
-	down_read(&fsi->cur_segs->lock);
+	SSDFS_DOWN_READ(cur_segs, &fsi->cur_segs->lock);
 	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(req_class)];
 	err = __ssdfs_segment_add_block(cur_seg, req, seg_id, extent);
 	up_read(&fsi->cur_segs->lock);
@@ -3452,7 +3734,7 @@ int ssdfs_segment_migrate_zone_block_sync(struct ssdfs_fs_info *fsi,
 					    SSDFS_MIGRATE_ZONE_USER_BLOCK,
 					    req_type, req);
 
-	down_read(&fsi->cur_segs->lock);
+	SSDFS_DOWN_READ(cur_segs, &fsi->cur_segs->lock);
 	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(req_class)];
 	err = __ssdfs_segment_add_block(cur_seg, req, seg_id, extent);
 	up_read(&fsi->cur_segs->lock);
@@ -3514,7 +3796,7 @@ int ssdfs_segment_migrate_zone_block_async(struct ssdfs_fs_info *fsi,
 					    SSDFS_MIGRATE_ZONE_USER_BLOCK,
 					    req_type, req);
 
-	down_read(&fsi->cur_segs->lock);
+	SSDFS_DOWN_READ(cur_segs, &fsi->cur_segs->lock);
 	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(req_class)];
 	err = __ssdfs_segment_add_block(cur_seg, req, seg_id, extent);
 	up_read(&fsi->cur_segs->lock);
@@ -3713,6 +3995,8 @@ int __ssdfs_segment_add_data_extent(struct ssdfs_current_segment *cur_seg,
 	struct ssdfs_segment_info *si;
 	int seg_type;
 	u64 start = U64_MAX;
+	u64 found_seg_id;
+	int attempts = 0;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -3751,6 +4035,9 @@ try_current_segment:
 	if (is_ssdfs_current_segment_empty(cur_seg)) {
 add_new_current_segment:
 		start = cur_seg->seg_id + 1;
+		attempts = 0;
+
+grab_new_segment:
 		si = ssdfs_grab_segment(fsi, seg_type, U64_MAX, start);
 		if (IS_ERR_OR_NULL(si)) {
 			err = (si == NULL ? -ENOMEM : PTR_ERR(si));
@@ -3777,12 +4064,26 @@ add_new_current_segment:
 			goto finish_add_extent;
 		}
 
+		found_seg_id = si->seg_id;
 		err = ssdfs_current_segment_add(cur_seg, si);
 		/*
 		 * ssdfs_grab_segment() has got object already.
 		 */
 		ssdfs_segment_put_object(si);
-		if (unlikely(err)) {
+		if (err == -EBUSY) {
+			/*
+			 * Segment is current for another
+			 * current segment container already.
+			 */
+			if (++attempts >= SSDFS_CUR_SEG_GRAB_ATTEMPTS_MAX) {
+				err = -ENOSPC;
+				SSDFS_DBG("unable to find free segment\n");
+				goto finish_add_extent;
+			}
+
+			start = found_seg_id + 1;
+			goto grab_new_segment;
+		} else if (unlikely(err)) {
 			SSDFS_ERR("fail to add segment %llu as current: "
 				  "err %d\n",
 				  si->seg_id, err);
@@ -3908,9 +4209,6 @@ int __ssdfs_segment_add_data_extent_sync(struct ssdfs_fs_info *fsi,
 					struct ssdfs_segment_request_pool *pool,
 					struct ssdfs_dirty_pages_batch *batch)
 {
-	struct ssdfs_current_segment *cur_seg;
-	int err;
-
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!fsi || !pool || !batch);
 	BUG_ON(pool->req_class <= SSDFS_PEB_READ_REQ ||
@@ -3928,12 +4226,8 @@ int __ssdfs_segment_add_data_extent_sync(struct ssdfs_fs_info *fsi,
 	pool->req_command = SSDFS_CREATE_EXTENT;
 	pool->req_type = SSDFS_REQ_SYNC;
 
-	down_read(&fsi->cur_segs->lock);
-	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(pool->req_class)];
-	err = __ssdfs_segment_add_data_extent(cur_seg, pool, batch);
-	up_read(&fsi->cur_segs->lock);
-
-	return err;
+	return ssdfs_add_data_into_current_segment(fsi, pool, batch,
+					__ssdfs_segment_add_data_extent);
 }
 
 /*
@@ -3957,9 +4251,6 @@ int __ssdfs_segment_add_data_extent_async(struct ssdfs_fs_info *fsi,
 					struct ssdfs_segment_request_pool *pool,
 					struct ssdfs_dirty_pages_batch *batch)
 {
-	struct ssdfs_current_segment *cur_seg;
-	int err;
-
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!fsi || !pool || !batch);
 	BUG_ON(pool->req_class <= SSDFS_PEB_READ_REQ ||
@@ -3977,12 +4268,8 @@ int __ssdfs_segment_add_data_extent_async(struct ssdfs_fs_info *fsi,
 	pool->req_command = SSDFS_CREATE_EXTENT;
 	pool->req_type = SSDFS_REQ_ASYNC;
 
-	down_read(&fsi->cur_segs->lock);
-	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(pool->req_class)];
-	err = __ssdfs_segment_add_data_extent(cur_seg, pool, batch);
-	up_read(&fsi->cur_segs->lock);
-
-	return err;
+	return ssdfs_add_data_into_current_segment(fsi, pool, batch,
+					__ssdfs_segment_add_data_extent);
 }
 
 /*
@@ -4123,6 +4410,8 @@ int __ssdfs_segment_add_extent(struct ssdfs_current_segment *cur_seg,
 	struct ssdfs_segment_info *si;
 	int seg_type;
 	u64 start = U64_MAX;
+	u64 found_seg_id;
+	int attempts = 0;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -4158,6 +4447,9 @@ try_current_segment:
 	if (is_ssdfs_current_segment_empty(cur_seg)) {
 add_new_current_segment:
 		start = cur_seg->seg_id + 1;
+		attempts = 0;
+
+grab_new_segment:
 		si = ssdfs_grab_segment(fsi, seg_type, U64_MAX, start);
 		if (IS_ERR_OR_NULL(si)) {
 			err = (si == NULL ? -ENOMEM : PTR_ERR(si));
@@ -4184,12 +4476,26 @@ add_new_current_segment:
 			goto finish_add_extent;
 		}
 
+		found_seg_id = si->seg_id;
 		err = ssdfs_current_segment_add(cur_seg, si);
 		/*
 		 * ssdfs_grab_segment() has got object already.
 		 */
 		ssdfs_segment_put_object(si);
-		if (unlikely(err)) {
+		if (err == -EBUSY) {
+			/*
+			 * Segment is current for another
+			 * current segment container already.
+			 */
+			if (++attempts >= SSDFS_CUR_SEG_GRAB_ATTEMPTS_MAX) {
+				err = -ENOSPC;
+				SSDFS_DBG("unable to find free segment\n");
+				goto finish_add_extent;
+			}
+
+			start = found_seg_id + 1;
+			goto grab_new_segment;
+		} else if (unlikely(err)) {
 			SSDFS_ERR("fail to add segment %llu as current: "
 				  "err %d\n",
 				  si->seg_id, err);
@@ -4396,7 +4702,7 @@ int __ssdfs_segment_add_extent_sync(struct ssdfs_fs_info *fsi,
 					    SSDFS_REQ_SYNC,
 					    req);
 
-	down_read(&fsi->cur_segs->lock);
+	SSDFS_DOWN_READ(cur_segs, &fsi->cur_segs->lock);
 	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(req_class)];
 	err = __ssdfs_segment_add_extent(cur_seg, req, seg_id, extent);
 	up_read(&fsi->cur_segs->lock);
@@ -4448,7 +4754,7 @@ int __ssdfs_segment_add_extent_async(struct ssdfs_fs_info *fsi,
 					    SSDFS_REQ_ASYNC,
 					    req);
 
-	down_read(&fsi->cur_segs->lock);
+	SSDFS_DOWN_READ(cur_segs, &fsi->cur_segs->lock);
 	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(req_class)];
 	err = __ssdfs_segment_add_extent(cur_seg, req, seg_id, extent);
 	up_read(&fsi->cur_segs->lock);
@@ -4665,7 +4971,7 @@ int ssdfs_segment_migrate_zone_extent_sync(struct ssdfs_fs_info *fsi,
 					    SSDFS_MIGRATE_ZONE_USER_EXTENT,
 					    req_type, req);
 
-	down_read(&fsi->cur_segs->lock);
+	SSDFS_DOWN_READ(cur_segs, &fsi->cur_segs->lock);
 	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(req_class)];
 	err = __ssdfs_segment_add_extent(cur_seg, req, seg_id, extent);
 	up_read(&fsi->cur_segs->lock);
@@ -4727,7 +5033,7 @@ int ssdfs_segment_migrate_zone_extent_async(struct ssdfs_fs_info *fsi,
 					    SSDFS_MIGRATE_ZONE_USER_EXTENT,
 					    req_type, req);
 
-	down_read(&fsi->cur_segs->lock);
+	SSDFS_DOWN_READ(cur_segs, &fsi->cur_segs->lock);
 	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(req_class)];
 	err = __ssdfs_segment_add_extent(cur_seg, req, seg_id, extent);
 	up_read(&fsi->cur_segs->lock);
@@ -4735,6 +5041,66 @@ int ssdfs_segment_migrate_zone_extent_async(struct ssdfs_fs_info *fsi,
 	return err;
 }
 
+/*
+ * ssdfs_segment_relocate_cold_extent_async() - relocate cold extent
+ * @fsi: pointer on shared file system object
+ * @req: segment request [in|out]
+ * @seg_id: segment ID [out]
+ * @extent: (pre-)allocated extent [out]
+ *
+ * This function tries to add user data extent that GC moves out
+ * of victim segment into current segment of cold data stream.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EOPNOTSUPP - temperature data streams are disabled.
+ * %-ENOSPC     - segment hasn't free pages.
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_segment_relocate_cold_extent_async(struct ssdfs_fs_info *fsi,
+					struct ssdfs_segment_request *req,
+					u64 *seg_id,
+					struct ssdfs_blk2off_range *extent)
+{
+	struct ssdfs_current_segs_array *array;
+	struct ssdfs_current_segment *cur_seg;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !req);
+
+	SSDFS_DBG("ino %llu, logical_offset %llu, "
+		  "data_bytes %u, cno %llu, parent_snapshot %llu\n",
+		  req->extent.ino, req->extent.logical_offset,
+		  req->extent.data_bytes, req->extent.cno,
+		  req->extent.parent_snapshot);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	ssdfs_request_prepare_internal_data(SSDFS_PEB_CREATE_DATA_REQ,
+					    SSDFS_CREATE_EXTENT,
+					    SSDFS_REQ_ASYNC,
+					    req);
+
+	array = fsi->cur_segs;
+
+	down_read(&array->lock);
+
+	if (!is_ssdfs_data_streams_enabled(array)) {
+		err = -EOPNOTSUPP;
+		goto finish_relocate_extent;
+	}
+
+	cur_seg = array->streams[SSDFS_COLD_DATA_STREAM];
+	err = __ssdfs_segment_add_extent(cur_seg, req, seg_id, extent);
+
+finish_relocate_extent:
+	up_read(&array->lock);
+
+	return err;
+}
+
 /*
  * ssdfs_segment_add_xattr_blob_sync() - store xattr blob synchronously
  * @fsi: pointer on shared file system object
@@ -4947,20 +5313,525 @@ int ssdfs_segment_add_index_node_extent_async(struct ssdfs_fs_info *fsi,
 						req, seg_id, extent);
 }
 
+/*
+ * ssdfs_segment_vector_extent_blks() - calculate extent's logical blocks
+ * @fsi: pointer on shared file system object
+ * @req: segment request
+ */
 static inline
-int ssdfs_account_user_data_pages_as_pending(struct ssdfs_peb_container *pebc,
-					     u32 count)
+u16 ssdfs_segment_vector_extent_blks(struct ssdfs_fs_info *fsi,
+				     struct ssdfs_segment_request *req)
 {
-	struct ssdfs_fs_info *fsi;
-	u64 updated = 0;
-	u32 pending = 0;
-	int err = 0;
+	u32 extent_bytes = req->extent.data_bytes;
+
+	if (fsi->pagesize > PAGE_SIZE)
+		extent_bytes += fsi->pagesize - 1;
+	else if (fsi->pagesize <= PAGE_SIZE)
+		extent_bytes += PAGE_SIZE - 1;
+
+	return extent_bytes >> fsi->log_pagesize;
+}
+
+/*
+ * ssdfs_segment_vector_grab_current_segment() - grab new current segment
+ * @cur_seg: current segment container
+ * @seg_type: segment type
+ *
+ * This function tries to find a new segment and to make it
+ * the current one for the @cur_seg container.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOSPC     - there is no free segments.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_segment_vector_grab_current_segment(struct ssdfs_current_segment *cur_seg,
+					      int seg_type)
+{
+	struct ssdfs_fs_info *fsi = cur_seg->fsi;
+	struct ssdfs_segment_info *si;
+	u64 start = cur_seg->seg_id + 1;
+	u64 found_seg_id;
+	int attempts = 0;
+	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!pebc);
+	SSDFS_DBG("cur_seg %llu, seg_type %#x\n",
+		  cur_seg->seg_id, seg_type);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	fsi = pebc->parent_si->fsi;
+	do {
+		si = ssdfs_grab_segment(fsi, seg_type, U64_MAX, start);
+		if (IS_ERR_OR_NULL(si)) {
+			err = (si == NULL ? -ENOMEM : PTR_ERR(si));
+			if (err == -ENOSPC) {
+#ifdef CONFIG_SSDFS_DEBUG
+				SSDFS_DBG("unable to create segment object: "
+					  "err %d\n", err);
+#endif /* CONFIG_SSDFS_DEBUG */
+			} else {
+				SSDFS_ERR("fail to create segment object: "
+					  "err %d\n", err);
+			}
+
+			return err;
+		}
+
+		if (cur_seg->seg_id == si->seg_id) {
+			/*
+			 * ssdfs_grab_segment() has got object already.
+			 */
+			ssdfs_segment_put_object(si);
+			SSDFS_DBG("there is no more clean segments\n");
+			return -ENOSPC;
+		}
+
+		found_seg_id = si->seg_id;
+		err = ssdfs_current_segment_add(cur_seg, si);
+		/*
+		 * ssdfs_grab_segment() has got object already.
+		 */
+		ssdfs_segment_put_object(si);
+		if (err == -EBUSY) {
+			/*
+			 * Segment is current for another
+			 * current segment container already.
+			 */
+			start = found_seg_id + 1;
+			continue;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to add segment %llu as current: "
+				  "err %d\n",
+				  found_seg_id, err);
+			return err;
+		}
+
+		return 0;
+	} while (++attempts < SSDFS_CUR_SEG_GRAB_ATTEMPTS_MAX);
+
+	SSDFS_DBG("unable to find free segment\n");
+	return -ENOSPC;
+}
+
+/*
+ * ssdfs_segment_vector_add_into_current() - add vector's extents into segment
+ * @cur_seg: current segment container
+ * @vec: vector of extents' requests [in|out]
+ *
+ * This function reserves logical blocks for all unprocessed
+ * requests of the vector by means of one call, allocates
+ * the extents and adds the requests into the create queue
+ * of the current segment by means of one queue's lock acquiring.
+ * The flush thread is woken up only once. If the segment
+ * is able to store only some part of requests, then
+ * unused reservation is returned back and -ENOSPC is returned.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOSPC     - segment hasn't free pages for the rest of requests.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_segment_vector_add_into_current(struct ssdfs_current_segment *cur_seg,
+					  struct ssdfs_segment_extents_vector *vec)
+{
+	struct ssdfs_fs_info *fsi = cur_seg->fsi;
+	struct ssdfs_segment_info *si = cur_seg->real_seg;
+	struct ssdfs_segment_request_pool *pool = &vec->pool;
+	struct ssdfs_blk2off_table *table;
+	struct ssdfs_segment_request *req;
+	struct ssdfs_blk2off_range *extent;
+	LIST_HEAD(list);
+	u32 requested_blks = 0;
+	u32 reserved_blks = 0;
+	u32 queued = 0;
+	u16 blks_count;
+	int i;
+	int err, err1;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!si);
+
+	SSDFS_DBG("seg %llu, processed %u, count %u\n",
+		  si->seg_id, vec->processed, pool->count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	table = si->blk2off_table;
+
+	for (i = vec->processed; i < pool->count; i++) {
+		req = pool->pointers[i];
+		requested_blks += ssdfs_segment_vector_extent_blks(fsi, req);
+	}
+
+	err = ssdfs_segment_blk_bmap_reserve_extent(&si->blk_bmap,
+						    requested_blks,
+						    &reserved_blks);
+	if (err == -E2BIG) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("segment %llu hasn't enough free pages: "
+			  "requested_blks %u, reserved_blks %u\n",
+			  si->seg_id, requested_blks, reserved_blks);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		if (reserved_blks == 0)
+			return -ENOSPC;
+	} else if (unlikely(err)) {
+		SSDFS_ERR("fail to reserve logical extent: "
+			  "seg %llu, err %d\n",
+			  si->seg_id, err);
+		return err;
+	}
+
+	err = 0;
+
+	for (i = vec->processed; i < pool->count; i++) {
+		req = pool->pointers[i];
+		extent = &vec->extent[i];
+		blks_count = ssdfs_segment_vector_extent_blks(fsi, req);
+
+		if (blks_count > reserved_blks) {
+			err = -ENOSPC;
+			break;
+		}
+
+		err = ssdfs_blk2off_table_allocate_extent(table,
+							  blks_count,
+							  extent);
+		if (err == -EAGAIN) {
+			struct completion *end;
+			end = &table->partial_init_end;
+
+			err = SSDFS_WAIT_COMPLETION(end);
+			if (unlikely(err)) {
+				SSDFS_ERR("blk2off init failed: "
+					  "err %d\n", err);
+				goto cancel_reservation;
+			}
+
+			err = ssdfs_blk2off_table_allocate_extent(table,
+								  blks_count,
+								  extent);
+		}
+
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to allocate logical extent\n");
+			goto cancel_reservation;
+		} else if (extent->len != blks_count) {
+			SSDFS_DBG("unable to allocate: "
+				  "extent (start_lblk %u, len %u), "
+				  "blks_count %u\n",
+				  extent->start_lblk,
+				  extent->len,
+				  blks_count);
+			reserved_blks -= blks_count;
+			err = -ENOSPC;
+			break;
+		}
+
+#ifdef CONFIG_SSDFS_DEBUG
+		BUG_ON(extent->start_lblk >= U16_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		reserved_blks -= blks_count;
+
+		vec->seg_id[i] = si->seg_id;
+		ssdfs_request_define_segment(si->seg_id, req);
+		ssdfs_request_define_volume_extent(extent->start_lblk,
+						   extent->len, req);
+
+		list_add_tail(&req->list, &list);
+		queued++;
+	}
+
+cancel_reservation:
+	if (reserved_blks > 0) {
+		err1 = ssdfs_segment_blk_bmap_cancel_reservation(&si->blk_bmap,
+								reserved_blks);
+		if (unlikely(err1)) {
+			SSDFS_ERR("fail to cancel reservation: "
+				  "seg %llu, reserved_blks %u, err %d\n",
+				  si->seg_id, reserved_blks, err1);
+			if (!err || err == -ENOSPC)
+				err = err1;
+		}
+	}
+
+	if (queued == 0)
+		return err;
+
+	err1 = ssdfs_current_segment_change_state(cur_seg);
+	if (unlikely(err1)) {
+		SSDFS_ERR("fail to change segment state: "
+			  "seg %llu, err %d\n",
+			  si->seg_id, err1);
+		return err1;
+	}
+
+	for (i = 0; i < queued; i++) {
+		ssdfs_account_user_data_flush_request(si);
+		ssdfs_segment_create_request_cno(si);
+	}
+
+	vec->processed += queued;
+
+	ssdfs_requests_queue_add_tail_list_inc(fsi, &si->create_rq,
+						&list, queued);
+	wake_up_all(&si->wait_queue[SSDFS_PEB_FLUSH_THREAD]);
+
+	return err;
+}
+
+/*
+ * __ssdfs_segment_add_extents_vector() - add vector of extents into segment
+ * @cur_seg: current segment container
+ * @vec: vector of extents' requests [in|out]
+ *
+ * This function tries to add all extents of the vector
+ * into the current segment. The new current segment is
+ * grabbed if the vector cannot be stored completely.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOSPC     - segment hasn't free pages.
+ * %-ERANGE     - internal error.
+ */
+static
+int __ssdfs_segment_add_extents_vector(struct ssdfs_current_segment *cur_seg,
+				       struct ssdfs_segment_extents_vector *vec)
+{
+	struct ssdfs_fs_info *fsi;
+	struct ssdfs_segment_request_pool *pool;
+	int seg_type;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!cur_seg || !vec);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+#ifdef CONFIG_SSDFS_TRACK_API_CALL
+	SSDFS_ERR("current segment: type %#x, seg_id %llu, "
+		  "processed %u, count %u\n",
+		  cur_seg->type, cur_seg->seg_id,
+		  vec->processed, vec->pool.count);
+#else
+	SSDFS_DBG("current segment: type %#x, seg_id %llu, "
+		  "processed %u, count %u\n",
+		  cur_seg->type, cur_seg->seg_id,
+		  vec->processed, vec->pool.count);
+#endif /* CONFIG_SSDFS_TRACK_API_CALL */
+
+	fsi = cur_seg->fsi;
+	pool = &vec->pool;
+
+	ssdfs_current_segment_lock(cur_seg);
+
+	seg_type = CHECKED_SEG_TYPE(fsi, SEG_TYPE(pool->req_class));
+
+	while (vec->processed < pool->count) {
+		if (is_ssdfs_current_segment_empty(cur_seg)) {
+			err = ssdfs_segment_vector_grab_current_segment(cur_seg,
+									seg_type);
+			if (err)
+				goto finish_add_vector;
+		}
+
+		err = ssdfs_segment_vector_add_into_current(cur_seg, vec);
+		if (err == -ENOSPC) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("segment %llu hasn't enough free pages\n",
+				  cur_seg->real_seg->seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+			err = ssdfs_remove_current_segment(cur_seg);
+			if (err == -ENOSPC) {
+#ifdef CONFIG_SSDFS_DEBUG
+				SSDFS_DBG("unable to add current segment: "
+					  "err %d\n", err);
+#endif /* CONFIG_SSDFS_DEBUG */
+				goto finish_add_vector;
+			} else if (unlikely(err)) {
+				SSDFS_ERR("fail to remove current segment: "
+					  "seg %llu, err %d\n",
+					  cur_seg->seg_id, err);
+				goto finish_add_vector;
+			}
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to add extents vector: "
+				  "seg %llu, err %d\n",
+				  cur_seg->seg_id, err);
+			goto finish_add_vector;
+		}
+	}
+
+finish_add_vector:
+	ssdfs_current_segment_unlock(cur_seg);
+
+#ifdef CONFIG_SSDFS_TRACK_API_CALL
+	SSDFS_ERR("finished: processed %u, count %u, err %d\n",
+		  vec->processed, pool->count, err);
+#else
+	SSDFS_DBG("finished: processed %u, count %u, err %d\n",
+		  vec->processed, pool->count, err);
+#endif /* CONFIG_SSDFS_TRACK_API_CALL */
+
+	return err;
+}
+
+/*
+ * ssdfs_segment_add_extents_vector() - add vector of extents
+ * @fsi: pointer on shared file system object
+ * @req_class: request class
+ * @req_type: request type
+ * @vec: vector of extents' requests [in|out]
+ *
+ * This function prepares all requests of the vector and
+ * tries to add the extents into the current segment.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ENOSPC     - segment hasn't free pages.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_segment_add_extents_vector(struct ssdfs_fs_info *fsi,
+				     int req_class, int req_type,
+				     struct ssdfs_segment_extents_vector *vec)
+{
+	struct ssdfs_segment_request_pool *pool;
+	struct ssdfs_current_segment *cur_seg;
+	int i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !vec);
+
+	SSDFS_DBG("req_class %#x, req_type %#x, count %u\n",
+		  req_class, req_type, vec->pool.count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	pool = &vec->pool;
+
+	if (req_class < SSDFS_PEB_PRE_ALLOCATE_LNODE_REQ ||
+	    req_class > SSDFS_PEB_CREATE_IDXNODE_REQ) {
+		SSDFS_ERR("unexpected request class %#x\n",
+			  req_class);
+		return -EINVAL;
+	}
+
+	if (pool->count == 0 || pool->count > SSDFS_SEG_REQ_PTR_NUMBER_MAX) {
+		SSDFS_ERR("invalid requests count %u\n",
+			  pool->count);
+		return -EINVAL;
+	}
+
+	pool->req_class = req_class;
+	pool->req_command = SSDFS_CREATE_EXTENT;
+	pool->req_type = req_type;
+
+	for (i = 0; i < pool->count; i++) {
+		struct ssdfs_segment_request *req = pool->pointers[i];
+
+		if (!req) {
+			SSDFS_ERR("empty request: index %d\n", i);
+			return -EINVAL;
+		}
+
+		ssdfs_request_prepare_internal_data(req_class,
+						    SSDFS_CREATE_EXTENT,
+						    req_type,
+						    req);
+
+		vec->seg_id[i] = U64_MAX;
+	}
+
+	vec->processed = 0;
+
+	SSDFS_DOWN_READ(cur_segs, &fsi->cur_segs->lock);
+	cur_seg = fsi->cur_segs->objects[CUR_SEG_TYPE(req_class)];
+	err = __ssdfs_segment_add_extents_vector(cur_seg, vec);
+	up_read(&fsi->cur_segs->lock);
+
+	return err;
+}
+
+/*
+ * ssdfs_segment_add_extents_vector_sync() - add vector of extents
+ * @fsi: pointer on shared file system object
+ * @req_class: request class
+ * @vec: vector of extents' requests [in|out]
+ *
+ * This function tries to add several b-tree nodes' extents
+ * into segment synchronously by means of one call.
+ * The @vec->processed keeps the number of requests that
+ * have been added into the create queues.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ENOSPC     - segment hasn't free pages.
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_segment_add_extents_vector_sync(struct ssdfs_fs_info *fsi,
+				int req_class,
+				struct ssdfs_segment_extents_vector *vec)
+{
+	return ssdfs_segment_add_extents_vector(fsi, req_class,
+						SSDFS_REQ_SYNC, vec);
+}
+
+/*
+ * ssdfs_segment_add_extents_vector_async() - add vector of extents
+ * @fsi: pointer on shared file system object
+ * @req_class: request class
+ * @vec: vector of extents' requests [in|out]
+ *
+ * This function tries to add several b-tree nodes' extents
+ * into segment asynchronously by means of one call.
+ * The @vec->processed keeps the number of requests that
+ * have been added into the create queues.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ENOSPC     - segment hasn't free pages.
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_segment_add_extents_vector_async(struct ssdfs_fs_info *fsi,
+				int req_class,
+				struct ssdfs_segment_extents_vector *vec)
+{
+	return ssdfs_segment_add_extents_vector(fsi, req_class,
+						SSDFS_REQ_ASYNC, vec);
+}
+
+static inline
+int ssdfs_account_user_data_pages_as_pending(struct ssdfs_peb_container *pebc,
+					     u32 count)
+{
+	struct ssdfs_fs_info *fsi;
+	u64 updated = 0;
+	u32 pending = 0;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!pebc);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	fsi = pebc->parent_si->fsi;
 
 	if (!is_ssdfs_peb_containing_user_data(pebc))
 		return 0;
@@ -4970,15 +5841,11 @@ int ssdfs_account_user_data_pages_as_pending(struct ssdfs_peb_container *pebc,
 		  pebc->parent_si->seg_id, pebc->peb_index, count);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	spin_lock(&fsi->volume_state_lock);
-	updated = fsi->updated_user_data_pages;
-	if (fsi->updated_user_data_pages >= count) {
-		fsi->updated_user_data_pages -= count;
-	} else {
+	if (!ssdfs_fs_counter_try_sub(&fsi->updated_user_data_pages, count)) {
 		err = -ERANGE;
-		fsi->updated_user_data_pages = 0;
+		updated = ssdfs_fs_counter_sum(&fsi->updated_user_data_pages);
+		percpu_counter_sub(&fsi->updated_user_data_pages, updated);
 	}
-	spin_unlock(&fsi->volume_state_lock);
 
 	if (err) {
 		SSDFS_WARN("count %u is bigger than updated %llu\n",
@@ -4995,6 +5862,11 @@ int ssdfs_account_user_data_pages_as_pending(struct ssdfs_peb_container *pebc,
 		spin_unlock(&pebc->pending_lock);
 	}
 
+	if (!ssdfs_fs_counter_positive(&fsi->updated_user_data_pages)) {
+		/* no more updated pages: waiting threads can commit logs */
+		ssdfs_segment_tree_wake_up_flush_waiters(fsi);
+	}
+
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("seg_id %llu, peb_index %u, "
 		  "updated %llu, pending %u\n",
@@ -5241,6 +6113,15 @@ int ssdfs_add_request_into_update_queue(struct ssdfs_segment_info *si,
 	}
 
 	pebc = &si->peb_array[peb_index];
+
+	err = ssdfs_peb_container_start_flush_thread(pebc);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to start flush thread: "
+			  "seg %llu, peb_index %u, err %d\n",
+			  si->seg_id, peb_index, err);
+		goto fail_add_request_into_update_queue;
+	}
+
 	update_rq = &pebc->update_rq;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -5268,6 +6149,26 @@ int ssdfs_add_request_into_update_queue(struct ssdfs_segment_info *si,
 		SSDFS_WARN("unexpected len %u\n", len);
 	}
 
+	if (ssdfs_requests_queue_merge_tail(update_rq, req, fsi->pagesize)) {
+		/*
+		 * Request has been merged with the tail
+		 * request of the queue. Forget it in the pool.
+		 */
+		pool->count--;
+		pool->pointers[pool->count] = NULL;
+
+		ssdfs_put_request(req);
+		ssdfs_request_free(req);
+
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("request has been merged: "
+			  "seg %llu, logical_blk %u, len %u\n",
+			  si->seg_id, logical_blk, len);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		goto wake_up_flush_thread;
+	}
+
 	ssdfs_account_user_data_flush_request(si);
 	ssdfs_segment_create_request_cno(si);
 
@@ -5281,6 +6182,7 @@ int ssdfs_add_request_into_update_queue(struct ssdfs_segment_info *si,
 		break;
 	}
 
+wake_up_flush_thread:
 	wait = &si->wait_queue[SSDFS_PEB_FLUSH_THREAD];
 	wake_up_all(wait);
 
@@ -5454,6 +6356,15 @@ int __ssdfs_segment_update_block(struct ssdfs_segment_info *si,
 	}
 
 	pebc = &si->peb_array[peb_index];
+
+	err = ssdfs_peb_container_start_flush_thread(pebc);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to start flush thread: "
+			  "seg %llu, peb_index %u, err %d\n",
+			  si->seg_id, peb_index, err);
+		return err;
+	}
+
 	rq = &pebc->update_rq;
 
 	if (req->private.cmd != SSDFS_COMMIT_LOG_NOW) {
@@ -5776,6 +6687,15 @@ int __ssdfs_segment_update_extent(struct ssdfs_segment_info *si,
 	}
 
 	pebc = &si->peb_array[peb_index];
+
+	err = ssdfs_peb_container_start_flush_thread(pebc);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to start flush thread: "
+			  "seg %llu, peb_index %u, err %d\n",
+			  si->seg_id, peb_index, err);
+		return err;
+	}
+
 	rq = &pebc->update_rq;
 
 	if (req->private.cmd != SSDFS_COMMIT_LOG_NOW) {
@@ -6454,6 +7374,7 @@ int __ssdfs_segment_commit_log2(struct ssdfs_segment_info *si,
 	struct ssdfs_peb_container *pebc;
 	struct ssdfs_requests_queue *rq;
 	wait_queue_head_t *wait;
+	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!si || !req);
@@ -6473,10 +7394,19 @@ int __ssdfs_segment_commit_log2(struct ssdfs_segment_info *si,
 		return -ERANGE;
 	}
 
+	pebc = &si->peb_array[peb_index];
+
+	err = ssdfs_peb_container_start_flush_thread(pebc);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to start flush thread: "
+			  "seg %llu, peb_index %u, err %d\n",
+			  si->seg_id, peb_index, err);
+		return err;
+	}
+
 	ssdfs_account_user_data_flush_request(si);
 	ssdfs_segment_create_request_cno(si);
 
-	pebc = &si->peb_array[peb_index];
 	rq = &pebc->update_rq;
 
 	switch (req->private.class) {
@@ -6737,6 +7667,14 @@ int ssdfs_segment_invalidate_logical_extent(struct ssdfs_segment_info *si,
 			  atomic_read(&si->blk_bmap.seg_invalid_blks));
 #endif /* CONFIG_SSDFS_DEBUG */
 
+		err = ssdfs_peb_container_start_flush_thread(pebc);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to start flush thread: "
+				  "seg %llu, peb_index %u, err %d\n",
+				  si->seg_id, peb_index, err);
+			goto finish_invalidate_block;
+		}
+
 		req = ssdfs_request_alloc();
 		if (IS_ERR_OR_NULL(req)) {
 			err = (req == NULL ? -ENOMEM : PTR_ERR(req));
@@ -6786,6 +7724,123 @@ finish_invalidate_block:
 	return 0;
 }
 
+/*
+ * ssdfs_segment_release_relocated_extent() - release relocated extent
+ * @si: segment info
+ * @peb_index: PEB's index
+ * @start_off: starting logical block
+ * @blks_count: count of logical blocks in the extent
+ *
+ * This function frees the logical blocks of extent that GC has
+ * moved into another segment. The blocks are under migration and
+ * the caller invalidates them in the source PEB's block bitmap.
+ * The caller has to hold the migration lock of PEB container.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_segment_release_relocated_extent(struct ssdfs_segment_info *si,
+					   u16 peb_index,
+					   u32 start_off, u32 blks_count)
+{
+	struct ssdfs_blk2off_table *blk2off_tbl;
+	struct ssdfs_peb_container *pebc;
+	struct ssdfs_segment_request *req;
+	u32 upper_blk = start_off + blks_count;
+	u32 blk;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!si);
+
+	SSDFS_DBG("seg %llu, peb_index %u, start_off %u, blks_count %u\n",
+		  si->seg_id, peb_index, start_off, blks_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (peb_index >= si->pebs_count) {
+		SSDFS_ERR("peb_index %u >= pebs_count %u\n",
+			  peb_index, si->pebs_count);
+		return -ERANGE;
+	}
+
+	if (upper_blk > U16_MAX) {
+		SSDFS_ERR("invalid extent: start_off %u, blks_count %u\n",
+			  start_off, blks_count);
+		return -ERANGE;
+	}
+
+	blk2off_tbl = si->blk2off_table;
+	pebc = &si->peb_array[peb_index];
+
+	for (blk = start_off; blk < upper_blk; blk++) {
+		err = ssdfs_blk2off_table_forget_block_migration(blk2off_tbl,
+								 (u16)blk,
+								 peb_index);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to forget block migration: "
+				  "blk %u, err %d\n",
+				  blk, err);
+			return err;
+		}
+
+		err = ssdfs_blk2off_table_free_block(blk2off_tbl,
+						     peb_index,
+						     (u16)blk);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to free logical block: "
+				  "blk %u, err %d\n",
+				  blk, err);
+			return err;
+		}
+	}
+
+	ssdfs_account_invalidated_user_data_pages(si, blks_count);
+
+	err = ssdfs_peb_container_start_flush_thread(pebc);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to start flush thread: "
+			  "seg %llu, peb_index %u, err %d\n",
+			  si->seg_id, peb_index, err);
+		return err;
+	}
+
+	req = ssdfs_request_alloc();
+	if (IS_ERR_OR_NULL(req)) {
+		err = (req == NULL ? -ENOMEM : PTR_ERR(req));
+		SSDFS_ERR("fail to allocate segment request: err %d\n",
+			  err);
+		return err;
+	}
+
+	ssdfs_request_init(req);
+	ssdfs_get_request(req);
+
+	ssdfs_request_prepare_internal_data(SSDFS_PEB_UPDATE_REQ,
+					    SSDFS_EXTENT_WAS_INVALIDATED,
+					    SSDFS_REQ_ASYNC, req);
+	ssdfs_request_define_segment(si->seg_id, req);
+
+	ssdfs_account_user_data_flush_request(si);
+	ssdfs_segment_create_request_cno(si);
+
+	ssdfs_requests_queue_add_tail_inc(si->fsi, &pebc->update_rq, req);
+	wake_up_all(&si->wait_queue[SSDFS_PEB_FLUSH_THREAD]);
+
+	err = ssdfs_segment_change_state(si);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to change segment state: "
+			  "seg %llu, err %d\n",
+			  si->seg_id, err);
+		return err;
+	}
+
+	return 0;
+}
+
 /*
  * ssdfs_segment_invalidate_logical_block() - invalidate logical block
  * @si: segment info
@@ -72,6 +72,7 @@ struct ssdfs_segment_migration_info {
  * @log_pages: count of pages in full partial log
  * @create_threads: number of flush PEB's threads for new page requests
  * @seg_type: segment type
+ * @node_id: NUMA node of segment's memory and PEBs' threads
  * @protection: segment's protection window
  * @seg_state: current state of segment
  * @obj_state: segment object's state
@@ -81,6 +82,8 @@ struct ssdfs_segment_migration_info {
  * @migration: migration info
  * @refs_count: counter of references on segment object
  * @object_queue: wait queue for segment creation/destruction
+ * @lru: item of segment tree's LRU list
+ * @lru_referenced: segment object has been accessed recently
  * @create_rq: new page requests queue
  * @pending_lock: lock of pending pages' counter
  * @pending_new_user_data_pages: counter of pending new user data pages
@@ -100,6 +103,7 @@ struct ssdfs_segment_info {
 	u16 log_pages;
 	u8 create_threads;
 	u16 seg_type;
+	int node_id;
 
 	/* Checkpoints set */
 	struct ssdfs_protection_window protection;
@@ -120,6 +124,10 @@ struct ssdfs_segment_info {
 	atomic_t refs_count;
 	wait_queue_head_t object_queue;
 
+	/* Segment tree's LRU */
+	struct list_head lru;
+	atomic_t lru_referenced;
+
 	/*
 	 * New pages processing:
 	 * requests queue, wait queue
@@ -166,6 +174,26 @@ enum {
 	SSDFS_SEG_OBJECT_ACTIVITY_TYPE_MAX
 };
 
+/*
+ * struct ssdfs_segment_extents_vector - vector of extents' requests
+ * @pool: pool of prepared requests
+ * @processed: number of processed requests
+ * @seg_id: array of segment IDs [out]
+ * @extent: array of (pre-)allocated extents [out]
+ *
+ * The vector is used to allocate several extents by means of
+ * one call. Every request in the pool describes one extent.
+ * The i-th item of @seg_id and @extent arrays keeps the placement
+ * of the extent of the i-th request in the pool.
+ */
+struct ssdfs_segment_extents_vector {
+	struct ssdfs_segment_request_pool pool;
+	u8 processed;
+
+	u64 seg_id[SSDFS_SEG_REQ_PTR_NUMBER_MAX];
+	struct ssdfs_blk2off_range extent[SSDFS_SEG_REQ_PTR_NUMBER_MAX];
+};
+
 /*
  * Inline functions
  */
@@ -333,6 +361,7 @@ int SEG_TYPE2MASK(int seg_type)
 static inline
 void ssdfs_account_user_data_flush_request(struct ssdfs_segment_info *si)
 {
+	struct percpu_counter *counter;
 	u64 flush_requests = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -340,12 +369,12 @@ void ssdfs_account_user_data_flush_request(struct ssdfs_segment_info *si)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	if (si->seg_type == SSDFS_USER_DATA_SEG_TYPE) {
-		spin_lock(&si->fsi->volume_state_lock);
-		si->fsi->flushing_user_data_requests++;
-		flush_requests = si->fsi->flushing_user_data_requests;
-		spin_unlock(&si->fsi->volume_state_lock);
+		counter = &si->fsi->flushing_user_data_requests;
+
+		percpu_counter_inc(counter);
 
 #ifdef CONFIG_SSDFS_DEBUG
+		flush_requests = ssdfs_fs_counter_read(counter);
 		SSDFS_DBG("seg_id %llu, flush_requests %llu\n",
 			  si->seg_id, flush_requests);
 #endif /* CONFIG_SSDFS_DEBUG */
@@ -355,6 +384,7 @@ void ssdfs_account_user_data_flush_request(struct ssdfs_segment_info *si)
 static inline
 void ssdfs_forget_user_data_flush_request(struct ssdfs_segment_info *si)
 {
+	struct percpu_counter *counter;
 	u64 flush_requests = 0;
 	int err = 0;
 
@@ -363,22 +393,23 @@ void ssdfs_forget_user_data_flush_request(struct ssdfs_segment_info *si)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	if (si->seg_type == SSDFS_USER_DATA_SEG_TYPE) {
-		spin_lock(&si->fsi->volume_state_lock);
-		flush_requests = si->fsi->flushing_user_data_requests;
-		if (flush_requests > 0) {
-			si->fsi->flushing_user_data_requests--;
-			flush_requests = si->fsi->flushing_user_data_requests;
-		} else
+		counter = &si->fsi->flushing_user_data_requests;
+
+		if (!ssdfs_fs_counter_try_sub(counter, 1))
 			err = -ERANGE;
-		spin_unlock(&si->fsi->volume_state_lock);
 
 		if (unlikely(err))
 			SSDFS_WARN("fail to decrement\n");
 
-		if (flush_requests == 0)
+		atomic64_inc(&si->fsi->write_throttle.finished_reqs);
+
+		/* wake up sync_fs() and the throttled writers */
+		if (!ssdfs_fs_counter_positive(counter) ||
+		    wq_has_sleeper(&si->fsi->finish_user_data_flush_wq))
 			wake_up_all(&si->fsi->finish_user_data_flush_wq);
 
 #ifdef CONFIG_SSDFS_DEBUG
+		flush_requests = ssdfs_fs_counter_read(counter);
 		SSDFS_DBG("seg_id %llu, flush_requests %llu\n",
 			  si->seg_id, flush_requests);
 #endif /* CONFIG_SSDFS_DEBUG */
@@ -718,6 +749,7 @@ int ssdfs_segment_create_object(struct ssdfs_fs_info *fsi,
 int ssdfs_segment_destroy_object(struct ssdfs_segment_info *si);
 void ssdfs_segment_get_object(struct ssdfs_segment_info *si);
 void ssdfs_segment_put_object(struct ssdfs_segment_info *si);
+bool should_ssdfs_segment_be_destroyed(struct ssdfs_segment_info *si);
 
 struct ssdfs_segment_info *
 ssdfs_grab_segment(struct ssdfs_fs_info *fsi, int seg_type, u64 seg_id,
@@ -848,6 +880,10 @@ int ssdfs_segment_migrate_zone_extent_async(struct ssdfs_fs_info *fsi,
 					    struct ssdfs_segment_request *req,
 					    u64 *seg_id,
 					    struct ssdfs_blk2off_range *extent);
+int ssdfs_segment_relocate_cold_extent_async(struct ssdfs_fs_info *fsi,
+					struct ssdfs_segment_request *req,
+					u64 *seg_id,
+					struct ssdfs_blk2off_range *extent);
 int ssdfs_segment_add_xattr_blob_sync(struct ssdfs_fs_info *fsi,
 					struct ssdfs_segment_request *req,
 					u64 *seg_id,
@@ -881,6 +917,13 @@ int ssdfs_segment_add_index_node_extent_async(struct ssdfs_fs_info *fsi,
 					u64 *seg_id,
 					struct ssdfs_blk2off_range *extent);
 
+int ssdfs_segment_add_extents_vector_sync(struct ssdfs_fs_info *fsi,
+				int req_class,
+				struct ssdfs_segment_extents_vector *vec);
+int ssdfs_segment_add_extents_vector_async(struct ssdfs_fs_info *fsi,
+				int req_class,
+				struct ssdfs_segment_extents_vector *vec);
+
 int ssdfs_segment_update_data_block_sync(struct ssdfs_segment_info *si,
 					struct ssdfs_segment_request_pool *pool,
 					struct ssdfs_dirty_pages_batch *batch);
@@ -948,6 +991,9 @@ int ssdfs_segment_invalidate_logical_block(struct ssdfs_segment_info *si,
 					   u32 blk_offset);
 int ssdfs_segment_invalidate_logical_extent(struct ssdfs_segment_info *si,
 					    u32 start_off, u32 blks_count);
+int ssdfs_segment_release_relocated_extent(struct ssdfs_segment_info *si,
+					   u16 peb_index,
+					   u32 start_off, u32 blks_count);
 
 int ssdfs_segment_migrate_range_async(struct ssdfs_segment_info *si,
 				      struct ssdfs_segment_request *req);
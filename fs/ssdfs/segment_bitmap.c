@@ -22,6 +22,7 @@
 #include <linux/slab.h>
 #include <linux/pagevec.h>
 #include <linux/wait.h>
+#include <linux/kthread.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -562,6 +563,63 @@ free_fbmaps:
 	return err;
 }
 
+/*
+ * ssdfs_segbmap_restore_fragment_bitmaps() - restore bitmaps from checkpoint
+ * @segbmap: pointer on segment bitmap object
+ *
+ * The checkpoint of clean umount keeps the fragment bitmaps.
+ * The restored bitmaps give the chance to skip the fragments
+ * without requested segment states before the initialization
+ * of the fragments. The initialization sets the bitmaps again
+ * by the state of fragments on the volume.
+ */
+static
+void ssdfs_segbmap_restore_fragment_bitmaps(struct ssdfs_segment_bmap *segbmap)
+{
+	struct ssdfs_mount_checkpoint *ckpt;
+	u8 *bytes;
+	u16 i;
+	int j;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!segbmap || !segbmap->fsi);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	segbmap->fbmap_restored = false;
+
+	ckpt = ssdfs_get_mount_checkpoint(segbmap->fsi);
+	if (!ckpt)
+		return;
+
+	if (!(le16_to_cpu(ckpt->flags) & SSDFS_MOUNT_CHECKPOINT_HAS_SEGBMAP))
+		return;
+
+	if (le16_to_cpu(ckpt->segbmap_fragments) != segbmap->fragments_count) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("ignore checkpoint: fragments %u != %u\n",
+			  le16_to_cpu(ckpt->segbmap_fragments),
+			  segbmap->fragments_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return;
+	}
+
+	for (j = 0; j < SSDFS_CKPT_FBMAPS; j++) {
+		bytes = ckpt->segbmap_fbmap[j];
+
+		for (i = 0; i < segbmap->fragments_count; i++) {
+			if (bytes[i / BITS_PER_BYTE] & BIT(i % BITS_PER_BYTE))
+				bitmap_set(segbmap->fbmap[j], i, 1);
+		}
+	}
+
+	segbmap->fbmap_restored = true;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("fragment bitmaps are restored: fragments_count %u\n",
+		  segbmap->fragments_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+}
+
 /*
  * ssdfs_segbmap_destroy_fragment_bitmaps() - destroy fragment bitmaps
  * @segbmap: pointer on segment bitmap object
@@ -581,6 +639,416 @@ void ssdfs_segbmap_destroy_fragment_bitmaps(struct ssdfs_segment_bmap *segbmap)
 		ssdfs_seg_bmap_kfree(segbmap->fbmap[i]);
 }
 
+/******************************************************************************
+ *                  CACHE OF PRE-FOUND CLEAN SEGMENTS                         *
+ ******************************************************************************/
+
+#define SEG_TYPE2CACHE_INDEX(seg_type) \
+	((seg_type) - SSDFS_LEAF_NODE_SEG_TYPE)
+
+#define SEGBMAP_CACHE_THREAD_WAKE_CONDITION(cache) \
+	(kthread_should_stop() || \
+	 atomic_read(&(cache)->refill_requested) > 0)
+
+/*
+ * ssdfs_segbmap_clean_cache_init() - init cache of clean segments
+ * @segbmap: pointer on segment bitmap object
+ *
+ * Every segment type receives own partition of the volume
+ * as a starting point of the search.
+ */
+static
+void ssdfs_segbmap_clean_cache_init(struct ssdfs_segment_bmap *segbmap)
+{
+	struct ssdfs_segbmap_clean_cache *cache = &segbmap->clean_cache;
+	u64 partition_size;
+	int i;
+
+	spin_lock_init(&cache->lock);
+	atomic_set(&cache->refill_requested, 0);
+	init_waitqueue_head(&cache->wait_queue);
+	cache->thread.task = NULL;
+
+	partition_size = div_u64(segbmap->items_count,
+				 SSDFS_SEGBMAP_CACHE_SEG_TYPES);
+
+	for (i = 0; i < SSDFS_SEGBMAP_CACHE_SEG_TYPES; i++) {
+		cache->count[i] = 0;
+		cache->cursor[i] = partition_size * i;
+	}
+}
+
+/*
+ * is_segment_cached() - check that segment ID is in the cache already
+ * @cache: pointer on cache of clean segments
+ * @seg_id: segment ID
+ *
+ * The caller has to hold the cache's lock.
+ */
+static inline
+bool is_segment_cached(struct ssdfs_segbmap_clean_cache *cache, u64 seg_id)
+{
+	int i, j;
+
+	for (i = 0; i < SSDFS_SEGBMAP_CACHE_SEG_TYPES; i++) {
+		for (j = 0; j < cache->count[i]; j++) {
+			if (cache->seg_id[i][j] == seg_id)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * ssdfs_segbmap_refill_clean_cache() - refill cache for segment type
+ * @segbmap: pointer on segment bitmap object
+ * @index: index of segment type in the cache
+ *
+ * This method searches clean segments in the partition of
+ * segment type and adds the found segment IDs into the cache.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EFAULT     - segbmap has inconsistent state.
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_segbmap_refill_clean_cache(struct ssdfs_segment_bmap *segbmap,
+				     int index)
+{
+	struct ssdfs_segbmap_clean_cache *cache = &segbmap->clean_cache;
+	struct completion *init_end;
+	u64 items_count;
+	u64 start;
+	u64 seg_id;
+	bool wrapped = false;
+	int attempts = 0;
+	int res;
+	int err = 0;
+
+	items_count = segbmap->items_count;
+	if (items_count == 0)
+		return 0;
+
+	while (attempts++ < (SSDFS_SEGBMAP_CACHE_SIZE * 2)) {
+		if (kthread_should_stop())
+			break;
+
+		spin_lock(&cache->lock);
+		if (cache->count[index] >= SSDFS_SEGBMAP_CACHE_SIZE) {
+			spin_unlock(&cache->lock);
+			break;
+		}
+		start = cache->cursor[index];
+		spin_unlock(&cache->lock);
+
+		if (start >= items_count) {
+			if (wrapped)
+				break;
+
+			wrapped = true;
+			start = 0;
+		}
+
+		res = ssdfs_segbmap_find(segbmap, start, items_count,
+					 SSDFS_SEG_CLEAN,
+					 SSDFS_SEG_CLEAN_STATE_FLAG,
+					 &seg_id, &init_end);
+		if (res == -EAGAIN) {
+			err = SSDFS_WAIT_COMPLETION(init_end);
+			if (unlikely(err)) {
+				SSDFS_ERR("segbmap init failed: "
+					  "err %d\n", err);
+				return err;
+			}
+
+			continue;
+		} else if (res == -ENODATA) {
+			spin_lock(&cache->lock);
+			cache->cursor[index] = items_count;
+			spin_unlock(&cache->lock);
+
+			if (wrapped)
+				break;
+
+			continue;
+		} else if (unlikely(res < 0)) {
+			SSDFS_ERR("fail to find clean segment: "
+				  "start %llu, err %d\n",
+				  start, res);
+			return res;
+		}
+
+		spin_lock(&cache->lock);
+		if (!is_segment_cached(cache, seg_id) &&
+		    cache->count[index] < SSDFS_SEGBMAP_CACHE_SIZE) {
+			cache->seg_id[index][cache->count[index]] = seg_id;
+			cache->count[index]++;
+		}
+		cache->cursor[index] = seg_id + 1;
+		spin_unlock(&cache->lock);
+
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("cache index %d, seg_id %llu\n",
+			  index, seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_segbmap_clean_cache_thread_func() - cache thread's function
+ */
+static
+int ssdfs_segbmap_clean_cache_thread_func(void *data)
+{
+	struct ssdfs_segment_bmap *segbmap = data;
+	struct ssdfs_segbmap_clean_cache *cache;
+	int i;
+	int err;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	if (!segbmap) {
+		SSDFS_ERR("segbmap is NULL\n");
+		BUG();
+	}
+
+	SSDFS_DBG("segbmap clean cache thread\n");
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	cache = &segbmap->clean_cache;
+
+repeat:
+	if (kthread_should_stop()) {
+		complete_all(&cache->thread.full_stop);
+		return 0;
+	}
+
+	atomic_set(&cache->refill_requested, 0);
+
+	for (i = 0; i < SSDFS_SEGBMAP_CACHE_SEG_TYPES; i++) {
+		bool need_refill;
+
+		spin_lock(&cache->lock);
+		need_refill = cache->count[i] <
+					SSDFS_SEGBMAP_CACHE_LOW_WATERMARK;
+		spin_unlock(&cache->lock);
+
+		if (!need_refill)
+			continue;
+
+		err = ssdfs_segbmap_refill_clean_cache(segbmap, i);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to refill cache: "
+				  "index %d, err %d\n",
+				  i, err);
+		}
+	}
+
+	wait_event_interruptible(cache->wait_queue,
+				 SEGBMAP_CACHE_THREAD_WAKE_CONDITION(cache));
+	goto repeat;
+}
+
+static
+struct ssdfs_thread_descriptor clean_cache_thread_desc[1] = {
+	{.threadfn = ssdfs_segbmap_clean_cache_thread_func,
+	 .fmt = "ssdfs-segbmap-cache",},
+};
+
+/*
+ * ssdfs_segbmap_start_clean_cache_thread() - start cache's thread
+ * @segbmap: pointer on segment bitmap object
+ *
+ * RETURN:
+ * [success] - thread has been started.
+ * [failure] - error code:
+ *
+ * %-ERANGE     - internal error.
+ */
+static
+int ssdfs_segbmap_start_clean_cache_thread(struct ssdfs_segment_bmap *segbmap)
+{
+	struct ssdfs_segbmap_clean_cache *cache = &segbmap->clean_cache;
+	ssdfs_threadfn threadfn;
+	const char *fmt;
+	int err;
+
+	threadfn = clean_cache_thread_desc[0].threadfn;
+	fmt = clean_cache_thread_desc[0].fmt;
+
+	cache->thread.task = kthread_create(threadfn, segbmap, fmt);
+	if (IS_ERR_OR_NULL(cache->thread.task)) {
+		err = PTR_ERR(cache->thread.task);
+		cache->thread.task = NULL;
+		if (err == -EINTR) {
+			/*
+			 * Ignore this error.
+			 */
+		} else {
+			if (err == 0)
+				err = -ERANGE;
+			SSDFS_ERR("fail to start segbmap cache's thread: "
+				  "err %d\n", err);
+		}
+
+		return err;
+	}
+
+	init_waitqueue_entry(&cache->thread.wait, cache->thread.task);
+	add_wait_queue(&cache->wait_queue, &cache->thread.wait);
+	init_completion(&cache->thread.full_stop);
+
+	wake_up_process(cache->thread.task);
+
+	return 0;
+}
+
+/*
+ * ssdfs_segbmap_stop_clean_cache_thread() - stop cache's thread
+ * @segbmap: pointer on segment bitmap object
+ */
+static
+void ssdfs_segbmap_stop_clean_cache_thread(struct ssdfs_segment_bmap *segbmap)
+{
+	struct ssdfs_segbmap_clean_cache *cache = &segbmap->clean_cache;
+	int err;
+
+	if (!cache->thread.task)
+		return;
+
+	err = kthread_stop(cache->thread.task);
+	if (err == -EINTR) {
+		/*
+		 * Ignore this error.
+		 * The wake_up_process() was never called.
+		 */
+		cache->thread.task = NULL;
+		return;
+	} else if (unlikely(err)) {
+		SSDFS_WARN("thread function had some issue: err %d\n",
+			    err);
+	}
+
+	finish_wait(&cache->wait_queue, &cache->thread.wait);
+	cache->thread.task = NULL;
+
+	err = SSDFS_WAIT_COMPLETION(&cache->thread.full_stop);
+	if (unlikely(err))
+		SSDFS_ERR("stop thread fails: err %d\n", err);
+}
+
+/*
+ * ssdfs_segbmap_claim_cached_segment() - claim pre-found clean segment
+ * @segbmap: pointer on segment bitmap object
+ * @seg_type: segment type
+ * @mask: mask of additonal states that can be retrieved too
+ * @new_state: new state of segment
+ * @seg: claimed segment number [out]
+ *
+ * This method takes segment ID from the cache of pre-found
+ * clean segments and tries to set the segment state as @new_state.
+ * The cached ID could be taken by somebody else already. Such ID
+ * is skipped. The cache's thread is woken up if the number
+ * of cached IDs is low.
+ *
+ * RETURN:
+ * [success] - claimed segment state before changing
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-EFAULT     - segbmap has inconsistent state.
+ * %-ERANGE     - internal error.
+ * %-ENODATA    - cache has no valid segment.
+ */
+int ssdfs_segbmap_claim_cached_segment(struct ssdfs_segment_bmap *segbmap,
+					int seg_type, int mask, int new_state,
+					u64 *seg)
+{
+	struct ssdfs_segbmap_clean_cache *cache;
+	struct completion *init_end;
+	int index;
+	u64 seg_id;
+	u8 count;
+	int res;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!segbmap || !seg);
+
+	SSDFS_DBG("segbmap %p, seg_type %#x, mask %#x, new_state %#x\n",
+		  segbmap, seg_type, mask, new_state);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	*seg = U64_MAX;
+
+	if (seg_type < SSDFS_LEAF_NODE_SEG_TYPE ||
+	    seg_type > SSDFS_LAST_KNOWN_SEG_TYPE) {
+		SSDFS_ERR("unexpected seg_type %#x\n", seg_type);
+		return -EINVAL;
+	}
+
+	cache = &segbmap->clean_cache;
+	index = SEG_TYPE2CACHE_INDEX(seg_type);
+
+	if (!cache->thread.task)
+		return -ENODATA;
+
+	for (;;) {
+		seg_id = U64_MAX;
+
+		spin_lock(&cache->lock);
+		count = cache->count[index];
+		if (count > 0) {
+			/* cached IDs are taken in the order of search */
+			seg_id = cache->seg_id[index][0];
+			memmove(&cache->seg_id[index][0],
+				&cache->seg_id[index][1],
+				(count - 1) * sizeof(u64));
+			cache->count[index] = --count;
+		}
+		spin_unlock(&cache->lock);
+
+		if (count < SSDFS_SEGBMAP_CACHE_LOW_WATERMARK &&
+		    atomic_inc_return(&cache->refill_requested) == 1)
+			wake_up_all(&cache->wait_queue);
+
+		if (seg_id == U64_MAX) {
+			/* cache is empty */
+			break;
+		}
+
+		if (seg_id >= segbmap->items_count)
+			continue;
+
+		res = ssdfs_segbmap_find_and_set(segbmap,
+						 seg_id, seg_id + 1,
+						 SSDFS_SEG_CLEAN, mask,
+						 new_state,
+						 seg, &init_end);
+		if (res >= 0) {
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("claimed seg %llu\n", *seg);
+#endif /* CONFIG_SSDFS_DEBUG */
+			return res;
+		} else if (res == -ENODATA || res == -EAGAIN) {
+			/* segment has been taken already */
+			*seg = U64_MAX;
+			continue;
+		} else {
+			SSDFS_ERR("fail to claim segment: "
+				  "seg %llu, err %d\n",
+				  seg_id, res);
+			return res;
+		}
+	}
+
+	return -ENODATA;
+}
+
 /*
  * ssdfs_segbmap_create() - create segment bitmap object
  * @fsi: file system info object
@@ -706,6 +1174,8 @@ int ssdfs_segbmap_create(struct ssdfs_fs_info *fsi)
 		goto free_segbmap_object;
 	}
 
+	ssdfs_segbmap_restore_fragment_bitmaps(ptr);
+
 	kaddr = ssdfs_seg_bmap_kcalloc(ptr->fragments_count,
 					frag_desc_size, GFP_KERNEL);
 	if (!kaddr) {
@@ -818,6 +1288,20 @@ int ssdfs_segbmap_create(struct ssdfs_fs_info *fsi)
 		goto destroy_seg_objects;
 	}
 
+	ssdfs_segbmap_clean_cache_init(ptr);
+
+	err = ssdfs_segbmap_start_clean_cache_thread(ptr);
+	if (err == -EINTR) {
+		/*
+		 * Ignore this error.
+		 */
+		goto destroy_seg_objects;
+	} else if (unlikely(err)) {
+		SSDFS_ERR("fail to start clean segments cache's thread: "
+			  "err %d\n", err);
+		goto destroy_seg_objects;
+	}
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("DONE: create segment bitmap\n");
 #else
@@ -873,6 +1357,8 @@ void ssdfs_segbmap_destroy(struct ssdfs_fs_info *fsi)
 	if (!fsi->segbmap)
 		return;
 
+	ssdfs_segbmap_stop_clean_cache_thread(fsi->segbmap);
+
 	inode_lock(fsi->segbmap_inode);
 	down_write(&fsi->segbmap->resize_lock);
 	down_write(&fsi->segbmap->search_lock);
@@ -951,6 +1437,59 @@ int ssdfs_segbmap_get_state_from_byte(u8 *byte_ptr, u32 byte_item)
 	return (int)((*byte_ptr >> shift) & SSDFS_SEG_STATE_MASK);
 }
 
+/*
+ * ssdfs_segbmap_count_states() - calculate segments for every state
+ * @desc: fragment descriptor
+ * @kaddr: pointer on fragment's content
+ *
+ * This method calculates the number of segments in every state
+ * for the fragment. The counters are used by search logic
+ * for skipping the fragments without the requested state.
+ */
+static
+void ssdfs_segbmap_count_states(struct ssdfs_segbmap_fragment_desc *desc,
+				void *kaddr)
+{
+	size_t hdr_size = sizeof(struct ssdfs_segbmap_fragment_header);
+	u32 items_per_byte = SSDFS_ITEMS_PER_BYTE(SSDFS_SEG_STATE_BITS);
+	u32 byte_offset;
+	u32 byte_item;
+	u8 *byte_ptr;
+	int state;
+	u16 i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!desc || !kaddr);
+
+	SSDFS_DBG("desc %p, total_segs %u\n",
+		  desc, desc->total_segs);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	memset(desc->state_segs, 0, sizeof(desc->state_segs));
+
+	for (i = 0; i < desc->total_segs; i++) {
+		byte_offset = ssdfs_segbmap_get_item_byte_offset(i);
+
+		if (byte_offset >= PAGE_SIZE) {
+			SSDFS_WARN("invalid byte_offset %u\n",
+				   byte_offset);
+			return;
+		}
+
+		byte_item = i - ((byte_offset - hdr_size) * items_per_byte);
+
+		byte_ptr = (u8 *)kaddr + byte_offset;
+		state = ssdfs_segbmap_get_state_from_byte(byte_ptr, byte_item);
+
+		if (state >= SSDFS_SEG_STATE_MAX) {
+			SSDFS_WARN("unexpected state %#x\n", state);
+			continue;
+		}
+
+		desc->state_segs[state]++;
+	}
+}
+
 /*
  * ssdfs_segbmap_check_fragment_header() - check fragment's header
  * @pebc: pointer on PEB container
@@ -1294,6 +1833,8 @@ int ssdfs_segbmap_fragment_init(struct ssdfs_peb_container *pebc,
 		else
 			bitmap_set(fbmap, sequence_id, 1);
 
+		ssdfs_segbmap_count_states(desc, hdr);
+
 		desc->state = state;
 		kunmap_local(hdr);
 	}
@@ -2381,6 +2922,81 @@ int ssdfs_segbmap_create_checkpoint(struct ssdfs_segment_bmap *segbmap)
 	return 0;
 }
 
+/*
+ * ssdfs_segbmap_prepare_mount_checkpoint() - store fragment bitmaps
+ * @segbmap: pointer on segment bitmap object
+ * @ckpt: checkpoint of clean umount [out]
+ *
+ * This method stores the fragment bitmaps into the checkpoint
+ * of clean umount. All fragments should be initialized and
+ * flushed on the volume.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-E2BIG      - fragment bitmaps don't fit into the checkpoint.
+ * %-EAGAIN     - fragment is not initialized or flushed.
+ */
+int ssdfs_segbmap_prepare_mount_checkpoint(struct ssdfs_segment_bmap *segbmap,
+					struct ssdfs_mount_checkpoint *ckpt)
+{
+	u32 capacity = SSDFS_CKPT_FBMAP_BYTES * BITS_PER_BYTE;
+	u8 *bytes;
+	u16 i;
+	int j;
+	int err = 0;
+
+	BUILD_BUG_ON(SSDFS_SEGBMAP_BAD_FBMAP >= SSDFS_CKPT_FBMAPS);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!segbmap || !ckpt);
+
+	SSDFS_DBG("segbmap %p, fragments_count %u\n",
+		  segbmap, segbmap->fragments_count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (segbmap->fragments_count > capacity)
+		return -E2BIG;
+
+	down_read(&segbmap->search_lock);
+
+	for (i = 0; i < segbmap->fragments_count; i++) {
+		switch (segbmap->desc_array[i].state) {
+		case SSDFS_SEGBMAP_FRAG_INITIALIZED:
+			/* expected state */
+			break;
+
+		default:
+			err = -EAGAIN;
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("fragment %u has state %#x\n",
+				  i, segbmap->desc_array[i].state);
+#endif /* CONFIG_SSDFS_DEBUG */
+			goto finish_prepare_checkpoint;
+		}
+	}
+
+	for (j = 0; j < SSDFS_CKPT_FBMAPS; j++) {
+		bytes = ckpt->segbmap_fbmap[j];
+		memset(bytes, 0, SSDFS_CKPT_FBMAP_BYTES);
+
+		for (i = 0; i < segbmap->fragments_count; i++) {
+			if (!test_bit(i, segbmap->fbmap[j]))
+				continue;
+
+			bytes[i / BITS_PER_BYTE] |= BIT(i % BITS_PER_BYTE);
+		}
+	}
+
+	ckpt->segbmap_fragments = cpu_to_le16(segbmap->fragments_count);
+
+finish_prepare_checkpoint:
+	up_read(&segbmap->search_lock);
+
+	return err;
+}
+
 /*
  * ssdfs_segbmap_flush() - flush segbmap current state
  * @segbmap: pointer on segment bitmap object
@@ -3113,6 +3729,11 @@ void ssdfs_segbmap_correct_fragment_header(struct ssdfs_segment_bmap *segbmap,
 		  fragment->bad_segs);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	BUG_ON(fragment->state_segs[old_state] == 0);
+	fragment->state_segs[old_state]--;
+	BUG_ON((fragment->state_segs[new_state] + 1) == U16_MAX);
+	fragment->state_segs[new_state]++;
+
 	hdr->clean_or_using_segs = cpu_to_le16(fragment->clean_or_using_segs);
 	hdr->used_or_dirty_segs = cpu_to_le16(fragment->used_or_dirty_segs);
 	hdr->bad_segs = cpu_to_le16(fragment->bad_segs);
@@ -3517,6 +4138,15 @@ int ssdfs_segbmap_find_fragment(struct ssdfs_segment_bmap *segbmap,
 			break;
 
 		case SSDFS_SEGBMAP_FRAG_CREATED:
+			if (segbmap->fbmap_restored &&
+			    !test_bit(index, fbmap)) {
+				/*
+				 * Checkpoint of clean umount shows that
+				 * the fragment hasn't requested segments.
+				 */
+				break;
+			}
+
 			/* It needs to wait the fragment's init */
 			err = -EAGAIN;
 			checked_size = index - checking_fragment;
@@ -3657,17 +4287,37 @@ u64 ssdfs_segbmap_correct_search_start(u16 fragment_index,
 	return corrected_value;
 }
 
+/* Segment state for every bit of segment state flags */
+static const int ssdfs_segbmap_flag2state[] = {
+	SSDFS_SEG_CLEAN,
+	SSDFS_SEG_DATA_USING,
+	SSDFS_SEG_LEAF_NODE_USING,
+	SSDFS_SEG_HYBRID_NODE_USING,
+	SSDFS_SEG_INDEX_NODE_USING,
+	SSDFS_SEG_USED,
+	SSDFS_SEG_PRE_DIRTY,
+	SSDFS_SEG_DIRTY,
+	SSDFS_SEG_BAD,
+	SSDFS_SEG_RESERVED,
+};
+
 /*
  * ssdfs_segbmap_define_items_count() - define items count for state/mask
  * @desc: fragment descriptor
  * @state: requested state
  * @mask: requested mask
+ *
+ * This method returns the number of segments in the fragment
+ * that are in @state or in any state of @mask. The fragment
+ * can be skipped by search logic if the number is zero.
  */
 static inline
 u16 ssdfs_segbmap_define_items_count(struct ssdfs_segbmap_fragment_desc *desc,
 				     int state, int mask)
 {
 	int complex_mask;
+	u32 items_count = 0;
+	int i;
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!desc);
@@ -3726,14 +4376,15 @@ u16 ssdfs_segbmap_define_items_count(struct ssdfs_segbmap_fragment_desc *desc,
 		return U16_MAX;
 	}
 
-	if (complex_mask & SSDFS_SEG_CLEAN_USING_MASK)
-		return desc->clean_or_using_segs;
-	else if (complex_mask & SSDFS_SEG_USED_DIRTY_MASK)
-		return desc->used_or_dirty_segs;
-	else if (complex_mask & SSDFS_SEG_BAD_STATE_MASK)
-		return desc->bad_segs;
+	for (i = 0; i < ARRAY_SIZE(ssdfs_segbmap_flag2state); i++) {
+		if (complex_mask & (1 << i)) {
+			int cur_state = ssdfs_segbmap_flag2state[i];
 
-	return U16_MAX;
+			items_count += desc->state_segs[cur_state];
+		}
+	}
+
+	return (u16)min_t(u32, items_count, desc->total_segs);
 }
 
 /*
@@ -3794,6 +4445,71 @@ bool BYTE_CONTAINS_MASK(u8 *value, int mask)
 	return false;
 }
 
+#define SSDFS_SEGBMAP_WORD_LOW_BITS		(0x1111111111111111ULL)
+#define SSDFS_SEGBMAP_WORD_HIGH_BITS		(0x8888888888888888ULL)
+
+/*
+ * WORD_CONTAINS_STATE() - check that 64-bit word contains requested state
+ * @word: analysed word of packed segment states
+ * @state: requested state
+ *
+ * Every state of the word is compared with @state in parallel:
+ * the matched states become zero after XOR and the zero states
+ * are detected by the borrow in the high bit of every state.
+ */
+static inline
+bool WORD_CONTAINS_STATE(u64 word, int state)
+{
+	u64 value;
+
+	BUILD_BUG_ON(SSDFS_SEG_STATE_BITS != 4);
+
+	value = word ^ (SSDFS_SEGBMAP_WORD_LOW_BITS * (u64)state);
+	value = (value - SSDFS_SEGBMAP_WORD_LOW_BITS) & ~value;
+
+	return (value & SSDFS_SEGBMAP_WORD_HIGH_BITS) != 0;
+}
+
+/*
+ * WORD_CONTAINS_STATES() - check that 64-bit word contains any of states
+ * @word: analysed word of packed segment states
+ * @states: bitmap of requested states (bit number is a state)
+ */
+static inline
+bool WORD_CONTAINS_STATES(u64 word, unsigned long states)
+{
+	int state;
+
+	for_each_set_bit(state, &states, SSDFS_SEG_STATE_MAX) {
+		if (WORD_CONTAINS_STATE(word, state))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * ssdfs_segbmap_define_search_states() - define states that search stops on
+ * @state: primary state for search
+ * @mask: mask of additonal states that can be retrieved too
+ */
+static inline
+unsigned long ssdfs_segbmap_define_search_states(int state, int mask)
+{
+	unsigned long states = 0;
+	int i;
+
+	if (state >= SSDFS_SEG_CLEAN && state < SSDFS_SEG_STATE_MAX)
+		states |= 1UL << state;
+
+	for (i = SSDFS_SEG_CLEAN; i < SSDFS_SEG_STATE_MAX; i++) {
+		if (IS_STATE_GOOD_FOR_MASK(mask, i))
+			states |= 1UL << i;
+	}
+
+	return states;
+}
+
 /*
  * FIRST_MASK_IN_BYTE() - determine first item's offset for requested mask
  * @value: pointer on analysed byte
@@ -3878,6 +4594,8 @@ int FIND_FIRST_ITEM_IN_FRAGMENT(struct ssdfs_segbmap_fragment_header *hdr,
 	u32 byte_index, search_bytes;
 	u64 byte_range;
 	u8 start_offset;
+	unsigned long search_states;
+	u64 word;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -3936,10 +4654,27 @@ int FIND_FIRST_ITEM_IN_FRAGMENT(struct ssdfs_segbmap_fragment_header *hdr,
 		start_offset = 0;
 	}
 
+	search_states = ssdfs_segbmap_define_search_states(state, mask);
+
 	for (; byte_index < search_bytes; byte_index++) {
 		u8 *value = fragment + byte_index;
 		u8 found_offset;
 
+		if (start_offset == 0 &&
+		    (byte_index + sizeof(u64)) <= search_bytes) {
+			/*
+			 * Skip the whole word if no state
+			 * in the word can finish the search.
+			 */
+			memcpy(&word, value, sizeof(u64));
+
+			if (!WORD_CONTAINS_STATES(word, search_states)) {
+				byte_index += sizeof(u64) - 1;
+				err = -ENODATA;
+				continue;
+			}
+		}
+
 		err = FIND_FIRST_ITEM_IN_BYTE(value, state,
 					      SSDFS_SEG_STATE_BITS,
 					      SSDFS_SEG_STATE_MASK,
@@ -4438,6 +5173,7 @@ int ssdfs_segbmap_find(struct ssdfs_segment_bmap *segbmap,
 			int state, int mask,
 			u64 *seg, struct completion **end)
 {
+	ktime_t start_time = ktime_get();
 	u64 items_count;
 	u16 fragment_size;
 	int err = 0;
@@ -4502,6 +5238,9 @@ finish_search_preparation:
 	up_read(&segbmap->resize_lock);
 	inode_unlock_shared(segbmap->fsi->segbmap_inode);
 
+	ssdfs_account_lookup(segbmap->fsi, SSDFS_LOOKUP_SEGBMAP,
+			     start_time, err);
+
 	return err;
 }
 
@@ -76,6 +76,7 @@ enum {
  * @clean_or_using_segs: count of clean or using segments in fragment
  * @used_or_dirty_segs: count of used, pre-dirty, dirty or reserved segments
  * @bad_segs: count of bad segments in fragment
+ * @state_segs: count of segments in fragment for every state
  * @init_end: wait of init ending
  * @flush_req1: main flush request
  * @flush_req2: backup flush request
@@ -86,6 +87,7 @@ struct ssdfs_segbmap_fragment_desc {
 	u16 clean_or_using_segs;
 	u16 used_or_dirty_segs;
 	u16 bad_segs;
+	u16 state_segs[SSDFS_SEG_STATE_MAX];
 	struct completion init_end;
 	struct ssdfs_segment_request flush_req1;
 	struct ssdfs_segment_request flush_req2;
@@ -110,6 +112,42 @@ enum {
 	SSDFS_SEGBMAP_FBMAP_TYPE_MAX,
 };
 
+/*
+ * Cache of pre-found clean segments
+ */
+#define SSDFS_SEGBMAP_CACHE_SEG_TYPES \
+	(SSDFS_LAST_KNOWN_SEG_TYPE - SSDFS_LEAF_NODE_SEG_TYPE + 1)
+#define SSDFS_SEGBMAP_CACHE_SIZE		(8)
+#define SSDFS_SEGBMAP_CACHE_LOW_WATERMARK	(2)
+
+/*
+ * struct ssdfs_segbmap_clean_cache - cache of pre-found clean segments
+ * @lock: cache's lock
+ * @count: number of cached segment IDs for every segment type
+ * @seg_id: cached segment IDs for every segment type
+ * @cursor: search position in the partition of segment type
+ * @refill_requested: thread has to refill the cache
+ * @wait_queue: wait queue of cache's thread
+ * @thread: descriptor of cache's thread
+ *
+ * The background thread searches clean segments and keeps
+ * several IDs for every segment type. Every segment type has
+ * own partition of the volume where the search starts. It
+ * decreases the contention of segment types for the same fragments
+ * of segment bitmap. The cached IDs are only hints. The state of
+ * segment is not changed until the segment is claimed.
+ */
+struct ssdfs_segbmap_clean_cache {
+	spinlock_t lock;
+	u8 count[SSDFS_SEGBMAP_CACHE_SEG_TYPES];
+	u64 seg_id[SSDFS_SEGBMAP_CACHE_SEG_TYPES][SSDFS_SEGBMAP_CACHE_SIZE];
+	u64 cursor[SSDFS_SEGBMAP_CACHE_SEG_TYPES];
+
+	atomic_t refill_requested;
+	wait_queue_head_t wait_queue;
+	struct ssdfs_thread_info thread;
+};
+
 /*
  * struct ssdfs_segment_bmap - segments bitmap
  * @resize_lock: lock for possible resize operation
@@ -125,8 +163,10 @@ enum {
  * @segs: array of pointers on segment objects
  * @search_lock: lock for search and change state operations
  * @fbmap: array of fragment bitmaps
+ * @fbmap_restored: fragment bitmaps are restored from mount checkpoint
  * @desc_array: array of fragments' descriptors
  * @pages: memory pages of the whole segment bitmap
+ * @clean_cache: cache of pre-found clean segments
  * @fsi: pointer on shared file system object
  */
 struct ssdfs_segment_bmap {
@@ -146,9 +186,12 @@ struct ssdfs_segment_bmap {
 
 	struct rw_semaphore search_lock;
 	unsigned long *fbmap[SSDFS_SEGBMAP_FBMAP_TYPE_MAX];
+	bool fbmap_restored;
 	struct ssdfs_segbmap_fragment_desc *desc_array;
 	struct address_space pages;
 
+	struct ssdfs_segbmap_clean_cache clean_cache;
+
 	struct ssdfs_fs_info *fsi;
 };
 
@@ -432,6 +475,8 @@ int ssdfs_segbmap_fragment_init(struct ssdfs_peb_container *pebc,
 				struct page *page,
 				int state);
 int ssdfs_segbmap_flush(struct ssdfs_segment_bmap *segbmap);
+int ssdfs_segbmap_prepare_mount_checkpoint(struct ssdfs_segment_bmap *segbmap,
+					struct ssdfs_mount_checkpoint *ckpt);
 int ssdfs_segbmap_resize(struct ssdfs_segment_bmap *segbmap,
 			 u64 new_items_count);
 
@@ -455,5 +500,8 @@ int ssdfs_segbmap_find_and_set(struct ssdfs_segment_bmap *segbmap,
 int ssdfs_segbmap_reserve_clean_segment(struct ssdfs_segment_bmap *segbmap,
 					u64 start, u64 max,
 					u64 *seg, struct completion **end);
+int ssdfs_segbmap_claim_cached_segment(struct ssdfs_segment_bmap *segbmap,
+					int seg_type, int mask, int new_state,
+					u64 *seg);
 
 #endif /* _SSDFS_SEGMENT_BITMAP_H */
@@ -164,6 +164,7 @@ int ssdfs_segment_blk_bmap_create(struct ssdfs_segment_info *si,
 	atomic_set(&bmap->seg_invalid_blks, 0);
 	atomic_set(&bmap->seg_free_blks, 0);
 	atomic_set(&bmap->seg_reserved_metapages, 0);
+	bmap->last_invalidation = jiffies;
 
 	bmap->pebs_count = si->pebs_count;
 
@@ -505,7 +506,7 @@ finish_define_bmap_index:
 				TASK_UNINTERRUPTIBLE);
 		schedule();
 		finish_wait(&pebc->migration_wq, &wait);
-		down_read(&pebc->lock);
+		SSDFS_DOWN_READ(pebc, &pebc->lock);
 		mutex_lock(&pebc->migration_lock);
 		goto try_define_bmap_index;
 	} else if (unlikely(err)) {
@@ -539,7 +540,7 @@ bool has_ssdfs_segment_blk_bmap_initialized(struct ssdfs_segment_blk_bmap *ptr,
 		return false;
 	}
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 	if (pebc->dst_peb)
 		peb_index = pebc->dst_peb->peb_index;
 	else
@@ -577,7 +578,7 @@ int ssdfs_segment_blk_bmap_wait_init_end(struct ssdfs_segment_blk_bmap *ptr,
 		return -ERANGE;
 	}
 
-	down_read(&pebc->lock);
+	SSDFS_DOWN_READ(pebc, &pebc->lock);
 	if (pebc->dst_peb)
 		peb_index = pebc->dst_peb->peb_index;
 	else
@@ -775,9 +776,6 @@ int ssdfs_segment_blk_bmap_reserve_extent(struct ssdfs_segment_blk_bmap *ptr,
 	reserved_threshold = (u32)ptr->pebs_count *
 				SSDFS_RESERVED_FREE_PAGE_THRESHOLD_PER_PEB;
 
-	down_write(&ptr->modification_lock);
-
-	free_blks = atomic_read(&ptr->seg_free_blks);
 	reserved_metapages = atomic_read(&ptr->seg_reserved_metapages);
 
 	if (reserved_threshold < reserved_metapages)
@@ -785,28 +783,32 @@ int ssdfs_segment_blk_bmap_reserve_extent(struct ssdfs_segment_blk_bmap *ptr,
 	else
 		reserved_threshold -= reserved_metapages;
 
-	if (free_blks <= reserved_threshold) {
+	/*
+	 * The reservation doesn't need the modification lock.
+	 * The free blocks counter is decreased atomically and
+	 * it never drops below the threshold. The block bitmap
+	 * is changed later by pre-allocation or allocation only.
+	 */
+	free_blks = ssdfs_segment_blk_bmap_take_free_blks(&ptr->seg_free_blks,
+							  reserved_threshold,
+							  count);
+	if (free_blks <= 0) {
 		err = -E2BIG;
 
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("segment %llu hasn't enough free pages: "
-			  "free_pages %u, reserved_threshold %u\n",
-			  ptr->parent_si->seg_id, free_blks,
+			  "free_pages %d, reserved_threshold %u\n",
+			  ptr->parent_si->seg_id,
+			  atomic_read(&ptr->seg_free_blks),
 			  reserved_threshold);
 #endif /* CONFIG_SSDFS_DEBUG */
-	} else {
-		free_blks -= reserved_threshold;
+	} else if (free_blks < count) {
+		*reserved_blks = free_blks;
 
-		if (free_blks < count) {
-			if (si->seg_type == SSDFS_USER_DATA_SEG_TYPE) {
-				err = -EAGAIN;
-				*reserved_blks = free_blks;
-				atomic_sub(*reserved_blks, &ptr->seg_free_blks);
-			} else {
-				err = -E2BIG;
-				*reserved_blks = free_blks;
-				atomic_sub(*reserved_blks, &ptr->seg_free_blks);
-			}
+		if (si->seg_type == SSDFS_USER_DATA_SEG_TYPE)
+			err = -EAGAIN;
+		else
+			err = -E2BIG;
 
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("segment %llu hasn't enough free pages: "
@@ -815,13 +817,8 @@ int ssdfs_segment_blk_bmap_reserve_extent(struct ssdfs_segment_blk_bmap *ptr,
 			  ptr->parent_si->seg_id, free_blks,
 			  count, *reserved_blks);
 #endif /* CONFIG_SSDFS_DEBUG */
-		} else {
-			*reserved_blks = count;
-			atomic_sub(*reserved_blks, &ptr->seg_free_blks);
-		}
-	}
-
-	up_write(&ptr->modification_lock);
+	} else
+		*reserved_blks = count;
 
 	if (err == -EAGAIN) {
 		/*
@@ -837,18 +834,17 @@ int ssdfs_segment_blk_bmap_reserve_extent(struct ssdfs_segment_blk_bmap *ptr,
 		goto finish_reserve_extent;
 
 	if (si->seg_type == SSDFS_USER_DATA_SEG_TYPE) {
+		struct percpu_counter *counter;
 		u64 reserved = 0;
 		u32 pending = 0;
 
-		spin_lock(&fsi->volume_state_lock);
-		reserved = fsi->reserved_new_user_data_pages;
-		if (fsi->reserved_new_user_data_pages >= *reserved_blks) {
-			fsi->reserved_new_user_data_pages -= *reserved_blks;
-		} else
+		counter = &fsi->reserved_new_user_data_pages;
+
+		if (!ssdfs_fs_counter_try_sub(counter, *reserved_blks))
 			err1 = -ERANGE;
-		spin_unlock(&fsi->volume_state_lock);
 
 		if (err1) {
+			reserved = ssdfs_fs_counter_sum(counter);
 			err = err1;
 			SSDFS_ERR("count %u is bigger than reserved %llu\n",
 				  *reserved_blks, reserved);
@@ -879,6 +875,56 @@ finish_reserve_extent:
 	return err;
 }
 
+/*
+ * ssdfs_segment_blk_bmap_cancel_reservation() - cancel blocks reservation
+ * @ptr: segment block bitmap object
+ * @count: number of reserved logical blocks
+ *
+ * This function returns the reserved but not used logical
+ * blocks into the pool of free blocks. It is used by batched
+ * allocation of metadata extents only.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - internal error.
+ */
+int ssdfs_segment_blk_bmap_cancel_reservation(struct ssdfs_segment_blk_bmap *ptr,
+					      u32 count)
+{
+	struct ssdfs_segment_info *si;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!ptr || !ptr->parent_si);
+
+	SSDFS_DBG("seg_id %llu, count %u\n",
+		  ptr->parent_si->seg_id, count);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	si = ptr->parent_si;
+
+	if (atomic_read(&ptr->state) != SSDFS_SEG_BLK_BMAP_CREATED) {
+		SSDFS_ERR("invalid segment block bitmap state %#x\n",
+			  atomic_read(&ptr->state));
+		return -ERANGE;
+	}
+
+	if (si->seg_type == SSDFS_USER_DATA_SEG_TYPE) {
+		SSDFS_ERR("unable to cancel reservation: "
+			  "seg_id %llu, seg_type %#x\n",
+			  si->seg_id, si->seg_type);
+		return -ERANGE;
+	}
+
+	if (count == 0)
+		return 0;
+
+	atomic_add(count, &ptr->seg_free_blks);
+
+	return 0;
+}
+
 /*
  * ssdfs_segment_blk_bmap_reserve_block() - reserve free block
  * @ptr: segment block bitmap object
@@ -1355,7 +1401,7 @@ finish_define_bmap_index:
 				TASK_UNINTERRUPTIBLE);
 		schedule();
 		finish_wait(&pebc->migration_wq, &wait);
-		down_read(&pebc->lock);
+		SSDFS_DOWN_READ(pebc, &pebc->lock);
 		mutex_lock(&pebc->migration_lock);
 		goto try_define_bmap_index;
 	} else if (unlikely(err)) {
@@ -1521,3 +1567,49 @@ finish_define_bmap_index:
 
 	return 0;
 }
+
+/*
+ * ssdfs_segment_blk_bmap_compact() - compact idle block bitmaps of segment
+ * @ptr: segment block bitmap object
+ * @force: compact block bitmaps independently from idle time
+ *
+ * This method tries to compact the block bitmaps of segment's
+ * PEBs that haven't been accessed for a long time.
+ *
+ * RETURN:
+ * [success] - number of compacted block bitmaps.
+ * [failure] - error code:
+ *
+ * %-ERANGE     - internal error.
+ * %-ENOMEM     - unable to allocate memory.
+ */
+int ssdfs_segment_blk_bmap_compact(struct ssdfs_segment_blk_bmap *ptr,
+				   bool force)
+{
+	int compacted = 0;
+	int i;
+	int res;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!ptr || !ptr->parent_si);
+
+	SSDFS_DBG("seg_id %llu\n", ptr->parent_si->seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (atomic_read(&ptr->state) != SSDFS_SEG_BLK_BMAP_CREATED)
+		return -ERANGE;
+
+	for (i = 0; i < ptr->pebs_count; i++) {
+		res = ssdfs_peb_blk_bmap_compact(&ptr->peb[i], force);
+		if (unlikely(res < 0)) {
+			SSDFS_ERR("fail to compact PEB's block bitmap: "
+				  "seg_id %llu, peb_index %d, err %d\n",
+				  ptr->parent_si->seg_id, i, res);
+			return res;
+		}
+
+		compacted += res;
+	}
+
+	return compacted;
+}
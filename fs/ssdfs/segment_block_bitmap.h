@@ -34,6 +34,7 @@
  * @seg_invalid_blks: segment's invalid logical blocks count
  * @seg_free_blks: segment's free logical blocks count
  * @seg_reserved_metapages: number of reserved metapages
+ * @last_invalidation: time of the latest invalidation (jiffies)
  * @peb: array of PEB block bitmap objects
  * @pebs_count: PEBs count in segment
  * @parent_si: pointer on parent segment object
@@ -49,6 +50,7 @@ struct ssdfs_segment_blk_bmap {
 	atomic_t seg_invalid_blks;
 	atomic_t seg_free_blks;
 	atomic_t seg_reserved_metapages;
+	unsigned long last_invalidation;
 
 	struct ssdfs_peb_blk_bmap *peb;
 	u16 pebs_count;
@@ -97,6 +99,8 @@ int ssdfs_segment_blk_bmap_free_metapages(struct ssdfs_segment_blk_bmap *ptr,
 int ssdfs_segment_blk_bmap_reserve_block(struct ssdfs_segment_blk_bmap *ptr);
 int ssdfs_segment_blk_bmap_reserve_extent(struct ssdfs_segment_blk_bmap *ptr,
 					  u32 count, u32 *reserved_blks);
+int ssdfs_segment_blk_bmap_cancel_reservation(struct ssdfs_segment_blk_bmap *ptr,
+					      u32 count);
 int ssdfs_segment_blk_bmap_pre_allocate(struct ssdfs_segment_blk_bmap *ptr,
 					struct ssdfs_peb_container *pebc,
 					u32 *len,
@@ -110,6 +114,39 @@ int ssdfs_segment_blk_bmap_update_range(struct ssdfs_segment_blk_bmap *ptr,
 				    u8 peb_migration_id,
 				    int range_state,
 				    struct ssdfs_block_bmap_range *range);
+int ssdfs_segment_blk_bmap_compact(struct ssdfs_segment_blk_bmap *ptr,
+				   bool force);
+
+/*
+ * ssdfs_segment_blk_bmap_take_free_blks() - take blocks from free pool
+ * @free_blks: counter of free blocks
+ * @threshold: number of free blocks that cannot be taken
+ * @count: requested number of blocks
+ *
+ * This function atomically decreases @free_blks by @count or
+ * by the available number of blocks above @threshold.
+ * The counter never drops below @threshold by this function.
+ * It doesn't require the modification lock.
+ *
+ * RETURN: number of taken blocks.
+ */
+static inline
+int ssdfs_segment_blk_bmap_take_free_blks(atomic_t *free_blks,
+					  int threshold, int count)
+{
+	int old_value = atomic_read(free_blks);
+	int taken;
+
+	do {
+		if (old_value <= threshold || count <= 0)
+			return 0;
+
+		taken = min_t(int, count, old_value - threshold);
+	} while (!atomic_try_cmpxchg(free_blks, &old_value,
+				     old_value - taken));
+
+	return taken;
+}
 
 static inline
 int ssdfs_segment_blk_bmap_get_free_pages(struct ssdfs_segment_blk_bmap *ptr)
@@ -21,6 +21,8 @@
 
 #include <linux/slab.h>
 #include <linux/pagevec.h>
+#include <linux/xarray.h>
+#include <linux/list_lru.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -100,70 +102,6 @@ void ssdfs_seg_tree_check_memory_leaks(void)
  *                        SEGMENTS TREE FUNCTIONALITY                         *
  ******************************************************************************/
 
-static
-void ssdfs_segment_tree_invalidate_folio(struct folio *folio, size_t offset,
-					 size_t length)
-{
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("do nothing: offset %zu, length %zu\n",
-		  offset, length);
-#endif /* CONFIG_SSDFS_DEBUG */
-}
-
-/*
- * ssdfs_segment_tree_release_folio() - Release fs-specific metadata on a folio.
- * @folio: The folio which the kernel is trying to free.
- * @gfp: Memory allocation flags (and I/O mode).
- *
- * The address_space is trying to release any data attached to a folio
- * (presumably at folio->private).
- *
- * This will also be called if the private_2 flag is set on a page,
- * indicating that the folio has other metadata associated with it.
- *
- * The @gfp argument specifies whether I/O may be performed to release
- * this page (__GFP_IO), and whether the call may block
- * (__GFP_RECLAIM & __GFP_FS).
- *
- * Return: %true if the release was successful, otherwise %false.
- */
-static
-bool ssdfs_segment_tree_release_folio(struct folio *folio, gfp_t gfp)
-{
-	return false;
-}
-
-static
-bool ssdfs_segment_tree_noop_dirty_folio(struct address_space *mapping,
-					 struct folio *folio)
-{
-	return true;
-}
-
-const struct address_space_operations ssdfs_segment_tree_aops = {
-	.invalidate_folio	= ssdfs_segment_tree_invalidate_folio,
-	.release_folio		= ssdfs_segment_tree_release_folio,
-	.dirty_folio		= ssdfs_segment_tree_noop_dirty_folio,
-};
-
-/*
- * ssdfs_segment_tree_mapping_init() - segment tree's mapping init
- */
-static inline
-void ssdfs_segment_tree_mapping_init(struct address_space *mapping,
-				     struct inode *inode)
-{
-	address_space_init_once(mapping);
-	mapping->a_ops = &ssdfs_segment_tree_aops;
-	mapping->host = inode;
-	mapping->flags = 0;
-	atomic_set(&mapping->i_mmap_writable, 0);
-	mapping_set_gfp_mask(mapping, GFP_KERNEL | __GFP_ZERO);
-	mapping->private_data = NULL;
-	mapping->writeback_index = 0;
-	inode->i_mapping = mapping;
-}
-
 static const struct inode_operations def_segment_tree_ino_iops;
 static const struct file_operations def_segment_tree_ino_fops;
 static const struct address_space_operations def_segment_tree_ino_aops;
@@ -225,6 +163,287 @@ int ssdfs_create_segment_tree_inode(struct ssdfs_fs_info *fsi)
 	return 0;
 }
 
+/*
+ * ssdfs_segment_tree_lru_isolate() - isolate idle segment object
+ * @item: LRU item of segment object
+ * @list: LRU list
+ * @lock: LRU list's lock
+ * @cb_arg: dispose list
+ *
+ * This method moves the idle segment object into dispose list.
+ * The segment object that has users or has been accessed
+ * recently gets the second chance.
+ */
+static
+enum lru_status ssdfs_segment_tree_lru_isolate(struct list_head *item,
+						struct list_lru_one *list,
+						spinlock_t *lock,
+						void *cb_arg)
+{
+	struct ssdfs_segment_info *si;
+	struct list_head *dispose = cb_arg;
+
+	si = list_entry(item, struct ssdfs_segment_info, lru);
+
+	if (atomic_read(&si->refs_count) > 0)
+		return LRU_ROTATE;
+
+	if (atomic_read(&si->obj_state) != SSDFS_SEG_OBJECT_CREATED)
+		return LRU_ROTATE;
+
+	if (atomic_xchg(&si->lru_referenced, 0) != 0)
+		return LRU_ROTATE;
+
+	list_lru_isolate_move(list, item, dispose);
+	return LRU_REMOVED;
+}
+
+/*
+ * ssdfs_segment_tree_evict_object() - evict idle segment object
+ * @fsi: pointer on shared file system object
+ * @si: pointer on segment object
+ *
+ * This method tries to exclude the idle segment object
+ * from the tree. The caller has to hold the eviction lock.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EBUSY    - segment object is in use.
+ */
+static
+int ssdfs_segment_tree_evict_object(struct ssdfs_fs_info *fsi,
+				    struct ssdfs_segment_info *si)
+{
+	struct xarray *objects = &fsi->segs_tree->objects;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!mutex_is_locked(&fsi->segs_tree->evict_lock));
+
+	SSDFS_DBG("seg_id %llu, refs_count %d\n",
+		  si->seg_id, atomic_read(&si->refs_count));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!should_ssdfs_segment_be_destroyed(si))
+		return -EBUSY;
+
+	/*
+	 * ssdfs_segment_tree_find_get() increments
+	 * the reference counter under the xarray's lock.
+	 */
+	xa_lock(objects);
+	if (atomic_read(&si->refs_count) > 0 ||
+	    xa_load(objects, si->seg_id) != si)
+		err = -EBUSY;
+	else
+		__xa_erase(objects, si->seg_id);
+	xa_unlock(objects);
+
+	return err;
+}
+
+/*
+ * ssdfs_segment_tree_count() - count segment objects in LRU
+ * @shrink: shrinker object
+ * @sc: shrink control
+ */
+static
+unsigned long ssdfs_segment_tree_count(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	struct ssdfs_segment_tree *tree;
+	unsigned long count;
+
+	tree = container_of(shrink, struct ssdfs_segment_tree, shrinker);
+	count = list_lru_count(&tree->lru);
+
+	return count ? count : SHRINK_EMPTY;
+}
+
+/*
+ * ssdfs_segment_tree_scan() - evict idle segment objects
+ * @shrink: shrinker object
+ * @sc: shrink control
+ *
+ * This method walks through LRU of segment objects and
+ * destroys the idle ones. The segment object is idle if
+ * nobody keeps the reference on it, it is out of protection
+ * window and it hasn't any requests or dirty state.
+ */
+static
+unsigned long ssdfs_segment_tree_scan(struct shrinker *shrink,
+				       struct shrink_control *sc)
+{
+	struct ssdfs_segment_tree *tree;
+	struct ssdfs_segment_info *si, *tmp;
+	LIST_HEAD(dispose);
+	LIST_HEAD(evicted);
+	unsigned long scanned = 0;
+	unsigned long busy = 0;
+	unsigned long freed = 0;
+	int err;
+
+	tree = container_of(shrink, struct ssdfs_segment_tree, shrinker);
+
+	if (!(sc->gfp_mask & __GFP_FS))
+		return SHRINK_STOP;
+
+	if (!mutex_trylock(&tree->evict_lock))
+		return SHRINK_STOP;
+
+	list_lru_walk(&tree->lru, ssdfs_segment_tree_lru_isolate,
+		      &dispose, sc->nr_to_scan);
+
+	list_for_each_entry_safe(si, tmp, &dispose, lru) {
+		list_del_init(&si->lru);
+
+		scanned++;
+
+		err = ssdfs_segment_tree_evict_object(si->fsi, si);
+		if (err) {
+			list_lru_add(&tree->lru, &si->lru);
+			busy++;
+			continue;
+		}
+
+		/*
+		 * Prevent from error of creation
+		 * the same segment in another thread.
+		 */
+		ssdfs_sysfs_delete_seg_group(si);
+
+		list_add_tail(&si->lru, &evicted);
+	}
+
+	mutex_unlock(&tree->evict_lock);
+
+	if (list_empty(&evicted)) {
+		ssdfs_account_reclaim(tree->fsi, SSDFS_RECLAIM_SEG_OBJECTS,
+				      scanned, 0, busy);
+		return 0;
+	}
+
+	/* wait the end of RCU lookups */
+	synchronize_rcu();
+
+	list_for_each_entry_safe(si, tmp, &evicted, lru) {
+		list_del_init(&si->lru);
+
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("evict segment object: seg_id %llu\n",
+			  si->seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+		err = ssdfs_segment_destroy_object(si);
+		if (err) {
+			SSDFS_WARN("fail to destroy: "
+				   "seg %llu, err %d\n",
+				   si->seg_id, err);
+			continue;
+		}
+
+		freed++;
+	}
+
+	ssdfs_account_reclaim(tree->fsi, SSDFS_RECLAIM_SEG_OBJECTS,
+			      scanned, freed, busy);
+
+	return freed;
+}
+
+/*
+ * ssdfs_segment_tree_bmap_count() - count segments with block bitmaps
+ * @shrink: shrinker object
+ * @sc: shrink control
+ */
+static
+unsigned long ssdfs_segment_tree_bmap_count(struct shrinker *shrink,
+					    struct shrink_control *sc)
+{
+	struct ssdfs_segment_tree *tree;
+	unsigned long count;
+
+	tree = container_of(shrink, struct ssdfs_segment_tree, bmap_shrinker);
+	count = list_lru_count(&tree->lru);
+
+	return count ? count : SHRINK_EMPTY;
+}
+
+/*
+ * ssdfs_segment_tree_bmap_scan() - compact block bitmaps of segments
+ * @shrink: shrinker object
+ * @sc: shrink control
+ *
+ * The segment objects that are in use cannot be evicted.
+ * But clean block bitmaps of their PEBs can be compacted
+ * independently from the idle time. The compacted block
+ * bitmap is restored on the next access. The method walks
+ * through the segment objects in round-robin manner.
+ */
+static
+unsigned long ssdfs_segment_tree_bmap_scan(struct shrinker *shrink,
+					   struct shrink_control *sc)
+{
+	struct ssdfs_segment_tree *tree;
+	struct ssdfs_segment_info *si;
+	struct xarray *objects;
+	unsigned long index;
+	unsigned long scanned = 0;
+	unsigned long freed = 0;
+	int res;
+
+	tree = container_of(shrink, struct ssdfs_segment_tree, bmap_shrinker);
+	objects = &tree->objects;
+
+	if (!(sc->gfp_mask & __GFP_FS))
+		return SHRINK_STOP;
+
+	index = tree->compact_cursor;
+
+	while (scanned < sc->nr_to_scan) {
+		xa_lock(objects);
+		si = xa_find(objects, &index, ULONG_MAX, XA_PRESENT);
+		if (si)
+			ssdfs_segment_get_object(si);
+		xa_unlock(objects);
+
+		if (!si) {
+			if (tree->compact_cursor == 0)
+				break;
+
+			/* start from the beginning */
+			tree->compact_cursor = 0;
+			index = 0;
+			continue;
+		}
+
+		scanned++;
+
+		res = ssdfs_segment_blk_bmap_compact(&si->blk_bmap, true);
+		if (res > 0)
+			freed += res;
+
+		ssdfs_segment_put_object(si);
+
+		index++;
+		tree->compact_cursor = index;
+	}
+
+	sc->nr_scanned = scanned;
+
+	ssdfs_account_reclaim(tree->fsi, SSDFS_RECLAIM_BLK_BMAPS,
+			      scanned, freed, 0);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("scanned %lu, compacted %lu\n",
+		  scanned, freed);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return freed;
+}
+
 /*
  * ssdfs_segment_tree_create() - create segments tree
  * @fsi: pointer on shared file system object
@@ -283,134 +502,68 @@ int ssdfs_segment_tree_create(struct ssdfs_fs_info *fsi)
 	fsi->segs_tree->user_data_log_pages =
 		le16_to_cpu(fsi->vh->user_data_log_pages);
 	fsi->segs_tree->default_log_pages = SSDFS_LOG_PAGES_DEFAULT;
+	fsi->segs_tree->fsi = fsi;
 
-	ssdfs_segment_tree_mapping_init(&fsi->segs_tree->pages,
-					fsi->segs_tree_inode);
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("DONE: create segment tree\n");
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	return 0;
+	xa_init(&fsi->segs_tree->objects);
+	mutex_init(&fsi->segs_tree->evict_lock);
 
-free_memory:
-	ssdfs_seg_tree_kfree(fsi->segs_tree);
-	fsi->segs_tree = NULL;
-
-	return err;
-}
-
-/*
- * ssdfs_segment_tree_destroy_objects_in_page() - destroy objects in page
- * @fsi: pointer on shared file system object
- * @page: pointer on memory page
- */
-static
-void ssdfs_segment_tree_destroy_objects_in_page(struct ssdfs_fs_info *fsi,
-						struct page *page)
-{
-	struct ssdfs_segment_info **kaddr;
-	size_t ptr_size = sizeof(struct ssdfs_segment_info *);
-	size_t ptrs_per_page = PAGE_SIZE / ptr_size;
-	int i;
-
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!page || !fsi || !fsi->segs_tree);
-
-	SSDFS_DBG("page %p\n", page);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	ssdfs_lock_page(page);
-
-	kaddr = (struct ssdfs_segment_info **)kmap_local_page(page);
-
-	for (i = 0; i < ptrs_per_page; i++) {
-		struct ssdfs_segment_info *si = *(kaddr + i);
-
-		if (si) {
-			wait_queue_head_t *wq = &si->object_queue;
-			int err = 0;
-
-#ifdef CONFIG_SSDFS_DEBUG
-			SSDFS_DBG("si %p, seg_id %llu\n", si, si->seg_id);
-#endif /* CONFIG_SSDFS_DEBUG */
+	err = list_lru_init(&fsi->segs_tree->lru);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to initialize segments LRU: "
+			  "err %d\n", err);
+		goto destroy_inode;
+	}
 
-			if (atomic_read(&si->refs_count) > 0) {
-				ssdfs_unlock_page(page);
-
-				err = wait_event_killable_timeout(*wq,
-					atomic_read(&si->refs_count) <= 0,
-					SSDFS_DEFAULT_TIMEOUT);
-				if (err < 0)
-					WARN_ON(err < 0);
-				else
-					err = 0;
-
-				ssdfs_lock_page(page);
-			}
-
-			err = ssdfs_segment_destroy_object(si);
-			if (err) {
-				SSDFS_WARN("fail to destroy segment object: "
-					   "seg %llu, err %d\n",
-					   si->seg_id, err);
-			}
-		}
+	fsi->segs_tree->shrinker.count_objects = ssdfs_segment_tree_count;
+	fsi->segs_tree->shrinker.scan_objects = ssdfs_segment_tree_scan;
+	fsi->segs_tree->shrinker.seeks = DEFAULT_SEEKS;
 
+	err = register_shrinker(&fsi->segs_tree->shrinker,
+				"ssdfs-segs:%s", fsi->sb->s_id);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to register segments shrinker: "
+			  "err %d\n", err);
+		goto destroy_lru;
 	}
 
-	kunmap_local(kaddr);
+	fsi->segs_tree->compact_cursor = 0;
+	fsi->segs_tree->bmap_shrinker.count_objects =
+					ssdfs_segment_tree_bmap_count;
+	fsi->segs_tree->bmap_shrinker.scan_objects =
+					ssdfs_segment_tree_bmap_scan;
+	fsi->segs_tree->bmap_shrinker.seeks = DEFAULT_SEEKS;
 
-	__ssdfs_clear_dirty_page(page);
-
-	ssdfs_unlock_page(page);
-	ssdfs_put_page(page);
+	err = register_shrinker(&fsi->segs_tree->bmap_shrinker,
+				"ssdfs-blkbmap:%s", fsi->sb->s_id);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to register block bitmaps shrinker: "
+			  "err %d\n", err);
+		goto unregister_shrinker;
+	}
 
 #ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("page %p, count %d\n",
-		  page, page_ref_count(page));
-	SSDFS_DBG("page_index %ld, flags %#lx\n",
-		  page->index, page->flags);
+	SSDFS_DBG("DONE: create segment tree\n");
 #endif /* CONFIG_SSDFS_DEBUG */
-}
 
-/*
- * ssdfs_segment_tree_destroy_objects_in_array() - destroy objects in array
- * @fsi: pointer on shared file system object
- * @array: pointer on array of pages
- * @pages_count: count of pages in array
- */
-static
-void ssdfs_segment_tree_destroy_objects_in_array(struct ssdfs_fs_info *fsi,
-						 struct page **array,
-						 size_t pages_count)
-{
-	struct page *page;
-	int i;
+	return 0;
 
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!array || !fsi);
+unregister_shrinker:
+	unregister_shrinker(&fsi->segs_tree->shrinker);
 
-	SSDFS_DBG("array %p, pages_count %zu\n",
-		  array, pages_count);
-#endif /* CONFIG_SSDFS_DEBUG */
+destroy_lru:
+	list_lru_destroy(&fsi->segs_tree->lru);
 
-	for (i = 0; i < pages_count; i++) {
-		page = array[i];
+destroy_inode:
+	iput(fsi->segs_tree_inode);
+	fsi->segs_tree_inode = NULL;
 
-		if (!page) {
-			SSDFS_WARN("page pointer is NULL: "
-				   "index %d\n",
-				   i);
-			continue;
-		}
+free_memory:
+	ssdfs_seg_tree_kfree(fsi->segs_tree);
+	fsi->segs_tree = NULL;
 
-		ssdfs_segment_tree_destroy_objects_in_page(fsi, page);
-	}
+	return err;
 }
 
-#define SSDFS_MEM_PAGE_ARRAY_SIZE	(16)
-
 /*
  * ssdfs_segment_tree_destroy_segment_objects() - destroy all segment objects
  * @fsi: pointer on shared file system object
@@ -418,10 +571,8 @@ void ssdfs_segment_tree_destroy_objects_in_array(struct ssdfs_fs_info *fsi,
 static
 void ssdfs_segment_tree_destroy_segment_objects(struct ssdfs_fs_info *fsi)
 {
-	pgoff_t start = 0;
-	pgoff_t end = -1;
-	size_t pages_count = 0;
-	struct page *array[SSDFS_MEM_PAGE_ARRAY_SIZE] = {0};
+	struct ssdfs_segment_info *si;
+	unsigned long index;
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!fsi || !fsi->segs_tree);
@@ -429,30 +580,34 @@ void ssdfs_segment_tree_destroy_segment_objects(struct ssdfs_fs_info *fsi)
 	SSDFS_DBG("fsi %p\n", fsi);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	do {
-		pages_count = find_get_pages_range_tag(&fsi->segs_tree->pages,
-					    &start, end,
-					    PAGECACHE_TAG_DIRTY,
-					    SSDFS_MEM_PAGE_ARRAY_SIZE,
-					    &array[0]);
+	xa_for_each(&fsi->segs_tree->objects, index, si) {
+		wait_queue_head_t *wq = &si->object_queue;
+		int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("start %lu, pages_count %zu\n",
-			  start, pages_count);
+		SSDFS_DBG("si %p, seg_id %llu\n", si, si->seg_id);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-		if (pages_count != 0) {
-			ssdfs_segment_tree_destroy_objects_in_array(fsi,
-								&array[0],
-								pages_count);
-
-#ifdef CONFIG_SSDFS_DEBUG
-			BUG_ON(!array[pages_count - 1]);
-#endif /* CONFIG_SSDFS_DEBUG */
+		xa_erase(&fsi->segs_tree->objects, index);
+		list_lru_del(&fsi->segs_tree->lru, &si->lru);
+
+		if (atomic_read(&si->refs_count) > 0) {
+			err = wait_event_killable_timeout(*wq,
+				atomic_read(&si->refs_count) <= 0,
+				SSDFS_DEFAULT_TIMEOUT);
+			if (err < 0)
+				WARN_ON(err < 0);
+			else
+				err = 0;
+		}
 
-			start = page_index(array[pages_count - 1]) + 1;
+		err = ssdfs_segment_destroy_object(si);
+		if (err) {
+			SSDFS_WARN("fail to destroy segment object: "
+				   "seg %llu, err %d\n",
+				   si->seg_id, err);
 		}
-	} while (pages_count != 0);
+	}
 }
 
 /*
@@ -467,14 +622,15 @@ void ssdfs_segment_tree_destroy(struct ssdfs_fs_info *fsi)
 	SSDFS_DBG("fsi %p\n", fsi);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	inode_lock(fsi->segs_tree_inode);
+	unregister_shrinker(&fsi->segs_tree->bmap_shrinker);
+	unregister_shrinker(&fsi->segs_tree->shrinker);
 
+	mutex_lock(&fsi->segs_tree->evict_lock);
 	ssdfs_segment_tree_destroy_segment_objects(fsi);
+	mutex_unlock(&fsi->segs_tree->evict_lock);
 
-	if (fsi->segs_tree->pages.nrpages != 0)
-		truncate_inode_pages(&fsi->segs_tree->pages, 0);
-
-	inode_unlock(fsi->segs_tree_inode);
+	xa_destroy(&fsi->segs_tree->objects);
+	list_lru_destroy(&fsi->segs_tree->lru);
 
 	iput(fsi->segs_tree_inode);
 	ssdfs_seg_tree_kfree(fsi->segs_tree);
@@ -499,10 +655,6 @@ void ssdfs_segment_tree_destroy(struct ssdfs_fs_info *fsi)
 int ssdfs_segment_tree_add(struct ssdfs_fs_info *fsi,
 			   struct ssdfs_segment_info *si)
 {
-	pgoff_t page_index;
-	u32 object_index;
-	struct page *page;
-	struct ssdfs_segment_info **kaddr, *object;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -512,54 +664,22 @@ int ssdfs_segment_tree_add(struct ssdfs_fs_info *fsi,
 		  fsi, si, si->seg_id);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	page_index = div_u64_rem(si->seg_id, SSDFS_SEG_OBJ_PTR_PER_PAGE,
-				 &object_index);
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("page_index %lu, object_index %u\n",
-		  page_index, object_index);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	inode_lock(fsi->segs_tree_inode);
-
-	page = grab_cache_page(&fsi->segs_tree->pages, page_index);
-	if (!page) {
-		err = -ENOMEM;
-		SSDFS_ERR("fail to grab page: page_index %lu\n",
-			  page_index);
-		goto finish_add_segment;
-	}
-
-	ssdfs_account_locked_page(page);
-
-	kaddr = (struct ssdfs_segment_info **)kmap_local_page(page);
-	object = *(kaddr + object_index);
-	if (object) {
+	err = xa_insert(&fsi->segs_tree->objects, si->seg_id,
+			si, GFP_KERNEL);
+	if (err == -EBUSY) {
 		err = -EEXIST;
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("object exists for segment %llu\n",
 			  si->seg_id);
 #endif /* CONFIG_SSDFS_DEBUG */
-	} else
-		*(kaddr + object_index) = si;
-	kunmap_local(kaddr);
-
-	SetPageUptodate(page);
-	if (!PageDirty(page))
-		ssdfs_set_page_dirty(page);
-
-	ssdfs_unlock_page(page);
-	ssdfs_put_page(page);
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("page %p, count %d\n",
-		  page, page_ref_count(page));
-	SSDFS_DBG("page_index %ld, flags %#lx\n",
-		  page->index, page->flags);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-finish_add_segment:
-	inode_unlock(fsi->segs_tree_inode);
+	} else if (unlikely(err)) {
+		SSDFS_ERR("fail to add segment object: "
+			  "seg %llu, err %d\n",
+			  si->seg_id, err);
+	} else {
+		atomic_set(&si->lru_referenced, 1);
+		list_lru_add(&fsi->segs_tree->lru, &si->lru);
+	}
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("finished\n");
@@ -574,7 +694,7 @@ finish_add_segment:
  * @si: pointer on segment object
  *
  * This method tries to remove the valid pointer on segment
- * object from the tree.
+ * object from the tree. The caller has to hold the eviction lock.
  *
  * RETURN:
  * [success]
@@ -585,65 +705,37 @@ finish_add_segment:
 int ssdfs_segment_tree_remove(struct ssdfs_fs_info *fsi,
 			      struct ssdfs_segment_info *si)
 {
-	pgoff_t page_index;
-	u32 object_index;
-	struct page *page;
-	struct ssdfs_segment_info **kaddr, *object;
+	struct ssdfs_segment_info *object;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!fsi || !fsi->segs_tree || !si);
+	BUG_ON(!mutex_is_locked(&fsi->segs_tree->evict_lock));
 
 	SSDFS_DBG("fsi %p, si %p, seg %llu\n",
 		  fsi, si, si->seg_id);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	page_index = div_u64_rem(si->seg_id, SSDFS_SEG_OBJ_PTR_PER_PAGE,
-				 &object_index);
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("page_index %lu, object_index %u\n",
-		  page_index, object_index);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	inode_lock(fsi->segs_tree_inode);
-
-	page = find_lock_page(&fsi->segs_tree->pages, page_index);
-	if (!page) {
-		err = -ENODATA;
-		SSDFS_ERR("failed to remove segment object: "
-			  "seg %llu\n",
-			  si->seg_id);
+	object = xa_cmpxchg(&fsi->segs_tree->objects, si->seg_id,
+			    si, NULL, GFP_KERNEL);
+	if (xa_is_err(object)) {
+		err = xa_err(object);
+		SSDFS_ERR("fail to remove segment object: "
+			  "seg %llu, err %d\n",
+			  si->seg_id, err);
 		goto finish_remove_segment;
-	}
-
-	ssdfs_account_locked_page(page);
-	kaddr = (struct ssdfs_segment_info **)kmap_local_page(page);
-	object = *(kaddr + object_index);
-	if (!object) {
+	} else if (object != si) {
 		err = -ENODATA;
 		SSDFS_WARN("object ptr is NULL: "
 			   "seg %llu\n",
 			   si->seg_id);
-	} else {
-#ifdef CONFIG_SSDFS_DEBUG
-		BUG_ON(object != si);
-#endif /* CONFIG_SSDFS_DEBUG */
-		*(kaddr + object_index) = NULL;
+		goto finish_remove_segment;
 	}
-	kunmap_local(kaddr);
 
-	SetPageUptodate(page);
-	if (!PageDirty(page))
-		ssdfs_set_page_dirty(page);
+	list_lru_del(&fsi->segs_tree->lru, &si->lru);
 
-	ssdfs_unlock_page(page);
-	ssdfs_put_page(page);
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("page %p, count %d\n",
-		  page, page_ref_count(page));
-#endif /* CONFIG_SSDFS_DEBUG */
+	/* wait the end of RCU lookups */
+	synchronize_rcu();
 
 	/*
 	 * Prevent from error of creation
@@ -652,8 +744,6 @@ int ssdfs_segment_tree_remove(struct ssdfs_fs_info *fsi,
 	ssdfs_sysfs_delete_seg_group(si);
 
 finish_remove_segment:
-	inode_unlock(fsi->segs_tree_inode);
-
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("finished\n");
 #endif /* CONFIG_SSDFS_DEBUG */
@@ -667,7 +757,10 @@ finish_remove_segment:
  * @seg_id: segment number
  *
  * This method tries to find the valid pointer on segment
- * object for @seg_id.
+ * object for @seg_id. The lookup is lockless (RCU-protected).
+ * The found object isn't pinned by the reference counter.
+ * So, the caller has to hold the eviction lock or it needs
+ * to use ssdfs_segment_tree_find_get().
  *
  * RETURN:
  * [success] - pointer on found segment object
@@ -679,10 +772,7 @@ finish_remove_segment:
 struct ssdfs_segment_info *
 ssdfs_segment_tree_find(struct ssdfs_fs_info *fsi, u64 seg_id)
 {
-	pgoff_t page_index;
-	u32 object_index;
-	struct page *page;
-	struct ssdfs_segment_info **kaddr, *object;
+	struct ssdfs_segment_info *object;
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!fsi || !fsi->segs_tree);
@@ -697,53 +787,163 @@ ssdfs_segment_tree_find(struct ssdfs_fs_info *fsi, u64 seg_id)
 		  fsi, seg_id);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	page_index = div_u64_rem(seg_id, SSDFS_SEG_OBJ_PTR_PER_PAGE,
-				 &object_index);
+	rcu_read_lock();
+	object = xa_load(&fsi->segs_tree->objects, seg_id);
+	if (object)
+		atomic_set(&object->lru_referenced, 1);
+	rcu_read_unlock();
 
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("page_index %lu, object_index %u\n",
-		  page_index, object_index);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	inode_lock_shared(fsi->segs_tree_inode);
-
-	page = find_lock_page(&fsi->segs_tree->pages, page_index);
-	if (!page) {
+	if (!object) {
 		object = ERR_PTR(-ENODATA);
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("unable to find segment object: "
 			  "seg %llu\n",
 			  seg_id);
 #endif /* CONFIG_SSDFS_DEBUG */
-		goto finish_find_segment;
 	}
 
-	ssdfs_account_locked_page(page);
-	kaddr = (struct ssdfs_segment_info **)kmap_local_page(page);
-	object = *(kaddr + object_index);
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("finished\n");
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return object;
+}
+
+/*
+ * ssdfs_segment_tree_find_get() - find segment object and get reference
+ * @fsi: pointer on shared file system object
+ * @seg_id: segment number
+ *
+ * This method tries to find the valid pointer on segment
+ * object for @seg_id and to increment the reference counter
+ * of found object. The reference is taken under the xarray's
+ * lock. It guarantees that the object cannot be evicted
+ * in parallel.
+ *
+ * RETURN:
+ * [success] - pointer on found segment object
+ * [failure] - error code:
+ *
+ * %-EINVAL   - invalid input.
+ * %-ENODATA  - segment tree hasn't object for @seg_id.
+ */
+struct ssdfs_segment_info *
+ssdfs_segment_tree_find_get(struct ssdfs_fs_info *fsi, u64 seg_id)
+{
+	struct xarray *objects;
+	struct ssdfs_segment_info *object;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !fsi->segs_tree);
+
+	if (seg_id >= fsi->nsegs) {
+		SSDFS_ERR("seg_id %llu >= fsi->nsegs %llu\n",
+			  seg_id, fsi->nsegs);
+		return ERR_PTR(-EINVAL);
+	}
+
+	SSDFS_DBG("fsi %p, seg_id %llu\n",
+		  fsi, seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	objects = &fsi->segs_tree->objects;
+
+	xa_lock(objects);
+	object = xa_load(objects, seg_id);
+	if (object) {
+		ssdfs_segment_get_object(object);
+		atomic_set(&object->lru_referenced, 1);
+	}
+	xa_unlock(objects);
+
 	if (!object) {
-		object = ERR_PTR(-ENODATA);
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("unable to find segment object: "
 			  "seg %llu\n",
 			  seg_id);
 #endif /* CONFIG_SSDFS_DEBUG */
+		return ERR_PTR(-ENODATA);
 	}
-	kunmap_local(kaddr);
-	ssdfs_unlock_page(page);
-	ssdfs_put_page(page);
 
+	return object;
+}
+
+/*
+ * ssdfs_segment_tree_lock_eviction() - prevent segment objects eviction
+ * @fsi: pointer on shared file system object
+ */
+void ssdfs_segment_tree_lock_eviction(struct ssdfs_fs_info *fsi)
+{
 #ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("page %p, count %d\n",
-		  page, page_ref_count(page));
+	BUG_ON(!fsi || !fsi->segs_tree);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-finish_find_segment:
-	inode_unlock_shared(fsi->segs_tree_inode);
+	mutex_lock(&fsi->segs_tree->evict_lock);
+}
 
+/*
+ * ssdfs_segment_tree_unlock_eviction() - allow segment objects eviction
+ * @fsi: pointer on shared file system object
+ */
+void ssdfs_segment_tree_unlock_eviction(struct ssdfs_fs_info *fsi)
+{
 #ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("finished\n");
+	BUG_ON(!fsi || !fsi->segs_tree);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	return object;
+	mutex_unlock(&fsi->segs_tree->evict_lock);
+}
+
+/*
+ * ssdfs_segment_tree_mark_flush_waiter() - mark segment with waiting threads
+ * @fsi: pointer on shared file system object
+ * @seg_id: segment number
+ *
+ * The flush thread of user data segment marks the segment object
+ * before the waiting of pending requests on segment's wait queue.
+ * Only marked segments are woken up by the volume-wide events.
+ */
+void ssdfs_segment_tree_mark_flush_waiter(struct ssdfs_fs_info *fsi,
+					  u64 seg_id)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !fsi->segs_tree);
+
+	SSDFS_DBG("seg_id %llu\n", seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	xa_set_mark(&fsi->segs_tree->objects, seg_id,
+		    SSDFS_SEG_TREE_FLUSH_WAITER);
+}
+
+/*
+ * ssdfs_segment_tree_wake_up_flush_waiters() - wake up waiting flush threads
+ * @fsi: pointer on shared file system object
+ *
+ * This method wakes up the flush threads of marked segments
+ * and clears the marks. The segment objects are freed after
+ * the RCU grace period. So, the walk doesn't need the eviction lock.
+ */
+void ssdfs_segment_tree_wake_up_flush_waiters(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_segment_info *si;
+	unsigned long index;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi);
+
+	SSDFS_DBG("fsi %p\n", fsi);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (!fsi->segs_tree)
+		return;
+
+	rcu_read_lock();
+	xa_for_each_marked(&fsi->segs_tree->objects, index, si,
+			   SSDFS_SEG_TREE_FLUSH_WAITER) {
+		xa_clear_mark(&fsi->segs_tree->objects, index,
+			      SSDFS_SEG_TREE_FLUSH_WAITER);
+		wake_up_all(&si->wait_queue[SSDFS_PEB_FLUSH_THREAD]);
+	}
+	rcu_read_unlock();
 }
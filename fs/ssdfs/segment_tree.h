@@ -22,8 +22,13 @@
 #ifndef _SSDFS_SEGMENT_TREE_H
 #define _SSDFS_SEGMENT_TREE_H
 
+#include <linux/xarray.h>
+#include <linux/list_lru.h>
+#include <linux/shrinker.h>
+
 /*
  * struct ssdfs_segment_tree - tree of segment objects
+ * @fsi: pointer on shared file system object
  * @lnodes_seg_log_pages: full log size in leaf nodes segment (pages count)
  * @hnodes_seg_log_pages: full log size in hybrid nodes segment (pages count)
  * @inodes_seg_log_pages: full log size in index nodes segment (pages count)
@@ -32,9 +37,16 @@
  * @dentries_btree: dentries b-tree descriptor
  * @extents_btree: extents b-tree descriptor
  * @xattr_btree: xattrs b-tree descriptor
- * @pages: pages of segment tree
+ * @objects: segment objects (RCU-protected lookup)
+ * @lru: LRU list of segment objects
+ * @shrinker: shrinker of idle segment objects
+ * @bmap_shrinker: shrinker of block bitmaps of segment objects in use
+ * @compact_cursor: segment ID to continue block bitmaps compaction
+ * @evict_lock: lock of segment objects eviction
  */
 struct ssdfs_segment_tree {
+	struct ssdfs_fs_info *fsi;
+
 	u16 lnodes_seg_log_pages;
 	u16 hnodes_seg_log_pages;
 	u16 inodes_seg_log_pages;
@@ -45,11 +57,19 @@ struct ssdfs_segment_tree {
 	struct ssdfs_extents_btree_descriptor extents_btree;
 	struct ssdfs_xattr_btree_descriptor xattr_btree;
 
-	struct address_space pages;
+	struct xarray objects;
+	struct list_lru lru;
+	struct shrinker shrinker;
+	struct shrinker bmap_shrinker;
+	unsigned long compact_cursor;
+	struct mutex evict_lock;
 };
 
-#define SSDFS_SEG_OBJ_PTR_PER_PAGE \
-	(PAGE_SIZE / sizeof(struct ssdfs_segment_info *))
+/*
+ * The mark of segment object with flush threads that are waiting
+ * for the pending user data requests.
+ */
+#define SSDFS_SEG_TREE_FLUSH_WAITER	XA_MARK_0
 
 /*
  * Segments' tree API
@@ -62,5 +82,12 @@ int ssdfs_segment_tree_remove(struct ssdfs_fs_info *fsi,
 			      struct ssdfs_segment_info *si);
 struct ssdfs_segment_info *
 ssdfs_segment_tree_find(struct ssdfs_fs_info *fsi, u64 seg_id);
+struct ssdfs_segment_info *
+ssdfs_segment_tree_find_get(struct ssdfs_fs_info *fsi, u64 seg_id);
+void ssdfs_segment_tree_lock_eviction(struct ssdfs_fs_info *fsi);
+void ssdfs_segment_tree_unlock_eviction(struct ssdfs_fs_info *fsi);
+void ssdfs_segment_tree_mark_flush_waiter(struct ssdfs_fs_info *fsi,
+					  u64 seg_id);
+void ssdfs_segment_tree_wake_up_flush_waiters(struct ssdfs_fs_info *fsi);
 
 #endif /* _SSDFS_SEGMENT_TREE_H */
@@ -115,9 +115,9 @@ ssdfs_create_sequence_array(unsigned long revert_threshold)
 	}
 
 	ptr->revert_threshold = revert_threshold;
-	spin_lock_init(&ptr->lock);
-	ptr->last_allocated_id = SSDFS_SEQUENCE_ARRAY_INVALID_ID;
-	INIT_RADIX_TREE(&ptr->map, GFP_ATOMIC);
+	atomic_long_set(&ptr->last_allocated_id,
+			(long)SSDFS_SEQUENCE_ARRAY_INVALID_ID);
+	xa_init(&ptr->map);
 
 	return ptr;
 }
@@ -127,15 +127,14 @@ ssdfs_create_sequence_array(unsigned long revert_threshold)
  * @array: pointer on sequence array object
  * @free_item: pointer on function that can free item
  *
- * This method tries to delete all items from the radix tree,
+ * This method tries to delete all items from the xarray,
  * to free memory of every item and to free the memory of
  * sequence array itself.
  */
 void ssdfs_destroy_sequence_array(struct ssdfs_sequence_array *array,
 				  ssdfs_free_item free_item)
 {
-	struct radix_tree_iter iter;
-	void __rcu **slot;
+	unsigned long index;
 	void *item_ptr;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -144,39 +143,49 @@ void ssdfs_destroy_sequence_array(struct ssdfs_sequence_array *array,
 	SSDFS_DBG("array %p\n", array);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	rcu_read_lock();
-	spin_lock(&array->lock);
-	radix_tree_for_each_slot(slot, &array->map, &iter, 0) {
-		item_ptr = rcu_dereference_raw(*slot);
-
-		spin_unlock(&array->lock);
-		rcu_read_unlock();
-
+	xa_for_each(&array->map, index, item_ptr) {
 #ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("index %llu, ptr %p\n",
-			  (u64)iter.index, item_ptr);
+		SSDFS_DBG("index %lu, ptr %p\n",
+			  index, item_ptr);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-		if (!item_ptr) {
-			SSDFS_WARN("empty node pointer: "
-				   "index %llu\n",
-				   (u64)iter.index);
-		} else {
-			free_item(item_ptr);
-		}
-
-		rcu_read_lock();
-		spin_lock(&array->lock);
-
-		radix_tree_iter_delete(&array->map, &iter, slot);
+		xa_erase(&array->map, index);
+		free_item(item_ptr);
 	}
-	array->last_allocated_id = SSDFS_SEQUENCE_ARRAY_INVALID_ID;
-	spin_unlock(&array->lock);
-	rcu_read_unlock();
+
+	xa_destroy(&array->map);
+	atomic_long_set(&array->last_allocated_id,
+			(long)SSDFS_SEQUENCE_ARRAY_INVALID_ID);
 
 	ssdfs_seq_arr_kfree(array);
 }
 
+/*
+ * ssdfs_sequence_array_insert() - insert item into xarray
+ * @array: pointer on sequence array object
+ * @id: ID of inserting item
+ * @item: pointer on inserting item
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EEXIST  - item with @id exists already.
+ * %-ENOMEM  - fail to allocate memory.
+ */
+static inline
+int ssdfs_sequence_array_insert(struct ssdfs_sequence_array *array,
+				unsigned long id, void *item)
+{
+	int err;
+
+	err = xa_insert(&array->map, id, item, GFP_NOFS);
+	if (err == -EBUSY)
+		err = -EEXIST;
+
+	return err;
+}
+
 /*
  * ssdfs_sequence_array_init_item() - initialize the array by item
  * @array: pointer on sequence array object
@@ -210,34 +219,49 @@ int ssdfs_sequence_array_init_item(struct ssdfs_sequence_array *array,
 		return -EINVAL;
 	}
 
-	err = radix_tree_preload(GFP_NOFS);
+	err = ssdfs_sequence_array_insert(array, id, item);
 	if (unlikely(err)) {
-		SSDFS_ERR("fail to preload radix tree: err %d\n",
-			  err);
-		return err;
-	}
-
-	spin_lock(&array->lock);
-	err = radix_tree_insert(&array->map, id, item);
-	spin_unlock(&array->lock);
-
-	radix_tree_preload_end();
-
-	if (unlikely(err)) {
-		SSDFS_ERR("fail to add item into radix tree: "
+		SSDFS_ERR("fail to add item into xarray: "
 			  "id %llu, item %p, err %d\n",
 			  (u64)id, item, err);
 		return err;
 	}
 
-	spin_lock(&array->lock);
-	if (array->last_allocated_id == SSDFS_SEQUENCE_ARRAY_INVALID_ID)
-		array->last_allocated_id = id;
-	spin_unlock(&array->lock);
+	atomic_long_cmpxchg(&array->last_allocated_id,
+			    (long)SSDFS_SEQUENCE_ARRAY_INVALID_ID,
+			    (long)id);
 
 	return 0;
 }
 
+/*
+ * ssdfs_sequence_array_alloc_id() - allocate next ID
+ * @array: pointer on sequence array object
+ *
+ * This method allocates the next ID without any lock.
+ * The ID sequence is reverted to zero after the threshold.
+ */
+static
+unsigned long ssdfs_sequence_array_alloc_id(struct ssdfs_sequence_array *array)
+{
+	unsigned long last_id;
+	unsigned long id;
+
+	do {
+		last_id = ssdfs_sequence_array_last_id(array);
+
+		if (last_id == SSDFS_SEQUENCE_ARRAY_INVALID_ID)
+			id = 0;
+		else if ((last_id + 1) > array->revert_threshold)
+			id = 0;
+		else
+			id = last_id + 1;
+	} while (atomic_long_cmpxchg(&array->last_allocated_id,
+				     (long)last_id, (long)id) != (long)last_id);
+
+	return id;
+}
+
 /*
  * ssdfs_sequence_array_add_item() - add new item into array
  * @array: pointer on sequence array object
@@ -264,51 +288,25 @@ int ssdfs_sequence_array_add_item(struct ssdfs_sequence_array *array,
 		  array, item, id);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	*id = SSDFS_SEQUENCE_ARRAY_INVALID_ID;
-
-	err = radix_tree_preload(GFP_NOFS);
-	if (unlikely(err)) {
-		SSDFS_ERR("fail to preload radix tree: err %d\n",
-			  err);
-		return err;
-	}
-
-	spin_lock(&array->lock);
-
-	if (array->last_allocated_id == SSDFS_SEQUENCE_ARRAY_INVALID_ID) {
-		*id = 0;
-		array->last_allocated_id = 0;
-	} else {
-		if ((array->last_allocated_id + 1) > array->revert_threshold) {
-			*id = 0;
-			array->last_allocated_id = 0;
-		} else {
-			array->last_allocated_id++;
-			*id = array->last_allocated_id;
-		}
-	}
+	*id = ssdfs_sequence_array_alloc_id(array);
 
 	if (*id > array->revert_threshold) {
 		err = -ERANGE;
 		goto finish_add_item;
 	}
 
-	err = radix_tree_insert(&array->map, *id, item);
+	err = ssdfs_sequence_array_insert(array, *id, item);
 
 finish_add_item:
-	spin_unlock(&array->lock);
-
-	radix_tree_preload_end();
-
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("id %lu\n", *id);
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	if (unlikely(err)) {
-		SSDFS_ERR("fail to add item into radix tree: "
+		SSDFS_ERR("fail to add item into xarray: "
 			  "id %llu, last_allocated_id %lu, "
 			  "item %p, err %d\n",
-			  (u64)*id, array->last_allocated_id,
+			  (u64)*id, ssdfs_sequence_array_last_id(array),
 			  item, err);
 		return err;
 	}
@@ -342,10 +340,7 @@ void *ssdfs_sequence_array_get_item(struct ssdfs_sequence_array *array,
 		  array, id);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	spin_lock(&array->lock);
-	item_ptr = radix_tree_lookup(&array->map, id);
-	spin_unlock(&array->lock);
-
+	item_ptr = xa_load(&array->map, id);
 	if (!item_ptr) {
 #ifdef CONFIG_SSDFS_DEBUG
 		SSDFS_DBG("unable to find the item: id %llu\n",
@@ -377,8 +372,7 @@ void *ssdfs_sequence_array_get_item(struct ssdfs_sequence_array *array,
 int ssdfs_sequence_array_apply_for_all(struct ssdfs_sequence_array *array,
 					ssdfs_apply_action apply_action)
 {
-	struct radix_tree_iter iter;
-	void **slot;
+	unsigned long index;
 	void *item_ptr;
 	int err = 0;
 
@@ -388,40 +382,20 @@ int ssdfs_sequence_array_apply_for_all(struct ssdfs_sequence_array *array,
 	SSDFS_DBG("array %p\n", array);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	rcu_read_lock();
-
-	spin_lock(&array->lock);
-	radix_tree_for_each_slot(slot, &array->map, &iter, 0) {
-		item_ptr = radix_tree_deref_slot(slot);
-		if (unlikely(!item_ptr)) {
-			SSDFS_WARN("empty item ptr: id %llu\n",
-				   (u64)iter.index);
-			continue;
-		}
-		spin_unlock(&array->lock);
-
-		rcu_read_unlock();
-
+	xa_for_each(&array->map, index, item_ptr) {
 #ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("id %llu, item_ptr %p\n",
-			  (u64)iter.index, item_ptr);
+		SSDFS_DBG("id %lu, item_ptr %p\n",
+			  index, item_ptr);
 #endif /* CONFIG_SSDFS_DEBUG */
 
 		err = apply_action(item_ptr);
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to apply action: "
-				  "id %llu, err %d\n",
-				  (u64)iter.index,  err);
+				  "id %lu, err %d\n",
+				  index,  err);
 			goto finish_apply_to_all;
 		}
-
-		rcu_read_lock();
-
-		spin_lock(&array->lock);
 	}
-	spin_unlock(&array->lock);
-
-	rcu_read_unlock();
 
 finish_apply_to_all:
 	if (unlikely(err)) {
@@ -459,7 +433,6 @@ int ssdfs_sequence_array_change_state(struct ssdfs_sequence_array *array,
 					int old_state, int new_state)
 {
 	void *item_ptr = NULL;
-	int res;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -472,24 +445,22 @@ int ssdfs_sequence_array_change_state(struct ssdfs_sequence_array *array,
 		  old_state, new_state);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	rcu_read_lock();
-
-	spin_lock(&array->lock);
-	item_ptr = radix_tree_lookup(&array->map, id);
+	item_ptr = xa_load(&array->map, id);
 	if (item_ptr) {
 		if (old_tag != SSDFS_SEQUENCE_ITEM_NO_TAG) {
-			res = radix_tree_tag_get(&array->map, id, old_tag);
-			if (res != 1)
+			xa_mark_t mark;
+
+			mark = ssdfs_sequence_array_tag2mark(old_tag);
+			if (!xa_get_mark(&array->map, id, mark))
 				err = -ERANGE;
 		}
 	} else
 		err = -ENOENT;
-	spin_unlock(&array->lock);
 
 	if (unlikely(err)) {
 		SSDFS_ERR("fail to find item id %llu with tag %#x\n",
 			  (u64)id, old_tag);
-		goto finish_change_state;
+		return err;
 	}
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -503,19 +474,20 @@ int ssdfs_sequence_array_change_state(struct ssdfs_sequence_array *array,
 			  "id %llu, old_state %#x, "
 			  "new_state %#x, err %d\n",
 			  (u64)id, old_state, new_state, err);
-		goto finish_change_state;
+		return err;
 	}
 
-	spin_lock(&array->lock);
-	item_ptr = radix_tree_tag_set(&array->map, id, new_tag);
-	if (old_tag != SSDFS_SEQUENCE_ITEM_NO_TAG)
-		radix_tree_tag_clear(&array->map, id, old_tag);
-	spin_unlock(&array->lock);
+	if (new_tag != SSDFS_SEQUENCE_ITEM_NO_TAG) {
+		xa_set_mark(&array->map, id,
+			    ssdfs_sequence_array_tag2mark(new_tag));
+	}
 
-finish_change_state:
-	rcu_read_unlock();
+	if (old_tag != SSDFS_SEQUENCE_ITEM_NO_TAG) {
+		xa_clear_mark(&array->map, id,
+			      ssdfs_sequence_array_tag2mark(old_tag));
+	}
 
-	return err;
+	return 0;
 }
 
 /*
@@ -542,8 +514,9 @@ int ssdfs_sequence_array_change_all_states(struct ssdfs_sequence_array *ptr,
 					   int old_state, int new_state,
 					   unsigned long *found_items)
 {
-	struct radix_tree_iter iter;
-	void **slot;
+	xa_mark_t old_mark = ssdfs_sequence_array_tag2mark(old_tag);
+	xa_mark_t new_mark = ssdfs_sequence_array_tag2mark(new_tag);
+	unsigned long index;
 	void *item_ptr;
 	int err = 0;
 
@@ -559,47 +532,27 @@ int ssdfs_sequence_array_change_all_states(struct ssdfs_sequence_array *ptr,
 
 	*found_items = 0;
 
-	rcu_read_lock();
-
-	spin_lock(&ptr->lock);
-	radix_tree_for_each_tagged(slot, &ptr->map, &iter, 0, old_tag) {
-		item_ptr = radix_tree_deref_slot(slot);
-		if (unlikely(!item_ptr)) {
-			SSDFS_WARN("empty item ptr: id %llu\n",
-				   (u64)iter.index);
-			radix_tree_tag_clear(&ptr->map, iter.index, old_tag);
-			continue;
-		}
-		spin_unlock(&ptr->lock);
-
-		rcu_read_unlock();
-
+	xa_for_each_marked(&ptr->map, index, item_ptr, old_mark) {
 #ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("id %llu, item_ptr %p\n",
-			  (u64)iter.index, item_ptr);
+		SSDFS_DBG("id %lu, item_ptr %p\n",
+			  index, item_ptr);
 #endif /* CONFIG_SSDFS_DEBUG */
 
 		err = change_state(item_ptr, old_state, new_state);
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to change state: "
-				  "id %llu, old_state %#x, "
+				  "id %lu, old_state %#x, "
 				  "new_state %#x, err %d\n",
-				  (u64)iter.index, old_state,
+				  index, old_state,
 				  new_state, err);
 			goto finish_change_all_states;
 		}
 
 		(*found_items)++;
 
-		rcu_read_lock();
-
-		spin_lock(&ptr->lock);
-		radix_tree_tag_set(&ptr->map, iter.index, new_tag);
-		radix_tree_tag_clear(&ptr->map, iter.index, old_tag);
+		xa_set_mark(&ptr->map, index, new_mark);
+		xa_clear_mark(&ptr->map, index, old_mark);
 	}
-	spin_unlock(&ptr->lock);
-
-	rcu_read_unlock();
 
 finish_change_all_states:
 	if (*found_items == 0 || err) {
@@ -628,9 +581,7 @@ bool has_ssdfs_sequence_array_state(struct ssdfs_sequence_array *array,
 	SSDFS_DBG("array %p, tag %#x\n", array, tag);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	spin_lock(&array->lock);
-	res = radix_tree_tagged(&array->map, tag);
-	spin_unlock(&array->lock);
+	res = xa_marked(&array->map, ssdfs_sequence_array_tag2mark(tag));
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("res %#x\n", res);
@@ -24,9 +24,8 @@
 /*
  * struct ssdfs_sequence_array - sequence of pointers on items
  * @revert_threshold: threshold of reverting the ID numbers' sequence
- * @lock: exclusive lock
  * @last_allocated_id: the latest ID was allocated
- * @map: pointers' radix tree
+ * @map: pointers' xarray
  *
  * The sequence array is specialized structure that has goal
  * to provide access to items via pointers on the basis of
@@ -36,13 +35,17 @@
  * number of existing items into the sequence array.
  * The ID number could be reverted from some maximum number
  * (threshold) to zero value.
+ *
+ * The lookup and iteration of items are RCU-protected and they
+ * don't take any lock. Only the modifications of xarray are
+ * serialized by the internal xarray's lock. The latest allocated
+ * ID is changed by atomic operations.
  */
 struct ssdfs_sequence_array {
 	unsigned long revert_threshold;
 
-	spinlock_t lock;
-	unsigned long last_allocated_id;
-	struct radix_tree_root map;
+	atomic_long_t last_allocated_id;
+	struct xarray map;
 };
 
 /* function prototype */
@@ -58,22 +61,14 @@ typedef int (*ssdfs_change_item_state)(void *item,
 static inline
 unsigned long ssdfs_sequence_array_last_id(struct ssdfs_sequence_array *array)
 {
-	unsigned long last_id = ULONG_MAX;
-
-	spin_lock(&array->lock);
-	last_id = array->last_allocated_id;
-	spin_unlock(&array->lock);
-
-	return last_id;
+	return (unsigned long)atomic_long_read(&array->last_allocated_id);
 }
 
 static inline
 void ssdfs_sequence_array_set_last_id(struct ssdfs_sequence_array *array,
 				      unsigned long id)
 {
-	spin_lock(&array->lock);
-	array->last_allocated_id = id;
-	spin_unlock(&array->lock);
+	atomic_long_set(&array->last_allocated_id, (long)id);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("set last id %lu\n", id);
@@ -83,13 +78,23 @@ void ssdfs_sequence_array_set_last_id(struct ssdfs_sequence_array *array,
 static inline
 bool is_ssdfs_sequence_array_last_id_invalid(struct ssdfs_sequence_array *ptr)
 {
-	bool is_invalid = false;
+	return ssdfs_sequence_array_last_id(ptr) ==
+					SSDFS_SEQUENCE_ARRAY_INVALID_ID;
+}
 
-	spin_lock(&ptr->lock);
-	is_invalid = ptr->last_allocated_id == SSDFS_SEQUENCE_ARRAY_INVALID_ID;
-	spin_unlock(&ptr->lock);
+/*
+ * The tags of items are stored as marks of xarray.
+ * SSDFS_SEQUENCE_ITEM_NO_TAG has no mark.
+ */
+static inline
+xa_mark_t ssdfs_sequence_array_tag2mark(int tag)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(tag <= SSDFS_SEQUENCE_ITEM_NO_TAG ||
+		tag > SSDFS_SEQUENCE_ITEM_COMMITED_TAG);
+#endif /* CONFIG_SSDFS_DEBUG */
 
-	return is_invalid;
+	return (__force xa_mark_t)(tag - 1);
 }
 
 /*
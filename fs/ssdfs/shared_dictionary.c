@@ -22,6 +22,7 @@
 #include <linux/kernel.h>
 #include <linux/mm.h>
 #include <linux/slab.h>
+#include <linux/hash.h>
 #include <linux/pagevec.h>
 
 #include "peb_mapping_queue.h"
@@ -407,6 +408,290 @@ void ssdfs_names_queue_remove_all(struct ssdfs_names_queue *nq)
 	}
 }
 
+/******************************************************************************
+ *                         NAMES CACHE FUNCTIONALITY                          *
+ ******************************************************************************/
+
+static inline
+struct hlist_head *
+ssdfs_shdict_names_cache_bucket(struct ssdfs_shdict_names_cache *cache,
+				u64 hash)
+{
+	return &cache->buckets[hash_64(hash,
+				       SSDFS_SHDICT_NAMES_CACHE_HASH_BITS)];
+}
+
+/*
+ * ssdfs_shdict_name_cache_item_free() - free item after grace period
+ * @head: RCU head of the item
+ */
+static
+void ssdfs_shdict_name_cache_item_free(struct rcu_head *head)
+{
+	struct ssdfs_shdict_name_cache_item *item;
+
+	item = container_of(head, struct ssdfs_shdict_name_cache_item, rcu);
+	ssdfs_dict_kfree(item);
+}
+
+/*
+ * __ssdfs_shdict_names_cache_remove() - remove item from the cache
+ * @cache: names cache
+ * @item: cached name
+ *
+ * The caller has to hold the cache's lock. The memory of the item
+ * is freed after RCU grace period because concurrent readers
+ * could access the item.
+ */
+static
+void __ssdfs_shdict_names_cache_remove(struct ssdfs_shdict_names_cache *cache,
+				       struct ssdfs_shdict_name_cache_item *item)
+{
+	hlist_del_rcu(&item->hnode);
+	list_del(&item->list);
+	cache->count--;
+	call_rcu(&item->rcu, ssdfs_shdict_name_cache_item_free);
+}
+
+/*
+ * __ssdfs_shdict_names_cache_evict() - evict items from the cache
+ * @cache: names cache
+ * @nr_to_evict: number of items for eviction
+ *
+ * This method walks from the tail of eviction list and frees
+ * the items that haven't been referenced since the previous pass.
+ * The referenced items receive the second chance. The caller
+ * has to hold the cache's lock.
+ *
+ * RETURN: number of evicted items.
+ */
+static
+unsigned long
+__ssdfs_shdict_names_cache_evict(struct ssdfs_shdict_names_cache *cache,
+				 unsigned long nr_to_evict)
+{
+	struct ssdfs_shdict_name_cache_item *item;
+	unsigned long evicted = 0;
+	u32 passed = 0;
+
+	while (evicted < nr_to_evict && !list_empty(&cache->list)) {
+		item = list_last_entry(&cache->list,
+					struct ssdfs_shdict_name_cache_item,
+					list);
+
+		if (READ_ONCE(item->referenced) && passed < cache->count) {
+			WRITE_ONCE(item->referenced, false);
+			list_move(&item->list, &cache->list);
+			passed++;
+			continue;
+		}
+
+		__ssdfs_shdict_names_cache_remove(cache, item);
+		evicted++;
+	}
+
+	return evicted;
+}
+
+/*
+ * ssdfs_shdict_names_cache_count() - count cached names
+ * @shrink: shrinker object
+ * @sc: shrink control
+ */
+static
+unsigned long ssdfs_shdict_names_cache_count(struct shrinker *shrink,
+					     struct shrink_control *sc)
+{
+	struct ssdfs_shdict_names_cache *cache;
+	u32 count;
+
+	cache = container_of(shrink, struct ssdfs_shdict_names_cache,
+			     shrinker);
+
+	spin_lock(&cache->lock);
+	count = cache->count;
+	spin_unlock(&cache->lock);
+
+	return count > 0 ? (unsigned long)count : SHRINK_EMPTY;
+}
+
+/*
+ * ssdfs_shdict_names_cache_scan() - evict cached names
+ * @shrink: shrinker object
+ * @sc: shrink control
+ */
+static
+unsigned long ssdfs_shdict_names_cache_scan(struct shrinker *shrink,
+					    struct shrink_control *sc)
+{
+	struct ssdfs_shdict_names_cache *cache;
+	unsigned long freed;
+
+	cache = container_of(shrink, struct ssdfs_shdict_names_cache,
+			     shrinker);
+
+	spin_lock(&cache->lock);
+	freed = __ssdfs_shdict_names_cache_evict(cache, sc->nr_to_scan);
+	spin_unlock(&cache->lock);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("nr_to_scan %lu, freed %lu\n",
+		  sc->nr_to_scan, freed);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return freed;
+}
+
+/*
+ * ssdfs_shdict_names_cache_init() - initialize names cache
+ * @fsi: pointer on shared file system object
+ * @cache: names cache
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+static
+int ssdfs_shdict_names_cache_init(struct ssdfs_fs_info *fsi,
+				  struct ssdfs_shdict_names_cache *cache)
+{
+	int i;
+	int err;
+
+	spin_lock_init(&cache->lock);
+	for (i = 0; i < SSDFS_SHDICT_NAMES_CACHE_BUCKETS; i++)
+		INIT_HLIST_HEAD(&cache->buckets[i]);
+	INIT_LIST_HEAD(&cache->list);
+	cache->count = 0;
+	cache->capacity = SSDFS_SHDICT_NAMES_CACHE_CAPACITY;
+
+	cache->shrinker.count_objects = ssdfs_shdict_names_cache_count;
+	cache->shrinker.scan_objects = ssdfs_shdict_names_cache_scan;
+	cache->shrinker.seeks = DEFAULT_SEEKS;
+
+	err = register_shrinker(&cache->shrinker,
+				"ssdfs-shdict:%s", fsi->sb->s_id);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to register names cache shrinker: "
+			  "err %d\n", err);
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_shdict_names_cache_destroy() - destroy names cache
+ * @cache: names cache
+ */
+static
+void ssdfs_shdict_names_cache_destroy(struct ssdfs_shdict_names_cache *cache)
+{
+	struct ssdfs_shdict_name_cache_item *item, *tmp;
+
+	unregister_shrinker(&cache->shrinker);
+
+	spin_lock(&cache->lock);
+	list_for_each_entry_safe(item, tmp, &cache->list, list) {
+		__ssdfs_shdict_names_cache_remove(cache, item);
+	}
+	spin_unlock(&cache->lock);
+}
+
+/*
+ * ssdfs_shdict_names_cache_find() - find name in the cache
+ * @cache: names cache
+ * @hash: name hash
+ * @name: name buffer [out]
+ *
+ * RETURN:
+ * [true]  - the name has been found and copied into @name.
+ * [false] - the cache doesn't contain the name.
+ */
+static
+bool ssdfs_shdict_names_cache_find(struct ssdfs_shdict_names_cache *cache,
+				   u64 hash,
+				   struct ssdfs_name_string *name)
+{
+	struct ssdfs_shdict_name_cache_item *item;
+	struct hlist_head *head;
+	bool is_found = false;
+
+	head = ssdfs_shdict_names_cache_bucket(cache, hash);
+
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(item, head, hnode) {
+		if (item->hash != hash)
+			continue;
+
+		name->hash = hash;
+		name->len = item->len;
+		memcpy(name->str, item->str, item->len);
+
+		if (!READ_ONCE(item->referenced))
+			WRITE_ONCE(item->referenced, true);
+
+		is_found = true;
+		break;
+	}
+	rcu_read_unlock();
+
+	return is_found;
+}
+
+/*
+ * ssdfs_shdict_names_cache_add() - add name into the cache
+ * @cache: names cache
+ * @name: extracted name
+ *
+ * This method tries to store the name into the cache. The failure
+ * of memory allocation is not an error because the name can be
+ * extracted from the dictionary again.
+ */
+static
+void ssdfs_shdict_names_cache_add(struct ssdfs_shdict_names_cache *cache,
+				  struct ssdfs_name_string *name)
+{
+	struct ssdfs_shdict_name_cache_item *item, *cur;
+	struct hlist_head *head;
+
+	if (name->len == 0 || name->len > SSDFS_MAX_NAME_LEN)
+		return;
+
+	item = ssdfs_dict_kmalloc(struct_size(item, str, name->len),
+				  GFP_NOFS);
+	if (!item)
+		return;
+
+	INIT_LIST_HEAD(&item->list);
+	item->hash = name->hash;
+	item->referenced = false;
+	item->len = (u16)name->len;
+	memcpy(item->str, name->str, name->len);
+
+	head = ssdfs_shdict_names_cache_bucket(cache, name->hash);
+
+	spin_lock(&cache->lock);
+
+	hlist_for_each_entry(cur, head, hnode) {
+		if (cur->hash == name->hash) {
+			/* name has been added by concurrent thread */
+			spin_unlock(&cache->lock);
+			ssdfs_dict_kfree(item);
+			return;
+		}
+	}
+
+	if (cache->count >= cache->capacity)
+		__ssdfs_shdict_names_cache_evict(cache, 1);
+
+	hlist_add_head_rcu(&item->hnode, head);
+	list_add(&item->list, &cache->list);
+	cache->count++;
+
+	spin_unlock(&cache->lock);
+}
+
 /******************************************************************************
  *                SHARED DICTIONARY TREE OBJECT FUNCTIONALITY                 *
  ******************************************************************************/
@@ -467,16 +752,23 @@ int ssdfs_shared_dict_btree_create(struct ssdfs_fs_info *fsi)
 	init_waitqueue_head(&ptr->wait_queue);
 	ssdfs_names_queue_init(&ptr->requests.queue);
 
+	err = ssdfs_shdict_names_cache_init(fsi, &ptr->names_cache);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to initialize names cache: err %d\n",
+			  err);
+		goto destroy_shared_dict_object;
+	}
+
 	err = ssdfs_shared_dict_start_thread(ptr);
 	if (err == -EINTR) {
 		/*
 		 * Ignore this error.
 		 */
-		goto destroy_shared_dict_object;
+		goto destroy_names_cache;
 	} else if (unlikely(err)) {
 		SSDFS_ERR("fail to start shared dictionary tree's thread: "
 			  "err %d\n", err);
-		goto destroy_shared_dict_object;
+		goto destroy_names_cache;
 	}
 
 	atomic_set(&ptr->state, SSDFS_SHDICT_BTREE_CREATED);
@@ -493,6 +785,9 @@ int ssdfs_shared_dict_btree_create(struct ssdfs_fs_info *fsi)
 
 	return 0;
 
+destroy_names_cache:
+	ssdfs_shdict_names_cache_destroy(&ptr->names_cache);
+
 destroy_shared_dict_object:
 	ssdfs_btree_destroy(&ptr->generic_tree);
 
@@ -522,6 +817,7 @@ void ssdfs_shared_dict_btree_destroy(struct ssdfs_fs_info *fsi)
 
 	ssdfs_names_queue_remove_all(&fsi->shdictree->requests.queue);
 
+	ssdfs_shdict_names_cache_destroy(&fsi->shdictree->names_cache);
 	ssdfs_btree_destroy(&fsi->shdictree->generic_tree);
 	ssdfs_dict_kfree(fsi->shdictree);
 	fsi->shdictree = NULL;
@@ -858,6 +1154,14 @@ try_check_state:
 
 	memset(name, 0, sizeof(struct ssdfs_name_string));
 
+	if (ssdfs_shdict_names_cache_find(&tree->names_cache, hash, name)) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("name has been found in the cache: hash %llx\n",
+			  hash);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return 0;
+	}
+
 	search = ssdfs_btree_search_alloc();
 	if (!search) {
 		SSDFS_ERR("fail to allocate btree search object\n");
@@ -943,6 +1247,8 @@ try_check_state:
 		     search->result.name, 0, sizeof(struct ssdfs_name_string),
 		     sizeof(struct ssdfs_name_string));
 
+	ssdfs_shdict_names_cache_add(&tree->names_cache, name);
+
 finish_get_name:
 	ssdfs_btree_search_free(search);
 
@@ -1521,8 +1827,8 @@ int ssdfs_shared_dict_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	err = ssdfs_btree_pre_flush_root_node(node);
 	if (unlikely(err)) {
@@ -1531,7 +1837,7 @@ int ssdfs_shared_dict_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 			  node->node_id, err);
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	return err;
@@ -1683,7 +1989,7 @@ int ssdfs_shared_dict_btree_create_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 	down_write(&node->bmap_array.lock);
 
 	switch (atomic_read(&node->type)) {
@@ -1848,7 +2154,7 @@ int ssdfs_shared_dict_btree_create_node(struct ssdfs_btree_node *node)
 
 finish_create_node:
 	up_write(&node->bmap_array.lock);
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		return err;
@@ -2412,7 +2718,7 @@ int ssdfs_shared_dict_btree_init_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	if (pagevec_count(&node->content.pvec) == 0) {
 		err = -ERANGE;
@@ -2447,7 +2753,7 @@ int ssdfs_shared_dict_btree_init_node(struct ssdfs_btree_node *node)
 		goto finish_init_operation;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&node->raw.dict_header, 0, hdr_size,
 		     hdr, 0, hdr_size,
@@ -2589,7 +2895,7 @@ int ssdfs_shared_dict_btree_init_node(struct ssdfs_btree_node *node)
 	node->items_area.items_capacity = items_capacity;
 
 finish_header_init:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_init_operation;
@@ -2727,7 +3033,7 @@ int ssdfs_shared_dict_btree_add_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	};
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	switch (atomic_read(&node->items_area.state)) {
 	case SSDFS_BTREE_NODE_ITEMS_AREA_EXIST:
@@ -2775,7 +3081,7 @@ int ssdfs_shared_dict_btree_add_node(struct ssdfs_btree_node *node)
 	}
 
 finish_add_node:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (err)
 		return err;
@@ -3012,8 +3318,8 @@ int ssdfs_shared_dict_btree_pre_flush_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&dict_header, 0, hdr_size,
 		     &node->raw.dict_header, 0, hdr_size,
@@ -3227,7 +3533,8 @@ int ssdfs_shared_dict_btree_pre_flush_node(struct ssdfs_btree_node *node)
 	dict_header.lookup_table2.items_count = le16_to_cpu(lookup_tbl2_items);
 
 	dict_header.node.check.bytes = cpu_to_le16((u16)hdr_size);
-	dict_header.node.check.flags = cpu_to_le16(SSDFS_CRC32);
+	dict_header.node.check.flags =
+		cpu_to_le16(ssdfs_csum_type(node->tree->fsi));
 
 	err = ssdfs_calculate_csum(&dict_header.node.check,
 				   &dict_header, hdr_size);
@@ -3244,7 +3551,7 @@ int ssdfs_shared_dict_btree_pre_flush_node(struct ssdfs_btree_node *node)
 	ssdfs_mark_lookup2_table_clean(node);
 
 finish_shared_dict_header_preparation:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_node_pre_flush;
@@ -3308,7 +3615,7 @@ int ssdfs_shared_dict_btree_flush_node(struct ssdfs_btree_node *node)
 
 	fsi = node->tree->fsi;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	fs_feature_compat = fsi->fs_feature_compat;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -4463,6 +4770,77 @@ int ssdfs_shared_dict_node_find_index_nolock(struct ssdfs_btree_node *node,
 	return -ENODATA;
 }
 
+/*
+ * ssdfs_shared_dict_lookup1_scan_nolock() - scan the lookup1 table
+ * @node: node object
+ * @key: search key (valid hash32_lo)
+ * @found_index: pointer on the found index [out]
+ * @found_key: pointer on the found key [out]
+ *
+ * The lookup1 table is a small sorted array in the node's header.
+ * Instead of the binary search through the callbacks this method
+ * counts the items that are not bigger than the search key.
+ * The loop has no data-dependent branches and the compiler is able
+ * to vectorize it. The found index is the last item that is not
+ * bigger than the key (or the first item if the key is lesser
+ * than any item) that is the same result as the generic search.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - no such data in the node.
+ * %-EEXIST     - exactly the requested data was found.
+ */
+static inline
+int ssdfs_shared_dict_lookup1_scan_nolock(struct ssdfs_btree_node *node,
+				struct ssdfs_shdict_search_key *key,
+				u16 *found_index,
+				struct ssdfs_shdict_search_key *found_key)
+{
+	struct ssdfs_shdict_ltbl1_item *lookup_table;
+	size_t key_size = sizeof(struct ssdfs_shdict_search_key);
+	u32 hash = (__force u32)key->name.hash_lo;
+	int count = 0;
+	int i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!node || !key || !found_index || !found_key);
+	BUG_ON(!rwsem_is_locked(&node->header_lock));
+	BUG_ON(!is_ssdfs_hash32_lo_valid(key));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	lookup_table = node->raw.dict_header.lookup_table1;
+
+	for (i = 0; i < SSDFS_SHDIC_LTBL1_SIZE; i++)
+		count += (__force u32)lookup_table[i].hash_lo <= hash;
+
+	*found_index = count > 0 ? count - 1 : 0;
+	memset(found_key, 0xFF, key_size);
+
+	if ((__force u32)lookup_table[0].hash_lo >= U32_MAX) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("lookup1 table is empty: found_index %u\n",
+			  *found_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+		return -ENODATA;
+	}
+
+	ssdfs_memcpy(found_key, 0, key_size,
+		     &lookup_table[*found_index], 0, key_size,
+		     key_size);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("count %d, found_index %u\n",
+		  count, *found_index);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (count > 0 && found_key->name.hash_lo == key->name.hash_lo)
+		return -EEXIST;
+
+	return -ENODATA;
+}
+
 /*
  * ssdfs_shared_dict_node_find_lookup1_index() - find lookup1 index
  * @node: node object
@@ -4483,8 +4861,10 @@ int ssdfs_shared_dict_node_find_lookup1_index(struct ssdfs_btree_node *node,
 					      struct ssdfs_btree_search *search,
 					      u16 *index)
 {
+	struct ssdfs_shdict_search_key key;
 	struct ssdfs_shdict_search_key found;
 	int array_size = SSDFS_SHDIC_LTBL1_SIZE;
+	bool can_scan = false;
 	int err;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -4501,8 +4881,17 @@ int ssdfs_shared_dict_node_find_lookup1_index(struct ssdfs_btree_node *node,
 		  search->node.child);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	if (search->request.start.hash < U64_MAX) {
+		err = ssdfs_convert_hash64_to_hash32_lo(search, &key);
+		can_scan = !err && is_ssdfs_hash32_lo_valid(&key);
+	}
+
 	down_read(&node->header_lock);
-	err = ssdfs_shared_dict_node_find_index_nolock(node, search,
+	if (can_scan) {
+		err = ssdfs_shared_dict_lookup1_scan_nolock(node, &key,
+							    index, &found);
+	} else {
+		err = ssdfs_shared_dict_node_find_index_nolock(node, search,
 					0, array_size, array_size,
 					ssdfs_convert_hash64_to_hash32_lo,
 					ssdfs_get_lookup1_table_search_key,
@@ -4510,6 +4899,7 @@ int ssdfs_shared_dict_node_find_lookup1_index(struct ssdfs_btree_node *node,
 					ssdfs_hash32_lo_compare,
 					ssdfs_correct_range_search_lower_index,
 					index, &found);
+	}
 	up_read(&node->header_lock);
 
 	switch (err) {
@@ -4641,7 +5031,7 @@ int ssdfs_shared_dict_node_find_lookup2_index(struct ssdfs_btree_node *node,
 		  start_index, range_len, array_size);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	err = ssdfs_shared_dict_node_find_index_nolock(node, search,
 				start_index, array_size, table_size,
@@ -5052,7 +5442,7 @@ int ssdfs_shared_dict_node_find_hash_index(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	err = ssdfs_shared_dict_node_find_index_nolock(node, search,
 				start_index, range_len, table_size,
@@ -5421,7 +5811,7 @@ int ssdfs_extract_range_by_hash_index(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	for (i = 0; i < found_items; i++) {
 		name = &search->result.name[i];
@@ -10931,7 +11321,7 @@ int ssdfs_add_full_name(struct ssdfs_btree_node *node,
 
 	requested_size = str_len + l2desc_size + hdesc_size;
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	if (!is_free_space_enough(node, requested_size)) {
 		err = -ENOSPC;
@@ -11089,7 +11479,7 @@ check_node_consistency:
 	atomic_set(&node->state, SSDFS_BTREE_NODE_DIRTY);
 
 finish_add_full_name:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	return err;
 }
@@ -11222,7 +11612,7 @@ int ssdfs_create_prefix_for_left_name(struct ssdfs_btree_node *node,
 
 	requested_size = hdesc_size;
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	if (!is_free_space_enough(node, requested_size)) {
 		err = -ENOSPC;
@@ -11453,7 +11843,7 @@ check_node_consistency:
 	atomic_set(&node->state, SSDFS_BTREE_NODE_DIRTY);
 
 finish_create_left_prefix:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("DEBUG SEARCH RESULT NAME:\n");
@@ -11573,7 +11963,7 @@ int ssdfs_create_prefix_for_right_name(struct ssdfs_btree_node *node,
 
 	requested_size = hdesc_size;
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	if (!is_free_space_enough(node, requested_size)) {
 		err = -ENOSPC;
@@ -11793,7 +12183,7 @@ check_node_consistency:
 	atomic_set(&node->state, SSDFS_BTREE_NODE_DIRTY);
 
 finish_create_right_prefix:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	return err;
 }
@@ -12384,7 +12774,7 @@ int ssdfs_insert_suffix_into_left_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	err = ssdfs_insert_suffix(node, search, prefix_len);
 	if (unlikely(err)) {
@@ -12407,7 +12797,7 @@ check_node_consistency:
 	atomic_set(&node->state, SSDFS_BTREE_NODE_DIRTY);
 
 finish_insert_left_suffix:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	return err;
 }
@@ -12579,7 +12969,7 @@ int ssdfs_insert_suffix_into_right_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	err = ssdfs_insert_suffix(node, search, prefix_len);
 	if (unlikely(err)) {
@@ -12602,7 +12992,7 @@ check_node_consistency:
 	atomic_set(&node->state, SSDFS_BTREE_NODE_DIRTY);
 
 finish_insert_right_suffix:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	return err;
 }
@@ -12777,7 +13167,7 @@ int __ssdfs_shared_dict_btree_node_insert_item(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	down_read(&node->header_lock);
 	index_area_size = node->index_area.area_size;
@@ -16200,8 +16590,8 @@ int __ssdfs_shared_dict_btree_node_delete_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&lookup_tbl_area,
 		     0, sizeof(struct ssdfs_btree_node_index_area),
@@ -16367,7 +16757,7 @@ int __ssdfs_shared_dict_btree_node_delete_range(struct ssdfs_btree_node *node,
 	names_count = node->items_area.items_count;
 
 finish_delete_range:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	if (unlikely(err))
@@ -16863,7 +17253,7 @@ int ssdfs_shared_dict_btree_node_extract_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	hash_index = start_index;
 	name_index = 0;
@@ -17050,8 +17440,8 @@ int ssdfs_shared_dict_btree_resize_items_area(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 	down_write(&node->bmap_array.lock);
 
 	area_offset = node->items_area.offset;
@@ -17128,7 +17518,7 @@ int ssdfs_shared_dict_btree_resize_items_area(struct ssdfs_btree_node *node,
 
 finish_area_resize:
 	up_write(&node->bmap_array.lock);
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	return err;
@@ -81,6 +81,56 @@ struct ssdfs_name_requests_queue {
 	struct ssdfs_thread_info thread;
 };
 
+#define SSDFS_SHDICT_NAMES_CACHE_HASH_BITS	(8)
+#define SSDFS_SHDICT_NAMES_CACHE_BUCKETS	\
+	(1 << SSDFS_SHDICT_NAMES_CACHE_HASH_BITS)
+#define SSDFS_SHDICT_NAMES_CACHE_CAPACITY	(1024)
+
+/*
+ * struct ssdfs_shdict_name_cache_item - cached name
+ * @hnode: hash table's node
+ * @list: node of eviction list
+ * @rcu: RCU head for deferred freeing
+ * @hash: name hash
+ * @referenced: item has been accessed since the last eviction pass
+ * @len: name length
+ * @str: name string
+ */
+struct ssdfs_shdict_name_cache_item {
+	struct hlist_node hnode;
+	struct list_head list;
+	struct rcu_head rcu;
+	u64 hash;
+	bool referenced;
+	u16 len;
+	unsigned char str[];
+};
+
+/*
+ * struct ssdfs_shdict_names_cache - hash to name lookaside cache
+ * @lock: cache's lock (protects modification of the cache)
+ * @buckets: hash table of items (RCU readable)
+ * @list: eviction list (the most recently added item is the first)
+ * @count: number of items in the cache
+ * @capacity: maximum number of items in the cache
+ * @shrinker: shrinker of the cache
+ *
+ * The names of the shared dictionary are never changed or deleted.
+ * So, the name for a hash can be kept in memory without invalidation.
+ * The cache keeps the recently extracted names and it is searched
+ * under RCU without any lock. The eviction uses the second chance
+ * policy: an item that has been referenced since the previous pass
+ * is moved to the head of eviction list instead of the freeing.
+ */
+struct ssdfs_shdict_names_cache {
+	spinlock_t lock;
+	struct hlist_head buckets[SSDFS_SHDICT_NAMES_CACHE_BUCKETS];
+	struct list_head list;
+	u32 count;
+	u32 capacity;
+	struct shrinker shrinker;
+};
+
 /*
  * struct ssdfs_shared_dict_btree_info - shared dictionary btree info
  * @state: shared dictionary btree state
@@ -89,6 +139,7 @@ struct ssdfs_name_requests_queue {
  * @read_reqs: current count of read requests
  * @requests: name requests queue
  * @wait_queue: wait queue of shared dictionary tree's thread
+ * @names_cache: hash to name lookaside cache
  */
 struct ssdfs_shared_dict_btree_info {
 	atomic_t state;
@@ -99,6 +150,8 @@ struct ssdfs_shared_dict_btree_info {
 
 	struct ssdfs_name_requests_queue requests;
 	wait_queue_head_t wait_queue;
+
+	struct ssdfs_shdict_names_cache names_cache;
 };
 
 /* Shared dictionary tree states */
@@ -24,6 +24,7 @@
 #include <linux/slab.h>
 #include <linux/kthread.h>
 #include <linux/pagevec.h>
+#include <linux/list_sort.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -149,6 +150,158 @@ finish_init:
 	return err;
 }
 
+#define SSDFS_SHDICT_NAMES_BATCH_MAX		(64)
+
+/*
+ * ssdfs_shdict_grab_names_batch() - move names into the batch
+ * @tree: shared dictionary tree's object
+ * @batch: list of names' batch [out]
+ *
+ * This method moves up to SSDFS_SHDICT_NAMES_BATCH_MAX names
+ * from the requests queue into the @batch.
+ *
+ * RETURN: number of names in the batch.
+ */
+static
+int ssdfs_shdict_grab_names_batch(struct ssdfs_shared_dict_btree_info *tree,
+				  struct list_head *batch)
+{
+	struct ssdfs_name_info *ni = NULL;
+	int count = 0;
+	int err;
+
+	while (count < SSDFS_SHDICT_NAMES_BATCH_MAX) {
+		err = ssdfs_names_queue_remove_first(&tree->requests.queue,
+						     &ni);
+		if (err == -ENODATA)
+			break;
+		else if (unlikely(err)) {
+			SSDFS_ERR("fail to get name: err %d\n", err);
+			break;
+		} else if (ni == NULL) {
+			SSDFS_ERR("invalid name info\n");
+			break;
+		}
+
+		list_add_tail(&ni->list, batch);
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * ssdfs_name_info_hash_cmp() - compare names by hash
+ */
+static
+int ssdfs_name_info_hash_cmp(void *priv,
+			     const struct list_head *a,
+			     const struct list_head *b)
+{
+	struct ssdfs_name_info *ni1, *ni2;
+
+	ni1 = list_entry(a, struct ssdfs_name_info, list);
+	ni2 = list_entry(b, struct ssdfs_name_info, list);
+
+	if (ni1->desc.name.hash < ni2->desc.name.hash)
+		return -1;
+	else if (ni1->desc.name.hash > ni2->desc.name.hash)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * ssdfs_shdict_add_names_batch() - add batch of names
+ * @tree: shared dictionary tree's object
+ * @search: search object
+ * @batch: list of names' batch
+ *
+ * This method adds the names of the batch into the dictionary
+ * in the order of hashes. As a result, the names of the same node
+ * are inserted one after another under one acquisition of
+ * the tree's lock. If some name cannot be added, then the rest
+ * of the batch is returned at the head of the requests queue.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+static
+int ssdfs_shdict_add_names_batch(struct ssdfs_shared_dict_btree_info *tree,
+				 struct ssdfs_btree_search *search,
+				 struct list_head *batch)
+{
+	struct ssdfs_name_info *ni, *tmp;
+	int err = 0;
+
+	list_sort(NULL, batch, ssdfs_name_info_hash_cmp);
+
+	down_write(&tree->lock);
+
+	list_for_each_entry_safe(ni, tmp, batch, list) {
+		list_del(&ni->list);
+
+		switch (ni->type) {
+		case SSDFS_NAME_ADD:
+			ssdfs_btree_search_init(search);
+
+			err = ssdfs_shared_dict_tree_add(tree,
+							 ni->desc.name.hash,
+							 ni->desc.name.str_buf,
+							 ni->desc.name.len,
+							 search);
+			if (err == -EEXIST) {
+				/* name exist -> do nothing */
+				err = 0;
+			} else if (unlikely(err)) {
+				ssdfs_fs_error(tree->generic_tree.fsi->sb,
+						__FILE__, __func__, __LINE__,
+						"fail to add name: "
+						"hash %llx, name %s, len %zu, "
+						"err %d\n",
+						ni->desc.name.hash,
+						ni->desc.name.str_buf,
+						ni->desc.name.len,
+						err);
+				ssdfs_name_info_free(ni);
+				goto finish_process_batch;
+			}
+			break;
+
+		case SSDFS_NAME_CHANGE:
+		case SSDFS_NAME_DELETE:
+			SSDFS_ERR("unsupported operation: "
+				  "type %#x, hash %llx, len %zu\n",
+				  ni->type,
+				  ni->desc.name.hash,
+				  ni->desc.name.len);
+			break;
+
+		default:
+			SSDFS_ERR("invalid operation type: "
+				  "type %#x, hash %llx, len %zu\n",
+				  ni->type,
+				  ni->desc.name.hash,
+				  ni->desc.name.len);
+			break;
+		};
+
+		ssdfs_name_info_free(ni);
+	}
+
+finish_process_batch:
+	up_write(&tree->lock);
+
+	while (!list_empty(batch)) {
+		ni = list_last_entry(batch, struct ssdfs_name_info, list);
+		list_del(&ni->list);
+		ssdfs_names_queue_add_head(&tree->requests.queue, ni);
+	}
+
+	return err;
+}
+
 #define SHDICT_PTR(tree) \
 	((struct ssdfs_shared_dict_btree_info *)(tree))
 #define SHDICT_THREAD_WAKE_CONDITION(tree) \
@@ -215,7 +368,7 @@ finish_thread:
 
 try_process_queue:
 	do {
-		struct ssdfs_name_info *ni = NULL;
+		LIST_HEAD(batch);
 
 		switch (atomic_read(&tree->state)) {
 		case SSDFS_SHDICT_BTREE_UNDER_INIT:
@@ -263,71 +416,12 @@ try_process_queue:
 		if (!has_queue_unprocessed_names(tree))
 			goto sleep_shared_dict_thread;
 
-		err = ssdfs_names_queue_remove_first(&ptr->queue, &ni);
-		if (err == -ENODATA) {
-			err = 0;
+		if (ssdfs_shdict_grab_names_batch(tree, &batch) == 0)
 			goto sleep_shared_dict_thread;
-		} else if (unlikely(err)) {
-			SSDFS_ERR("fail to get name: err %d\n", err);
-			goto repeat;
-		} else if (ni == NULL) {
-			err = -ERANGE;
-			SSDFS_ERR("invalid name info\n");
-			goto repeat;
-		}
-
-		switch (ni->type) {
-		case SSDFS_NAME_ADD:
-			ssdfs_btree_search_init(search);
-
-			down_write(&tree->lock);
-			err = ssdfs_shared_dict_tree_add(tree,
-							 ni->desc.name.hash,
-							 ni->desc.name.str_buf,
-							 ni->desc.name.len,
-							 search);
-			up_write(&tree->lock);
 
-			if (err == -EEXIST) {
-				/* name exist -> do nothing */
-				err = 0;
-				ssdfs_name_info_free(ni);
-				continue;
-			} else if (unlikely(err)) {
-				ssdfs_fs_error(tree->generic_tree.fsi->sb,
-						__FILE__, __func__, __LINE__,
-						"fail to add name: "
-						"hash %llx, name %s, len %zu, "
-						"err %d\n",
-						ni->desc.name.hash,
-						ni->desc.name.str_buf,
-						ni->desc.name.len,
-						err);
-				ssdfs_name_info_free(ni);
-				goto repeat;
-			} else
-				ssdfs_name_info_free(ni);
-			break;
-
-		case SSDFS_NAME_CHANGE:
-		case SSDFS_NAME_DELETE:
-			SSDFS_ERR("unsupported operation: "
-				  "type %#x, hash %llx, len %zu\n",
-				  ni->type,
-				  ni->desc.name.hash,
-				  ni->desc.name.len);
-			ssdfs_name_info_free(ni);
-			break;
-
-		default:
-			SSDFS_ERR("invalid operation type: "
-				  "type %#x, hash %llx, len %zu\n",
-				  ni->type,
-				  ni->desc.name.hash,
-				  ni->desc.name.len);
-			ssdfs_name_info_free(ni);
-			break;
-		};
+		err = ssdfs_shdict_add_names_batch(tree, search, &batch);
+		if (unlikely(err))
+			goto repeat;
 	} while (has_queue_unprocessed_names(tree));
 
 	if (kthread_should_stop())
@@ -21,6 +21,7 @@
 
 #include <linux/slab.h>
 #include <linux/pagevec.h>
+#include <crypto/sha2.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -1302,6 +1303,308 @@ int ssdfs_shextree_delete_all(struct ssdfs_shared_extents_tree *tree)
 	return err;
 }
 
+/*
+ * ssdfs_shextree_calculate_fingerprint() - calculate block's fingerprint
+ * @kaddr: pointer on block's content
+ * @size: size of block in bytes
+ * @fingerprint: calculated fingerprint [out]
+ *
+ * This method calculates SHA-256 fingerprint of the block's content.
+ * The strength of the hash excludes the necessity to compare
+ * the content of blocks with identical fingerprints.
+ */
+void ssdfs_shextree_calculate_fingerprint(const void *kaddr, u32 size,
+					  struct ssdfs_fingerprint *fingerprint)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!kaddr || !fingerprint);
+	BUILD_BUG_ON(SHA256_DIGEST_SIZE > SSDFS_FINGERPRINT_LENGTH_MAX);
+
+	SSDFS_DBG("kaddr %p, size %u\n", kaddr, size);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	memset(fingerprint, 0, sizeof(struct ssdfs_fingerprint));
+	sha256(kaddr, size, fingerprint->buf);
+	fingerprint->len = SHA256_DIGEST_SIZE;
+	fingerprint->type = SSDFS_SHA256_FINGERPRINT_TYPE;
+}
+
+/*
+ * ssdfs_shextree_dedup_block() - find duplicate of the block
+ * @tree: shared extents tree
+ * @fingerprint: fingerprint of block's content
+ * @extent: position of the duplicate on volume [out]
+ *
+ * This method tries to find an already stored block with
+ * the same @fingerprint. If the block has been found, then
+ * the reference counter of shared extent is incremented and
+ * the position of the block is returned in @extent. The caller
+ * should reference the returned block instead of writing
+ * the new one.
+ *
+ * RETURN:
+ * [success] - @extent contains position of the duplicate.
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ERANGE     - internal error.
+ * %-ENOMEM     - fail to allocate memory.
+ * %-ENODATA    - duplicate is absent in the tree.
+ */
+int ssdfs_shextree_dedup_block(struct ssdfs_shared_extents_tree *tree,
+				struct ssdfs_fingerprint *fingerprint,
+				struct ssdfs_raw_extent *extent)
+{
+	struct ssdfs_btree_search *search;
+	struct ssdfs_shared_extent *shared_extent;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !fingerprint || !extent);
+
+	SSDFS_DBG("tree %p, fingerprint %pUb\n",
+		  tree, fingerprint->buf);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	search = ssdfs_btree_search_alloc();
+	if (!search) {
+		SSDFS_ERR("fail to allocate btree search object\n");
+		return -ENOMEM;
+	}
+
+	ssdfs_btree_search_init(search);
+
+	err = ssdfs_shextree_find(tree, fingerprint, search);
+	if (err == -ENODATA) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("duplicate is absent: fingerprint %pUb\n",
+			  fingerprint->buf);
+#endif /* CONFIG_SSDFS_DEBUG */
+		goto finish_dedup_block;
+	} else if (unlikely(err)) {
+		SSDFS_ERR("fail to find shared extent: "
+			  "fingerprint %pUb, err %d\n",
+			  fingerprint->buf, err);
+		goto finish_dedup_block;
+	}
+
+	shared_extent = &search->raw.shared_extent;
+
+	if (shared_extent->fingerprint_type != fingerprint->type ||
+	    le32_to_cpu(shared_extent->extent.len) != 1) {
+		err = -ENODATA;
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("shared extent cannot be used for dedup: "
+			  "type %#x, len %u\n",
+			  shared_extent->fingerprint_type,
+			  le32_to_cpu(shared_extent->extent.len));
+#endif /* CONFIG_SSDFS_DEBUG */
+		goto finish_dedup_block;
+	}
+
+	ssdfs_memcpy(extent, 0, sizeof(struct ssdfs_raw_extent),
+		     &shared_extent->extent, 0, sizeof(struct ssdfs_raw_extent),
+		     sizeof(struct ssdfs_raw_extent));
+
+	err = ssdfs_shextree_ref_count_inc(tree, fingerprint, search);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to increment reference counter: "
+			  "fingerprint %pUb, err %d\n",
+			  fingerprint->buf, err);
+		goto finish_dedup_block;
+	}
+
+finish_dedup_block:
+	ssdfs_btree_search_free(search);
+
+	return err;
+}
+
+/*
+ * ssdfs_shextree_register_block() - register block for deduplication
+ * @tree: shared extents tree
+ * @fingerprint: fingerprint of block's content
+ * @extent: position of the block on volume
+ *
+ * This method tries to add the shared extent of the newly
+ * written block into the tree. The reference counter of
+ * the shared extent is equal to one.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ERANGE     - internal error.
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EEXIST     - block with the same fingerprint is registered already.
+ */
+int ssdfs_shextree_register_block(struct ssdfs_shared_extents_tree *tree,
+				  struct ssdfs_fingerprint *fingerprint,
+				  struct ssdfs_raw_extent *extent)
+{
+	struct ssdfs_btree_search *search;
+	struct ssdfs_shared_extent shared_extent;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !fingerprint || !extent);
+	BUG_ON(le32_to_cpu(extent->len) != 1);
+
+	SSDFS_DBG("tree %p, fingerprint %pUb, "
+		  "extent (seg_id %llu, logical_blk %u)\n",
+		  tree, fingerprint->buf,
+		  le64_to_cpu(extent->seg_id),
+		  le32_to_cpu(extent->logical_blk));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	memset(&shared_extent, 0, sizeof(struct ssdfs_shared_extent));
+	ssdfs_memcpy(shared_extent.fingerprint,
+		     0, SSDFS_FINGERPRINT_LENGTH_MAX,
+		     fingerprint->buf, 0, SSDFS_FINGERPRINT_LENGTH_MAX,
+		     fingerprint->len);
+	ssdfs_memcpy(&shared_extent.extent,
+		     0, sizeof(struct ssdfs_raw_extent),
+		     extent, 0, sizeof(struct ssdfs_raw_extent),
+		     sizeof(struct ssdfs_raw_extent));
+	shared_extent.fingerprint_len = fingerprint->len;
+	shared_extent.fingerprint_type = fingerprint->type;
+	shared_extent.ref_count = cpu_to_le64(1);
+
+	search = ssdfs_btree_search_alloc();
+	if (!search) {
+		SSDFS_ERR("fail to allocate btree search object\n");
+		return -ENOMEM;
+	}
+
+	ssdfs_btree_search_init(search);
+	err = ssdfs_shextree_add(tree, fingerprint, &shared_extent, search);
+	ssdfs_btree_search_free(search);
+
+	if (err == -EEXIST) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("block is registered already: "
+			  "fingerprint %pUb\n",
+			  fingerprint->buf);
+#endif /* CONFIG_SSDFS_DEBUG */
+	} else if (unlikely(err)) {
+		SSDFS_ERR("fail to add shared extent: "
+			  "fingerprint %pUb, err %d\n",
+			  fingerprint->buf, err);
+	}
+
+	return err;
+}
+
+/*
+ * ssdfs_shextree_release_block() - release reference on shared block
+ * @tree: shared extents tree
+ * @fingerprint: fingerprint of block's content
+ * @extent: position of the block on volume
+ * @ref_count: number of remaining references [out]
+ *
+ * This method tries to decrement the reference counter of
+ * the shared extent that describes the block at @extent.
+ * The shared extent is deleted from the tree if the last
+ * reference has been released. The caller can invalidate
+ * the block only if @ref_count is equal to zero.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ERANGE     - internal error.
+ * %-ENOMEM     - fail to allocate memory.
+ * %-ENODATA    - block is not shared.
+ */
+int ssdfs_shextree_release_block(struct ssdfs_shared_extents_tree *tree,
+				 struct ssdfs_fingerprint *fingerprint,
+				 struct ssdfs_raw_extent *extent,
+				 u64 *ref_count)
+{
+	struct ssdfs_btree_search *search;
+	struct ssdfs_shared_extent *shared_extent;
+	int err = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !fingerprint || !extent || !ref_count);
+
+	SSDFS_DBG("tree %p, fingerprint %pUb, "
+		  "extent (seg_id %llu, logical_blk %u)\n",
+		  tree, fingerprint->buf,
+		  le64_to_cpu(extent->seg_id),
+		  le32_to_cpu(extent->logical_blk));
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	*ref_count = 0;
+
+	search = ssdfs_btree_search_alloc();
+	if (!search) {
+		SSDFS_ERR("fail to allocate btree search object\n");
+		return -ENOMEM;
+	}
+
+	ssdfs_btree_search_init(search);
+
+	err = ssdfs_shextree_find(tree, fingerprint, search);
+	if (err == -ENODATA) {
+		goto finish_release_block;
+	} else if (unlikely(err)) {
+		SSDFS_ERR("fail to find shared extent: "
+			  "fingerprint %pUb, err %d\n",
+			  fingerprint->buf, err);
+		goto finish_release_block;
+	}
+
+	shared_extent = &search->raw.shared_extent;
+
+	if (shared_extent->extent.seg_id != extent->seg_id ||
+	    shared_extent->extent.logical_blk != extent->logical_blk) {
+		err = -ENODATA;
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("block is not shared: "
+			  "seg_id %llu, logical_blk %u\n",
+			  le64_to_cpu(extent->seg_id),
+			  le32_to_cpu(extent->logical_blk));
+#endif /* CONFIG_SSDFS_DEBUG */
+		goto finish_release_block;
+	}
+
+	*ref_count = le64_to_cpu(shared_extent->ref_count);
+
+	if (*ref_count <= 1) {
+		*ref_count = 0;
+
+		err = ssdfs_shextree_delete(tree, fingerprint, search);
+		if (err == -ENOENT) {
+			/* tree is empty now */
+			err = 0;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to delete shared extent: "
+				  "fingerprint %pUb, err %d\n",
+				  fingerprint->buf, err);
+		}
+
+		goto finish_release_block;
+	}
+
+	err = ssdfs_shextree_ref_count_dec(tree, fingerprint, search);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to decrement reference counter: "
+			  "fingerprint %pUb, err %d\n",
+			  fingerprint->buf, err);
+		goto finish_release_block;
+	}
+
+	(*ref_count)--;
+
+finish_release_block:
+	ssdfs_btree_search_free(search);
+
+	return err;
+}
+
 /*
  * ssdfs_shextree_add_pre_invalid_extent() - add pre-invalid extent into queue
  * @tree: shared extents tree
@@ -1876,8 +2179,8 @@ int ssdfs_shextree_pre_flush_root_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	err = ssdfs_btree_pre_flush_root_node(node);
 	if (unlikely(err)) {
@@ -1886,7 +2189,7 @@ int ssdfs_shextree_pre_flush_root_node(struct ssdfs_btree_node *node)
 			  node->node_id, err);
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	return err;
@@ -2036,7 +2339,7 @@ int ssdfs_shextree_create_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 	down_write(&node->bmap_array.lock);
 
 	switch (atomic_read(&node->type)) {
@@ -2207,7 +2510,7 @@ int ssdfs_shextree_create_node(struct ssdfs_btree_node *node)
 
 finish_create_node:
 	up_write(&node->bmap_array.lock);
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		return err;
@@ -2315,7 +2618,7 @@ int ssdfs_shextree_init_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	if (pagevec_count(&node->content.pvec) == 0) {
 		err = -ERANGE;
@@ -2350,7 +2653,7 @@ int ssdfs_shextree_init_node(struct ssdfs_btree_node *node)
 		goto finish_init_operation;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&node->raw.shextree_header, 0, hdr_size,
 		     hdr, 0, hdr_size,
@@ -2543,7 +2846,7 @@ int ssdfs_shextree_init_node(struct ssdfs_btree_node *node)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_header_init:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_init_operation;
@@ -2865,8 +3168,8 @@ int ssdfs_shextree_pre_flush_node(struct ssdfs_btree_node *node)
 					 generic_tree);
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&header, 0, hdr_size,
 		     &node->raw.shextree_header, 0, hdr_size,
@@ -2913,7 +3216,8 @@ int ssdfs_shextree_pre_flush_node(struct ssdfs_btree_node *node)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	header.node.check.bytes = cpu_to_le16((u16)hdr_size);
-	header.node.check.flags = cpu_to_le16(SSDFS_CRC32);
+	header.node.check.flags =
+		cpu_to_le16(ssdfs_csum_type(node->tree->fsi));
 
 	err = ssdfs_calculate_csum(&header.node.check,
 				   &header, hdr_size);
@@ -2927,7 +3231,7 @@ int ssdfs_shextree_pre_flush_node(struct ssdfs_btree_node *node)
 		     hdr_size);
 
 finish_shextree_header_preparation:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_node_pre_flush;
@@ -2991,7 +3295,7 @@ int ssdfs_shextree_flush_node(struct ssdfs_btree_node *node)
 
 	fsi = node->tree->fsi;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	fs_feature_compat = fsi->fs_feature_compat;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -4614,7 +4918,7 @@ int __ssdfs_shextree_node_insert_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -4805,7 +5109,7 @@ finish_detect_affected_items:
 		goto unlock_items_range;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	node->items_area.items_count += search->request.count;
 	if (node->items_area.items_count > node->items_area.items_capacity) {
@@ -4888,7 +5192,7 @@ finish_detect_affected_items:
 	atomic64_add(search->request.count, &tree_info->shared_extents);
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -5384,7 +5688,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 		return err;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	start_hash = node->items_area.start_hash;
 	end_hash = node->items_area.end_hash;
@@ -5434,7 +5738,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -5578,7 +5882,7 @@ int ssdfs_shextree_node_change_item(struct ssdfs_btree_node *node,
 		return -EFAULT;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -5758,7 +6062,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	switch (atomic_read(&node->items_area.state)) {
 	case SSDFS_BTREE_NODE_ITEMS_AREA_EXIST:
@@ -5788,7 +6092,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		break;
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -6123,7 +6427,7 @@ int __ssdfs_shextree_node_delete_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -6270,7 +6574,7 @@ finish_detect_affected_items:
 		}
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("INITIAL STATE: node_id %u, "
@@ -6435,7 +6739,7 @@ finish_detect_affected_items:
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -6673,7 +6977,7 @@ int ssdfs_shextree_node_extract_range(struct ssdfs_btree_node *node,
 		  search->node.child);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_node_extract_range(node, start_index, count,
 					sizeof(struct ssdfs_shared_extent),
 					search);
@@ -129,6 +129,19 @@ int ssdfs_shextree_delete(struct ssdfs_shared_extents_tree *tree,
 			  struct ssdfs_btree_search *search);
 int ssdfs_shextree_delete_all(struct ssdfs_shared_extents_tree *tree);
 
+void ssdfs_shextree_calculate_fingerprint(const void *kaddr, u32 size,
+					  struct ssdfs_fingerprint *fingerprint);
+int ssdfs_shextree_dedup_block(struct ssdfs_shared_extents_tree *tree,
+				struct ssdfs_fingerprint *fingerprint,
+				struct ssdfs_raw_extent *extent);
+int ssdfs_shextree_register_block(struct ssdfs_shared_extents_tree *tree,
+				  struct ssdfs_fingerprint *fingerprint,
+				  struct ssdfs_raw_extent *extent);
+int ssdfs_shextree_release_block(struct ssdfs_shared_extents_tree *tree,
+				 struct ssdfs_fingerprint *fingerprint,
+				 struct ssdfs_raw_extent *extent,
+				 u64 *ref_count);
+
 int ssdfs_shextree_add_pre_invalid_extent(struct ssdfs_shared_extents_tree *tree,
 					  u64 owner_ino,
 					  struct ssdfs_raw_extent *extent);
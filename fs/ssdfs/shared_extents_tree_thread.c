@@ -24,6 +24,7 @@
 #include <linux/slab.h>
 #include <linux/kthread.h>
 #include <linux/pagevec.h>
+#include <linux/list_sort.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -58,42 +59,6 @@ bool has_shextree_pre_invalid_extents(struct ssdfs_shared_extents_tree *tree,
 	return !is_ssdfs_extents_queue_empty(queue);
 }
 
-/*
- * ssdfs_shextree_invalidate_extent() - invalidate extent
- * @tree: shared extents tree's object
- * @ei: extent info
- */
-static
-int ssdfs_shextree_invalidate_extent(struct ssdfs_shared_extents_tree *tree,
-				     struct ssdfs_extent_info *ei)
-{
-	u64 seg_id;
-	u32 logical_blk;
-	u32 len;
-
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!tree || !ei);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	seg_id = le64_to_cpu(ei->raw.extent.seg_id);
-	logical_blk = le32_to_cpu(ei->raw.extent.logical_blk);
-	len = le32_to_cpu(ei->raw.extent.len);
-
-#ifdef CONFIG_SSDFS_DEBUG
-	SSDFS_DBG("tree %p, ei %p, seg_id %llu, "
-		  "logical_blk %u, len %u\n",
-		  tree, ei, seg_id, logical_blk, len);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	if (ei->type != SSDFS_EXTENT_INFO_RAW_EXTENT) {
-		SSDFS_ERR("invalid type %#x\n",
-			  ei->type);
-		return -ERANGE;
-	}
-
-	return ssdfs_invalidate_extent(tree->fsi, &ei->raw.extent);
-}
-
 /*
  * ssdfs_shextree_invalidate_index() - invalidate index
  * @tree: shared extents tree's object
@@ -227,6 +192,240 @@ int ssdfs_shextree_try_merge_extents(struct ssdfs_extent_info *ei,
 	return 0;
 }
 
+#define SSDFS_SHEXTREE_INVALIDATION_BATCH_MAX	(256)
+
+/*
+ * ssdfs_shextree_grab_extents_batch() - move extents into the batch
+ * @eq: extents queue
+ * @batch: list of extents' batch [out]
+ *
+ * RETURN: number of extents in the batch.
+ */
+static inline
+int ssdfs_shextree_grab_extents_batch(struct ssdfs_extents_queue *eq,
+				      struct list_head *batch)
+{
+	return ssdfs_extents_queue_remove_batch(eq, batch,
+					SSDFS_SHEXTREE_INVALIDATION_BATCH_MAX);
+}
+
+/*
+ * ssdfs_extent_info_cmp() - compare extents by segment and block
+ */
+static
+int ssdfs_extent_info_cmp(void *priv,
+			  const struct list_head *a,
+			  const struct list_head *b)
+{
+	struct ssdfs_extent_info *ei1, *ei2;
+	u64 seg_id1, seg_id2;
+	u32 blk1, blk2;
+
+	ei1 = list_entry(a, struct ssdfs_extent_info, list);
+	ei2 = list_entry(b, struct ssdfs_extent_info, list);
+
+	if (ei1->type != ei2->type)
+		return ei1->type < ei2->type ? -1 : 1;
+
+	if (ei1->type != SSDFS_EXTENT_INFO_RAW_EXTENT)
+		return 0;
+
+	seg_id1 = le64_to_cpu(ei1->raw.extent.seg_id);
+	seg_id2 = le64_to_cpu(ei2->raw.extent.seg_id);
+
+	if (seg_id1 != seg_id2)
+		return seg_id1 < seg_id2 ? -1 : 1;
+
+	blk1 = le32_to_cpu(ei1->raw.extent.logical_blk);
+	blk2 = le32_to_cpu(ei2->raw.extent.logical_blk);
+
+	if (blk1 != blk2)
+		return blk1 < blk2 ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * ssdfs_shextree_merge_extents_batch() - merge contiguous extents
+ * @batch: sorted list of extents' batch
+ */
+static
+void ssdfs_shextree_merge_extents_batch(struct list_head *batch)
+{
+	struct ssdfs_extent_info *ei, *next_ei;
+
+	list_for_each_entry(ei, batch, list) {
+		while (!list_is_last(&ei->list, batch)) {
+			next_ei = list_next_entry(ei, list);
+
+			if (ssdfs_shextree_try_merge_extents(ei, next_ei))
+				break;
+
+			list_del(&next_ei->list);
+			ssdfs_extent_info_free(next_ei);
+		}
+	}
+}
+
+/*
+ * ssdfs_shextree_throttle() - respect invalidation budget
+ * @tree: shared extents tree's object
+ * @window_start: starting time of the current budget's window
+ * @segs: number of invalidated segments in the current window
+ *
+ * The invalidation budget (mount option) limits the number
+ * of segments that are invalidated per second. The thread sleeps
+ * till the end of the current window if the budget is exhausted.
+ */
+static
+void ssdfs_shextree_throttle(struct ssdfs_shared_extents_tree *tree,
+			     unsigned long *window_start,
+			     u32 *segs)
+{
+	u32 budget = tree->fsi->invalidation_budget;
+	long timeout;
+
+	if (budget == 0)
+		return;
+
+	if (time_after_eq(jiffies, *window_start + HZ)) {
+		*window_start = jiffies;
+		*segs = 0;
+	}
+
+	(*segs)++;
+
+	if (*segs < budget)
+		return;
+
+	timeout = (long)(*window_start + HZ - jiffies);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("budget %u is exhausted: timeout %ld\n",
+		  budget, timeout);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (timeout > 0 && !kthread_should_stop()) {
+		wait_event_interruptible_timeout(tree->wait_queue,
+						 kthread_should_stop(),
+						 timeout);
+	}
+
+	*window_start = jiffies;
+	*segs = 0;
+}
+
+/*
+ * ssdfs_shextree_invalidate_batch() - invalidate batch of extents
+ * @tree: shared extents tree's object
+ * @batch: list of extents' batch
+ * @window_start: starting time of the current budget's window
+ * @segs: number of invalidated segments in the current window
+ *
+ * This method sorts the extents by segment ID and logical block,
+ * merges the contiguous extents and invalidates the extents
+ * of every segment by one request. The extents of busy segments
+ * are returned at the tail of the queue.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+static
+int ssdfs_shextree_invalidate_batch(struct ssdfs_shared_extents_tree *tree,
+				    struct list_head *batch,
+				    unsigned long *window_start,
+				    u32 *segs)
+{
+	struct ssdfs_extents_queue *eq;
+	struct ssdfs_extent_info *ei, *tmp;
+	LIST_HEAD(seg_extents);
+	LIST_HEAD(postponed);
+	u64 seg_id;
+	int err = 0;
+
+	eq = &tree->array[SSDFS_EXTENT_INVALIDATION_QUEUE].queue;
+
+	list_sort(NULL, batch, ssdfs_extent_info_cmp);
+	ssdfs_shextree_merge_extents_batch(batch);
+
+	while (!list_empty(batch)) {
+		ei = list_first_entry(batch, struct ssdfs_extent_info, list);
+
+		if (ei->type != SSDFS_EXTENT_INFO_RAW_EXTENT) {
+			err = -ERANGE;
+			SSDFS_ERR("invalid type %#x\n",
+				  ei->type);
+			goto finish_invalidate_batch;
+		}
+
+		seg_id = le64_to_cpu(ei->raw.extent.seg_id);
+
+		list_for_each_entry_safe(ei, tmp, batch, list) {
+			if (ei->type != SSDFS_EXTENT_INFO_RAW_EXTENT ||
+			    le64_to_cpu(ei->raw.extent.seg_id) != seg_id)
+				break;
+
+			list_move_tail(&ei->list, &seg_extents);
+		}
+
+		err = ssdfs_invalidate_segment_extents(tree->fsi, seg_id,
+							&seg_extents);
+		if (err == -ENODATA && kthread_should_stop()) {
+			ssdfs_fs_error(tree->fsi->sb,
+				__FILE__, __func__, __LINE__,
+				"fail to invalidate extents: "
+				"seg_id %llu, err %d\n",
+				seg_id, err);
+			goto finish_invalidate_batch;
+		} else if (err == -ENODATA || err == -EBUSY) {
+			err = 0;
+			list_splice_tail_init(&seg_extents, &postponed);
+
+#ifdef CONFIG_SSDFS_DEBUG
+			SSDFS_DBG("return extents to queue: "
+				  "seg_id %llu\n", seg_id);
+#endif /* CONFIG_SSDFS_DEBUG */
+			continue;
+		} else if (err) {
+			ssdfs_fs_error(tree->fsi->sb,
+				__FILE__, __func__, __LINE__,
+				"fail to invalidate extents: "
+				"seg_id %llu, err %d\n",
+				seg_id, err);
+			goto finish_invalidate_batch;
+		}
+
+		ssdfs_shextree_throttle(tree, window_start, segs);
+	}
+
+finish_invalidate_batch:
+	if (err) {
+		list_splice_tail_init(&seg_extents, batch);
+		list_splice_tail_init(&postponed, batch);
+
+		list_for_each_entry_safe(ei, tmp, batch, list) {
+			list_del(&ei->list);
+			ssdfs_extent_info_free(ei);
+		}
+
+		return err;
+	}
+
+	if (!list_empty(&postponed)) {
+		list_for_each_entry_safe(ei, tmp, &postponed, list) {
+			list_del(&ei->list);
+			ssdfs_extents_queue_add_tail(eq, ei);
+		}
+
+		wait_event_interruptible_timeout(tree->wait_queue,
+						 kthread_should_stop(),
+						 HZ);
+	}
+
+	return 0;
+}
+
 #define SHEXTREE_PTR(tree) \
 	((struct ssdfs_shared_extents_tree *)(tree))
 #define SHEXTREE_THREAD_WAKE_CONDITION(tree, index) \
@@ -246,6 +445,8 @@ int ssdfs_shextree_extent_thread_func(void *data)
 	struct ssdfs_invalidation_queue *ptr = NULL;
 	struct ssdfs_extents_queue *eq = NULL;
 	int id = SSDFS_EXTENT_INVALIDATION_QUEUE;
+	unsigned long window_start = jiffies;
+	u32 segs = 0;
 	int state;
 	int err = 0;
 
@@ -288,7 +489,7 @@ finish_thread:
 
 try_invalidate_queue:
 	do {
-		struct ssdfs_extent_info *ei = NULL, *next_ei = NULL;
+		LIST_HEAD(batch);
 
 		state = atomic_read(&tree->fsi->global_fs_state);
 		switch (state) {
@@ -318,89 +519,13 @@ try_invalidate_queue:
 			break;
 		}
 
-		err = ssdfs_extents_queue_remove_first(eq, &ei);
-		if (err == -ENODATA) {
-			err = 0;
+		if (ssdfs_shextree_grab_extents_batch(eq, &batch) == 0)
 			goto sleep_shextree_thread;
-		} else if (unlikely(err)) {
-			SSDFS_ERR("fail to get extent for invalidation: "
-				  "err %d\n",
-				  err);
-			goto repeat;
-		} else if (ei == NULL) {
-			err = -ERANGE;
-			SSDFS_ERR("invalid extent info\n");
-			goto repeat;
-		}
-
-		do {
-			if (!has_shextree_pre_invalid_extents(tree, id))
-				break;
-
-			err = ssdfs_extents_queue_remove_first(eq, &next_ei);
-			if (!err) {
-				err = ssdfs_shextree_try_merge_extents(ei,
-								    next_ei);
-				if (err) {
-					ssdfs_extents_queue_add_head(eq,
-								     next_ei);
-				} else
-					ssdfs_extent_info_free(next_ei);
-			}
-		} while (err == 0);
-
-		err = ssdfs_shextree_invalidate_extent(tree, ei);
-		if (err == -ENODATA) {
-			if (kthread_should_stop()) {
-				ssdfs_fs_error(tree->fsi->sb,
-					__FILE__, __func__, __LINE__,
-					"fail to invalidate extent: "
-					"(seg_id %llu, logical_blk %u, len %u), "
-					"err %d\n",
-					le64_to_cpu(ei->raw.extent.seg_id),
-					le32_to_cpu(ei->raw.extent.logical_blk),
-					le32_to_cpu(ei->raw.extent.len),
-					err);
-				ssdfs_extent_info_free(ei);
-				goto repeat;
-			} else {
-				err = 0;
-				ssdfs_extents_queue_add_tail(eq, ei);
-
-#ifdef CONFIG_SSDFS_DEBUG
-				SSDFS_DBG("return extent to queue: "
-					  "(seg_id %llu, logical_blk %u, len %u)\n",
-					  le64_to_cpu(ei->raw.extent.seg_id),
-					  le32_to_cpu(ei->raw.extent.logical_blk),
-					  le32_to_cpu(ei->raw.extent.len));
-#endif /* CONFIG_SSDFS_DEBUG */
 
-				wait_event_interruptible_timeout(*wait_queue,
-							kthread_should_stop(),
-							HZ);
-				continue;
-			}
-		} else if (err == -EBUSY) {
-			err = 0;
-			ssdfs_extents_queue_add_tail(eq, ei);
-			wait_event_interruptible_timeout(*wait_queue,
-						kthread_should_stop(),
-						HZ);
-			continue;
-		} else if (err) {
-			ssdfs_fs_error(tree->fsi->sb,
-				__FILE__, __func__, __LINE__,
-				"fail to invalidate extent: "
-				"(seg_id %llu, logical_blk %u, len %u), "
-				"err %d\n",
-				le64_to_cpu(ei->raw.extent.seg_id),
-				le32_to_cpu(ei->raw.extent.logical_blk),
-				le32_to_cpu(ei->raw.extent.len),
-				err);
-			ssdfs_extent_info_free(ei);
+		err = ssdfs_shextree_invalidate_batch(tree, &batch,
+						      &window_start, &segs);
+		if (unlikely(err))
 			goto repeat;
-		} else
-			ssdfs_extent_info_free(ei);
 	} while (has_shextree_pre_invalid_extents(tree, id));
 
 	if (kthread_should_stop())
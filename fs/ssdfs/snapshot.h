@@ -78,6 +78,52 @@ struct ssdfs_snapshot_rule_details {
 	u8 uuid[SSDFS_UUID_SIZE];
 };
 
+/*
+ * struct ssdfs_changed_inode_details - changed inode details
+ * @ino: inode ID
+ * @flags: change flags
+ * @mode: file mode
+ * @ctime: change timestamp (nanoseconds)
+ * @mtime: modification timestamp (nanoseconds)
+ * @size: file size in bytes
+ * @parent_ino: parent inode ID
+ */
+struct ssdfs_changed_inode_details {
+	u64 ino;
+#define SSDFS_INODE_CREATED_IN_RANGE		(1 << 0)
+#define SSDFS_INODE_CHANGED_IN_RANGE		(1 << 1)
+	u32 flags;
+	u32 mode;
+	u64 ctime;
+	u64 mtime;
+	u64 size;
+	u64 parent_ino;
+};
+
+/*
+ * struct ssdfs_snapshot_diff_info - request of changes between snapshots
+ * @start_time: create timestamp of the older snapshot
+ * @end_time: create timestamp of the newer snapshot (U64_MAX means now)
+ * @start_ino: inode ID to start the search from [in|out]
+ * @count: number of details in the buffer [out]
+ * @buf: buffer to share the changed inode details
+ * @buf_size: size of buffer in bytes
+ *
+ * The create timestamps of snapshots can be retrieved by
+ * SSDFS_IOC_LIST_SNAPSHOTS. If the buffer is full, then
+ * @start_ino contains the inode ID to continue the search from.
+ * The @start_ino is U64_MAX when the search has been finished.
+ */
+struct ssdfs_snapshot_diff_info {
+	u64 start_time;
+	u64 end_time;
+	u64 start_ino;
+	u64 count;
+
+	char __user *buf;
+	u64 buf_size;
+};
+
 /*
  * struct ssdfs_snapshot_info - snapshot details
  * @name: snapshot name
@@ -137,10 +183,12 @@ struct ssdfs_snapshot_request {
  * struct ssdfs_snapshot_rule_item - snapshot rule item
  * @list: snapshot rules list
  * @rule: snapshot rule's info
+ * @next_due_cno: checkpoint when the next snapshot of the rule is due
  */
 struct ssdfs_snapshot_rule_item {
 	struct list_head list;
 	struct ssdfs_snapshot_rule_info rule;
+	u64 next_due_cno;
 };
 
 /*
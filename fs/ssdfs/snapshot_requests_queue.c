@@ -466,7 +466,7 @@ int ssdfs_add_snapshot_rule(struct ssdfs_fs_info *fsi,
 
 	ptr->rule.last_snapshot_cno = cpu_to_le64(SSDFS_INVALID_CNO);
 
-	ssdfs_snapshot_rules_list_add_tail(rl, ptr);
+	ssdfs_snapshot_rules_list_add(rl, ptr);
 
 	return 0;
 
@@ -94,6 +94,7 @@ void ssdfs_snapshot_rules_list_init(struct ssdfs_snapshot_rules_list *rl)
 
 	spin_lock_init(&rl->lock);
 	INIT_LIST_HEAD(&rl->list);
+	rl->next_due_cno = U64_MAX;
 }
 
 /*
@@ -116,32 +117,122 @@ bool is_ssdfs_snapshot_rules_list_empty(struct ssdfs_snapshot_rules_list *rl)
 }
 
 /*
- * ssdfs_snapshot_rules_list_add_head() - add rule at the head of list
+ * ssdfs_snapshot_rule_next_due() - calculate next due checkpoint of rule
+ * @rule: snapshot rule
+ *
+ * This function calculates the checkpoint when the next snapshot
+ * of the @rule has to be created. The rule without any snapshot
+ * is due immediately.
+ */
+static inline
+u64 ssdfs_snapshot_rule_next_due(struct ssdfs_snapshot_rule_info *rule)
+{
+	u64 last_snapshot_cno;
+	u64 secs_per_day = (u64)SSDFS_HOURS_PER_DAY * SSDFS_SECS_PER_HOUR;
+	u64 secs_per_week = secs_per_day * SSDFS_DAYS_PER_WEEK;
+	u64 secs_per_month = secs_per_week * SSDFS_WEEKS_PER_MONTH;
+	u64 period_secs;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!rule);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (rule->type != SSDFS_PERIODIC_SNAPSHOT)
+		return U64_MAX;
+
+	last_snapshot_cno = le64_to_cpu(rule->last_snapshot_cno);
+
+	if (last_snapshot_cno >= SSDFS_INVALID_CNO)
+		return 0;
+
+	switch (rule->frequency) {
+	case SSDFS_SYNCFS_FREQUENCY:
+		/* any next syncfs */
+		return last_snapshot_cno + 1;
+
+	case SSDFS_HOUR_FREQUENCY:
+		period_secs = SSDFS_SECS_PER_HOUR;
+		break;
+
+	case SSDFS_DAY_FREQUENCY:
+		period_secs = secs_per_day;
+		break;
+
+	case SSDFS_WEEK_FREQUENCY:
+		period_secs = secs_per_week;
+		break;
+
+	case SSDFS_MONTH_FREQUENCY:
+		period_secs = secs_per_month;
+		break;
+
+	default:
+		SSDFS_ERR("unexpected frequency %#x\n",
+			  rule->frequency);
+		return U64_MAX;
+	}
+
+	return last_snapshot_cno + (period_secs * SSDFS_NANOSECS_PER_SEC);
+}
+
+/*
+ * ssdfs_snapshot_rules_list_update_due() - update earliest due checkpoint
+ * @rl: snapshot rules list
+ *
+ * The caller has to hold the list's lock.
+ */
+static inline
+void ssdfs_snapshot_rules_list_update_due(struct ssdfs_snapshot_rules_list *rl)
+{
+	struct ssdfs_snapshot_rule_item *first;
+
+	if (list_empty(&rl->list)) {
+		rl->next_due_cno = U64_MAX;
+		return;
+	}
+
+	first = list_first_entry(&rl->list,
+				 struct ssdfs_snapshot_rule_item, list);
+	rl->next_due_cno = first->next_due_cno;
+}
+
+/*
+ * __ssdfs_snapshot_rules_list_add() - add rule in the order of due time
  * @rl: snapshot rules list
  * @ri: snapshot rule item
+ *
+ * This function inserts @ri after all rules that are due not later
+ * than @ri. The caller has to hold the list's lock.
  */
-void ssdfs_snapshot_rules_list_add_head(struct ssdfs_snapshot_rules_list *rl,
-					struct ssdfs_snapshot_rule_item *ri)
+static
+void __ssdfs_snapshot_rules_list_add(struct ssdfs_snapshot_rules_list *rl,
+				     struct ssdfs_snapshot_rule_item *ri)
 {
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!rl || !ri);
+	struct ssdfs_snapshot_rule_item *cur;
 
-	SSDFS_DBG("rl %p, ri %p\n",
-		  rl, ri);
-#endif /* CONFIG_SSDFS_DEBUG */
+	list_for_each_entry_reverse(cur, &rl->list, list) {
+		if (cur->next_due_cno <= ri->next_due_cno) {
+			list_add(&ri->list, &cur->list);
+			goto finish_add_rule;
+		}
+	}
 
-	spin_lock(&rl->lock);
 	list_add(&ri->list, &rl->list);
-	spin_unlock(&rl->lock);
+
+finish_add_rule:
+	ssdfs_snapshot_rules_list_update_due(rl);
 }
 
 /*
- * ssdfs_snapshot_rules_list_add_tail() - add rule at the tail of list
+ * ssdfs_snapshot_rules_list_add() - add rule into the list
  * @rl: snapshot rules list
  * @ri: snapshot rule item
+ *
+ * This function adds the rule into the list in the order
+ * of the next due checkpoint.
  */
-void ssdfs_snapshot_rules_list_add_tail(struct ssdfs_snapshot_rules_list *rl,
-					struct ssdfs_snapshot_rule_item *ri)
+void ssdfs_snapshot_rules_list_add(struct ssdfs_snapshot_rules_list *rl,
+				   struct ssdfs_snapshot_rule_item *ri)
 {
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(!rl || !ri);
@@ -150,8 +241,10 @@ void ssdfs_snapshot_rules_list_add_tail(struct ssdfs_snapshot_rules_list *rl,
 		  rl, ri);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+	ri->next_due_cno = ssdfs_snapshot_rule_next_due(&ri->rule);
+
 	spin_lock(&rl->lock);
-	list_add_tail(&ri->list, &rl->list);
+	__ssdfs_snapshot_rules_list_add(rl, ri);
 	spin_unlock(&rl->lock);
 }
 
@@ -175,6 +268,7 @@ void ssdfs_snapshot_rules_list_remove_all(struct ssdfs_snapshot_rules_list *rl)
 	is_empty = list_empty_careful(&rl->list);
 	if (!is_empty)
 		list_replace_init(&rl->list, &tmp_list);
+	rl->next_due_cno = U64_MAX;
 	spin_unlock(&rl->lock);
 
 	if (is_empty)
@@ -275,78 +369,14 @@ bool is_snapshot_rule_expired(struct ssdfs_snapshot_rule_item *ptr)
 	return snapshots_number >= snapshots_threshold;
 }
 
-/*
- * is_time_create_snapshot() - is it time to create snapshot
- * @fsi: pointer on shared file system object
- * @ptr: snapshot rule
- *
- * This function tries to check that it's time to create snapshot.
- */
-static inline
-bool is_time_create_snapshot(struct ssdfs_fs_info *fsi,
-			     struct ssdfs_snapshot_rule_info *ptr)
-{
-	u8 frequency;
-	u64 last_snapshot_cno;
-	u64 cno;
-	u64 diff_cno;
-	u64 diff_secs;
-	u64 secs_per_day = (u64)SSDFS_HOURS_PER_DAY * SSDFS_SECS_PER_HOUR;
-	u64 secs_per_week = secs_per_day * SSDFS_DAYS_PER_WEEK;
-	u64 secs_per_month = secs_per_week * SSDFS_WEEKS_PER_MONTH;
-
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!ptr);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	frequency = ptr->frequency;
-	last_snapshot_cno = le64_to_cpu(ptr->last_snapshot_cno);
-
-	if (last_snapshot_cno >= SSDFS_INVALID_CNO)
-		return true;
-
-	cno = ssdfs_current_cno(fsi->sb);
-
-	if (last_snapshot_cno >= cno) {
-		SSDFS_ERR("last_snapshot_cno %llu >= cno %llu\n",
-			  last_snapshot_cno, cno);
-		return false;
-	}
-
-	diff_cno = cno - last_snapshot_cno;
-	diff_secs = div64_u64(diff_cno, SSDFS_NANOSECS_PER_SEC);
-
-	switch (frequency) {
-	case SSDFS_SYNCFS_FREQUENCY:
-		return true;
-
-	case SSDFS_HOUR_FREQUENCY:
-		return diff_secs >= SSDFS_SECS_PER_HOUR;
-
-	case SSDFS_DAY_FREQUENCY:
-		return diff_secs >= secs_per_day;
-
-	case SSDFS_WEEK_FREQUENCY:
-		return diff_secs >= secs_per_week;
-
-	case SSDFS_MONTH_FREQUENCY:
-		return diff_secs >= secs_per_month;
-
-	default:
-		/* do nothing */
-		SSDFS_ERR("unexpected frequency %#x\n",
-			  frequency);
-	}
-
-	return false;
-}
-
 /*
  * ssdfs_create_snapshot() - create snapshot
  * @fsi: pointer on shared file system object
  * @ptr: snapshot rule
  *
- * This function tries to create a snapshot.
+ * This function tries to create a snapshot. The request is only
+ * added into the snapshots tree's queue and the caller has to wake up
+ * the snapshots tree's thread.
  *
  * RETURN:
  * [success]
@@ -431,7 +461,6 @@ int ssdfs_create_snapshot(struct ssdfs_fs_info *fsi,
 
 	tree = fsi->snapshots.tree;
 	ssdfs_snapshot_reqs_queue_add_tail(&tree->requests.queue, snr);
-	wake_up_all(&tree->wait_queue);
 
 	return 0;
 }
@@ -440,8 +469,11 @@ int ssdfs_create_snapshot(struct ssdfs_fs_info *fsi,
  * ssdfs_process_snapshot_rules() - process existing snapshot rules
  * @fsi: pointer on shared file system object
  *
- * This function tries to process the existing snapshot rules
- * and to create snapshots.
+ * This function tries to process the due snapshot rules
+ * and to create snapshots. The rules list is sorted by due time.
+ * So, only the head of the list is checked and nothing is done
+ * if the earliest rule is not due yet. Snapshot requests of the whole
+ * due batch are queued before the snapshots tree's thread is woken up.
  *
  * RETURN:
  * [success]
@@ -454,10 +486,12 @@ int ssdfs_create_snapshot(struct ssdfs_fs_info *fsi,
 int ssdfs_process_snapshot_rules(struct ssdfs_fs_info *fsi)
 {
 	struct ssdfs_snapshot_rules_list *rl = NULL;
-	struct list_head *this, *next;
+	struct ssdfs_snapshots_btree_info *tree;
 	struct ssdfs_snapshot_rule_item *ptr = NULL;
 	struct ssdfs_snapshot_rule_info rule;
 	size_t rule_size = sizeof(struct ssdfs_snapshot_rule_info);
+	u64 cur_cno;
+	u32 queued = 0;
 	int err = 0;
 
 #ifdef CONFIG_SSDFS_DEBUG
@@ -467,15 +501,24 @@ int ssdfs_process_snapshot_rules(struct ssdfs_fs_info *fsi)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	rl = &fsi->snapshots.rules_list;
+	cur_cno = ssdfs_current_cno(fsi->sb);
 
-	if (is_ssdfs_snapshot_rules_list_empty(rl)) {
-		SSDFS_DBG("snapshot rules list is empty\n");
-		return 0;
+	spin_lock(&rl->lock);
+
+	if (rl->next_due_cno > cur_cno) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("nothing is due: next_due_cno %llu, cno %llu\n",
+			  rl->next_due_cno, cur_cno);
+#endif /* CONFIG_SSDFS_DEBUG */
+		goto finish_process_rules;
 	}
 
-	spin_lock(&rl->lock);
-	list_for_each_safe(this, next, &rl->list) {
-		ptr = list_entry(this, struct ssdfs_snapshot_rule_item, list);
+	while (!list_empty(&rl->list)) {
+		ptr = list_first_entry(&rl->list,
+					struct ssdfs_snapshot_rule_item, list);
+
+		if (ptr->next_due_cno > cur_cno)
+			break;
 
 		if (is_snapshot_rule_expired(ptr)) {
 			list_del(&ptr->list);
@@ -483,41 +526,70 @@ int ssdfs_process_snapshot_rules(struct ssdfs_fs_info *fsi)
 			continue;
 		}
 
+		if (ptr->rule.type != SSDFS_PERIODIC_SNAPSHOT) {
+			err = -ERANGE;
+			SSDFS_ERR("invalid rule type %#x\n",
+				  ptr->rule.type);
+			list_del(&ptr->list);
+			ptr->next_due_cno = U64_MAX;
+			__ssdfs_snapshot_rules_list_add(rl, ptr);
+			continue;
+		}
+
 		ssdfs_memcpy(&rule, 0, rule_size,
 			     &ptr->rule, 0, rule_size,
 			     rule_size);
 
 		spin_unlock(&rl->lock);
 
-		if (rule.type != SSDFS_PERIODIC_SNAPSHOT) {
-			err = -ERANGE;
-			SSDFS_ERR("invalid rule type %#x\n",
-				  rule.type);
-			goto try_next_rule;
+		err = ssdfs_create_snapshot(fsi, &rule);
+
+		spin_lock(&rl->lock);
+
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to create snapshot: "
+				  "UUID %pUb, err %d\n",
+				  rule.uuid, err);
+			break;
 		}
 
-		if (is_time_create_snapshot(fsi, &rule)) {
-			err = ssdfs_create_snapshot(fsi, &rule);
-			if (unlikely(err)) {
-				SSDFS_ERR("fail to create snapshot: "
-					  "UUID %pUb, err %d\n",
-					  rule.uuid, err);
-			}
+		queued++;
+
+		if (list_empty(&rl->list) ||
+		    ptr != list_first_entry(&rl->list,
+					    struct ssdfs_snapshot_rule_item,
+					    list)) {
+			/*
+			 * The rule has been changed concurrently.
+			 * The rest of due rules will be processed later.
+			 */
+			break;
 		}
 
-try_next_rule:
-		spin_lock(&rl->lock);
+		list_del(&ptr->list);
+		le16_add_cpu(&ptr->rule.snapshots_number, 1);
+		ptr->rule.last_snapshot_cno =
+			cpu_to_le64(ssdfs_current_cno(fsi->sb));
 
-		if (!err) {
-			ptr = list_entry(this, struct ssdfs_snapshot_rule_item,
-					 list);
-			le16_add_cpu(&ptr->rule.snapshots_number, 1);
-			ptr->rule.last_snapshot_cno =
-				cpu_to_le64(ssdfs_current_cno(fsi->sb));
+		if (is_snapshot_rule_expired(ptr)) {
+			ssdfs_snapshot_rule_free(ptr);
+			continue;
 		}
+
+		ptr->next_due_cno = ssdfs_snapshot_rule_next_due(&ptr->rule);
+		__ssdfs_snapshot_rules_list_add(rl, ptr);
 	}
+
+	ssdfs_snapshot_rules_list_update_due(rl);
+
+finish_process_rules:
 	spin_unlock(&rl->lock);
 
+	if (queued > 0) {
+		tree = fsi->snapshots.tree;
+		wake_up_all(&tree->wait_queue);
+	}
+
 	return err;
 }
 
@@ -622,6 +694,10 @@ int ssdfs_modify_snapshot_rule(struct ssdfs_fs_info *fsi,
 				cpu_to_le16((u16)snr->info.snapshots_threshold);
 		}
 
+		list_del(&ptr->list);
+		ptr->next_due_cno = ssdfs_snapshot_rule_next_due(&ptr->rule);
+		__ssdfs_snapshot_rules_list_add(rl, ptr);
+
 		err = 0;
 		goto finish_process_rules;
 	}
@@ -726,6 +802,7 @@ int ssdfs_remove_snapshot_rule(struct ssdfs_snapshot_subsystem *snapshots,
 		err = 0;
 		list_del(&ptr->list);
 		ssdfs_snapshot_rule_free(ptr);
+		ssdfs_snapshot_rules_list_update_due(rl);
 		goto finish_process_rules;
 	}
 finish_process_rules:
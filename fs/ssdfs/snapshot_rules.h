@@ -18,10 +18,16 @@
  * struct ssdfs_snapshot_rules_list - snapshot rules list descriptor
  * @lock: snapshot rules list's lock
  * @list: snapshot rules list
+ * @next_due_cno: the earliest due checkpoint among the rules
+ *
+ * The list is sorted by the next due checkpoint of the rules.
+ * As a result, the due rules are always at the head of the list
+ * and the check that nothing is due needs only @next_due_cno.
  */
 struct ssdfs_snapshot_rules_list {
 	spinlock_t lock;
 	struct list_head list;
+	u64 next_due_cno;
 };
 
 /*
@@ -29,10 +35,8 @@ struct ssdfs_snapshot_rules_list {
  */
 void ssdfs_snapshot_rules_list_init(struct ssdfs_snapshot_rules_list *rl);
 bool is_ssdfs_snapshot_rules_list_empty(struct ssdfs_snapshot_rules_list *rl);
-void ssdfs_snapshot_rules_list_add_tail(struct ssdfs_snapshot_rules_list *rl,
-					struct ssdfs_snapshot_rule_item *ri);
-void ssdfs_snapshot_rules_list_add_head(struct ssdfs_snapshot_rules_list *rl,
-					struct ssdfs_snapshot_rule_item *ri);
+void ssdfs_snapshot_rules_list_add(struct ssdfs_snapshot_rules_list *rl,
+				   struct ssdfs_snapshot_rule_item *ri);
 void ssdfs_snapshot_rules_list_remove_all(struct ssdfs_snapshot_rules_list *rl);
 
 /*
@@ -89,6 +89,357 @@ void ssdfs_snap_tree_check_memory_leaks(void)
 #endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
 }
 
+/******************************************************************************
+ *                    SNAPSHOTS TIME INDEX FUNCTIONALITY                      *
+ ******************************************************************************/
+
+/*
+ * ssdfs_snaptime_index_init() - initialize snapshots time index
+ * @index: pointer on snapshots time index
+ */
+static
+void ssdfs_snaptime_index_init(struct ssdfs_snapshots_time_index *index)
+{
+	spin_lock_init(&index->lock);
+	index->state = SSDFS_SNAPSHOTS_TIME_INDEX_INVALID;
+	index->timestamps = NULL;
+	index->count = 0;
+	index->capacity = 0;
+}
+
+/*
+ * ssdfs_snaptime_index_destroy() - destroy snapshots time index
+ * @index: pointer on snapshots time index
+ */
+static
+void ssdfs_snaptime_index_destroy(struct ssdfs_snapshots_time_index *index)
+{
+	u64 *timestamps;
+
+	spin_lock(&index->lock);
+	timestamps = index->timestamps;
+	index->state = SSDFS_SNAPSHOTS_TIME_INDEX_INVALID;
+	index->timestamps = NULL;
+	index->count = 0;
+	index->capacity = 0;
+	spin_unlock(&index->lock);
+
+	if (timestamps)
+		ssdfs_snap_tree_kfree(timestamps);
+}
+
+/*
+ * ssdfs_snaptime_index_lower_bound() - find position of timestamp
+ * @index: pointer on snapshots time index
+ * @timestamp: timestamp value
+ *
+ * This method finds the position of the first timestamp
+ * that is not lesser than @timestamp. The caller has to
+ * hold the index's lock.
+ */
+static inline
+u32 ssdfs_snaptime_index_lower_bound(struct ssdfs_snapshots_time_index *index,
+				     u64 timestamp)
+{
+	u32 lower = 0;
+	u32 upper = index->count;
+
+	while (lower < upper) {
+		u32 middle = lower + ((upper - lower) / 2);
+
+		if (index->timestamps[middle] < timestamp)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+
+	return lower;
+}
+
+/*
+ * ssdfs_snaptime_index_insert() - insert timestamp into the index
+ * @index: pointer on snapshots time index
+ * @state: expected state of the index
+ * @timestamp: snapshot's creation timestamp
+ *
+ * This method tries to insert @timestamp into the index.
+ * The index is not changed if it is not in the @state.
+ * But, if the index is under building, then any modification
+ * of snapshots tree means that the building has to be
+ * started from scratch.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - unable to allocate memory.
+ */
+static
+int ssdfs_snaptime_index_insert(struct ssdfs_snapshots_time_index *index,
+				int state, u64 timestamp)
+{
+	size_t item_size = sizeof(u64);
+	u64 *new_array = NULL;
+	u64 *old_array = NULL;
+	u32 capacity = 0;
+	u32 pos;
+	int err = 0;
+
+try_insert:
+	spin_lock(&index->lock);
+
+	if (index->state != state) {
+		if (index->state == SSDFS_SNAPSHOTS_TIME_INDEX_BUILDING)
+			index->state = SSDFS_SNAPSHOTS_TIME_INDEX_INVALID;
+		goto finish_insert;
+	}
+
+	if (index->count >= index->capacity) {
+		if (!new_array || capacity <= index->count) {
+			capacity = index->capacity * 2;
+			capacity = max_t(u32, capacity,
+				    SSDFS_SNAPSHOTS_TIME_INDEX_MIN_CAPACITY);
+			spin_unlock(&index->lock);
+
+			if (new_array)
+				ssdfs_snap_tree_kfree(new_array);
+
+			new_array = ssdfs_snap_tree_kcalloc(capacity, item_size,
+							    GFP_KERNEL);
+			if (!new_array) {
+				SSDFS_ERR("fail to allocate timestamps array: "
+					  "capacity %u\n", capacity);
+				spin_lock(&index->lock);
+				index->state =
+					SSDFS_SNAPSHOTS_TIME_INDEX_INVALID;
+				spin_unlock(&index->lock);
+				return -ENOMEM;
+			}
+
+			goto try_insert;
+		}
+
+		if (index->count > 0) {
+			memcpy(new_array, index->timestamps,
+				index->count * item_size);
+		}
+
+		old_array = index->timestamps;
+		index->timestamps = new_array;
+		index->capacity = capacity;
+		new_array = NULL;
+	}
+
+	pos = ssdfs_snaptime_index_lower_bound(index, timestamp);
+
+	if (pos < index->count) {
+		memmove(&index->timestamps[pos + 1],
+			&index->timestamps[pos],
+			(index->count - pos) * item_size);
+	}
+
+	index->timestamps[pos] = timestamp;
+	index->count++;
+
+finish_insert:
+	spin_unlock(&index->lock);
+
+	if (old_array)
+		ssdfs_snap_tree_kfree(old_array);
+
+	if (new_array)
+		ssdfs_snap_tree_kfree(new_array);
+
+	return err;
+}
+
+/*
+ * ssdfs_snaptime_index_remove() - remove timestamp from the index
+ * @index: pointer on snapshots time index
+ * @timestamp: snapshot's creation timestamp
+ *
+ * This method tries to remove @timestamp from the valid index.
+ * The index is invalidated if @timestamp is absent or
+ * the index is under building.
+ */
+static
+void ssdfs_snaptime_index_remove(struct ssdfs_snapshots_time_index *index,
+				 u64 timestamp)
+{
+	u32 pos;
+
+	spin_lock(&index->lock);
+
+	switch (index->state) {
+	case SSDFS_SNAPSHOTS_TIME_INDEX_VALID:
+		pos = ssdfs_snaptime_index_lower_bound(index, timestamp);
+
+		if (pos >= index->count ||
+		    index->timestamps[pos] != timestamp) {
+			SSDFS_WARN("timestamp %llx is absent in the index\n",
+				   timestamp);
+			index->state = SSDFS_SNAPSHOTS_TIME_INDEX_INVALID;
+			break;
+		}
+
+		index->count--;
+
+		if (pos < index->count) {
+			memmove(&index->timestamps[pos],
+				&index->timestamps[pos + 1],
+				(index->count - pos) * sizeof(u64));
+		}
+		break;
+
+	case SSDFS_SNAPSHOTS_TIME_INDEX_BUILDING:
+		index->state = SSDFS_SNAPSHOTS_TIME_INDEX_INVALID;
+		break;
+
+	default:
+		/* do nothing */
+		break;
+	}
+
+	spin_unlock(&index->lock);
+}
+
+/*
+ * ssdfs_snaptime_index_clear() - remove all timestamps from the index
+ * @index: pointer on snapshots time index
+ */
+static
+void ssdfs_snaptime_index_clear(struct ssdfs_snapshots_time_index *index)
+{
+	spin_lock(&index->lock);
+	index->count = 0;
+	if (index->state == SSDFS_SNAPSHOTS_TIME_INDEX_BUILDING)
+		index->state = SSDFS_SNAPSHOTS_TIME_INDEX_INVALID;
+	spin_unlock(&index->lock);
+}
+
+/*
+ * ssdfs_snaptime_index_check() - check snapshots presence in time range
+ * @tree: pointer on snapshots btree object
+ * @range: timestamp range
+ *
+ * This method checks by means of the in-memory index that
+ * any snapshot has been created in the time @range.
+ *
+ * RETURN:
+ * [success] - the time range contains a snapshot.
+ * [failure] - error code:
+ *
+ * %-ENODATA    - the time range doesn't contain any snapshot.
+ * %-EAGAIN     - index is not valid, the btree should be checked.
+ */
+int ssdfs_snaptime_index_check(struct ssdfs_snapshots_btree_info *tree,
+			       struct ssdfs_timestamp_range *range)
+{
+	struct ssdfs_snapshots_time_index *index;
+	u32 pos;
+	int err = -ENODATA;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !range);
+
+	SSDFS_DBG("tree %p, range (start %llx, end %llx)\n",
+		  tree, range->start, range->end);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	index = &tree->time_index;
+
+	spin_lock(&index->lock);
+
+	if (index->state != SSDFS_SNAPSHOTS_TIME_INDEX_VALID) {
+		err = -EAGAIN;
+		goto finish_check;
+	}
+
+	pos = ssdfs_snaptime_index_lower_bound(index, range->start);
+
+	if (pos < index->count && index->timestamps[pos] <= range->end)
+		err = 0;
+
+finish_check:
+	spin_unlock(&index->lock);
+
+	return err;
+}
+
+/*
+ * ssdfs_snaptime_index_start_build() - start building of the index
+ * @tree: pointer on snapshots btree object
+ *
+ * This method prepares the invalid index for the building.
+ * The valid index is not touched.
+ */
+void ssdfs_snaptime_index_start_build(struct ssdfs_snapshots_btree_info *tree)
+{
+	struct ssdfs_snapshots_time_index *index;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	index = &tree->time_index;
+
+	spin_lock(&index->lock);
+	if (index->state != SSDFS_SNAPSHOTS_TIME_INDEX_VALID) {
+		index->state = SSDFS_SNAPSHOTS_TIME_INDEX_BUILDING;
+		index->count = 0;
+	}
+	spin_unlock(&index->lock);
+}
+
+/*
+ * ssdfs_snaptime_index_build_add() - add timestamp into building index
+ * @tree: pointer on snapshots btree object
+ * @timestamp: snapshot's creation timestamp
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - unable to allocate memory.
+ */
+int ssdfs_snaptime_index_build_add(struct ssdfs_snapshots_btree_info *tree,
+				   u64 timestamp)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree);
+
+	SSDFS_DBG("tree %p, timestamp %llx\n",
+		  tree, timestamp);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return ssdfs_snaptime_index_insert(&tree->time_index,
+					   SSDFS_SNAPSHOTS_TIME_INDEX_BUILDING,
+					   timestamp);
+}
+
+/*
+ * ssdfs_snaptime_index_finish_build() - finish building of the index
+ * @tree: pointer on snapshots btree object
+ *
+ * This method makes the index valid if nobody has modified
+ * the snapshots tree during the building.
+ */
+void ssdfs_snaptime_index_finish_build(struct ssdfs_snapshots_btree_info *tree)
+{
+	struct ssdfs_snapshots_time_index *index;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	index = &tree->time_index;
+
+	spin_lock(&index->lock);
+	if (index->state == SSDFS_SNAPSHOTS_TIME_INDEX_BUILDING)
+		index->state = SSDFS_SNAPSHOTS_TIME_INDEX_VALID;
+	spin_unlock(&index->lock);
+}
+
 /******************************************************************************
  *                     SNAPSHOTS TREE OBJECT FUNCTIONALITY                    *
  ******************************************************************************/
@@ -159,6 +510,8 @@ int ssdfs_snapshots_btree_create(struct ssdfs_fs_info *fsi)
 	 */
 	atomic64_set(&ptr->deleted_snapshots, 1);
 
+	ssdfs_snaptime_index_init(&ptr->time_index);
+
 	init_waitqueue_head(&ptr->wait_queue);
 	ssdfs_snapshot_reqs_queue_init(&ptr->requests.queue);
 
@@ -219,6 +572,8 @@ void ssdfs_snapshots_btree_destroy(struct ssdfs_fs_info *fsi)
 
 	ssdfs_btree_destroy(&tree->generic_tree);
 
+	ssdfs_snaptime_index_destroy(&tree->time_index);
+
 	ssdfs_snap_tree_kfree(tree);
 	fsi->snapshots.tree = NULL;
 
@@ -1092,10 +1447,15 @@ int ssdfs_snapshots_btree_add(struct ssdfs_snapshots_btree_info *tree,
 		ssdfs_btree_search_forget_parent_node(search);
 		ssdfs_btree_search_forget_child_node(search);
 
+		err = ssdfs_snaptime_index_insert(&tree->time_index,
+					SSDFS_SNAPSHOTS_TIME_INDEX_VALID,
+					create_time);
 		if (unlikely(err)) {
-			SSDFS_ERR("fail to add snapshot: "
-				  "err %d\n", err);
-			goto finish_add_snapshot;
+			/* index is invalid, btree will be checked */
+			SSDFS_WARN("fail to add snapshot into time index: "
+				   "create_time %llx, err %d\n",
+				   create_time, err);
+			err = 0;
 		}
 	} else {
 		err = -EEXIST;
@@ -1940,6 +2300,7 @@ int ssdfs_snapshots_btree_delete(struct ssdfs_snapshots_btree_info *tree,
 	struct ssdfs_snapshot_id id;
 	struct ssdfs_snapshot *desc;
 	s64 snapshots_count;
+	u64 create_time;
 	size_t len;
 	int err = 0;
 
@@ -2074,6 +2435,8 @@ int ssdfs_snapshots_btree_delete(struct ssdfs_snapshots_btree_info *tree,
 		goto finish_delete_snapshot;
 	}
 
+	create_time = le64_to_cpu(desc->create_time);
+
 	err = ssdfs_btree_delete_item(&tree->generic_tree,
 				      search);
 	if (unlikely(err)) {
@@ -2082,6 +2445,8 @@ int ssdfs_snapshots_btree_delete(struct ssdfs_snapshots_btree_info *tree,
 		goto finish_delete_snapshot;
 	}
 
+	ssdfs_snaptime_index_remove(&tree->time_index, create_time);
+
 	atomic_set(&tree->state, SSDFS_SNAPSHOTS_BTREE_DIRTY);
 
 	ssdfs_btree_search_forget_parent_node(search);
@@ -2482,8 +2847,10 @@ int ssdfs_snapshots_btree_delete_all(struct ssdfs_snapshots_btree_info *tree)
 
 	down_write(&tree->lock);
 	err = ssdfs_btree_delete_all(&tree->generic_tree);
-	if (!err)
+	if (!err) {
 		atomic64_set(&tree->snapshots_count, 0);
+		ssdfs_snaptime_index_clear(&tree->time_index);
+	}
 	up_write(&tree->lock);
 
 	if (unlikely(err)) {
@@ -2748,8 +3115,8 @@ int ssdfs_snapshots_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	err = ssdfs_btree_pre_flush_root_node(node);
 	if (unlikely(err)) {
@@ -2758,7 +3125,7 @@ int ssdfs_snapshots_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 			  node->node_id, err);
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	return err;
@@ -2908,7 +3275,7 @@ int ssdfs_snapshots_btree_create_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 	down_write(&node->bmap_array.lock);
 
 	switch (atomic_read(&node->type)) {
@@ -3079,7 +3446,7 @@ int ssdfs_snapshots_btree_create_node(struct ssdfs_btree_node *node)
 
 finish_create_node:
 	up_write(&node->bmap_array.lock);
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		return err;
@@ -3187,7 +3554,7 @@ int ssdfs_snapshots_btree_init_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	if (pagevec_count(&node->content.pvec) == 0) {
 		err = -ERANGE;
@@ -3222,7 +3589,7 @@ int ssdfs_snapshots_btree_init_node(struct ssdfs_btree_node *node)
 		goto finish_init_operation;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&node->raw.snapshots_header, 0, hdr_size,
 		     hdr, 0, hdr_size,
@@ -3415,7 +3782,7 @@ int ssdfs_snapshots_btree_init_node(struct ssdfs_btree_node *node)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_header_init:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_init_operation;
@@ -3737,8 +4104,8 @@ int ssdfs_snapshots_btree_pre_flush_node(struct ssdfs_btree_node *node)
 					 generic_tree);
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&snapshots_header, 0, hdr_size,
 		     &node->raw.snapshots_header, 0, hdr_size,
@@ -3786,7 +4153,8 @@ int ssdfs_snapshots_btree_pre_flush_node(struct ssdfs_btree_node *node)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	snapshots_header.node.check.bytes = cpu_to_le16((u16)hdr_size);
-	snapshots_header.node.check.flags = cpu_to_le16(SSDFS_CRC32);
+	snapshots_header.node.check.flags =
+		cpu_to_le16(ssdfs_csum_type(node->tree->fsi));
 
 	err = ssdfs_calculate_csum(&snapshots_header.node.check,
 				   &snapshots_header, hdr_size);
@@ -3800,7 +4168,7 @@ int ssdfs_snapshots_btree_pre_flush_node(struct ssdfs_btree_node *node)
 		     hdr_size);
 
 finish_snapshots_header_preparation:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_node_pre_flush;
@@ -3864,7 +4232,7 @@ int ssdfs_snapshots_btree_flush_node(struct ssdfs_btree_node *node)
 
 	fsi = node->tree->fsi;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	fs_feature_compat = fsi->fs_feature_compat;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -6710,7 +7078,7 @@ int __ssdfs_snapshots_btree_node_insert(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -6925,7 +7293,7 @@ finish_detect_affected_items:
 		goto unlock_items_range;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	node->items_area.items_count += search->request.count;
 	if (node->items_area.items_count > node->items_area.items_capacity) {
@@ -7020,7 +7388,7 @@ finish_detect_affected_items:
 	atomic64_add(search->request.count, &tree_info->snapshots_count);
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -7397,7 +7765,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 		return err;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	start_hash = node->items_area.start_hash;
 	end_hash = node->items_area.end_hash;
@@ -7456,7 +7824,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -7599,7 +7967,7 @@ int ssdfs_snapshots_btree_node_change_item(struct ssdfs_btree_node *node,
 		return -EFAULT;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -7779,7 +8147,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	switch (atomic_read(&node->items_area.state)) {
 	case SSDFS_BTREE_NODE_ITEMS_AREA_EXIST:
@@ -7809,7 +8177,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		break;
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -8144,7 +8512,7 @@ int __ssdfs_snapshots_btree_node_delete_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -8291,7 +8659,7 @@ finish_detect_affected_items:
 		}
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("INITIAL STATE: node_id %u, "
@@ -8466,7 +8834,7 @@ finish_detect_affected_items:
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -8705,7 +9073,7 @@ int ssdfs_snapshots_btree_node_extract_range(struct ssdfs_btree_node *node,
 		  search->node.child);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_node_extract_range(node, start_index, count,
 						item_size, search);
 	up_read(&node->full_lock);
@@ -24,6 +24,41 @@ struct ssdfs_snapshots_btree_queue {
 	struct ssdfs_thread_info thread;
 };
 
+/*
+ * struct ssdfs_snapshots_time_index - index of snapshots' timestamps
+ * @lock: index's lock
+ * @state: index's state
+ * @timestamps: sorted array of snapshots' creation timestamps
+ * @count: number of timestamps in the array
+ * @capacity: capacity of the array
+ *
+ * GC checks for every PEB whether any snapshot has been created
+ * during the lifetime of the PEB. The index keeps the creation
+ * timestamps of all snapshots in the sorted array. It is built by
+ * the snapshots tree's thread during the first walk through
+ * the tree after mount and it is updated by every snapshot's
+ * add/delete operation. As a result, the check is a binary search
+ * without any search in the btree. The btree is checked until
+ * the index is valid.
+ */
+struct ssdfs_snapshots_time_index {
+	spinlock_t lock;
+	int state;
+	u64 *timestamps;
+	u32 count;
+	u32 capacity;
+};
+
+/* Snapshots time index states */
+enum {
+	SSDFS_SNAPSHOTS_TIME_INDEX_INVALID,
+	SSDFS_SNAPSHOTS_TIME_INDEX_BUILDING,
+	SSDFS_SNAPSHOTS_TIME_INDEX_VALID,
+	SSDFS_SNAPSHOTS_TIME_INDEX_STATE_MAX
+};
+
+#define SSDFS_SNAPSHOTS_TIME_INDEX_MIN_CAPACITY	(64)
+
 /*
  * struct ssdfs_snapshots_btree_info - snapshots btree info
  * @state: snapshots btree state
@@ -31,6 +66,7 @@ struct ssdfs_snapshots_btree_queue {
  * @generic_tree: generic btree description
  * @snapshots_count: count of the snapshots in the whole tree
  * @deleted_snapshots: current number of snapshot delete operations
+ * @time_index: in-memory index of snapshots' creation timestamps
  * @requests: snapshot requests queue
  * @wait_queue: wait queue of snapshots tree's thread
  * @fsi: pointer on shared file system object
@@ -43,6 +79,8 @@ struct ssdfs_snapshots_btree_info {
 	atomic64_t snapshots_count;
 	atomic64_t deleted_snapshots;
 
+	struct ssdfs_snapshots_time_index time_index;
+
 	struct ssdfs_snapshots_btree_queue requests;
 	wait_queue_head_t wait_queue;
 
@@ -211,6 +249,8 @@ int ssdfs_snapshots_btree_delete_peb2time(struct ssdfs_snapshots_btree_info *,
 					  struct ssdfs_peb_timestamps *peb2time,
 					  struct ssdfs_btree_search *search);
 int ssdfs_snapshots_btree_delete_all(struct ssdfs_snapshots_btree_info *tree);
+int ssdfs_snaptime_index_check(struct ssdfs_snapshots_btree_info *tree,
+			       struct ssdfs_timestamp_range *range);
 
 /*
  * Internal snapshots tree API
@@ -233,6 +273,10 @@ int ssdfs_snapshots_tree_check_search_result(struct ssdfs_btree_search *search);
 int ssdfs_snapshots_tree_get_next_hash(struct ssdfs_snapshots_btree_info *tree,
 					struct ssdfs_btree_search *search,
 					u64 *next_hash);
+void ssdfs_snaptime_index_start_build(struct ssdfs_snapshots_btree_info *tree);
+int ssdfs_snaptime_index_build_add(struct ssdfs_snapshots_btree_info *tree,
+				   u64 timestamp);
+void ssdfs_snaptime_index_finish_build(struct ssdfs_snapshots_btree_info *tree);
 
 void ssdfs_debug_snapshots_btree_object(struct ssdfs_snapshots_btree_info *tree);
 
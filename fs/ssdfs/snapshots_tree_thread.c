@@ -50,6 +50,36 @@ bool is_time_process_requests(struct ssdfs_snapshots_btree_info *tree)
 	return !is_ssdfs_snapshot_reqs_queue_empty(&tree->requests.queue);
 }
 
+/*
+ * ssdfs_time_index_snapshot_item() - add snapshot into the time index
+ * @tree: snapshot btree
+ * @item: snapshot or PEB2time set item
+ *
+ * This function adds the creation timestamp of snapshot
+ * into the time index under building. PEB2time sets are ignored.
+ * The failure is not critical because the index simply stays
+ * invalid and the snapshots btree is checked instead.
+ */
+static inline
+void ssdfs_time_index_snapshot_item(struct ssdfs_snapshots_btree_info *tree,
+				    union ssdfs_snapshot_item *item)
+{
+	u64 create_time;
+	int err;
+
+	if (!is_item_snapshot(item))
+		return;
+
+	create_time = le64_to_cpu(item->snapshot.create_time);
+
+	err = ssdfs_snaptime_index_build_add(tree, create_time);
+	if (unlikely(err)) {
+		SSDFS_WARN("fail to add snapshot into time index: "
+			   "create_time %llx, err %d\n",
+			   create_time, err);
+	}
+}
+
 /*
  * ssdfs_check_necessity_delete_peb2time() - check/delete obsolete PEB2time pairs
  * @fsi: pointer on shared file system object
@@ -363,6 +393,12 @@ try_process_queue:
 		u64 start_hash = U64_MAX;
 		u64 end_hash = U64_MAX;
 
+		/*
+		 * The walk through the whole tree is used
+		 * to build the time index of snapshots too.
+		 */
+		ssdfs_snaptime_index_start_build(tree);
+
 		err = ssdfs_snapshots_tree_get_start_hash(tree,
 							  &start_hash);
 		if (err == -ENOENT) {
@@ -463,6 +499,8 @@ try_process_queue:
 				item = (union ssdfs_snapshot_item *)(start_ptr +
 								(i * item_size));
 
+				ssdfs_time_index_snapshot_item(tree, item);
+
 				err = ssdfs_check_necessity_delete_peb2time(fsi,
 									  tree,
 									  item);
@@ -507,6 +545,7 @@ try_process_queue:
 		} while (start_hash < U64_MAX);
 
 finish_snapshots_tree_processing:
+		ssdfs_snaptime_index_finish_build(tree);
 		atomic64_dec(&tree->deleted_snapshots);
 	}
 
@@ -24,7 +24,10 @@
 #include <linux/sched.h>
 #include <linux/fs.h>
 #include <linux/crc32.h>
+#include <linux/crc32c.h>
 #include <linux/pagemap.h>
+#include <linux/bio.h>
+#include <linux/percpu_counter.h>
 #include <linux/ssdfs_fs.h>
 
 #include "ssdfs_constants.h"
@@ -124,6 +127,8 @@ int ssdfs_bdev_writepages(struct super_block *sb, loff_t to_off,
 /* dev_zns.c */
 u64 ssdfs_zns_zone_size(struct super_block *sb, loff_t offset);
 u64 ssdfs_zns_zone_capacity(struct super_block *sb, loff_t offset);
+void ssdfs_zns_open_zones_init(struct ssdfs_fs_info *fsi);
+void ssdfs_zns_open_zones_destroy(struct ssdfs_fs_info *fsi);
 
 /* dir.c */
 int ssdfs_inode_by_name(struct inode *dir,
@@ -160,6 +165,7 @@ int ssdfs_getattr(struct user_namespace *mnt_userns,
 int ssdfs_setattr(struct user_namespace *mnt_userns,
 		  struct dentry *dentry, struct iattr *attr);
 void ssdfs_evict_inode(struct inode *inode);
+void ssdfs_delete_orphan_inode(struct inode *inode);
 int ssdfs_write_inode(struct inode *inode, struct writeback_control *wbc);
 int ssdfs_statfs(struct dentry *dentry, struct kstatfs *buf);
 void ssdfs_set_inode_flags(struct inode *inode);
@@ -326,6 +332,8 @@ int ssdfs_prepare_partial_log_header_for_commit(struct ssdfs_fs_info *fsi,
 					u64 last_log_time,
 					u64 last_log_cno,
 					struct ssdfs_partial_log_header *hdr);
+struct ssdfs_mount_checkpoint *
+ssdfs_get_mount_checkpoint(struct ssdfs_fs_info *fsi);
 
 /* memory leaks checker */
 void ssdfs_acl_memory_leaks_init(void);
@@ -344,6 +352,10 @@ void ssdfs_btree_search_memory_leaks_init(void);
 void ssdfs_btree_search_check_memory_leaks(void);
 void ssdfs_lzo_memory_leaks_init(void);
 void ssdfs_lzo_check_memory_leaks(void);
+void ssdfs_zstd_memory_leaks_init(void);
+void ssdfs_zstd_check_memory_leaks(void);
+void ssdfs_lz4_memory_leaks_init(void);
+void ssdfs_lz4_check_memory_leaks(void);
 void ssdfs_zlib_memory_leaks_init(void);
 void ssdfs_zlib_check_memory_leaks(void);
 void ssdfs_compr_memory_leaks_init(void);
@@ -388,6 +400,8 @@ void ssdfs_map_queue_memory_leaks_init(void);
 void ssdfs_map_queue_check_memory_leaks(void);
 void ssdfs_map_tbl_memory_leaks_init(void);
 void ssdfs_map_tbl_check_memory_leaks(void);
+void ssdfs_lhdr_cache_memory_leaks_init(void);
+void ssdfs_lhdr_cache_check_memory_leaks(void);
 void ssdfs_map_cache_memory_leaks_init(void);
 void ssdfs_map_cache_check_memory_leaks(void);
 void ssdfs_map_thread_memory_leaks_init(void);
@@ -32,6 +32,149 @@ enum {
 	SSDFS_GC_THREAD_TYPE_MAX,
 };
 
+/*
+ * Flush request priority classes
+ */
+enum {
+	SSDFS_REQ_PRIO_SYNC,
+	SSDFS_REQ_PRIO_ASYNC,
+	SSDFS_REQ_PRIO_BACKGROUND,
+	SSDFS_REQ_PRIO_CLASS_MAX,
+};
+
+#define SSDFS_SYNC_REQ_LATENCY_MSECS_DEFAULT		(10)
+#define SSDFS_ASYNC_REQ_LATENCY_MSECS_DEFAULT		(100)
+#define SSDFS_BACKGROUND_REQ_LATENCY_MSECS_DEFAULT	(1000)
+#define SSDFS_REQ_LATENCY_MSECS_MAX			(60000)
+
+/*
+ * User data log size adaptation
+ */
+#define SSDFS_LOG_STREAM_SCORE_MAX			(64)
+#define SSDFS_LOG_STREAM_SCORE_THRESHOLD		(8)
+#define SSDFS_LOG_PAGES_GROWTH_MAX			(4)
+
+/*
+ * Diff-On-Write threshold adaptation
+ */
+enum {
+	SSDFS_DOW_METADATA,
+	SSDFS_DOW_USER_DATA,
+	SSDFS_DOW_TYPE_MAX,
+};
+
+/*
+ * Memory reclaim by shrinkers
+ */
+enum {
+	SSDFS_RECLAIM_SEG_OBJECTS,
+	SSDFS_RECLAIM_BLK_BMAPS,
+	SSDFS_RECLAIM_BTREE_NODES,
+	SSDFS_RECLAIM_TYPE_MAX,
+};
+
+/*
+ * Write amplification accounting
+ */
+enum {
+	SSDFS_WA_HOST_DATA,
+	SSDFS_WA_USER_DATA,
+	SSDFS_WA_BTREE_NODES,
+	SSDFS_WA_MAPTBL,
+	SSDFS_WA_SEGBMAP,
+	SSDFS_WA_OTHER_PAYLOAD,
+	SSDFS_WA_BLK_DESC,
+	SSDFS_WA_BLK2OFF,
+	SSDFS_WA_BLK_BMAP,
+	SSDFS_WA_DIFFS,
+	SSDFS_WA_GC_COPIES,
+	SSDFS_WA_DEVICE_WRITES,
+	SSDFS_WA_TYPE_MAX,
+};
+
+/*
+ * Metadata lookup instrumentation
+ */
+enum {
+	SSDFS_LOOKUP_MAPTBL_CACHE,
+	SSDFS_LOOKUP_MAPTBL_FRAGMENT,
+	SSDFS_LOOKUP_SEGBMAP,
+	SSDFS_LOOKUP_BLK2OFF_CACHE,
+	SSDFS_LOOKUP_BLK2OFF_TABLE,
+	SSDFS_LOOKUP_BTREE_BASE,
+	SSDFS_LOOKUP_TYPE_MAX = SSDFS_LOOKUP_BTREE_BASE + SSDFS_BTREE_TYPE_MAX,
+};
+
+#define SSDFS_LOOKUP_LATENCY_BUCKETS		(24)
+
+/*
+ * Mount phases
+ */
+enum {
+	SSDFS_MOUNT_VOLUME_HEADER,
+	SSDFS_MOUNT_SB_FAST_SEARCH,
+	SSDFS_MOUNT_SB_SLOW_SEARCH,
+	SSDFS_MOUNT_SB_FALLBACK_SEARCH,
+	SSDFS_MOUNT_VOLUME_STATE,
+	SSDFS_MOUNT_SNAPSHOTS_TREE,
+	SSDFS_MOUNT_SEGMENTS_TREE,
+	SSDFS_MOUNT_MAPTBL,
+	SSDFS_MOUNT_SEGBMAP,
+	SSDFS_MOUNT_SHEXTREE,
+	SSDFS_MOUNT_INVEXTREE,
+	SSDFS_MOUNT_CURRENT_SEGMENTS,
+	SSDFS_MOUNT_SHARED_DICT,
+	SSDFS_MOUNT_INODES_TREE,
+	SSDFS_MOUNT_ROOT_INODE,
+	SSDFS_MOUNT_GC_THREADS,
+	SSDFS_MOUNT_COMMIT_SB,
+	SSDFS_MOUNT_PHASE_MAX
+};
+
+#ifdef CONFIG_SSDFS_DIFF_ON_WRITE_METADATA
+#define SSDFS_DOW_METADATA_THRESHOLD_DEFAULT	\
+	CONFIG_SSDFS_DIFF_ON_WRITE_METADATA_THRESHOLD
+#else
+#define SSDFS_DOW_METADATA_THRESHOLD_DEFAULT	(25)
+#endif /* CONFIG_SSDFS_DIFF_ON_WRITE_METADATA */
+
+#ifdef CONFIG_SSDFS_DIFF_ON_WRITE_USER_DATA
+#define SSDFS_DOW_USER_DATA_THRESHOLD_DEFAULT	\
+	CONFIG_SSDFS_DIFF_ON_WRITE_USER_DATA_THRESHOLD
+#else
+#define SSDFS_DOW_USER_DATA_THRESHOLD_DEFAULT	(50)
+#endif /* CONFIG_SSDFS_DIFF_ON_WRITE_USER_DATA */
+
+#define SSDFS_DOW_THRESHOLD_ADAPTIVE			(0)
+#define SSDFS_DOW_THRESHOLD_MIN				(1)
+#define SSDFS_DOW_THRESHOLD_MAX				(50)
+#define SSDFS_DOW_THRESHOLD_STEP			(5)
+#define SSDFS_DOW_ADAPT_WINDOW				(64)
+#define SSDFS_DOW_POOR_DIFF_RATIO_PCT			(50)
+#define SSDFS_DOW_GOOD_DIFF_RATIO_PCT			(10)
+#define SSDFS_DOW_MAX_DIFFS_PER_READ			(4)
+#define SSDFS_DOW_FOLD_CHAIN_DEFAULT			(3)
+
+/*
+ * GC governor
+ */
+#define SSDFS_GC_IDLE_REQS_DEFAULT			(50)
+#define SSDFS_GC_BUSY_REQS_DEFAULT			(1000)
+#define SSDFS_GC_URGENT_FREE_PCT_DEFAULT		(5)
+#define SSDFS_GC_URGENT_FREE_PCT_MAX			(50)
+#define SSDFS_GC_IDLE_DELAY_MSECS_DEFAULT		(10)
+#define SSDFS_GC_BUSY_DELAY_MSECS_DEFAULT		(1000)
+#define SSDFS_GC_DELAY_MSECS_MAX			(60000)
+#define SSDFS_GC_IDLE_SCAN_SECS_DEFAULT			(60)
+#define SSDFS_GC_IDLE_SCAN_SECS_MAX			(24 * 60 * 60)
+
+/*
+ * Writers' throttling
+ */
+#define SSDFS_WRITE_THROTTLE_MSECS_DEFAULT		(1000)
+#define SSDFS_WRITE_THROTTLE_MSECS_MAX			(60000)
+#define SSDFS_WRITE_THROTTLE_MIN_REQS_DEFAULT		(64)
+
 enum {
 	SSDFS_256B	= 256,
 	SSDFS_512B	= 512,
@@ -115,6 +115,44 @@ struct ssdfs_sb_info {
 	struct ssdfs_peb_extent last_log;
 };
 
+/*
+ * struct ssdfs_io_batch - batch of asynchronous I/O requests
+ * @pending: number of submitted requests in flight
+ * @err: first error of the completed requests
+ * @lock: protects @err and @completed
+ * @completed: list of completed write requests (not used by discards)
+ * @wait: wait queue for the batch completion
+ */
+struct ssdfs_io_batch {
+	atomic_t pending;
+	int err;
+	spinlock_t lock;
+	struct bio_list completed;
+	wait_queue_head_t wait;
+};
+
+/*
+ * struct ssdfs_zns_open_zones - manager of open zones (ZNS device)
+ * @lock: protects @lru and @count
+ * @mutex: serializes open/close operations of zones
+ * @lru: list of active zones (the most recently written zone is the first)
+ * @count: number of zones in OPEN state
+ * @max_open: device's limit of open zones (0 - no limit)
+ *
+ * Device limits the number of open zones and, independently, the number
+ * of active (open or closed) zones. The least recently written open
+ * zone is closed when a zone needs to be opened but the open zones limit
+ * is achieved. The closed zone stays active and it is reopened
+ * on the next write.
+ */
+struct ssdfs_zns_open_zones {
+	spinlock_t lock;
+	struct mutex mutex;
+	struct list_head lru;
+	u32 count;
+	u32 max_open;
+};
+
 /*
  * struct ssdfs_device_ops - device operations
  * @device_name: get device name
@@ -125,13 +163,29 @@ struct ssdfs_sb_info {
  * @read: read from device
  * @readpage: read page
  * @readpages: read sequence of pages
+ * @readpages_async: submit read of sequence of pages without waiting
+ * @wait_reads: wait the end of asynchronous reads in the batch
  * @can_write_page: can we write into page?
  * @writepage: write page to device
  * @writepages: write sequence of pages to device
+ * @writepages_async: submit write of sequence of pages without waiting
+ * @wait_writes: wait the end of asynchronous writes in the batch
  * @erase: erase block
  * @trim: support of background erase operation
+ * @trim_async: submit background erase operation without waiting
+ * @wait_trims: wait the end of asynchronous erase operations in the batch
  * @peb_isbad: check that physical erase block is bad
  * @sync: synchronize page cache with device
+ *
+ * The operations drive the single device of the superblock and
+ * the offset is the byte offset on this device. The volume cannot
+ * be striped over several member devices by these operations yet:
+ * the volume header and the segment bitmap describe one linear
+ * PEB space of the device, the mapping table keeps only the PEB ID
+ * for every LEB, and the superblock segments are looked up at fixed
+ * offsets of one device. The native striping needs the on-disk
+ * description of the members (and mkfs support) before the offset
+ * could be routed to the member's block device.
  */
 struct ssdfs_device_ops {
 	const char * (*device_name)(struct super_block *sb);
@@ -145,14 +199,27 @@ struct ssdfs_device_ops {
 			loff_t offset);
 	int (*readpages)(struct super_block *sb, struct pagevec *pvec,
 			 loff_t offset);
+	int (*readpages_async)(struct super_block *sb, struct pagevec *pvec,
+				loff_t offset, struct ssdfs_io_batch *batch);
+	int (*wait_reads)(struct super_block *sb,
+			  struct ssdfs_io_batch *batch);
 	int (*can_write_page)(struct super_block *sb, loff_t offset,
 				bool need_check);
 	int (*writepage)(struct super_block *sb, loff_t to_off,
 			 struct page *page, u32 from_off, size_t len);
 	int (*writepages)(struct super_block *sb, loff_t to_off,
 			  struct pagevec *pvec, u32 from_off, size_t len);
+	int (*writepages_async)(struct super_block *sb, loff_t to_off,
+				struct pagevec *pvec, u32 from_off, size_t len,
+				struct ssdfs_io_batch *batch);
+	int (*wait_writes)(struct super_block *sb,
+			   struct ssdfs_io_batch *batch);
 	int (*erase)(struct super_block *sb, loff_t offset, size_t len);
 	int (*trim)(struct super_block *sb, loff_t offset, size_t len);
+	int (*trim_async)(struct super_block *sb, loff_t offset, size_t len,
+			  struct ssdfs_io_batch *batch);
+	int (*wait_trims)(struct super_block *sb,
+			  struct ssdfs_io_batch *batch);
 	int (*peb_isbad)(struct super_block *sb, loff_t offset);
 	int (*mark_peb_bad)(struct super_block *sb, loff_t offset);
 	void (*sync)(struct super_block *sb);
@@ -170,6 +237,166 @@ struct ssdfs_snapshot_subsystem {
 	struct ssdfs_snapshots_btree_info *tree;
 };
 
+/*
+ * struct ssdfs_cache_flush_group - group of device cache flush requesters
+ * @lock: serializes the device cache flushes
+ * @started: sequence number of the last started flush
+ * @finished: sequence number of the last finished flush
+ * @err: result of the last finished flush
+ *
+ * Concurrent fsync() callers wait on @lock while a flush is in progress.
+ * The flush that started after the entry of a caller covers all its
+ * completed writes. Such callers finish without issuing another flush.
+ */
+struct ssdfs_cache_flush_group {
+	struct mutex lock;
+	atomic64_t started;
+	atomic64_t finished;
+	int err;
+};
+
+/*
+ * struct ssdfs_reclaim_stats - statistics of one shrinker
+ * @scans: number of shrinker's invocations
+ * @scanned: number of scanned objects
+ * @reclaimed: number of reclaimed objects
+ * @busy: number of scanned objects that cannot be reclaimed yet
+ */
+struct ssdfs_reclaim_stats {
+	atomic64_t scans;
+	atomic64_t scanned;
+	atomic64_t reclaimed;
+	atomic64_t busy;
+};
+
+/*
+ * struct ssdfs_wa_stats - write amplification statistics
+ * @bytes: array of byte counters for every category
+ *
+ * The host data category is the volume of user data received
+ * by flush requests. The device writes category is the volume
+ * of all written logs. The rest of categories split the logs'
+ * payload on the type of content. The difference between device
+ * writes and the payload is the logs' headers, footers and padding.
+ */
+struct ssdfs_wa_stats {
+	atomic64_t bytes[SSDFS_WA_TYPE_MAX];
+};
+
+/*
+ * struct ssdfs_lookup_stats - statistics of one metadata lookup type
+ * @hits: number of lookups that found the item
+ * @misses: number of lookups that failed or found nothing
+ * @latency: histogram of lookups' latency (log2 buckets of nsecs)
+ */
+struct ssdfs_lookup_stats {
+	atomic64_t hits;
+	atomic64_t misses;
+	atomic64_t latency[SSDFS_LOOKUP_LATENCY_BUCKETS];
+};
+
+/*
+ * struct ssdfs_mount_profile - timings of mount phases
+ * @nsecs: time of every mount phase in nanoseconds
+ * @total_nsecs: total time of mount in nanoseconds
+ * @sb_search: phase of superblock search that found the latest log
+ *
+ * The profile is filled during the mount only and it is not
+ * changed after that.
+ */
+struct ssdfs_mount_profile {
+	u64 nsecs[SSDFS_MOUNT_PHASE_MAX];
+	u64 total_nsecs;
+	int sb_search;
+};
+
+/*
+ * struct ssdfs_dow_stats - Diff-On-Write statistics of one data type
+ * @threshold: current adaptive threshold of modification (percentage)
+ * @override: threshold defined by user (0 means adaptive threshold)
+ * @prepared: number of prepared diffs
+ * @rejected: number of rejected attempts to prepare a diff
+ * @diff_bytes: total size of prepared diffs in bytes
+ * @block_bytes: total size of blocks that have been replaced by diffs
+ * @reads: number of read requests that applied diffs
+ * @applied: number of diff pages applied by read requests
+ * @folded: number of diff chains folded into full block state
+ * @window: number of decisions in current adaptation window
+ * @win_rejected: rejected attempts in current adaptation window
+ * @win_diff_bytes: diffs' bytes in current adaptation window
+ * @win_block_bytes: blocks' bytes in current adaptation window
+ * @win_reads: read requests in current adaptation window
+ * @win_applied: applied diff pages in current adaptation window
+ *
+ * Diff-On-Write saves write bandwidth, but every read of a block
+ * has to apply the chain of diffs. The threshold is re-calculated
+ * at the end of every adaptation window on the basis of measured
+ * diff size vs. block size and measured diffs count per read.
+ */
+struct ssdfs_dow_stats {
+	atomic_t threshold;
+	atomic_t override;
+
+	atomic64_t prepared;
+	atomic64_t rejected;
+	atomic64_t diff_bytes;
+	atomic64_t block_bytes;
+	atomic64_t reads;
+	atomic64_t applied;
+	atomic64_t folded;
+
+	atomic_t window;
+	atomic64_t win_rejected;
+	atomic64_t win_diff_bytes;
+	atomic64_t win_block_bytes;
+	atomic64_t win_reads;
+	atomic64_t win_applied;
+};
+
+/*
+ * struct ssdfs_gc_governor - I/O load aware GC scheduling
+ * @idle_reqs: flush requests count that is treated as idle state
+ * @busy_reqs: flush requests count that stops GC activity
+ * @urgent_free_pct: free space (percents) that switches GC into urgent mode
+ * @idle_delay_msecs: delay between GC victims in idle state
+ * @busy_delay_msecs: delay between GC victims under high I/O load
+ * @idle_scan_secs: period of GC's own passes in idle state (0 - disabled)
+ *
+ * GC is throttled proportionally to the depth of flush requests queue.
+ * It processes victims without delays if free space is lower than
+ * urgent watermark. Also GC starts by itself in idle state without
+ * waiting of requests from migration scheme.
+ */
+struct ssdfs_gc_governor {
+	atomic_t idle_reqs;
+	atomic_t busy_reqs;
+	atomic_t urgent_free_pct;
+	atomic_t idle_delay_msecs;
+	atomic_t busy_delay_msecs;
+	atomic_t idle_scan_secs;
+};
+
+/*
+ * struct ssdfs_write_throttle - pacing of writers by flush throughput
+ * @target_msecs: target time of user data flush backlog's draining
+ * @min_reqs: backlog of user data flush requests that is not throttled
+ * @stamp: time of the latest throughput estimation (jiffies)
+ * @finished_reqs: finished user data flush requests since @stamp
+ * @reqs_per_sec: estimated throughput of user data flush requests
+ *
+ * The writer waits in write_begin if the backlog of user data flush
+ * requests cannot be drained by the flush threads during the target
+ * time. The throughput is estimated every second by the number of
+ * finished requests. Zero target time disables the throttling.
+ */
+struct ssdfs_write_throttle {
+	atomic_t target_msecs;
+	atomic_t min_reqs;
+	atomic_long_t stamp;
+	atomic64_t finished_reqs;
+	atomic64_t reqs_per_sec;
+};
+
 /*
  * struct ssdfs_fs_info - in-core fs information
  * @log_pagesize: log2(page size)
@@ -190,6 +417,8 @@ struct ssdfs_snapshot_subsystem {
  * @raw_inode_size: raw inode size in bytes
  * @create_threads_per_seg: number of creation threads per segment
  * @mount_opts: mount options
+ * @inline_file_max: maximal size of a new inline file (mount option)
+ * @invalidation_budget: invalidated segments per second (mount option)
  * @metadata_options: metadata options
  * @volume_sem: volume semaphore
  * @last_vh: buffer for last valid volume header
@@ -205,12 +434,14 @@ struct ssdfs_snapshot_subsystem {
  * @inodes_seg_log_pages: full log size in index nodes segment (pages count)
  * @user_data_log_pages: full log size in user data segment (pages count)
  * @volume_state_lock: lock for mutable volume metadata
- * @free_pages: free pages count on the volume
+ * @free_pages: free pages count on the volume (per-CPU counter)
  * @reserved_new_user_data_pages: reserved pages of growing files' content
  * @updated_user_data_pages: number of updated pages of files' content
  * @flushing_user_data_requests: number of user data processing flush request
- * @pending_wq: wait queue for flush threads of user data segments
  * @finish_user_data_flush_wq: wait queue for waiting the end of user data flush
+ * @orphans_lock: lock of orphan inodes list
+ * @orphans: list of evicted inodes waiting the deletion of content
+ * @orphans_work: work of the orphan inodes' deletion
  * @fs_mount_time: file system mount timestamp
  * @fs_mod_time: last write timestamp
  * @fs_mount_cno: mount checkpoint
@@ -233,6 +464,7 @@ struct ssdfs_snapshot_subsystem {
  * @segbmap_inode: segment bitmap inode
  * @maptbl: PEB mapping table object
  * @maptbl_cache: maptbl cache
+ * @log_hdr_cache: cache of checked log headers and footers
  * @segs_tree: tree of segment objects
  * @segs_tree_inode: segment tree inode
  * @cur_segs: array of current segments
@@ -240,11 +472,26 @@ struct ssdfs_snapshot_subsystem {
  * @shdictree: shared dictionary
  * @inodes_tree: inodes btree
  * @invextree: invalidated extents btree
+ * @btrees_lock: lock of btrees list
+ * @btrees_list: list of created btrees (for eviction of btree nodes)
+ * @btree_nodes_count: number of btree nodes in memory
+ * @btree_nodes_shrinker: shrinker of clean btree leaf nodes
+ * @reclaim_stats: statistics of memory reclaim by shrinkers
  * @snapshots: snapshots subsystem
  * @gc_thread: array of GC threads
  * @gc_wait_queue: array of GC threads' wait queues
  * @gc_should_act: array of counters that define necessity of GC activity
+ * @gc_governor: I/O load aware GC scheduling tunables
+ * @write_throttle: pacing of writers by user data flush throughput
  * @flush_reqs: current number of flush requests
+ * @req_latency_msecs: latency targets of flush request classes (msecs)
+ * @flush_group: group of device cache flush requesters
+ * @data_log_stream_score: balance of filled vs. prematurely committed data logs
+ * @dow_stats: Diff-On-Write statistics and thresholds
+ * @dow_fold_chain: max diffs in block's chain before folding
+ * @wa_stats: write amplification statistics
+ * @lookup_stats: latency and hit/miss statistics of metadata lookups
+ * @mount_profile: timings of mount phases
  * @sb: pointer on VFS superblock object
  * @mtd: MTD info
  * @devops: device access operations
@@ -253,8 +500,9 @@ struct ssdfs_snapshot_subsystem {
  * @is_zns_device: file system volume is on ZNS device
  * @zone_size: zone size in bytes
  * @zone_capacity: zone capacity in bytes available for write operations
- * @max_open_zones: open zones limitation (upper bound)
- * @open_zones: current number of opened zones
+ * @max_open_zones: active zones limitation (upper bound)
+ * @open_zones: current number of active (open or closed) zones
+ * @zns_open_zones: manager of open zones
  * @dev_kobj: /sys/fs/ssdfs/<device> kernel object
  * @dev_kobj_unregister: completion state for <device> kernel object
  * @maptbl_kobj: /sys/fs/<ssdfs>/<device>/maptbl kernel object
@@ -284,6 +532,8 @@ struct ssdfs_fs_info {
 	u16 create_threads_per_seg;
 
 	unsigned long mount_opts;
+	u32 inline_file_max;
+	u32 invalidation_budget;
 	struct ssdfs_metadata_options metadata_options;
 
 	struct rw_semaphore volume_sem;
@@ -303,12 +553,14 @@ struct ssdfs_fs_info {
 	atomic_t global_fs_state;
 
 	spinlock_t volume_state_lock;
-	u64 free_pages;
-	u64 reserved_new_user_data_pages;
-	u64 updated_user_data_pages;
-	u64 flushing_user_data_requests;
-	wait_queue_head_t pending_wq;
+	struct percpu_counter free_pages;
+	struct percpu_counter reserved_new_user_data_pages;
+	struct percpu_counter updated_user_data_pages;
+	struct percpu_counter flushing_user_data_requests;
 	wait_queue_head_t finish_user_data_flush_wq;
+	spinlock_t orphans_lock;
+	struct list_head orphans;
+	struct work_struct orphans_work;
 	u64 fs_mount_time;
 	u64 fs_mod_time;
 	u64 fs_mount_cno;
@@ -335,6 +587,7 @@ struct ssdfs_fs_info {
 
 	struct ssdfs_peb_mapping_table *maptbl;
 	struct ssdfs_maptbl_cache maptbl_cache;
+	struct ssdfs_log_hdr_cache *log_hdr_cache;
 
 	struct ssdfs_segment_tree *segs_tree;
 	struct inode *segs_tree_inode;
@@ -346,12 +599,28 @@ struct ssdfs_fs_info {
 	struct ssdfs_inodes_btree_info *inodes_tree;
 	struct ssdfs_invextree_info *invextree;
 
+	struct mutex btrees_lock;
+	struct list_head btrees_list;
+	atomic64_t btree_nodes_count;
+	struct shrinker btree_nodes_shrinker;
+	struct ssdfs_reclaim_stats reclaim_stats[SSDFS_RECLAIM_TYPE_MAX];
+
 	struct ssdfs_snapshot_subsystem snapshots;
 
 	struct ssdfs_thread_info gc_thread[SSDFS_GC_THREAD_TYPE_MAX];
 	wait_queue_head_t gc_wait_queue[SSDFS_GC_THREAD_TYPE_MAX];
 	atomic_t gc_should_act[SSDFS_GC_THREAD_TYPE_MAX];
+	struct ssdfs_gc_governor gc_governor;
+	struct ssdfs_write_throttle write_throttle;
 	atomic64_t flush_reqs;
+	atomic_t req_latency_msecs[SSDFS_REQ_PRIO_CLASS_MAX];
+	struct ssdfs_cache_flush_group flush_group;
+	atomic_t data_log_stream_score;
+	struct ssdfs_dow_stats dow_stats[SSDFS_DOW_TYPE_MAX];
+	atomic_t dow_fold_chain;
+	struct ssdfs_wa_stats wa_stats;
+	struct ssdfs_lookup_stats lookup_stats[SSDFS_LOOKUP_TYPE_MAX];
+	struct ssdfs_mount_profile mount_profile;
 
 	struct super_block *sb;
 
@@ -365,6 +634,7 @@ struct ssdfs_fs_info {
 	u64 zone_capacity;
 	u32 max_open_zones;
 	atomic_t open_zones;
+	struct ssdfs_zns_open_zones zns_open_zones;
 
 	/* /sys/fs/ssdfs/<device> */
 	struct kobject dev_kobj;
@@ -386,6 +656,7 @@ struct ssdfs_fs_info {
 	struct address_space testing_pages;
 	struct inode *testing_inode;
 	bool do_fork_invalidation;
+	struct ssdfs_benchmark_context *testing_bench;
 #endif /* CONFIG_SSDFS_TESTING */
 };
 
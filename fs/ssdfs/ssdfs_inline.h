@@ -16,6 +16,7 @@
 
 #include <linux/slab.h>
 #include <linux/swap.h>
+#include <linux/percpu.h>
 
 #define SSDFS_CRIT(fmt, ...) \
 	pr_crit("pid %d:%s:%d %s(): " fmt, \
@@ -59,6 +60,177 @@ extern atomic64_t ssdfs_memory_leaks;
 extern atomic64_t ssdfs_locked_pages;
 #endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
 
+/*
+ * Memory accounting per subsystem.
+ *
+ * Every source file allocates memory by means of its own family of
+ * allocation methods (SSDFS_MEMORY_ALLOCATOR_FNS). These methods
+ * account the bytes of allocated memory in the per-CPU counter
+ * of the subsystem. The accounting is always on and it doesn't
+ * require any shared cache line. The value of subsystem's counter
+ * is the sum of CPUs' counters. The value is exported by sysfs
+ * (/sys/fs/ssdfs/memory/<subsystem>). The memory that was allocated
+ * by vmalloc is not accounted.
+ */
+#define SSDFS_MEM_STAT_SUBSYSTEMS(X) \
+	X(acl) X(blk2off) X(block_bmap) X(btree) X(btree_hierarchy) \
+	X(btree_node) X(btree_search) X(compr) X(cur_seg) X(dentries) \
+	X(dev_bdev) X(dev_mtd) X(dev_zns) X(dict) X(diff) X(dir) \
+	X(dynamic_array) X(ext_queue) X(ext_tree) X(file) X(flush) \
+	X(fs_error) X(gc) X(ino_tree) X(inode) X(invext_tree) \
+	X(lhdr_cache) X(lz4) X(lzo) X(map_cache) X(map_queue) \
+	X(map_tbl) X(map_thread) X(migration) X(page_vector) X(parray) \
+	X(peb) X(read) X(recovery) X(req_queue) X(seg_blk) X(seg_bmap) \
+	X(seg_obj) X(seg_tree) X(seq_arr) X(shextree) \
+	X(snap_reqs_queue) X(snap_rules_list) X(snap_tree) X(super) \
+	X(xattr) X(zlib) X(zstd)
+
+#define SSDFS_MEM_STAT_ID(name)		SSDFS_MEM_STAT_##name,
+
+enum {
+	SSDFS_MEM_STAT_SUBSYSTEMS(SSDFS_MEM_STAT_ID)
+	SSDFS_MEM_STAT_MAX
+};
+
+#undef SSDFS_MEM_STAT_ID
+
+/*
+ * struct ssdfs_mem_stat - per-CPU memory accounting
+ * @bytes: array of subsystems' counters
+ */
+struct ssdfs_mem_stat {
+	s64 bytes[SSDFS_MEM_STAT_MAX];
+};
+
+DECLARE_PER_CPU(struct ssdfs_mem_stat, ssdfs_mem_stat);
+
+s64 ssdfs_mem_stat_read(int id);
+
+static inline
+void ssdfs_mem_stat_add(int id, s64 bytes)
+{
+	this_cpu_add(ssdfs_mem_stat.bytes[id], bytes);
+}
+
+static inline
+s64 ssdfs_mem_stat_ksize(const void *kaddr)
+{
+	if (ZERO_OR_NULL_PTR(kaddr) || is_vmalloc_addr(kaddr))
+		return 0;
+
+	return (s64)ksize(kaddr);
+}
+
+#define SSDFS_MEM_STAT_ACCOUNT(name, kaddr) \
+	ssdfs_mem_stat_add(SSDFS_MEM_STAT_##name, \
+			   ssdfs_mem_stat_ksize(kaddr))
+#define SSDFS_MEM_STAT_FORGET(name, kaddr) \
+	ssdfs_mem_stat_add(SSDFS_MEM_STAT_##name, \
+			   -ssdfs_mem_stat_ksize(kaddr))
+#define SSDFS_MEM_STAT_ACCOUNT_PAGE(name) \
+	ssdfs_mem_stat_add(SSDFS_MEM_STAT_##name, PAGE_SIZE)
+#define SSDFS_MEM_STAT_FORGET_PAGE(name) \
+	ssdfs_mem_stat_add(SSDFS_MEM_STAT_##name, -(s64)PAGE_SIZE)
+
+/*
+ * Contention statistics of hot locks.
+ *
+ * The lock is tried first. If the lock is contended then the time
+ * of waiting is measured. The counters are per-CPU and the values
+ * are exported by sysfs (/sys/fs/ssdfs/locks/<lock>). The statistics
+ * are module-wide because the locks' owners have no uniform access
+ * to the file system object. The wrappers are plain lock operations
+ * if CONFIG_SSDFS_LOCK_STATS is disabled.
+ */
+#define SSDFS_LOCK_STAT_CLASSES(X) \
+	X(volume_state) X(cur_segs) X(pebc) X(maptbl_frag) \
+	X(btree) X(btree_node) X(blk2off)
+
+#define SSDFS_LOCK_STAT_ID(name)	SSDFS_LOCK_STAT_##name,
+
+enum {
+	SSDFS_LOCK_STAT_CLASSES(SSDFS_LOCK_STAT_ID)
+	SSDFS_LOCK_STAT_MAX
+};
+
+#undef SSDFS_LOCK_STAT_ID
+
+#ifdef CONFIG_SSDFS_LOCK_STATS
+/*
+ * struct ssdfs_lock_stat - per-CPU lock contention accounting
+ * @acquired: number of locks' acquisitions
+ * @contended: number of acquisitions that had to wait
+ * @wait_nsecs: total time of waiting in nanoseconds
+ */
+struct ssdfs_lock_stat {
+	u64 acquired[SSDFS_LOCK_STAT_MAX];
+	u64 contended[SSDFS_LOCK_STAT_MAX];
+	u64 wait_nsecs[SSDFS_LOCK_STAT_MAX];
+};
+
+DECLARE_PER_CPU(struct ssdfs_lock_stat, ssdfs_lock_stat);
+
+static inline
+void ssdfs_lock_stat_contended(int id, ktime_t start)
+{
+	this_cpu_inc(ssdfs_lock_stat.contended[id]);
+	this_cpu_add(ssdfs_lock_stat.wait_nsecs[id],
+		     ktime_to_ns(ktime_sub(ktime_get(), start)));
+}
+
+#define SSDFS_LOCK_STAT_ACQUIRE(name, trylock, lock, ptr) \
+	do { \
+		int __id = SSDFS_LOCK_STAT_##name; \
+		this_cpu_inc(ssdfs_lock_stat.acquired[__id]); \
+		if (!trylock(ptr)) { \
+			ktime_t __start = ktime_get(); \
+			lock(ptr); \
+			ssdfs_lock_stat_contended(__id, __start); \
+		} \
+	} while (0)
+
+#define SSDFS_DOWN_READ(name, sem) \
+	SSDFS_LOCK_STAT_ACQUIRE(name, down_read_trylock, down_read, sem)
+#define SSDFS_DOWN_WRITE(name, sem) \
+	SSDFS_LOCK_STAT_ACQUIRE(name, down_write_trylock, down_write, sem)
+#define SSDFS_SPIN_LOCK(name, lock) \
+	SSDFS_LOCK_STAT_ACQUIRE(name, spin_trylock, spin_lock, lock)
+#else
+#define SSDFS_DOWN_READ(name, sem)	down_read(sem)
+#define SSDFS_DOWN_WRITE(name, sem)	down_write(sem)
+#define SSDFS_SPIN_LOCK(name, lock)	spin_lock(lock)
+#endif /* CONFIG_SSDFS_LOCK_STATS */
+
+#ifdef CONFIG_SSDFS_PAGE_POOL
+int ssdfs_page_pool_init(void);
+void ssdfs_page_pool_exit(void);
+struct page *ssdfs_page_pool_get(gfp_t gfp_mask);
+bool ssdfs_page_pool_put(struct page *page);
+#else
+static inline
+int ssdfs_page_pool_init(void)
+{
+	return 0;
+}
+
+static inline
+void ssdfs_page_pool_exit(void)
+{
+}
+
+static inline
+struct page *ssdfs_page_pool_get(gfp_t gfp_mask)
+{
+	return NULL;
+}
+
+static inline
+bool ssdfs_page_pool_put(struct page *page)
+{
+	return false;
+}
+#endif /* CONFIG_SSDFS_PAGE_POOL */
+
 static inline
 void ssdfs_memory_leaks_increment(void *kaddr)
 {
@@ -127,6 +299,28 @@ void *ssdfs_kcalloc(size_t n, size_t size, gfp_t flags)
 	return kaddr;
 }
 
+static inline
+void *ssdfs_kzalloc_node(size_t size, gfp_t flags, int node)
+{
+	void *kaddr = kzalloc_node(size, flags, node);
+
+	if (kaddr)
+		ssdfs_memory_leaks_increment(kaddr);
+
+	return kaddr;
+}
+
+static inline
+void *ssdfs_kcalloc_node(size_t n, size_t size, gfp_t flags, int node)
+{
+	void *kaddr = kcalloc_node(n, size, flags, node);
+
+	if (kaddr)
+		ssdfs_memory_leaks_increment(kaddr);
+
+	return kaddr;
+}
+
 static inline
 void ssdfs_kfree(void *kaddr)
 {
@@ -240,7 +434,10 @@ struct page *ssdfs_alloc_page(gfp_t gfp_mask)
 {
 	struct page *page;
 
-	page = alloc_page(gfp_mask);
+	page = ssdfs_page_pool_get(gfp_mask);
+	if (!page)
+		page = alloc_page(gfp_mask);
+
 	if (unlikely(!page)) {
 		SSDFS_ERR("unable to allocate memory page\n");
 		return ERR_PTR(-ENOMEM);
@@ -357,7 +554,8 @@ void ssdfs_free_page(struct page *page)
 		  page, atomic64_read(&ssdfs_allocated_pages));
 #endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
 
-	__free_pages(page, 0);
+	if (!ssdfs_page_pool_put(page))
+		__free_pages(page, 0);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("page %p, count %d, "
@@ -402,6 +600,7 @@ static inline								\
 void ssdfs_##name##_cache_leaks_increment(void *kaddr)			\
 {									\
 	atomic64_inc(&ssdfs_##name##_cache_leaks);			\
+	SSDFS_MEM_STAT_ACCOUNT(name, kaddr);				\
 	SSDFS_DBG("memory %p, allocation count %lld\n",			\
 		  kaddr,						\
 		  atomic64_read(&ssdfs_##name##_cache_leaks));		\
@@ -411,6 +610,7 @@ static inline								\
 void ssdfs_##name##_cache_leaks_decrement(void *kaddr)			\
 {									\
 	atomic64_dec(&ssdfs_##name##_cache_leaks);			\
+	SSDFS_MEM_STAT_FORGET(name, kaddr);				\
 	SSDFS_DBG("memory %p, allocation count %lld\n",			\
 		  kaddr,						\
 		  atomic64_read(&ssdfs_##name##_cache_leaks));		\
@@ -422,6 +622,7 @@ void *ssdfs_##name##_kmalloc(size_t size, gfp_t flags)			\
 	void *kaddr = ssdfs_kmalloc(size, flags);			\
 	if (kaddr) {							\
 		atomic64_inc(&ssdfs_##name##_memory_leaks);		\
+		SSDFS_MEM_STAT_ACCOUNT(name, kaddr);			\
 		SSDFS_DBG("memory %p, allocation count %lld\n",		\
 			  kaddr,					\
 			  atomic64_read(&ssdfs_##name##_memory_leaks));	\
@@ -434,6 +635,7 @@ void *ssdfs_##name##_kzalloc(size_t size, gfp_t flags)			\
 	void *kaddr = ssdfs_kzalloc(size, flags);			\
 	if (kaddr) {							\
 		atomic64_inc(&ssdfs_##name##_memory_leaks);		\
+		SSDFS_MEM_STAT_ACCOUNT(name, kaddr);			\
 		SSDFS_DBG("memory %p, allocation count %lld\n",		\
 			  kaddr,					\
 			  atomic64_read(&ssdfs_##name##_memory_leaks));	\
@@ -446,6 +648,7 @@ void *ssdfs_##name##_kvzalloc(size_t size, gfp_t flags)			\
 	void *kaddr = ssdfs_kvzalloc(size, flags);			\
 	if (kaddr) {							\
 		atomic64_inc(&ssdfs_##name##_memory_leaks);		\
+		SSDFS_MEM_STAT_ACCOUNT(name, kaddr);			\
 		SSDFS_DBG("memory %p, allocation count %lld\n",		\
 			  kaddr,					\
 			  atomic64_read(&ssdfs_##name##_memory_leaks));	\
@@ -458,6 +661,34 @@ void *ssdfs_##name##_kcalloc(size_t n, size_t size, gfp_t flags)	\
 	void *kaddr = ssdfs_kcalloc(n, size, flags);			\
 	if (kaddr) {							\
 		atomic64_inc(&ssdfs_##name##_memory_leaks);		\
+		SSDFS_MEM_STAT_ACCOUNT(name, kaddr);			\
+		SSDFS_DBG("memory %p, allocation count %lld\n",		\
+			  kaddr,					\
+			  atomic64_read(&ssdfs_##name##_memory_leaks));	\
+	}								\
+	return kaddr;							\
+}									\
+static inline								\
+void *ssdfs_##name##_kzalloc_node(size_t size, gfp_t flags, int node)	\
+{									\
+	void *kaddr = ssdfs_kzalloc_node(size, flags, node);		\
+	if (kaddr) {							\
+		atomic64_inc(&ssdfs_##name##_memory_leaks);		\
+		SSDFS_MEM_STAT_ACCOUNT(name, kaddr);			\
+		SSDFS_DBG("memory %p, allocation count %lld\n",		\
+			  kaddr,					\
+			  atomic64_read(&ssdfs_##name##_memory_leaks));	\
+	}								\
+	return kaddr;							\
+}									\
+static inline								\
+void *ssdfs_##name##_kcalloc_node(size_t n, size_t size,		\
+				  gfp_t flags, int node)		\
+{									\
+	void *kaddr = ssdfs_kcalloc_node(n, size, flags, node);		\
+	if (kaddr) {							\
+		atomic64_inc(&ssdfs_##name##_memory_leaks);		\
+		SSDFS_MEM_STAT_ACCOUNT(name, kaddr);			\
 		SSDFS_DBG("memory %p, allocation count %lld\n",		\
 			  kaddr,					\
 			  atomic64_read(&ssdfs_##name##_memory_leaks));	\
@@ -469,6 +700,7 @@ void ssdfs_##name##_kfree(void *kaddr)					\
 {									\
 	if (kaddr) {							\
 		atomic64_dec(&ssdfs_##name##_memory_leaks);		\
+		SSDFS_MEM_STAT_FORGET(name, kaddr);			\
 		SSDFS_DBG("memory %p, allocation count %lld\n",		\
 			  kaddr,					\
 			  atomic64_read(&ssdfs_##name##_memory_leaks));	\
@@ -480,6 +712,7 @@ void ssdfs_##name##_kvfree(void *kaddr)					\
 {									\
 	if (kaddr) {							\
 		atomic64_dec(&ssdfs_##name##_memory_leaks);		\
+		SSDFS_MEM_STAT_FORGET(name, kaddr);			\
 		SSDFS_DBG("memory %p, allocation count %lld\n",		\
 			  kaddr,					\
 			  atomic64_read(&ssdfs_##name##_memory_leaks));	\
@@ -493,6 +726,7 @@ struct page *ssdfs_##name##_alloc_page(gfp_t gfp_mask)			\
 	page = ssdfs_alloc_page(gfp_mask);				\
 	if (!IS_ERR_OR_NULL(page)) {					\
 		atomic64_inc(&ssdfs_##name##_page_leaks);		\
+		SSDFS_MEM_STAT_ACCOUNT_PAGE(name);			\
 		SSDFS_DBG("page %p, allocated_pages %lld\n",		\
 			  page,						\
 			  atomic64_read(&ssdfs_##name##_page_leaks));	\
@@ -504,6 +738,7 @@ void ssdfs_##name##_account_page(struct page *page)			\
 {									\
 	if (page) {							\
 		atomic64_inc(&ssdfs_##name##_page_leaks);		\
+		SSDFS_MEM_STAT_ACCOUNT_PAGE(name);			\
 		SSDFS_DBG("page %p, allocated_pages %lld\n",		\
 			  page,						\
 			  atomic64_read(&ssdfs_##name##_page_leaks));	\
@@ -514,6 +749,7 @@ void ssdfs_##name##_forget_page(struct page *page)			\
 {									\
 	if (page) {							\
 		atomic64_dec(&ssdfs_##name##_page_leaks);		\
+		SSDFS_MEM_STAT_FORGET_PAGE(name);			\
 		SSDFS_DBG("page %p, allocated_pages %lld\n",		\
 			  page,						\
 			  atomic64_read(&ssdfs_##name##_page_leaks));	\
@@ -526,6 +762,7 @@ struct page *ssdfs_##name##_add_pagevec_page(struct pagevec *pvec)	\
 	page = ssdfs_add_pagevec_page(pvec);				\
 	if (!IS_ERR_OR_NULL(page)) {					\
 		atomic64_inc(&ssdfs_##name##_page_leaks);		\
+		SSDFS_MEM_STAT_ACCOUNT_PAGE(name);			\
 		SSDFS_DBG("page %p, allocated_pages %lld\n",		\
 			  page,						\
 			  atomic64_read(&ssdfs_##name##_page_leaks));	\
@@ -537,6 +774,7 @@ void ssdfs_##name##_free_page(struct page *page)			\
 {									\
 	if (page) {							\
 		atomic64_dec(&ssdfs_##name##_page_leaks);		\
+		SSDFS_MEM_STAT_FORGET_PAGE(name);			\
 		SSDFS_DBG("page %p, allocated_pages %lld\n",		\
 			  page,						\
 			  atomic64_read(&ssdfs_##name##_page_leaks));	\
@@ -553,6 +791,7 @@ void ssdfs_##name##_pagevec_release(struct pagevec *pvec)		\
 			if (!page)					\
 				continue;				\
 			atomic64_dec(&ssdfs_##name##_page_leaks);	\
+			SSDFS_MEM_STAT_FORGET_PAGE(name);		\
 			SSDFS_DBG("page %p, allocated_pages %lld\n",	\
 			    page,					\
 			    atomic64_read(&ssdfs_##name##_page_leaks));	\
@@ -565,71 +804,117 @@ void ssdfs_##name##_pagevec_release(struct pagevec *pvec)		\
 static inline								\
 void ssdfs_##name##_cache_leaks_increment(void *kaddr)			\
 {									\
+	SSDFS_MEM_STAT_ACCOUNT(name, kaddr);				\
 	ssdfs_memory_leaks_increment(kaddr);				\
 }									\
 static inline								\
 void ssdfs_##name##_cache_leaks_decrement(void *kaddr)			\
 {									\
+	SSDFS_MEM_STAT_FORGET(name, kaddr);				\
 	ssdfs_memory_leaks_decrement(kaddr);				\
 }									\
 static inline								\
 void *ssdfs_##name##_kmalloc(size_t size, gfp_t flags)			\
 {									\
-	return ssdfs_kmalloc(size, flags);				\
+	void *kaddr = ssdfs_kmalloc(size, flags);			\
+	SSDFS_MEM_STAT_ACCOUNT(name, kaddr);				\
+	return kaddr;							\
 }									\
 static inline								\
 void *ssdfs_##name##_kzalloc(size_t size, gfp_t flags)			\
 {									\
-	return ssdfs_kzalloc(size, flags);				\
+	void *kaddr = ssdfs_kzalloc(size, flags);			\
+	SSDFS_MEM_STAT_ACCOUNT(name, kaddr);				\
+	return kaddr;							\
 }									\
 static inline								\
 void *ssdfs_##name##_kvzalloc(size_t size, gfp_t flags)			\
 {									\
-	return ssdfs_kvzalloc(size, flags);				\
+	void *kaddr = ssdfs_kvzalloc(size, flags);			\
+	SSDFS_MEM_STAT_ACCOUNT(name, kaddr);				\
+	return kaddr;							\
 }									\
 static inline								\
 void *ssdfs_##name##_kcalloc(size_t n, size_t size, gfp_t flags)	\
 {									\
-	return ssdfs_kcalloc(n, size, flags);				\
+	void *kaddr = ssdfs_kcalloc(n, size, flags);			\
+	SSDFS_MEM_STAT_ACCOUNT(name, kaddr);				\
+	return kaddr;							\
+}									\
+static inline								\
+void *ssdfs_##name##_kzalloc_node(size_t size, gfp_t flags, int node)	\
+{									\
+	void *kaddr = ssdfs_kzalloc_node(size, flags, node);		\
+	SSDFS_MEM_STAT_ACCOUNT(name, kaddr);				\
+	return kaddr;							\
+}									\
+static inline								\
+void *ssdfs_##name##_kcalloc_node(size_t n, size_t size,		\
+				  gfp_t flags, int node)		\
+{									\
+	void *kaddr = ssdfs_kcalloc_node(n, size, flags, node);		\
+	SSDFS_MEM_STAT_ACCOUNT(name, kaddr);				\
+	return kaddr;							\
 }									\
 static inline								\
 void ssdfs_##name##_kfree(void *kaddr)					\
 {									\
+	SSDFS_MEM_STAT_FORGET(name, kaddr);				\
 	ssdfs_kfree(kaddr);						\
 }									\
 static inline								\
 void ssdfs_##name##_kvfree(void *kaddr)					\
 {									\
+	SSDFS_MEM_STAT_FORGET(name, kaddr);				\
 	ssdfs_kvfree(kaddr);						\
 }									\
 static inline								\
 struct page *ssdfs_##name##_alloc_page(gfp_t gfp_mask)			\
 {									\
-	return ssdfs_alloc_page(gfp_mask);				\
+	struct page *page = ssdfs_alloc_page(gfp_mask);			\
+	if (!IS_ERR_OR_NULL(page))					\
+		SSDFS_MEM_STAT_ACCOUNT_PAGE(name);			\
+	return page;							\
 }									\
 static inline								\
 void ssdfs_##name##_account_page(struct page *page)			\
 {									\
+	if (page)							\
+		SSDFS_MEM_STAT_ACCOUNT_PAGE(name);			\
 	ssdfs_account_page(page);					\
 }									\
 static inline								\
 void ssdfs_##name##_forget_page(struct page *page)			\
 {									\
+	if (page)							\
+		SSDFS_MEM_STAT_FORGET_PAGE(name);			\
 	ssdfs_forget_page(page);					\
 }									\
 static inline								\
 struct page *ssdfs_##name##_add_pagevec_page(struct pagevec *pvec)	\
 {									\
-	return ssdfs_add_pagevec_page(pvec);				\
+	struct page *page = ssdfs_add_pagevec_page(pvec);		\
+	if (!IS_ERR_OR_NULL(page))					\
+		SSDFS_MEM_STAT_ACCOUNT_PAGE(name);			\
+	return page;							\
 }									\
 static inline								\
 void ssdfs_##name##_free_page(struct page *page)			\
 {									\
+	if (page)							\
+		SSDFS_MEM_STAT_FORGET_PAGE(name);			\
 	ssdfs_free_page(page);						\
 }									\
 static inline								\
 void ssdfs_##name##_pagevec_release(struct pagevec *pvec)		\
 {									\
+	int i;								\
+	if (pvec) {							\
+		for (i = 0; i < pagevec_count(pvec); i++) {		\
+			if (pvec->pages[i])				\
+				SSDFS_MEM_STAT_FORGET_PAGE(name);	\
+		}							\
+	}								\
 	ssdfs_pagevec_release(pvec);					\
 }									\
 
@@ -639,6 +924,302 @@ __le32 ssdfs_crc32_le(void *data, size_t len)
 	return cpu_to_le32(crc32(~0, data, len));
 }
 
+/*
+ * ssdfs_account_reclaim() - account the result of shrinker's scan
+ * @fsi: pointer on shared file system object
+ * @type: shrinker type
+ * @scanned: number of scanned objects
+ * @reclaimed: number of reclaimed objects
+ * @busy: number of scanned objects that cannot be reclaimed yet
+ */
+static inline
+void ssdfs_account_reclaim(struct ssdfs_fs_info *fsi, int type,
+			   unsigned long scanned, unsigned long reclaimed,
+			   unsigned long busy)
+{
+	struct ssdfs_reclaim_stats *stats;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(type < 0 || type >= SSDFS_RECLAIM_TYPE_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	stats = &fsi->reclaim_stats[type];
+
+	atomic64_inc(&stats->scans);
+	atomic64_add(scanned, &stats->scanned);
+	atomic64_add(reclaimed, &stats->reclaimed);
+	atomic64_add(busy, &stats->busy);
+}
+
+/*
+ * ssdfs_account_write_amplification() - account written bytes
+ * @fsi: pointer on shared file system object
+ * @type: category of written bytes
+ * @bytes: number of bytes
+ */
+static inline
+void ssdfs_account_write_amplification(struct ssdfs_fs_info *fsi,
+					int type, u64 bytes)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(type < 0 || type >= SSDFS_WA_TYPE_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (bytes == 0)
+		return;
+
+	atomic64_add(bytes, &fsi->wa_stats.bytes[type]);
+}
+
+/*
+ * Volume's free space counters.
+ *
+ * The free pages, the reserved and updated pages of user data and
+ * the number of user data flush requests are changed on every write.
+ * They are per-CPU counters, so, the write path doesn't take
+ * any global lock. The precise sum of the counter is calculated
+ * only if the value is close to the checked limit. The volume
+ * header and log footer store the precise value.
+ */
+static inline
+int ssdfs_fs_counters_init(struct ssdfs_fs_info *fsi)
+{
+	int err;
+
+	err = percpu_counter_init(&fsi->free_pages, 0, GFP_KERNEL);
+	if (err)
+		goto fail_init;
+
+	err = percpu_counter_init(&fsi->reserved_new_user_data_pages,
+				  0, GFP_KERNEL);
+	if (err)
+		goto destroy_free_pages;
+
+	err = percpu_counter_init(&fsi->updated_user_data_pages,
+				  0, GFP_KERNEL);
+	if (err)
+		goto destroy_reserved_pages;
+
+	err = percpu_counter_init(&fsi->flushing_user_data_requests,
+				  0, GFP_KERNEL);
+	if (err)
+		goto destroy_updated_pages;
+
+	return 0;
+
+destroy_updated_pages:
+	percpu_counter_destroy(&fsi->updated_user_data_pages);
+
+destroy_reserved_pages:
+	percpu_counter_destroy(&fsi->reserved_new_user_data_pages);
+
+destroy_free_pages:
+	percpu_counter_destroy(&fsi->free_pages);
+
+fail_init:
+	return err;
+}
+
+static inline
+void ssdfs_fs_counters_destroy(struct ssdfs_fs_info *fsi)
+{
+	percpu_counter_destroy(&fsi->flushing_user_data_requests);
+	percpu_counter_destroy(&fsi->updated_user_data_pages);
+	percpu_counter_destroy(&fsi->reserved_new_user_data_pages);
+	percpu_counter_destroy(&fsi->free_pages);
+}
+
+/*
+ * ssdfs_fs_counter_read() - approximate value of the counter
+ * @counter: per-CPU counter
+ */
+static inline
+u64 ssdfs_fs_counter_read(struct percpu_counter *counter)
+{
+	return (u64)percpu_counter_read_positive(counter);
+}
+
+/*
+ * ssdfs_fs_counter_sum() - precise value of the counter
+ * @counter: per-CPU counter
+ */
+static inline
+u64 ssdfs_fs_counter_sum(struct percpu_counter *counter)
+{
+	return (u64)percpu_counter_sum_positive(counter);
+}
+
+/*
+ * ssdfs_fs_counter_positive() - check that counter is not zero
+ * @counter: per-CPU counter
+ */
+static inline
+bool ssdfs_fs_counter_positive(struct percpu_counter *counter)
+{
+	return percpu_counter_compare(counter, 0) > 0;
+}
+
+/*
+ * ssdfs_fs_counter_try_sub() - decrease the counter if it is big enough
+ * @counter: per-CPU counter
+ * @count: decreasing value
+ *
+ * The counter is decreased at first. If the value becomes negative
+ * then the decrement is reverted. So, the concurrent threads
+ * cannot overcommit the counter's value.
+ *
+ * RETURN: true if the counter has been decreased.
+ */
+static inline
+bool ssdfs_fs_counter_try_sub(struct percpu_counter *counter, u64 count)
+{
+	percpu_counter_sub(counter, (s64)count);
+
+	if (percpu_counter_compare(counter, 0) < 0) {
+		percpu_counter_add(counter, (s64)count);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * ssdfs_account_lookup() - account latency and result of lookup
+ * @fsi: pointer on shared file system object
+ * @type: lookup type
+ * @start: timestamp of lookup's start
+ * @err: result of lookup
+ */
+static inline
+void ssdfs_account_lookup(struct ssdfs_fs_info *fsi, int type,
+			  ktime_t start, int err)
+{
+	struct ssdfs_lookup_stats *stats;
+	s64 nsecs;
+	int bucket = 0;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(type < 0 || type >= SSDFS_LOOKUP_TYPE_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	stats = &fsi->lookup_stats[type];
+
+	if (err < 0)
+		atomic64_inc(&stats->misses);
+	else
+		atomic64_inc(&stats->hits);
+
+	nsecs = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (nsecs > 1) {
+		bucket = ilog2(nsecs);
+		bucket = min_t(int, bucket, SSDFS_LOOKUP_LATENCY_BUCKETS - 1);
+	}
+
+	atomic64_inc(&stats->latency[bucket]);
+}
+
+/*
+ * ssdfs_account_mount_phase() - account time of mount phase
+ * @fsi: pointer on shared file system object
+ * @phase: mount phase
+ * @start: timestamp of phase's start
+ */
+static inline
+void ssdfs_account_mount_phase(struct ssdfs_fs_info *fsi, int phase,
+				ktime_t start)
+{
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(phase < 0 || phase >= SSDFS_MOUNT_PHASE_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	fsi->mount_profile.nsecs[phase] +=
+			ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+/*
+ * ssdfs_mount_phase_name() - get name of mount phase
+ * @phase: mount phase
+ */
+static inline
+const char *ssdfs_mount_phase_name(int phase)
+{
+	switch (phase) {
+	case SSDFS_MOUNT_VOLUME_HEADER:
+		return "volume_header";
+	case SSDFS_MOUNT_SB_FAST_SEARCH:
+		return "sb_fast_search";
+	case SSDFS_MOUNT_SB_SLOW_SEARCH:
+		return "sb_slow_search";
+	case SSDFS_MOUNT_SB_FALLBACK_SEARCH:
+		return "sb_fallback_search";
+	case SSDFS_MOUNT_VOLUME_STATE:
+		return "volume_state";
+	case SSDFS_MOUNT_SNAPSHOTS_TREE:
+		return "snapshots_tree";
+	case SSDFS_MOUNT_SEGMENTS_TREE:
+		return "segments_tree";
+	case SSDFS_MOUNT_MAPTBL:
+		return "maptbl";
+	case SSDFS_MOUNT_SEGBMAP:
+		return "segbmap";
+	case SSDFS_MOUNT_SHEXTREE:
+		return "shextree";
+	case SSDFS_MOUNT_INVEXTREE:
+		return "invextree";
+	case SSDFS_MOUNT_CURRENT_SEGMENTS:
+		return "current_segments";
+	case SSDFS_MOUNT_SHARED_DICT:
+		return "shared_dict";
+	case SSDFS_MOUNT_INODES_TREE:
+		return "inodes_tree";
+	case SSDFS_MOUNT_ROOT_INODE:
+		return "root_inode";
+	case SSDFS_MOUNT_GC_THREADS:
+		return "gc_threads";
+	case SSDFS_MOUNT_COMMIT_SB:
+		return "commit_sb";
+	}
+
+	return "unknown";
+}
+
+/*
+ * ssdfs_csum_type() - checksum type of new metadata structures
+ * @fsi: pointer on shared file system object
+ *
+ * CRC32C is calculated by the CPU instructions (SSE4.2, ARMv8 CRC)
+ * by means of crypto API. The CRC32 is used for volumes that
+ * were created without CRC32C support.
+ */
+static inline
+u16 ssdfs_csum_type(struct ssdfs_fs_info *fsi)
+{
+	if (fsi->fs_feature_incompat & SSDFS_HAS_CRC32C_CSUM_INCOMPAT_FLAG)
+		return SSDFS_CRC32C;
+
+	return SSDFS_CRC32;
+}
+
+/*
+ * ssdfs_csum_update() - update checksum by next fragment of data
+ * @flags: metadata check flags
+ * @csum: current value of checksum (~0 for the first fragment)
+ * @data: fragment of data
+ * @len: size of fragment in bytes
+ *
+ * The checksum of data that is split on several fragments
+ * (memory pages, for example) can be calculated in one pass
+ * by calling the method for every fragment in sequence.
+ */
+static inline
+u32 ssdfs_csum_update(u16 flags, u32 csum, const void *data, size_t len)
+{
+	if (flags & SSDFS_CRC32C)
+		return crc32c(csum, data, len);
+
+	return crc32(csum, data, len);
+}
+
 static inline
 int ssdfs_calculate_csum(struct ssdfs_metadata_check *check,
 			  void *buf, size_t buf_size)
@@ -658,9 +1239,10 @@ int ssdfs_calculate_csum(struct ssdfs_metadata_check *check,
 		return -EINVAL;
 	}
 
-	if (flags & SSDFS_CRC32) {
+	if (flags & (SSDFS_CRC32 | SSDFS_CRC32C)) {
 		check->csum = 0;
-		check->csum = ssdfs_crc32_le(buf, bytes);
+		check->csum = cpu_to_le32(ssdfs_csum_update(flags, ~0,
+							    buf, bytes));
 	} else {
 		SSDFS_ERR("unknown flags set %#x\n", flags);
 		return -EINVAL;
@@ -746,6 +1328,15 @@ bool is_ssdfs_magic_valid(struct ssdfs_signature *magic)
 #define SSDFS_MOUNT_ERRORS_RO			(1 << 4)
 #define SSDFS_MOUNT_ERRORS_PANIC		(1 << 5)
 #define SSDFS_MOUNT_IGNORE_FS_STATE		(1 << 6)
+#define SSDFS_MOUNT_PERCPU_CUR_SEGS		(1 << 7)
+#define SSDFS_MOUNT_LAZY_PEB_THREADS		(1 << 8)
+#define SSDFS_MOUNT_DATA_TEMP_STREAMS		(1 << 9)
+#define SSDFS_MOUNT_LAZY_BLK2OFF_INIT		(1 << 10)
+#define SSDFS_MOUNT_COMPR_BTREE_NODES		(1 << 11)
+#define SSDFS_MOUNT_COMPR_MODE_ZSTD		(1 << 12)
+#define SSDFS_MOUNT_COMPR_MODE_LZ4		(1 << 13)
+#define SSDFS_MOUNT_PEB_AFFINITY		(1 << 14)
+#define SSDFS_MOUNT_META_IO_PRIO		(1 << 15)
 
 #define ssdfs_clear_opt(o, opt)		((o) &= ~SSDFS_MOUNT_##opt)
 #define ssdfs_set_opt(o, opt)		((o) |= SSDFS_MOUNT_##opt)
@@ -816,6 +1407,16 @@ u64 ssdfs_current_cno(struct super_block *sb)
 		boot_vs_mount_timediff;
 }
 
+static inline
+void ssdfs_io_batch_init(struct ssdfs_io_batch *batch)
+{
+	atomic_set(&batch->pending, 0);
+	batch->err = 0;
+	spin_lock_init(&batch->lock);
+	bio_list_init(&batch->completed);
+	init_waitqueue_head(&batch->wait);
+}
+
 #define SSDFS_MAPTBL_CACHE_HDR(ptr) \
 	((struct ssdfs_maptbl_cache_header *)(ptr))
 
@@ -73,6 +73,8 @@ static inline __u32 ssdfs_mask_flags(umode_t mode, __u32 flags)
  * @birthtime: creation time
  * @raw_inode_size: raw inode size in bytes
  * @private_flags: inode's private flags
+ * @updates_count: number of data update requests (temperature estimation)
+ * @compr_backoff: number of requests to skip compression (incompressible data)
  * @lock: inode lock
  * @parent_ino: parent inode ID
  * @flags: inode flags
@@ -82,6 +84,8 @@ static inline __u32 ssdfs_mask_flags(umode_t mode, __u32 flags)
  * @dentries_tree: dentries btree
  * @xattrs_tree: extended attributes tree
  * @inline_file: inline file buffer
+ * @is_orphan: content of evicted inode is deleted in the background
+ * @orphan_list: node of the list of orphan inodes
  * @raw_inode: raw inode
  */
 struct ssdfs_inode_info {
@@ -90,6 +94,8 @@ struct ssdfs_inode_info {
 	u16 raw_inode_size;
 
 	atomic_t private_flags;
+	atomic_t updates_count;
+	atomic_t compr_backoff;
 
 	struct rw_semaphore lock;
 	u64 parent_ino;
@@ -100,6 +106,8 @@ struct ssdfs_inode_info {
 	struct ssdfs_dentries_btree_info *dentries_tree;
 	struct ssdfs_xattrs_btree_info *xattrs_tree;
 	void *inline_file;
+	bool is_orphan;
+	struct list_head orphan_list;
 	struct ssdfs_inode raw_inode;
 };
 
@@ -132,6 +140,36 @@ struct ssdfs_xattrs_btree_info *SSDFS_XATTREE(struct ssdfs_inode_info *ii)
 	return ii->xattrs_tree;
 }
 
+/*
+ * ssdfs_inode_compr_policy() - get compression policy of inode
+ * @ii: pointer on in-core inode
+ */
+static inline
+int ssdfs_inode_compr_policy(struct ssdfs_inode_info *ii)
+{
+	int flags = atomic_read(&ii->private_flags);
+
+	if (ii->flags & SSDFS_NOCOMP_FL)
+		return SSDFS_COMPR_POLICY_NONE;
+
+	flags &= SSDFS_INODE_COMPR_POLICY_MASK;
+	return flags >> SSDFS_INODE_COMPR_POLICY_SHIFT;
+}
+
+/*
+ * ssdfs_inode_set_compr_policy() - set compression policy of inode
+ * @ii: pointer on in-core inode
+ * @policy: compression policy
+ */
+static inline
+void ssdfs_inode_set_compr_policy(struct ssdfs_inode_info *ii, int policy)
+{
+	atomic_andnot(SSDFS_INODE_COMPR_POLICY_MASK, &ii->private_flags);
+	atomic_or((policy << SSDFS_INODE_COMPR_POLICY_SHIFT) &
+					SSDFS_INODE_COMPR_POLICY_MASK,
+		  &ii->private_flags);
+}
+
 extern const struct file_operations ssdfs_dir_operations;
 extern const struct inode_operations ssdfs_dir_inode_operations;
 extern const struct file_operations ssdfs_file_operations;
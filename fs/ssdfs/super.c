@@ -58,6 +58,7 @@
 #include "acl.h"
 #include "snapshots_tree.h"
 #include "invalidated_extents_tree.h"
+#include "log_header_cache.h"
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/ssdfs.h>
@@ -167,6 +168,8 @@ struct inode *ssdfs_alloc_inode(struct super_block *sb)
 	init_once((void *)ii);
 
 	atomic_set(&ii->private_flags, 0);
+	atomic_set(&ii->updates_count, 0);
+	atomic_set(&ii->compr_backoff, 0);
 	init_rwsem(&ii->lock);
 	ii->parent_ino = U64_MAX;
 	ii->flags = 0;
@@ -176,6 +179,8 @@ struct inode *ssdfs_alloc_inode(struct super_block *sb)
 	ii->dentries_tree = NULL;
 	ii->xattrs_tree = NULL;
 	ii->inline_file = NULL;
+	ii->is_orphan = false;
+	INIT_LIST_HEAD(&ii->orphan_list);
 	memset(&ii->raw_inode, 0, sizeof(struct ssdfs_inode));
 
 	return &ii->vfs_inode;
@@ -212,15 +217,110 @@ static void ssdfs_i_callback(struct rcu_head *head)
  */
 static void ssdfs_destroy_inode(struct inode *inode)
 {
+	struct ssdfs_fs_info *fsi = SSDFS_FS_I(inode->i_sb);
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+
+	if (ii->is_orphan) {
+		/* the orphans' worker frees the inode */
+		spin_lock(&fsi->orphans_lock);
+		list_add_tail(&ii->orphan_list, &fsi->orphans);
+		spin_unlock(&fsi->orphans_lock);
+
+		queue_work(system_unbound_wq, &fsi->orphans_work);
+		return;
+	}
+
 	call_rcu(&inode->i_rcu, ssdfs_i_callback);
 }
 
+/*
+ * ssdfs_orphans_work_func() - delete content of orphan inodes
+ * @work: work item
+ *
+ * The unlink of a big file doesn't wait the truncation of
+ * the file's extents tree. The evicted inode is added into
+ * the list of orphans and the worker deletes the content
+ * of the file in the background. The invalidated extents are
+ * released by the threads of the shared extents tree.
+ */
+static void ssdfs_orphans_work_func(struct work_struct *work)
+{
+	struct ssdfs_fs_info *fsi;
+	struct ssdfs_inode_info *ii;
+	LIST_HEAD(orphans);
+
+	fsi = container_of(work, struct ssdfs_fs_info, orphans_work);
+
+	spin_lock(&fsi->orphans_lock);
+	list_splice_init(&fsi->orphans, &orphans);
+	spin_unlock(&fsi->orphans_lock);
+
+	while (!list_empty(&orphans)) {
+		ii = list_first_entry(&orphans, struct ssdfs_inode_info,
+				      orphan_list);
+		list_del_init(&ii->orphan_list);
+
+		ssdfs_delete_orphan_inode(&ii->vfs_inode);
+		call_rcu(&ii->vfs_inode.i_rcu, ssdfs_i_callback);
+	}
+}
+
 static void ssdfs_init_inode_once(void *obj)
 {
 	struct ssdfs_inode_info *ii = obj;
 	inode_init_once(&ii->vfs_inode);
 }
 
+/*
+ * ssdfs_start_gc_threads() - start GC threads
+ * @fsi: pointer on shared file system object
+ *
+ * The GC threads are not started for read-only mount because
+ * the migration of valid blocks is the write activity. The threads
+ * are started by the first remount in RW mode. The already
+ * started threads are kept untouched.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+static int ssdfs_start_gc_threads(struct ssdfs_fs_info *fsi)
+{
+	u32 started = 0;
+	int i;
+	int err;
+
+	for (i = 0; i < SSDFS_GC_THREAD_TYPE_MAX; i++) {
+		if (fsi->gc_thread[i].task)
+			continue;
+
+		err = ssdfs_start_gc_thread(fsi, i);
+		if (unlikely(err)) {
+			fsi->gc_thread[i].task = NULL;
+
+			if (err != -EINTR) {
+				SSDFS_ERR("fail to start GC thread: "
+					  "thread_type %d, err %d\n",
+					  i, err);
+			}
+
+			goto stop_gc_threads;
+		}
+
+		started |= 1 << i;
+	}
+
+	return 0;
+
+stop_gc_threads:
+	for (i--; i >= 0; i--) {
+		if (started & (1 << i))
+			ssdfs_stop_gc_thread(fsi, i);
+	}
+
+	return err;
+}
+
 static int ssdfs_remount_fs(struct super_block *sb, int *flags, char *data)
 {
 	struct ssdfs_fs_info *fsi = SSDFS_FS_I(sb);
@@ -228,6 +328,8 @@ static int ssdfs_remount_fs(struct super_block *sb, int *flags, char *data)
 	struct ssdfs_sb_log_payload payload;
 	unsigned long old_sb_flags;
 	unsigned long old_mount_opts;
+	u32 old_inline_file_max;
+	u32 old_invalidation_budget;
 	int err;
 
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
@@ -238,6 +340,8 @@ static int ssdfs_remount_fs(struct super_block *sb, int *flags, char *data)
 
 	old_sb_flags = sb->s_flags;
 	old_mount_opts = fsi->mount_opts;
+	old_inline_file_max = fsi->inline_file_max;
+	old_invalidation_budget = fsi->invalidation_budget;
 
 	pagevec_init(&payload.maptbl_cache.pvec);
 
@@ -245,6 +349,17 @@ static int ssdfs_remount_fs(struct super_block *sb, int *flags, char *data)
 	if (err)
 		goto restore_opts;
 
+	/* current segments array is created at mount time only */
+	if (ssdfs_test_opt(old_mount_opts, PERCPU_CUR_SEGS))
+		ssdfs_set_opt(fsi->mount_opts, PERCPU_CUR_SEGS);
+	else
+		ssdfs_clear_opt(fsi->mount_opts, PERCPU_CUR_SEGS);
+
+	if (ssdfs_test_opt(old_mount_opts, DATA_TEMP_STREAMS))
+		ssdfs_set_opt(fsi->mount_opts, DATA_TEMP_STREAMS);
+	else
+		ssdfs_clear_opt(fsi->mount_opts, DATA_TEMP_STREAMS);
+
 	set_posix_acl_flag(sb);
 
 	if ((*flags & SB_RDONLY) == (sb->s_flags & SB_RDONLY))
@@ -282,6 +397,13 @@ static int ssdfs_remount_fs(struct super_block *sb, int *flags, char *data)
 		sb->s_flags |= SB_RDONLY;
 		SSDFS_DBG("remount in RO mode\n");
 	} else {
+		err = ssdfs_start_gc_threads(fsi);
+		if (unlikely(err)) {
+			SSDFS_NOTICE("fail to start GC threads: err %d\n",
+				     err);
+			goto restore_opts;
+		}
+
 		down_write(&fsi->volume_sem);
 
 		err = ssdfs_prepare_sb_log(sb, &last_sb_log);
@@ -329,6 +451,8 @@ out:
 restore_opts:
 	sb->s_flags = old_sb_flags;
 	fsi->mount_opts = old_mount_opts;
+	fsi->inline_file_max = old_inline_file_max;
+	fsi->invalidation_budget = old_invalidation_budget;
 	ssdfs_super_pagevec_release(&payload.maptbl_cache.pvec);
 	return err;
 }
@@ -336,13 +460,7 @@ restore_opts:
 static inline
 bool unfinished_user_data_requests_exist(struct ssdfs_fs_info *fsi)
 {
-	u64 flush_requests = 0;
-
-	spin_lock(&fsi->volume_state_lock);
-	flush_requests = fsi->flushing_user_data_requests;
-	spin_unlock(&fsi->volume_state_lock);
-
-	return flush_requests > 0;
+	return ssdfs_fs_counter_positive(&fsi->flushing_user_data_requests);
 }
 
 static int ssdfs_sync_fs(struct super_block *sb, int wait)
@@ -369,7 +487,7 @@ static int ssdfs_sync_fs(struct super_block *sb, int wait)
 	SSDFS_DBG("SSDFS_METADATA_GOING_FLUSHING\n");
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	wake_up_all(&fsi->pending_wq);
+	ssdfs_segment_tree_wake_up_flush_waiters(fsi);
 
 	if (unfinished_user_data_requests_exist(fsi)) {
 		wait_queue_head_t *wq = &fsi->finish_user_data_flush_wq;
@@ -1877,11 +1995,13 @@ int ssdfs_prepare_sb_log(struct super_block *sb,
 }
 
 static void
-ssdfs_prepare_maptbl_cache_descriptor(struct ssdfs_metadata_descriptor *desc,
+ssdfs_prepare_maptbl_cache_descriptor(struct ssdfs_fs_info *fsi,
+				      struct ssdfs_metadata_descriptor *desc,
 				      u32 offset,
 				      struct ssdfs_payload_content *payload,
 				      u32 payload_size)
 {
+	u16 csum_type = ssdfs_csum_type(fsi);
 	unsigned i;
 	u32 csum = ~0;
 
@@ -1900,7 +2020,7 @@ ssdfs_prepare_maptbl_cache_descriptor(struct ssdfs_metadata_descriptor *desc,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	desc->check.bytes = cpu_to_le16((u16)payload_size);
-	desc->check.flags = cpu_to_le16(SSDFS_CRC32);
+	desc->check.flags = cpu_to_le16(csum_type);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	BUG_ON(pagevec_count(&payload->pvec) == 0);
@@ -1922,7 +2042,7 @@ ssdfs_prepare_maptbl_cache_descriptor(struct ssdfs_metadata_descriptor *desc,
 		hdr = (struct ssdfs_maptbl_cache_header *)kaddr;
 		bytes_count = le16_to_cpu(hdr->bytes_count);
 
-		csum = crc32(csum, kaddr, bytes_count);
+		csum = ssdfs_csum_update(csum_type, csum, kaddr, bytes_count);
 
 		kunmap_local(kaddr);
 		ssdfs_unlock_page(page);
@@ -2017,9 +2137,9 @@ finish_copy_items:
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	desc->check.bytes = cpu_to_le16(area_size);
-	desc->check.flags = cpu_to_le16(SSDFS_CRC32);
+	desc->check.flags = cpu_to_le16(ssdfs_csum_type(fsi));
 
-	csum = crc32(csum, hdr, area_size);
+	csum = ssdfs_csum_update(ssdfs_csum_type(fsi), csum, hdr, area_size);
 	desc->check.csum = cpu_to_le32(csum);
 
 	return 0;
@@ -2079,8 +2199,9 @@ static int __ssdfs_commit_sb_log(struct super_block *sb,
 	offset += PAGE_SIZE;
 
 	cur_hdr_desc = &hdr_desc[SSDFS_MAPTBL_CACHE_INDEX];
-	ssdfs_prepare_maptbl_cache_descriptor(cur_hdr_desc, (u32)offset,
-					     &payload->maptbl_cache,
+	ssdfs_prepare_maptbl_cache_descriptor(fsi, cur_hdr_desc,
+					      (u32)offset,
+					      &payload->maptbl_cache,
 					     payload->maptbl_cache.bytes_count);
 
 	offset += payload->maptbl_cache.bytes_count;
@@ -2361,7 +2482,8 @@ __ssdfs_commit_sb_log_inline(struct super_block *sb,
 	offset += hdr_size;
 
 	cur_hdr_desc = &hdr_desc[SSDFS_MAPTBL_CACHE_INDEX];
-	ssdfs_prepare_maptbl_cache_descriptor(cur_hdr_desc, (u32)offset,
+	ssdfs_prepare_maptbl_cache_descriptor(fsi, cur_hdr_desc,
+					      (u32)offset,
 					      &payload->maptbl_cache,
 					      payload_size);
 
@@ -2637,6 +2759,83 @@ static int ssdfs_commit_sb_log(struct super_block *sb,
 	return err;
 }
 
+/*
+ * ssdfs_prepare_mount_checkpoint() - prepare checkpoint of clean umount
+ * @fsi: pointer on shared file system object
+ * @fs_state: file system state of superblock log
+ * @cno: checkpoint number of superblock log
+ *
+ * The checkpoint is stored in the payload of segment header
+ * of superblock log. Only the log of clean state keeps
+ * the checkpoint. Otherwise, the payload is cleared because
+ * the volume state can be changed after the commit.
+ */
+static
+void ssdfs_prepare_mount_checkpoint(struct ssdfs_fs_info *fsi,
+				    u16 fs_state, u64 cno)
+{
+	struct ssdfs_segment_header *hdr = SSDFS_SEG_HDR(fsi->sbi.vh_buf);
+	struct ssdfs_mount_checkpoint *ckpt;
+	size_t ckpt_size = sizeof(struct ssdfs_mount_checkpoint);
+	u16 flags = 0;
+	int err;
+
+	ckpt = (struct ssdfs_mount_checkpoint *)hdr->payload;
+	memset(ckpt, 0, ckpt_size);
+
+	if (fs_state != SSDFS_VALID_FS)
+		return;
+
+	if ((fsi->fs_feature_compat & SSDFS_HAS_SEGBMAP_COMPAT_FLAG) &&
+	    fsi->segbmap) {
+		err = ssdfs_segbmap_prepare_mount_checkpoint(fsi->segbmap,
+							     ckpt);
+		if (!err)
+			flags |= SSDFS_MOUNT_CHECKPOINT_HAS_SEGBMAP;
+
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("segbmap checkpoint: err %d\n", err);
+#endif /* CONFIG_SSDFS_DEBUG */
+	}
+
+	if (flags == 0) {
+		memset(ckpt, 0, ckpt_size);
+		return;
+	}
+
+	ckpt->magic = cpu_to_le16(SSDFS_MOUNT_CHECKPOINT_MAGIC);
+	ckpt->flags = cpu_to_le16(flags);
+	ckpt->cno = cpu_to_le64(cno);
+
+	ckpt->check.bytes = cpu_to_le16(ckpt_size);
+	ckpt->check.flags = cpu_to_le16(ssdfs_csum_type(fsi));
+
+	err = ssdfs_calculate_csum(&ckpt->check, ckpt, ckpt_size);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to calculate checksum: err %d\n", err);
+		memset(ckpt, 0, ckpt_size);
+	}
+}
+
+/*
+ * ssdfs_commit_super() - commit superblock log
+ * @sb: pointer on VFS superblock object
+ * @fs_state: file system state of superblock log
+ * @last_sb_log: superblock log's extent [out]
+ * @payload: superblock log's payload
+ *
+ * The superblock log is committed only for the file system
+ * state transitions: RW mount (SSDFS_MOUNTED_FS), remount and
+ * umount (SSDFS_VALID_FS or SSDFS_ERROR_FS). The sync_fs() and
+ * fsync() paths never call this method because the metadata
+ * structures are stored in the logs of regular segments.
+ * Every call has to be written immediately, otherwise the volume
+ * state on the media could not reflect the real state.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
 static
 int ssdfs_commit_super(struct super_block *sb, u16 fs_state,
 			struct ssdfs_peb_extent *last_sb_log,
@@ -2691,6 +2890,8 @@ int ssdfs_commit_super(struct super_block *sb, u16 fs_state,
 		goto finish_commit_super;
 	}
 
+	ssdfs_prepare_mount_checkpoint(fsi, fs_state, cno);
+
 	for (i = 0; i < SSDFS_SB_SEG_COPY_MAX; i++) {
 		last_sb_log->leb_id = fsi->sb_lebs[SSDFS_CUR_SB_SEG][i];
 		last_sb_log->peb_id = fsi->sb_pebs[SSDFS_CUR_SB_SEG][i];
@@ -2771,6 +2972,14 @@ static void ssdfs_memory_leaks_checker_init(void)
 	ssdfs_lzo_memory_leaks_init();
 #endif /* CONFIG_SSDFS_LZO */
 
+#ifdef CONFIG_SSDFS_ZSTD
+	ssdfs_zstd_memory_leaks_init();
+#endif /* CONFIG_SSDFS_ZSTD */
+
+#ifdef CONFIG_SSDFS_LZ4
+	ssdfs_lz4_memory_leaks_init();
+#endif /* CONFIG_SSDFS_LZ4 */
+
 	ssdfs_compr_memory_leaks_init();
 	ssdfs_cur_seg_memory_leaks_init();
 	ssdfs_dentries_memory_leaks_init();
@@ -2804,6 +3013,7 @@ static void ssdfs_memory_leaks_checker_init(void)
 	ssdfs_gc_memory_leaks_init();
 	ssdfs_map_queue_memory_leaks_init();
 	ssdfs_map_tbl_memory_leaks_init();
+	ssdfs_lhdr_cache_memory_leaks_init();
 	ssdfs_map_cache_memory_leaks_init();
 	ssdfs_map_thread_memory_leaks_init();
 	ssdfs_migration_memory_leaks_init();
@@ -2845,6 +3055,14 @@ static void ssdfs_check_memory_leaks(void)
 	ssdfs_lzo_check_memory_leaks();
 #endif /* CONFIG_SSDFS_LZO */
 
+#ifdef CONFIG_SSDFS_ZSTD
+	ssdfs_zstd_check_memory_leaks();
+#endif /* CONFIG_SSDFS_ZSTD */
+
+#ifdef CONFIG_SSDFS_LZ4
+	ssdfs_lz4_check_memory_leaks();
+#endif /* CONFIG_SSDFS_LZ4 */
+
 	ssdfs_compr_check_memory_leaks();
 	ssdfs_cur_seg_check_memory_leaks();
 	ssdfs_dentries_check_memory_leaks();
@@ -2878,6 +3096,7 @@ static void ssdfs_check_memory_leaks(void)
 	ssdfs_gc_check_memory_leaks();
 	ssdfs_map_queue_check_memory_leaks();
 	ssdfs_map_tbl_check_memory_leaks();
+	ssdfs_lhdr_cache_check_memory_leaks();
 	ssdfs_map_cache_check_memory_leaks();
 	ssdfs_map_thread_check_memory_leaks();
 	ssdfs_migration_check_memory_leaks();
@@ -2923,6 +3142,46 @@ static void ssdfs_check_memory_leaks(void)
 #endif /* CONFIG_SSDFS_MEMORY_LEAKS_ACCOUNTING */
 }
 
+/*
+ * ssdfs_show_mount_profile() - show one-line summary of mount timings
+ * @fsi: pointer on shared file system object
+ */
+static
+void ssdfs_show_mount_profile(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_mount_profile *profile = &fsi->mount_profile;
+	u64 ms[SSDFS_MOUNT_PHASE_MAX];
+	int i;
+
+	for (i = 0; i < SSDFS_MOUNT_PHASE_MAX; i++)
+		ms[i] = div_u64(profile->nsecs[i], NSEC_PER_MSEC);
+
+	SSDFS_INFO("mount time %llu ms (%s): vh %llu, fast %llu, "
+		   "slow %llu, fallback %llu, state %llu, snapshots %llu, "
+		   "segtree %llu, maptbl %llu, segbmap %llu, shextree %llu, "
+		   "invextree %llu, cur_segs %llu, shdict %llu, "
+		   "inodes %llu, root %llu, gc %llu, commit %llu\n",
+		   div_u64(profile->total_nsecs, NSEC_PER_MSEC),
+		   ssdfs_mount_phase_name(profile->sb_search),
+		   ms[SSDFS_MOUNT_VOLUME_HEADER],
+		   ms[SSDFS_MOUNT_SB_FAST_SEARCH],
+		   ms[SSDFS_MOUNT_SB_SLOW_SEARCH],
+		   ms[SSDFS_MOUNT_SB_FALLBACK_SEARCH],
+		   ms[SSDFS_MOUNT_VOLUME_STATE],
+		   ms[SSDFS_MOUNT_SNAPSHOTS_TREE],
+		   ms[SSDFS_MOUNT_SEGMENTS_TREE],
+		   ms[SSDFS_MOUNT_MAPTBL],
+		   ms[SSDFS_MOUNT_SEGBMAP],
+		   ms[SSDFS_MOUNT_SHEXTREE],
+		   ms[SSDFS_MOUNT_INVEXTREE],
+		   ms[SSDFS_MOUNT_CURRENT_SEGMENTS],
+		   ms[SSDFS_MOUNT_SHARED_DICT],
+		   ms[SSDFS_MOUNT_INODES_TREE],
+		   ms[SSDFS_MOUNT_ROOT_INODE],
+		   ms[SSDFS_MOUNT_GC_THREADS],
+		   ms[SSDFS_MOUNT_COMMIT_SB]);
+}
+
 static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 {
 	struct ssdfs_fs_info *fs_info;
@@ -2930,6 +3189,8 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 	struct ssdfs_sb_log_payload payload;
 	struct inode *root_i;
 	u64 fs_feature_compat;
+	ktime_t mount_start = ktime_get();
+	ktime_t start;
 	int i;
 	int err = 0;
 
@@ -2955,6 +3216,13 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 	if (!fs_info)
 		return -ENOMEM;
 
+	err = ssdfs_fs_counters_init(fs_info);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to initialize counters: err %d\n", err);
+		ssdfs_super_kfree(fs_info);
+		return err;
+	}
+
 #ifdef CONFIG_SSDFS_TESTING
 	fs_info->do_fork_invalidation = true;
 #endif /* CONFIG_SSDFS_TESTING */
@@ -2974,6 +3242,15 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 		fs_info->devops = &ssdfs_zns_devops;
 		fs_info->is_zns_device = true;
 		fs_info->max_open_zones = bdev_max_open_zones(sb->s_bdev);
+		ssdfs_zns_open_zones_init(fs_info);
+
+		/*
+		 * Open zones over the device's limit are closed in LRU
+		 * order. So, active zones limit restricts the budget.
+		 */
+		if (bdev_max_active_zones(sb->s_bdev) > fs_info->max_open_zones)
+			fs_info->max_open_zones =
+				bdev_max_active_zones(sb->s_bdev);
 
 		fs_info->zone_size = ssdfs_zns_zone_size(sb,
 						SSDFS_RESERVED_VBR_SIZE);
@@ -3014,8 +3291,45 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 	fs_info->sb = sb;
 	sb->s_fs_info = fs_info;
 	atomic64_set(&fs_info->flush_reqs, 0);
-	init_waitqueue_head(&fs_info->pending_wq);
+	atomic_set(&fs_info->req_latency_msecs[SSDFS_REQ_PRIO_SYNC],
+		   SSDFS_SYNC_REQ_LATENCY_MSECS_DEFAULT);
+	atomic_set(&fs_info->req_latency_msecs[SSDFS_REQ_PRIO_ASYNC],
+		   SSDFS_ASYNC_REQ_LATENCY_MSECS_DEFAULT);
+	atomic_set(&fs_info->req_latency_msecs[SSDFS_REQ_PRIO_BACKGROUND],
+		   SSDFS_BACKGROUND_REQ_LATENCY_MSECS_DEFAULT);
+	mutex_init(&fs_info->flush_group.lock);
+	atomic64_set(&fs_info->flush_group.started, 0);
+	atomic64_set(&fs_info->flush_group.finished, 0);
+	fs_info->flush_group.err = 0;
+	atomic_set(&fs_info->data_log_stream_score, 0);
+	atomic_set(&fs_info->dow_stats[SSDFS_DOW_METADATA].threshold,
+		   SSDFS_DOW_METADATA_THRESHOLD_DEFAULT);
+	atomic_set(&fs_info->dow_stats[SSDFS_DOW_USER_DATA].threshold,
+		   SSDFS_DOW_USER_DATA_THRESHOLD_DEFAULT);
+	atomic_set(&fs_info->dow_fold_chain, SSDFS_DOW_FOLD_CHAIN_DEFAULT);
+	atomic_set(&fs_info->gc_governor.idle_reqs,
+		   SSDFS_GC_IDLE_REQS_DEFAULT);
+	atomic_set(&fs_info->gc_governor.busy_reqs,
+		   SSDFS_GC_BUSY_REQS_DEFAULT);
+	atomic_set(&fs_info->gc_governor.urgent_free_pct,
+		   SSDFS_GC_URGENT_FREE_PCT_DEFAULT);
+	atomic_set(&fs_info->gc_governor.idle_delay_msecs,
+		   SSDFS_GC_IDLE_DELAY_MSECS_DEFAULT);
+	atomic_set(&fs_info->gc_governor.busy_delay_msecs,
+		   SSDFS_GC_BUSY_DELAY_MSECS_DEFAULT);
+	atomic_set(&fs_info->gc_governor.idle_scan_secs,
+		   SSDFS_GC_IDLE_SCAN_SECS_DEFAULT);
+	atomic_set(&fs_info->write_throttle.target_msecs,
+		   SSDFS_WRITE_THROTTLE_MSECS_DEFAULT);
+	atomic_set(&fs_info->write_throttle.min_reqs,
+		   SSDFS_WRITE_THROTTLE_MIN_REQS_DEFAULT);
+	atomic_long_set(&fs_info->write_throttle.stamp, jiffies);
+	atomic64_set(&fs_info->write_throttle.finished_reqs, 0);
+	atomic64_set(&fs_info->write_throttle.reqs_per_sec, 0);
 	init_waitqueue_head(&fs_info->finish_user_data_flush_wq);
+	spin_lock_init(&fs_info->orphans_lock);
+	INIT_LIST_HEAD(&fs_info->orphans);
+	INIT_WORK(&fs_info->orphans_work, ssdfs_orphans_work_func);
 	atomic_set(&fs_info->global_fs_state, SSDFS_UNKNOWN_GLOBAL_FS_STATE);
 
 	for (i = 0; i < SSDFS_GC_THREAD_TYPE_MAX; i++) {
@@ -3029,10 +3343,21 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 	SSDFS_DBG("parse options started...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	fs_info->inline_file_max = U32_MAX;
+	fs_info->invalidation_budget = 0;
+
 	err = ssdfs_parse_options(fs_info, data);
 	if (err)
 		goto free_erase_page;
 
+	err = ssdfs_log_hdr_cache_create(fs_info);
+	if (err)
+		goto free_erase_page;
+
+	err = ssdfs_btree_nodes_cache_create(fs_info);
+	if (err)
+		goto free_erase_page;
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("gather superblock info started...\n");
 #else
@@ -3043,7 +3368,7 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 	if (err)
 		goto free_erase_page;
 
-	spin_lock(&fs_info->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fs_info->volume_state_lock);
 	fs_feature_compat = fs_info->fs_feature_compat;
 	spin_unlock(&fs_info->volume_state_lock);
 
@@ -3071,6 +3396,7 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 	SSDFS_DBG("create snapshots subsystem started...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	start = ktime_get();
 	err = ssdfs_snapshot_subsystem_init(fs_info);
 	if (err == -EINTR) {
 		/*
@@ -3081,24 +3407,30 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 	} else if (err)
 		goto destroy_sysfs_device_group;
 
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_SNAPSHOTS_TREE, start);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("create segment tree started...\n");
 #else
 	SSDFS_DBG("create segment tree started...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	start = ktime_get();
 	down_write(&fs_info->volume_sem);
 	err = ssdfs_segment_tree_create(fs_info);
 	up_write(&fs_info->volume_sem);
 	if (err)
 		goto destroy_snapshot_subsystem;
 
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_SEGMENTS_TREE, start);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("create mapping table started...\n");
 #else
 	SSDFS_DBG("create mapping table started...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	start = ktime_get();
 	if (fs_feature_compat & SSDFS_HAS_MAPTBL_COMPAT_FLAG) {
 		down_write(&fs_info->volume_sem);
 		err = ssdfs_maptbl_create(fs_info);
@@ -3118,12 +3450,15 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 		goto destroy_segments_tree;
 	}
 
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_MAPTBL, start);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("create segment bitmap started...\n");
 #else
 	SSDFS_DBG("create segment bitmap started...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	start = ktime_get();
 	if (fs_feature_compat & SSDFS_HAS_SEGBMAP_COMPAT_FLAG) {
 		down_write(&fs_info->volume_sem);
 		err = ssdfs_segbmap_create(fs_info);
@@ -3143,12 +3478,15 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 		goto destroy_maptbl;
 	}
 
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_SEGBMAP, start);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("create shared extents tree started...\n");
 #else
 	SSDFS_DBG("create shared extents tree started...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	start = ktime_get();
 	if (fs_info->fs_feature_compat & SSDFS_HAS_SHARED_EXTENTS_COMPAT_FLAG) {
 		down_write(&fs_info->volume_sem);
 		err = ssdfs_shextree_create(fs_info);
@@ -3161,12 +3499,15 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 		goto destroy_segbmap;
 	}
 
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_SHEXTREE, start);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("create invalidated extents btree started...\n");
 #else
 	SSDFS_DBG("create invalidated extents btree started...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	start = ktime_get();
 	if (fs_feature_compat & SSDFS_HAS_INVALID_EXTENTS_TREE_COMPAT_FLAG) {
 		down_write(&fs_info->volume_sem);
 		err = ssdfs_invextree_create(fs_info);
@@ -3175,24 +3516,30 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 			goto destroy_shextree;
 	}
 
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_INVEXTREE, start);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("create current segment array started...\n");
 #else
 	SSDFS_DBG("create current segment array started...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	start = ktime_get();
 	down_write(&fs_info->volume_sem);
 	err = ssdfs_current_segment_array_create(fs_info);
 	up_write(&fs_info->volume_sem);
 	if (err)
 		goto destroy_invext_btree;
 
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_CURRENT_SEGMENTS, start);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("create shared dictionary started...\n");
 #else
 	SSDFS_DBG("create shared dictionary started...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	start = ktime_get();
 	if (fs_feature_compat & SSDFS_HAS_SHARED_DICT_COMPAT_FLAG) {
 		down_write(&fs_info->volume_sem);
 
@@ -3215,12 +3562,15 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 		goto destroy_current_segment_array;
 	}
 
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_SHARED_DICT, start);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("create inodes btree started...\n");
 #else
 	SSDFS_DBG("create inodes btree started...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	start = ktime_get();
 	if (fs_feature_compat & SSDFS_HAS_INODES_TREE_COMPAT_FLAG) {
 		down_write(&fs_info->volume_sem);
 		err = ssdfs_inodes_btree_create(fs_info);
@@ -3233,12 +3583,15 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 		goto destroy_shdictree;
 	}
 
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_INODES_TREE, start);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("getting root inode...\n");
 #else
 	SSDFS_DBG("getting root inode...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	start = ktime_get();
 	root_i = ssdfs_iget(sb, SSDFS_ROOT_INO);
 	if (IS_ERR(root_i)) {
 		SSDFS_DBG("getting root inode failed\n");
@@ -3265,64 +3618,33 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 		goto put_root_inode;
 	}
 
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_ROOT_INODE, start);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("starting GC threads...\n");
 #else
 	SSDFS_DBG("starting GC threads...\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
-	err = ssdfs_start_gc_thread(fs_info, SSDFS_SEG_USING_GC_THREAD);
-	if (err == -EINTR) {
-		/*
-		 * Ignore this error.
-		 */
-		err = 0;
-		goto put_root_inode;
-	} else if (unlikely(err)) {
-		SSDFS_ERR("fail to start GC-using-seg thread: "
-			  "err %d\n", err);
-		goto put_root_inode;
-	}
-
-	err = ssdfs_start_gc_thread(fs_info, SSDFS_SEG_USED_GC_THREAD);
-	if (err == -EINTR) {
-		/*
-		 * Ignore this error.
-		 */
-		err = 0;
-		goto stop_gc_using_seg_thread;
-	} else if (unlikely(err)) {
-		SSDFS_ERR("fail to start GC-used-seg thread: "
-			  "err %d\n", err);
-		goto stop_gc_using_seg_thread;
-	}
-
-	err = ssdfs_start_gc_thread(fs_info, SSDFS_SEG_PRE_DIRTY_GC_THREAD);
-	if (err == -EINTR) {
-		/*
-		 * Ignore this error.
-		 */
-		err = 0;
-		goto stop_gc_used_seg_thread;
-	} else if (unlikely(err)) {
-		SSDFS_ERR("fail to start GC-pre-dirty-seg thread: "
-			  "err %d\n", err);
-		goto stop_gc_used_seg_thread;
+	start = ktime_get();
+	if (!(sb->s_flags & SB_RDONLY)) {
+		err = ssdfs_start_gc_threads(fs_info);
+		if (err == -EINTR) {
+			/*
+			 * Ignore this error.
+			 */
+			err = 0;
+			goto put_root_inode;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to start GC threads: "
+				  "err %d\n", err);
+			goto put_root_inode;
+		}
 	}
 
-	err = ssdfs_start_gc_thread(fs_info, SSDFS_SEG_DIRTY_GC_THREAD);
-	if (err == -EINTR) {
-		/*
-		 * Ignore this error.
-		 */
-		err = 0;
-		goto stop_gc_pre_dirty_seg_thread;
-	} else if (unlikely(err)) {
-		SSDFS_ERR("fail to start GC-dirty-seg thread: "
-			  "err %d\n", err);
-		goto stop_gc_pre_dirty_seg_thread;
-	}
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_GC_THREADS, start);
 
+	start = ktime_get();
 	if (!(sb->s_flags & SB_RDONLY)) {
 		pagevec_init(&payload.maptbl_cache.pvec);
 
@@ -3362,22 +3684,20 @@ static int ssdfs_fill_super(struct super_block *sb, void *data, int silent)
 
 	atomic_set(&fs_info->global_fs_state, SSDFS_REGULAR_FS_OPERATIONS);
 
+	ssdfs_account_mount_phase(fs_info, SSDFS_MOUNT_COMMIT_SB, start);
+
 	SSDFS_INFO("%s has been mounted on device %s\n",
 		   SSDFS_VERSION, fs_info->devops->device_name(sb));
 
-	return 0;
-
-stop_gc_pre_dirty_seg_thread:
-	ssdfs_stop_gc_thread(fs_info, SSDFS_SEG_PRE_DIRTY_GC_THREAD);
-
-stop_gc_used_seg_thread:
-	ssdfs_stop_gc_thread(fs_info, SSDFS_SEG_USED_GC_THREAD);
+	fs_info->mount_profile.total_nsecs =
+			ktime_to_ns(ktime_sub(ktime_get(), mount_start));
+	ssdfs_show_mount_profile(fs_info);
 
-stop_gc_using_seg_thread:
-	ssdfs_stop_gc_thread(fs_info, SSDFS_SEG_USING_GC_THREAD);
+	return 0;
 
 put_root_inode:
 	iput(root_i);
+	flush_work(&fs_info->orphans_work);
 
 destroy_inodes_btree:
 	ssdfs_inodes_btree_destroy(fs_info);
@@ -3415,14 +3735,21 @@ release_maptbl_cache:
 	ssdfs_maptbl_cache_destroy(&fs_info->maptbl_cache);
 
 free_erase_page:
+	ssdfs_btree_nodes_cache_destroy(fs_info);
+	ssdfs_log_hdr_cache_destroy(fs_info);
+
 	if (fs_info->erase_page)
 		ssdfs_super_free_page(fs_info->erase_page);
 
+	if (fs_info->is_zns_device)
+		ssdfs_zns_open_zones_destroy(fs_info);
+
 	ssdfs_destruct_sb_info(&fs_info->sbi);
 	ssdfs_destruct_sb_info(&fs_info->sbi_backup);
 
 	ssdfs_free_workspaces();
 
+	ssdfs_fs_counters_destroy(fs_info);
 	ssdfs_super_kfree(fs_info);
 
 	rcu_barrier();
@@ -3449,13 +3776,16 @@ static void ssdfs_put_super(struct super_block *sb)
 	SSDFS_DBG("sb %p\n", sb);
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
 
+	/* finish the deletion of orphans before the metadata flush */
+	flush_work(&fsi->orphans_work);
+
 	atomic_set(&fsi->global_fs_state, SSDFS_METADATA_GOING_FLUSHING);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("SSDFS_METADATA_GOING_FLUSHING\n");
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	wake_up_all(&fsi->pending_wq);
+	ssdfs_segment_tree_wake_up_flush_waiters(fsi);
 
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("STOP THREADS...\n");
@@ -3545,7 +3875,7 @@ static void ssdfs_put_super(struct super_block *sb)
 	SSDFS_DBG("mapping table thread has been stoped\n");
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	fs_feature_compat = fsi->fs_feature_compat;
 	fs_state = fsi->fs_state;
 	spin_unlock(&fsi->volume_state_lock);
@@ -3797,12 +4127,18 @@ static void ssdfs_put_super(struct super_block *sb)
 	if (fsi->erase_page)
 		ssdfs_super_free_page(fsi->erase_page);
 
+	if (fsi->is_zns_device)
+		ssdfs_zns_open_zones_destroy(fsi);
+
 	ssdfs_maptbl_cache_destroy(&fsi->maptbl_cache);
+	ssdfs_btree_nodes_cache_destroy(fsi);
+	ssdfs_log_hdr_cache_destroy(fsi);
 	ssdfs_destruct_sb_info(&fsi->sbi);
 	ssdfs_destruct_sb_info(&fsi->sbi_backup);
 
 	ssdfs_free_workspaces();
 
+	ssdfs_fs_counters_destroy(fsi);
 	ssdfs_super_kfree(fsi);
 	sb->s_fs_info = NULL;
 
@@ -3987,10 +4323,16 @@ static int __init ssdfs_init(void)
 {
 	int err;
 
+	err = ssdfs_page_pool_init();
+	if (err) {
+		SSDFS_ERR("failed to initialize page pool\n");
+		goto failed_init;
+	}
+
 	err = ssdfs_init_caches();
 	if (err) {
 		SSDFS_ERR("failed to initialize caches\n");
-		goto failed_init;
+		goto page_pool_exit;
 	}
 
 	err = ssdfs_compressors_init();
@@ -4005,16 +4347,25 @@ static int __init ssdfs_init(void)
 		goto stop_compressors;
 	}
 
+	err = ssdfs_peb_read_workqueue_init();
+	if (err) {
+		SSDFS_ERR("failed to initialize read workqueue\n");
+		goto sysfs_exit;
+	}
+
 	err = register_filesystem(&ssdfs_fs_type);
 	if (err) {
 		SSDFS_ERR("failed to register filesystem\n");
-		goto sysfs_exit;
+		goto read_workqueue_exit;
 	}
 
 	ssdfs_print_info();
 
 	return 0;
 
+read_workqueue_exit:
+	ssdfs_peb_read_workqueue_exit();
+
 sysfs_exit:
 	ssdfs_sysfs_exit();
 
@@ -4024,6 +4375,9 @@ stop_compressors:
 free_caches:
 	ssdfs_destroy_caches();
 
+page_pool_exit:
+	ssdfs_page_pool_exit();
+
 failed_init:
 	return err;
 }
@@ -4032,8 +4386,10 @@ static void __exit ssdfs_exit(void)
 {
 	ssdfs_destroy_caches();
 	unregister_filesystem(&ssdfs_fs_type);
+	ssdfs_peb_read_workqueue_exit();
 	ssdfs_sysfs_exit();
 	ssdfs_compressors_exit();
+	ssdfs_page_pool_exit();
 }
 
 module_init(ssdfs_init);
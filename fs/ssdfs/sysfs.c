@@ -192,6 +192,108 @@ static ssize_t ssdfs_peb_threads_info_show(struct ssdfs_peb_attr *attr,
 	return count;
 }
 
+/*
+ * ssdfs_sysfs_show_latency() - show latency histogram
+ * @name: histogram name
+ * @histogram: values of log2 buckets
+ * @buf: output buffer
+ * @count: current size of output
+ */
+static
+int ssdfs_sysfs_show_latency(const char *name, u64 *histogram,
+			     char *buf, int count)
+{
+	int i;
+
+	count += snprintf(buf + count, PAGE_SIZE - count,
+			  "%s_latency_us (log2 buckets):", name);
+
+	for (i = 0; i < SSDFS_PEB_LATENCY_BUCKETS; i++) {
+		count += snprintf(buf + count, PAGE_SIZE - count,
+				  " %llu", histogram[i]);
+	}
+
+	count += snprintf(buf + count, PAGE_SIZE - count, "\n");
+
+	return count;
+}
+
+/*
+ * ssdfs_peb_io_stats_read() - add PEB's I/O statistics into totals
+ * @pebc: pointer on PEB container
+ * @read_latency: read requests' histogram [in|out]
+ * @flush_latency: flush requests' histogram [in|out]
+ * @log_commits: number of committed logs [in|out]
+ * @written_bytes: number of written bytes [in|out]
+ */
+static
+void ssdfs_peb_io_stats_read(struct ssdfs_peb_container *pebc,
+			     u64 *read_latency, u64 *flush_latency,
+			     u64 *log_commits, u64 *written_bytes)
+{
+	struct ssdfs_peb_io_stats *stats = &pebc->io_stats;
+	int i;
+
+	for (i = 0; i < SSDFS_PEB_LATENCY_BUCKETS; i++) {
+		read_latency[i] += atomic64_read(&stats->read_latency[i]);
+		flush_latency[i] += atomic64_read(&stats->flush_latency[i]);
+	}
+
+	*log_commits += atomic64_read(&stats->log_commits);
+	*written_bytes += atomic64_read(&stats->written_bytes);
+}
+
+static ssize_t ssdfs_peb_io_stats_show(struct ssdfs_peb_attr *attr,
+				       struct ssdfs_peb_container *pebc,
+				       char *buf)
+{
+	u64 read_latency[SSDFS_PEB_LATENCY_BUCKETS] = {0};
+	u64 flush_latency[SSDFS_PEB_LATENCY_BUCKETS] = {0};
+	u64 log_commits = 0;
+	u64 written_bytes = 0;
+	u32 create_rq_depth = 0;
+	struct task_struct *task;
+	int count = 0;
+	int i;
+
+	spin_lock(&pebc->crq_ptr_lock);
+	if (pebc->create_rq)
+		create_rq_depth = ssdfs_requests_queue_count(pebc->create_rq);
+	spin_unlock(&pebc->crq_ptr_lock);
+
+	ssdfs_peb_io_stats_read(pebc, read_latency, flush_latency,
+				&log_commits, &written_bytes);
+
+	count += snprintf(buf + count, PAGE_SIZE - count,
+			  "read_rq_depth: %u\n"
+			  "update_rq_depth: %u\n"
+			  "create_rq_depth: %u\n"
+			  "log_commits: %llu\n"
+			  "written_bytes: %llu\n",
+			  ssdfs_requests_queue_count(&pebc->read_rq),
+			  ssdfs_requests_queue_count(&pebc->update_rq),
+			  create_rq_depth,
+			  log_commits, written_bytes);
+
+	count = ssdfs_sysfs_show_latency("read", read_latency,
+					 buf, count);
+	count = ssdfs_sysfs_show_latency("flush", flush_latency,
+					 buf, count);
+
+	for (i = 0; i < SSDFS_PEB_THREAD_TYPE_MAX; i++) {
+		task = pebc->thread[i].task;
+		if (!task)
+			continue;
+
+		count += snprintf(buf + count, PAGE_SIZE - count,
+				  "%s: cputime_ns %llu\n",
+				  thread_type_array[i],
+				  READ_ONCE(task->se.sum_exec_runtime));
+	}
+
+	return count;
+}
+
 SSDFS_PEB_RO_ATTR(id);
 SSDFS_PEB_RO_ATTR(peb_index);
 SSDFS_PEB_RO_ATTR(log_pages);
@@ -199,6 +301,7 @@ SSDFS_PEB_RO_ATTR(valid_pages);
 SSDFS_PEB_RO_ATTR(invalid_pages);
 SSDFS_PEB_RO_ATTR(free_pages);
 SSDFS_PEB_RO_ATTR(threads_info);
+SSDFS_PEB_RO_ATTR(io_stats);
 
 static struct attribute *ssdfs_peb_attrs[] = {
 	SSDFS_PEB_ATTR_LIST(id),
@@ -208,6 +311,7 @@ static struct attribute *ssdfs_peb_attrs[] = {
 	SSDFS_PEB_ATTR_LIST(invalid_pages),
 	SSDFS_PEB_ATTR_LIST(free_pages),
 	SSDFS_PEB_ATTR_LIST(threads_info),
+	SSDFS_PEB_ATTR_LIST(io_stats),
 	NULL,
 };
 ATTRIBUTE_GROUPS(ssdfs_peb);
@@ -517,6 +621,47 @@ static ssize_t ssdfs_seg_seg_state_show(struct ssdfs_seg_attr *attr,
 	return -EINVAL;
 }
 
+static ssize_t ssdfs_seg_io_stats_show(struct ssdfs_seg_attr *attr,
+				       struct ssdfs_segment_info *si,
+				       char *buf)
+{
+	u64 read_latency[SSDFS_PEB_LATENCY_BUCKETS] = {0};
+	u64 flush_latency[SSDFS_PEB_LATENCY_BUCKETS] = {0};
+	u64 log_commits = 0;
+	u64 written_bytes = 0;
+	u32 read_rq_depth = 0;
+	u32 update_rq_depth = 0;
+	int count = 0;
+	int i;
+
+	for (i = 0; i < si->pebs_count; i++) {
+		struct ssdfs_peb_container *pebc = &si->peb_array[i];
+
+		read_rq_depth += ssdfs_requests_queue_count(&pebc->read_rq);
+		update_rq_depth += ssdfs_requests_queue_count(&pebc->update_rq);
+
+		ssdfs_peb_io_stats_read(pebc, read_latency, flush_latency,
+					&log_commits, &written_bytes);
+	}
+
+	count += snprintf(buf + count, PAGE_SIZE - count,
+			  "read_rq_depth: %u\n"
+			  "update_rq_depth: %u\n"
+			  "create_rq_depth: %u\n"
+			  "log_commits: %llu\n"
+			  "written_bytes: %llu\n",
+			  read_rq_depth, update_rq_depth,
+			  ssdfs_requests_queue_count(&si->create_rq),
+			  log_commits, written_bytes);
+
+	count = ssdfs_sysfs_show_latency("read", read_latency,
+					 buf, count);
+	count = ssdfs_sysfs_show_latency("flush", flush_latency,
+					 buf, count);
+
+	return count;
+}
+
 SSDFS_SEG_RO_ATTR(id);
 SSDFS_SEG_RO_ATTR(log_pages);
 SSDFS_SEG_RO_ATTR(create_threads);
@@ -527,6 +672,7 @@ SSDFS_SEG_RO_ATTR(valid_pages);
 SSDFS_SEG_RO_ATTR(invalid_pages);
 SSDFS_SEG_RO_ATTR(free_pages);
 SSDFS_SEG_RO_ATTR(seg_state);
+SSDFS_SEG_RO_ATTR(io_stats);
 
 static struct attribute *ssdfs_seg_attrs[] = {
 	SSDFS_SEG_ATTR_LIST(id),
@@ -539,6 +685,7 @@ static struct attribute *ssdfs_seg_attrs[] = {
 	SSDFS_SEG_ATTR_LIST(invalid_pages),
 	SSDFS_SEG_ATTR_LIST(free_pages),
 	SSDFS_SEG_ATTR_LIST(seg_state),
+	SSDFS_SEG_ATTR_LIST(io_stats),
 	NULL,
 };
 ATTRIBUTE_GROUPS(ssdfs_seg);
@@ -766,11 +913,638 @@ ssize_t ssdfs_segments_current_segments_show(struct ssdfs_segments_attr *attr,
 	return count;
 }
 
+static inline
+ssize_t ssdfs_segments_req_latency_show(struct ssdfs_fs_info *fsi,
+					int prio, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+			atomic_read(&fsi->req_latency_msecs[prio]));
+}
+
+static inline
+ssize_t ssdfs_segments_req_latency_store(struct ssdfs_fs_info *fsi,
+					 int prio, const char *buf,
+					 size_t count)
+{
+	unsigned int val;
+	int err;
+
+	err = kstrtouint(skip_spaces(buf), 0, &val);
+	if (err) {
+		SSDFS_ERR("unable to convert string: err %d\n", err);
+		return err;
+	}
+
+	if (val > SSDFS_REQ_LATENCY_MSECS_MAX) {
+		SSDFS_ERR("invalid latency target: "
+			  "val %u, max %u\n",
+			  val, SSDFS_REQ_LATENCY_MSECS_MAX);
+		return -ERANGE;
+	}
+
+	atomic_set(&fsi->req_latency_msecs[prio], val);
+
+	return count;
+}
+
+static
+ssize_t ssdfs_segments_sync_req_latency_ms_show(struct ssdfs_segments_attr *attr,
+						struct ssdfs_fs_info *fsi,
+						char *buf)
+{
+	return ssdfs_segments_req_latency_show(fsi, SSDFS_REQ_PRIO_SYNC, buf);
+}
+
+static
+ssize_t ssdfs_segments_sync_req_latency_ms_store(struct ssdfs_segments_attr *attr,
+						 struct ssdfs_fs_info *fsi,
+						 const char *buf, size_t count)
+{
+	return ssdfs_segments_req_latency_store(fsi, SSDFS_REQ_PRIO_SYNC,
+						buf, count);
+}
+
+static
+ssize_t ssdfs_segments_async_req_latency_ms_show(struct ssdfs_segments_attr *attr,
+						 struct ssdfs_fs_info *fsi,
+						 char *buf)
+{
+	return ssdfs_segments_req_latency_show(fsi, SSDFS_REQ_PRIO_ASYNC, buf);
+}
+
+static
+ssize_t ssdfs_segments_async_req_latency_ms_store(struct ssdfs_segments_attr *attr,
+						  struct ssdfs_fs_info *fsi,
+						  const char *buf, size_t count)
+{
+	return ssdfs_segments_req_latency_store(fsi, SSDFS_REQ_PRIO_ASYNC,
+						buf, count);
+}
+
+static
+ssize_t ssdfs_segments_gc_req_latency_ms_show(struct ssdfs_segments_attr *attr,
+					      struct ssdfs_fs_info *fsi,
+					      char *buf)
+{
+	return ssdfs_segments_req_latency_show(fsi, SSDFS_REQ_PRIO_BACKGROUND,
+						buf);
+}
+
+static
+ssize_t ssdfs_segments_gc_req_latency_ms_store(struct ssdfs_segments_attr *attr,
+					       struct ssdfs_fs_info *fsi,
+					       const char *buf, size_t count)
+{
+	return ssdfs_segments_req_latency_store(fsi, SSDFS_REQ_PRIO_BACKGROUND,
+						buf, count);
+}
+
+static inline
+ssize_t ssdfs_segments_dow_threshold_show(struct ssdfs_fs_info *fsi,
+					  int type, char *buf)
+{
+	struct ssdfs_dow_stats *stats = &fsi->dow_stats[type];
+	int override = atomic_read(&stats->override);
+
+	if (override != SSDFS_DOW_THRESHOLD_ADAPTIVE)
+		return snprintf(buf, PAGE_SIZE, "%d\n", override);
+
+	return snprintf(buf, PAGE_SIZE, "auto (%d)\n",
+			atomic_read(&stats->threshold));
+}
+
+static inline
+ssize_t ssdfs_segments_dow_threshold_store(struct ssdfs_fs_info *fsi,
+					   int type, const char *buf,
+					   size_t count)
+{
+	unsigned int val;
+	int err;
+
+	if (sysfs_streq(buf, "auto")) {
+		atomic_set(&fsi->dow_stats[type].override,
+			   SSDFS_DOW_THRESHOLD_ADAPTIVE);
+		return count;
+	}
+
+	err = kstrtouint(skip_spaces(buf), 0, &val);
+	if (err) {
+		SSDFS_ERR("unable to convert string: err %d\n", err);
+		return err;
+	}
+
+	if (val > SSDFS_DOW_THRESHOLD_MAX) {
+		SSDFS_ERR("invalid Diff-On-Write threshold: "
+			  "val %u, max %u\n",
+			  val, SSDFS_DOW_THRESHOLD_MAX);
+		return -ERANGE;
+	}
+
+	atomic_set(&fsi->dow_stats[type].override, val);
+
+	return count;
+}
+
+static
+ssize_t ssdfs_segments_dow_metadata_pct_show(struct ssdfs_segments_attr *attr,
+					     struct ssdfs_fs_info *fsi,
+					     char *buf)
+{
+	return ssdfs_segments_dow_threshold_show(fsi, SSDFS_DOW_METADATA, buf);
+}
+
+static
+ssize_t ssdfs_segments_dow_metadata_pct_store(struct ssdfs_segments_attr *attr,
+					      struct ssdfs_fs_info *fsi,
+					      const char *buf,
+					      size_t count)
+{
+	return ssdfs_segments_dow_threshold_store(fsi, SSDFS_DOW_METADATA,
+						  buf, count);
+}
+
+static
+ssize_t ssdfs_segments_dow_user_data_pct_show(struct ssdfs_segments_attr *attr,
+					      struct ssdfs_fs_info *fsi,
+					      char *buf)
+{
+	return ssdfs_segments_dow_threshold_show(fsi, SSDFS_DOW_USER_DATA,
+						 buf);
+}
+
+static
+ssize_t ssdfs_segments_dow_user_data_pct_store(struct ssdfs_segments_attr *attr,
+					       struct ssdfs_fs_info *fsi,
+					       const char *buf,
+					       size_t count)
+{
+	return ssdfs_segments_dow_threshold_store(fsi, SSDFS_DOW_USER_DATA,
+						  buf, count);
+}
+
+static
+ssize_t ssdfs_segments_dow_stats_show(struct ssdfs_segments_attr *attr,
+				      struct ssdfs_fs_info *fsi,
+				      char *buf)
+{
+	static const char * const names[SSDFS_DOW_TYPE_MAX] = {
+		"metadata",
+		"user_data",
+	};
+	int count = 0;
+	int i;
+
+	for (i = 0; i < SSDFS_DOW_TYPE_MAX; i++) {
+		struct ssdfs_dow_stats *stats = &fsi->dow_stats[i];
+
+		count += snprintf(buf + count, PAGE_SIZE - count,
+				  "%s: threshold %d, override %d, "
+				  "prepared %lld, "
+				  "rejected %lld, diff_bytes %lld, "
+				  "block_bytes %lld, reads %lld, "
+				  "applied %lld, folded %lld\n",
+				  names[i],
+				  atomic_read(&stats->threshold),
+				  atomic_read(&stats->override),
+				  atomic64_read(&stats->prepared),
+				  atomic64_read(&stats->rejected),
+				  atomic64_read(&stats->diff_bytes),
+				  atomic64_read(&stats->block_bytes),
+				  atomic64_read(&stats->reads),
+				  atomic64_read(&stats->applied),
+				  atomic64_read(&stats->folded));
+	}
+
+	return count;
+}
+
+static
+ssize_t ssdfs_segments_dow_fold_chain_show(struct ssdfs_segments_attr *attr,
+					   struct ssdfs_fs_info *fsi,
+					   char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+			atomic_read(&fsi->dow_fold_chain));
+}
+
+static
+ssize_t ssdfs_segments_dow_fold_chain_store(struct ssdfs_segments_attr *attr,
+					    struct ssdfs_fs_info *fsi,
+					    const char *buf, size_t count)
+{
+	unsigned int val;
+	int err;
+
+	err = kstrtouint(skip_spaces(buf), 0, &val);
+	if (err) {
+		SSDFS_ERR("unable to convert string: err %d\n", err);
+		return err;
+	}
+
+	if (val == 0 || val >= SSDFS_BLK_STATE_OFF_MAX) {
+		SSDFS_ERR("invalid diff chain limit: "
+			  "val %u, max %u\n",
+			  val, SSDFS_BLK_STATE_OFF_MAX - 1);
+		return -ERANGE;
+	}
+
+	atomic_set(&fsi->dow_fold_chain, val);
+
+	return count;
+}
+
+static
+ssize_t ssdfs_segments_reclaim_stats_show(struct ssdfs_segments_attr *attr,
+					  struct ssdfs_fs_info *fsi,
+					  char *buf)
+{
+	static const char * const names[SSDFS_RECLAIM_TYPE_MAX] = {
+		"segment_objects",
+		"block_bitmaps",
+		"btree_nodes",
+	};
+	int count = 0;
+	int i;
+
+	for (i = 0; i < SSDFS_RECLAIM_TYPE_MAX; i++) {
+		struct ssdfs_reclaim_stats *stats = &fsi->reclaim_stats[i];
+
+		count += snprintf(buf + count, PAGE_SIZE - count,
+				  "%s: scans %lld, scanned %lld, "
+				  "reclaimed %lld, busy %lld\n",
+				  names[i],
+				  atomic64_read(&stats->scans),
+				  atomic64_read(&stats->scanned),
+				  atomic64_read(&stats->reclaimed),
+				  atomic64_read(&stats->busy));
+	}
+
+	return count;
+}
+
+static
+ssize_t ssdfs_segments_waf_stats_show(struct ssdfs_segments_attr *attr,
+				      struct ssdfs_fs_info *fsi,
+				      char *buf)
+{
+	static const char * const names[SSDFS_WA_TYPE_MAX] = {
+		"host_data",
+		"user_data",
+		"btree_nodes",
+		"mapping_table",
+		"segment_bitmap",
+		"other_payload",
+		"block_descriptors",
+		"blk2off_table",
+		"block_bitmap",
+		"diffs",
+		"gc_copies",
+		"device_writes",
+	};
+	struct ssdfs_wa_stats *stats = &fsi->wa_stats;
+	s64 host_bytes, device_bytes, payload_bytes = 0;
+	u64 waf = 0;
+	u32 fraction;
+	int count = 0;
+	int i;
+
+	for (i = 0; i < SSDFS_WA_TYPE_MAX; i++) {
+		s64 bytes = atomic64_read(&stats->bytes[i]);
+
+		count += snprintf(buf + count, PAGE_SIZE - count,
+				  "%s: %lld\n", names[i], bytes);
+
+		if (i >= SSDFS_WA_USER_DATA && i <= SSDFS_WA_DIFFS)
+			payload_bytes += bytes;
+	}
+
+	host_bytes = atomic64_read(&stats->bytes[SSDFS_WA_HOST_DATA]);
+	device_bytes = atomic64_read(&stats->bytes[SSDFS_WA_DEVICE_WRITES]);
+
+	count += snprintf(buf + count, PAGE_SIZE - count,
+			  "log_metadata: %lld\n",
+			  max_t(s64, device_bytes - payload_bytes, 0));
+
+	if (host_bytes > 0)
+		waf = div64_u64((u64)device_bytes * 1000, (u64)host_bytes);
+
+	waf = div_u64_rem(waf, 1000, &fraction);
+
+	count += snprintf(buf + count, PAGE_SIZE - count,
+			  "waf: %llu.%03u\n", waf, fraction);
+
+	return count;
+}
+
+static
+ssize_t ssdfs_segments_lookup_stats_show(struct ssdfs_segments_attr *attr,
+					 struct ssdfs_fs_info *fsi,
+					 char *buf)
+{
+	static const char * const names[SSDFS_LOOKUP_TYPE_MAX] = {
+		"maptbl_cache",
+		"maptbl_fragment",
+		"segbmap",
+		"blk2off_cache",
+		"blk2off_table",
+		"btree_unknown",
+		"btree_inodes",
+		"btree_dentries",
+		"btree_extents",
+		"btree_shared_extents",
+		"btree_xattrs",
+		"btree_shared_xattrs",
+		"btree_shared_dictionary",
+		"btree_snapshots",
+		"btree_invalidated_extents",
+	};
+	int count = 0;
+	int i, j;
+
+	for (i = 0; i < SSDFS_LOOKUP_TYPE_MAX; i++) {
+		struct ssdfs_lookup_stats *stats = &fsi->lookup_stats[i];
+
+		/* the output can be long, scnprintf() keeps it in the page */
+		count += scnprintf(buf + count, PAGE_SIZE - count,
+				   "%s: hits %lld, misses %lld, "
+				   "latency_ns (log2 buckets):",
+				   names[i],
+				   atomic64_read(&stats->hits),
+				   atomic64_read(&stats->misses));
+
+		for (j = 0; j < SSDFS_LOOKUP_LATENCY_BUCKETS; j++) {
+			count += scnprintf(buf + count, PAGE_SIZE - count,
+					   " %lld",
+					   atomic64_read(&stats->latency[j]));
+		}
+
+		count += scnprintf(buf + count, PAGE_SIZE - count, "\n");
+	}
+
+	return count;
+}
+
+/*
+ * Any write into lookup_stats resets the statistics.
+ */
+static
+ssize_t ssdfs_segments_lookup_stats_store(struct ssdfs_segments_attr *attr,
+					  struct ssdfs_fs_info *fsi,
+					  const char *buf, size_t count)
+{
+	int i, j;
+
+	for (i = 0; i < SSDFS_LOOKUP_TYPE_MAX; i++) {
+		struct ssdfs_lookup_stats *stats = &fsi->lookup_stats[i];
+
+		atomic64_set(&stats->hits, 0);
+		atomic64_set(&stats->misses, 0);
+
+		for (j = 0; j < SSDFS_LOOKUP_LATENCY_BUCKETS; j++)
+			atomic64_set(&stats->latency[j], 0);
+	}
+
+	return count;
+}
+
+static inline
+ssize_t ssdfs_segments_gc_tunable_show(atomic_t *tunable, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n", atomic_read(tunable));
+}
+
+static inline
+ssize_t ssdfs_segments_gc_tunable_store(atomic_t *tunable,
+					unsigned int min_val,
+					unsigned int max_val,
+					const char *buf, size_t count)
+{
+	unsigned int val;
+	int err;
+
+	err = kstrtouint(skip_spaces(buf), 0, &val);
+	if (err) {
+		SSDFS_ERR("unable to convert string: err %d\n", err);
+		return err;
+	}
+
+	if (val < min_val || val > max_val) {
+		SSDFS_ERR("invalid GC tunable: "
+			  "val %u, min %u, max %u\n",
+			  val, min_val, max_val);
+		return -ERANGE;
+	}
+
+	atomic_set(tunable, val);
+
+	return count;
+}
+
+static
+ssize_t ssdfs_segments_gc_idle_reqs_show(struct ssdfs_segments_attr *attr,
+					 struct ssdfs_fs_info *fsi,
+					 char *buf)
+{
+	return ssdfs_segments_gc_tunable_show(&fsi->gc_governor.idle_reqs,
+					      buf);
+}
+
+static
+ssize_t ssdfs_segments_gc_idle_reqs_store(struct ssdfs_segments_attr *attr,
+					  struct ssdfs_fs_info *fsi,
+					  const char *buf, size_t count)
+{
+	struct ssdfs_gc_governor *gov = &fsi->gc_governor;
+	int busy_reqs = atomic_read(&gov->busy_reqs);
+
+	return ssdfs_segments_gc_tunable_store(&gov->idle_reqs,
+					       0, busy_reqs - 1,
+					       buf, count);
+}
+
+static
+ssize_t ssdfs_segments_gc_busy_reqs_show(struct ssdfs_segments_attr *attr,
+					 struct ssdfs_fs_info *fsi,
+					 char *buf)
+{
+	return ssdfs_segments_gc_tunable_show(&fsi->gc_governor.busy_reqs,
+					      buf);
+}
+
+static
+ssize_t ssdfs_segments_gc_busy_reqs_store(struct ssdfs_segments_attr *attr,
+					  struct ssdfs_fs_info *fsi,
+					  const char *buf, size_t count)
+{
+	struct ssdfs_gc_governor *gov = &fsi->gc_governor;
+	int idle_reqs = atomic_read(&gov->idle_reqs);
+
+	return ssdfs_segments_gc_tunable_store(&gov->busy_reqs,
+					       idle_reqs + 1, INT_MAX,
+					       buf, count);
+}
+
+static
+ssize_t ssdfs_segments_gc_urgent_free_pct_show(struct ssdfs_segments_attr *attr,
+					       struct ssdfs_fs_info *fsi,
+					       char *buf)
+{
+	return ssdfs_segments_gc_tunable_show(&fsi->gc_governor.urgent_free_pct,
+					      buf);
+}
+
+static
+ssize_t ssdfs_segments_gc_urgent_free_pct_store(struct ssdfs_segments_attr *attr,
+						struct ssdfs_fs_info *fsi,
+						const char *buf, size_t count)
+{
+	return ssdfs_segments_gc_tunable_store(&fsi->gc_governor.urgent_free_pct,
+					       0, SSDFS_GC_URGENT_FREE_PCT_MAX,
+					       buf, count);
+}
+
+static
+ssize_t ssdfs_segments_gc_idle_delay_ms_show(struct ssdfs_segments_attr *attr,
+					     struct ssdfs_fs_info *fsi,
+					     char *buf)
+{
+	return ssdfs_segments_gc_tunable_show(&fsi->gc_governor.idle_delay_msecs,
+					      buf);
+}
+
+static
+ssize_t ssdfs_segments_gc_idle_delay_ms_store(struct ssdfs_segments_attr *attr,
+					      struct ssdfs_fs_info *fsi,
+					      const char *buf, size_t count)
+{
+	struct ssdfs_gc_governor *gov = &fsi->gc_governor;
+
+	return ssdfs_segments_gc_tunable_store(&gov->idle_delay_msecs,
+					       0, SSDFS_GC_DELAY_MSECS_MAX,
+					       buf, count);
+}
+
+static
+ssize_t ssdfs_segments_gc_busy_delay_ms_show(struct ssdfs_segments_attr *attr,
+					     struct ssdfs_fs_info *fsi,
+					     char *buf)
+{
+	return ssdfs_segments_gc_tunable_show(&fsi->gc_governor.busy_delay_msecs,
+					      buf);
+}
+
+static
+ssize_t ssdfs_segments_gc_busy_delay_ms_store(struct ssdfs_segments_attr *attr,
+					      struct ssdfs_fs_info *fsi,
+					      const char *buf, size_t count)
+{
+	struct ssdfs_gc_governor *gov = &fsi->gc_governor;
+
+	return ssdfs_segments_gc_tunable_store(&gov->busy_delay_msecs,
+					       0, SSDFS_GC_DELAY_MSECS_MAX,
+					       buf, count);
+}
+
+static
+ssize_t ssdfs_segments_gc_idle_scan_secs_show(struct ssdfs_segments_attr *attr,
+					      struct ssdfs_fs_info *fsi,
+					      char *buf)
+{
+	return ssdfs_segments_gc_tunable_show(&fsi->gc_governor.idle_scan_secs,
+					      buf);
+}
+
+static
+ssize_t ssdfs_segments_gc_idle_scan_secs_store(struct ssdfs_segments_attr *attr,
+					       struct ssdfs_fs_info *fsi,
+					       const char *buf, size_t count)
+{
+	return ssdfs_segments_gc_tunable_store(&fsi->gc_governor.idle_scan_secs,
+					       0, SSDFS_GC_IDLE_SCAN_SECS_MAX,
+					       buf, count);
+}
+
+static
+ssize_t ssdfs_segments_wr_throttle_ms_show(struct ssdfs_segments_attr *attr,
+					   struct ssdfs_fs_info *fsi,
+					   char *buf)
+{
+	return ssdfs_segments_gc_tunable_show(&fsi->write_throttle.target_msecs,
+					      buf);
+}
+
+static
+ssize_t ssdfs_segments_wr_throttle_ms_store(struct ssdfs_segments_attr *attr,
+					    struct ssdfs_fs_info *fsi,
+					    const char *buf, size_t count)
+{
+	struct ssdfs_write_throttle *throttle = &fsi->write_throttle;
+	unsigned int max_val = SSDFS_WRITE_THROTTLE_MSECS_MAX;
+
+	return ssdfs_segments_gc_tunable_store(&throttle->target_msecs,
+					       0, max_val,
+					       buf, count);
+}
+
+static
+ssize_t ssdfs_segments_wr_throttle_reqs_show(struct ssdfs_segments_attr *attr,
+					     struct ssdfs_fs_info *fsi,
+					     char *buf)
+{
+	return ssdfs_segments_gc_tunable_show(&fsi->write_throttle.min_reqs,
+					      buf);
+}
+
+static
+ssize_t ssdfs_segments_wr_throttle_reqs_store(struct ssdfs_segments_attr *attr,
+					      struct ssdfs_fs_info *fsi,
+					      const char *buf, size_t count)
+{
+	return ssdfs_segments_gc_tunable_store(&fsi->write_throttle.min_reqs,
+					       1, INT_MAX,
+					       buf, count);
+}
 
 SSDFS_SEGMENTS_RO_ATTR(current_segments);
+SSDFS_SEGMENTS_RW_ATTR(sync_req_latency_ms);
+SSDFS_SEGMENTS_RW_ATTR(async_req_latency_ms);
+SSDFS_SEGMENTS_RW_ATTR(gc_req_latency_ms);
+SSDFS_SEGMENTS_RW_ATTR(dow_metadata_pct);
+SSDFS_SEGMENTS_RW_ATTR(dow_user_data_pct);
+SSDFS_SEGMENTS_RO_ATTR(dow_stats);
+SSDFS_SEGMENTS_RO_ATTR(reclaim_stats);
+SSDFS_SEGMENTS_RO_ATTR(waf_stats);
+SSDFS_SEGMENTS_RW_ATTR(lookup_stats);
+SSDFS_SEGMENTS_RW_ATTR(dow_fold_chain);
+SSDFS_SEGMENTS_RW_ATTR(wr_throttle_ms);
+SSDFS_SEGMENTS_RW_ATTR(wr_throttle_reqs);
+SSDFS_SEGMENTS_RW_ATTR(gc_idle_reqs);
+SSDFS_SEGMENTS_RW_ATTR(gc_busy_reqs);
+SSDFS_SEGMENTS_RW_ATTR(gc_urgent_free_pct);
+SSDFS_SEGMENTS_RW_ATTR(gc_idle_delay_ms);
+SSDFS_SEGMENTS_RW_ATTR(gc_busy_delay_ms);
+SSDFS_SEGMENTS_RW_ATTR(gc_idle_scan_secs);
 
 static struct attribute *ssdfs_segments_attrs[] = {
 	SSDFS_SEGMENTS_ATTR_LIST(current_segments),
+	SSDFS_SEGMENTS_ATTR_LIST(sync_req_latency_ms),
+	SSDFS_SEGMENTS_ATTR_LIST(async_req_latency_ms),
+	SSDFS_SEGMENTS_ATTR_LIST(gc_req_latency_ms),
+	SSDFS_SEGMENTS_ATTR_LIST(dow_metadata_pct),
+	SSDFS_SEGMENTS_ATTR_LIST(dow_user_data_pct),
+	SSDFS_SEGMENTS_ATTR_LIST(dow_stats),
+	SSDFS_SEGMENTS_ATTR_LIST(reclaim_stats),
+	SSDFS_SEGMENTS_ATTR_LIST(waf_stats),
+	SSDFS_SEGMENTS_ATTR_LIST(lookup_stats),
+	SSDFS_SEGMENTS_ATTR_LIST(dow_fold_chain),
+	SSDFS_SEGMENTS_ATTR_LIST(wr_throttle_ms),
+	SSDFS_SEGMENTS_ATTR_LIST(wr_throttle_reqs),
+	SSDFS_SEGMENTS_ATTR_LIST(gc_idle_reqs),
+	SSDFS_SEGMENTS_ATTR_LIST(gc_busy_reqs),
+	SSDFS_SEGMENTS_ATTR_LIST(gc_urgent_free_pct),
+	SSDFS_SEGMENTS_ATTR_LIST(gc_idle_delay_ms),
+	SSDFS_SEGMENTS_ATTR_LIST(gc_busy_delay_ms),
+	SSDFS_SEGMENTS_ATTR_LIST(gc_idle_scan_secs),
 	NULL,
 };
 ATTRIBUTE_GROUPS(ssdfs_segments);
@@ -1370,6 +2144,81 @@ ssize_t ssdfs_maptbl_stripes_per_fragment_show(struct ssdfs_maptbl_attr *attr,
 	return snprintf(buf, PAGE_SIZE, "%u\n", stripes_per_fragment);
 }
 
+static
+ssize_t ssdfs_maptbl_erase_cycles_max_show(struct ssdfs_maptbl_attr *attr,
+					   struct ssdfs_fs_info *fsi,
+					   char *buf)
+{
+	struct ssdfs_peb_mapping_table *tbl = fsi->maptbl;
+	struct ssdfs_maptbl_wear_stats stats;
+
+	if (!tbl) {
+		SSDFS_WARN("maptbl is absent\n");
+		return 0;
+	}
+
+	ssdfs_maptbl_get_wear_stats(tbl, &stats);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", stats.max_erase_cycles);
+}
+
+static
+ssize_t ssdfs_maptbl_erase_cycles_avg_show(struct ssdfs_maptbl_attr *attr,
+					   struct ssdfs_fs_info *fsi,
+					   char *buf)
+{
+	struct ssdfs_peb_mapping_table *tbl = fsi->maptbl;
+	struct ssdfs_maptbl_wear_stats stats;
+	u64 avg = 0;
+
+	if (!tbl) {
+		SSDFS_WARN("maptbl is absent\n");
+		return 0;
+	}
+
+	ssdfs_maptbl_get_wear_stats(tbl, &stats);
+
+	if (stats.pebs_count > 0)
+		avg = div_u64(stats.total_erase_cycles, stats.pebs_count);
+
+	return snprintf(buf, PAGE_SIZE, "%llu\n", avg);
+}
+
+static
+ssize_t ssdfs_maptbl_wear_histogram_show(struct ssdfs_maptbl_attr *attr,
+					 struct ssdfs_fs_info *fsi,
+					 char *buf)
+{
+	struct ssdfs_peb_mapping_table *tbl = fsi->maptbl;
+	struct ssdfs_maptbl_wear_stats stats;
+	ssize_t count = 0;
+	int i;
+
+	if (!tbl) {
+		SSDFS_WARN("maptbl is absent\n");
+		return 0;
+	}
+
+	ssdfs_maptbl_get_wear_stats(tbl, &stats);
+
+	for (i = 0; i < SSDFS_MAPTBL_WEAR_BUCKETS; i++) {
+		u32 low = i == 0 ? 0 : 1U << (i - 1);
+
+		if (i == (SSDFS_MAPTBL_WEAR_BUCKETS - 1)) {
+			count += snprintf(buf + count, PAGE_SIZE - count,
+					  "[%u+]: %u\n",
+					  low, stats.histogram[i]);
+		} else {
+			count += snprintf(buf + count, PAGE_SIZE - count,
+					  "[%u-%u]: %u\n",
+					  low, (1U << i) - 1,
+					  stats.histogram[i]);
+		}
+	}
+
+	return count;
+}
+
 SSDFS_MAPTBL_RO_ATTR(fragments_count);
 SSDFS_MAPTBL_RO_ATTR(fragments_per_seg);
 SSDFS_MAPTBL_RO_ATTR(fragments_per_peb);
@@ -1381,6 +2230,9 @@ SSDFS_MAPTBL_RO_ATTR(lebs_per_fragment);
 SSDFS_MAPTBL_RO_ATTR(pebs_per_fragment);
 SSDFS_MAPTBL_RO_ATTR(pebs_per_stripe);
 SSDFS_MAPTBL_RO_ATTR(stripes_per_fragment);
+SSDFS_MAPTBL_RO_ATTR(erase_cycles_max);
+SSDFS_MAPTBL_RO_ATTR(erase_cycles_avg);
+SSDFS_MAPTBL_RO_ATTR(wear_histogram);
 
 static struct attribute *ssdfs_maptbl_attrs[] = {
 	SSDFS_MAPTBL_ATTR_LIST(fragments_count),
@@ -1394,6 +2246,9 @@ static struct attribute *ssdfs_maptbl_attrs[] = {
 	SSDFS_MAPTBL_ATTR_LIST(pebs_per_fragment),
 	SSDFS_MAPTBL_ATTR_LIST(pebs_per_stripe),
 	SSDFS_MAPTBL_ATTR_LIST(stripes_per_fragment),
+	SSDFS_MAPTBL_ATTR_LIST(erase_cycles_max),
+	SSDFS_MAPTBL_ATTR_LIST(erase_cycles_avg),
+	SSDFS_MAPTBL_ATTR_LIST(wear_histogram),
 	NULL,
 };
 ATTRIBUTE_GROUPS(ssdfs_maptbl);
@@ -1558,7 +2413,7 @@ static ssize_t ssdfs_dev_mount_time_show(struct ssdfs_dev_attr *attr,
 {
 	u64 mount_time_ns;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	mount_time_ns = fsi->fs_mount_time;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -1571,7 +2426,7 @@ static ssize_t ssdfs_dev_mount_time_ns_show(struct ssdfs_dev_attr *attr,
 {
 	u64 mount_time_ns;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	mount_time_ns = fsi->fs_mount_time;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -1584,7 +2439,7 @@ static ssize_t ssdfs_dev_write_time_show(struct ssdfs_dev_attr *attr,
 {
 	u64 write_time_ns;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	write_time_ns = fsi->fs_mod_time;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -1597,7 +2452,7 @@ static ssize_t ssdfs_dev_write_time_ns_show(struct ssdfs_dev_attr *attr,
 {
 	u64 write_time_ns;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	write_time_ns = fsi->fs_mod_time;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -1610,7 +2465,7 @@ static ssize_t ssdfs_dev_mount_cno_show(struct ssdfs_dev_attr *attr,
 {
 	u64 mount_cno;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	mount_cno = fsi->fs_mount_cno;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -1688,9 +2543,7 @@ static ssize_t ssdfs_dev_free_pages_show(struct ssdfs_dev_attr *attr,
 {
 	u64 free_pages;
 
-	spin_lock(&fsi->volume_state_lock);
-	free_pages = fsi->free_pages;
-	spin_unlock(&fsi->volume_state_lock);
+	free_pages = ssdfs_fs_counter_sum(&fsi->free_pages);
 
 	return snprintf(buf, PAGE_SIZE, "%llu\n", free_pages);
 }
@@ -1727,7 +2580,7 @@ static ssize_t ssdfs_dev_error_behavior_show(struct ssdfs_dev_attr *attr,
 {
 	u16 fs_errors;
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	fs_errors = fsi->fs_errors;
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -1764,13 +2617,39 @@ static ssize_t ssdfs_dev_error_behavior_store(struct ssdfs_dev_attr *attr,
 		return -EINVAL;
 	}
 
-	spin_lock(&fsi->volume_state_lock);
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	fsi->fs_errors = val;
 	spin_unlock(&fsi->volume_state_lock);
 
 	return sizeof(val);
 }
 
+static ssize_t ssdfs_dev_mount_profile_show(struct ssdfs_dev_attr *attr,
+					     struct ssdfs_fs_info *fsi,
+					     char *buf)
+{
+	struct ssdfs_mount_profile *profile = &fsi->mount_profile;
+	ssize_t count = 0;
+	int i;
+
+	count += scnprintf(buf + count, PAGE_SIZE - count,
+			   "sb_search_path: %s\n",
+			   ssdfs_mount_phase_name(profile->sb_search));
+
+	for (i = 0; i < SSDFS_MOUNT_PHASE_MAX; i++) {
+		count += scnprintf(buf + count, PAGE_SIZE - count,
+				   "%s: %llu ns\n",
+				   ssdfs_mount_phase_name(i),
+				   profile->nsecs[i]);
+	}
+
+	count += scnprintf(buf + count, PAGE_SIZE - count,
+			   "total: %llu ns\n",
+			   profile->total_nsecs);
+
+	return count;
+}
+
 SSDFS_DEV_RO_ATTR(revision);
 SSDFS_DEV_RO_ATTR(pagesize);
 SSDFS_DEV_RO_ATTR(erasesize);
@@ -1793,6 +2672,7 @@ SSDFS_DEV_RO_ATTR(free_pages);
 SSDFS_DEV_RO_ATTR(uuid);
 SSDFS_DEV_RO_ATTR(volume_label);
 SSDFS_DEV_RW_ATTR(error_behavior);
+SSDFS_DEV_RO_ATTR(mount_profile);
 
 static struct attribute *ssdfs_dev_attrs[] = {
 	SSDFS_DEV_ATTR_LIST(revision),
@@ -1817,6 +2697,7 @@ static struct attribute *ssdfs_dev_attrs[] = {
 	SSDFS_DEV_ATTR_LIST(uuid),
 	SSDFS_DEV_ATTR_LIST(volume_label),
 	SSDFS_DEV_ATTR_LIST(error_behavior),
+	SSDFS_DEV_ATTR_LIST(mount_profile),
 	NULL,
 };
 ATTRIBUTE_GROUPS(ssdfs_dev);
@@ -1971,6 +2852,135 @@ static const struct attribute_group ssdfs_feature_attr_group = {
 	.attrs = ssdfs_feature_attrs,
 };
 
+/************************************************************************
+ *                        SSDFS memory attrs                            *
+ ************************************************************************/
+
+DEFINE_PER_CPU(struct ssdfs_mem_stat, ssdfs_mem_stat);
+
+/*
+ * ssdfs_mem_stat_read() - get memory consumption of subsystem
+ * @id: subsystem ID
+ *
+ * The CPUs' counters are summed without any synchronization.
+ * The memory can be allocated on one CPU and freed on another one.
+ * So, the counter of particular CPU can be negative but the sum is
+ * the bytes of memory that the subsystem keeps allocated.
+ *
+ * RETURN: number of allocated bytes.
+ */
+s64 ssdfs_mem_stat_read(int id)
+{
+	s64 bytes = 0;
+	int cpu;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(id < 0 || id >= SSDFS_MEM_STAT_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	for_each_possible_cpu(cpu)
+		bytes += per_cpu_ptr(&ssdfs_mem_stat, cpu)->bytes[id];
+
+	return bytes;
+}
+
+#define SSDFS_MEMORY_SHOW_FN(name) \
+static ssize_t ssdfs_memory_##name##_show(struct kobject *kobj, \
+					  struct attribute *attr, \
+					  char *buf) \
+{ \
+	return snprintf(buf, PAGE_SIZE, "%lld\n", \
+			ssdfs_mem_stat_read(SSDFS_MEM_STAT_##name)); \
+}
+SSDFS_MEM_STAT_SUBSYSTEMS(SSDFS_MEMORY_SHOW_FN)
+#undef SSDFS_MEMORY_SHOW_FN
+
+#define SSDFS_MEMORY_ATTR_FN(name) \
+	SSDFS_MEMORY_RO_ATTR(name);
+SSDFS_MEM_STAT_SUBSYSTEMS(SSDFS_MEMORY_ATTR_FN)
+#undef SSDFS_MEMORY_ATTR_FN
+
+#define SSDFS_MEMORY_ATTR_ITEM(name) \
+	SSDFS_MEMORY_ATTR_LIST(name),
+static struct attribute *ssdfs_memory_attrs[] = {
+	SSDFS_MEM_STAT_SUBSYSTEMS(SSDFS_MEMORY_ATTR_ITEM)
+	NULL,
+};
+#undef SSDFS_MEMORY_ATTR_ITEM
+
+static const struct attribute_group ssdfs_memory_attr_group = {
+	.name = "memory",
+	.attrs = ssdfs_memory_attrs,
+};
+
+#ifdef CONFIG_SSDFS_LOCK_STATS
+/************************************************************************
+ *                        SSDFS locks attrs                             *
+ ************************************************************************/
+
+DEFINE_PER_CPU(struct ssdfs_lock_stat, ssdfs_lock_stat);
+
+/*
+ * ssdfs_locks_stat_show() - show contention statistics of lock
+ * @id: lock ID
+ * @buf: output buffer
+ *
+ * The CPUs' counters are summed without any synchronization.
+ * So, the values are approximate under heavy load.
+ */
+static
+ssize_t ssdfs_locks_stat_show(int id, char *buf)
+{
+	u64 acquired = 0;
+	u64 contended = 0;
+	u64 wait_nsecs = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ssdfs_lock_stat *stat;
+
+		stat = per_cpu_ptr(&ssdfs_lock_stat, cpu);
+		acquired += READ_ONCE(stat->acquired[id]);
+		contended += READ_ONCE(stat->contended[id]);
+		wait_nsecs += READ_ONCE(stat->wait_nsecs[id]);
+	}
+
+	return snprintf(buf, PAGE_SIZE,
+			"acquired %llu, contended %llu, "
+			"wait_ns %llu, avg_wait_ns %llu\n",
+			acquired, contended, wait_nsecs,
+			contended ? div64_u64(wait_nsecs, contended) : 0);
+}
+
+#define SSDFS_LOCKS_SHOW_FN(name) \
+static ssize_t ssdfs_locks_##name##_show(struct kobject *kobj, \
+					 struct attribute *attr, \
+					 char *buf) \
+{ \
+	return ssdfs_locks_stat_show(SSDFS_LOCK_STAT_##name, buf); \
+}
+SSDFS_LOCK_STAT_CLASSES(SSDFS_LOCKS_SHOW_FN)
+#undef SSDFS_LOCKS_SHOW_FN
+
+#define SSDFS_LOCKS_ATTR_FN(name) \
+	SSDFS_LOCKS_RO_ATTR(name);
+SSDFS_LOCK_STAT_CLASSES(SSDFS_LOCKS_ATTR_FN)
+#undef SSDFS_LOCKS_ATTR_FN
+
+#define SSDFS_LOCKS_ATTR_ITEM(name) \
+	SSDFS_LOCKS_ATTR_LIST(name),
+static struct attribute *ssdfs_locks_attrs[] = {
+	SSDFS_LOCK_STAT_CLASSES(SSDFS_LOCKS_ATTR_ITEM)
+	NULL,
+};
+#undef SSDFS_LOCKS_ATTR_ITEM
+
+static const struct attribute_group ssdfs_locks_attr_group = {
+	.name = "locks",
+	.attrs = ssdfs_locks_attrs,
+};
+#endif /* CONFIG_SSDFS_LOCK_STATS */
+
 int ssdfs_sysfs_init(void)
 {
 	int err;
@@ -1992,8 +3002,30 @@ int ssdfs_sysfs_init(void)
 		goto cleanup_sysfs_init;
 	}
 
+	err = sysfs_create_group(&ssdfs_kset->kobj, &ssdfs_memory_attr_group);
+	if (unlikely(err)) {
+		SSDFS_ERR("unable to create memory group: err %d\n", err);
+		goto remove_feature_group;
+	}
+
+#ifdef CONFIG_SSDFS_LOCK_STATS
+	err = sysfs_create_group(&ssdfs_kset->kobj, &ssdfs_locks_attr_group);
+	if (unlikely(err)) {
+		SSDFS_ERR("unable to create locks group: err %d\n", err);
+		goto remove_memory_group;
+	}
+#endif /* CONFIG_SSDFS_LOCK_STATS */
+
 	return 0;
 
+#ifdef CONFIG_SSDFS_LOCK_STATS
+remove_memory_group:
+	sysfs_remove_group(&ssdfs_kset->kobj, &ssdfs_memory_attr_group);
+#endif /* CONFIG_SSDFS_LOCK_STATS */
+
+remove_feature_group:
+	sysfs_remove_group(&ssdfs_kset->kobj, &ssdfs_feature_attr_group);
+
 cleanup_sysfs_init:
 	kset_unregister(ssdfs_kset);
 
@@ -2007,6 +3039,10 @@ void ssdfs_sysfs_exit(void)
 	SSDFS_DBG("deinitialize sysfs entry\n");
 #endif /* CONFIG_SSDFS_DEBUG */
 
+#ifdef CONFIG_SSDFS_LOCK_STATS
+	sysfs_remove_group(&ssdfs_kset->kobj, &ssdfs_locks_attr_group);
+#endif /* CONFIG_SSDFS_LOCK_STATS */
+	sysfs_remove_group(&ssdfs_kset->kobj, &ssdfs_memory_attr_group);
 	sysfs_remove_group(&ssdfs_kset->kobj, &ssdfs_feature_attr_group);
 	kset_unregister(ssdfs_kset);
 }
@@ -32,6 +32,22 @@ struct ssdfs_feature_attr {
 			 const char *, size_t);
 };
 
+struct ssdfs_memory_attr {
+	struct attribute attr;
+	ssize_t (*show)(struct kobject *, struct attribute *,
+			char *);
+	ssize_t (*store)(struct kobject *, struct attribute *,
+			 const char *, size_t);
+};
+
+struct ssdfs_locks_attr {
+	struct attribute attr;
+	ssize_t (*show)(struct kobject *, struct attribute *,
+			char *);
+	ssize_t (*store)(struct kobject *, struct attribute *,
+			 const char *, size_t);
+};
+
 struct ssdfs_dev_attr {
 	struct attribute attr;
 	ssize_t (*show)(struct ssdfs_dev_attr *, struct ssdfs_fs_info *,
@@ -97,6 +113,12 @@ struct ssdfs_maptbl_attr {
 #define SSDFS_FEATURE_RO_ATTR(name) \
 	SSDFS_ATTR(feature, name, 0444, ssdfs_feature_##name##_show, NULL)
 
+#define SSDFS_MEMORY_RO_ATTR(name) \
+	SSDFS_ATTR(memory, name, 0444, ssdfs_memory_##name##_show, NULL)
+
+#define SSDFS_LOCKS_RO_ATTR(name) \
+	SSDFS_ATTR(locks, name, 0444, ssdfs_locks_##name##_show, NULL)
+
 #define SSDFS_DEV_INFO_ATTR(name) \
 	SSDFS_ATTR(dev, name, 0444, NULL, NULL)
 #define SSDFS_DEV_RO_ATTR(name) \
@@ -155,6 +177,10 @@ struct ssdfs_maptbl_attr {
 
 #define SSDFS_FEATURE_ATTR_LIST(name) \
 	(&ssdfs_feature_attr_##name.attr)
+#define SSDFS_MEMORY_ATTR_LIST(name) \
+	(&ssdfs_memory_attr_##name.attr)
+#define SSDFS_LOCKS_ATTR_LIST(name) \
+	(&ssdfs_locks_attr_##name.attr)
 #define SSDFS_DEV_ATTR_LIST(name) \
 	(&ssdfs_dev_attr_##name.attr)
 #define SSDFS_SEGMENTS_ATTR_LIST(name) \
@@ -14,6 +14,8 @@
 #include <linux/slab.h>
 #include <linux/pagevec.h>
 #include <linux/wait.h>
+#include <linux/kthread.h>
+#include <linux/random.h>
 
 #include "peb_mapping_queue.h"
 #include "peb_mapping_table_cache.h"
@@ -38,8 +40,189 @@
 #include "shared_extents_tree.h"
 #include "snapshots_tree.h"
 #include "xattr.h"
+#include "compression.h"
 #include "testing.h"
 
+#define SSDFS_BENCHMARK_LATENCY_BUCKETS		(40)
+
+/*
+ * struct ssdfs_benchmark_context - benchmark's state
+ * @benv: benchmark environment
+ * @histogram: log2 histograms of operations' latency in nanoseconds
+ * @subsystem_start: timestamp of subsystem's testing start
+ * @memory_start: allocated memory at the start of subsystem's testing
+ */
+struct ssdfs_benchmark_context {
+	struct ssdfs_benchmark_environment *benv;
+	u64 histogram[SSDFS_TESTING_SUBSYSTEMS_MAX]
+		     [SSDFS_BENCHMARK_PHASE_MAX]
+		     [SSDFS_BENCHMARK_LATENCY_BUCKETS];
+	ktime_t subsystem_start;
+	s64 memory_start;
+};
+
+/*
+ * ssdfs_testing_memory_usage() - get amount of allocated memory
+ */
+static
+s64 ssdfs_testing_memory_usage(void)
+{
+	s64 bytes = 0;
+	int i;
+
+	for (i = 0; i < SSDFS_MEM_STAT_MAX; i++)
+		bytes += ssdfs_mem_stat_read(i);
+
+	return bytes;
+}
+
+/*
+ * ssdfs_testing_op_start() - get timestamp of operation's start
+ * @fsi: pointer on shared file system object
+ */
+static inline
+ktime_t ssdfs_testing_op_start(struct ssdfs_fs_info *fsi)
+{
+	if (!fsi->testing_bench)
+		return 0;
+
+	return ktime_get();
+}
+
+/*
+ * ssdfs_testing_op_finish() - account operation of benchmark's phase
+ * @fsi: pointer on shared file system object
+ * @id: subsystem ID
+ * @phase: benchmark phase
+ * @start: timestamp of operation's start
+ */
+static inline
+void ssdfs_testing_op_finish(struct ssdfs_fs_info *fsi, int id, int phase,
+			     ktime_t start)
+{
+	struct ssdfs_benchmark_context *bench = fsi->testing_bench;
+	struct ssdfs_benchmark_phase_result *result;
+	s64 nsecs;
+	int bucket = 0;
+
+	if (!bench)
+		return;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(id < 0 || id >= SSDFS_TESTING_SUBSYSTEMS_MAX);
+	BUG_ON(phase < 0 || phase >= SSDFS_BENCHMARK_PHASE_MAX);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	nsecs = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (nsecs > 1) {
+		bucket = ilog2(nsecs);
+		bucket = min_t(int, bucket,
+				SSDFS_BENCHMARK_LATENCY_BUCKETS - 1);
+	}
+
+	result = &bench->benv->results[id].phases[phase];
+	result->ops++;
+	result->nsecs += nsecs;
+	bench->histogram[id][phase][bucket]++;
+}
+
+/*
+ * ssdfs_testing_subsystem_start() - start subsystem's benchmark
+ * @fsi: pointer on shared file system object
+ */
+static inline
+void ssdfs_testing_subsystem_start(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_benchmark_context *bench = fsi->testing_bench;
+
+	if (!bench)
+		return;
+
+	bench->memory_start = ssdfs_testing_memory_usage();
+	bench->subsystem_start = ktime_get();
+}
+
+/*
+ * ssdfs_testing_latency_percentile() - estimate latency's percentile
+ * @histogram: log2 histogram of latency
+ * @ops: number of operations in histogram
+ * @percent: requested percentile
+ *
+ * RETURN: upper bound of bucket that contains the percentile.
+ */
+static
+u64 ssdfs_testing_latency_percentile(u64 *histogram, u64 ops, u32 percent)
+{
+	u64 threshold;
+	u64 sum = 0;
+	int i;
+
+	if (ops == 0)
+		return 0;
+
+	threshold = div_u64(ops * percent + 99, 100);
+
+	for (i = 0; i < SSDFS_BENCHMARK_LATENCY_BUCKETS; i++) {
+		sum += histogram[i];
+
+		if (sum >= threshold)
+			break;
+	}
+
+	return (1ULL << (i + 1)) - 1;
+}
+
+/*
+ * ssdfs_testing_subsystem_finish() - finish subsystem's benchmark
+ * @fsi: pointer on shared file system object
+ * @id: subsystem ID
+ */
+static
+void ssdfs_testing_subsystem_finish(struct ssdfs_fs_info *fsi, int id)
+{
+	struct ssdfs_benchmark_context *bench = fsi->testing_bench;
+	struct ssdfs_benchmark_result *result;
+	struct ssdfs_benchmark_phase_result *phase;
+	u64 *histogram;
+	int i;
+
+	if (!bench)
+		return;
+
+	result = &bench->benv->results[id];
+	result->nsecs = ktime_to_ns(ktime_sub(ktime_get(),
+					      bench->subsystem_start));
+	result->memory_delta = ssdfs_testing_memory_usage() -
+					bench->memory_start;
+
+	for (i = 0; i < SSDFS_BENCHMARK_PHASE_MAX; i++) {
+		phase = &result->phases[i];
+		histogram = bench->histogram[id][i];
+
+		if (phase->nsecs > 0) {
+			phase->ops_per_sec = div64_u64(phase->ops *
+								NSEC_PER_SEC,
+							phase->nsecs);
+		}
+
+		phase->p50_nsecs = ssdfs_testing_latency_percentile(histogram,
+								    phase->ops,
+								    50);
+		phase->p99_nsecs = ssdfs_testing_latency_percentile(histogram,
+								    phase->ops,
+								    99);
+
+		SSDFS_ERR("BENCHMARK: subsystem %d, phase %d, ops %llu, "
+			  "ops_per_sec %llu, p50 %llu ns, p99 %llu ns\n",
+			  id, i, phase->ops, phase->ops_per_sec,
+			  phase->p50_nsecs, phase->p99_nsecs);
+	}
+
+	SSDFS_ERR("BENCHMARK: subsystem %d, time %llu ns, "
+		  "memory delta %lld bytes\n",
+		  id, result->nsecs, result->memory_delta);
+}
+
 static
 void ssdfs_testing_invalidate_folio(struct folio *folio, size_t offset,
 				    size_t length)
@@ -221,6 +404,8 @@ int ssdfs_do_extents_tree_testing(struct ssdfs_fs_info *fsi,
 	u64 per_1_percent = 0;
 	u64 message_threshold = 0;
 	u64 processed_bytes = 0;
+	ktime_t start;
+	bool found;
 	int err = 0;
 
 	fsi->do_fork_invalidation = false;
@@ -261,11 +446,14 @@ int ssdfs_do_extents_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_extents_tree_add_block(fsi,
 							   logical_offset,
 							   seg_id,
 							   logical_blk,
 							   page_size);
+		ssdfs_testing_op_finish(fsi, SSDFS_EXTENTS_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_ADD_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to add logical block: "
 				  "err %d\n", err);
@@ -306,8 +494,13 @@ int ssdfs_do_extents_tree_testing(struct ssdfs_fs_info *fsi,
 
 		logical_blk = div_u64(logical_offset, page_size);
 
-		if (!ssdfs_extents_tree_has_logical_block(logical_blk,
-							  fsi->testing_inode)) {
+		start = ssdfs_testing_op_start(fsi);
+		found = ssdfs_extents_tree_has_logical_block(logical_blk,
+							fsi->testing_inode);
+		ssdfs_testing_op_finish(fsi, SSDFS_EXTENTS_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, start);
+
+		if (!found) {
 			err = -ENOENT;
 			SSDFS_ERR("fail to find: "
 				  "logical_offset %lld, "
@@ -341,12 +534,17 @@ int ssdfs_do_extents_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
+
 		truncate_setsize(fsi->testing_inode, logical_offset);
 
 		down_write(&SSDFS_I(fsi->testing_inode)->lock);
 		err = ssdfs_extents_tree_truncate(fsi->testing_inode);
 		up_write(&SSDFS_I(fsi->testing_inode)->lock);
 
+		ssdfs_testing_op_finish(fsi, SSDFS_EXTENTS_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_DELETE_PHASE, start);
+
 		if (err) {
 			SSDFS_ERR("fail to truncate logical block: "
 				  "err %d\n", err);
@@ -601,6 +799,7 @@ int ssdfs_do_dentries_tree_testing(struct ssdfs_fs_info *fsi,
 	u64 message_threshold = 0;
 	u64 file_index;
 	unsigned char name[SSDFS_DENTRY_INLINE_NAME_MAX_LEN];
+	ktime_t start;
 	int err = 0;
 
 	root_i = ssdfs_iget(fsi->sb, SSDFS_ROOT_INO);
@@ -634,9 +833,12 @@ int ssdfs_do_dentries_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_dentries_tree_add_file(fsi, root_i,
 							   file_index,
 							   name);
+		ssdfs_testing_op_finish(fsi, SSDFS_DENTRIES_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_ADD_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to create file: "
 				  "err %d\n", err);
@@ -664,9 +866,12 @@ int ssdfs_do_dentries_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_dentries_tree_check_file(fsi, root_i,
 							     file_index,
 							     name);
+		ssdfs_testing_op_finish(fsi, SSDFS_DENTRIES_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to check file: "
 				  "err %d\n", err);
@@ -709,9 +914,12 @@ int ssdfs_do_dentries_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_dentries_tree_delete_file(fsi, root_i,
 							      file_index,
 							      name);
+		ssdfs_testing_op_finish(fsi, SSDFS_DENTRIES_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_DELETE_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to delete file: "
 				  "err %d\n", err);
@@ -1114,6 +1322,7 @@ int ssdfs_do_block_bitmap_testing_iteration(struct ssdfs_fs_info *fsi,
 					struct ssdfs_block_bmap *bmap,
 					struct ssdfs_testing_environment *env)
 {
+	ktime_t start;
 	int err = 0;
 
 	err = ssdfs_block_bmap_lock(bmap);
@@ -1136,25 +1345,37 @@ int ssdfs_do_block_bitmap_testing_iteration(struct ssdfs_fs_info *fsi,
 		goto unlock_block_bitmap;
 	}
 
+	start = ssdfs_testing_op_start(fsi);
 	err = ssdfs_testing_block_bmap_pre_allocation(bmap, env);
+	ssdfs_testing_op_finish(fsi, SSDFS_BLOCK_BMAP_TESTING_ID,
+				SSDFS_BENCHMARK_ADD_PHASE, start);
 	if (unlikely(err)) {
 		SSDFS_ERR("pre_allocation check failed: err %d\n", err);
 		goto unlock_block_bitmap;
 	}
 
+	start = ssdfs_testing_op_start(fsi);
 	err = ssdfs_testing_block_bmap_allocation(bmap, env);
+	ssdfs_testing_op_finish(fsi, SSDFS_BLOCK_BMAP_TESTING_ID,
+				SSDFS_BENCHMARK_ADD_PHASE, start);
 	if (unlikely(err)) {
 		SSDFS_ERR("allocation check failed: err %d\n", err);
 		goto unlock_block_bitmap;
 	}
 
+	start = ssdfs_testing_op_start(fsi);
 	err = ssdfs_testing_block_bmap_invalidation(bmap, env);
+	ssdfs_testing_op_finish(fsi, SSDFS_BLOCK_BMAP_TESTING_ID,
+				SSDFS_BENCHMARK_DELETE_PHASE, start);
 	if (unlikely(err)) {
 		SSDFS_ERR("invalidation check failed: err %d\n", err);
 		goto unlock_block_bitmap;
 	}
 
+	start = ssdfs_testing_op_start(fsi);
 	err = ssdfs_testing_block_bmap_collect_garbage(bmap, env);
+	ssdfs_testing_op_finish(fsi, SSDFS_BLOCK_BMAP_TESTING_ID,
+				SSDFS_BENCHMARK_CHECK_PHASE, start);
 	if (unlikely(err)) {
 		SSDFS_ERR("collect garbage check failed: err %d\n", err);
 		goto unlock_block_bitmap;
@@ -1257,6 +1478,7 @@ int ssdfs_do_blk2off_table_testing(struct ssdfs_fs_info *fsi,
 	u16 logical_blk;
 	s64 sequence_id;
 	struct completion *end;
+	ktime_t start;
 	int err = 0;
 
 	blk2off_tbl = ssdfs_blk2off_table_create(fsi, capacity,
@@ -1270,8 +1492,11 @@ int ssdfs_do_blk2off_table_testing(struct ssdfs_fs_info *fsi,
 
 	logical_blk = 0;
 	while ((logical_blk + 1) < capacity) {
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_blk2off_table_allocate_block(blk2off_tbl,
 							 &logical_blk);
+		ssdfs_testing_op_finish(fsi, SSDFS_BLK2OFF_TABLE_TESTING_ID,
+					SSDFS_BENCHMARK_ADD_PHASE, start);
 		if (err == -EAGAIN) {
 			end = &blk2off_tbl->partial_init_end;
 
@@ -1328,11 +1553,14 @@ int ssdfs_do_blk2off_table_testing(struct ssdfs_fs_info *fsi,
 		blk_desc_off.blk_state.byte_offset =
 					cpu_to_le32(logical_blk * PAGE_SIZE);
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_blk2off_table_change_offset(blk2off_tbl,
 							logical_blk,
 							0,
 							&blk_desc,
 							&blk_desc_off);
+		ssdfs_testing_op_finish(fsi, SSDFS_BLK2OFF_TABLE_TESTING_ID,
+					SSDFS_BENCHMARK_CHANGE_PHASE, start);
 		if (err == -EAGAIN) {
 			end = &blk2off_tbl->full_init_end;
 
@@ -1375,11 +1603,14 @@ int ssdfs_do_blk2off_table_testing(struct ssdfs_fs_info *fsi,
 		SSDFS_ERR("CHECK LOGICAL BLOCK: logical_blk %u, capacity %u\n",
 			  logical_blk, capacity);
 
+		start = ssdfs_testing_op_start(fsi);
 		ptr = ssdfs_blk2off_table_convert(blk2off_tbl,
 						  logical_blk,
 						  &peb_index,
 						  &migration_state,
 						  &pos);
+		ssdfs_testing_op_finish(fsi, SSDFS_BLK2OFF_TABLE_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, start);
 		if (IS_ERR(ptr) && PTR_ERR(ptr) == -EAGAIN) {
 			end = &blk2off_tbl->full_init_end;
 
@@ -1466,8 +1697,11 @@ int ssdfs_do_blk2off_table_testing(struct ssdfs_fs_info *fsi,
 		SSDFS_ERR("FREE LOGICAL BLOCK: logical_blk %u, capacity %u\n",
 			  logical_blk, capacity);
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_blk2off_table_free_block(blk2off_tbl,
 						     0, logical_blk);
+		ssdfs_testing_op_finish(fsi, SSDFS_BLK2OFF_TABLE_TESTING_ID,
+					SSDFS_BENCHMARK_DELETE_PHASE, start);
 		if (err == -EAGAIN) {
 			end = &blk2off_tbl->full_init_end;
 
@@ -1497,7 +1731,7 @@ destroy_blk2off_table:
 
 	BUG_ON(sequence_id >= U16_MAX);
 
-	down_write(&blk2off_tbl->translation_lock);
+	ssdfs_blk2off_table_down_write(blk2off_tbl);
 
 	for (; sequence_id >= 0; --sequence_id) {
 		err = ssdfs_blk2off_table_fragment_set_clean(blk2off_tbl, 0,
@@ -1586,6 +1820,7 @@ int ssdfs_do_leb_mapping_testing(struct ssdfs_fs_info *fsi,
 	struct completion *end;
 	struct ssdfs_maptbl_peb_relation pebr;
 	u64 cur_leb = iteration * env->mapping_table.peb_mappings_per_iteration;
+	ktime_t start;
 	int i;
 	int err;
 
@@ -1597,9 +1832,12 @@ int ssdfs_do_leb_mapping_testing(struct ssdfs_fs_info *fsi,
 		}
 
 try_next_leb:
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_maptbl_map_leb2peb(fsi, cur_leb,
 						SSDFS_MAPTBL_DATA_PEB_TYPE,
 						&pebr, &end);
+		ssdfs_testing_op_finish(fsi, SSDFS_PEB_MAPPING_TABLE_TESTING_ID,
+					SSDFS_BENCHMARK_ADD_PHASE, start);
 		if (err == -EAGAIN) {
 			err = SSDFS_WAIT_COMPLETION(end);
 			if (unlikely(err)) {
@@ -1647,6 +1885,7 @@ int ssdfs_do_migration_add_testing(struct ssdfs_fs_info *fsi,
 	u8 peb_type = SSDFS_MAPTBL_DATA_PEB_TYPE;
 	u64 cur_leb = 0;
 	u64 seg_id = U64_MAX;
+	ktime_t start;
 	int i;
 	int err;
 
@@ -1748,8 +1987,11 @@ int ssdfs_do_migration_add_testing(struct ssdfs_fs_info *fsi,
 			return err;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_maptbl_add_migration_peb(fsi, cur_leb, peb_type,
 						     &pebr, &init_end);
+		ssdfs_testing_op_finish(fsi, SSDFS_PEB_MAPPING_TABLE_TESTING_ID,
+					SSDFS_BENCHMARK_CHANGE_PHASE, start);
 		if (err == -EAGAIN) {
 			err = SSDFS_WAIT_COMPLETION(init_end);
 			if (unlikely(err)) {
@@ -1786,6 +2028,7 @@ int ssdfs_do_finish_migration_testing(struct ssdfs_fs_info *fsi,
 	u8 peb_type = SSDFS_MAPTBL_DATA_PEB_TYPE;
 	u32 count = env->mapping_table.exclude_migrations_per_iteration;
 	u64 cur_leb = 0;
+	ktime_t start;
 	int i;
 	int err;
 
@@ -1849,10 +2092,13 @@ finish_search:
 			  cur_leb);
 #endif /* CONFIG_SSDFS_DEBUG */
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_maptbl_exclude_migration_peb(fsi, cur_leb,
 							 peb_type,
 							 U64_MAX, U64_MAX,
 							 &init_end);
+		ssdfs_testing_op_finish(fsi, SSDFS_PEB_MAPPING_TABLE_TESTING_ID,
+					SSDFS_BENCHMARK_CHANGE_PHASE, start);
 		if (err == -EAGAIN) {
 			err = SSDFS_WAIT_COMPLETION(init_end);
 			if (unlikely(err)) {
@@ -1892,12 +2138,16 @@ int ssdfs_do_check_leb2peb_mapping(struct ssdfs_fs_info *fsi,
 			env->mapping_table.peb_mappings_per_iteration;
 	u64 calculated = 0;
 	u64 cur_leb = 0;
+	ktime_t start;
 	int err;
 
 	do {
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_maptbl_convert_leb2peb(fsi, cur_leb,
 						   peb_type, &pebr,
 						   &init_end);
+		ssdfs_testing_op_finish(fsi, SSDFS_PEB_MAPPING_TABLE_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, start);
 		if (err == -EAGAIN) {
 			err = SSDFS_WAIT_COMPLETION(init_end);
 			if (unlikely(err)) {
@@ -1950,10 +2200,14 @@ int ssdfs_do_check_leb2peb_mapping(struct ssdfs_fs_info *fsi,
 				return err;
 			}
 
+			start = ssdfs_testing_op_start(fsi);
 			err = ssdfs_maptbl_prepare_pre_erase_state(fsi,
 								   cur_leb,
 								   peb_type,
 								   &init_end);
+			ssdfs_testing_op_finish(fsi,
+					SSDFS_PEB_MAPPING_TABLE_TESTING_ID,
+					SSDFS_BENCHMARK_DELETE_PHASE, start);
 			if (err == -EAGAIN) {
 				err = SSDFS_WAIT_COMPLETION(init_end);
 				if (unlikely(err)) {
@@ -2074,17 +2328,21 @@ int ssdfs_do_segment_using_testing(struct ssdfs_fs_info *fsi,
 	u64 found_seg;
 	int check_state;
 	struct completion *init_end;
+	ktime_t start;
 	int res = 0;
 	u32 i;
 	int err;
 
 	for (i = 0; i < count; i++) {
+		start = ssdfs_testing_op_start(fsi);
 		res = ssdfs_segbmap_find_and_set(fsi->segbmap,
 						 start_seg, end_seg,
 						 SSDFS_SEG_CLEAN,
 						 SSDFS_SEG_CLEAN_STATE_FLAG,
 						 new_state,
 						 &found_seg, &init_end);
+		ssdfs_testing_op_finish(fsi, SSDFS_SEGMENT_BITMAP_TESTING_ID,
+					SSDFS_BENCHMARK_ADD_PHASE, start);
 		if (res >= 0) {
 			if (res != SSDFS_SEG_CLEAN) {
 				SSDFS_ERR("invalid segment state: "
@@ -2182,9 +2440,14 @@ int ssdfs_do_segment_state_testing(struct ssdfs_fs_info *fsi,
 	int seg_state = SSDFS_SEG_STATE_MAX;
 	bool is_expected_state;
 	struct completion *init_end;
+	int phase = SSDFS_BENCHMARK_CHANGE_PHASE;
+	ktime_t start;
 	u32 i;
 	int err;
 
+	if (new_state == SSDFS_SEG_CLEAN)
+		phase = SSDFS_BENCHMARK_DELETE_PHASE;
+
 	mutex_lock(&fsi->resize_mutex);
 	nsegs = fsi->nsegs;
 	mutex_unlock(&fsi->resize_mutex);
@@ -2225,8 +2488,11 @@ fail_define_seg_state:
 			return -ENOSPC;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_segbmap_change_state(fsi->segbmap, cur_seg,
 						 new_state, &init_end);
+		ssdfs_testing_op_finish(fsi, SSDFS_SEGMENT_BITMAP_TESTING_ID,
+					phase, start);
 		if (err == -EAGAIN) {
 			err = SSDFS_WAIT_COMPLETION(init_end);
 			if (unlikely(err)) {
@@ -2315,6 +2581,7 @@ int ssdfs_check_segment_bitmap_testing(struct ssdfs_fs_info *fsi,
 	u64 pre_dirty_segs = 0;
 	u64 dirty_segs = 0;
 	u64 calculated;
+	ktime_t start;
 	int err;
 
 	mutex_lock(&fsi->resize_mutex);
@@ -2322,8 +2589,11 @@ int ssdfs_check_segment_bitmap_testing(struct ssdfs_fs_info *fsi,
 	mutex_unlock(&fsi->resize_mutex);
 
 	for (cur_seg = 0; cur_seg < nsegs; cur_seg++) {
+		start = ssdfs_testing_op_start(fsi);
 		seg_state = ssdfs_segbmap_get_state(fsi->segbmap,
 						    cur_seg, &init_end);
+		ssdfs_testing_op_finish(fsi, SSDFS_SEGMENT_BITMAP_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, start);
 		if (seg_state == -EAGAIN) {
 			err = SSDFS_WAIT_COMPLETION(init_end);
 			if (unlikely(err)) {
@@ -2529,6 +2799,7 @@ int ssdfs_do_shared_dictionary_testing(struct ssdfs_fs_info *fsi,
 	unsigned char table[SSDFS_MAX_NAME_LEN];
 	unsigned char name[SSDFS_MAX_NAME_LEN];
 	u64 name_hash;
+	ktime_t start;
 	u32 i;
 	int err = 0;
 
@@ -2549,9 +2820,12 @@ int ssdfs_do_shared_dictionary_testing(struct ssdfs_fs_info *fsi,
 			return -ERANGE;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_shared_dict_save_name(fsi->shdictree,
 						  name_hash,
 						  &str);
+		ssdfs_testing_op_finish(fsi, SSDFS_SHARED_DICTIONARY_TESTING_ID,
+					SSDFS_BENCHMARK_ADD_PHASE, start);
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to store name: "
 				  "hash %llx, err %d\n",
@@ -2577,9 +2851,12 @@ int ssdfs_do_shared_dictionary_testing(struct ssdfs_fs_info *fsi,
 			return -ERANGE;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_shared_dict_get_name(fsi->shdictree,
 						 name_hash,
 						 &found_name);
+		ssdfs_testing_op_finish(fsi, SSDFS_SHARED_DICTIONARY_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, start);
 		if (unlikely(err)) {
 			SSDFS_ERR("fail to get name: "
 				  "hash %llx, err %d\n",
@@ -2873,6 +3150,7 @@ int ssdfs_do_xattr_tree_testing(struct ssdfs_fs_info *fsi,
 	u64 per_1_percent = 0;
 	u64 message_threshold = 0;
 	unsigned char table[SSDFS_MAX_NAME_LEN];
+	ktime_t start;
 	u64 i;
 	int err = 0;
 
@@ -2906,7 +3184,10 @@ int ssdfs_do_xattr_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_xattr_tree_add(fsi, env, table);
+		ssdfs_testing_op_finish(fsi, SSDFS_XATTR_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_ADD_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to add extended attribute: "
 				  "err %d\n", err);
@@ -2931,7 +3212,10 @@ int ssdfs_do_xattr_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_xattr_tree_check(fsi, env, table);
+		ssdfs_testing_op_finish(fsi, SSDFS_XATTR_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to check extended attribute: "
 				  "err %d\n", err);
@@ -2956,7 +3240,10 @@ int ssdfs_do_xattr_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_xattr_tree_increase_blob(fsi, env, table);
+		ssdfs_testing_op_finish(fsi, SSDFS_XATTR_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHANGE_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to increase extended attribute: "
 				  "err %d\n", err);
@@ -2981,7 +3268,10 @@ int ssdfs_do_xattr_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_xattr_tree_check(fsi, env, table);
+		ssdfs_testing_op_finish(fsi, SSDFS_XATTR_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to check extended attribute: "
 				  "err %d\n", err);
@@ -3006,7 +3296,10 @@ int ssdfs_do_xattr_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_xattr_tree_shrink_blob(fsi, env, table);
+		ssdfs_testing_op_finish(fsi, SSDFS_XATTR_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHANGE_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to shrink extended attribute: "
 				  "err %d\n", err);
@@ -3031,7 +3324,10 @@ int ssdfs_do_xattr_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_xattr_tree_check(fsi, env, table);
+		ssdfs_testing_op_finish(fsi, SSDFS_XATTR_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to check extended attribute: "
 				  "err %d\n", err);
@@ -3071,7 +3367,10 @@ int ssdfs_do_xattr_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_xattr_tree_delete(fsi, env, table);
+		ssdfs_testing_op_finish(fsi, SSDFS_XATTR_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_DELETE_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to delete extended attribute: "
 				  "err %d\n", err);
@@ -3387,6 +3686,7 @@ int ssdfs_do_shextree_testing(struct ssdfs_fs_info *fsi,
 	u64 threshold = env->shextree.extents_number_threshold;
 	u64 per_1_percent = 0;
 	u64 message_threshold = 0;
+	ktime_t start;
 	u64 i;
 	int err = 0;
 
@@ -3406,7 +3706,10 @@ int ssdfs_do_shextree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_shextree_add(fsi, env, i + 1);
+		ssdfs_testing_op_finish(fsi, SSDFS_SHEXTREE_TESTING_ID,
+					SSDFS_BENCHMARK_ADD_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to add shared extent: "
 				  "err %d\n", err);
@@ -3429,7 +3732,10 @@ int ssdfs_do_shextree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_shextree_check(fsi, env, i + 1);
+		ssdfs_testing_op_finish(fsi, SSDFS_SHEXTREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to check shared extent: "
 				  "err %d\n", err);
@@ -3452,7 +3758,10 @@ int ssdfs_do_shextree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_shextree_change(fsi, env, i + 1);
+		ssdfs_testing_op_finish(fsi, SSDFS_SHEXTREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHANGE_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to change shared extent: "
 				  "err %d\n", err);
@@ -3475,7 +3784,10 @@ int ssdfs_do_shextree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_shextree_inc_ref_count(fsi, env, i + 1);
+		ssdfs_testing_op_finish(fsi, SSDFS_SHEXTREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHANGE_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to increment reference count: "
 				  "err %d\n", err);
@@ -3498,14 +3810,20 @@ int ssdfs_do_shextree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_shextree_dec_ref_count(fsi, env, i + 1);
+		ssdfs_testing_op_finish(fsi, SSDFS_SHEXTREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHANGE_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to decrement reference count: "
 				  "err %d\n", err);
 			return err;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_shextree_dec_ref_count(fsi, env, i + 1);
+		ssdfs_testing_op_finish(fsi, SSDFS_SHEXTREE_TESTING_ID,
+					SSDFS_BENCHMARK_CHANGE_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to decrement reference count: "
 				  "err %d\n", err);
@@ -3542,7 +3860,10 @@ int ssdfs_do_shextree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_shextree_delete(fsi, env, i + 1);
+		ssdfs_testing_op_finish(fsi, SSDFS_SHEXTREE_TESTING_ID,
+					SSDFS_BENCHMARK_DELETE_PHASE, start);
 		if (err == -ENOENT) {
 			err = 0;
 			SSDFS_DBG("tree is empty\n");
@@ -3858,6 +4179,7 @@ int ssdfs_traverse_snapshots_tree(struct ssdfs_fs_info *fsi,
 				  u64 per_1_percent,
 				  u64 message_threshold,
 				  const char *message_string,
+				  int phase,
 				  ssdfs_snapshot_testfn execute_test)
 {
 	struct ssdfs_btree_search *search;
@@ -3866,6 +4188,7 @@ int ssdfs_traverse_snapshots_tree(struct ssdfs_fs_info *fsi,
 	u64 end_hash = U64_MAX;
 	u64 create_time = U64_MAX;
 	u16 items_count;
+	ktime_t start;
 	u64 i, j;
 	int err = 0;
 
@@ -3982,7 +4305,11 @@ finish_tree_processing:
 				message_threshold += per_1_percent;
 			}
 
+			start = ssdfs_testing_op_start(fsi);
 			err = execute_test(fsi, env, create_time, i + 1);
+			ssdfs_testing_op_finish(fsi,
+						SSDFS_SNAPSHOTS_TREE_TESTING_ID,
+						phase, start);
 			if (err) {
 				SSDFS_ERR("fail to check snapshot: "
 					  "err %d\n", err);
@@ -4037,6 +4364,7 @@ int ssdfs_do_snapshots_tree_testing(struct ssdfs_fs_info *fsi,
 	u64 threshold = env->snapshots_tree.snapshots_number_threshold;
 	u64 per_1_percent = 0;
 	u64 message_threshold = 0;
+	ktime_t start;
 	u64 i;
 	int err = 0;
 
@@ -4056,7 +4384,10 @@ int ssdfs_do_snapshots_tree_testing(struct ssdfs_fs_info *fsi,
 			message_threshold += per_1_percent;
 		}
 
+		start = ssdfs_testing_op_start(fsi);
 		err = ssdfs_testing_snapshots_tree_add(fsi, env, i + 1);
+		ssdfs_testing_op_finish(fsi, SSDFS_SNAPSHOTS_TREE_TESTING_ID,
+					SSDFS_BENCHMARK_ADD_PHASE, start);
 		if (err) {
 			SSDFS_ERR("fail to add snapshot: "
 				  "err %d\n", err);
@@ -4074,6 +4405,7 @@ int ssdfs_do_snapshots_tree_testing(struct ssdfs_fs_info *fsi,
 	err = ssdfs_traverse_snapshots_tree(fsi, env, per_1_percent,
 					    message_threshold,
 					    "CHECK SNAPSHOTs",
+					    SSDFS_BENCHMARK_CHECK_PHASE,
 					    ssdfs_testing_snapshots_tree_check);
 	if (err) {
 		SSDFS_ERR("fail to check snapshot: err %d\n",
@@ -4091,6 +4423,7 @@ int ssdfs_do_snapshots_tree_testing(struct ssdfs_fs_info *fsi,
 	err = ssdfs_traverse_snapshots_tree(fsi, env, per_1_percent,
 					    message_threshold,
 					    "CHANGE SNAPSHOTs",
+					    SSDFS_BENCHMARK_CHANGE_PHASE,
 					    ssdfs_testing_snapshots_tree_change);
 	if (err) {
 		SSDFS_ERR("fail to change snapshot: err %d\n",
@@ -4122,6 +4455,7 @@ int ssdfs_do_snapshots_tree_testing(struct ssdfs_fs_info *fsi,
 	err = ssdfs_traverse_snapshots_tree(fsi, env, per_1_percent,
 					    message_threshold,
 					    "DELETE SNAPSHOTs",
+					    SSDFS_BENCHMARK_DELETE_PHASE,
 					    ssdfs_testing_snapshots_tree_delete);
 	if (err == -ENOENT) {
 		err = 0;
@@ -4138,131 +4472,1445 @@ int ssdfs_do_snapshots_tree_testing(struct ssdfs_fs_info *fsi,
 	return err;
 }
 
-int ssdfs_do_testing(struct ssdfs_fs_info *fsi,
-		     struct ssdfs_testing_environment *env)
+/*
+ * struct ssdfs_compression_testing_stats - compressor's testing results
+ * @blocks: number of processed blocks
+ * @incompressible: number of blocks that compressor was unable to compress
+ * @in_bytes: number of bytes before compression
+ * @out_bytes: number of bytes after compression
+ * @compress_nsecs: total time of compression in nanoseconds
+ * @decompress_nsecs: total time of decompression in nanoseconds
+ * @decompressed_bytes: number of decompressed bytes
+ */
+struct ssdfs_compression_testing_stats {
+	u64 blocks;
+	u64 incompressible;
+	u64 in_bytes;
+	u64 out_bytes;
+	u64 compress_nsecs;
+	u64 decompress_nsecs;
+	u64 decompressed_bytes;
+};
+
+/*
+ * ssdfs_testing_read_file_block() - read block of file's content
+ * @inode: file's inode
+ * @pos: offset in bytes inside the file
+ * @buf: buffer for the block [out]
+ * @len: length of the block in bytes
+ */
+static
+int ssdfs_testing_read_file_block(struct inode *inode, loff_t pos,
+				  unsigned char *buf, u32 len)
 {
-	int err = 0;
+	struct page *page;
+	u32 copied = 0;
+	u32 offset;
+	u32 size;
+
+	while (copied < len) {
+		page = read_mapping_page(inode->i_mapping,
+					 pos >> PAGE_SHIFT, NULL);
+		if (IS_ERR(page)) {
+			SSDFS_ERR("fail to read page: "
+				  "ino %lu, pos %lld, err %ld\n",
+				  inode->i_ino, pos, PTR_ERR(page));
+			return PTR_ERR(page);
+		}
 
-	SSDFS_ERR("TESTING STARTING...\n");
+		offset = pos & ~PAGE_MASK;
+		size = min_t(u32, len - copied, PAGE_SIZE - offset);
+		memcpy_from_page(buf + copied, page, offset, size);
+		put_page(page);
 
-	err = ssdfs_testing_get_inode(fsi);
-	if (unlikely(err)) {
-		SSDFS_ERR("fail to create testing inode: "
-			  "err %d\n", err);
-		goto finish_testing;
+		copied += size;
+		pos += size;
 	}
 
-	ssdfs_testing_mapping_init(&fsi->testing_pages,
-				   fsi->testing_inode);
+	return 0;
+}
 
-	if (env->subsystems & SSDFS_ENABLE_EXTENTS_TREE_TESTING) {
-		SSDFS_ERR("START EXTENTS TREE TESTING...\n");
+/*
+ * ssdfs_testing_prepare_compr_block() - prepare block for compression
+ * @env: testing environment
+ * @inode: file with real data (NULL - synthetic data)
+ * @file_length: length of file's range in bytes
+ * @index: index of the block
+ * @buf: buffer for the block [out]
+ * @len: length of the block in bytes
+ *
+ * The synthetic block is generated by the pattern. The first
+ * @entropy_percent bytes of every 100 bytes are replaced by
+ * random values. The real data are read from the file's range
+ * with the wrapping at the end of the range.
+ */
+static
+int ssdfs_testing_prepare_compr_block(struct ssdfs_testing_environment *env,
+				      struct inode *inode, u64 file_length,
+				      u64 index, unsigned char *buf, u32 len)
+{
+	u32 random_bytes = env->compression.entropy_percent;
+	u64 offset;
+	u32 i;
 
-		err = ssdfs_do_extents_tree_testing(fsi, env);
-		if (err)
-			goto free_inode;
+	if (inode) {
+		div64_u64_rem(index * len, file_length - len + 1, &offset);
+		offset += env->compression.file_offset;
 
-		SSDFS_ERR("EXTENTS TREE TESTING FINISHED\n");
+		return ssdfs_testing_read_file_block(inode, offset, buf, len);
 	}
 
-	if (env->subsystems & SSDFS_ENABLE_DENTRIES_TREE_TESTING) {
-		SSDFS_ERR("START DENTRIES TREE TESTING...\n");
-
-		err = ssdfs_do_dentries_tree_testing(fsi, env);
-		if (err)
-			goto free_inode;
+	ssdfs_testing_generate_blob(buf, len, env->compression.blob_pattern);
 
-		SSDFS_ERR("DENTRIES TREE TESTING FINISHED\n");
+	for (i = 0; i < len && random_bytes > 0; i += 100) {
+		get_random_bytes(buf + i,
+				 min_t(u32, len - i, random_bytes));
 	}
 
-	if (env->subsystems & SSDFS_ENABLE_BLOCK_BMAP_TESTING) {
-		SSDFS_ERR("START BLOCK BITMAP TESTING...\n");
+	return 0;
+}
 
-		err = ssdfs_do_block_bitmap_testing(fsi, env);
-		if (err)
-			goto free_inode;
+/*
+ * ssdfs_testing_throughput() - calculate throughput in MB/s
+ * @bytes: number of processed bytes
+ * @nsecs: time of processing in nanoseconds
+ */
+static inline
+u64 ssdfs_testing_throughput(u64 bytes, u64 nsecs)
+{
+	if (nsecs == 0)
+		return 0;
 
-		SSDFS_ERR("BLOCK BITMAP TESTING FINISHED\n");
-	}
+	return mul_u64_u64_div_u64(bytes, NSEC_PER_SEC, nsecs) >> 20;
+}
 
-	if (env->subsystems & SSDFS_ENABLE_BLK2OFF_TABLE_TESTING) {
-		SSDFS_ERR("START BLK2OFF TABLE TESTING...\n");
+/*
+ * ssdfs_testing_compressor() - test one compressor
+ * @fsi: pointer on shared file system object
+ * @env: testing environment
+ * @type: compression type
+ * @inode: file with real data (NULL - synthetic data)
+ * @file_length: length of file's range in bytes
+ * @buf: buffers for source, compressed and decompressed blocks
+ * @len: length of the block in bytes
+ */
+static
+int ssdfs_testing_compressor(struct ssdfs_fs_info *fsi,
+			     struct ssdfs_testing_environment *env,
+			     int type, struct inode *inode, u64 file_length,
+			     unsigned char *buf, u32 len)
+{
+	struct ssdfs_compression_testing_stats stats = {0};
+	unsigned char *data = buf;
+	unsigned char *cdata = buf + len;
+	unsigned char *ddata = buf + (2 * len);
+	size_t srclen, destlen;
+	u64 waits;
+	u64 ratio = 0;
+	u32 remainder = 0;
+	ktime_t start, op_start;
+	u64 i;
+	int err = 0;
 
-		err = ssdfs_do_blk2off_table_testing(fsi, env);
-		if (err)
-			goto free_inode;
+	waits = ssdfs_compr_workspace_waits(type);
 
-		SSDFS_ERR("BLK2OFF TABLE TESTING FINISHED\n");
-	}
+	for (i = 0; i < env->compression.iterations_number; i++) {
+		err = ssdfs_testing_prepare_compr_block(env, inode,
+							file_length, i,
+							data, len);
+		if (unlikely(err))
+			return err;
 
-	if (env->subsystems & SSDFS_ENABLE_PEB_MAPPING_TABLE_TESTING) {
-		SSDFS_ERR("START PEB MAPPING TABLE TESTING...\n");
+		srclen = len;
+		destlen = len;
 
-		err = ssdfs_do_peb_mapping_table_testing(fsi, env);
-		if (err)
-			goto free_inode;
+		op_start = ssdfs_testing_op_start(fsi);
+		start = ktime_get();
+		err = ssdfs_compress(type, data, cdata, &srclen, &destlen);
+		stats.compress_nsecs += ktime_to_ns(ktime_sub(ktime_get(),
+							      start));
+		ssdfs_testing_op_finish(fsi, SSDFS_COMPRESSION_TESTING_ID,
+					SSDFS_BENCHMARK_ADD_PHASE, op_start);
 
-		SSDFS_ERR("PEB MAPPING TABLE TESTING FINISHED\n");
-	}
+		stats.blocks++;
+		stats.in_bytes += len;
 
-	if (env->subsystems & SSDFS_ENABLE_SEGMENT_BITMAP_TESTING) {
-		SSDFS_ERR("START SEGMENT BITMAP TESTING...\n");
+		if (err == -E2BIG) {
+			/* block is stored without compression */
+			err = 0;
+			stats.incompressible++;
+			stats.out_bytes += len;
+			continue;
+		} else if (unlikely(err)) {
+			SSDFS_ERR("fail to compress: "
+				  "type %d, block %llu, err %d\n",
+				  type, i, err);
+			return err;
+		}
 
-		err = ssdfs_do_segment_bitmap_testing(fsi, env);
-		if (err)
-			goto free_inode;
+		stats.out_bytes += destlen;
 
-		SSDFS_ERR("SEGMENT BITMAP TESTING FINISHED\n");
+		memset(ddata, 0, len);
+
+		op_start = ssdfs_testing_op_start(fsi);
+		start = ktime_get();
+		err = ssdfs_decompress(type, cdata, ddata, destlen, len);
+		stats.decompress_nsecs += ktime_to_ns(ktime_sub(ktime_get(),
+								start));
+		ssdfs_testing_op_finish(fsi, SSDFS_COMPRESSION_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, op_start);
+
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to decompress: "
+				  "type %d, block %llu, err %d\n",
+				  type, i, err);
+			return err;
+		}
+
+		if (memcmp(data, ddata, len) != 0) {
+			SSDFS_ERR("corrupted decompressed data: "
+				  "type %d, block %llu\n",
+				  type, i);
+			return -EIO;
+		}
+
+		stats.decompressed_bytes += len;
 	}
 
-	if (env->subsystems & SSDFS_ENABLE_SHARED_DICTIONARY_TESTING) {
-		SSDFS_ERR("START SHARED DICTIONARY TESTING...\n");
+	waits = ssdfs_compr_workspace_waits(type) - waits;
 
-		err = ssdfs_do_shared_dictionary_testing(fsi, env);
-		if (err)
-			goto free_inode;
+	if (stats.out_bytes > 0) {
+		ratio = div64_u64(stats.in_bytes * 1000, stats.out_bytes);
+		ratio = div_u64_rem(ratio, 1000, &remainder);
+	}
 
-		SSDFS_ERR("SHARED DICTIONARY TESTING FINISHED\n");
+	SSDFS_ERR("COMPRESSOR %s: blocks %llu, incompressible %llu, "
+		  "in_bytes %llu, out_bytes %llu, ratio %llu.%03u, "
+		  "compress %llu MB/s, decompress %llu MB/s, "
+		  "workspace_waits %llu\n",
+		  ssdfs_compressors[type]->name,
+		  stats.blocks, stats.incompressible,
+		  stats.in_bytes, stats.out_bytes,
+		  ratio, remainder,
+		  ssdfs_testing_throughput(stats.in_bytes,
+					   stats.compress_nsecs),
+		  ssdfs_testing_throughput(stats.decompressed_bytes,
+					   stats.decompress_nsecs),
+		  waits);
+
+	return 0;
+}
+
+/*
+ * ssdfs_do_compression_testing() - test throughput and ratio of compressors
+ * @fsi: pointer on shared file system object
+ * @env: testing environment
+ *
+ * This method compresses and decompresses the synthetic blocks or
+ * the blocks of the file's range by every registered compressor.
+ * The throughput of compression and decompression, compression ratio
+ * and number of waits for free workspace are reported for
+ * every compressor.
+ */
+static
+int ssdfs_do_compression_testing(struct ssdfs_fs_info *fsi,
+				 struct ssdfs_testing_environment *env)
+{
+	struct inode *inode = NULL;
+	unsigned char *buf;
+	u64 file_length = 0;
+	u32 len = env->compression.block_size;
+	int type;
+	int err = 0;
+
+	if (len == 0 || len > PAGE_SIZE)
+		len = PAGE_SIZE;
+
+	if (env->compression.ino != 0) {
+		inode = ssdfs_iget(fsi->sb, env->compression.ino);
+		if (IS_ERR(inode)) {
+			SSDFS_ERR("fail to get inode: ino %llu\n",
+				  env->compression.ino);
+			return PTR_ERR(inode);
+		}
+
+		if (!S_ISREG(inode->i_mode) ||
+		    env->compression.file_offset >= i_size_read(inode)) {
+			err = -EINVAL;
+			SSDFS_ERR("invalid file range: "
+				  "ino %llu, offset %llu\n",
+				  env->compression.ino,
+				  env->compression.file_offset);
+			goto put_inode;
+		}
+
+		file_length = i_size_read(inode) -
+				env->compression.file_offset;
+		if (env->compression.file_length > 0) {
+			file_length = min_t(u64, file_length,
+					    env->compression.file_length);
+		}
+
+		if (file_length < len) {
+			err = -EINVAL;
+			SSDFS_ERR("file range %llu is shorter than block %u\n",
+				  file_length, len);
+			goto put_inode;
+		}
 	}
 
-	if (env->subsystems & SSDFS_ENABLE_XATTR_TREE_TESTING) {
-		SSDFS_ERR("START XATTR TREE TESTING...\n");
+	buf = kvzalloc(3 * len, GFP_KERNEL);
+	if (!buf) {
+		err = -ENOMEM;
+		SSDFS_ERR("fail to allocate buffers\n");
+		goto put_inode;
+	}
 
-		err = ssdfs_do_xattr_tree_testing(fsi, env);
-		if (err)
-			goto free_inode;
+	for (type = SSDFS_COMPR_NONE; type < SSDFS_COMPR_TYPES_CNT; type++) {
+		if (!ssdfs_compressors[type])
+			continue;
 
-		SSDFS_ERR("XATTR TREE TESTING FINISHED\n");
+		err = ssdfs_testing_compressor(fsi, env, type, inode,
+					       file_length, buf, len);
+		if (unlikely(err)) {
+			SSDFS_ERR("compressor testing failed: "
+				  "type %d, err %d\n",
+				  type, err);
+			break;
+		}
 	}
 
-	if (env->subsystems & SSDFS_ENABLE_SHEXTREE_TESTING) {
-		SSDFS_ERR("START SHARED EXTENTS TREE TESTING...\n");
+	kvfree(buf);
 
-		err = ssdfs_do_shextree_testing(fsi, env);
-		if (err)
-			goto free_inode;
+put_inode:
+	if (inode)
+		iput(inode);
 
-		SSDFS_ERR("SHARED EXTENTS TREE TESTING FINISHED\n");
+	return err;
+}
+
+/*
+ * struct ssdfs_write_replay_stats - write replay testing results
+ * @added_blks: number of new blocks
+ * @updated_blks: number of updated blocks
+ * @fsyncs: number of logs' commits
+ * @write_histogram: log2 histogram of write requests' latency
+ * @fsync_histogram: log2 histogram of logs' commits latency
+ */
+struct ssdfs_write_replay_stats {
+	u64 added_blks;
+	u64 updated_blks;
+	u64 fsyncs;
+	u64 write_histogram[SSDFS_BENCHMARK_LATENCY_BUCKETS];
+	u64 fsync_histogram[SSDFS_BENCHMARK_LATENCY_BUCKETS];
+};
+
+/*
+ * ssdfs_testing_account_latency() - account latency in log2 histogram
+ * @histogram: log2 histogram of latency
+ * @start: timestamp of operation's start
+ */
+static inline
+void ssdfs_testing_account_latency(u64 *histogram, ktime_t start)
+{
+	s64 nsecs = ktime_to_ns(ktime_sub(ktime_get(), start));
+	int bucket = 0;
+
+	if (nsecs > 1) {
+		bucket = ilog2(nsecs);
+		bucket = min_t(int, bucket,
+				SSDFS_BENCHMARK_LATENCY_BUCKETS - 1);
 	}
 
-	if (env->subsystems & SSDFS_ENABLE_SNAPSHOTS_TREE_TESTING) {
-		SSDFS_ERR("START SNAPSHOTS TREE TESTING...\n");
+	histogram[bucket]++;
+}
 
-		err = ssdfs_do_snapshots_tree_testing(fsi, env);
-		if (err)
-			goto free_inode;
+/*
+ * ssdfs_write_replay_next_block() - select logical block for writing
+ * @env: testing environment
+ * @op_index: index of operation
+ *
+ * The zipfian pattern is approximated by log-uniform distribution:
+ * the power of two range is selected uniformly and the block is
+ * selected uniformly inside of the range. It gives the probability
+ * of block's selection that is inversely proportional to its number.
+ */
+static
+u64 ssdfs_write_replay_next_block(struct ssdfs_testing_environment *env,
+				  u64 op_index)
+{
+	u32 file_blocks = env->write_replay.file_blocks;
+	u32 order;
+	u64 blk;
 
-		SSDFS_ERR("SNAPSHOTS TREE TESTING FINISHED\n");
+	switch (env->write_replay.pattern) {
+	case SSDFS_WRITE_REPLAY_RANDOM:
+		return get_random_u32() % file_blocks;
+
+	case SSDFS_WRITE_REPLAY_ZIPFIAN:
+		order = get_random_u32() % (ilog2(file_blocks) + 1);
+		blk = (1ULL << order) + (get_random_u32() % (1U << order));
+		return (blk - 1) % file_blocks;
+
+	default:
+		/* sequential pattern */
+		break;
 	}
 
-free_inode:
-	iput(fsi->testing_inode);
+	return do_div(op_index, file_blocks);
+}
 
-finish_testing:
-	if (err)
-		SSDFS_ERR("TESTING FAILED\n");
-	else
-		SSDFS_ERR("TESTING FINISHED\n");
+/*
+ * ssdfs_write_replay_update_block() - issue update request of the block
+ * @fsi: pointer on shared file system object
+ * @inode: testing inode
+ * @pool: segment request pool
+ * @batch: dirty pages batch
+ *
+ * The segment of updated block is stored into the commit queue
+ * of the extents tree. It will be committed by the fsync's emulation.
+ */
+static
+int ssdfs_write_replay_update_block(struct ssdfs_fs_info *fsi,
+				    struct inode *inode,
+				    struct ssdfs_segment_request_pool *pool,
+				    struct ssdfs_dirty_pages_batch *batch)
+{
+	struct ssdfs_extents_btree_info *etree = SSDFS_EXTREE(SSDFS_I(inode));
+	struct ssdfs_segment_info *si;
+	u64 seg_id;
+	int err;
+
+	err = __ssdfs_prepare_volume_extent(fsi, inode,
+					    &batch->requested_extent,
+					    &batch->place);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to prepare volume extent: "
+			  "logical_offset %llu, err %d\n",
+			  batch->requested_extent.logical_offset, err);
+		return err;
+	}
+
+	seg_id = batch->place.start.seg_id;
+
+	si = ssdfs_grab_segment(fsi, SSDFS_USER_DATA_SEG_TYPE,
+				seg_id, U64_MAX);
+	if (unlikely(IS_ERR_OR_NULL(si))) {
+		SSDFS_ERR("fail to grab segment object: "
+			  "seg %llu\n", seg_id);
+		return !si ? -ERANGE : PTR_ERR(si);
+	}
+
+	err = ssdfs_segment_update_data_block_async(si, SSDFS_REQ_ASYNC,
+						    pool, batch);
+	ssdfs_segment_put_object(si);
+
+	if (err)
+		return err;
+
+	down_write(&etree->lock);
+	err = ssdfs_extents_tree_add_updated_seg_id(etree, seg_id);
+	up_write(&etree->lock);
+
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to add updated segment in queue: "
+			  "seg_id %llu, err %d\n",
+			  seg_id, err);
+	}
+
+	return err;
+}
+
+/*
+ * ssdfs_write_replay_issue_block() - issue write request for the block
+ * @fsi: pointer on shared file system object
+ * @inode: testing inode
+ * @pool: segment request pool
+ * @batch: dirty pages batch
+ * @is_new: is block absent in the extents tree?
+ *
+ * This method sends the add or update request of one block into
+ * the segment layer directly. The request is processed
+ * asynchronously, the page is unlocked by the request's end.
+ */
+static
+int ssdfs_write_replay_issue_block(struct ssdfs_fs_info *fsi,
+				   struct inode *inode,
+				   struct ssdfs_segment_request_pool *pool,
+				   struct ssdfs_dirty_pages_batch *batch,
+				   bool is_new)
+{
+	int err;
+
+	do {
+		if (is_new) {
+			err = ssdfs_segment_add_data_extent_async(fsi, pool,
+								  batch);
+		} else {
+			err = ssdfs_write_replay_update_block(fsi, inode,
+							      pool, batch);
+		}
+
+		if (err == -EAGAIN) {
+			/* async requests are freed by flush thread */
+			ssdfs_segment_request_pool_init(pool);
+		}
+	} while (err == -EAGAIN);
+
+	return err;
+}
+
+/*
+ * ssdfs_write_replay_write_block() - write one logical block
+ * @fsi: pointer on shared file system object
+ * @inode: testing inode
+ * @pool: segment request pool
+ * @blk: logical block
+ * @stats: write replay results [out]
+ */
+static
+int ssdfs_write_replay_write_block(struct ssdfs_fs_info *fsi,
+				   struct inode *inode,
+				   struct ssdfs_segment_request_pool *pool,
+				   u64 blk,
+				   struct ssdfs_write_replay_stats *stats)
+{
+	struct ssdfs_dirty_pages_batch batch;
+	struct page *page;
+	void *kaddr;
+	u64 logical_offset = blk << PAGE_SHIFT;
+	bool is_new;
+	ktime_t start;
+	int err;
+
+	page = find_or_create_page(inode->i_mapping, blk, GFP_KERNEL);
+	if (!page) {
+		SSDFS_ERR("fail to grab page: blk %llu\n", blk);
+		return -ENOMEM;
+	}
+
+	/* previous request of the block could be in progress yet */
+	wait_on_page_writeback(page);
+
+	kaddr = kmap_local_page(page);
+	ssdfs_testing_generate_blob(kaddr, PAGE_SIZE,
+				    stats->added_blks + stats->updated_blks);
+	flush_dcache_page(page);
+	kunmap_local(kaddr);
+
+	SetPageUptodate(page);
+
+	is_new = !ssdfs_extents_tree_has_logical_block(blk, inode);
+	if (is_new)
+		set_page_new(page);
+
+	ssdfs_dirty_pages_batch_init(&batch);
+
+	err = ssdfs_dirty_pages_batch_add_page(page, &batch);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to add page into batch: "
+			  "blk %llu, err %d\n", blk, err);
+		goto unlock_page;
+	}
+
+	ssdfs_dirty_pages_batch_prepare_logical_extent(inode->i_ino,
+							logical_offset,
+							PAGE_SIZE, 0, 0,
+							&batch);
+
+	set_page_writeback(page);
+	ssdfs_clear_dirty_page(page);
+
+	start = ktime_get();
+	err = ssdfs_write_replay_issue_block(fsi, inode, pool,
+					     &batch, is_new);
+	ssdfs_testing_account_latency(stats->write_histogram, start);
+
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to issue write request: "
+			  "blk %llu, is_new %#x, err %d\n",
+			  blk, is_new, err);
+		end_page_writeback(page);
+		goto unlock_page;
+	}
+
+	if (is_new) {
+		stats->added_blks++;
+
+		if (logical_offset + PAGE_SIZE > i_size_read(inode))
+			i_size_write(inode, logical_offset + PAGE_SIZE);
+	} else
+		stats->updated_blks++;
+
+	/* page will be unlocked by the end of request */
+	put_page(page);
+	return 0;
+
+unlock_page:
+	unlock_page(page);
+	put_page(page);
+	return err;
+}
+
+/*
+ * ssdfs_write_replay_fsync() - wait requests and commit logs
+ * @fsi: pointer on shared file system object
+ * @inode: testing inode
+ * @stats: write replay results [out]
+ *
+ * This method emulates the fsync(): it waits the end of write
+ * requests and commits the logs of the segments that have received
+ * the new or updated blocks of the testing inode.
+ */
+static
+int ssdfs_write_replay_fsync(struct ssdfs_fs_info *fsi,
+			     struct inode *inode,
+			     struct ssdfs_write_replay_stats *stats)
+{
+	ktime_t start = ktime_get();
+	int err;
+
+	err = filemap_fdatawait_range(inode->i_mapping, 0, LLONG_MAX);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to wait write requests: err %d\n", err);
+		return err;
+	}
+
+	err = ssdfs_extents_tree_commit_updated_segs(SSDFS_I(inode));
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to commit updated segments: err %d\n", err);
+		return err;
+	}
+
+	ssdfs_testing_account_latency(stats->fsync_histogram, start);
+	stats->fsyncs++;
+
+	return 0;
+}
+
+/*
+ * ssdfs_do_write_replay_testing() - replay write workload by segment layer
+ * @fsi: pointer on shared file system object
+ * @env: testing environment
+ *
+ * This method writes the blocks of the testing inode by means of
+ * the segment layer's requests directly (without VFS and page cache
+ * writeback). The offsets of blocks are defined by the sequential,
+ * random or zipfian pattern in the range of the file's size. The logs
+ * are committed every @fsync_interval blocks. The throughput, latency
+ * percentiles of write requests and logs' commits, and the volume of
+ * device writes are reported.
+ */
+static
+int ssdfs_do_write_replay_testing(struct ssdfs_fs_info *fsi,
+				  struct ssdfs_testing_environment *env)
+{
+	struct ssdfs_write_replay_testing *replay = &env->write_replay;
+	struct ssdfs_write_replay_stats *stats;
+	struct ssdfs_segment_request_pool pool;
+	struct inode *inode = fsi->testing_inode;
+	struct ssdfs_inode_info *ii = SSDFS_I(inode);
+	u64 device_bytes;
+	u64 nsecs;
+	u64 written_bytes;
+	ktime_t start;
+	u32 unsynced = 0;
+	u64 blk;
+	u64 i;
+	int err, res;
+
+	if (fsi->pagesize != PAGE_SIZE) {
+		SSDFS_ERR("unsupported logical block size %u\n",
+			  fsi->pagesize);
+		return -EOPNOTSUPP;
+	}
+
+	if (replay->file_blocks == 0 ||
+	    replay->pattern >= SSDFS_WRITE_REPLAY_PATTERN_MAX) {
+		SSDFS_ERR("invalid environment: "
+			  "pattern %u, file_blocks %u\n",
+			  replay->pattern, replay->file_blocks);
+		return -EINVAL;
+	}
+
+	stats = kzalloc(sizeof(struct ssdfs_write_replay_stats), GFP_KERNEL);
+	if (!stats) {
+		SSDFS_ERR("fail to allocate statistics\n");
+		return -ENOMEM;
+	}
+
+	down_write(&ii->lock);
+	err = ssdfs_extents_tree_create(fsi, ii);
+	up_write(&ii->lock);
+
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to create the extents tree: "
+			  "err %d\n", err);
+		goto free_stats;
+	}
+
+	ssdfs_segment_request_pool_init(&pool);
+
+	device_bytes =
+		atomic64_read(&fsi->wa_stats.bytes[SSDFS_WA_DEVICE_WRITES]);
+	start = ktime_get();
+
+	for (i = 0; i < replay->ops_number; i++) {
+		ktime_t op_start = ssdfs_testing_op_start(fsi);
+
+		blk = ssdfs_write_replay_next_block(env, i);
+
+		err = ssdfs_write_replay_write_block(fsi, inode, &pool,
+						     blk, stats);
+		ssdfs_testing_op_finish(fsi, SSDFS_WRITE_REPLAY_TESTING_ID,
+					SSDFS_BENCHMARK_ADD_PHASE, op_start);
+		if (unlikely(err)) {
+			SSDFS_ERR("fail to write block: "
+				  "op %llu, blk %llu, err %d\n",
+				  i, blk, err);
+			goto truncate_file;
+		}
+
+		unsynced++;
+
+		if (replay->fsync_interval > 0 &&
+		    unsynced >= replay->fsync_interval) {
+			unsynced = 0;
+			op_start = ssdfs_testing_op_start(fsi);
+			err = ssdfs_write_replay_fsync(fsi, inode, stats);
+			ssdfs_testing_op_finish(fsi,
+					SSDFS_WRITE_REPLAY_TESTING_ID,
+					SSDFS_BENCHMARK_CHECK_PHASE, op_start);
+			if (unlikely(err))
+				goto truncate_file;
+		}
+	}
+
+	err = ssdfs_write_replay_fsync(fsi, inode, stats);
+	if (unlikely(err))
+		goto truncate_file;
+
+	nsecs = ktime_to_ns(ktime_sub(ktime_get(), start));
+	device_bytes =
+		atomic64_read(&fsi->wa_stats.bytes[SSDFS_WA_DEVICE_WRITES]) -
+			device_bytes;
+	written_bytes = (stats->added_blks + stats->updated_blks) << PAGE_SHIFT;
+
+	SSDFS_ERR("WRITE REPLAY: pattern %u, added_blks %llu, "
+		  "updated_blks %llu, fsyncs %llu, nsecs %llu, "
+		  "throughput %llu MB/s, device_bytes %llu\n",
+		  replay->pattern, stats->added_blks, stats->updated_blks,
+		  stats->fsyncs, nsecs,
+		  ssdfs_testing_throughput(written_bytes, nsecs),
+		  device_bytes);
+	SSDFS_ERR("WRITE REPLAY: write p50 %llu ns, p99 %llu ns, "
+		  "fsync p50 %llu ns, p99 %llu ns\n",
+		  ssdfs_testing_latency_percentile(stats->write_histogram,
+						   replay->ops_number, 50),
+		  ssdfs_testing_latency_percentile(stats->write_histogram,
+						   replay->ops_number, 99),
+		  ssdfs_testing_latency_percentile(stats->fsync_histogram,
+						   stats->fsyncs, 50),
+		  ssdfs_testing_latency_percentile(stats->fsync_histogram,
+						   stats->fsyncs, 99));
+
+truncate_file:
+	res = filemap_fdatawait_range(inode->i_mapping, 0, LLONG_MAX);
+	if (unlikely(res))
+		SSDFS_ERR("fail to wait write requests: err %d\n", res);
+
+	truncate_setsize(inode, 0);
+
+	down_write(&ii->lock);
+	res = ssdfs_extents_tree_truncate(inode);
+	up_write(&ii->lock);
+
+	if (unlikely(res)) {
+		SSDFS_ERR("fail to truncate file: err %d\n", res);
+		if (!err)
+			err = res;
+	}
+
+	ssdfs_extents_tree_destroy(ii);
+
+free_stats:
+	kfree(stats);
+	return err;
+}
+
+int ssdfs_do_testing(struct ssdfs_fs_info *fsi,
+		     struct ssdfs_testing_environment *env)
+{
+	int err = 0;
+
+	SSDFS_ERR("TESTING STARTING...\n");
+
+	err = ssdfs_testing_get_inode(fsi);
+	if (unlikely(err)) {
+		SSDFS_ERR("fail to create testing inode: "
+			  "err %d\n", err);
+		goto finish_testing;
+	}
+
+	ssdfs_testing_mapping_init(&fsi->testing_pages,
+				   fsi->testing_inode);
+
+	if (env->subsystems & SSDFS_ENABLE_EXTENTS_TREE_TESTING) {
+		SSDFS_ERR("START EXTENTS TREE TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_extents_tree_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_EXTENTS_TREE_TESTING_ID);
+
+		SSDFS_ERR("EXTENTS TREE TESTING FINISHED\n");
+	}
+
+	if (env->subsystems & SSDFS_ENABLE_DENTRIES_TREE_TESTING) {
+		SSDFS_ERR("START DENTRIES TREE TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_dentries_tree_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_DENTRIES_TREE_TESTING_ID);
+
+		SSDFS_ERR("DENTRIES TREE TESTING FINISHED\n");
+	}
+
+	if (env->subsystems & SSDFS_ENABLE_BLOCK_BMAP_TESTING) {
+		SSDFS_ERR("START BLOCK BITMAP TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_block_bitmap_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_BLOCK_BMAP_TESTING_ID);
+
+		SSDFS_ERR("BLOCK BITMAP TESTING FINISHED\n");
+	}
+
+	if (env->subsystems & SSDFS_ENABLE_BLK2OFF_TABLE_TESTING) {
+		SSDFS_ERR("START BLK2OFF TABLE TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_blk2off_table_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_BLK2OFF_TABLE_TESTING_ID);
+
+		SSDFS_ERR("BLK2OFF TABLE TESTING FINISHED\n");
+	}
+
+	if (env->subsystems & SSDFS_ENABLE_PEB_MAPPING_TABLE_TESTING) {
+		SSDFS_ERR("START PEB MAPPING TABLE TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_peb_mapping_table_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_PEB_MAPPING_TABLE_TESTING_ID);
+
+		SSDFS_ERR("PEB MAPPING TABLE TESTING FINISHED\n");
+	}
+
+	if (env->subsystems & SSDFS_ENABLE_SEGMENT_BITMAP_TESTING) {
+		SSDFS_ERR("START SEGMENT BITMAP TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_segment_bitmap_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_SEGMENT_BITMAP_TESTING_ID);
+
+		SSDFS_ERR("SEGMENT BITMAP TESTING FINISHED\n");
+	}
+
+	if (env->subsystems & SSDFS_ENABLE_SHARED_DICTIONARY_TESTING) {
+		SSDFS_ERR("START SHARED DICTIONARY TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_shared_dictionary_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_SHARED_DICTIONARY_TESTING_ID);
+
+		SSDFS_ERR("SHARED DICTIONARY TESTING FINISHED\n");
+	}
+
+	if (env->subsystems & SSDFS_ENABLE_XATTR_TREE_TESTING) {
+		SSDFS_ERR("START XATTR TREE TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_xattr_tree_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_XATTR_TREE_TESTING_ID);
+
+		SSDFS_ERR("XATTR TREE TESTING FINISHED\n");
+	}
+
+	if (env->subsystems & SSDFS_ENABLE_SHEXTREE_TESTING) {
+		SSDFS_ERR("START SHARED EXTENTS TREE TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_shextree_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_SHEXTREE_TESTING_ID);
+
+		SSDFS_ERR("SHARED EXTENTS TREE TESTING FINISHED\n");
+	}
+
+	if (env->subsystems & SSDFS_ENABLE_SNAPSHOTS_TREE_TESTING) {
+		SSDFS_ERR("START SNAPSHOTS TREE TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_snapshots_tree_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_SNAPSHOTS_TREE_TESTING_ID);
+
+		SSDFS_ERR("SNAPSHOTS TREE TESTING FINISHED\n");
+	}
+
+	if (env->subsystems & SSDFS_ENABLE_COMPRESSION_TESTING) {
+		SSDFS_ERR("START COMPRESSION TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_compression_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_COMPRESSION_TESTING_ID);
+
+		SSDFS_ERR("COMPRESSION TESTING FINISHED\n");
+	}
+
+	if (env->subsystems & SSDFS_ENABLE_WRITE_REPLAY_TESTING) {
+		SSDFS_ERR("START WRITE REPLAY TESTING...\n");
+
+		ssdfs_testing_subsystem_start(fsi);
+		err = ssdfs_do_write_replay_testing(fsi, env);
+		if (err)
+			goto free_inode;
+		ssdfs_testing_subsystem_finish(fsi,
+					SSDFS_WRITE_REPLAY_TESTING_ID);
+
+		SSDFS_ERR("WRITE REPLAY TESTING FINISHED\n");
+	}
+
+free_inode:
+	iput(fsi->testing_inode);
+
+finish_testing:
+	if (err)
+		SSDFS_ERR("TESTING FAILED\n");
+	else
+		SSDFS_ERR("TESTING FINISHED\n");
+
+	return err;
+}
+
+/*
+ * struct ssdfs_testing_worker - thread of scalability scenario
+ * @ctx: scalability scenario's context
+ * @task: thread's task
+ * @index: index of the thread
+ * @ops: number of executed operations
+ * @err: result of the thread's work
+ * @finished: signal of the work's end
+ */
+struct ssdfs_testing_worker {
+	struct ssdfs_testing_scalability *ctx;
+	struct task_struct *task;
+	u32 index;
+	u64 ops;
+	int err;
+	struct completion finished;
+};
+
+/*
+ * struct ssdfs_testing_scalability - context of scalability scenario
+ * @fsi: pointer on shared file system object
+ * @scenario: scenario type
+ * @threads: number of concurrent threads
+ * @total_ops: number of operations of all threads
+ * @root_i: root directory (dentries tree scenarios)
+ * @bmap: block bitmap (block bitmap scenario)
+ * @start: signal to start the work by all threads
+ * @workers: array of threads
+ */
+struct ssdfs_testing_scalability {
+	struct ssdfs_fs_info *fsi;
+	int scenario;
+	u32 threads;
+	u64 total_ops;
+	struct inode *root_i;
+	struct ssdfs_block_bmap *bmap;
+	struct completion start;
+	struct ssdfs_testing_worker workers[SSDFS_SCALABILITY_THREADS_MAX];
+};
+
+/*
+ * ssdfs_testing_scalability_op() - execute one operation of scenario
+ * @ctx: scalability scenario's context
+ * @op_index: index of operation
+ * @name_buf: buffer for the file name
+ */
+static
+int ssdfs_testing_scalability_op(struct ssdfs_testing_scalability *ctx,
+				 u64 op_index, unsigned char *name_buf)
+{
+	struct ssdfs_fs_info *fsi = ctx->fsi;
+	struct ssdfs_maptbl_peb_relation pebr;
+	struct ssdfs_block_bmap_range range;
+	struct completion *end;
+	u64 lebs_count;
+	u64 leb_id;
+	u32 len = 1;
+	int err;
+
+	switch (ctx->scenario) {
+	case SSDFS_SCALABILITY_DENTRIES_ADD:
+		/* VFS creates the file under exclusive lock of directory */
+		inode_lock(ctx->root_i);
+		err = ssdfs_testing_dentries_tree_add_file(fsi, ctx->root_i,
+							   op_index,
+							   name_buf);
+		inode_unlock(ctx->root_i);
+		break;
+
+	case SSDFS_SCALABILITY_DENTRIES_LOOKUP:
+		inode_lock_shared(ctx->root_i);
+		err = ssdfs_testing_dentries_tree_check_file(fsi, ctx->root_i,
+							     op_index,
+							     name_buf);
+		inode_unlock_shared(ctx->root_i);
+		break;
+
+	case SSDFS_SCALABILITY_BLOCK_BMAP_ALLOC:
+		err = ssdfs_block_bmap_lock(ctx->bmap);
+		if (unlikely(err))
+			break;
+
+		err = ssdfs_block_bmap_allocate(ctx->bmap, 0, &len, &range);
+		ssdfs_block_bmap_unlock(ctx->bmap);
+		break;
+
+	case SSDFS_SCALABILITY_MAPTBL_CONVERT:
+		lebs_count = max_t(u64, fsi->maptbl->lebs_count, 1);
+		div64_u64_rem(op_index, lebs_count, &leb_id);
+
+		err = ssdfs_maptbl_convert_leb2peb(fsi, leb_id,
+						   SSDFS_MAPTBL_DATA_PEB_TYPE,
+						   &pebr, &end);
+		if (err == -EAGAIN) {
+			err = SSDFS_WAIT_COMPLETION(end);
+			if (unlikely(err))
+				break;
+
+			err = ssdfs_maptbl_convert_leb2peb(fsi, leb_id,
+						SSDFS_MAPTBL_DATA_PEB_TYPE,
+						&pebr, &end);
+		}
+
+		if (err == -ENODATA)
+			err = 0;
+		break;
+
+	default:
+		BUG();
+	}
+
+	return err;
+}
+
+/*
+ * ssdfs_testing_worker_func() - thread function of scalability scenario
+ * @data: pointer on worker object
+ */
+static
+int ssdfs_testing_worker_func(void *data)
+{
+	struct ssdfs_testing_worker *worker = data;
+	struct ssdfs_testing_scalability *ctx = worker->ctx;
+	unsigned char name[SSDFS_DENTRY_INLINE_NAME_MAX_LEN];
+	u64 per_thread = div_u64(ctx->total_ops, ctx->threads);
+	u64 first = per_thread * worker->index;
+	u64 last = first + per_thread;
+	u64 i;
+
+	if (worker->index == (ctx->threads - 1))
+		last = ctx->total_ops;
+
+	wait_for_completion(&ctx->start);
+
+	for (i = first; i < last; i++) {
+		worker->err = ssdfs_testing_scalability_op(ctx, i, name);
+		if (unlikely(worker->err)) {
+			SSDFS_ERR("operation failed: "
+				  "scenario %d, thread %u, op %llu, err %d\n",
+				  ctx->scenario, worker->index, i,
+				  worker->err);
+			break;
+		}
+
+		worker->ops++;
+	}
+
+	complete(&worker->finished);
+
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return worker->err;
+}
+
+/*
+ * ssdfs_testing_run_scalability() - execute scenario by several threads
+ * @ctx: scalability scenario's context
+ * @result: result of scenario [out]
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to create a thread.
+ */
+static
+int ssdfs_testing_run_scalability(struct ssdfs_testing_scalability *ctx,
+				  struct ssdfs_scalability_result *result)
+{
+	struct ssdfs_testing_worker *worker;
+	ktime_t start;
+	u32 created;
+	u32 i;
+	int err = 0;
+
+	init_completion(&ctx->start);
+
+	for (created = 0; created < ctx->threads; created++) {
+		worker = &ctx->workers[created];
+
+		memset(worker, 0, sizeof(struct ssdfs_testing_worker));
+		worker->ctx = ctx;
+		worker->index = created;
+		init_completion(&worker->finished);
+
+		worker->task = kthread_create(ssdfs_testing_worker_func,
+					      worker, "ssdfs-bench/%u",
+					      created);
+		if (IS_ERR(worker->task)) {
+			err = PTR_ERR(worker->task);
+			SSDFS_ERR("fail to create thread: "
+				  "index %u, err %d\n",
+				  created, err);
+			goto stop_threads;
+		}
+	}
+
+	for (i = 0; i < ctx->threads; i++)
+		wake_up_process(ctx->workers[i].task);
+
+	start = ktime_get();
+	complete_all(&ctx->start);
+
+	for (i = 0; i < ctx->threads; i++)
+		wait_for_completion(&ctx->workers[i].finished);
+
+	result->nsecs = ktime_to_ns(ktime_sub(ktime_get(), start));
+	result->threads = ctx->threads;
+
+	for (i = 0; i < ctx->threads; i++) {
+		result->ops += ctx->workers[i].ops;
+
+		if (!err)
+			err = ctx->workers[i].err;
+	}
+
+	if (result->nsecs > 0) {
+		result->ops_per_sec = div64_u64(result->ops * NSEC_PER_SEC,
+						result->nsecs);
+	}
+
+	SSDFS_ERR("SCALABILITY: scenario %d, threads %u, ops %llu, "
+		  "ops_per_sec %llu\n",
+		  ctx->scenario, result->threads, result->ops,
+		  result->ops_per_sec);
+
+stop_threads:
+	/* never woken thread is stopped without execution */
+	for (i = 0; i < created; i++)
+		kthread_stop(ctx->workers[i].task);
+
+	return err;
+}
+
+/*
+ * ssdfs_scale_dentries_tree() - concurrent dentries scenarios
+ * @ctx: scalability scenario's context
+ * @benv: benchmark environment [in|out]
+ * @step: index of threads number's step
+ */
+static
+int ssdfs_scale_dentries_tree(struct ssdfs_testing_scalability *ctx,
+			      struct ssdfs_benchmark_environment *benv,
+			      int step)
+{
+	struct ssdfs_fs_info *fsi = ctx->fsi;
+	struct ssdfs_testing_environment *env = &benv->env;
+	struct ssdfs_scalability_result *add, *lookup;
+	unsigned char name[SSDFS_DENTRY_INLINE_NAME_MAX_LEN];
+	u64 file_index;
+	int err;
+
+	ctx->root_i = ssdfs_iget(fsi->sb, SSDFS_ROOT_INO);
+	if (IS_ERR(ctx->root_i)) {
+		SSDFS_ERR("getting root inode failed\n");
+		return PTR_ERR(ctx->root_i);
+	}
+
+	add = &benv->scalability[SSDFS_SCALABILITY_DENTRIES_ADD][step];
+	lookup = &benv->scalability[SSDFS_SCALABILITY_DENTRIES_LOOKUP][step];
+	ctx->total_ops = env->dentries_tree.files_number_threshold;
+
+	ctx->scenario = SSDFS_SCALABILITY_DENTRIES_ADD;
+	err = ssdfs_testing_run_scalability(ctx, add);
+	if (unlikely(err))
+		goto delete_files;
+
+	ctx->scenario = SSDFS_SCALABILITY_DENTRIES_LOOKUP;
+	err = ssdfs_testing_run_scalability(ctx, lookup);
+
+delete_files:
+	/* failed threads could leave the gaps in the range of files */
+	for (file_index = 0; file_index < ctx->total_ops; file_index++) {
+		int res;
+
+		res = ssdfs_testing_dentries_tree_delete_file(fsi, ctx->root_i,
+							      file_index,
+							      name);
+		if (unlikely(res) && !err) {
+			SSDFS_ERR("fail to delete file: "
+				  "file_index %llu, err %d\n",
+				  file_index, res);
+			err = res;
+			break;
+		}
+	}
+
+	iput(ctx->root_i);
+	ctx->root_i = NULL;
+
+	return err;
+}
+
+/*
+ * ssdfs_scale_block_bmap() - concurrent block allocation
+ * @ctx: scalability scenario's context
+ * @benv: benchmark environment [in|out]
+ * @step: index of threads number's step
+ */
+static
+int ssdfs_scale_block_bmap(struct ssdfs_testing_scalability *ctx,
+			   struct ssdfs_benchmark_environment *benv,
+			   int step)
+{
+	struct ssdfs_testing_environment *env = &benv->env;
+	struct ssdfs_scalability_result *result;
+	struct ssdfs_block_bmap bmap;
+	int err, res;
+
+	result = &benv->scalability[SSDFS_SCALABILITY_BLOCK_BMAP_ALLOC][step];
+
+	err = ssdfs_block_bmap_create(ctx->fsi, &bmap,
+				      env->block_bitmap.capacity,
+				      SSDFS_BLK_BMAP_CREATE,
+				      SSDFS_BLK_FREE);
+	if (err) {
+		SSDFS_ERR("fail to create block bitmap: "
+			  "err %d\n", err);
+		return err;
+	}
+
+	ctx->bmap = &bmap;
+	ctx->total_ops = env->block_bitmap.capacity;
+	ctx->scenario = SSDFS_SCALABILITY_BLOCK_BMAP_ALLOC;
+
+	err = ssdfs_testing_run_scalability(ctx, result);
+
+	res = ssdfs_block_bmap_lock(&bmap);
+	if (!res) {
+		ssdfs_block_bmap_clean(&bmap);
+		ssdfs_block_bmap_clear_dirty_state(&bmap);
+		ssdfs_block_bmap_unlock(&bmap);
+	}
+
+	ssdfs_block_bmap_destroy(&bmap);
+	ctx->bmap = NULL;
+
+	return err;
+}
+
+/*
+ * ssdfs_scale_maptbl() - concurrent LEB to PEB conversion
+ * @ctx: scalability scenario's context
+ * @benv: benchmark environment [in|out]
+ * @step: index of threads number's step
+ */
+static
+int ssdfs_scale_maptbl(struct ssdfs_testing_scalability *ctx,
+		       struct ssdfs_benchmark_environment *benv,
+		       int step)
+{
+	struct ssdfs_testing_environment *env = &benv->env;
+	struct ssdfs_scalability_result *result;
+
+	if (!ctx->fsi->maptbl)
+		return 0;
+
+	result = &benv->scalability[SSDFS_SCALABILITY_MAPTBL_CONVERT][step];
+
+	ctx->total_ops = (u64)env->mapping_table.iterations_number *
+				env->mapping_table.peb_mappings_per_iteration;
+	if (ctx->total_ops == 0)
+		ctx->total_ops = ctx->fsi->maptbl->lebs_count;
+
+	ctx->scenario = SSDFS_SCALABILITY_MAPTBL_CONVERT;
+
+	return ssdfs_testing_run_scalability(ctx, result);
+}
+
+/*
+ * ssdfs_do_scalability_testing() - measure throughput vs. threads number
+ * @fsi: pointer on shared file system object
+ * @benv: benchmark environment [in|out]
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ */
+static
+int ssdfs_do_scalability_testing(struct ssdfs_fs_info *fsi,
+				 struct ssdfs_benchmark_environment *benv)
+{
+	struct ssdfs_testing_scalability *ctx;
+	struct ssdfs_testing_environment *env = &benv->env;
+	u32 max_threads;
+	u32 threads = 1;
+	int step;
+	int err = 0;
+
+	max_threads = min_t(u32, benv->threads_number,
+			    SSDFS_SCALABILITY_THREADS_MAX);
+	if (max_threads == 0)
+		return 0;
+
+	ctx = kvzalloc(sizeof(struct ssdfs_testing_scalability), GFP_KERNEL);
+	if (!ctx) {
+		SSDFS_ERR("fail to allocate scalability context\n");
+		return -ENOMEM;
+	}
+
+	ctx->fsi = fsi;
+
+	SSDFS_ERR("SCALABILITY TESTING STARTING...\n");
+
+	for (step = 0; step < SSDFS_SCALABILITY_STEPS_MAX; step++) {
+		ctx->threads = threads;
+
+		if (env->subsystems & SSDFS_ENABLE_DENTRIES_TREE_TESTING) {
+			err = ssdfs_scale_dentries_tree(ctx, benv, step);
+			if (err)
+				goto finish_testing;
+		}
+
+		if (env->subsystems & SSDFS_ENABLE_BLOCK_BMAP_TESTING) {
+			err = ssdfs_scale_block_bmap(ctx, benv, step);
+			if (err)
+				goto finish_testing;
+		}
+
+		if (env->subsystems & SSDFS_ENABLE_PEB_MAPPING_TABLE_TESTING) {
+			err = ssdfs_scale_maptbl(ctx, benv, step);
+			if (err)
+				goto finish_testing;
+		}
+
+		if (threads >= max_threads)
+			break;
+
+		threads = min_t(u32, threads * 2, max_threads);
+	}
+
+finish_testing:
+	if (err)
+		SSDFS_ERR("SCALABILITY TESTING FAILED\n");
+	else
+		SSDFS_ERR("SCALABILITY TESTING FINISHED\n");
+
+	kvfree(ctx);
+	return err;
+}
+
+/*
+ * ssdfs_do_benchmark() - run testing with timing of phases
+ * @fsi: pointer on shared file system object
+ * @benv: benchmark environment [in|out]
+ *
+ * This method executes the testing of enabled subsystems and measures
+ * the throughput and latency of add/check/change/delete operations,
+ * and the memory delta of every subsystem's testing.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ */
+int ssdfs_do_benchmark(struct ssdfs_fs_info *fsi,
+			struct ssdfs_benchmark_environment *benv)
+{
+	struct ssdfs_benchmark_context *bench;
+	int err;
+
+	bench = kvzalloc(sizeof(struct ssdfs_benchmark_context), GFP_KERNEL);
+	if (!bench) {
+		SSDFS_ERR("fail to allocate benchmark context\n");
+		return -ENOMEM;
+	}
+
+	memset(benv->results, 0, sizeof(benv->results));
+	bench->benv = benv;
+
+	fsi->testing_bench = bench;
+	err = ssdfs_do_testing(fsi, &benv->env);
+	fsi->testing_bench = NULL;
+
+	kvfree(bench);
+
+	memset(benv->scalability, 0, sizeof(benv->scalability));
+
+	if (!err && benv->threads_number > 0)
+		err = ssdfs_do_scalability_testing(fsi, benv);
 
 	return err;
 }
@@ -139,6 +139,50 @@ struct ssdfs_snapshots_tree_testing {
 	u64 snapshots_number_threshold;
 };
 
+/*
+ * struct ssdfs_compression_testing - compression testing environment
+ * @iterations_number: number of blocks for every compressor
+ * @block_size: size of (de)compressed block in bytes (0 - page size)
+ * @entropy_percent: percentage of random bytes in synthetic block
+ * @reserved: alignment
+ * @blob_pattern: pattern to generate the synthetic block
+ * @ino: inode ID of file with real data (0 - synthetic data)
+ * @file_offset: offset of file's range in bytes
+ * @file_length: length of file's range in bytes
+ */
+struct ssdfs_compression_testing {
+	u32 iterations_number;
+	u32 block_size;
+	u32 entropy_percent;
+	u32 reserved;
+	u64 blob_pattern;
+	u64 ino;
+	u64 file_offset;
+	u64 file_length;
+};
+
+/* Write replay patterns */
+enum {
+	SSDFS_WRITE_REPLAY_SEQUENTIAL,
+	SSDFS_WRITE_REPLAY_RANDOM,
+	SSDFS_WRITE_REPLAY_ZIPFIAN,
+	SSDFS_WRITE_REPLAY_PATTERN_MAX
+};
+
+/*
+ * struct ssdfs_write_replay_testing - write replay testing environment
+ * @pattern: pattern of written blocks' offsets
+ * @ops_number: number of written blocks
+ * @file_blocks: size of file (working set) in logical blocks
+ * @fsync_interval: commit logs every N written blocks (0 - at the end)
+ */
+struct ssdfs_write_replay_testing {
+	u32 pattern;
+	u32 ops_number;
+	u32 file_blocks;
+	u32 fsync_interval;
+};
+
 /*
  * struct ssdfs_testing_environment - define testing environment
  * @subsystems: enable testing particular subsystems
@@ -153,6 +197,8 @@ struct ssdfs_snapshots_tree_testing {
  * @xattr_tree: xattr tree testing environment
  * @shextree: shared extents tree testing environment
  * @snapshots_tree: snaphots tree testing environment
+ * @compression: compression testing environment
+ * @write_replay: write replay testing environment
  */
 struct ssdfs_testing_environment {
 	u64 subsystems;
@@ -168,6 +214,8 @@ struct ssdfs_testing_environment {
 	struct ssdfs_xattr_tree_testing xattr_tree;
 	struct ssdfs_shextree_testing shextree;
 	struct ssdfs_snapshots_tree_testing snapshots_tree;
+	struct ssdfs_compression_testing compression;
+	struct ssdfs_write_replay_testing write_replay;
 };
 
 /* Subsystem tests */
@@ -181,10 +229,118 @@ struct ssdfs_testing_environment {
 #define SSDFS_ENABLE_XATTR_TREE_TESTING		(1 << 7)
 #define SSDFS_ENABLE_SHEXTREE_TESTING		(1 << 8)
 #define SSDFS_ENABLE_SNAPSHOTS_TREE_TESTING	(1 << 9)
+#define SSDFS_ENABLE_COMPRESSION_TESTING	(1 << 10)
+#define SSDFS_ENABLE_WRITE_REPLAY_TESTING	(1 << 11)
+
+/* Index of subsystem (bit number of subsystem's flag) */
+enum {
+	SSDFS_EXTENTS_TREE_TESTING_ID,
+	SSDFS_DENTRIES_TREE_TESTING_ID,
+	SSDFS_BLOCK_BMAP_TESTING_ID,
+	SSDFS_BLK2OFF_TABLE_TESTING_ID,
+	SSDFS_PEB_MAPPING_TABLE_TESTING_ID,
+	SSDFS_SEGMENT_BITMAP_TESTING_ID,
+	SSDFS_SHARED_DICTIONARY_TESTING_ID,
+	SSDFS_XATTR_TREE_TESTING_ID,
+	SSDFS_SHEXTREE_TESTING_ID,
+	SSDFS_SNAPSHOTS_TREE_TESTING_ID,
+	SSDFS_COMPRESSION_TESTING_ID,
+	SSDFS_WRITE_REPLAY_TESTING_ID,
+	SSDFS_TESTING_SUBSYSTEMS_MAX
+};
+
+/* Benchmark phases */
+enum {
+	SSDFS_BENCHMARK_ADD_PHASE,
+	SSDFS_BENCHMARK_CHECK_PHASE,
+	SSDFS_BENCHMARK_CHANGE_PHASE,
+	SSDFS_BENCHMARK_DELETE_PHASE,
+	SSDFS_BENCHMARK_PHASE_MAX
+};
+
+/*
+ * struct ssdfs_benchmark_phase_result - result of benchmark's phase
+ * @ops: number of executed operations
+ * @nsecs: total time of operations in nanoseconds
+ * @ops_per_sec: operations per second
+ * @p50_nsecs: median latency of operation (upper bound of log2 bucket)
+ * @p99_nsecs: 99th percentile of latency (upper bound of log2 bucket)
+ */
+struct ssdfs_benchmark_phase_result {
+	u64 ops;
+	u64 nsecs;
+	u64 ops_per_sec;
+	u64 p50_nsecs;
+	u64 p99_nsecs;
+};
+
+/*
+ * struct ssdfs_benchmark_result - benchmark result of subsystem
+ * @phases: results of add/check/change/delete phases
+ * @nsecs: total time of subsystem's testing in nanoseconds
+ * @memory_delta: difference of allocated memory in bytes
+ */
+struct ssdfs_benchmark_result {
+	struct ssdfs_benchmark_phase_result phases[SSDFS_BENCHMARK_PHASE_MAX];
+	u64 nsecs;
+	s64 memory_delta;
+};
+
+#define SSDFS_SCALABILITY_THREADS_MAX	(128)
+#define SSDFS_SCALABILITY_STEPS_MAX	(8)
+
+/* Scalability scenarios */
+enum {
+	SSDFS_SCALABILITY_DENTRIES_ADD,
+	SSDFS_SCALABILITY_DENTRIES_LOOKUP,
+	SSDFS_SCALABILITY_BLOCK_BMAP_ALLOC,
+	SSDFS_SCALABILITY_MAPTBL_CONVERT,
+	SSDFS_SCALABILITY_SCENARIO_MAX
+};
+
+/*
+ * struct ssdfs_scalability_result - result of concurrent scenario
+ * @threads: number of concurrent threads
+ * @reserved: alignment
+ * @ops: number of executed operations by all threads
+ * @nsecs: time of scenario's execution in nanoseconds
+ * @ops_per_sec: throughput of all threads
+ */
+struct ssdfs_scalability_result {
+	u32 threads;
+	u32 reserved;
+	u64 ops;
+	u64 nsecs;
+	u64 ops_per_sec;
+};
+
+/*
+ * struct ssdfs_benchmark_environment - define benchmark environment
+ * @env: testing environment [in]
+ * @threads_number: max number of concurrent threads (0 - no scalability) [in]
+ * @reserved: alignment
+ * @results: results of enabled subsystems [out]
+ * @scalability: throughput for every step of threads number [out]
+ *
+ * The scalability scenarios are executed for the dentries tree,
+ * block bitmap and mapping table (if these subsystems are enabled)
+ * with 1, 2, 4, ... threads up to @threads_number.
+ */
+struct ssdfs_benchmark_environment {
+	struct ssdfs_testing_environment env;
+	u32 threads_number;
+	u32 reserved;
+	struct ssdfs_benchmark_result results[SSDFS_TESTING_SUBSYSTEMS_MAX];
+	struct ssdfs_scalability_result
+		scalability[SSDFS_SCALABILITY_SCENARIO_MAX]
+			   [SSDFS_SCALABILITY_STEPS_MAX];
+};
 
 #ifdef CONFIG_SSDFS_TESTING
 int ssdfs_do_testing(struct ssdfs_fs_info *fsi,
 		     struct ssdfs_testing_environment *env);
+int ssdfs_do_benchmark(struct ssdfs_fs_info *fsi,
+			struct ssdfs_benchmark_environment *benv);
 #else
 static inline
 int ssdfs_do_testing(struct ssdfs_fs_info *fsi,
@@ -195,6 +351,16 @@ int ssdfs_do_testing(struct ssdfs_fs_info *fsi,
 
 	return -EOPNOTSUPP;
 }
+
+static inline
+int ssdfs_do_benchmark(struct ssdfs_fs_info *fsi,
+			struct ssdfs_benchmark_environment *benv)
+{
+	SSDFS_ERR("Benchmark is not supported. "
+		  "Please, enable CONFIG_SSDFS_TESTING option.\n");
+
+	return -EOPNOTSUPP;
+}
 #endif /* CONFIG_SSDFS_TESTING */
 
 #endif /* _SSDFS_TESTING_H */
@@ -1120,7 +1120,7 @@ int ssdfs_prepare_segment_header_for_commit(struct ssdfs_fs_info *fsi,
 	hdr->seg_flags = cpu_to_le32(seg_flags);
 
 	hdr->volume_hdr.check.bytes = cpu_to_le16(data_size);
-	hdr->volume_hdr.check.flags = cpu_to_le16(SSDFS_CRC32);
+	hdr->volume_hdr.check.flags = cpu_to_le16(ssdfs_csum_type(fsi));
 
 	err = ssdfs_calculate_csum(&hdr->volume_hdr.check,
 				   hdr, data_size);
@@ -1186,8 +1186,9 @@ int ssdfs_prepare_partial_log_header_for_commit(struct ssdfs_fs_info *fsi,
 	hdr->seg_type = cpu_to_le16(seg_type);
 	hdr->pl_flags = cpu_to_le32(pl_flags);
 
-	spin_lock(&fsi->volume_state_lock);
-	hdr->free_pages = cpu_to_le64(fsi->free_pages);
+	hdr->free_pages = cpu_to_le64(ssdfs_fs_counter_sum(&fsi->free_pages));
+
+	SSDFS_SPIN_LOCK(volume_state, &fsi->volume_state_lock);
 	hdr->flags = cpu_to_le32(fsi->fs_flags);
 	spin_unlock(&fsi->volume_state_lock);
 
@@ -1244,7 +1245,7 @@ int ssdfs_prepare_partial_log_header_for_commit(struct ssdfs_fs_info *fsi,
 #endif /* CONFIG_SSDFS_DEBUG */
 
 	hdr->check.bytes = cpu_to_le16(data_size);
-	hdr->check.flags = cpu_to_le16(SSDFS_CRC32);
+	hdr->check.flags = cpu_to_le16(ssdfs_csum_type(fsi));
 
 	err = ssdfs_calculate_csum(&hdr->check,
 				   hdr, data_size);
@@ -1255,3 +1256,57 @@ int ssdfs_prepare_partial_log_header_for_commit(struct ssdfs_fs_info *fsi,
 
 	return 0;
 }
+
+/*
+ * ssdfs_get_mount_checkpoint() - get checkpoint of clean umount
+ * @fsi: pointer on shared file system object
+ *
+ * This function checks the checkpoint in the segment header
+ * of the last superblock log. The checkpoint is valid only if
+ * the volume has been unmounted cleanly and the checkpoint number
+ * is the same as the number of the log.
+ *
+ * RETURN: pointer on valid checkpoint or NULL.
+ */
+struct ssdfs_mount_checkpoint *
+ssdfs_get_mount_checkpoint(struct ssdfs_fs_info *fsi)
+{
+	struct ssdfs_segment_header *hdr;
+	struct ssdfs_mount_checkpoint *ckpt;
+	size_t ckpt_size = sizeof(struct ssdfs_mount_checkpoint);
+
+	BUILD_BUG_ON(sizeof(struct ssdfs_mount_checkpoint) >
+			sizeof(((struct ssdfs_segment_header *)0)->payload));
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!fsi || !fsi->sbi.vh_buf || !fsi->vs);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	hdr = SSDFS_SEG_HDR(fsi->sbi.vh_buf);
+	ckpt = (struct ssdfs_mount_checkpoint *)hdr->payload;
+
+	if (le16_to_cpu(ckpt->magic) != SSDFS_MOUNT_CHECKPOINT_MAGIC)
+		return NULL;
+
+	if (le16_to_cpu(fsi->vs->state) != SSDFS_VALID_FS ||
+	    le64_to_cpu(ckpt->cno) != le64_to_cpu(hdr->cno) ||
+	    le16_to_cpu(ckpt->flags) & ~SSDFS_MOUNT_CHECKPOINT_FLAGS_MASK ||
+	    le16_to_cpu(ckpt->check.bytes) != ckpt_size) {
+#ifdef CONFIG_SSDFS_DEBUG
+		SSDFS_DBG("ignore checkpoint: state %#x, "
+			  "cno %llu, log cno %llu, flags %#x\n",
+			  le16_to_cpu(fsi->vs->state),
+			  le64_to_cpu(ckpt->cno),
+			  le64_to_cpu(hdr->cno),
+			  le16_to_cpu(ckpt->flags));
+#endif /* CONFIG_SSDFS_DEBUG */
+		return NULL;
+	}
+
+	if (!is_csum_valid(&ckpt->check, ckpt, ckpt_size)) {
+		SSDFS_WARN("mount checkpoint is corrupted\n");
+		return NULL;
+	}
+
+	return ckpt;
+}
@@ -764,7 +764,7 @@ finish_get_start_hash:
 		goto clean_up;
 
 	do {
-		ssdfs_btree_search_init(search);
+		ssdfs_btree_search_reinit(search);
 
 		/* allow ssdfs_listxattr_generic_tree() to be interrupted */
 		if (fatal_signal_pending(current)) {
@@ -1063,7 +1063,7 @@ int ssdfs_xattr_read_external_blob(struct ssdfs_fs_info *fsi,
 		goto fail_get_segment;
 	}
 
-	pvec_size = blob_size >> PAGE_SHIFT;
+	pvec_size = (blob_size + PAGE_SIZE - 1) >> PAGE_SHIFT;
 
 	if (pvec_size == 0)
 		pvec_size = 1;
@@ -1250,6 +1250,7 @@ ssize_t __ssdfs_getxattr(struct inode *inode, int name_index, const char *name,
 	u8 blob_type;
 	u8 blob_flags;
 	int private_flags;
+	u64 version;
 	ssize_t err = 0;
 
 	if (name == NULL) {
@@ -1279,6 +1280,13 @@ ssize_t __ssdfs_getxattr(struct inode *inode, int name_index, const char *name,
 			goto finish_search_xattr;
 		}
 
+		version = ssdfs_xattrs_cache_version(ii->xattrs_tree);
+
+		if (ssdfs_xattrs_cache_lookup(ii->xattrs_tree, name_index,
+					      name, name_len,
+					      value, size, &err))
+			goto finish_search_xattr;
+
 		search = ssdfs_btree_search_alloc();
 		if (!search) {
 			err = -ENOMEM;
@@ -1298,6 +1306,9 @@ ssize_t __ssdfs_getxattr(struct inode *inode, int name_index, const char *name,
 				  (unsigned long)inode->i_ino,
 				  name);
 #endif /* CONFIG_SSDFS_DEBUG */
+			ssdfs_xattrs_cache_add(ii->xattrs_tree, version,
+						name_index, name, name_len,
+						NULL, 0);
 			goto xattr_is_not_available;
 		} else if (unlikely(err)) {
 			SSDFS_ERR("fail to find the xattr: "
@@ -1354,6 +1365,11 @@ ssize_t __ssdfs_getxattr(struct inode *inode, int name_index, const char *name,
 					  blob_len);
 				goto xattr_is_not_available;
 			}
+
+			ssdfs_xattrs_cache_add(ii->xattrs_tree, version,
+					name_index, name, name_len,
+					xattr->blob.inline_value.bytes,
+					blob_len);
 			break;
 
 		case SSDFS_XATTR_REGULAR_BLOB:
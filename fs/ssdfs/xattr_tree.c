@@ -152,6 +152,184 @@ u16 ssdfs_calculate_inline_capacity(struct ssdfs_fs_info *fsi)
 	return inline_capacity;
 }
 
+/*
+ * ssdfs_xattrs_cache_init() - initialize cache of xattr lookups
+ * @cache: cache of xattr lookups
+ */
+static inline
+void ssdfs_xattrs_cache_init(struct ssdfs_xattr_cache *cache)
+{
+	spin_lock_init(&cache->lock);
+	cache->version = 0;
+	cache->next = 0;
+	memset(cache->items, 0, sizeof(cache->items));
+}
+
+/*
+ * ssdfs_xattrs_cache_version() - get version of xattrs tree's content
+ * @tree: xattrs tree
+ */
+u64 ssdfs_xattrs_cache_version(struct ssdfs_xattrs_btree_info *tree)
+{
+	u64 version;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	spin_lock(&tree->cache.lock);
+	version = tree->cache.version;
+	spin_unlock(&tree->cache.lock);
+
+	return version;
+}
+
+/*
+ * ssdfs_xattrs_cache_invalidate() - empty cache of xattr lookups
+ * @tree: xattrs tree
+ *
+ * This method has to be called after any modification
+ * of the xattrs tree.
+ */
+static
+void ssdfs_xattrs_cache_invalidate(struct ssdfs_xattrs_btree_info *tree)
+{
+	spin_lock(&tree->cache.lock);
+	tree->cache.version++;
+	tree->cache.next = 0;
+	memset(tree->cache.items, 0, sizeof(tree->cache.items));
+	spin_unlock(&tree->cache.lock);
+}
+
+/*
+ * ssdfs_xattrs_cache_lookup() - find result of xattr lookup in the cache
+ * @tree: xattrs tree
+ * @name_index: name index
+ * @name: xattr's name
+ * @name_len: length of the name
+ * @value: buffer for the xattr's value (could be NULL)
+ * @size: size of the buffer in bytes
+ * @res: result of xattr lookup [out]
+ *
+ * This method tries to find the result of previous lookup
+ * of the xattr. The @res is set to -ENODATA if the xattr is absent,
+ * to the length of the value if the value has been copied
+ * into @value (or @value is NULL), or to -ERANGE if @size
+ * is not enough for the value.
+ *
+ * RETURN:
+ * [true]  - the result has been found.
+ * [false] - the cache doesn't contain the result.
+ */
+bool ssdfs_xattrs_cache_lookup(struct ssdfs_xattrs_btree_info *tree,
+				int name_index,
+				const char *name, size_t name_len,
+				void *value, size_t size,
+				ssize_t *res)
+{
+	struct ssdfs_xattr_cache_item *item;
+	bool is_found = false;
+	int i;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !name || !res);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (name_len == 0 || name_len > SSDFS_XATTR_CACHE_NAME_LEN)
+		return false;
+
+	spin_lock(&tree->cache.lock);
+	for (i = 0; i < SSDFS_XATTR_CACHE_SIZE; i++) {
+		item = &tree->cache.items[i];
+
+		if (item->name_len != name_len ||
+		    item->name_index != name_index)
+			continue;
+
+		if (memcmp(item->name, name, name_len) != 0)
+			continue;
+
+		if (item->is_absent)
+			*res = -ENODATA;
+		else if (!value)
+			*res = item->value_len;
+		else if (size < item->value_len)
+			*res = -ERANGE;
+		else {
+			memcpy(value, item->value, item->value_len);
+			*res = item->value_len;
+		}
+
+		is_found = true;
+		break;
+	}
+	spin_unlock(&tree->cache.lock);
+
+#ifdef CONFIG_SSDFS_DEBUG
+	SSDFS_DBG("name_index %d, name %s, is_found %#x\n",
+		  name_index, name, is_found);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	return is_found;
+}
+
+/*
+ * ssdfs_xattrs_cache_add() - add result of xattr lookup into the cache
+ * @tree: xattrs tree
+ * @version: version of xattrs tree's content before the search
+ * @name_index: name index
+ * @name: xattr's name
+ * @name_len: length of the name
+ * @value: xattr's value (NULL means absent xattr)
+ * @value_len: length of the value
+ *
+ * This method stores the result of the search into the cache.
+ * Only the absence of the xattr or the value of inline blob
+ * is stored. The result is ignored if the xattrs tree has been
+ * modified since the beginning of the search.
+ */
+void ssdfs_xattrs_cache_add(struct ssdfs_xattrs_btree_info *tree,
+			    u64 version, int name_index,
+			    const char *name, size_t name_len,
+			    const void *value, size_t value_len)
+{
+	struct ssdfs_xattr_cache_item *item;
+
+#ifdef CONFIG_SSDFS_DEBUG
+	BUG_ON(!tree || !name);
+#endif /* CONFIG_SSDFS_DEBUG */
+
+	if (name_len == 0 || name_len > SSDFS_XATTR_CACHE_NAME_LEN)
+		return;
+
+	if (value && value_len > SSDFS_XATTR_INLINE_BLOB_MAX_LEN)
+		return;
+
+	spin_lock(&tree->cache.lock);
+
+	if (tree->cache.version != version)
+		goto finish_add;
+
+	item = &tree->cache.items[tree->cache.next];
+	tree->cache.next = (tree->cache.next + 1) % SSDFS_XATTR_CACHE_SIZE;
+
+	item->name_index = name_index;
+	item->name_len = (u16)name_len;
+	memcpy(item->name, name, name_len);
+
+	if (value) {
+		item->is_absent = false;
+		item->value_len = (u16)value_len;
+		memcpy(item->value, value, value_len);
+	} else {
+		item->is_absent = true;
+		item->value_len = 0;
+	}
+
+finish_add:
+	spin_unlock(&tree->cache.lock);
+}
+
 /*
  * ssdfs_xattrs_tree_create() - create xattrs tree of a new inode
  * @fsi: pointer on shared file system object
@@ -232,6 +410,7 @@ int ssdfs_xattrs_tree_create(struct ssdfs_fs_info *fsi,
 		     &fsi->segs_tree->xattr_btree,
 		     0, sizeof(struct ssdfs_xattr_btree_descriptor),
 		     sizeof(struct ssdfs_xattr_btree_descriptor));
+	ssdfs_xattrs_cache_init(&ptr->cache);
 	ptr->owner = ii;
 	ptr->fsi = fsi;
 
@@ -1601,21 +1780,6 @@ size_t ssdfs_define_name_length(const char *name, size_t name_len)
 	return name_len;
 }
 
-/*
- * generate_value_hash() - generate the blob's hash
- * @value: pointer on xattr's blob
- * @size: size of the blob in bytes
- */
-static inline
-u64 generate_value_hash(const void *value, size_t size)
-{
-#ifdef CONFIG_SSDFS_DEBUG
-	BUG_ON(!value);
-#endif /* CONFIG_SSDFS_DEBUG */
-
-	return (u64)crc32(~0, value, size);
-}
-
 /*
  * ssdfs_save_external_blob() - save the external blob
  * @fsi:  pointer on shared file system object
@@ -1623,6 +1787,11 @@ u64 generate_value_hash(const void *value, size_t size)
  * @value: pointer on xattr's blob
  * @size: size of the blob in bytes
  * @desc: blob's extent descriptor [out]
+ *
+ * This function copies the blob into the pages of segment request
+ * and it calculates the blob's hash on the same pass through
+ * the value's buffer. The free pages are reserved for the whole
+ * blob because the blob could occupy several logical blocks.
  */
 static
 int ssdfs_save_external_blob(struct ssdfs_fs_info *fsi,
@@ -1635,6 +1804,7 @@ int ssdfs_save_external_blob(struct ssdfs_fs_info *fsi,
 	int pages_count;
 	size_t copied_data = 0;
 	size_t cur_len;
+	u32 hash = ~0;
 	u64 seg_id;
 	struct ssdfs_blk2off_range extent;
 	int i;
@@ -1654,11 +1824,15 @@ int ssdfs_save_external_blob(struct ssdfs_fs_info *fsi,
 		return -ERANGE;
 	}
 
-	err = ssdfs_reserve_free_pages(fsi, 1, SSDFS_USER_DATA_PAGES);
+	pages_count = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+
+	err = ssdfs_reserve_free_pages(fsi, pages_count,
+					SSDFS_USER_DATA_PAGES);
 	if (unlikely(err)) {
 #ifdef CONFIG_SSDFS_DEBUG
-		SSDFS_DBG("unable to reserve logical block: "
-			  "err %d\n", err);
+		SSDFS_DBG("unable to reserve logical blocks: "
+			  "pages_count %d, err %d\n",
+			  pages_count, err);
 #endif /* CONFIG_SSDFS_DEBUG */
 		return -ENOSPC;
 	}
@@ -1668,7 +1842,7 @@ int ssdfs_save_external_blob(struct ssdfs_fs_info *fsi,
 		err = (req == NULL ? -ENOMEM : PTR_ERR(req));
 		SSDFS_ERR("fail to allocate segment request: err %d\n",
 			  err);
-		goto free_reserved_page;
+		goto free_reserved_pages;
 	}
 
 	ssdfs_request_init(req);
@@ -1677,7 +1851,6 @@ int ssdfs_save_external_blob(struct ssdfs_fs_info *fsi,
 	ssdfs_request_prepare_logical_extent(ii->vfs_inode.i_ino,
 					     0, size, 0, 0, req);
 
-	pages_count = (size + PAGE_SIZE - 1) / PAGE_SIZE;
 	for (i = 0; i < pages_count; i++) {
 		page = ssdfs_request_allocate_and_add_page(req);
 		if (IS_ERR_OR_NULL(page)) {
@@ -1706,6 +1879,7 @@ int ssdfs_save_external_blob(struct ssdfs_fs_info *fsi,
 			goto finish_copy;
 		}
 
+		hash = crc32(hash, (u8 *)value + copied_data, cur_len);
 		copied_data += cur_len;
 
 finish_copy:
@@ -1734,7 +1908,7 @@ finish_copy:
 	BUG_ON(seg_id == U64_MAX);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	desc->hash = cpu_to_le64(generate_value_hash(value, size));
+	desc->hash = cpu_to_le64((u64)hash);
 	desc->extent.seg_id = cpu_to_le64(seg_id);
 	desc->extent.logical_blk = cpu_to_le32(extent.start_lblk);
 	desc->extent.len = cpu_to_le32(extent.len);
@@ -1757,10 +1931,8 @@ finish_save_external_blob:
 	ssdfs_put_request(req);
 	ssdfs_request_free(req);
 
-free_reserved_page:
-	spin_lock(&fsi->volume_state_lock);
-	fsi->free_pages--;
-	spin_unlock(&fsi->volume_state_lock);
+free_reserved_pages:
+	percpu_counter_add(&fsi->free_pages, pages_count);
 
 	return err;
 }
@@ -2887,6 +3059,8 @@ finish_add_generic_xattr:
 		return -ERANGE;
 	}
 
+	ssdfs_xattrs_cache_invalidate(tree);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("finished\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
@@ -3374,6 +3548,8 @@ finish_change_generic_xattr:
 		break;
 	}
 
+	ssdfs_xattrs_cache_invalidate(tree);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("finished\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
@@ -4099,6 +4275,8 @@ finish_delete_generic_xattr:
 		break;
 	}
 
+	ssdfs_xattrs_cache_invalidate(tree);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("finished\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
@@ -4313,6 +4491,8 @@ int ssdfs_xattrs_tree_delete_all(struct ssdfs_xattrs_btree_info *tree)
 		break;
 	}
 
+	ssdfs_xattrs_cache_invalidate(tree);
+
 #ifdef CONFIG_SSDFS_TRACK_API_CALL
 	SSDFS_ERR("finished\n");
 #endif /* CONFIG_SSDFS_TRACK_API_CALL */
@@ -4912,8 +5092,8 @@ int ssdfs_xattrs_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	err = ssdfs_btree_pre_flush_root_node(node);
 	if (unlikely(err)) {
@@ -4922,7 +5102,7 @@ int ssdfs_xattrs_btree_pre_flush_root_node(struct ssdfs_btree_node *node)
 			  node->node_id, err);
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 	up_write(&node->full_lock);
 
 	return err;
@@ -5131,7 +5311,7 @@ int ssdfs_xattrs_btree_create_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 	down_write(&node->bmap_array.lock);
 
 	switch (atomic_read(&node->type)) {
@@ -5306,7 +5486,7 @@ int ssdfs_xattrs_btree_create_node(struct ssdfs_btree_node *node)
 
 finish_create_node:
 	up_write(&node->bmap_array.lock);
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		return err;
@@ -5417,7 +5597,7 @@ int ssdfs_xattrs_btree_init_node(struct ssdfs_btree_node *node)
 		return -ERANGE;
 	}
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 
 	if (pagevec_count(&node->content.pvec) == 0) {
 		err = -ERANGE;
@@ -5452,7 +5632,7 @@ int ssdfs_xattrs_btree_init_node(struct ssdfs_btree_node *node)
 		goto finish_init_operation;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&node->raw.xattrs_header, 0, hdr_size,
 		     hdr, 0, hdr_size,
@@ -5620,7 +5800,7 @@ int ssdfs_xattrs_btree_init_node(struct ssdfs_btree_node *node)
 #endif /* CONFIG_SSDFS_DEBUG */
 
 finish_header_init:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_init_operation;
@@ -5954,8 +6134,8 @@ int ssdfs_xattrs_btree_pre_flush_node(struct ssdfs_btree_node *node)
 					 buffer.tree);
 	}
 
-	down_write(&node->full_lock);
-	down_write(&node->header_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	ssdfs_memcpy(&xattrs_header, 0, hdr_size,
 		     &node->raw.xattrs_header, 0, hdr_size,
@@ -6022,7 +6202,8 @@ int ssdfs_xattrs_btree_pre_flush_node(struct ssdfs_btree_node *node)
 	}
 
 	xattrs_header.node.check.bytes = cpu_to_le16((u16)hdr_size);
-	xattrs_header.node.check.flags = cpu_to_le16(SSDFS_CRC32);
+	xattrs_header.node.check.flags =
+		cpu_to_le16(ssdfs_csum_type(node->tree->fsi));
 
 	err = ssdfs_calculate_csum(&xattrs_header.node.check,
 				   &xattrs_header, hdr_size);
@@ -6036,7 +6217,7 @@ int ssdfs_xattrs_btree_pre_flush_node(struct ssdfs_btree_node *node)
 		     hdr_size);
 
 finish_xattrs_header_preparation:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		goto finish_node_pre_flush;
@@ -7738,7 +7919,7 @@ int __ssdfs_xattrs_btree_node_insert_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -7919,7 +8100,7 @@ finish_detect_affected_items:
 		goto unlock_items_range;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	node->items_area.items_count += search->request.count;
 	if (node->items_area.items_count > node->items_area.items_capacity) {
@@ -7999,7 +8180,7 @@ finish_detect_affected_items:
 	hdr->free_space = cpu_to_le16(node->items_area.free_space);
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -8370,7 +8551,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 		return err;
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	start_hash = node->items_area.start_hash;
 	end_hash = node->items_area.end_hash;
@@ -8418,7 +8599,7 @@ int ssdfs_change_item_only(struct ssdfs_btree_node *node,
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -8562,7 +8743,7 @@ int ssdfs_xattrs_btree_node_change_item(struct ssdfs_btree_node *node,
 		return -EFAULT;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -8887,7 +9068,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		}
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 	switch (atomic_read(&node->items_area.state)) {
 	case SSDFS_BTREE_NODE_ITEMS_AREA_EXIST:
@@ -8917,7 +9098,7 @@ int __ssdfs_invalidate_items_area(struct ssdfs_btree_node *node,
 		break;
 	}
 
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err)) {
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -9253,7 +9434,7 @@ int __ssdfs_xattrs_btree_node_delete_range(struct ssdfs_btree_node *node,
 		return -ERANGE;
 	}
 
-	down_write(&node->full_lock);
+	SSDFS_DOWN_WRITE(btree_node, &node->full_lock);
 
 	direction = is_requested_position_correct(node, &items_area,
 						  search);
@@ -9405,7 +9586,7 @@ finish_detect_affected_items:
 		}
 	}
 
-	down_write(&node->header_lock);
+	ssdfs_btree_node_header_down_write(node);
 
 #ifdef CONFIG_SSDFS_DEBUG
 	SSDFS_DBG("INITIAL STATE: node_id %u, "
@@ -9568,7 +9749,7 @@ finish_detect_affected_items:
 	}
 
 finish_items_area_correction:
-	up_write(&node->header_lock);
+	ssdfs_btree_node_header_up_write(node);
 
 	if (unlikely(err))
 		atomic_set(&node->state, SSDFS_BTREE_NODE_CORRUPTED);
@@ -9810,7 +9991,7 @@ int ssdfs_xattrs_btree_node_extract_range(struct ssdfs_btree_node *node,
 		  search->node.child);
 #endif /* CONFIG_SSDFS_DEBUG */
 
-	down_read(&node->full_lock);
+	SSDFS_DOWN_READ(btree_node, &node->full_lock);
 	err = __ssdfs_btree_node_extract_range(node, start_index, count,
 						sizeof(struct ssdfs_xattr_entry),
 						search);
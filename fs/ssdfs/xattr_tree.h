@@ -22,6 +22,49 @@
 #ifndef _SSDFS_XATTR_TREE_H
 #define _SSDFS_XATTR_TREE_H
 
+#define SSDFS_XATTR_CACHE_SIZE		(4)
+#define SSDFS_XATTR_CACHE_NAME_LEN	(32)
+
+/*
+ * struct ssdfs_xattr_cache_item - result of xattr lookup
+ * @name_index: name index
+ * @name_len: length of the name (zero means empty item)
+ * @value_len: length of the value
+ * @is_absent: xattr doesn't exist in the tree
+ * @name: xattr's name
+ * @value: xattr's value (inline blob)
+ */
+struct ssdfs_xattr_cache_item {
+	int name_index;
+	u16 name_len;
+	u16 value_len;
+	bool is_absent;
+	char name[SSDFS_XATTR_CACHE_NAME_LEN];
+	u8 value[SSDFS_XATTR_INLINE_BLOB_MAX_LEN];
+};
+
+/*
+ * struct ssdfs_xattr_cache - cache of recent xattr lookups
+ * @lock: cache's lock
+ * @version: version of the xattrs tree's content
+ * @next: index of the item for the next insertion
+ * @items: cached lookup results
+ *
+ * Permission checks (POSIX ACL, security modules) request the same
+ * xattrs on every access, usually for xattrs that don't exist at all.
+ * The cache keeps the recent results of the search: the absence of
+ * the xattr or the value of an inline blob. Any modification of
+ * the xattrs tree increments the version and empties the cache.
+ * A result is added into the cache only if the version hasn't been
+ * changed since the beginning of the search.
+ */
+struct ssdfs_xattr_cache {
+	spinlock_t lock;
+	u64 version;
+	u32 next;
+	struct ssdfs_xattr_cache_item items[SSDFS_XATTR_CACHE_SIZE];
+};
+
 /*
  * struct ssdfs_xattrs_btree_info - xattrs btree info
  * @type: xattrs btree type
@@ -36,6 +79,7 @@
  * @root: pointer on root node
  * @root_buffer: buffer for root node
  * @desc: b-tree descriptor
+ * @cache: cache of recent xattr lookups
  * @owner: pointer on owner inode object
  * @fsi: pointer on shared file system object
  */
@@ -57,6 +101,7 @@ struct ssdfs_xattrs_btree_info {
 	struct ssdfs_btree_inline_root_node root_buffer;
 
 	struct ssdfs_xattr_btree_descriptor desc;
+	struct ssdfs_xattr_cache cache;
 	struct ssdfs_inode_info *owner;
 	struct ssdfs_fs_info *fsi;
 };
@@ -112,6 +157,17 @@ int ssdfs_xattrs_tree_delete(struct ssdfs_xattrs_btree_info *tree,
 			     struct ssdfs_btree_search *search);
 int ssdfs_xattrs_tree_delete_all(struct ssdfs_xattrs_btree_info *tree);
 
+u64 ssdfs_xattrs_cache_version(struct ssdfs_xattrs_btree_info *tree);
+bool ssdfs_xattrs_cache_lookup(struct ssdfs_xattrs_btree_info *tree,
+				int name_index,
+				const char *name, size_t name_len,
+				void *value, size_t size,
+				ssize_t *res);
+void ssdfs_xattrs_cache_add(struct ssdfs_xattrs_btree_info *tree,
+			    u64 version, int name_index,
+			    const char *name, size_t name_len,
+			    const void *value, size_t value_len);
+
 /*
  * Xattr tree internal API
  */
@@ -67,6 +67,7 @@ struct ssdfs_metadata_check {
 #define SSDFS_CRC32			(1 << 0)
 #define SSDFS_ZLIB_COMPRESSED		(1 << 1)
 #define SSDFS_LZO_COMPRESSED		(1 << 2)
+#define SSDFS_CRC32C			(1 << 3)
 	__le16 flags;
 	__le32 csum;
 
@@ -667,6 +668,8 @@ struct ssdfs_user_data_options {
 #define SSDFS_USER_DATA_NOCOMPR_TYPE		(0)
 #define SSDFS_USER_DATA_ZLIB_COMPR_TYPE		(1)
 #define SSDFS_USER_DATA_LZO_COMPR_TYPE		(2)
+#define SSDFS_USER_DATA_ZSTD_COMPR_TYPE		(3)
+#define SSDFS_USER_DATA_LZ4_COMPR_TYPE		(4)
 	__le8 compression;
 	__le8 reserved1;
 	__le16 migration_threshold;
@@ -1051,7 +1054,9 @@ struct ssdfs_inode {
 #define SSDFS_INODE_HAS_INLINE_XATTR		(1 << 4)
 #define SSDFS_INODE_HAS_XATTR_BTREE		(1 << 5)
 #define SSDFS_INODE_HAS_INLINE_FILE		(1 << 6)
-#define SSDFS_INODE_PRIVATE_FLAGS_MASK		0x7F
+#define SSDFS_INODE_COMPR_POLICY_SHIFT		(8)
+#define SSDFS_INODE_COMPR_POLICY_MASK		(0x7 << 8)
+#define SSDFS_INODE_PRIVATE_FLAGS_MASK		0x77F
 	__le16 private_flags;
 
 	union {
@@ -1070,13 +1075,29 @@ struct ssdfs_inode {
 	 SSDFS_INODE_HAS_EXTENTS_BTREE | \
 	 SSDFS_INODE_HAS_INLINE_XATTR | \
 	 SSDFS_INODE_HAS_XATTR_BTREE | \
-	 SSDFS_INODE_HAS_INLINE_FILE)
+	 SSDFS_INODE_HAS_INLINE_FILE | \
+	 SSDFS_INODE_COMPR_POLICY_MASK)
 
 #define SSDFS_IFDIR_PRIVATE_FLAG_MASK \
 	(SSDFS_INODE_HAS_INLINE_DENTRIES | \
 	 SSDFS_INODE_HAS_DENTRIES_BTREE | \
 	 SSDFS_INODE_HAS_INLINE_XATTR | \
-	 SSDFS_INODE_HAS_XATTR_BTREE)
+	 SSDFS_INODE_HAS_XATTR_BTREE | \
+	 SSDFS_INODE_COMPR_POLICY_MASK)
+
+/*
+ * Compression policy of inode (SSDFS_INODE_COMPR_POLICY_MASK bits
+ * of private_flags). A new inode inherits the policy of the parent
+ * directory. The default policy follows the user data options
+ * of the volume.
+ */
+#define SSDFS_COMPR_POLICY_DEFAULT		(0)
+#define SSDFS_COMPR_POLICY_NONE			(1)
+#define SSDFS_COMPR_POLICY_ZLIB			(2)
+#define SSDFS_COMPR_POLICY_LZO			(3)
+#define SSDFS_COMPR_POLICY_ZSTD			(4)
+#define SSDFS_COMPR_POLICY_LZ4			(5)
+#define SSDFS_COMPR_POLICY_MAX			(6)
 
 /*
  * struct ssdfs_volume_header - static part of superblock
@@ -1296,7 +1317,11 @@ struct ssdfs_volume_state {
 #define SSDFS_FEATURE_COMPAT_RO_SUPP \
 	(SSDFS_ZLIB_COMPAT_RO_FLAG | SSDFS_LZO_COMPAT_RO_FLAG)
 
-#define SSDFS_FEATURE_INCOMPAT_SUPP	0ULL
+/* Incompatible feature flags */
+#define SSDFS_HAS_CRC32C_CSUM_INCOMPAT_FLAG		(1 << 0)
+
+#define SSDFS_FEATURE_INCOMPAT_SUPP \
+	(SSDFS_HAS_CRC32C_CSUM_INCOMPAT_FLAG)
 
 /*
  * struct ssdfs_metadata_descriptor - metadata descriptor
@@ -1377,6 +1402,48 @@ struct ssdfs_segment_header {
 /* 0x0800 */
 } __packed;
 
+/*
+ * struct ssdfs_mount_checkpoint - checkpoint of clean umount
+ * @magic: checkpoint magic
+ * @flags: checkpoint flags
+ * @segbmap_fragments: number of segment bitmap's fragments
+ * @reserved1: reserved field
+ * @check: checkpoint's checksum
+ * @cno: checkpoint number of superblock log
+ * @reserved2: reserved field
+ * @segbmap_fbmap: bitmaps of segment bitmap's fragments
+ *
+ * The superblock log of clean umount keeps the checkpoint
+ * in the payload of segment header. The checkpoint keeps
+ * the in-memory state that is otherwise re-derived
+ * from the metadata structures during mount.
+ */
+struct ssdfs_mount_checkpoint {
+/* 0x0000 */
+	__le16 magic;
+	__le16 flags;
+	__le16 segbmap_fragments;
+	__le16 reserved1;
+
+/* 0x0008 */
+	struct ssdfs_metadata_check check;
+
+/* 0x0010 */
+	__le64 cno;
+	__le64 reserved2;
+
+/* 0x0020 */
+#define SSDFS_CKPT_FBMAPS		(3)
+#define SSDFS_CKPT_FBMAP_BYTES		(0x100)
+	__le8 segbmap_fbmap[SSDFS_CKPT_FBMAPS][SSDFS_CKPT_FBMAP_BYTES];
+
+/* 0x0320 */
+} __packed;
+
+/* Mount checkpoint flags */
+#define SSDFS_MOUNT_CHECKPOINT_HAS_SEGBMAP	(1 << 0)
+#define SSDFS_MOUNT_CHECKPOINT_FLAGS_MASK	0x1
+
 /* Possible segment types */
 #define SSDFS_UNKNOWN_SEG_TYPE			(0)
 #define SSDFS_SB_SEG_TYPE			(1)
@@ -1966,7 +2033,9 @@ struct ssdfs_fragment_desc {
 #define SSDFS_BLK2OFF_DESC_ZLIB		12
 #define SSDFS_BLK2OFF_DESC_LZO		13
 #define SSDFS_NEXT_TABLE_DESC		14
-#define SSDFS_FRAGMENT_DESC_MAX_TYPE	(SSDFS_NEXT_TABLE_DESC + 1)
+#define SSDFS_FRAGMENT_ZSTD_BLOB	15
+#define SSDFS_FRAGMENT_LZ4_BLOB		16
+#define SSDFS_FRAGMENT_DESC_MAX_TYPE	(SSDFS_FRAGMENT_LZ4_BLOB + 1)
 
 /* Fragment descriptor flags */
 #define SSDFS_FRAGMENT_HAS_CSUM		(1 << 0)
@@ -3416,6 +3485,11 @@ struct ssdfs_shared_extent {
 /* 0x0040 */
 } __packed;
 
+/* Shared extent's fingerprint types */
+#define SSDFS_UNKNOWN_FINGERPRINT_TYPE		(0)
+#define SSDFS_SHA256_FINGERPRINT_TYPE		(1)
+#define SSDFS_FINGERPRINT_TYPE_MAX		(2)
+
 #define SSDFS_SHEXTREE_PAGES_PER_NODE_MAX		(32)
 #define SSDFS_SHEXTREE_BMAP_SIZE \
 	(((SSDFS_SHEXTREE_PAGES_PER_NODE_MAX * PAGE_SIZE) / \
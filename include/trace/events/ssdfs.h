@@ -19,6 +19,10 @@
 
 #include <linux/tracepoint.h>
 
+struct ssdfs_segment_request;
+struct ssdfs_peb_container;
+struct ssdfs_peb_info;
+
 DECLARE_EVENT_CLASS(ssdfs__inode,
 
 	TP_PROTO(struct inode *inode),
@@ -249,6 +253,224 @@ DEFINE_EVENT(ssdfs__inode_exit, ssdfs_unlink_exit,
 	TP_ARGS(inode, ret)
 );
 
+TRACE_EVENT(ssdfs_request_alloc,
+
+	TP_PROTO(struct ssdfs_segment_request *req),
+
+	TP_ARGS(req),
+
+	TP_STRUCT__entry(
+		__field(const void *,	req)
+	),
+
+	TP_fast_assign(
+		__entry->req	= req;
+	),
+
+	TP_printk("req = %p",
+		__entry->req)
+);
+
+TRACE_EVENT(ssdfs_request_enqueue,
+
+	TP_PROTO(struct ssdfs_segment_request *req, bool at_head),
+
+	TP_ARGS(req, at_head),
+
+	TP_STRUCT__entry(
+		__field(const void *,	req)
+		__field(u64,	seg_id)
+		__field(u16,	logical_blk)
+		__field(u16,	len)
+		__field(u64,	ino)
+		__field(int,	class)
+		__field(int,	cmd)
+		__field(int,	type)
+		__field(bool,	at_head)
+	),
+
+	TP_fast_assign(
+		__entry->req		= req;
+		__entry->seg_id		= req->place.start.seg_id;
+		__entry->logical_blk	= req->place.start.blk_index;
+		__entry->len		= req->place.len;
+		__entry->ino		= req->extent.ino;
+		__entry->class		= req->private.class;
+		__entry->cmd		= req->private.cmd;
+		__entry->type		= req->private.type;
+		__entry->at_head	= at_head;
+	),
+
+	TP_printk("req = %p, seg_id = %llu, logical_blk = %u, len = %u, "
+		"ino = %llu, class = %#x, cmd = %#x, type = %#x, "
+		"at_head = %d",
+		__entry->req,
+		(unsigned long long)__entry->seg_id,
+		(unsigned int)__entry->logical_blk,
+		(unsigned int)__entry->len,
+		(unsigned long long)__entry->ino,
+		__entry->class,
+		__entry->cmd,
+		__entry->type,
+		__entry->at_head)
+);
+
+DECLARE_EVENT_CLASS(ssdfs__peb_request,
+
+	TP_PROTO(struct ssdfs_peb_container *pebc,
+		 struct ssdfs_segment_request *req, int err),
+
+	TP_ARGS(pebc, req, err),
+
+	TP_STRUCT__entry(
+		__field(const void *,	req)
+		__field(u64,	seg_id)
+		__field(u16,	peb_index)
+		__field(int,	class)
+		__field(int,	cmd)
+		__field(int,	type)
+		__field(int,	err)
+	),
+
+	TP_fast_assign(
+		__entry->req		= req;
+		__entry->seg_id		= pebc->parent_si->seg_id;
+		__entry->peb_index	= pebc->peb_index;
+		__entry->class		= req->private.class;
+		__entry->cmd		= req->private.cmd;
+		__entry->type		= req->private.type;
+		__entry->err		= err;
+	),
+
+	TP_printk("req = %p, seg_id = %llu, peb_index = %u, "
+		"class = %#x, cmd = %#x, type = %#x, err = %d",
+		__entry->req,
+		(unsigned long long)__entry->seg_id,
+		(unsigned int)__entry->peb_index,
+		__entry->class,
+		__entry->cmd,
+		__entry->type,
+		__entry->err)
+);
+
+DEFINE_EVENT(ssdfs__peb_request, ssdfs_request_dequeue,
+
+	TP_PROTO(struct ssdfs_peb_container *pebc,
+		 struct ssdfs_segment_request *req, int err),
+
+	TP_ARGS(pebc, req, err)
+);
+
+DEFINE_EVENT(ssdfs__peb_request, ssdfs_request_complete,
+
+	TP_PROTO(struct ssdfs_peb_container *pebc,
+		 struct ssdfs_segment_request *req, int err),
+
+	TP_ARGS(pebc, req, err)
+);
+
+DECLARE_EVENT_CLASS(ssdfs__peb_log,
+
+	TP_PROTO(struct ssdfs_peb_info *pebi, int err),
+
+	TP_ARGS(pebi, err),
+
+	TP_STRUCT__entry(
+		__field(u64,	seg_id)
+		__field(u16,	peb_index)
+		__field(u64,	peb_id)
+		__field(u16,	start_page)
+		__field(int,	err)
+	),
+
+	TP_fast_assign(
+		__entry->seg_id		= pebi->pebc->parent_si->seg_id;
+		__entry->peb_index	= pebi->peb_index;
+		__entry->peb_id		= pebi->peb_id;
+		__entry->start_page	= pebi->current_log.start_page;
+		__entry->err		= err;
+	),
+
+	TP_printk("seg_id = %llu, peb_index = %u, peb_id = %llu, "
+		"start_page = %u, err = %d",
+		(unsigned long long)__entry->seg_id,
+		(unsigned int)__entry->peb_index,
+		(unsigned long long)__entry->peb_id,
+		(unsigned int)__entry->start_page,
+		__entry->err)
+);
+
+DEFINE_EVENT(ssdfs__peb_log, ssdfs_peb_commit_log_begin,
+
+	TP_PROTO(struct ssdfs_peb_info *pebi, int err),
+
+	TP_ARGS(pebi, err)
+);
+
+DEFINE_EVENT(ssdfs__peb_log, ssdfs_peb_commit_log_end,
+
+	TP_PROTO(struct ssdfs_peb_info *pebi, int err),
+
+	TP_ARGS(pebi, err)
+);
+
+TRACE_EVENT(ssdfs_bio_submit,
+
+	TP_PROTO(struct bio *bio),
+
+	TP_ARGS(bio),
+
+	TP_STRUCT__entry(
+		__field(const void *,	bio)
+		__field(dev_t,	dev)
+		__field(sector_t,	sector)
+		__field(unsigned int,	size)
+		__field(unsigned int,	opf)
+	),
+
+	TP_fast_assign(
+		__entry->bio	= bio;
+		__entry->dev	= bio->bi_bdev ? bio->bi_bdev->bd_dev : 0;
+		__entry->sector	= bio->bi_iter.bi_sector;
+		__entry->size	= bio->bi_iter.bi_size;
+		__entry->opf	= bio->bi_opf;
+	),
+
+	TP_printk("dev = (%d,%d), bio = %p, sector = %llu, size = %u, "
+		"opf = %#x",
+		MAJOR(__entry->dev),
+		MINOR(__entry->dev),
+		__entry->bio,
+		(unsigned long long)__entry->sector,
+		__entry->size,
+		__entry->opf)
+);
+
+TRACE_EVENT(ssdfs_bio_complete,
+
+	TP_PROTO(struct bio *bio),
+
+	TP_ARGS(bio),
+
+	TP_STRUCT__entry(
+		__field(const void *,	bio)
+		__field(dev_t,	dev)
+		__field(int,	status)
+	),
+
+	TP_fast_assign(
+		__entry->bio	= bio;
+		__entry->dev	= bio->bi_bdev ? bio->bi_bdev->bd_dev : 0;
+		__entry->status	= (int)bio->bi_status;
+	),
+
+	TP_printk("dev = (%d,%d), bio = %p, status = %d",
+		MAJOR(__entry->dev),
+		MINOR(__entry->dev),
+		__entry->bio,
+		__entry->status)
+);
+
 #endif /* _TRACE_SSDFS_H */
 
 /* This part must be outside protection */
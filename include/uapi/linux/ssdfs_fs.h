@@ -61,6 +61,7 @@
 #define SSDFS_DIFF_BLOB_MAGIC			0x4466		/* Df */
 #define SSDFS_INVEXT_BTREE_MAGIC		0x49784274	/* IxBt */
 #define SSDFS_INVEXT_BNODE_MAGIC		0x4958		/* IX */
+#define SSDFS_MOUNT_CHECKPOINT_MAGIC		0x4D43		/* MC */
 
 /* SSDFS revision */
 #define SSDFS_MAJOR_REVISION		1